@@ -37,9 +37,11 @@
 #include "execute_task_solution_capability.h"
 
 #include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/task_constructor/utils.h>
 
 #include <moveit/plan_execution/plan_execution.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/move_group/capability_names.h>
 #include <moveit/robot_state/conversions.h>
@@ -47,37 +49,78 @@
 #include <moveit/utils/message_checks.h>
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
 namespace {
 
-// TODO: move to moveit::core::RobotModel
-const moveit::core::JointModelGroup* findJointModelGroup(const moveit::core::RobotModel& model,
-                                                         const std::vector<std::string>& joints) {
-	std::set<std::string> joint_set(joints.begin(), joints.end());
-
-	const std::vector<const moveit::core::JointModelGroup*>& jmgs = model.getJointModelGroups();
-
-	for (const moveit::core::JointModelGroup* jmg : jmgs) {
-		const std::vector<std::string>& jmg_joints = jmg->getJointModelNames();
-		std::set<std::string> jmg_joint_set(jmg_joints.begin(), jmg_joints.end());
-
-		// return group if sets agree on all active joints
-		if (std::includes(jmg_joint_set.begin(), jmg_joint_set.end(), joint_set.begin(), joint_set.end())) {
-			std::set<std::string> difference;
-			std::set_difference(jmg_joint_set.begin(), jmg_joint_set.end(), joint_set.begin(), joint_set.end(),
-			                    std::inserter(difference, difference.begin()));
-			unsigned int acceptable = 0;
-			for (const std::string& diff_joint : difference) {
-				const moveit::core::JointModel* diff_jm = model.getJointModel(diff_joint);
-				if (diff_jm->isPassive() || diff_jm->getMimic() || diff_jm->getType() == moveit::core::JointModel::FIXED)
-					++acceptable;
+// number of converted solutions kept for resubmission
+constexpr size_t SOLUTION_CACHE_SIZE = 10;
+
+double maxJointDeviation(const moveit::core::RobotState& a, const moveit::core::RobotState& b) {
+	double deviation = 0.0;
+	for (const moveit::core::JointModel* jm : a.getRobotModel()->getActiveJointModels())
+		deviation = std::max(deviation, jm->distance(a.getJointPositions(jm), b.getJointPositions(jm)));
+	return deviation;
+}
+
+// largest ratio of waypoint velocities to the group's velocity limits, 0 if unknown
+double velocityScaling(const robot_trajectory::RobotTrajectory& trajectory) {
+	double scaling = 0.0;
+	for (size_t i = 0; i < trajectory.getWayPointCount(); ++i) {
+		const moveit::core::RobotState& waypoint = trajectory.getWayPoint(i);
+		if (!waypoint.hasVelocities())
+			return 0.0;
+		for (const moveit::core::JointModel* jm : trajectory.getGroup()->getActiveJointModels()) {
+			const moveit::core::JointModel::Bounds& bounds = jm->getVariableBounds();
+			for (size_t k = 0; k < bounds.size(); ++k) {
+				if (!bounds[k].velocity_bounded_ || bounds[k].max_velocity_ <= 0.0)
+					continue;
+				double velocity = std::abs(waypoint.getVariableVelocity(jm->getFirstVariableIndex() + k));
+				scaling = std::max(scaling, velocity / bounds[k].max_velocity_);
 			}
-			if (difference.size() == acceptable)
-				return jmg;
 		}
 	}
+	return std::min(scaling, 1.0);
+}
+
+// concatenate both trajectories and re-time them, rounding corners within radius
+robot_trajectory::RobotTrajectoryPtr blend(const robot_trajectory::RobotTrajectory& first,
+                                           const robot_trajectory::RobotTrajectory& second, double radius,
+                                           const planning_scene::PlanningScene& scene) {
+	// keep the velocity scaling the trajectories were planned with
+	const double scaling = std::max(velocityScaling(first), velocityScaling(second));
+	if (scaling <= 0.0)
+		return nullptr;
+
+	auto blended = std::make_shared<robot_trajectory::RobotTrajectory>(first.getRobotModel(), first.getGroup());
+	for (size_t i = 0; i < first.getWayPointCount(); ++i)
+		blended->addSuffixWayPoint(first.getWayPoint(i), 0.0);
+	// skip the duplicated junction state
+	for (size_t i = 1; i < second.getWayPointCount(); ++i)
+		blended->addSuffixWayPoint(second.getWayPoint(i), 0.0);
+
+	trajectory_processing::TimeOptimalTrajectoryGeneration timing(radius);
+	if (!timing.computeTimeStamps(*blended, scaling, scaling))
+		return nullptr;
 
-	return nullptr;
+	// blending deviates from the planned path
+	if (!scene.isPathValid(*blended, blended->getGroupName()))
+		return nullptr;
+	return blended;
 }
+
+// ids are unique within a task only, and zero without introspection
+uint32_t solutionId(const moveit_task_constructor_msgs::Solution& solution) {
+	if (!solution.sub_solution.empty())
+		return solution.sub_solution.front().info.id;
+	if (solution.sub_trajectory.size() == 1)
+		return solution.sub_trajectory.front().info.id;
+	return 0;
+}
+
 }  // namespace
 
 namespace move_group {
@@ -90,6 +133,15 @@ void ExecuteTaskSolutionCapability::initialize() {
 	    root_node_handle_, "execute_task_solution",
 	    std::bind(&ExecuteTaskSolutionCapability::goalCallback, this, std::placeholders::_1), false));
 	as_->registerPreemptCallback(std::bind(&ExecuteTaskSolutionCapability::preemptCallback, this));
+
+	node_handle_.param("execute_task_solution/segment_timeout", segment_timeout_, 10.0);
+	node_handle_.param("execute_task_solution/state_tolerance", state_tolerance_, 1e-2);
+	node_handle_.param("execute_task_solution/num_threads", num_threads_,
+	                   static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+	segment_sub_ = root_node_handle_.subscribe("execute_task_solution/segments", 100,
+	                                           &ExecuteTaskSolutionCapability::segmentCallback, this);
+	follow_up_sub_ = root_node_handle_.subscribe("execute_task_solution/follow_up", 10,
+	                                             &ExecuteTaskSolutionCapability::followUpCallback, this);
 	as_->start();
 }
 
@@ -104,14 +156,68 @@ void ExecuteTaskSolutionCapability::goalCallback(
 		return;
 	}
 
+	{
+		std::lock_guard<std::mutex> lock(follow_ups_mutex_);
+		accept_follow_ups_ = true;
+	}
+
+	if (goal->streaming) {
+		// drop segments left over from other tasks
+		std::lock_guard<std::mutex> lock(segments_mutex_);
+		segments_.erase(std::remove_if(segments_.begin(), segments_.end(),
+		                               [&goal](const moveit_task_constructor_msgs::SolutionSegmentConstPtr& segment) {
+			                               return segment->task_id != goal->solution.task_id;
+		                               }),
+		                segments_.end());
+	}
+
+	robot_state::RobotState state(context_->planning_scene_monitor_->getRobotModel());
 	plan_execution::ExecutableMotionPlan plan;
-	if (!constructMotionPlan(goal->solution, plan))
+	if (!constructMotionPlan(goal->solution, plan, state, goal->blend_radius))
 		result.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
 	else {
 		ROS_INFO_NAMED("ExecuteTaskSolution", "Executing TaskSolution");
 		result.error_code = context_->plan_execution_->executeAndMonitor(plan);
 	}
 
+	if (goal->streaming && result.error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS)
+		executeStream(goal->solution.task_id, state, goal->blend_radius, result.error_code);
+
+	if (goal->streaming) {
+		std::lock_guard<std::mutex> lock(segments_mutex_);
+		segments_.clear();
+	}
+
+	// seamlessly continue with follow-up solutions, planned against the predicted end scene
+	while (result.error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS) {
+		moveit_task_constructor_msgs::SolutionConstPtr follow_up;
+		{
+			std::lock_guard<std::mutex> lock(follow_ups_mutex_);
+			if (follow_ups_.empty())
+				break;
+			follow_up = follow_ups_.front();
+			follow_ups_.pop_front();
+		}
+		if (!matchesCurrentScene(follow_up->start_scene)) {
+			result.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_ROBOT_STATE;
+			break;
+		}
+		plan = plan_execution::ExecutableMotionPlan();
+		if (!constructMotionPlan(*follow_up, plan, state, goal->blend_radius)) {
+			result.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+			break;
+		}
+		ROS_INFO_NAMED("ExecuteTaskSolution", "Executing follow-up TaskSolution");
+		result.error_code = context_->plan_execution_->executeAndMonitor(plan);
+	}
+	{
+		std::lock_guard<std::mutex> lock(follow_ups_mutex_);
+		if (!follow_ups_.empty())
+			ROS_WARN_NAMED("ExecuteTaskSolution", "Dropping %zu follow-up solution(s)", follow_ups_.size());
+		follow_ups_.clear();
+		accept_follow_ups_ = false;
+	}
+
 	const std::string response = context_->plan_execution_->getErrorCodeString(result.error_code);
 
 	if (result.error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS)
@@ -125,28 +231,239 @@ void ExecuteTaskSolutionCapability::goalCallback(
 void ExecuteTaskSolutionCapability::preemptCallback() {
 	if (context_->plan_execution_)
 		context_->plan_execution_->stop();
+	segments_cv_.notify_all();
 }
 
-bool ExecuteTaskSolutionCapability::constructMotionPlan(const moveit_task_constructor_msgs::Solution& solution,
-                                                        plan_execution::ExecutableMotionPlan& plan) {
-	robot_model::RobotModelConstPtr model = context_->planning_scene_monitor_->getRobotModel();
+void ExecuteTaskSolutionCapability::segmentCallback(
+    const moveit_task_constructor_msgs::SolutionSegmentConstPtr& segment) {
+	{
+		std::lock_guard<std::mutex> lock(segments_mutex_);
+		segments_.push_back(segment);
+	}
+	segments_cv_.notify_all();
+}
 
-	robot_state::RobotState state(model);
+void ExecuteTaskSolutionCapability::followUpCallback(const moveit_task_constructor_msgs::SolutionConstPtr& solution) {
+	{
+		std::lock_guard<std::mutex> lock(follow_ups_mutex_);
+		if (!accept_follow_ups_) {
+			ROS_WARN_NAMED("ExecuteTaskSolution", "Ignoring follow-up TaskSolution: no goal is running");
+			return;
+		}
+	}
+	// convert and cache the solution while the current one is still executing
+	planning_scene::PlanningScenePtr predicted_scene = sceneSnapshot();
+	predicted_scene->setPlanningSceneMsg(solution->start_scene);
+	robot_state::RobotState state(predicted_scene->getCurrentState());
+	const robot_state::RobotState start_state(state);
+
+	plan_execution::ExecutableMotionPlan plan;
+	std::vector<robot_trajectory::RobotTrajectoryPtr> trajectories;
+	if (solutionId(*solution) && appendMotionPlan(solution->sub_trajectory, plan, state, predicted_scene, 0.0, 0,
+	                                              std::to_string(solution->sub_trajectory.size()), trajectories))
+		cacheSolution(*solution, start_state, trajectories);
+
+	std::lock_guard<std::mutex> lock(follow_ups_mutex_);
+	if (accept_follow_ups_)  // goal might have finished meanwhile
+		follow_ups_.push_back(solution);
+}
+
+void ExecuteTaskSolutionCapability::executeStream(const std::string& task_id, robot_state::RobotState& state,
+                                                  double blend_radius, moveit_msgs::MoveItErrorCodes& error_code) {
+	size_t executed = 0;
+	for (bool final = false; !final;) {
+		moveit_task_constructor_msgs::SolutionSegmentConstPtr segment = waitForSegment(task_id, error_code);
+		if (!segment)
+			return;
+		final = segment->final;
+		if (segment->sub_trajectory.empty())
+			continue;
+
+		const robot_state::RobotState predicted(state);
+		plan_execution::ExecutableMotionPlan plan;
+		std::vector<robot_trajectory::RobotTrajectoryPtr> trajectories;
+		if (!appendMotionPlan(segment->sub_trajectory, plan, state, sceneSnapshot(), blend_radius, executed, "?",
+		                      trajectories)) {
+			error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+			return;
+		}
+		executed += segment->sub_trajectory.size();
+
+		// handshake: the segment needs to continue from the predicted state, which the robot needs to have reached
+		for (const plan_execution::ExecutableTrajectory& exec_traj : plan.plan_components_) {
+			if (exec_traj.trajectory_->empty())
+				continue;
+			if (maxJointDeviation(exec_traj.trajectory_->getFirstWayPoint(), predicted) > state_tolerance_) {
+				ROS_ERROR_NAMED("ExecuteTaskSolution", "Streamed segment doesn't start at the end of its predecessor");
+				error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+				return;
+			}
+			break;
+		}
+		if (!matchesCurrentState(predicted)) {
+			error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_ROBOT_STATE;
+			return;
+		}
+
+		ROS_INFO_NAMED("ExecuteTaskSolution", "Executing streamed segment");
+		error_code = context_->plan_execution_->executeAndMonitor(plan);
+		if (error_code.val != moveit_msgs::MoveItErrorCodes::SUCCESS)
+			return;
+	}
+}
+
+moveit_task_constructor_msgs::SolutionSegmentConstPtr
+ExecuteTaskSolutionCapability::waitForSegment(const std::string& task_id, moveit_msgs::MoveItErrorCodes& error_code) {
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(segment_timeout_);
+	std::unique_lock<std::mutex> lock(segments_mutex_);
+	while (true) {
+		while (!segments_.empty()) {
+			moveit_task_constructor_msgs::SolutionSegmentConstPtr segment = segments_.front();
+			segments_.pop_front();
+			if (segment->task_id == task_id)
+				return segment;
+			ROS_WARN_NAMED("ExecuteTaskSolution", "Ignoring segment of task '%s' while streaming '%s'",
+			               segment->task_id.c_str(), task_id.c_str());
+		}
+		if (as_->isPreemptRequested()) {
+			error_code.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+			return nullptr;
+		}
+		if (!ros::ok() || std::chrono::steady_clock::now() >= deadline) {
+			ROS_ERROR_NAMED("ExecuteTaskSolution", "Timed out waiting for next streamed segment");
+			error_code.val = moveit_msgs::MoveItErrorCodes::TIMED_OUT;
+			return nullptr;
+		}
+		// wake up regularly to notice preemption and shutdown
+		segments_cv_.wait_for(lock, std::chrono::milliseconds(100));
+	}
+}
+
+bool ExecuteTaskSolutionCapability::matchesCurrentState(const robot_state::RobotState& predicted) {
+	context_->planning_scene_monitor_->waitForCurrentRobotState(ros::Time::now(), 1.0);
+	planning_scene_monitor::LockedPlanningSceneRO scene(context_->planning_scene_monitor_);
+	const double deviation = maxJointDeviation(scene->getCurrentState(), predicted);
+	if (deviation > state_tolerance_) {
+		ROS_ERROR_NAMED("ExecuteTaskSolution", "Current robot state deviates by %f from predicted state", deviation);
+		return false;
+	}
+	return true;
+}
+
+planning_scene::PlanningScenePtr ExecuteTaskSolutionCapability::sceneSnapshot() {
+	planning_scene_monitor::LockedPlanningSceneRO scene(context_->planning_scene_monitor_);
+	return planning_scene::PlanningScene::clone(scene);
+}
+
+bool ExecuteTaskSolutionCapability::matchesCurrentScene(const moveit_msgs::PlanningScene& predicted) {
+	robot_state::RobotState state(context_->planning_scene_monitor_->getRobotModel());
+	std::set<std::string> object_ids, attached_ids;
 	{
 		planning_scene_monitor::LockedPlanningSceneRO scene(context_->planning_scene_monitor_);
 		state = scene->getCurrentState();
+		const std::vector<std::string> ids = scene->getWorld()->getObjectIds();
+		object_ids.insert(ids.begin(), ids.end());
 	}
+	std::vector<const moveit::core::AttachedBody*> attached_bodies;
+	state.getAttachedBodies(attached_bodies);
+	for (const moveit::core::AttachedBody* body : attached_bodies)
+		attached_ids.insert(body->getName());
 
-	plan.plan_components_.reserve(solution.sub_trajectory.size());
-	for (size_t i = 0; i < solution.sub_trajectory.size(); ++i) {
-		const moveit_task_constructor_msgs::SubTrajectory& sub_traj = solution.sub_trajectory[i];
+	if (!moveit::core::robotStateMsgToRobotState(predicted.robot_state, state, true)) {
+		ROS_ERROR_NAMED("ExecuteTaskSolution", "Invalid robot state in predicted start scene");
+		return false;
+	}
+	if (!matchesCurrentState(state))
+		return false;
+	// diffs don't describe the whole scene
+	if (predicted.is_diff)
+		return true;
 
-		plan.plan_components_.emplace_back();
-		plan_execution::ExecutableTrajectory& exec_traj = plan.plan_components_.back();
+	std::set<std::string> predicted_object_ids, predicted_attached_ids;
+	for (const moveit_msgs::CollisionObject& object : predicted.world.collision_objects)
+		predicted_object_ids.insert(object.id);
+	for (const moveit_msgs::AttachedCollisionObject& object : predicted.robot_state.attached_collision_objects)
+		predicted_attached_ids.insert(object.object.id);
+	if (object_ids != predicted_object_ids || attached_ids != predicted_attached_ids) {
+		ROS_ERROR_NAMED("ExecuteTaskSolution", "Current scene objects differ from predicted start scene");
+		return false;
+	}
+	return true;
+}
 
-		// define individual variable for use in closure below
-		const std::string description = std::to_string(i + 1) + "/" + std::to_string(solution.sub_trajectory.size());
-		exec_traj.description_ = description;
+std::vector<robot_trajectory::RobotTrajectoryPtr>
+ExecuteTaskSolutionCapability::cachedTrajectories(const moveit_task_constructor_msgs::Solution& solution,
+                                                  const robot_state::RobotState& start_state) {
+	const uint32_t id = solutionId(solution);
+	std::lock_guard<std::mutex> lock(cache_mutex_);
+	for (const CachedSolution& entry : solution_cache_) {
+		// conversion only depends on the start state
+		if (id && entry.id == id && entry.task_id == solution.task_id &&
+		    entry.trajectories.size() == solution.sub_trajectory.size() &&
+		    maxJointDeviation(entry.start_state, start_state) <= state_tolerance_) {
+			ROS_DEBUG_NAMED("ExecuteTaskSolution", "Reusing converted trajectories of solution %u", id);
+			return entry.trajectories;
+		}
+	}
+	return {};
+}
+
+void ExecuteTaskSolutionCapability::cacheSolution(
+    const moveit_task_constructor_msgs::Solution& solution, const robot_state::RobotState& start_state,
+    const std::vector<robot_trajectory::RobotTrajectoryPtr>& trajectories) {
+	const uint32_t id = solutionId(solution);
+	if (!id)
+		return;
+
+	std::lock_guard<std::mutex> lock(cache_mutex_);
+	solution_cache_.remove_if(
+	    [&](const CachedSolution& entry) { return entry.id == id && entry.task_id == solution.task_id; });
+	solution_cache_.push_front(CachedSolution{ solution.task_id, id, start_state, trajectories });
+	if (solution_cache_.size() > SOLUTION_CACHE_SIZE)
+		solution_cache_.pop_back();
+}
+
+bool ExecuteTaskSolutionCapability::constructMotionPlan(const moveit_task_constructor_msgs::Solution& solution,
+                                                        plan_execution::ExecutableMotionPlan& plan,
+                                                        robot_state::RobotState& state, double blend_radius) {
+	planning_scene::PlanningScenePtr snapshot = sceneSnapshot();
+	state = snapshot->getCurrentState();
+
+	const robot_state::RobotState start_state(state);
+	std::vector<robot_trajectory::RobotTrajectoryPtr> trajectories = cachedTrajectories(solution, start_state);
+	if (!appendMotionPlan(solution.sub_trajectory, plan, state, snapshot, blend_radius, 0,
+	                      std::to_string(solution.sub_trajectory.size()), trajectories))
+		return false;
+
+	cacheSolution(solution, start_state, trajectories);
+	return true;
+}
+
+bool ExecuteTaskSolutionCapability::appendMotionPlan(
+    const std::vector<moveit_task_constructor_msgs::SubTrajectory>& sub_trajectories,
+    plan_execution::ExecutableMotionPlan& plan, robot_state::RobotState& state,
+    const planning_scene::PlanningScenePtr& scene, double blend_radius, size_t first_id, const std::string& total,
+    std::vector<robot_trajectory::RobotTrajectoryPtr>& trajectories) {
+	robot_model::RobotModelConstPtr model = context_->planning_scene_monitor_->getRobotModel();
+	const size_t n = sub_trajectories.size();
+
+	// sequentially predict start state, group, and scene of each sub trajectory
+	std::vector<std::string> descriptions;
+	std::vector<robot_state::RobotState> start_states;
+	std::vector<const moveit::core::JointModelGroup*> groups;
+	std::vector<planning_scene::PlanningSceneConstPtr> scenes;
+	std::vector<bool> scene_changes;
+	descriptions.reserve(n);
+	start_states.reserve(n);
+	groups.reserve(n);
+	scenes.reserve(n);
+	scene_changes.reserve(n);
+
+	planning_scene::PlanningScenePtr predicted_scene = scene;
+	for (size_t i = 0; i < n; ++i) {
+		const moveit_task_constructor_msgs::SubTrajectory& sub_traj = sub_trajectories[i];
+		descriptions.push_back(std::to_string(first_id + i + 1) + "/" + total);
+		const std::string& description = descriptions.back();
 
 		const moveit::core::JointModelGroup* group = nullptr;
 		{
@@ -154,7 +471,7 @@ bool ExecuteTaskSolutionCapability::constructMotionPlan(const moveit_task_constr
 			joint_names.insert(joint_names.end(), sub_traj.trajectory.multi_dof_joint_trajectory.joint_names.begin(),
 			                   sub_traj.trajectory.multi_dof_joint_trajectory.joint_names.end());
 			if (!joint_names.empty()) {
-				group = findJointModelGroup(*model, joint_names);
+				group = moveit::task_constructor::utils::findJointModelGroup(*model, joint_names);
 				if (!group) {
 					ROS_ERROR_STREAM_NAMED("ExecuteTaskSolution", "Could not find JointModelGroup that actuates {"
 					                                                  << boost::algorithm::join(joint_names, ", ") << "}");
@@ -164,8 +481,62 @@ bool ExecuteTaskSolutionCapability::constructMotionPlan(const moveit_task_constr
 				                group->getName().c_str());
 			}
 		}
-		exec_traj.trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(model, group);
-		exec_traj.trajectory_->setRobotTrajectoryMsg(state, sub_traj.trajectory);
+		groups.push_back(group);
+		start_states.push_back(state);
+		// each sub trajectory runs in the scene resulting from all preceding scene diffs
+		scenes.push_back(predicted_scene);
+		predicted_scene = moveit::task_constructor::utils::predictScene(predicted_scene, sub_traj.scene_diff);
+		scene_changes.push_back(predicted_scene != scenes.back());
+
+#if MOVEIT_HAS_MESSAGE_CHECKS
+		if (!moveit::core::isEmpty(sub_traj.scene_diff.robot_state) &&
+#else
+		if (!planning_scene::PlanningScene::isEmpty(sub_traj.scene_diff.robot_state) &&
+#endif
+		    !moveit::core::robotStateMsgToRobotState(sub_traj.scene_diff.robot_state, state, true)) {
+			ROS_ERROR_STREAM_NAMED("ExecuteTaskSolution",
+			                       "invalid intermediate robot state in scene diff of SubTrajectory " << description);
+			return false;
+		}
+	}
+
+	// convert (unless cached) and validate all sub trajectories in parallel
+	const bool convert = trajectories.size() != n;
+	if (convert)
+		trajectories.assign(n, nullptr);
+	std::vector<char> valid(n, false);  // std::vector<bool> doesn't support concurrent writes
+	const size_t num_threads = std::max<size_t>(1, std::min<size_t>(num_threads_, n));
+	auto process = [&](size_t first) {
+		for (size_t i = first; i < n; i += num_threads) {
+			if (convert) {
+				trajectories[i] = std::make_shared<robot_trajectory::RobotTrajectory>(model, groups[i]);
+				trajectories[i]->setRobotTrajectoryMsg(start_states[i], sub_trajectories[i].trajectory);
+			}
+			const robot_trajectory::RobotTrajectory& trajectory = *trajectories[i];
+			valid[i] = trajectory.empty() || scenes[i]->isPathValid(trajectory, trajectory.getGroupName());
+		}
+	};
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < num_threads; ++t)
+		threads.emplace_back(process, t);
+	process(0);
+	for (std::thread& thread : threads)
+		thread.join();
+
+	plan.plan_components_.reserve(plan.plan_components_.size() + n);
+	for (size_t i = 0; i < n; ++i) {
+		const moveit_task_constructor_msgs::SubTrajectory& sub_traj = sub_trajectories[i];
+		// define individual variable for use in closure below
+		const std::string description = descriptions[i];
+		if (!valid[i]) {
+			ROS_ERROR_STREAM_NAMED("ExecuteTaskSolution", "SubTrajectory " << description << " is invalid in its scene");
+			return false;
+		}
+
+		plan.plan_components_.emplace_back();
+		plan_execution::ExecutableTrajectory& exec_traj = plan.plan_components_.back();
+		exec_traj.description_ = description;
+		exec_traj.trajectory_ = trajectories[i];
 
 		/* TODO add action feedback and markers */
 		exec_traj.effect_on_success_ = [this, sub_traj,
@@ -181,15 +552,22 @@ bool ExecuteTaskSolutionCapability::constructMotionPlan(const moveit_task_constr
 			return true;
 		};
 
-#if MOVEIT_HAS_MESSAGE_CHECKS
-		if (!moveit::core::isEmpty(sub_traj.scene_diff.robot_state) &&
-#else
-		if (!planning_scene::PlanningScene::isEmpty(sub_traj.scene_diff.robot_state) &&
-#endif
-		    !moveit::core::robotStateMsgToRobotState(sub_traj.scene_diff.robot_state, state, true)) {
-			ROS_ERROR_STREAM_NAMED("ExecuteTaskSolution",
-			                       "invalid intermediate robot state in scene diff of SubTrajectory " << description);
-			return false;
+		// merge into the previous trajectory if both are executed by the same group without scene change in between
+		// never blend across segment boundaries
+		const size_t k = plan.plan_components_.size();
+		if (blend_radius <= 0.0 || i == 0 || scene_changes[i - 1] || !groups[i] || k < 2)
+			continue;
+		plan_execution::ExecutableTrajectory& previous = plan.plan_components_[k - 2];
+		if (previous.trajectory_->getGroup() != groups[i] || previous.trajectory_->empty() ||
+		    exec_traj.trajectory_->empty())
+			continue;
+		if (auto blended = blend(*previous.trajectory_, *exec_traj.trajectory_, blend_radius, *scenes[i])) {
+			ROS_DEBUG_STREAM_NAMED("ExecuteTaskSolution", "blending " << previous.description_ << " and " << description);
+			previous.trajectory_ = blended;
+			previous.description_ += "+" + description;
+			// the previous effect didn't change the scene
+			previous.effect_on_success_ = exec_traj.effect_on_success_;
+			plan.plan_components_.pop_back();
 		}
 	}
 
@@ -45,8 +45,14 @@
 #include <actionlib/server/simple_action_server.h>
 
 #include <moveit_task_constructor_msgs/ExecuteTaskSolutionAction.h>
+#include <moveit_task_constructor_msgs/Solution.h>
+#include <moveit_task_constructor_msgs/SolutionSegment.h>
 
+#include <condition_variable>
+#include <deque>
+#include <list>
 #include <memory>
+#include <mutex>
 
 namespace move_group {
 
@@ -58,13 +64,71 @@ public:
 	void initialize() override;
 
 private:
+	struct CachedSolution
+	{
+		std::string task_id;
+		uint32_t id;
+		robot_state::RobotState start_state;
+		std::vector<robot_trajectory::RobotTrajectoryPtr> trajectories;
+	};
+
+	/// copy of the monitored scene, only locking it for copying
+	planning_scene::PlanningScenePtr sceneSnapshot();
+
+	std::vector<robot_trajectory::RobotTrajectoryPtr>
+	cachedTrajectories(const moveit_task_constructor_msgs::Solution& solution,
+	                   const robot_state::RobotState& start_state);
+	void cacheSolution(const moveit_task_constructor_msgs::Solution& solution,
+	                   const robot_state::RobotState& start_state,
+	                   const std::vector<robot_trajectory::RobotTrajectoryPtr>& trajectories);
+
 	bool constructMotionPlan(const moveit_task_constructor_msgs::Solution& solution,
-	                         plan_execution::ExecutableMotionPlan& plan);
+	                         plan_execution::ExecutableMotionPlan& plan, robot_state::RobotState& state,
+	                         double blend_radius);
+	/** append sub trajectories to plan, advancing state to their predicted end state
+	 *
+	 * Sub trajectories are validated against scene, updated by their scene diffs.
+	 * Their conversions are returned in trajectories, which are reused if already provided.
+	 */
+	bool appendMotionPlan(const std::vector<moveit_task_constructor_msgs::SubTrajectory>& sub_trajectories,
+	                      plan_execution::ExecutableMotionPlan& plan, robot_state::RobotState& state,
+	                      const planning_scene::PlanningScenePtr& scene, double blend_radius, size_t first_id,
+	                      const std::string& total, std::vector<robot_trajectory::RobotTrajectoryPtr>& trajectories);
+
+	/// execute streamed segments of task_id, continuing from the predicted state
+	void executeStream(const std::string& task_id, robot_state::RobotState& state, double blend_radius,
+	                   moveit_msgs::MoveItErrorCodes& error_code);
+	moveit_task_constructor_msgs::SolutionSegmentConstPtr waitForSegment(const std::string& task_id,
+	                                                                     moveit_msgs::MoveItErrorCodes& error_code);
+	/// check that the monitored robot state agrees with the predicted one
+	bool matchesCurrentState(const robot_state::RobotState& predicted);
+	/// check that robot state and objects of the monitored scene agree with the predicted ones
+	bool matchesCurrentScene(const moveit_msgs::PlanningScene& predicted);
 
 	void goalCallback(const moveit_task_constructor_msgs::ExecuteTaskSolutionGoalConstPtr& goal);
 	void preemptCallback();
+	void segmentCallback(const moveit_task_constructor_msgs::SolutionSegmentConstPtr& segment);
+	void followUpCallback(const moveit_task_constructor_msgs::SolutionConstPtr& solution);
 
 	std::unique_ptr<actionlib::SimpleActionServer<moveit_task_constructor_msgs::ExecuteTaskSolutionAction>> as_;
+
+	ros::Subscriber segment_sub_;
+	std::mutex segments_mutex_;
+	std::condition_variable segments_cv_;
+	std::deque<moveit_task_constructor_msgs::SolutionSegmentConstPtr> segments_;
+
+	ros::Subscriber follow_up_sub_;
+	std::mutex follow_ups_mutex_;
+	std::deque<moveit_task_constructor_msgs::SolutionConstPtr> follow_ups_;
+	bool accept_follow_ups_ = false;  // only while a goal is running
+
+	double segment_timeout_;
+	double state_tolerance_;
+	int num_threads_;
+
+	/// recently converted solutions, most recent first
+	std::mutex cache_mutex_;
+	std::list<CachedSolution> solution_cache_;
 };
 
 }  // namespace move_group
@@ -0,0 +1,181 @@
+/* Micro-benchmarks of the core data structures used during planning:
+ * - ordered<> (cost queue): insert, update, and pop
+ * - Interface: storms of priority updates, with and without BatchUpdate
+ * - SerialContainer: solution propagation and path enumeration (onNewSolution) for varying widths and depths
+ *
+ * Run with: rosrun moveit_task_constructor_core moveit_task_constructor_core-core_benchmarks
+ */
+
+#include <moveit/task_constructor/cost_queue.h>
+#include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/container.h>
+#include <moveit/task_constructor/task.h>
+
+#include "../test/models.h"
+#include "../test/stage_mockups.h"
+
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <benchmark/benchmark.h>
+
+#include <deque>
+#include <random>
+#include <vector>
+
+using namespace moveit::task_constructor;
+
+namespace {
+
+constexpr unsigned int SEED = 42;
+
+std::vector<int> randomValues(size_t count) {
+	std::mt19937 rng(SEED);
+	std::uniform_int_distribution<int> dist(0, 1000);
+	std::vector<int> values(count);
+	for (int& v : values)
+		v = dist(rng);
+	return values;
+}
+
+void orderedInsert(benchmark::State& state) {
+	const auto values = randomValues(state.range(0));
+	for (auto _ : state) {
+		ordered<int> queue;
+		for (int v : values)
+			queue.insert(v);
+		benchmark::DoNotOptimize(queue.top());
+	}
+	state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(orderedInsert)->RangeMultiplier(8)->Range(8, 8 << 9);
+
+void orderedUpdate(benchmark::State& state) {
+	const auto values = randomValues(state.range(0));
+	std::vector<int> storage(values);
+	ordered<int*> queue;
+	std::vector<ordered<int*>::iterator> items;
+	for (int& v : storage)
+		items.push_back(queue.insert(&v));
+
+	std::mt19937 rng(SEED);
+	std::uniform_int_distribution<size_t> pick(0, items.size() - 1);
+	std::uniform_int_distribution<int> dist(0, 1000);
+	for (auto _ : state) {
+		auto& it = items[pick(rng)];
+		**it = dist(rng);
+		queue.update(it);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(orderedUpdate)->RangeMultiplier(8)->Range(8, 8 << 9);
+
+void orderedPop(benchmark::State& state) {
+	const auto values = randomValues(state.range(0));
+	ordered<int> filled;
+	for (int v : values)
+		filled.insert(v);
+	for (auto _ : state) {
+		state.PauseTiming();
+		ordered<int> queue(filled);
+		state.ResumeTiming();
+		while (!queue.empty())
+			benchmark::DoNotOptimize(queue.pop());
+	}
+	state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(orderedPop)->RangeMultiplier(8)->Range(8, 8 << 9);
+
+// random priority updates of all states of an Interface, optionally deferred by a BatchUpdate
+void interfaceUpdateStorm(benchmark::State& state, bool batched) {
+	const size_t num_states = state.range(0);
+	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	Interface interface([](Interface::iterator /*it*/, Interface::UpdateFlags /*updated*/) {});
+	std::deque<InterfaceState> states;
+	for (size_t i = 0; i < num_states; ++i) {
+		states.emplace_back(ps, InterfaceState::Priority(0, 0.0));
+		interface.add(states.back());
+	}
+
+	std::mt19937 rng(SEED);
+	std::uniform_int_distribution<unsigned int> depth(1, 10);
+	std::uniform_real_distribution<double> cost(0.0, 100.0);
+	auto storm = [&]() {
+		for (InterfaceState& s : states)
+			interface.updatePriority(&s, InterfaceState::Priority(depth(rng), cost(rng)));
+	};
+	for (auto _ : state) {
+		if (batched) {
+			Interface::BatchUpdate batch;
+			storm();
+		} else
+			storm();
+	}
+	state.SetItemsProcessed(state.iterations() * num_states);
+}
+BENCHMARK_CAPTURE(interfaceUpdateStorm, immediate, false)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK_CAPTURE(interfaceUpdateStorm, batched, true)->RangeMultiplier(4)->Range(16, 4096);
+
+/* Plan a serial chain of a generator, emitting `width` solutions, followed by `depth` propagators,
+ * each of them creating `width` solutions per input state. Thus, width^(depth+1) solution paths are enumerated.
+ * Use max_solution_paths to limit the number of enumerated paths per new child solution (0: all). */
+void serialPlan(benchmark::State& state, size_t max_paths) {
+	const size_t width = state.range(0);
+	const size_t depth = state.range(1);
+	size_t solutions = 0;
+	for (auto _ : state) {
+		state.PauseTiming();
+		resetMockupIds();
+		Task t("", false);
+		t.setRobotModel(getModel());
+		auto serial = std::make_unique<SerialContainer>();
+		serial->setMaxSolutionPaths(max_paths);
+		serial->add(std::make_unique<GeneratorMockup>(PredefinedCosts(std::list<double>(width, 1.0)), 1));
+		for (size_t i = 0; i < depth; ++i)
+			serial->add(std::make_unique<ForwardMockup>(PredefinedCosts::constant(1.0), width));
+		t.add(std::move(serial));
+		t.init();
+		state.ResumeTiming();
+
+		t.plan();
+
+		state.PauseTiming();
+		solutions = t.solutions().size();
+		state.ResumeTiming();
+	}
+	state.counters["solutions"] = solutions;
+}
+BENCHMARK_CAPTURE(serialPlan, all_paths, 0)->ArgsProduct({ { 1, 2, 3 }, { 1, 2, 4, 6 } });
+BENCHMARK_CAPTURE(serialPlan, cheapest_path, 1)->ArgsProduct({ { 1, 2, 3 }, { 1, 2, 4, 6 } });
+
+/* Nest `depth` serial containers, each providing `width` generator solutions at its end.
+ * This measures lifting of solutions through the container hierarchy. */
+void nestedSerialPlan(benchmark::State& state) {
+	const size_t width = state.range(0);
+	const size_t depth = state.range(1);
+	for (auto _ : state) {
+		state.PauseTiming();
+		resetMockupIds();
+		Task t("", false);
+		t.setRobotModel(getModel());
+		auto root = std::make_unique<SerialContainer>("serial 0");
+		ContainerBase* parent = root.get();
+		for (size_t i = 1; i < depth; ++i) {
+			auto serial = std::make_unique<SerialContainer>("serial " + std::to_string(i));
+			ContainerBase* child = serial.get();
+			parent->add(std::move(serial));
+			parent = child;
+		}
+		parent->add(std::make_unique<GeneratorMockup>(PredefinedCosts(std::list<double>(width, 1.0)), 1));
+		parent->add(std::make_unique<ForwardMockup>(PredefinedCosts::constant(1.0), width));
+		t.add(std::move(root));
+		t.init();
+		state.ResumeTiming();
+
+		t.plan();
+	}
+}
+BENCHMARK(nestedSerialPlan)->ArgsProduct({ { 1, 4, 16 }, { 1, 4, 16 } });
+
+}  // namespace
+
+BENCHMARK_MAIN();
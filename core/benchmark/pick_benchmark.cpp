@@ -0,0 +1,54 @@
+/* Planning benchmark of the pick_* integration tasks
+ *
+ * Plans the pick task of the robot given by ~robot (pa10, pr2, ur5) for ~repetitions runs with seeds
+ * ~seed, ~seed + 1, ... and writes the results as JSON to ~output (default: stdout).
+ * Needs the same environment as the corresponding pick_<robot>.test, e.g.:
+ *   rosrun moveit_task_constructor_core pick_benchmark _robot:=ur5 _repetitions:=20 _output:=ur5.json
+ */
+
+#include "../test/pick_tasks.h"
+
+#include <moveit/task_constructor/task_benchmark.h>
+#include <ros/ros.h>
+
+#include <iostream>
+#include <map>
+
+using namespace moveit::task_constructor;
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "pick_benchmark");
+	ros::NodeHandle pnh("~");
+	ros::AsyncSpinner spinner(1);
+	spinner.start();
+
+	const std::map<std::string, TaskPtr (*)()> tasks = {
+		{ "pa10", &createPickPA10Task }, { "pr2", &createPickPR2Task }, { "ur5", &createPickUR5Task }
+	};
+	const std::string robot = pnh.param<std::string>("robot", "ur5");
+	auto create = tasks.find(robot);
+	if (create == tasks.end()) {
+		ROS_ERROR_STREAM("unknown robot '" << robot << "', expected one of: pa10, pr2, ur5");
+		return 1;
+	}
+
+	TaskBenchmark benchmark("pick_" + robot, [&create](unsigned int /*seed*/) {
+		TaskPtr task = create->second();
+		task->enableIntrospection(false);
+		return task;
+	});
+	benchmark.setRepetitions(pnh.param("repetitions", 10));
+	benchmark.setSeed(pnh.param("seed", 0));
+	benchmark.setMaxSolutions(pnh.param("max_solutions", 0));
+
+	// wait some time for move_group to come up
+	ros::WallDuration(pnh.param("startup_delay", 5.0)).sleep();
+	benchmark.run();
+
+	const std::string output = pnh.param<std::string>("output", "");
+	if (output.empty())
+		benchmark.writeJson(std::cout);
+	else if (!benchmark.writeJson(output))
+		return 1;
+	return 0;
+}
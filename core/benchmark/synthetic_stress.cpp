@@ -0,0 +1,157 @@
+/* Stress test of the scheduler, pruning, and introspection with synthetic tasks
+ *
+ * Plans a synthetic task (see synthetic_task.h) for a number of repetitions and writes TaskBenchmark's JSON results.
+ * Run with --help to list all options, e.g.:
+ *   synthetic_stress --depth 3 --branching 4 --containers serial,alternatives --failure 0.2 --output stress.json
+ */
+
+#include "synthetic_task.h"
+
+#include <moveit/task_constructor/task_benchmark.h>
+#include <ros/ros.h>
+
+#include <iostream>
+#include <sstream>
+
+using namespace moveit::task_constructor;
+
+namespace {
+void usage(const char* program) {
+	std::cout << "usage: " << program << " [options]\n"
+	          << "task structure:\n"
+	          << "  --depth N                   nesting levels of containers (default: 2)\n"
+	          << "  --branching N               children per container (default: 2)\n"
+	          << "  --containers T1,T2,...      container type per level: serial, alternatives, fallbacks\n"
+	          << "  --generator-solutions N     states created by the initial generator (default: 10)\n"
+	          << "  --solutions-per-compute N   solutions of each propagator per input state (default: 2)\n"
+	          << "  --failure P                 failure probability of stage solutions (default: 0)\n"
+	          << "  --costs D                   cost distribution: constant, uniform, exponential\n"
+	          << "  --cost-mean C               mean cost of stage solutions (default: 1)\n"
+	          << "  --latency S                 simulated latency of each compute() call [s] (default: 0)\n"
+	          << "planning:\n"
+	          << "  --threads N                 number of planning threads (default: 1)\n"
+	          << "  --best-first                use BEST_FIRST scheduling policy\n"
+	          << "  --pipelined                 use PIPELINED scheduling policy (one thread per stage)\n"
+	          << "  --cost-pruning              enable branch-and-bound cost pruning\n"
+	          << "  --introspection             publish introspection (requires a ROS master)\n"
+	          << "  --memory-accounting         record memory usage per stage\n"
+	          << "benchmark:\n"
+	          << "  --repetitions N             number of runs (default: 1)\n"
+	          << "  --seed N                    seed of first run (default: 0)\n"
+	          << "  --max-solutions N           solutions to plan per run (default: 0 = all)\n"
+	          << "  --output FILE               write JSON results to FILE instead of stdout\n"
+	          << "  --print-state               print the task's state after each run to stderr\n";
+}
+
+template <typename T>
+T parse(const std::string& option, const char* value) {
+	std::istringstream is(value ? value : "");
+	T result;
+	if (!(is >> result) || !is.eof())
+		throw std::invalid_argument("invalid value for " + option);
+	return result;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "synthetic_stress", ros::init_options::AnonymousName);
+
+	synthetic::TaskConfig config;
+	size_t threads = 1, repetitions = 1, max_solutions = 0;
+	unsigned int seed = 0;
+	bool best_first = false, pipelined = false, cost_pruning = false, introspection = false, print_state = false;
+	std::string output;
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const std::string option = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+			auto next = [&]() {
+				++i;
+				return value;
+			};
+			if (option == "--help" || option == "-h") {
+				usage(argv[0]);
+				return 0;
+			} else if (option == "--depth")
+				config.depth = parse<unsigned int>(option, next());
+			else if (option == "--branching")
+				config.branching = parse<unsigned int>(option, next());
+			else if (option == "--containers") {
+				config.containers.clear();
+				std::istringstream types(parse<std::string>(option, next()));
+				for (std::string type; std::getline(types, type, ',');)
+					config.containers.push_back(synthetic::parseContainerType(type));
+			} else if (option == "--generator-solutions")
+				config.generator_solutions = parse<unsigned int>(option, next());
+			else if (option == "--solutions-per-compute")
+				config.solutions_per_compute = parse<unsigned int>(option, next());
+			else if (option == "--failure")
+				config.failure_probability = parse<double>(option, next());
+			else if (option == "--costs")
+				config.cost_distribution = synthetic::parseCostDistribution(parse<std::string>(option, next()));
+			else if (option == "--cost-mean")
+				config.cost_mean = parse<double>(option, next());
+			else if (option == "--latency")
+				config.compute_latency = parse<double>(option, next());
+			else if (option == "--threads")
+				threads = parse<size_t>(option, next());
+			else if (option == "--best-first")
+				best_first = true;
+			else if (option == "--pipelined")
+				pipelined = true;
+			else if (option == "--cost-pruning")
+				cost_pruning = true;
+			else if (option == "--introspection")
+				introspection = true;
+			else if (option == "--memory-accounting")
+				Stage::setMemoryAccounting(true);
+			else if (option == "--repetitions")
+				repetitions = parse<size_t>(option, next());
+			else if (option == "--seed")
+				seed = parse<unsigned int>(option, next());
+			else if (option == "--max-solutions")
+				max_solutions = parse<size_t>(option, next());
+			else if (option == "--output")
+				output = parse<std::string>(option, next());
+			else if (option == "--print-state")
+				print_state = true;
+			else
+				throw std::invalid_argument("unknown option " + option);
+		}
+	} catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		usage(argv[0]);
+		return 1;
+	}
+
+	TaskPtr previous;  // keep previous task to print its state (only with --print-state)
+	auto print_previous = [&previous]() {
+		if (previous)
+			previous->printState(std::cerr);
+		previous.reset();
+	};
+	TaskBenchmark benchmark("synthetic", [&](unsigned int run_seed) {
+		print_previous();
+		config.seed = run_seed;
+		TaskPtr task = synthetic::createTask(config);
+		task->setNumThreads(threads);
+		task->setSchedulingPolicy(pipelined ? Task::PIPELINED : best_first ? Task::BEST_FIRST : Task::RECURSIVE);
+		task->enableCostPruning(cost_pruning);
+		task->enableIntrospection(introspection);
+		if (print_state)
+			previous = task;
+		return task;
+	});
+	benchmark.setRepetitions(repetitions);
+	benchmark.setSeed(seed);
+	benchmark.setMaxSolutions(max_solutions);
+	benchmark.run();
+	print_previous();
+
+	if (output.empty())
+		benchmark.writeJson(std::cout);
+	else if (!benchmark.writeJson(output))
+		return 1;
+	return 0;
+}
@@ -0,0 +1,172 @@
+#include "synthetic_task.h"
+#include "../test/models.h"
+
+#include <moveit/task_constructor/container.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <chrono>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace moveit {
+namespace task_constructor {
+namespace synthetic {
+
+namespace {
+
+// random costs and failures of a single stage
+class CostSampler
+{
+public:
+	CostSampler(const TaskConfig& config, unsigned int index)
+	  : config_(config), rng_(config.seed + index), uniform_(0.0, 1.0) {}
+
+	double sample() {
+		if (config_.failure_probability > 0.0 && uniform_(rng_) < config_.failure_probability)
+			return std::numeric_limits<double>::infinity();
+		switch (config_.cost_distribution) {
+			case CostDistribution::UNIFORM:
+				return 2.0 * config_.cost_mean * uniform_(rng_);
+			case CostDistribution::EXPONENTIAL:
+				return config_.cost_mean > 0.0 ? std::exponential_distribution<double>(1.0 / config_.cost_mean)(rng_) : 0.0;
+			case CostDistribution::CONSTANT:
+				break;
+		}
+		return config_.cost_mean;
+	}
+
+	void simulateLatency() const {
+		if (config_.compute_latency > 0.0)
+			std::this_thread::sleep_for(std::chrono::duration<double>(config_.compute_latency));
+	}
+
+private:
+	const TaskConfig config_;
+	std::mt19937 rng_;
+	std::uniform_real_distribution<double> uniform_;
+};
+
+class SyntheticGenerator : public Generator
+{
+public:
+	SyntheticGenerator(const std::string& name, const TaskConfig& config, unsigned int index)
+	  : Generator(name), sampler_(config, index), config_(config), remaining_(config.generator_solutions) {}
+
+	void reset() override {
+		Generator::reset();
+		remaining_ = config_.generator_solutions;
+	}
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override {
+		scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model);
+		Generator::init(robot_model);
+	}
+	bool canCompute() const override { return remaining_ > 0; }
+	void compute() override {
+		sampler_.simulateLatency();
+		for (unsigned int i = 0; remaining_ > 0 && i < config_.solutions_per_compute; ++i, --remaining_)
+			spawn(InterfaceState(scene_), sampler_.sample());
+	}
+
+private:
+	CostSampler sampler_;
+	const TaskConfig config_;
+	unsigned int remaining_;
+	planning_scene::PlanningScenePtr scene_;
+};
+
+class SyntheticPropagator : public PropagatingEitherWay
+{
+public:
+	SyntheticPropagator(const std::string& name, const TaskConfig& config, unsigned int index)
+	  : PropagatingEitherWay(name), sampler_(config, index), solutions_per_compute_(config.solutions_per_compute) {
+		restrictDirection(FORWARD);
+	}
+
+	void computeForward(const InterfaceState& from) override {
+		sampler_.simulateLatency();
+		for (unsigned int i = 0; i < solutions_per_compute_; ++i) {
+			SubTrajectory solution(robot_trajectory::RobotTrajectoryConstPtr(), sampler_.sample());
+			sendForward(from, InterfaceState(from.scene()->diff()), std::move(solution));
+		}
+	}
+	void computeBackward(const InterfaceState& /*to*/) override {}
+
+private:
+	CostSampler sampler_;
+	unsigned int solutions_per_compute_;
+};
+
+class TreeBuilder
+{
+public:
+	TreeBuilder(const TaskConfig& config) : config_(config) {}
+
+	Stage::pointer generator() { return std::make_unique<SyntheticGenerator>(name("GEN"), config_, index_++); }
+
+	// create the subtree of given level, leafs are propagators
+	Stage::pointer subtree(unsigned int level) {
+		if (level >= config_.depth || config_.containers.empty())
+			return std::make_unique<SyntheticPropagator>(name("PRO"), config_, index_++);
+
+		auto container = createContainer(config_.containers[level % config_.containers.size()]);
+		for (unsigned int i = 0; i < config_.branching; ++i)
+			container->add(subtree(level + 1));
+		return container;
+	}
+
+private:
+	std::string name(const char* prefix) { return prefix + std::to_string(index_); }
+
+	std::unique_ptr<ContainerBase> createContainer(ContainerType type) {
+		switch (type) {
+			case ContainerType::ALTERNATIVES:
+				return std::make_unique<Alternatives>(name("ALT"));
+			case ContainerType::FALLBACKS:
+				return std::make_unique<Fallbacks>(name("FB"));
+			case ContainerType::SERIAL:
+				break;
+		}
+		return std::make_unique<SerialContainer>(name("SER"));
+	}
+
+	const TaskConfig& config_;
+	unsigned int index_ = 0;
+};
+}  // namespace
+
+TaskPtr createTask(const TaskConfig& config) {
+	auto task = std::make_shared<Task>("", false);
+	task->stages()->setName("synthetic");
+	task->setRobotModel(getModel());
+
+	TreeBuilder builder(config);
+	task->add(builder.generator());
+	task->add(builder.subtree(0));
+	return task;
+}
+
+ContainerType parseContainerType(const std::string& name) {
+	if (name == "serial")
+		return ContainerType::SERIAL;
+	if (name == "alternatives")
+		return ContainerType::ALTERNATIVES;
+	if (name == "fallbacks")
+		return ContainerType::FALLBACKS;
+	throw std::invalid_argument("unknown container type: " + name);
+}
+
+CostDistribution parseCostDistribution(const std::string& name) {
+	if (name == "constant")
+		return CostDistribution::CONSTANT;
+	if (name == "uniform")
+		return CostDistribution::UNIFORM;
+	if (name == "exponential")
+		return CostDistribution::EXPONENTIAL;
+	throw std::invalid_argument("unknown cost distribution: " + name);
+}
+
+}  // namespace synthetic
+}  // namespace task_constructor
+}  // namespace moveit
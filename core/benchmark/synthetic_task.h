@@ -0,0 +1,70 @@
+/* Synthetic tasks for stress testing the scheduler, pruning, and introspection
+ *
+ * Tasks are built from synthetic generator and propagator stages, which need no robot model
+ * beyond the dummy model of test/models.h, and don't plan any trajectories.
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/task.h>
+
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace synthetic {
+
+enum class ContainerType
+{
+	SERIAL,
+	ALTERNATIVES,
+	FALLBACKS,
+};
+
+enum class CostDistribution
+{
+	CONSTANT,  ///< always cost_mean
+	UNIFORM,  ///< uniform in [0, 2 * cost_mean]
+	EXPONENTIAL,  ///< exponential with mean cost_mean
+};
+
+struct TaskConfig
+{
+	/// nesting levels of containers below the task's root
+	unsigned int depth = 2;
+	/// number of children of each container
+	unsigned int branching = 2;
+	/// container type of each level, cycling through this list with increasing depth
+	std::vector<ContainerType> containers = { ContainerType::SERIAL };
+
+	/// total number of states created by the initial generator
+	unsigned int generator_solutions = 10;
+	/// number of solutions created by each propagator for each input state
+	unsigned int solutions_per_compute = 2;
+
+	/// probability of a stage solution to fail
+	double failure_probability = 0.0;
+	CostDistribution cost_distribution = CostDistribution::UNIFORM;
+	double cost_mean = 1.0;
+
+	/// simulated latency of each compute() call [s]
+	double compute_latency = 0.0;
+	/// random seed, each stage uses its own generator seeded with seed + stage index
+	unsigned int seed = 0;
+};
+
+/** Create a synthetic task
+ *
+ * The task's root is a serial container holding the initial generator, followed by a tree of containers
+ * of given depth and branching factor. Its leaves are forward propagators.
+ */
+TaskPtr createTask(const TaskConfig& config);
+
+/// parse ContainerType / CostDistribution from their lower-case names, throws std::invalid_argument
+ContainerType parseContainerType(const std::string& name);
+CostDistribution parseCostDistribution(const std::string& name);
+
+}  // namespace synthetic
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,115 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    backend for batched collision and distance queries
+*/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/collision_detection/collision_common.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace planning_scene {
+MOVEIT_CLASS_FORWARD(PlanningScene);
+}
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(RobotState);
+}
+}  // namespace moveit
+
+namespace moveit {
+namespace task_constructor {
+
+class PreemptionToken;
+MOVEIT_CLASS_FORWARD(CollisionBackend);
+
+/** Backend for collision and distance queries of many robot states against a single scene
+ *
+ * Stages, solvers, and cost terms hand over all states they need to check at once,
+ * such that a backend can evaluate them in bulk, e.g. on a GPU using a sphere model of the robot.
+ * The process-wide backend is accessed via instance() and can be replaced via setInstance().
+ * The default, ThreadedCollisionBackend, uses the scene's collision environment on multiple CPU threads.
+ */
+class CollisionBackend
+{
+public:
+	using States = std::vector<const moveit::core::RobotState*>;
+	using Distances = std::vector<collision_detection::DistanceResult>;
+	/// predicate terminating a distance batch early
+	using DistanceStop = std::function<bool(const collision_detection::DistanceResult&)>;
+
+	virtual ~CollisionBackend() = default;
+
+	/** index of the first state colliding in scene, or states.size() if all are collision-free
+	 *
+	 * Only links of group are considered (all links if empty).
+	 * num_threads is a hint for CPU backends. If preemption is requested, states.size() is returned.
+	 */
+	virtual size_t firstColliding(const planning_scene::PlanningScene& scene, const std::string& group,
+	                              const States& states, unsigned int num_threads = 1,
+	                              const PreemptionToken* preempt = nullptr) const = 0;
+
+	/** distances of all states, to the world (with_world) or to the robot itself
+	 *
+	 * If stop is given, evaluation terminates at the first state fulfilling it, whose index is returned
+	 * (states.size() otherwise). All results before and at that index are valid, later ones are unspecified.
+	 */
+	virtual size_t distances(const planning_scene::PlanningScene& scene,
+	                         const collision_detection::DistanceRequest& request, bool with_world,
+	                         const States& states, Distances& results, unsigned int num_threads = 1,
+	                         const DistanceStop& stop = DistanceStop()) const = 0;
+
+	/// process-wide backend, a ThreadedCollisionBackend unless replaced
+	static CollisionBackendPtr instance();
+	/// replace process-wide backend, nullptr restores the default
+	static void setInstance(const CollisionBackendPtr& backend);
+};
+
+/// default backend, distributing the states over (up to) num_threads threads
+class ThreadedCollisionBackend : public CollisionBackend
+{
+public:
+	size_t firstColliding(const planning_scene::PlanningScene& scene, const std::string& group, const States& states,
+	                      unsigned int num_threads = 1, const PreemptionToken* preempt = nullptr) const override;
+	size_t distances(const planning_scene::PlanningScene& scene, const collision_detection::DistanceRequest& request,
+	                 bool with_world, const States& states, Distances& results, unsigned int num_threads = 1,
+	                 const DistanceStop& stop = DistanceStop()) const override;
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,129 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    cache of collision and distance results shared by stages, solvers, and cost terms
+*/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/collision_detection/collision_common.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace planning_scene {
+MOVEIT_CLASS_FORWARD(PlanningScene);
+}
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(RobotState);
+}
+}  // namespace moveit
+
+namespace moveit {
+namespace task_constructor {
+
+MOVEIT_CLASS_FORWARD(CollisionCache);
+
+/** Cache of collision and distance results of robot states per planning scene
+ *
+ * The same state is often checked several times in the same scene: by the stage generating it (ComputeIK),
+ * as start state of the next motion (JointInterpolationPlanner), and by cost terms (Clearance).
+ * Results are keyed by the state's joint positions, quantized to resolution, and its attached bodies.
+ * As results are stored per scene object, they are only valid for scenes that don't change anymore,
+ * like the scenes of InterfaceStates. Only weak references to scenes are kept: results of a scene are
+ * dropped once the scene is destroyed (and the cache notices by next accessing the scene's address).
+ * Caching is disabled by default: enable the process-wide cache, accessed via instance(), with
+ * setInstance(std::make_shared<CollisionCache>()). Task::reset() clears its results.
+ */
+class CollisionCache
+{
+public:
+	/// results of at most max_scenes scenes are kept, dropping those of destroyed scenes first
+	CollisionCache(double resolution = 1e-5, size_t max_scenes = 1000);
+
+	/// whether state collides in scene (considering links of group only, all if empty), evaluating check on a miss
+	bool isColliding(const planning_scene::PlanningSceneConstPtr& scene, const moveit::core::RobotState& state,
+	                 const std::string& group, const std::function<bool()>& check);
+	/// record a collision result known otherwise, e.g. from checking state in a parent scene
+	void storeColliding(const planning_scene::PlanningSceneConstPtr& scene, const moveit::core::RobotState& state,
+	                    const std::string& group, bool colliding);
+
+	/** distance result of state in scene, evaluating compute on a miss
+	 *
+	 * request identifies the distance query, i.e. all request parameters affecting the result.
+	 */
+	collision_detection::DistanceResult
+	distance(const planning_scene::PlanningSceneConstPtr& scene, const moveit::core::RobotState& state,
+	         const std::string& request, const std::function<collision_detection::DistanceResult()>& compute);
+
+	double resolution() const { return resolution_; }
+	size_t hits() const { return hits_; }
+	size_t misses() const { return misses_; }
+	/// number of scenes with cached results
+	size_t size() const;
+	void clear();
+
+	/// process-wide cache (nullptr if disabled, the default)
+	static CollisionCachePtr instance();
+	/// replace process-wide cache, nullptr disables caching
+	static void setInstance(const CollisionCachePtr& cache);
+
+private:
+	struct SceneResults
+	{
+		std::weak_ptr<const planning_scene::PlanningScene> scene;
+		std::unordered_map<std::string, bool> colliding;
+		std::unordered_map<std::string, collision_detection::DistanceResult> distances;
+	};
+
+	/// query, quantized joint positions, and attached bodies of state, compared in full (not only by hash)
+	std::string key(const moveit::core::RobotState& state, const std::string& query) const;
+	// results of scene (reset if a destroyed scene used the same address), requires mutex_ being locked
+	SceneResults& results(const planning_scene::PlanningSceneConstPtr& scene);
+
+	const double resolution_;
+	const size_t max_scenes_;
+	mutable std::mutex mutex_;
+	std::unordered_map<const planning_scene::PlanningScene*, SceneResults> scenes_;
+	std::atomic<size_t> hits_{ 0 };
+	std::atomic<size_t> misses_{ 0 };
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -39,6 +39,7 @@
 #pragma once
 
 #include "stage.h"
+#include <map>
 
 namespace moveit {
 namespace task_constructor {
@@ -51,6 +52,8 @@ public:
 	PRIVATE_CLASS(ContainerBase)
 	using pointer = std::unique_ptr<ContainerBase>;
 
+	~ContainerBase() override;
+
 	size_t numChildren() const;
 	Stage* findChild(const std::string& name) const;
 
@@ -73,11 +76,26 @@ public:
 	void reset() override;
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
 
+	/** limit the compute time [s] spent in this container, including all its children (0: unlimited)
+	 *
+	 * Once the deadline is exceeded, neither the container nor any of its children are computed anymore,
+	 * until the deadline is refilled via refillDeadline() or reset().
+	 */
+	void setDeadline(double seconds) { setProperty("deadline", seconds); }
+	/// restart accounting of the deadline, e.g. on events granting a new time budget to this container
+	void refillDeadline();
+	/// compute time [s] accounted for the deadline so far
+	double deadlineUsed() const;
+	/// was this container's or any ancestor's deadline exceeded?
+	bool deadlineExceeded() const;
+
 	virtual bool canCompute() const = 0;
 	virtual void compute() = 0;
 
 	/// called by a (direct) child when a new solution becomes available
 	virtual void onNewSolution(const SolutionBase& s) = 0;
+	/// called by a (direct) child for a batch of new solutions, by default calls onNewSolution() for each
+	virtual void onNewSolutions(const std::vector<const SolutionBase*>& solutions);
 
 protected:
 	ContainerBase(ContainerBasePrivate* impl);
@@ -92,11 +110,15 @@ public:
 	PRIVATE_CLASS(SerialContainer)
 	SerialContainer(const std::string& name = "serial container");
 
+	/// limit number of full solutions (in order of increasing cost) assembled for every new child solution
+	void setMaxSolutionPaths(size_t max_paths) { setProperty("max_solution_paths", max_paths); }
+
 	bool canCompute() const override;
 	void compute() override;
 
 protected:
 	void onNewSolution(const SolutionBase& s) override;
+	void onNewSolutions(const std::vector<const SolutionBase*>& solutions) override;
 
 	SerialContainer(SerialContainerPrivate* impl);
 };
@@ -135,19 +157,37 @@ protected:
 	void sendBackward(InterfaceState&& from, const InterfaceState& to, SubTrajectory&& trajectory);
 };
 
+class AlternativesPrivate;
 /** Plan for different alternatives in parallel.
  *
  * Solution of all children are reported - sorted by cost.
+ *
+ * In racing mode, the first child solution not exceeding the cost threshold decides the race:
+ * all other children are preempted, i.e. their running computations abort and they are not scheduled anymore.
+ * Together with concurrent planning, this minimizes the time to the first solution across all children.
  */
 class Alternatives : public ParallelContainerBase
 {
 public:
-	Alternatives(const std::string& name = "alternatives") : ParallelContainerBase(name) {}
+	PRIVATE_CLASS(Alternatives)
+	Alternatives(const std::string& name = "alternatives");
 
+	/// race children for the first solution with a cost not exceeding cost_threshold
+	void setRacing(bool racing, double cost_threshold = std::numeric_limits<double>::infinity()) {
+		setProperty("racing", racing);
+		setProperty("race_cost_threshold", cost_threshold);
+	}
+	/// child that won the race (nullptr if not decided yet)
+	const Stage* raceWinner() const;
+
+	void reset() override;
 	bool canCompute() const override;
 	void compute() override;
 
 	void onNewSolution(const SolutionBase& s) override;
+
+protected:
+	Alternatives(AlternativesPrivate* impl);
 };
 
 class FallbacksPrivate;
@@ -156,6 +196,9 @@ class FallbacksPrivate;
  * Try to find feasible solutions using first child. Only if this fails,
  * proceed to the next child trying an alternative planning strategy.
  * All solutions of the last active child are reported.
+ *
+ * With adaptive ordering, the children are tried in order of their observed success rate per compute time,
+ * learned separately for each class of input states.
  */
 class Fallbacks : public ParallelContainerBase
 {
@@ -168,6 +211,39 @@ public:
 	void reset() override;
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
 
+	/** In concurrent planning mode, compute the next child on the current job in parallel.
+	 *
+	 * Its solutions are only used if all previous children fail. Only supported for propagating children.
+	 */
+	void setSpeculative(bool speculative) { setProperty("speculative", speculative); }
+
+	/// outcome of the jobs a child processed for a class of input states
+	struct ChildStatistics
+	{
+		size_t attempts = 0;
+		size_t successes = 0;  ///< attempts yielding at least one solution
+		double compute_time = 0.0;  ///< total compute time spent on attempts [s]
+	};
+	/// statistics per state class and child name
+	using OrderStatistics = std::map<std::string, std::map<std::string, ChildStatistics>>;
+	/// assign a class to an input state, e.g. based on its properties (nullptr for generator-like Fallbacks)
+	using StateClassifier = std::function<std::string(const InterfaceState*)>;
+
+	/** Try children in order of their (smoothed) success rate per mean compute time.
+	 *
+	 * Statistics are always collected and persist across reset(). Without statistics for a state class,
+	 * children are tried in their configured order. Not supported for CONNECT-like Fallbacks.
+	 */
+	void setAdaptiveOrder(bool adaptive) { setProperty("adaptive_order", adaptive); }
+	/// classify input states to learn separate orders (default: a single class "")
+	void setStateClassifier(const StateClassifier& classifier);
+
+	const OrderStatistics& orderStatistics() const;
+	/// warm start adaptive ordering with previously exported statistics
+	void setOrderStatistics(const OrderStatistics& statistics);
+	/// names of children in the order they are tried for states of the given class
+	std::vector<std::string> childOrder(const std::string& state_class = std::string()) const;
+
 protected:
 	Fallbacks(FallbacksPrivate* impl);
 	void onNewSolution(const SolutionBase& s) override;
@@ -186,6 +262,17 @@ public:
 	PRIVATE_CLASS(Merger)
 	Merger(const std::string& name = "merger");
 
+	/// limit the number of merge attempts per new child solution (0 = unlimited), trying cheapest combinations first
+	void setMaxCombinations(uint32_t max) { setProperty("max_combinations", max); }
+	/// merge and validate this many combinations in parallel
+	void setNumThreads(uint32_t num) { setProperty("num_threads", num); }
+	/** compute children concurrently, interleaving their planner calls (default: false)
+	 *
+	 * Only enable this if the children's solvers and kinematics plugins are thread-safe,
+	 * i.e. they don't share a single PlanningPipeline instance (see PipelinePlanner::setNumInstances).
+	 */
+	void setConcurrent(bool concurrent) { setProperty("concurrent", concurrent); }
+
 	void reset() override;
 	void init(const core::RobotModelConstPtr& robot_model) override;
 	bool canCompute() const override;
@@ -196,6 +283,46 @@ protected:
 	void onNewSolution(const SolutionBase& s) override;
 };
 
+class ForEachPrivate;
+/** Apply a sub pipeline to each element of an input list, computing the elements in parallel
+ *
+ * The child of an element is created by the child factory only once a compute slot becomes available:
+ * up to max_concurrency children, which can compute, are computed in parallel. Children inherit the
+ * configuration of this container as their parent. reset() drops all children, init() creates the first wave again.
+ * Solutions of all children are reported - sorted by cost. After max_solutions solutions were found,
+ * neither further children are instantiated nor existing ones computed.
+ */
+class ForEach : public ParallelContainerBase
+{
+public:
+	PRIVATE_CLASS(ForEach)
+	using Elements = std::vector<boost::any>;
+	/// create the child processing the element with given index
+	using ChildFactory = std::function<Stage::pointer(const boost::any& element, size_t index)>;
+
+	ForEach(const std::string& name = "for each", const ChildFactory& factory = ChildFactory());
+
+	void setChildFactory(const ChildFactory& factory);
+	/// elements to process (needs to be set directly, as children are created before properties are inherited)
+	void setElements(const Elements& elements) { setProperty("elements", elements); }
+	/// max number of children computed in parallel (0 = one per core)
+	void setMaxConcurrency(uint32_t num) { setProperty("max_concurrency", num); }
+	/// stop once this many solutions were found (0 = unlimited)
+	void setMaxSolutions(size_t num) { setProperty("max_solutions", num); }
+
+	/// number of elements whose child was created so far
+	size_t numInstantiated() const;
+
+	void reset() override;
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	bool canCompute() const override;
+	void compute() override;
+
+protected:
+	ForEach(ForEachPrivate* impl);
+	void onNewSolution(const SolutionBase& s) override;
+};
+
 class WrapperBasePrivate;
 /** A wrapper wraps a single child stage, which can be accessed via wrapped().
  *
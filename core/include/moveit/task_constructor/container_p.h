@@ -95,6 +95,8 @@ public:
 	/// remove child at given iterator position, returns fals if pos is invalid
 	Stage::pointer remove(ContainerBasePrivate::const_iterator pos);
 
+	bool needsInit(const moveit::core::RobotModelConstPtr& robot_model) const override;
+
 	/// traversing all stages up to max_depth
 	bool traverseStages(const ContainerBase::StageCallback& processor, unsigned int cur_depth,
 	                    unsigned int max_depth) const;
@@ -109,6 +111,13 @@ public:
 
 	void validateConnectivity() const override;
 
+	/** wait for queued asynchronous solution callbacks of this container and all its descendants
+	 *
+	 * Queued solutions refer to states of sibling stages too. Hence, all of them need to be processed
+	 * before any child is reset or destroyed.
+	 */
+	void flushSolutionCallbacksRecursively() const;
+
 	// Containers derive their required interface from their children
 	// UNKNOWN until resolveInterface was called
 	InterfaceFlags requiredInterface() const override { return required_interface_; }
@@ -116,6 +125,10 @@ public:
 	// forward these methods to the public interface for containers
 	bool canCompute() const override;
 	void compute() override;
+	/// most promising job priority among all children that can compute
+	InterfaceState::Priority jobPriority() const override;
+	/// pending jobs of all children
+	size_t pendingJobs() const override;
 
 	// internal interface for first/last child to push to if required
 	InterfacePtr pendingBackward() const { return pending_backward_; }
@@ -132,6 +145,27 @@ public:
 
 	/// called by a (direct) child when a solution failed
 	virtual void onNewFailure(const Stage& child, const InterfaceState* from, const InterfaceState* to);
+	/// called by a (direct) child when one of its stored solutions became invalid
+	void pruneInvalidSolution(const Stage& child, const SolutionBase& solution);
+	/// called by a (direct) child before dropping a stored solution: prune the states created by it
+	void pruneEvictedSolution(const Stage& child, const SolutionBase& solution);
+	/// is the given child solution used by any of our own solutions (and thus cannot be dropped)?
+	virtual bool refersTo(const SolutionBase& child_solution) const;
+	/// preemption token handed down to the given child (default: our own one)
+	virtual const PreemptionToken* childPreemptionToken(const StagePrivate* /*child*/) { return preemptionToken(); }
+	/// called when children were added to this container or a descendant during planning (default: tell parent)
+	virtual void onStageTreeChanged();
+
+	/// revalidate children first, then invalidate own solutions composed of invalid child solutions
+	size_t revalidate(SceneUpdate& update) override;
+
+	// deadline accounting, see ContainerBase::setDeadline(), might be charged from concurrently computing children
+	inline bool ownDeadlineExceeded() const { return deadline_ > 0.0 && deadlineUsed() >= deadline_; }
+	inline double deadlineUsed() const {
+		return std::chrono::duration<double>(std::chrono::steady_clock::duration(deadline_used_.load())).count();
+	}
+	inline void chargeDeadline(std::chrono::steady_clock::duration elapsed) { deadline_used_ += elapsed.count(); }
+	inline void refillDeadline() { deadline_used_ = 0; }
 
 protected:
 	ContainerBasePrivate(ContainerBase* me, const std::string& name);
@@ -172,9 +206,27 @@ protected:
 	// set in resolveInterface()
 	InterfaceFlags required_interface_;
 
+	double deadline_ = 0.0;  // compute time limit [s] (0: unlimited), read in init()
+	std::atomic<int64_t> deadline_used_{ 0 };  // compute time [steady_clock ticks] accounted since the last refill
+
 private:
+	/// apply status to a single state of setStatus(), returns true if its successors need to be visited as well
+	template <Interface::Direction dir>
+	bool applyStatus(const Stage* creator, const InterfaceState* source, const InterfaceState* target,
+	                 InterfaceState::Status& status);
+
 	container_type children_;
 
+	struct StatusJob
+	{
+		const Stage* creator;
+		const InterfaceState* source;
+		const InterfaceState* target;
+		InterfaceState::Status status;
+	};
+	// reusable stack of setStatus(), shared by nested calls (e.g. from notify callbacks)
+	std::vector<StatusJob> status_jobs_;
+
 	// map start/end states of children (internal) to corresponding states in our external interfaces
 	boost::bimap<boost::bimaps::unordered_set_of<boost::bimaps::tagged<const InterfaceState*, INTERNAL>>,
 	             boost::bimaps::unordered_multiset_of<boost::bimaps::tagged<const InterfaceState*, EXTERNAL>>>
@@ -230,6 +282,12 @@ public:
 
 	void validateConnectivity() const override;
 
+	/** compute the given children in parallel threads, interleaving their ComputeUnlock scopes
+	 *
+	 * Outside of concurrent planning, a planning lock local to this call is provided to the whole subtree.
+	 */
+	void computeConcurrently(const std::vector<StagePrivate*>& computable);
+
 protected:
 	void validateInterfaces(const StagePrivate& child, InterfaceFlags& external, bool first = false) const;
 
@@ -250,6 +308,24 @@ PIMPL_FUNCTIONS(ParallelContainerBase)
  * The actual interface-specific class is instantiated in initializeExternalInterfaces()
  * resp. Fallbacks::replaceImpl() when the actual interface is known.
  * The key difference between the 3 variants is how they advance to the next job. */
+class AlternativesPrivate : public ParallelContainerBasePrivate
+{
+	friend class Alternatives;
+
+public:
+	AlternativesPrivate(Alternatives* me, const std::string& name);
+
+	/// each child gets an own token, chained to ours, to preempt the losers of a race
+	const PreemptionToken* childPreemptionToken(const StagePrivate* child) override;
+	/// preempt all other children, once winner found a good enough solution
+	void finishRace(const Stage* winner);
+
+private:
+	std::map<const StagePrivate*, std::unique_ptr<PreemptionToken>> child_tokens_;
+	const Stage* winner_ = nullptr;  // child that won the race (if racing)
+};
+PIMPL_FUNCTIONS(Alternatives)
+
 class FallbacksPrivate : public ParallelContainerBasePrivate
 {
 public:
@@ -262,6 +338,13 @@ public:
 	// virtual methods specific to each variant
 	virtual void onNewSolution(const SolutionBase& s);
 	virtual void reset() {}
+
+	std::string stateClass(const InterfaceState* state) const;
+	/// children in the order to try them for states of the given class
+	std::vector<container_type::const_iterator> childOrder(const std::string& state_class) const;
+
+	Fallbacks::StateClassifier classifier_;
+	Fallbacks::OrderStatistics order_stats_;  // outcome of children's attempts, used for adaptive ordering
 };
 PIMPL_FUNCTIONS(Fallbacks)
 
@@ -276,12 +359,20 @@ public:
 	inline void nextChild();
 	/// Advance to the next job, assuming that the current child is exhausted on the current job.
 	virtual bool nextJob() = 0;
+	/// Start processing a new job (nullptr for generators) with the first child of its order
+	void startOrder(const InterfaceState* state);
+	/// Record the outcome of the current child's attempt on the current job
+	void recordAttempt(bool success);
 
 	void reset() override;
 	bool canCompute() const override;
 	void compute() override;
 
 	container_type::const_iterator current_;  // currently active child
+	std::vector<container_type::const_iterator> order_;  // order of children for the current job
+	size_t rank_;  // index of current_ in order_
+	std::string job_class_;  // state class of the current job
+	double time_mark_;  // compute time of current_ when it started on the current job
 };
 
 /// Fallbacks implementation for GENERATOR interface
@@ -296,12 +387,18 @@ struct FallbacksPrivatePropagator : FallbacksPrivateCommon
 {
 	FallbacksPrivatePropagator(FallbacksPrivate&& old);
 	void reset() override;
+	void compute() override;
 	void onNewSolution(const SolutionBase& s) override;
 	bool nextJob() override;
+	bool refersTo(const SolutionBase& child_solution) const override;
 
 	Interface::Direction dir_;  // propagation direction
 	Interface::iterator job_;  // pointer to currently processed external state
 	bool job_has_solutions_;  // flag indicating whether the current job generated solutions
+
+	container_type::const_iterator speculated_;  // child that speculatively processed job_ already
+	double speculation_time_mark_;  // compute time of speculated_ when it started on job_
+	std::vector<const SolutionBase*> speculative_solutions_;  // solutions of speculated_, not yet lifted
 };
 
 /// Fallbacks implementation for CONNECT interface
@@ -337,10 +434,14 @@ class MergerPrivate : public ParallelContainerBasePrivate
 	using ChildSolutionMap = std::map<const Stage*, ChildSolutionList>;
 	// map from external source state (iterator) to all corresponding children's solutions
 	std::map<const InterfaceState*, ChildSolutionMap> source_state_to_solutions_;
+	// known merge results of solution pairs (true if conflicting), ordered by pointer
+	std::map<std::pair<const SubTrajectory*, const SubTrajectory*>, bool> pair_conflicts_;
 
 public:
 	using Spawner = std::function<void(SubTrajectory&&)>;
 	MergerPrivate(Merger* me, const std::string& name);
+	// children's solutions are kept for merging in source_state_to_solutions_
+	bool refersTo(const SolutionBase& /* child_solution */) const override { return true; }
 
 	void resolveInterface(InterfaceFlags expected) override;
 
@@ -348,12 +449,45 @@ public:
 	void onNewGeneratorSolution(const SolutionBase& s);
 	void mergeAnyCombination(const ChildSolutionMap& all_solutions, const SolutionBase& current,
 	                         const planning_scene::PlanningSceneConstPtr& start_scene, const Spawner& spawner);
-	void merge(const ChildSolutionList& sub_solutions, const planning_scene::PlanningSceneConstPtr& start_scene,
-	           const Spawner& spawner);
+	// merge and validate sub solutions, thread-safe once jmg_merged_ is available
+	SubTrajectory merge(const ChildSolutionList& sub_solutions,
+	                    const planning_scene::PlanningSceneConstPtr& start_scene);
+	// check (and remember) whether the pair of solutions can be merged
+	bool conflicting(const SubTrajectory* a, const SubTrajectory* b,
+	                 const planning_scene::PlanningSceneConstPtr& start_scene);
+	bool knownConflict(const ChildSolutionList& sub_solutions) const;
 
 	void sendForward(SubTrajectory&& t, const InterfaceState* from);
 	void sendBackward(SubTrajectory&& t, const InterfaceState* to);
 };
 PIMPL_FUNCTIONS(Merger)
+
+class ForEachPrivate : public ParallelContainerBasePrivate
+{
+	friend class ForEach;
+
+public:
+	ForEachPrivate(ForEach* me, const std::string& name);
+
+	/** create the child of the next element
+	 *
+	 * During planning, i.e. after interface resolution, the child is initialized and connected as well,
+	 * receiving all states already known to this container.
+	 */
+	Stage* instantiateNext(bool connect);
+	/// are there more elements to instantiate and input states to process?
+	bool canInstantiate() const;
+	bool enoughSolutions() const;
+	uint32_t maxConcurrency() const;
+
+private:
+	/// initialize and connect a child created during planning, like init() and resolveInterface() did for the others
+	void connectLate(Stage& child);
+
+	ForEach::ChildFactory factory_;
+	size_t next_element_ = 0;  // index of the next element to instantiate
+	moveit::core::RobotModelConstPtr robot_model_;
+};
+PIMPL_FUNCTIONS(ForEach)
 }  // namespace task_constructor
 }  // namespace moveit
@@ -5,6 +5,9 @@
 #include <deque>
 #include <iostream>
 #include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
 
 /// ValueOrPointeeLess provides correct comparison for plain and pointer-like types
 template <typename T, typename = bool>
@@ -23,7 +26,9 @@ struct ValueOrPointeeLess<T, decltype(*std::declval<T>() < *std::declval<T>())>
  *
  *  In contrast to std::priority_queue, we use a std::list as the underlying container.
  *  This ensures, that existing iterators remain valid upon insertion and deletion.
- *  Sorted insertion has logarithmic complexity.
+ *  An additional random-access index, mirroring the list order, allows for binary search.
+ *  Thus sorted insertion and update require a logarithmic number of comparisons,
+ *  while the index itself is shifted by contiguous moves of iterators only.
  */
 template <typename T, typename Compare = ValueOrPointeeLess<T>>
 class ordered
@@ -47,23 +52,84 @@ public:
 	using const_reverse_iterator = typename container_type::const_reverse_iterator;
 
 protected:
+	using index_type = std::deque<iterator>;
+
 	container_type c;
+	index_type index_;  // iterators of c in list order
 	Compare comp;
+	uint64_t revision_ = 0;  // modification counter of content and order
+
+	/// index position to insert item (after all equivalent items)
+	typename index_type::iterator upperBound(const value_type& item) {
+		return std::upper_bound(index_.begin(), index_.end(), item,
+		                        [this](const value_type& value, const iterator& entry) { return comp(value, *entry); });
+	}
+	/// index position of an existing list item
+	typename index_type::iterator locate(const_iterator pos) {
+		// fast paths for both ends
+		if (!index_.empty() && const_iterator(index_.front()) == pos)
+			return index_.begin();
+		if (!index_.empty() && const_iterator(index_.back()) == pos)
+			return std::prev(index_.end());
+		// binary search for the item's value, then scan all equivalent items
+		auto less = [this](const iterator& entry, const value_type& value) { return comp(*entry, value); };
+		auto it = std::lower_bound(index_.begin(), index_.end(), *pos, less);
+		for (; it != index_.end() && !comp(*pos, **it); ++it)
+			if (const_iterator(*it) == pos)
+				return it;
+		// item's value was changed without updating its position
+		it = std::find_if(index_.begin(), index_.end(),
+		                  [pos](const iterator& entry) { return const_iterator(entry) == pos; });
+		assert(it != index_.end());
+		return it;
+	}
+	/// index position of item (by identity among all equivalent items), index_.end() if not found
+	typename index_type::const_iterator findIndex(const value_type& item) const {
+		auto less = [this](const iterator& entry, const value_type& value) { return comp(*entry, value); };
+		auto it = std::lower_bound(index_.begin(), index_.end(), item, less);
+		for (; it != index_.end() && !comp(item, **it); ++it)
+			if (**it == item)
+				return it;
+		return index_.end();
+	}
+	void rebuildIndex() {
+		++revision_;
+		index_.clear();
+		for (iterator it = c.begin(), end = c.end(); it != end; ++it)
+			index_.push_back(it);
+	}
 
 public:
 	/// initialize empty container
 	explicit ordered() {}
+	ordered(const ordered& other) : c(other.c), comp(other.comp) { rebuildIndex(); }
+	ordered(ordered&& other) = default;
+	ordered& operator=(const ordered& other) {
+		c = other.c;
+		comp = other.comp;
+		rebuildIndex();
+		return *this;
+	}
+	ordered& operator=(ordered&& other) = default;
 
 	bool empty() const { return c.empty(); }
+	/// modification counter, increased by every change of content or order
+	uint64_t revision() const { return revision_; }
 	size_type size() const { return c.size(); }
 
-	void clear() { c.clear(); }
+	void clear() {
+		++revision_;
+		c.clear();
+		index_.clear();
+	}
 
 	reference top() { return c.front(); }
 	const_reference top() const { return c.front(); }
 	value_type pop() {
 		value_type result(top());
 		c.pop_front();
+		index_.pop_front();
+		++revision_;
 		return result;
 	}
 
@@ -85,46 +151,92 @@ public:
 	const_reverse_iterator crbegin() const { return c.rbegin(); }
 	const_reverse_iterator crend() const { return c.rend(); }
 
+	/// find item by identity among all equivalent items, end() if not found
+	const_iterator find(const value_type& item) const {
+		auto it = findIndex(item);
+		return it == index_.end() ? c.end() : *it;
+	}
+	iterator find(const value_type& item) {
+		auto it = findIndex(item);
+		return it == index_.end() ? c.end() : *it;
+	}
+
 	/// explicitly sort container, useful if many items have changed their value
-	void sort() { c.sort(comp); }
+	void sort() {
+		c.sort(comp);
+		rebuildIndex();
+	}
 
 	iterator insert(const value_type& item) {
-		iterator at = std::upper_bound(c.begin(), c.end(), item, comp);
-		return c.insert(at, item);
+		auto pos = upperBound(item);
+		iterator it = c.insert(pos == index_.end() ? c.end() : *pos, item);
+		index_.insert(pos, it);
+		++revision_;
+		return it;
 	}
 	iterator insert(value_type&& item) {
-		iterator at = std::upper_bound(c.begin(), c.end(), item, comp);
-		return c.insert(at, std::move(item));
+		auto pos = upperBound(item);
+		iterator it = c.insert(pos == index_.end() ? c.end() : *pos, std::move(item));
+		index_.insert(pos, it);
+		++revision_;
+		return it;
 	}
 	inline void push(const value_type& item) { insert(item); }
 	inline void push(value_type&& item) { insert(std::move(item)); }
 
-	iterator erase(const_iterator pos) { return c.erase(pos); }
+	iterator erase(const_iterator pos) {
+		index_.erase(locate(pos));
+		++revision_;
+		return c.erase(pos);
+	}
 
 	/// update sort position of a single item after changes
 	iterator update(iterator& it) {
-		container_type temp;
-		temp.splice(temp.end(), c, it);  // move it from c to temp
-		iterator at = std::upper_bound(c.begin(), c.end(), *it, comp);
-		c.splice(at, temp, it);
+		index_.erase(locate(it));
+		auto pos = upperBound(*it);
+		c.splice(pos == index_.end() ? c.end() : *pos, c, it);
+		index_.insert(pos, it);
+		++revision_;
+		return it;
+	}
+	/// change an item's value via modify(item) and update its sort position, locating it before the change
+	template <typename Modify>
+	iterator update(iterator it, Modify&& modify) {
+		index_.erase(locate(it));
+		modify(*it);
+		auto pos = upperBound(*it);
+		c.splice(pos == index_.end() ? c.end() : *pos, c, it);
+		index_.insert(pos, it);
+		++revision_;
 		return it;
 	}
 
 	/// move element pos from this to other container, inserting before other_pos
 	iterator moveTo(iterator pos, container_type& other, iterator other_pos) {
+		index_.erase(locate(pos));
 		other.splice(other_pos, c, pos);
+		++revision_;
 		return pos;
 	}
 	/// move element pos from other container into this one (sorted)
 	iterator moveFrom(iterator pos, container_type& other) {
-		iterator at = std::upper_bound(begin(), end(), *pos, comp);
-		c.splice(at, other, pos);
+		auto at = upperBound(*pos);
+		c.splice(at == index_.end() ? c.end() : *at, other, pos);
+		index_.insert(at, pos);
+		++revision_;
 		return pos;
 	}
+	/// move all elements from other container into this one, sorting them once and rebuilding the index in one pass
+	void merge(container_type& other) {
+		other.sort(comp);
+		c.merge(other, comp);  // keeps existing items before equivalent new ones, like insert()
+		rebuildIndex();
+	}
 
 	template <typename Predicate>
 	void remove_if(Predicate p) {
 		c.remove_if(p);
+		rebuildIndex();
 	}
 };
 
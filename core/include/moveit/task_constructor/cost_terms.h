@@ -41,6 +41,8 @@
 #include <moveit/task_constructor/storage.h>
 #include <moveit/task_constructor/utils.h>
 
+#include <map>
+
 namespace moveit {
 namespace task_constructor {
 
@@ -61,6 +63,9 @@ public:
 	virtual double operator()(const SubTrajectory& s, std::string& comment) const;
 	virtual double operator()(const SolutionSequence& s, std::string& comment) const;
 	virtual double operator()(const WrappedSolution& s, std::string& comment) const;
+
+	/// admissible lower bound for the cost of any solution connecting from and to (used for cost pruning)
+	virtual double lowerBound(const InterfaceState& from, const InterfaceState& to) const;
 };
 
 /** base class for cost terms that only work on SubTrajectory solutions
@@ -109,19 +114,27 @@ public:
 	double operator()(const SubTrajectory& s, std::string& comment) const override;
 	double operator()(const SolutionSequence& s, std::string& comment) const override;
 	double operator()(const WrappedSolution& s, std::string& comment) const override;
+	double lowerBound(const InterfaceState& from, const InterfaceState& to) const override;
 
 	double cost;
 };
 
-/// trajectory length (interpolated between waypoints)
+/** trajectory length (interpolated between waypoints)
+ *
+ * Without joints and weights, all active joints contribute, weighted by their distance factor.
+ * Otherwise, the given joints (weight 1) and weighted joints contribute.
+ */
 class PathLength : public TrajectoryCostTerm
 {
 public:
 	PathLength() = default;
 	PathLength(std::vector<std::string> j) : joints{ std::move(j) } {};
 	double operator()(const SubTrajectory& s, std::string& comment) const override;
+	/// joint-space distance between from and to
+	double lowerBound(const InterfaceState& from, const InterfaceState& to) const override;
 
 	std::vector<std::string> joints;
+	std::map<std::string, double> weights;
 };
 
 /// execution duration of the whole trajectory
@@ -149,6 +162,9 @@ public:
  * \arg group_property the name of the property which defines the group to look at
  * \arg interface compute distances using START or END interface of solution *only*, instead of averaging over
  * trajectory
+ *
+ * Trajectories can be subsampled (stride), evaluated concurrently (num_threads),
+ * and cut short once a waypoint comes closer than stop_distance, whose distance then defines the cost.
  * */
 class Clearance : public TrajectoryCostTerm
 {
@@ -169,11 +185,44 @@ public:
 
 	Mode mode;
 
+	/// evaluate every stride-th waypoint only (the last waypoint is always evaluated)
+	size_t stride = 1;
+	/// number of threads evaluating waypoints concurrently
+	unsigned int num_threads = 1;
+	/// stop evaluating waypoints once a distance falls below this value
+	double stop_distance = 0.0;
+
 	std::function<double(double)> distance_to_cost;
 
 	double operator()(const SubTrajectory& s, std::string& comment) const override;
 };
 
+/** weighted sum of cost terms
+ *
+ * The sub terms share per-trajectory data (frame and joint positions, distance queries),
+ * which is computed only once per SubTrajectory, see SubTrajectory::sharedData().
+ * Weights should be non-negative to keep the lower bound admissible.
+ */
+class Composite : public CostTerm
+{
+public:
+	Composite() = default;
+	Composite(std::vector<std::pair<CostTermConstPtr, double>> t) : terms{ std::move(t) } {}
+
+	void add(const CostTermConstPtr& term, double weight = 1.0) { terms.emplace_back(term, weight); }
+
+	double operator()(const SubTrajectory& s, std::string& comment) const override;
+	double operator()(const SolutionSequence& s, std::string& comment) const override;
+	double operator()(const WrappedSolution& s, std::string& comment) const override;
+	/// weighted sum of the terms' lower bounds
+	double lowerBound(const InterfaceState& from, const InterfaceState& to) const override;
+
+	std::vector<std::pair<CostTermConstPtr, double>> terms;
+
+private:
+	double sum(const SolutionBase& s, std::string& comment) const;
+};
+
 }  // namespace cost
 }  // namespace task_constructor
 }  // namespace moveit
@@ -0,0 +1,139 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Lock-free ring buffer of binary events from hot paths, formatted as text on demand only
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Process-wide, fixed-size ring buffer of binary events
+ *
+ * Hot paths record (source, code, numeric payload) tuples in addition to their (debug) log messages.
+ * Sources are process-unique ids of stages (see newSource()), which remain unambiguous after a stage was destroyed.
+ * Writers claim a slot with a single atomic increment and never block, overwriting the oldest events.
+ * Readers detect slots overwritten while copying them (seqlock) and skip those.
+ * Readable text is only formatted by dump(), e.g. after planning failed (at debug level of logger "EventLog")
+ * or through the get_event_log service of a task's introspection.
+ * Recording is disabled by default, see enable(). While disabled, logEvent() costs a single relaxed atomic load.
+ */
+class EventLog
+{
+public:
+	enum Code : uint16_t
+	{
+		COMPUTE,  ///< stage finished compute(), value: duration [s], arg: whether a solution was found
+		CHILD_SOLUTION,  ///< container received a solution, value: its cost, arg: creating child stage
+		CHILD_FAILURE,  ///< container prunes after a child's failure, arg: child stage
+		CHILD_INVALIDATED,  ///< container prunes after a child invalidated a solution, arg: child stage
+		CHILD_DROPPED,  ///< container prunes after a child dropped a solution, arg: child stage
+		FALLBACK,  ///< Fallbacks child failed and the next one is tried, arg: failed child stage
+		JOINT_DEVIATION,  ///< Connect found incompatible states, value: deviation, arg: index of deviating joint
+		STALL,  ///< compute() exceeded its stall deadline, value: running time [s], arg: Introspection::stateId() of input
+	};
+	/// process-unique id of an event source, never reused
+	using Source = uint64_t;
+	struct Event
+	{
+		uint64_t sequence;  ///< running number of event
+		int64_t time;  ///< µs since log creation
+		Source source;  ///< stage recording the event
+		Code code;
+		double value;
+		uint64_t arg;
+	};
+	/// number of most recent events kept
+	static constexpr std::size_t CAPACITY = 1 << 14;
+	/// name of a recorded source, empty if unknown
+	using NameLookup = std::function<std::string(Source source)>;
+
+	static EventLog& instance();
+	static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+	/// allocate a new source id (> 0)
+	static Source newSource();
+
+	void enable() { enabled_ = true; }
+	void disable() { enabled_ = false; }
+	/// drop all events recorded so far
+	void clear();
+
+	void record(Source source, Code code, double value = 0.0, uint64_t arg = 0);
+
+	/// up to max (0: all) most recent events, oldest first
+	std::vector<Event> events(std::size_t max = 0) const;
+	/// format up to max (0: all) most recent events as text, one per line
+	void dump(std::ostream& os, const NameLookup& names = NameLookup(), std::size_t max = 0) const;
+
+	static const char* name(Code code);
+
+private:
+	EventLog();
+
+	struct Slot
+	{
+		std::atomic<uint64_t> version{ 0 };  // 2 * (sequence + 1) once written, odd while writing
+		std::atomic<int64_t> time{ 0 };
+		std::atomic<Source> source{ 0 };
+		std::atomic<uint16_t> code{ 0 };
+		std::atomic<double> value{ 0.0 };
+		std::atomic<uint64_t> arg{ 0 };
+	};
+
+	static std::atomic<bool> enabled_;
+	static std::atomic<Source> next_source_;
+
+	const std::chrono::steady_clock::time_point origin_;
+	std::atomic<uint64_t> head_{ 0 };  // sequence number of next event
+	std::atomic<uint64_t> cleared_{ 0 };  // events before this sequence number were cleared
+	std::unique_ptr<Slot[]> slots_;
+};
+
+/// record an event in the process-wide EventLog, if enabled
+inline void logEvent(EventLog::Source source, EventLog::Code code, double value = 0.0, uint64_t arg = 0) {
+	if (EventLog::enabled())
+		EventLog::instance().record(source, code, value, arg);
+}
+}  // namespace task_constructor
+}  // namespace moveit
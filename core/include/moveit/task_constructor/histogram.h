@@ -0,0 +1,95 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Fixed-size streaming histogram of durations
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Streaming histogram of durations (in seconds) using logarithmic buckets
+ *
+ * Bucket 0 collects values below MIN_VALUE, bucket i > 0 covers
+ * [MIN_VALUE * 2^((i-1) / BUCKETS_PER_OCTAVE), MIN_VALUE * 2^(i / BUCKETS_PER_OCTAVE)).
+ * The last bucket also collects all larger values. Memory is fixed, the relative
+ * quantization error is below 2^(1 / BUCKETS_PER_OCTAVE) - 1 (19%).
+ */
+class LatencyHistogram
+{
+public:
+	static constexpr double MIN_VALUE = 1e-5;  // 10 µs
+	static constexpr unsigned int BUCKETS_PER_OCTAVE = 4;
+	static constexpr unsigned int NUM_BUCKETS = 1 + 24 * BUCKETS_PER_OCTAVE;  // up to ~168s
+
+	LatencyHistogram() { reset(); }
+
+	void reset();
+	void record(double value);
+	/// accumulate counts of another histogram
+	void merge(const LatencyHistogram& other);
+	/// scale all counts down to (about) max_count samples, preserving the distribution and the mean
+	void decay(std::size_t max_count);
+	/// restore a histogram from its bucket counts and exact summary, e.g. after deserialization
+	void assign(const std::array<uint32_t, NUM_BUCKETS>& buckets, double sum, double min, double max);
+
+	std::size_t count() const { return count_; }
+	double sum() const { return sum_; }
+	double min() const { return count_ ? min_ : 0.0; }
+	double max() const { return count_ ? max_ : 0.0; }
+	double mean() const { return count_ ? sum_ / count_ : 0.0; }
+	/// estimate q-quantile (q in [0,1]) from bucket counts, interpolating within buckets
+	double quantile(double q) const;
+
+	const std::array<uint32_t, NUM_BUCKETS>& buckets() const { return buckets_; }
+	static unsigned int bucketIndex(double value);
+	/// lower bound of given bucket
+	static double bucketLowerBound(unsigned int bucket);
+
+private:
+	std::array<uint32_t, NUM_BUCKETS> buckets_;
+	std::size_t count_;
+	double sum_;
+	double min_;
+	double max_;
+};
+
+}  // namespace task_constructor
+}  // namespace moveit
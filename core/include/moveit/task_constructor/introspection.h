@@ -38,23 +38,32 @@
 
 #pragma once
 
+#include <moveit/task_constructor/histogram.h>
 #include <moveit/macros/class_forward.h>
 #include <moveit_task_constructor_msgs/TaskDescription.h>
 #include <moveit_task_constructor_msgs/TaskStatistics.h>
 #include <moveit_task_constructor_msgs/Solution.h>
+#include <moveit_task_constructor_msgs/GetEventLog.h>
 #include <moveit_task_constructor_msgs/GetSolution.h>
+#include <moveit_task_constructor_msgs/GetSolutions.h>
+#include <set>
 
 #define DESCRIPTION_TOPIC "description"
 #define STATISTICS_TOPIC "statistics"
 #define SOLUTION_TOPIC "solution"
 #define GET_SOLUTION_SERVICE "get_solution"
+#define GET_SOLUTIONS_SERVICE "get_solutions"
+#define GET_EVENT_LOG_SERVICE "get_event_log"
+#define REMOTE_NAMESPACE "remote"
 
 namespace moveit {
 namespace task_constructor {
 
 MOVEIT_CLASS_FORWARD(Stage);
 MOVEIT_CLASS_FORWARD(SolutionBase);
+MOVEIT_CLASS_FORWARD(TaskExecutor);
 
+class InterfaceState;
 class TaskPrivate;
 class IntrospectionPrivate;
 
@@ -76,37 +85,119 @@ public:
 	fillTaskDescription(moveit_task_constructor_msgs::TaskDescription& msg);
 	/// publish detailed task description
 	void publishTaskDescription();
+	/** Publish task descriptions incrementally, with (at most) num_stages stages per message
+	 *
+	 * The first description is published as a skeleton of all stages (omitting their properties),
+	 * followed by delta messages providing the properties of num_stages stages each.
+	 * Later descriptions only describe stages that were added or changed. If stages were removed,
+	 * subscribers are reset and receive a new skeleton. New subscribers receive the last description
+	 * in the same way. To fit into the publisher queue, a description is split into at most 98 chunks,
+	 * enlarging them beyond num_stages if needed. num_stages = 0 publishes complete descriptions (default).
+	 */
+	void setDescriptionChunkSize(size_t num_stages);
+	/** Serialize property values in binary form (if available for their type) instead of text
+	 *
+	 * This is faster and more compact, but subscribers need to know the types to decode them.
+	 */
+	void setBinaryProperties(bool enable);
+	/** drop waypoints of published solution trajectories that are linearly interpolated within tolerance (0 = off)
+	 *
+	 * This only affects messages published or served for visualization, not the trajectories executed by the Task.
+	 */
+	void setTrajectoryTolerance(double tolerance);
 
 	/// fill task state message for publishing the current task state
 	moveit_task_constructor_msgs::TaskStatistics& fillTaskStatistics(moveit_task_constructor_msgs::TaskStatistics& msg);
-	/// publish the current state of task
+	/** publish the current state of task
+	 *
+	 * Publishing is skipped if there are no subscribers or the rate limit is exceeded.
+	 * Skipped updates are coalesced into the next one or published by flushTaskState().
+	 */
 	void publishTaskState();
+	/// publish skipped state updates (or the current state if force is true)
+	void flushTaskState(bool force = false);
+	/// limit rate of task state messages (in Hz), 0 = unlimited
+	void setMaxStatisticsRate(double rate);
+	/** Publish task states delta-encoded, with a full keyframe every interval messages
+	 *
+	 * Delta messages only describe stages that changed since the previous message
+	 * and only list solutions added (or removed) since then. interval = 0 disables delta encoding.
+	 */
+	void setStatisticsKeyframeInterval(unsigned int interval);
+
+	/** Additionally provide introspection for monitoring over low-bandwidth links in the remote/ sub namespace
+	 *
+	 * Subscribers select the profile by topic: remote/description mirrors the description topic,
+	 * remote/statistics provides delta-encoded statistics without latency histograms and planner statistics,
+	 * and remote/solution provides solution summaries (ids, costs, comments, stage ids) only.
+	 * Full solutions are served on request by the services in the remote/ namespace.
+	 * Remote statistics use the keyframe interval of the statistics topic, or 100 if delta encoding
+	 * is disabled there, which keeps the statistics topic publishing full messages.
+	 * New subscribers of remote/statistics receive the last keyframe and all later deltas.
+	 * Call before planning.
+	 */
+	void setRemoteProfile(bool enable);
+
+	/// configure publishing threads according to given executor (initially the task's one)
+	void setExecutor(const TaskExecutorPtr& executor);
 
 	/// indicate that this task was reset
 	void reset();
 
 	/// register the given solution, assigning a unique ID
 	void registerSolution(const SolutionBase& s);
-
-	/// publish the given solution
+	/// forget about a solution that is going to be destroyed
+	void unregisterSolution(const SolutionBase& s);
+
+	/** publish the given solution
+	 *
+	 * Messages are published by a background thread. If the rate limit is exceeded,
+	 * a newer solution replaces a still pending one.
+	 */
 	void publishSolution(const SolutionBase& s);
+	/// limit rate of solution messages (in Hz), 0 = unlimited
+	void setMaxSolutionRate(double rate);
+	/// durations of filling task state and solution messages, i.e. the publishing cost of the planning thread
+	const LatencyHistogram& publishLatency() const;
 
 	/// publish all top-level solutions of task
 	void publishAllSolutions(bool wait = true);
+	/** publish a page of top-level solutions: count solutions, ranked by cost, starting at first
+	 *
+	 * Messages are filled in parallel by up to num_threads threads (0: one per core) and published
+	 * best first via a bounded queue, i.e. only a few messages are filled ahead of publishing.
+	 * Request further pages on demand, or individual solutions via the get_solutions service.
+	 * Returns the number of published solutions.
+	 */
+	size_t publishSolutions(size_t count, size_t first = 0, unsigned int num_threads = 0);
 
 	/// get solution
 	bool getSolution(moveit_task_constructor_msgs::GetSolution::Request& req,
 	                 moveit_task_constructor_msgs::GetSolution::Response& res);
+	/// get several solutions at once, sending each start scene only once
+	bool getSolutions(moveit_task_constructor_msgs::GetSolutions::Request& req,
+	                  moveit_task_constructor_msgs::GetSolutions::Response& res);
+	/// get recent events of the EventLog as text
+	bool getEventLog(moveit_task_constructor_msgs::GetEventLog::Request& req,
+	                 moveit_task_constructor_msgs::GetEventLog::Response& res);
 
 	/// retrieve id of given stage
 	uint32_t stageId(const moveit::task_constructor::Stage* const s) const;
 
 	/// retrieve or set id of given solution
 	uint32_t solutionId(const moveit::task_constructor::SolutionBase& s);
+	/// id of given state: the solution id of the (first) sub trajectory it was created by, 0 if there is none
+	uint32_t stateId(const moveit::task_constructor::InterfaceState& s);
 
 private:
 	void fillStageStatistics(const Stage& stage, moveit_task_constructor_msgs::StageStatistics& s);
-	void fillSolution(moveit_task_constructor_msgs::Solution& msg, const SolutionBase& s);
+	/// fill task state message in delta mode (keyframe or delta)
+	void fillTaskStatisticsDelta(moveit_task_constructor_msgs::TaskStatistics& msg);
+	/// aggregate call statistics of all planners used in the task
+	void fillPlannerStatistics(moveit_task_constructor_msgs::TaskStatistics& msg);
+	/// fill solution msg, omitting start_scene if its id is in known_scenes (new ids are added)
+	void fillSolution(moveit_task_constructor_msgs::Solution& msg, const SolutionBase& s,
+	                  std::set<std::string>* known_scenes = nullptr);
 	/// retrieve or set id of given stage
 	uint32_t stageId(const moveit::task_constructor::Stage* const s);
 	/// retrieve solution with given id
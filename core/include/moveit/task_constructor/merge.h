@@ -60,5 +60,9 @@ robot_trajectory::RobotTrajectoryPtr
 merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
       const moveit::core::RobotState& base_state, moveit::core::JointModelGroup*& merged_group,
       const trajectory_processing::TimeParameterization& time_parameterization);
+/// merge without timing (all waypoint durations are zero), e.g. for collision checking or deferred timing
+robot_trajectory::RobotTrajectoryPtr
+merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
+      const moveit::core::RobotState& base_state, moveit::core::JointModelGroup*& merged_group);
 }  // namespace task_constructor
 }  // namespace moveit
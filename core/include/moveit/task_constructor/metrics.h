@@ -0,0 +1,99 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Export planning statistics of a task as Prometheus metrics
+*/
+
+#pragma once
+
+#include "task.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Export statistics of a task in the Prometheus text format, optionally serving them via HTTP
+ *
+ * The exporter renders stage statistics (solutions, failures by reason, compute latency, memory),
+ * planner call statistics, and introspection publishing cost independently of any subscriber.
+ * Rendering happens in the planning thread (as a task callback), at most at the configured rate,
+ * because statistics cannot be accessed concurrently with planning. Scrapes only copy the latest text.
+ * Counters accumulate since the last reset() of the task: rates (e.g. solutions/s) are left to Prometheus.
+ * The HTTP server only listens on localhost by default: pass another address to expose it to the network.
+ *
+ * The exporter needs to be destroyed before its task.
+ */
+class MetricsExporter
+{
+public:
+	/// export metrics of task, serving them on given HTTP port and IPv4 address (port 0: don't serve),
+	/// updated at most at rate Hz
+	MetricsExporter(Task& task, unsigned short port = 0, double rate = 1.0,
+	                const std::string& address = "127.0.0.1");
+	~MetricsExporter();
+
+	/// render current metrics in the planning thread (or while not planning)
+	void update();
+	/// latest rendered metrics
+	std::string text() const;
+	/// actual port of the HTTP server (0 if not serving)
+	unsigned short port() const { return port_; }
+
+	/// write metrics of task in Prometheus text format (not thread-safe w.r.t. planning)
+	static void write(std::ostream& os, const Task& task);
+
+private:
+	void serve();
+
+	Task& task_;
+	Task::TaskCallbackList::const_iterator callback_;
+	const std::chrono::steady_clock::duration period_;
+	std::chrono::steady_clock::time_point next_update_;
+
+	mutable std::mutex text_mutex_;
+	std::string text_;
+
+	int socket_ = -1;
+	unsigned short port_ = 0;
+	std::atomic<bool> stop_{ false };
+	std::thread server_thread_;
+};
+}  // namespace task_constructor
+}  // namespace moveit
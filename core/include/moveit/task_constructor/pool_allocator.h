@@ -0,0 +1,176 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Pooled allocation of list nodes
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Pool of equally-sized memory nodes
+ *
+ * Memory is requested from the heap in chunks of growing size and recycled via a free list.
+ * Hence, the number of heap allocations grows only logarithmically with the number of nodes.
+ * Chunks are kept until destruction, such that clearing and refilling a container is cheap.
+ * Not thread-safe: all users of a pool need to be synchronized by their owner.
+ */
+class NodePool
+{
+public:
+	explicit NodePool(std::size_t node_size)
+	  : node_size_(nodeSizeFor(node_size)), chunk_nodes_(MIN_CHUNK_NODES), free_(nullptr) {}
+	NodePool(const NodePool&) = delete;
+	NodePool& operator=(const NodePool&) = delete;
+
+	std::size_t nodeSize() const { return node_size_; }
+	/// actual node size used for requested size, considering alignment
+	static std::size_t nodeSizeFor(std::size_t size) {
+		constexpr std::size_t align = alignof(std::max_align_t);
+		size = std::max(size, sizeof(FreeNode));
+		return (size + align - 1) / align * align;
+	}
+
+	void* allocate() {
+		if (!free_)
+			grow();
+		FreeNode* node = free_;
+		free_ = node->next;
+		return node;
+	}
+	void deallocate(void* p) noexcept {
+		FreeNode* node = static_cast<FreeNode*>(p);
+		node->next = free_;
+		free_ = node;
+	}
+
+private:
+	struct FreeNode
+	{
+		FreeNode* next;
+	};
+	static constexpr std::size_t MIN_CHUNK_NODES = 32;
+	static constexpr std::size_t MAX_CHUNK_NODES = 4096;
+
+	void grow() {
+		const std::size_t num = chunk_nodes_;
+		chunk_nodes_ = 2 * num < MAX_CHUNK_NODES ? 2 * num : MAX_CHUNK_NODES;
+		chunks_.emplace_back(new char[num * node_size_]);
+		char* chunk = chunks_.back().get();
+		for (std::size_t i = num; i-- > 0;)  // such that nodes are handed out in memory order
+			deallocate(chunk + i * node_size_);
+	}
+
+	const std::size_t node_size_;
+	std::size_t chunk_nodes_;  // size of next chunk
+	FreeNode* free_;
+	std::vector<std::unique_ptr<char[]>> chunks_;
+};
+
+/// set of node pools for different node sizes
+class NodePools
+{
+public:
+	NodePool& pool(std::size_t node_size) {
+		const std::size_t size = NodePool::nodeSizeFor(node_size);
+		if (last_ && last_->nodeSize() == size)
+			return *last_;
+		for (const auto& p : pools_)
+			if (p->nodeSize() == size)
+				return *(last_ = p.get());
+		pools_.emplace_back(std::make_unique<NodePool>(size));
+		return *(last_ = pools_.back().get());
+	}
+
+private:
+	std::vector<std::unique_ptr<NodePool>> pools_;
+	NodePool* last_ = nullptr;
+};
+
+/** Allocator serving single objects from NodePools, which are shared by all copies (and rebinds)
+ *
+ * Intended for node-based containers like std::list, which allocate their elements one by one.
+ */
+template <typename T>
+class PoolAllocator
+{
+public:
+	using value_type = T;
+	static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not supported");
+
+	PoolAllocator() : pools_(std::make_shared<NodePools>()) {}
+	PoolAllocator(const PoolAllocator& other) noexcept = default;  // no move: moved-from allocators need to remain valid
+	template <typename U>
+	PoolAllocator(const PoolAllocator<U>& other) noexcept : pools_(other.pools_) {}
+
+	T* allocate(std::size_t n) {
+		if (n != 1)
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		return static_cast<T*>(pools_->pool(sizeof(T)).allocate());
+	}
+	void deallocate(T* p, std::size_t n) noexcept {
+		if (n != 1)
+			::operator delete(p);
+		else
+			pools_->pool(sizeof(T)).deallocate(p);
+	}
+
+	template <typename U>
+	bool operator==(const PoolAllocator<U>& other) const {
+		return pools_ == other.pools_;
+	}
+	template <typename U>
+	bool operator!=(const PoolAllocator<U>& other) const {
+		return pools_ != other.pools_;
+	}
+
+private:
+	template <typename U>
+	friend class PoolAllocator;
+	std::shared_ptr<NodePools> pools_;
+};
+
+template <typename T>
+using PoolList = std::list<T, PoolAllocator<T>>;
+
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,100 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    structure-of-arrays batch of pose candidates, filtered by pose generators before spawning states
+*/
+
+#pragma once
+
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Batch of pose candidates in structure-of-arrays layout
+ *
+ * Poses, scores, and parent references are stored in separate, contiguous arrays of equal size,
+ * such that operations across all candidates (transformation, scoring, filtering) can be vectorized.
+ * Stages like GeneratePose process candidates as a batch and only materialize the remaining ones
+ * into individual InterfaceStates. Poses share a common frame. Scores are cost-like: lower is better.
+ * Parents index into a list of originating objects maintained by the producer, e.g. upstream solutions.
+ */
+class PoseCandidates
+{
+public:
+	using Poses = std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d>>;
+	/// filter operating on a whole batch, e.g. calling retain() or updating scores
+	using Filter = std::function<void(PoseCandidates& candidates)>;
+
+	explicit PoseCandidates(std::string frame = "") : frame_(std::move(frame)) {}
+
+	const std::string& frame() const { return frame_; }
+	void setFrame(const std::string& frame) { frame_ = frame; }
+
+	size_t size() const { return poses_.size(); }
+	bool empty() const { return poses_.empty(); }
+	void reserve(size_t n);
+	void clear();
+
+	void add(const Eigen::Isometry3d& pose, double score = 0.0, uint32_t parent = 0);
+
+	const Poses& poses() const { return poses_; }
+	Poses& poses() { return poses_; }
+	const std::vector<double>& scores() const { return scores_; }
+	std::vector<double>& scores() { return scores_; }
+	const std::vector<uint32_t>& parents() const { return parents_; }
+
+	/// pre-multiply all poses by tf, the pose of frame() w.r.t. frame, such that they are expressed in frame
+	void transform(const Eigen::Isometry3d& tf, const std::string& frame);
+	/// keep candidates with non-zero mask entries only, preserving their order. Returns number of removed ones.
+	size_t retain(const std::vector<uint8_t>& mask);
+	/// keep candidates for which predicate(index) returns true
+	size_t retain(const std::function<bool(size_t index)>& predicate);
+	/// stable sort of all candidates by increasing score
+	void sortByScore();
+
+private:
+	std::string frame_;
+	Poses poses_;
+	std::vector<double> scores_;
+	std::vector<uint32_t> parents_;
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,77 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Cooperative preemption of long-running computations
+*/
+
+#pragma once
+
+#include <atomic>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Flag signaling a pending preemption request of a Task.
+ *
+ * The Task owns the token and passes it down to stages and solvers.
+ * Long-running computations (IK attempts, Cartesian waypoints, planning) should poll
+ * requested() within their inner loops and return early (with failure) if it is set.
+ * Containers may hand own tokens to their children, chained to their parent token,
+ * to preempt individual subtrees only.
+ */
+class PreemptionToken
+{
+public:
+	PreemptionToken() = default;
+	explicit PreemptionToken(const PreemptionToken* parent) : parent_(parent) {}
+	PreemptionToken(const PreemptionToken&) = delete;
+	PreemptionToken& operator=(const PreemptionToken&) = delete;
+
+	void request() { requested_ = true; }
+	void reset() { requested_ = false; }
+	/// was preemption requested for this token or any of its parents?
+	bool requested() const { return requested_.load(std::memory_order_relaxed) || requested(parent_); }
+
+	/// chain to a parent token (only while no computation polls this token)
+	void setParent(const PreemptionToken* parent) { parent_ = parent; }
+
+	/// convenience check, handling undefined tokens
+	static bool requested(const PreemptionToken* token) { return token && token->requested(); }
+
+private:
+	std::atomic<bool> requested_{ false };
+	const PreemptionToken* parent_ = nullptr;
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -39,7 +39,10 @@
 #pragma once
 
 #include <boost/any.hpp>
+#include <cstdint>
+#include <cstring>
 #include <typeindex>
+#include <type_traits>
 #include <map>
 #include <set>
 #include <vector>
@@ -95,7 +98,9 @@ public:
 
 	/// set current value and default value
 	void setValue(const boost::any& value);
+	void setValue(boost::any&& value);
 	void setCurrentValue(const boost::any& value);
+	void setCurrentValue(boost::any&& value);
 	void setDefaultValue(const boost::any& value);
 
 	/// reset to default value (which can be empty)
@@ -114,6 +119,9 @@ public:
 	static std::string serialize(const boost::any& value);
 	static boost::any deserialize(const std::string& type_name, const std::string& wire);
 	std::string serialize() const { return serialize(value()); }
+	/// binary serialization (ROS msgs and arithmetic types), returns false if not available for value's type
+	static bool serializeBinary(const boost::any& value, std::vector<uint8_t>& data);
+	static boost::any deserializeBinary(const std::string& type_name, const std::vector<uint8_t>& data);
 
 	/// get description text
 	const std::string& description() const { return description_; }
@@ -131,6 +139,9 @@ public:
 	Property& configureInitFrom(SourceFlags source, const std::string& name);
 
 private:
+	/// throw type_error if value doesn't match the declared type
+	void checkType(const boost::any& value) const;
+
 	std::string description_;
 	const type_info& type_info_;
 	boost::any default_;
@@ -140,6 +151,7 @@ private:
 	SourceFlags source_flags_ = 0;
 	SourceFlags initialized_from_;
 	InitializerFunction initializer_;
+	std::string initializer_name_;  // name of other property, if initializer_ is fromName()
 };
 
 class Property::error : public std::runtime_error
@@ -188,18 +200,29 @@ template <typename T>
 struct hasDeserialize<T, decltype(std::declval<std::istream&>() >> std::declval<T&>())> : std::true_type
 {};
 
+/// types that can be binary-serialized as raw bytes
+template <typename T>
+struct isRawBinary : std::integral_constant<bool, std::is_arithmetic<T>::value || std::is_enum<T>::value>
+{};
+
 class PropertySerializerBase
 {
 public:
 	using SerializeFunction = std::string (*)(const boost::any&);
 	using DeserializeFunction = boost::any (*)(const std::string&);
+	/// copy-assign source to target, both holding the same type, reusing target's storage
+	using AssignFunction = void (*)(boost::any& target, const boost::any& source);
+	using BinarySerializeFunction = void (*)(const boost::any&, std::vector<uint8_t>&);
+	using BinaryDeserializeFunction = boost::any (*)(const std::vector<uint8_t>&);
 
 	static std::string dummySerialize(const boost::any& /*unused*/) { return ""; }
 	static boost::any dummyDeserialize(const std::string& /*unused*/) { return boost::any(); }
 
 protected:
 	static bool insert(const std::type_index& type_index, const std::string& type_name, SerializeFunction serialize,
-	                   DeserializeFunction deserialize);
+	                   DeserializeFunction deserialize, AssignFunction assign = nullptr,
+	                   BinarySerializeFunction serialize_binary = nullptr,
+	                   BinaryDeserializeFunction deserialize_binary = nullptr);
 };
 
 /// utility class to register serializer/deserializer functions for a property of type T
@@ -207,7 +230,10 @@ template <typename T>
 class PropertySerializer : protected PropertySerializerBase
 {
 public:
-	PropertySerializer() { insert(typeid(T), typeName<T>(), &serialize, &deserialize); }
+	PropertySerializer() {
+		insert(typeid(T), typeName<T>(), &serialize, &deserialize, assignFunction(), binarySerializeFunction(),
+		       binaryDeserializeFunction());
+	}
 
 	template <class Q = T>
 	static typename std::enable_if<ros::message_traits::IsMessage<Q>::value, std::string>::type typeName() {
@@ -220,6 +246,71 @@ public:
 	}
 
 private:
+	/** In-place assignment avoids reallocation of boost::any's holder (and possibly T's own storage) */
+	template <class Q = T>
+	static typename std::enable_if<std::is_copy_assignable<Q>::value, AssignFunction>::type assignFunction() {
+		return [](boost::any& target, const boost::any& source) {
+			*boost::any_cast<T>(&target) = *boost::any_cast<T>(&source);
+		};
+	}
+	template <class Q = T>
+	static typename std::enable_if<!std::is_copy_assignable<Q>::value, AssignFunction>::type assignFunction() {
+		return nullptr;
+	}
+
+	/** Binary serialization: ROS serialization for msgs, raw bytes for arithmetic and enum types */
+	template <class Q = T>
+	static typename std::enable_if<ros::message_traits::IsMessage<Q>::value, BinarySerializeFunction>::type
+	binarySerializeFunction() {
+		return [](const boost::any& value, std::vector<uint8_t>& data) {
+			const T& msg = *boost::any_cast<T>(&value);
+			data.resize(ros::serialization::serializationLength(msg));
+			ros::serialization::OStream stream(data.data(), data.size());
+			ros::serialization::serialize(stream, msg);
+		};
+	}
+	template <class Q = T>
+	static typename std::enable_if<ros::message_traits::IsMessage<Q>::value, BinaryDeserializeFunction>::type
+	binaryDeserializeFunction() {
+		return [](const std::vector<uint8_t>& data) -> boost::any {
+			T msg;
+			ros::serialization::IStream stream(const_cast<uint8_t*>(data.data()), data.size());
+			ros::serialization::deserialize(stream, msg);
+			return msg;
+		};
+	}
+	template <class Q = T>
+	static typename std::enable_if<isRawBinary<Q>::value, BinarySerializeFunction>::type
+	binarySerializeFunction() {
+		return [](const boost::any& value, std::vector<uint8_t>& data) {
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(boost::any_cast<T>(&value));
+			data.assign(bytes, bytes + sizeof(T));
+		};
+	}
+	template <class Q = T>
+	static typename std::enable_if<isRawBinary<Q>::value, BinaryDeserializeFunction>::type
+	binaryDeserializeFunction() {
+		return [](const std::vector<uint8_t>& data) -> boost::any {
+			if (data.size() != sizeof(T))
+				return boost::any();
+			T value;
+			std::memcpy(&value, data.data(), sizeof(T));
+			return value;
+		};
+	}
+	template <class Q = T>
+	static typename std::enable_if<!ros::message_traits::IsMessage<Q>::value && !isRawBinary<Q>::value,
+	                               BinarySerializeFunction>::type
+	binarySerializeFunction() {
+		return nullptr;
+	}
+	template <class Q = T>
+	static typename std::enable_if<!ros::message_traits::IsMessage<Q>::value && !isRawBinary<Q>::value,
+	                               BinaryDeserializeFunction>::type
+	binaryDeserializeFunction() {
+		return nullptr;
+	}
+
 	/** Serialization based on std::[io]stringstream */
 	template <class Q = T>
 	static typename std::enable_if<hasSerialize<Q>::value, std::string>::type serialize(const boost::any& value) {
@@ -230,11 +321,23 @@ private:
 	template <class Q = T>
 	static typename std::enable_if<hasSerialize<Q>::value && hasDeserialize<Q>::value, boost::any>::type
 	deserialize(const std::string& wired) {
-		std::istringstream iss(wired);
 		T value;
-		iss >> value;
+		if (!parse(wired, value) && !wired.empty())
+			return boost::any();  // parse error
 		return value;
 	}
+	/// strings are taken verbatim, as operator>> would stop at the first whitespace
+	static bool parse(const std::string& wired, std::string& value) {
+		value = wired;
+		return true;
+	}
+	/// other values need to consume all of the (whitespace-trimmed) input
+	template <class V>
+	static bool parse(const std::string& wired, V& value) {
+		std::istringstream iss(wired);
+		iss >> value;
+		return !iss.fail() && (iss >> std::ws).eof();
+	}
 
 	/** No serialization available */
 	template <class Q = T>
@@ -248,6 +351,40 @@ private:
 	}
 };
 
+/** Typed handle to a declared Property, obtained via PropertyMap::handle()
+ *
+ * Resolving the name once, e.g. in Stage::init(), avoids the map lookup on every access.
+ * The handle remains valid as long as the PropertyMap exists.
+ */
+template <typename T>
+class PropertyHandle
+{
+	friend class PropertyMap;
+	const std::string* name_ = nullptr;
+	const Property* property_ = nullptr;
+
+	PropertyHandle(const std::string& name, const Property& property) : name_(&name), property_(&property) {}
+
+public:
+	PropertyHandle() = default;
+
+	/// was the handle resolved?
+	bool valid() const { return property_ != nullptr; }
+
+	/// Get typed value of property. Throws undefined or bad_any_cast.
+	const T& get() const {
+		const boost::any& value = property_->value();
+		if (value.empty())
+			throw Property::undefined(*name_);
+		return boost::any_cast<const T&>(value);
+	}
+	/// get typed value of property, using fallback if undefined. Throws bad_any_cast on type mismatch.
+	const T& get(const T& fallback) const {
+		const boost::any& value = property_->value();
+		return (value.empty()) ? fallback : boost::any_cast<const T&>(value);
+	}
+};
+
 /** PropertyMap is map of (name, Property) pairs.
  *
  * Conveniency methods are provided to setup property initialization for several
@@ -257,9 +394,24 @@ class PropertyMap
 {
 	std::map<std::string, Property> props_;
 
+	/// stamp identifying the map's content: renewed on each modification, shared by copies
+	uint64_t version_ = 0;
+	/// inputs and result of the last performInitFrom(), allowing to skip an identical re-initialization
+	struct InitStamp
+	{
+		Property::SourceFlags source = 0;
+		uint64_t other = 0;
+		uint64_t result = 0;
+	} last_init_;
+
+	/// renew version_ after (potential) modification
+	void touch();
+
 	/// implementation of declare methods
 	Property& declare(const std::string& name, const Property::type_info& type_info, const std::string& description,
 	                  const boost::any& default_value);
+	/// throw Property::type_error if property isn't declared with given type (or boost::any)
+	static void checkType(const Property& property, const Property::type_info& type_info);
 
 public:
 	/// declare a property for future use
@@ -286,12 +438,32 @@ public:
 
 	/// get the property with given name, throws Property::undeclared for unknown name
 	Property& property(const std::string& name);
-	const Property& property(const std::string& name) const { return const_cast<PropertyMap*>(this)->property(name); }
+	const Property& property(const std::string& name) const;
+
+	/** Version stamp of the map's content
+	 *
+	 * Two maps with the same version have identical content. Any non-const access renews the version.
+	 * Thus modify a property immediately after accessing it, don't keep a Property& for later modification.
+	 */
+	uint64_t version() const { return version_; }
+
+	/// get a typed handle to the property with given name, throws Property::undeclared or Property::type_error
+	template <typename T>
+	PropertyHandle<T> handle(const std::string& name) const {
+		auto it = props_.find(name);
+		if (it == props_.end())
+			throw Property::undeclared(name);
+		checkType(it->second, typeid(T));
+		return PropertyHandle<T>(it->first, it->second);
+	}
 
 	using iterator = std::map<std::string, Property>::iterator;
 	using const_iterator = std::map<std::string, Property>::const_iterator;
 
-	iterator begin() { return props_.begin(); }
+	iterator begin() {
+		touch();
+		return props_.begin();
+	}
 	iterator end() { return props_.end(); }
 	const_iterator begin() const { return props_.begin(); }
 	const_iterator end() const { return props_.end(); }
@@ -305,8 +477,10 @@ public:
 		auto it = props_.find(name);
 		if (it == props_.end())  // name is not yet declared
 			declare<T>(name, value, "");
-		else
+		else {
 			it->second.setValue(value);
+			touch();
+		}
 	}
 
 	/// overloading: const char* is stored as std::string
@@ -339,7 +513,10 @@ public:
 	/// reset all properties to their defaults
 	void reset();
 
-	/// perform initialization of still undefined properties using configured initializers
+	/** perform initialization of still undefined properties using configured initializers
+	 *
+	 * This is skipped if neither this map nor other changed since the last (identical) call.
+	 */
 	void performInitFrom(Property::SourceFlags source, const PropertyMap& other);
 };
 
@@ -0,0 +1,115 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    voxelized reachability map of a link, used to reject out-of-reach IK targets early
+*/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+
+#include <Eigen/Geometry>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(JointModelGroup);
+MOVEIT_CLASS_FORWARD(LinkModel);
+}  // namespace core
+}  // namespace moveit
+
+namespace moveit {
+namespace task_constructor {
+
+MOVEIT_CLASS_FORWARD(ReachabilityMap);
+
+/** Voxelized position reachability of a link, relative to the root link of a group
+ *
+ * Each voxel holds a score in [0, 1]: the normalized number of (randomly sampled) group configurations
+ * placing the link within that voxel. Voxels never reached, as well as positions outside the map, score 0.
+ * As sampling easily misses parts of the workspace, a zero score doesn't prove a position unreachable.
+ * Only positions outside of the map's bounds (enlarged by a voxel) are considered unreachable, see contains().
+ * Maps are generated offline by forward kinematics, saved to a file, and memory-mapped when loaded.
+ */
+class ReachabilityMap
+{
+public:
+	/// sample num_samples random configurations of jmg, voxelizing the positions of link
+	static ReachabilityMapPtr generate(const moveit::core::JointModelGroup* jmg, const moveit::core::LinkModel* link,
+	                                   double resolution = 0.05, size_t num_samples = 1000000,
+	                                   unsigned int seed = 0);
+	/// memory-map a file written by save(), throws std::runtime_error on failure
+	static ReachabilityMapPtr load(const std::string& path);
+	/// throws std::runtime_error on failure
+	void save(const std::string& path) const;
+
+	~ReachabilityMap();
+	ReachabilityMap(const ReachabilityMap&) = delete;
+	ReachabilityMap& operator=(const ReachabilityMap&) = delete;
+
+	/// link of jmg the map was generated for, which positions are expressed relative to
+	static const moveit::core::LinkModel* rootLink(const moveit::core::JointModelGroup* jmg);
+
+	const std::string& group() const { return group_; }
+	const std::string& link() const { return link_; }
+	bool matches(const moveit::core::JointModelGroup* jmg, const moveit::core::LinkModel* link) const;
+
+	/// score of a position given w.r.t. rootLink() in O(1)
+	double score(const Eigen::Vector3d& position) const;
+	/// whether a position given w.r.t. rootLink() lies within the bounds of all samples, enlarged by a voxel
+	bool contains(const Eigen::Vector3d& position) const;
+
+	double resolution() const { return resolution_; }
+	size_t size() const { return static_cast<size_t>(dims_[0]) * dims_[1] * dims_[2]; }
+
+private:
+	ReachabilityMap() = default;
+
+	std::string group_;
+	std::string link_;
+	Eigen::Vector3d origin_ = Eigen::Vector3d::Zero();  // center of voxel (0, 0, 0)
+	double resolution_ = 0.0;
+	std::array<uint32_t, 3> dims_{ { 0, 0, 0 } };
+	const uint8_t* cells_ = nullptr;  // scores scaled to [0, 255], x varying fastest
+
+	std::vector<uint8_t> owned_;  // storage of generated maps
+	void* mapping_ = nullptr;  // memory-mapped file of loaded maps
+	size_t mapping_size_ = 0;
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,157 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Record and deterministically replay planning runs
+*/
+
+#pragma once
+
+#include <moveit_task_constructor_msgs/PlanningRecord.h>
+#include <moveit/macros/class_forward.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace planning_scene {
+MOVEIT_CLASS_FORWARD(PlanningScene);
+}
+namespace robot_trajectory {
+MOVEIT_CLASS_FORWARD(RobotTrajectory);
+}
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(RobotModel);
+MOVEIT_CLASS_FORWARD(JointModelGroup);
+}  // namespace core
+}  // namespace moveit
+
+namespace moveit {
+namespace task_constructor {
+
+class Task;
+MOVEIT_CLASS_FORWARD(PlanningRecord);
+
+/** Recording of a planning run, which can be replayed deterministically to reproduce it
+ *
+ * A recording captures the seed of std::rand(), the scenes fetched by stages (e.g. CurrentState),
+ * all stage properties, and the responses of all planner calls.
+ * Replaying reseeds std::rand(), and serves the recorded scenes and planner responses
+ * instead of querying move_group or calling the planners.
+ * Responses are replayed in call order per (group, planner id), such that replay of sequential planning
+ * (a single thread with RECURSIVE scheduling) is deterministic.
+ *
+ * A record is activated per thread, see Activation. Threads spawned via TaskExecutor::spawn() inherit
+ * the record of their spawning thread, such that parallel planning of a task is recorded too,
+ * while concurrently planned tasks record independently.
+ */
+class PlanningRecord
+{
+public:
+	enum Mode
+	{
+		RECORD,
+		REPLAY
+	};
+
+	/// RAII helper activating a record (may be nullptr) for the current scope of the calling thread
+	class Activation
+	{
+	public:
+		explicit Activation(PlanningRecord* record);
+		~Activation();
+		Activation(const Activation&) = delete;
+		Activation& operator=(const Activation&) = delete;
+
+	private:
+		PlanningRecord* previous_;
+	};
+
+	/// start a new recording, using the given seed for std::rand()
+	explicit PlanningRecord(uint32_t seed);
+	/// replay the given recording
+	explicit PlanningRecord(moveit_task_constructor_msgs::PlanningRecord msg);
+
+	/// record active in the calling thread (nullptr if none)
+	static PlanningRecord* active();
+
+	Mode mode() const { return mode_; }
+	uint32_t seed() const { return msg_.seed; }
+	const moveit_task_constructor_msgs::PlanningRecord& msg() const { return msg_; }
+
+	/// rewind replay to the first planner response
+	void rewind();
+
+	/// record the scene fetched by the named stage
+	void recordScene(const std::string& stage, const planning_scene::PlanningScene& scene);
+	/// recorded scene of the named stage (nullptr if there is none)
+	planning_scene::PlanningScenePtr replayScene(const std::string& stage,
+	                                             const moveit::core::RobotModelConstPtr& robot_model) const;
+
+	/// record properties of all stages of the task
+	void recordProperties(const Task& task);
+	/// warn about properties differing from the recorded ones, returning the number of differences
+	size_t checkProperties(const Task& task) const;
+
+	/// record the response of a planner call
+	void recordResponse(const std::string& planner_id, const moveit::core::JointModelGroup* jmg, bool success,
+	                    const robot_trajectory::RobotTrajectoryConstPtr& trajectory);
+	/** fetch the next recorded response of the given (group, planner id) pair
+	 *
+	 * The trajectory is restored starting from the state of scene from.
+	 * Returns false if there are no recorded responses left.
+	 */
+	bool replayResponse(const std::string& planner_id, const planning_scene::PlanningSceneConstPtr& from,
+	                    const moveit::core::JointModelGroup* jmg, bool& success,
+	                    robot_trajectory::RobotTrajectoryPtr& trajectory);
+	/// number of recorded responses not yet replayed
+	size_t pendingResponses() const;
+
+	/// write record to file in a compact binary format
+	bool save(const std::string& file) const;
+	/// load record for replaying from file (nullptr on failure)
+	static PlanningRecordPtr load(const std::string& file);
+
+private:
+	using ResponseKey = std::pair<std::string, std::string>;  // (group, planner id)
+
+	Mode mode_;
+	mutable std::mutex mutex_;
+	moveit_task_constructor_msgs::PlanningRecord msg_;
+	std::map<ResponseKey, std::deque<size_t>> pending_;  // indices of responses to replay
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,69 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    process-wide cache of robot models loaded from the parameter server
+*/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+
+#include <cstddef>
+#include <string>
+
+namespace robot_model_loader {
+MOVEIT_CLASS_FORWARD(RobotModelLoader);
+}
+
+namespace moveit {
+namespace task_constructor {
+
+/** Process-wide cache of RobotModelLoaders, shared by all Tasks and TaskBatches
+ *
+ * Parsing URDF and SRDF and loading the kinematics plugins might take seconds.
+ * Thus loaders (owning the model and its kinematics solvers) are cached per parameter name.
+ * A cached loader is reused as long as the hash of the URDF and SRDF strings on the parameter server didn't change.
+ */
+class RobotModelCache
+{
+public:
+	/// (cached) loader for given parameter, throws if the model cannot be loaded
+	static robot_model_loader::RobotModelLoaderPtr load(const std::string& robot_description = "robot_description");
+	/// drop all cached loaders (loaders still in use are kept alive by their users)
+	static void clear();
+	/// number of cached loaders
+	static size_t size();
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,87 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    thread-local pool of scratch RobotStates
+*/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+
+#include <cstddef>
+#include <memory>
+
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(RobotModel);
+MOVEIT_CLASS_FORWARD(RobotState);
+}  // namespace core
+
+namespace task_constructor {
+
+/** RobotState for temporary use within a computation, recycled via a pool of the calling thread
+ *
+ * Stages and solvers frequently need a scratch copy of a state, e.g. for collision checking or as an IK seed.
+ * Instead of allocating a new RobotState each time, a ScratchState leases one from a thread-local pool
+ * and returns it on destruction. In steady state, leasing a state of the same robot model doesn't allocate.
+ * Don't keep references to the state beyond the lifetime of its ScratchState.
+ *
+ * Idle states keep their robot model alive. Hence, owners of a robot model should call purge()
+ * before releasing it, e.g. to unload the model's plugins afterwards.
+ */
+class ScratchState
+{
+public:
+	/// lease a state of the given robot model, with unspecified variable values
+	explicit ScratchState(const moveit::core::RobotModelConstPtr& robot_model);
+	/// lease a copy of the given state
+	explicit ScratchState(const moveit::core::RobotState& state);
+	ScratchState(ScratchState&& other) noexcept = default;
+	ScratchState(const ScratchState&) = delete;
+	ScratchState& operator=(const ScratchState&) = delete;
+	~ScratchState();
+
+	moveit::core::RobotState& operator*() const { return *state_; }
+	moveit::core::RobotState* operator->() const { return state_.get(); }
+
+	/// number of idle states pooled by the calling thread
+	static size_t pooled();
+	/// drop idle states of the given robot model from the pools of all threads
+	static void purge(const moveit::core::RobotModel* robot_model);
+
+private:
+	std::unique_ptr<moveit::core::RobotState> state_;
+};
+}  // namespace task_constructor
+}  // namespace moveit
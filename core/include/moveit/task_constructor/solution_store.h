@@ -0,0 +1,155 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Persistent, memory-mapped store of task solutions
+*/
+
+#pragma once
+
+#include <moveit_task_constructor_msgs/Solution.h>
+#include <sensor_msgs/JointState.h>
+#include <moveit/macros/class_forward.h>
+
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+class Task;
+MOVEIT_CLASS_FORWARD(SolutionStore);
+
+/** Read-only, memory-mapped file of solutions, e.g. to execute them or to use them as a plan cache
+ *
+ * Layout (native byte order): 8 byte magic, uint64 numbers of blobs, solutions, and sub trajectories,
+ * a blob table (uint64 offset and size per blob), a solution table (64 byte zero-terminated task name,
+ * double cost, uint64 blob indices of the solution msg and of its start state's joint names and positions,
+ * uint64 index and number of its sub trajectories), a sub trajectory table (uint32 blob indices of the scene diff
+ * and of the creator's stage name), followed by the 8-byte aligned blob data.
+ * Solution msgs are stored without scene diffs, which are deduplicated across all solutions.
+ * Solutions are deserialized from the mapped file on demand only.
+ */
+class SolutionStore
+{
+	struct Blob;
+	struct SolutionRecord;
+	struct SubRecord;
+
+public:
+	/// a stored solution, referring to the mapped file
+	class Entry
+	{
+	public:
+		const std::string& taskName() const;
+		double cost() const;
+		/// Euclidean distance of the start state to the given joint positions (across common joints)
+		double distance(const sensor_msgs::JointState& state) const;
+		/// names of the stages that created the sub trajectories
+		std::vector<std::string> stages() const;
+		/// deserialize the solution msg, restoring its scene diffs
+		void toMsg(moveit_task_constructor_msgs::Solution& msg) const;
+
+	private:
+		friend class SolutionStore;
+		Entry(const SolutionStore* store, size_t index) : store_(store), index_(index) {}
+
+		const SolutionStore* store_;
+		size_t index_;
+	};
+
+	struct Query
+	{
+		std::string task_name;  ///< only consider solutions of this task (all if empty)
+		const sensor_msgs::JointState* start = nullptr;  ///< reference start state for max_distance
+		double max_distance = std::numeric_limits<double>::infinity();
+		double max_cost = std::numeric_limits<double>::infinity();
+		size_t limit = 0;  ///< max number of results (0: unlimited)
+	};
+
+	/// collect solutions to write a store file
+	class Writer
+	{
+	public:
+		/// add solution msg of task, with the creator's stage name of each sub trajectory (if known)
+		void add(const std::string& task_name, const moveit_task_constructor_msgs::Solution& msg, double cost,
+		         const std::vector<std::string>& stages = {});
+		/// add (up to max_solutions) best solutions of task
+		void add(const Task& task, size_t max_solutions = 0);
+		size_t size() const { return solutions_.size(); }
+		bool write(const std::string& file) const;
+
+	private:
+		uint32_t blob(std::string bytes);
+
+		std::vector<std::string> blobs_;
+		std::map<std::string, uint32_t> blob_index_;  // deduplicate blobs by content
+		struct Solution
+		{
+			std::string task_name;
+			double cost;
+			uint32_t solution, joint_names, joint_positions;
+			std::vector<std::pair<uint32_t, uint32_t>> subs;  // scene diff and stage name blobs
+		};
+		std::vector<Solution> solutions_;
+	};
+
+	SolutionStore() = default;
+	~SolutionStore();
+	SolutionStore(const SolutionStore&) = delete;
+	SolutionStore& operator=(const SolutionStore&) = delete;
+
+	/// map file (without copying), validating its layout
+	bool open(const std::string& file);
+	void close();
+
+	size_t size() const { return num_solutions_; }
+	Entry operator[](size_t index) const { return Entry(this, index); }
+	/// solutions matching the query, sorted by increasing cost
+	std::vector<Entry> query(const Query& query) const;
+
+private:
+	const char* blobData(size_t index, size_t& size) const;
+
+	void* data_ = nullptr;
+	size_t size_ = 0;
+	size_t num_solutions_ = 0;
+	const Blob* blobs_ = nullptr;
+	const SolutionRecord* solutions_ = nullptr;
+	const SubRecord* subs_ = nullptr;
+	std::vector<std::string> task_names_;  // per solution, decoded on open()
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,109 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Thread-safe queue streaming solutions from planning to a consumer
+*/
+
+#pragma once
+
+#include <moveit/task_constructor/storage.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+
+namespace moveit {
+namespace task_constructor {
+
+MOVEIT_CLASS_FORWARD(SolutionStream);
+
+/** Pull-based stream of solutions, filled by a (planning) producer thread.
+ *
+ * Consumers call next() to retrieve the solutions in the order they were found.
+ * Once the producer closed the stream, next() returns false after all pending solutions were consumed.
+ */
+class SolutionStream
+{
+public:
+	/// append a new solution and wake up a waiting consumer
+	void push(const SolutionBaseConstPtr& solution) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (closed_)
+				return;
+			queue_.push_back(solution);
+		}
+		cv_.notify_one();
+	}
+	/// signal that no more solutions will arrive
+	void close() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			closed_ = true;
+		}
+		cv_.notify_all();
+	}
+	bool closed() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return closed_;
+	}
+
+	/** retrieve the next solution, waiting at most timeout seconds
+	 *
+	 * Returns false if no solution became available in time or if the stream was closed.
+	 */
+	bool next(SolutionBaseConstPtr& solution, double timeout = std::numeric_limits<double>::infinity()) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		auto ready = [this]() { return !queue_.empty() || closed_; };
+		if (timeout == std::numeric_limits<double>::infinity())
+			cv_.wait(lock, ready);
+		else if (!cv_.wait_for(lock, std::chrono::duration<double>(timeout), ready))
+			return false;
+		if (queue_.empty())
+			return false;  // closed
+		solution = std::move(queue_.front());
+		queue_.pop_front();
+		return true;
+	}
+
+private:
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<SolutionBaseConstPtr> queue_;
+	bool closed_ = false;
+};
+}  // namespace task_constructor
+}  // namespace moveit
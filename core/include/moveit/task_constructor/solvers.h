@@ -38,6 +38,8 @@
 
 #pragma once
 
+#include "solvers/caching_planner.h"
 #include "solvers/cartesian_path.h"
+#include "solvers/experience_planner.h"
 #include "solvers/joint_interpolation.h"
 #include "solvers/pipeline_planner.h"
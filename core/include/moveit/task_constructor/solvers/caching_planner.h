@@ -0,0 +1,118 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    cache trajectories of another planner, keyed by start, goal, and scene
+*/
+
+#pragma once
+
+#include <moveit/task_constructor/solvers/planner_interface.h>
+#include <moveit/macros/class_forward.h>
+#include <moveit_msgs/RobotTrajectory.h>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+MOVEIT_CLASS_FORWARD(CachingPlanner);
+
+/** Reuse trajectories of a wrapped planner for repeated planning requests
+ *
+ * Requests are keyed by the group, the quantized start (and goal) joint positions or Cartesian target,
+ * the path constraints, and a fingerprint of the collision objects in the start scene.
+ * Cached trajectories are re-validated (collisions and path constraints at all waypoints) before reuse.
+ * The cache can be saved to / loaded from disk to survive restarts.
+ */
+class CachingPlanner : public PlannerInterface
+{
+public:
+	CachingPlanner(const PlannerInterfacePtr& planner);
+
+	const PlannerInterfacePtr& planner() const { return planner_; }
+
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	bool validatesLazily() const override { return planner_->validatesLazily(); }
+	/// defer if either this wrapper (e.g. for repaired paths) or the wrapped planner defers
+	bool defersTimeParameterization() const override {
+		return PlannerInterface::defersTimeParameterization() || planner_->defersTimeParameterization();
+	}
+	bool timeParameterize(robot_trajectory::RobotTrajectory& trajectory) const override {
+		return planner_->timeParameterize(trajectory);
+	}
+
+	bool plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
+	          const core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	          const PreemptionToken* preempt = nullptr) override;
+
+	bool plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	          const Eigen::Isometry3d& target, const core::JointModelGroup* jmg, double timeout,
+	          robot_trajectory::RobotTrajectoryPtr& result,
+	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	          const PreemptionToken* preempt = nullptr) override;
+
+	std::size_t size() const;
+	void clear();
+	std::size_t hits() const { return hits_; }
+	std::size_t misses() const { return misses_; }
+
+	/// write all entries to file
+	bool save(const std::string& file) const;
+	/// add entries from file (written by save())
+	bool load(const std::string& file);
+
+private:
+	std::string startKey(const planning_scene::PlanningSceneConstPtr& from, const core::JointModelGroup* jmg,
+	                     const moveit_msgs::Constraints& path_constraints) const;
+	bool lookup(const std::string& key, const planning_scene::PlanningSceneConstPtr& from,
+	            const core::JointModelGroup* jmg, const moveit_msgs::Constraints& path_constraints,
+	            robot_trajectory::RobotTrajectoryPtr& result);
+	void store(const std::string& key, const robot_trajectory::RobotTrajectory& trajectory);
+
+	PlannerInterfacePtr planner_;
+
+	mutable std::mutex mutex_;
+	std::list<std::string> order_;  // insertion order of keys, for eviction
+	std::unordered_map<std::string, moveit_msgs::RobotTrajectory> entries_;
+	std::atomic<std::size_t> hits_{ 0 };
+	std::atomic<std::size_t> misses_{ 0 };
+};
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
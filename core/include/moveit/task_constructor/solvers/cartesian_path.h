@@ -39,6 +39,7 @@
 #pragma once
 
 #include <moveit/task_constructor/solvers/planner_interface.h>
+#include <eigen_stl_containers/eigen_stl_containers.h>
 
 namespace moveit {
 namespace task_constructor {
@@ -55,20 +56,46 @@ public:
 	void setStepSize(double step_size) { setProperty("step_size", step_size); }
 	void setJumpThreshold(double jump_threshold) { setProperty("jump_threshold", jump_threshold); }
 	void setMinFraction(double min_fraction) { setProperty("min_fraction", min_fraction); }
+	/** first interpolate with step_size * factor (checking each segment at about factor substeps, or continuously),
+	 * refining the remainder with step_size where the coarse pass got stuck */
+	void setCoarseStepFactor(double factor) { setProperty("coarse_step_factor", factor); }
 
 	void setMaxVelocityScaling(double factor) { setProperty("max_velocity_scaling_factor", factor); }
 	void setMaxAccelerationScaling(double factor) { setProperty("max_acceleration_scaling_factor", factor); }
 
+	/// only check path constraints while planning, postponing collision checking (see validatesLazily())
+	void setLazyValidation(bool lazy) { setProperty("lazy_validation", lazy); }
+
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	bool validatesLazily() const override;
 
 	bool plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
 	          const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
-	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	          const PreemptionToken* preempt = nullptr) override;
 
 	bool plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
 	          const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg, double timeout,
 	          robot_trajectory::RobotTrajectoryPtr& result,
-	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	          const PreemptionToken* preempt = nullptr) override;
+
+	/// policy to pick a path among several candidate targets
+	enum CandidatePolicy
+	{
+		FIRST_FEASIBLE,  // first feasible candidate (in order of targets), skipping unstarted later ones
+		SHORTEST_PATH,  // feasible candidate with shortest joint-space path
+	};
+	/** plan Cartesian paths to several candidate targets (e.g. approach directions) in parallel
+	 *
+	 * Candidates are distributed over the num_threads property. Returns the index of the chosen target
+	 * or -1 if none is feasible.
+	 */
+	int planCandidates(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	                   const EigenSTL::vector_Isometry3d& targets, const moveit::core::JointModelGroup* jmg,
+	                   double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	                   const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	                   CandidatePolicy policy = FIRST_FEASIBLE, const PreemptionToken* preempt = nullptr);
 };
 }  // namespace solvers
 }  // namespace task_constructor
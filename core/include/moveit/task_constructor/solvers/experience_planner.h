@@ -0,0 +1,119 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    repair stored trajectories of similar queries before falling back to a planner
+*/
+
+#pragma once
+
+#include <moveit/task_constructor/solvers/planner_interface.h>
+#include <moveit/macros/class_forward.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+MOVEIT_CLASS_FORWARD(ExperiencePlanner);
+
+/** Experience-based planning on top of another planner
+ *
+ * Successful trajectories of the wrapped planner are stored as joint-space paths.
+ * For a new joint-space query, the nearest stored paths (in start and goal positions, considering
+ * both directions) are deformed to the new start and goal (if neither moves by more than max_deformation
+ * in any joint), and the first one that is valid (including joint limits)
+ * along its whole length (sampled at max_step) is returned. Only if all repairs fail,
+ * the wrapped planner is called. Cartesian queries are always forwarded, but their results are stored.
+ */
+class ExperiencePlanner : public PlannerInterface
+{
+public:
+	ExperiencePlanner(const PlannerInterfacePtr& planner);
+
+	const PlannerInterfacePtr& planner() const { return planner_; }
+
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	bool validatesLazily() const override { return planner_->validatesLazily(); }
+	/// defer if either this wrapper (e.g. for repaired paths) or the wrapped planner defers
+	bool defersTimeParameterization() const override {
+		return PlannerInterface::defersTimeParameterization() || planner_->defersTimeParameterization();
+	}
+	bool timeParameterize(robot_trajectory::RobotTrajectory& trajectory) const override {
+		return planner_->timeParameterize(trajectory);
+	}
+
+	bool plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
+	          const core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	          const PreemptionToken* preempt = nullptr) override;
+
+	bool plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	          const Eigen::Isometry3d& target, const core::JointModelGroup* jmg, double timeout,
+	          robot_trajectory::RobotTrajectoryPtr& result,
+	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	          const PreemptionToken* preempt = nullptr) override;
+
+	std::size_t size() const;
+	void clear();
+	/// number of queries answered by a repaired experience
+	std::size_t repairs() const { return repairs_; }
+
+private:
+	using Path = std::vector<std::vector<double>>;  // joint positions of a group
+	struct Experience
+	{
+		std::vector<double> start;
+		std::vector<double> goal;
+		Path path;
+	};
+
+	/// collect the num_neighbors nearest paths from start to goal (reversing stored paths if needed)
+	std::vector<Path> nearest(const std::string& group, const std::vector<double>& start,
+	                          const std::vector<double>& goal) const;
+	void record(const robot_trajectory::RobotTrajectory& trajectory);
+
+	PlannerInterfacePtr planner_;
+
+	mutable std::mutex mutex_;
+	std::map<std::string, std::deque<Experience>> experiences_;  // per group
+	std::atomic<std::size_t> repairs_{ 0 };
+};
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
@@ -56,16 +56,22 @@ class JointInterpolationPlanner : public PlannerInterface
 public:
 	JointInterpolationPlanner();
 
+	/// only check the goal state while planning, postponing collision checking (see validatesLazily())
+	void setLazyValidation(bool lazy) { setProperty("lazy_validation", lazy); }
+
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	bool validatesLazily() const override;
 
 	bool plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
 	          const core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
-	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	          const PreemptionToken* preempt = nullptr) override;
 
 	bool plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
 	          const Eigen::Isometry3d& target, const core::JointModelGroup* jmg, double timeout,
 	          robot_trajectory::RobotTrajectoryPtr& result,
-	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	          const PreemptionToken* preempt = nullptr) override;
 };
 }  // namespace solvers
 }  // namespace task_constructor
@@ -40,6 +40,7 @@
 
 #include <moveit/task_constructor/solvers/planner_interface.h>
 #include <moveit/macros/class_forward.h>
+#include <moveit_msgs/MotionPlanRequest.h>
 
 namespace planning_pipeline {
 MOVEIT_CLASS_FORWARD(PlanningPipeline);
@@ -50,6 +51,7 @@ namespace task_constructor {
 namespace solvers {
 
 MOVEIT_CLASS_FORWARD(PipelinePlanner);
+class PipelineInstances;
 
 /** Use MoveIt's PlanningPipeline to plan a trajectory between to scenes */
 class PipelinePlanner : public PlannerInterface
@@ -61,6 +63,8 @@ public:
 		std::string ns{ "move_group" };
 		std::string pipeline{ "ompl" };
 		std::string adapter_param{ "request_adapters" };
+		/// distinct instance of the same pipeline (to be used by another thread)
+		std::size_t instance{ 0 };
 	};
 
 	static planning_pipeline::PlanningPipelinePtr create(const moveit::core::RobotModelConstPtr& model) {
@@ -76,21 +80,86 @@ public:
 	PipelinePlanner(const planning_pipeline::PlanningPipelinePtr& planning_pipeline);
 
 	void setPlannerId(const std::string& planner) { setProperty("planner", planner); }
+	/** number of pipeline instances to use for concurrent plan() calls
+	 *
+	 * Many planning plugins are not reentrant: each call checks out an instance for exclusive use
+	 * (waiting for a free one if needed). All instances are created in init(). With a single instance (default),
+	 * concurrent calls are serialized - just like calls of other PipelinePlanners sharing the same (cached) instance.
+	 */
+	void setNumInstances(size_t num) { setProperty("num_instances", num); }
+
+	/// policy to pick the result when racing several planners
+	enum RacePolicy
+	{
+		FIRST_SUCCESS,  // return the first successful result
+		SHORTEST_PATH,  // return the result with shortest joint-space path within the timeout
+	};
+	/** race given planners (in addition to "planner") in parallel threads
+	 *
+	 * Each planner plans on its own diff of the start scene and its own pipeline instance:
+	 * init() creates at least one instance per raced planner, while a custom pipeline serializes them.
+	 * Once a result was picked, planners still running are terminated in the background (see plan())
+	 * and planners still waiting for an instance are skipped.
+	 */
+	void setRacePlanners(const std::vector<std::string>& planners) { setProperty("race_planners", planners); }
+	void setRacePolicy(RacePolicy policy) { setProperty("race_policy", policy); }
+	/** plan within a multi-query session, reusing the planner's state while the scene is unchanged
+	 *
+	 * Requires a planner configured for multi-query planning, e.g. OMPL's PRM or LazyPRM
+	 * with multi_query_planning_enabled, whose roadmap then grows across consecutive calls, e.g. of Connect.
+	 * The session uses a dedicated pipeline instance, serializing its plan() calls, and resets the planner
+	 * once sceneFingerprint() changes. Not supported for custom pipelines.
+	 */
+	void setMultiQuery(bool enable) { setProperty("multi_query", enable); }
+	/** fingerprint of everything a roadmap of jmg validated in scene depends on
+	 *
+	 * Comprises the collision objects (identity and poses), the attached bodies,
+	 * the positions of all joints not part of jmg, and the allowed collision matrix.
+	 */
+	static std::string sceneFingerprint(const planning_scene::PlanningScene& scene,
+	                                    const moveit::core::JointModelGroup* jmg);
 
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
 
+	/** plan using the pipeline, terminating it when preemption is requested
+	 *
+	 * The token is polled by a helper thread, which calls PlanningPipeline::terminate().
+	 * Only planner plugins supporting termination (e.g. OMPL) stop early, others finish regularly
+	 * with their result discarded.
+	 */
 	bool plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
 	          const core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
-	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	          const PreemptionToken* preempt = nullptr) override;
 
 	bool plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
 	          const Eigen::Isometry3d& target, const core::JointModelGroup* jmg, double timeout,
 	          robot_trajectory::RobotTrajectoryPtr& result,
-	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	          const PreemptionToken* preempt = nullptr) override;
+
+	/// run each request on a dedicated thread: pipeline calls are long-running and would block the shared pool
+	AsyncPlan planAsync(const planning_scene::PlanningSceneConstPtr& from,
+	                    const planning_scene::PlanningSceneConstPtr& to, const moveit::core::JointModelGroup* jmg,
+	                    double timeout,
+	                    const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+	AsyncPlan planAsync(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	                    const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg, double timeout,
+	                    const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
 
 protected:
+	/// planner id used to key call statistics: pipeline[/planner]
+	std::string plannerId() const;
+	/// plan req using the multi-query session, racing planners, or the next free pipeline instance
+	bool solve(const planning_scene::PlanningSceneConstPtr& from, const moveit_msgs::MotionPlanRequest& req,
+	           robot_trajectory::RobotTrajectoryPtr& result, const PreemptionToken* preempt = nullptr);
+
 	std::string pipeline_name_;
 	planning_pipeline::PlanningPipelinePtr planner_;
+	bool custom_ = false;  // planner_ was passed to the constructor
+	std::shared_ptr<PipelineInstances> instances_;  // planner_ and additional instances
+	struct Session;
+	std::shared_ptr<Session> session_;  // multi-query session, if enabled
 };
 }  // namespace solvers
 }  // namespace task_constructor
@@ -41,7 +41,15 @@
 #include <moveit/macros/class_forward.h>
 #include <moveit_msgs/Constraints.h>
 #include <moveit/task_constructor/properties.h>
+#include <moveit/task_constructor/preemption.h>
+#include <moveit/task_constructor/histogram.h>
 #include <Eigen/Geometry>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
 
 namespace planning_scene {
 MOVEIT_CLASS_FORWARD(PlanningScene);
@@ -68,6 +76,46 @@ class PlannerInterface
 	PropertyMap properties_;
 
 public:
+	/// statistics of plan() calls for a (group, planner id) pair
+	struct CallStatistics
+	{
+		std::size_t calls = 0;
+		std::size_t successes = 0;
+		std::size_t waypoints = 0;  // total number of waypoints of successful results
+		LatencyHistogram planning_time;
+	};
+	using StatisticsKey = std::pair<std::string, std::string>;  // (group, planner id)
+	using Statistics = std::map<StatisticsKey, CallStatistics>;
+
+	/// outcome of an asynchronous plan() call
+	struct PlanResult
+	{
+		bool success = false;
+		robot_trajectory::RobotTrajectoryPtr trajectory;
+	};
+	/// handle of an asynchronous plan() call
+	class AsyncPlan
+	{
+	public:
+		AsyncPlan() = default;
+		AsyncPlan(std::shared_future<PlanResult> future, std::shared_ptr<PreemptionToken> token)
+		  : future_(std::move(future)), token_(std::move(token)) {}
+
+		bool valid() const { return future_.valid(); }
+		const std::shared_future<PlanResult>& future() const { return future_; }
+		/// block until planning finished
+		const PlanResult& get() const { return future_.get(); }
+		/// request the planner to stop early (failing), if the planner supports preemption
+		void cancel() {
+			if (token_)
+				token_->request();
+		}
+
+	private:
+		std::shared_future<PlanResult> future_;
+		std::shared_ptr<PreemptionToken> token_;
+	};
+
 	PlannerInterface();
 	virtual ~PlannerInterface() {}
 
@@ -78,17 +126,106 @@ public:
 
 	virtual void init(const moveit::core::RobotModelConstPtr& robot_model) = 0;
 
-	/// plan trajectory between to robot states
+	/** plan trajectory between to robot states
+	 *
+	 * If a preemption token is provided, planners should poll it and return early (failing) when requested.
+	 */
 	virtual bool plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
 	                  const moveit::core::JointModelGroup* jmg, double timeout,
 	                  robot_trajectory::RobotTrajectoryPtr& result,
-	                  const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) = 0;
+	                  const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	                  const PreemptionToken* preempt = nullptr) = 0;
 
 	/// plan trajectory from current robot state to Cartesian target
 	virtual bool plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
 	                  const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg, double timeout,
 	                  robot_trajectory::RobotTrajectoryPtr& result,
-	                  const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) = 0;
+	                  const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	                  const PreemptionToken* preempt = nullptr) = 0;
+
+	/** plan asynchronously, calling plan() on a process-wide thread pool
+	 *
+	 * The scenes are shared with the planning thread and must not be modified anymore.
+	 * The planner needs to outlive the returned future.
+	 */
+	virtual AsyncPlan planAsync(const planning_scene::PlanningSceneConstPtr& from,
+	                            const planning_scene::PlanningSceneConstPtr& to,
+	                            const moveit::core::JointModelGroup* jmg, double timeout,
+	                            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints());
+	virtual AsyncPlan planAsync(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	                            const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg,
+	                            double timeout,
+	                            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints());
+
+	/** whether plan() skips collision checking of intermediate waypoints (lazy validation)
+	 *
+	 * Stages mark trajectories of such planners as VALIDATION_PENDING, leaving validation to the Task.
+	 */
+	virtual bool validatesLazily() const { return false; }
+
+	/** leave full time parameterization of planned trajectories to timeParameterize(), only estimating their timing
+	 *
+	 * Stages defer the parameterization of such trajectories until their solution is published or executed.
+	 * Meanwhile, solutions are ranked by the cheap estimate of utils::estimateTimeStamps().
+	 */
+	void setDeferTimeParameterization(bool defer) { setProperty("defer_time_parameterization", defer); }
+	virtual bool defersTimeParameterization() const;
+	/// apply the time_parameterization algorithm and scaling factors of this planner to trajectory
+	virtual bool timeParameterize(robot_trajectory::RobotTrajectory& trajectory) const;
+	/// timeParameterize() bound to the planner if it defers time parameterization, otherwise an empty function
+	static std::function<bool(robot_trajectory::RobotTrajectory&)>
+	deferredTimeParameterization(const PlannerInterfacePtr& planner);
+
+	/// snapshot of call statistics, accumulated over all plan() calls
+	Statistics statistics() const;
+	void resetStatistics();
+
+protected:
+	/// job receiving the preemption token of the AsyncPlan handle
+	using PlanJob = std::function<PlanResult(const PreemptionToken*)>;
+	/// run job on given executor (by default the pool of the process-wide TaskExecutor), returning a handle
+	static AsyncPlan launch(PlanJob job, const std::function<void(std::function<void()>)>& executor = nullptr);
+	/// time-parameterize a planned trajectory, or only estimate its timing if parameterization is deferred
+	bool addTiming(robot_trajectory::RobotTrajectory& trajectory) const;
+
+	/** RAII helper to record a plan() call on destruction
+	 *
+	 * Nested plan() calls (e.g. an overload forwarding to another one) are recorded once only.
+	 * This includes jobs launch()ed from within a plan() call, although they run on another thread.
+	 * Successful calls need to return via finish(true).
+	 * If a PlanningRecord is active, the call's response is recorded as well.
+	 */
+	class CallRecorder
+	{
+	public:
+		CallRecorder(PlannerInterface& planner, const moveit::core::JointModelGroup* jmg, std::string planner_id,
+		             robot_trajectory::RobotTrajectoryPtr& result);
+		~CallRecorder();
+		CallRecorder(const CallRecorder&) = delete;
+		CallRecorder& operator=(const CallRecorder&) = delete;
+
+		bool finish(bool success) {
+			success_ = success;
+			return success;
+		}
+		/** fetch result and success from the replayed PlanningRecord (if any), instead of actually planning
+		 *
+		 * Returns true if the call was replayed. The planner should return finish(success) then.
+		 */
+		bool replay(const planning_scene::PlanningSceneConstPtr& from, bool& success);
+
+	private:
+		PlannerInterface* planner_;  // nullptr if nested
+		const moveit::core::JointModelGroup* jmg_;
+		std::string planner_id_;
+		robot_trajectory::RobotTrajectoryPtr& result_;
+		std::chrono::steady_clock::time_point start_;
+		bool success_ = false;
+	};
+
+private:
+	mutable std::mutex statistics_mutex_;
+	Statistics statistics_;
 };
 }  // namespace solvers
 }  // namespace task_constructor
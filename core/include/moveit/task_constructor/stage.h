@@ -42,8 +42,16 @@
 #include "utils.h"
 #include <moveit/macros/class_forward.h>
 #include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/histogram.h>
+#include <algorithm>
+#include <limits>
+#include <chrono>
+#include <functional>
+#include <future>
 #include <vector>
 #include <list>
+#include <map>
+#include <mutex>
 
 #define PRIVATE_CLASS(Class)                   \
 	friend class Class##Private;                \
@@ -108,6 +116,11 @@ constexpr InterfaceFlags UNKNOWN;
 constexpr InterfaceFlags START_IF_MASK({ READS_START, WRITES_PREV_END });
 constexpr InterfaceFlags END_IF_MASK({ READS_END, WRITES_NEXT_START });
 
+namespace solvers {
+MOVEIT_CLASS_FORWARD(PlannerInterface);
+}
+class WarmStartCache;
+
 MOVEIT_CLASS_FORWARD(Interface);
 MOVEIT_CLASS_FORWARD(Stage);
 class InterfaceState;
@@ -140,8 +153,137 @@ std::ostream& operator<<(std::ostream& os, const InitStageException& e);
 
 MOVEIT_CLASS_FORWARD(CostTerm);
 class LambdaCostTerm;
+class PreemptionToken;
 class ContainerBase;
 class StagePrivate;
+
+/// estimated memory [bytes] allocated for objects created by a stage, see Stage::memoryUsage()
+struct MemoryUsage
+{
+	size_t states = 0;  ///< InterfaceState objects
+	size_t scenes = 0;  ///< PlanningScene (diffs) of new states
+	size_t trajectories = 0;  ///< waypoints of SubTrajectories
+	size_t markers = 0;  ///< visualization markers of solutions (deferred ones once generated)
+
+	size_t total() const { return states + scenes + trajectories + markers; }
+};
+
+/// summary of solutions dropped from a bounded (top-K) solution set, see Stage::setMaxStoredSolutions()
+struct EvictedSolutions
+{
+	size_t count = 0;
+	double min_cost = std::numeric_limits<double>::infinity();
+	double max_cost = -std::numeric_limits<double>::infinity();
+	double sum_cost = 0.0;
+
+	void add(double cost) {
+		++count;
+		min_cost = std::min(min_cost, cost);
+		max_cost = std::max(max_cost, cost);
+		sum_cost += cost;
+	}
+	double meanCost() const { return count ? sum_cost / count : 0.0; }
+};
+
+/** policy adapting a stage's timeout to the durations of its successful compute() calls, see Stage::timeout()
+ *
+ * Once min_samples successful calls were observed, the timeout becomes (1 + margin) times their given quantile,
+ * but at least min_timeout. The configured timeout remains an upper bound.
+ *
+ * Failed calls reaching their timeout are right-censored: they might have succeeded given more time.
+ * They are ranked above all successful durations, i.e. the quantile is taken among successes at
+ * quantile * (successes + timeouts) / successes. If that exceeds 1, the configured timeout applies.
+ * Thus, a shortened timeout grows again when too many calls hit it, instead of only ever shrinking.
+ */
+struct TimeoutPolicy
+{
+	double quantile = 0.0;  ///< quantile of successful compute() durations (0 = disabled, use fixed timeout)
+	double margin = 0.5;  ///< relative margin added to the quantile
+	size_t min_samples = 10;  ///< keep the fixed timeout until this many successful calls were observed
+	double min_timeout = 0.01;  ///< lower bound of the adapted timeout [s]
+
+	bool enabled() const { return quantile > 0.0; }
+	static TimeoutPolicy adaptive(double quantile = 0.95, double margin = 0.5) {
+		TimeoutPolicy policy;
+		policy.quantile = quantile;
+		policy.margin = margin;
+		return policy;
+	}
+};
+
+/** policy of the task's stall watchdog, detecting compute() calls that take far longer than expected
+ *
+ * A call stalls once it runs longer than factor times the stage's timeout(), or default_timeout if the stage
+ * has no (finite) timeout. Stalls are logged and recorded in the EventLog with the stage path and input state.
+ * Only the innermost stalled stage is reported. Optionally, a stall preempts planning (see Task::preempt()).
+ */
+struct StallPolicy
+{
+	double factor = 0.0;  ///< stall threshold relative to the expected duration (0 = watchdog disabled)
+	double default_timeout = 10.0;  ///< expected duration [s] of compute() calls of stages without a timeout
+	double check_interval = 0.1;  ///< period [s] of the watchdog's checks
+	bool preempt = false;  ///< preempt planning on a stall
+
+	bool enabled() const { return factor > 0.0; }
+	static StallPolicy watchdog(double factor = 2.0, bool preempt = false) {
+		StallPolicy policy;
+		policy.factor = factor;
+		policy.preempt = preempt;
+		return policy;
+	}
+};
+
+/** immutable view of a stage's solutions and statistics, published after each planning step, see Stage::snapshot()
+ *
+ * Solutions are shared, not copied. As their cost might change meanwhile, costs are captured separately.
+ * The ranking is only rebuilt if the stage's solution list changed since the last snapshot.
+ * Otherwise, consecutive snapshots share it and publishing only updates the statistics.
+ */
+struct StageSnapshot
+{
+	struct Ranking
+	{
+		std::vector<SolutionBaseConstPtr> solutions;  ///< ordered by increasing cost
+		std::vector<double> costs;  ///< costs of solutions at time of publishing
+	};
+
+	uint64_t epoch = 0;  ///< task's planning step that published this snapshot
+	std::shared_ptr<const Ranking> ranking = std::make_shared<const Ranking>();
+	size_t num_failures = 0;
+	double total_compute_time = 0.0;
+
+	const std::vector<SolutionBaseConstPtr>& solutions() const { return ranking->solutions; }
+	const std::vector<double>& costs() const { return ranking->costs; }
+};
+using StageSnapshotConstPtr = std::shared_ptr<const StageSnapshot>;
+
+/** how a solution callback is called, see Stage::addSolutionCallback()
+ *
+ * Asynchronous callbacks are called from a dedicated thread, which receives solutions via a bounded queue.
+ */
+struct CallbackDispatch
+{
+	/// what to do with a new solution if the queue is full
+	enum Overflow
+	{
+		BLOCK,  ///< wait for the callback to catch up, slowing down planning
+		DROP_NEWEST,  ///< discard the new solution
+		DROP_OLDEST,  ///< discard the oldest queued solution
+	};
+
+	bool asynchronous = false;
+	size_t queue_size = 16;
+	Overflow overflow = BLOCK;
+
+	static CallbackDispatch async(size_t queue_size = 16, Overflow overflow = BLOCK) {
+		CallbackDispatch dispatch;
+		dispatch.asynchronous = true;
+		dispatch.queue_size = queue_size;
+		dispatch.overflow = overflow;
+		return dispatch;
+	}
+};
+
 class Stage
 {
 public:
@@ -178,6 +320,13 @@ public:
 	 */
 	virtual void init(const moveit::core::RobotModelConstPtr& robot_model);
 
+	/** discard all solutions to generate them anew, because a world object they depend on moved
+	 *
+	 * Called by Task::replanObject() for generators depending on the moved object and their wrappers.
+	 * Stored solutions are invalidated and their states pruned. Overrides also drop pending inputs.
+	 */
+	virtual void regenerate();
+
 	const ContainerBase* parent() const;
 
 	const std::string& name() const;
@@ -190,8 +339,29 @@ public:
 	 * The logic of the individual stage should ensure this limit is respected.
 	 */
 	void setTimeout(double timeout) { setProperty("timeout", timeout); }
-	/// timeout of stage per computation
-	double timeout() const { return properties().get<double>("timeout"); }
+	/// timeout of stage per computation, adapted by the timeout policy and limited by the time budget (anytime planning)
+	double timeout() const;
+	/// adapt the timeout to the observed durations of successful computations (overrides the task-wide policy)
+	void setTimeoutPolicy(const TimeoutPolicy& policy);
+	/// policy in effect, either the stage's own or the task-wide one
+	const TimeoutPolicy& timeoutPolicy() const;
+
+	/** limit the number of stored solutions / failures (0 = unlimited)
+	 *
+	 * Exceeding worst solutions resp. oldest failures are dropped, unless they are used by a parent's solution.
+	 * Setting max_stored_solutions of Task::stages() keeps the top-K Task solutions only, which bounds the
+	 * number of Task solutions, but not planning memory: children keep the solutions the dropped ones were
+	 * composed of, unless they are bounded themselves or released by Task::setMemoryBudget().
+	 * Dropped solutions are summarized by evictedSolutions().
+	 */
+	void setMaxStoredSolutions(size_t max) { setProperty("max_stored_solutions", max); }
+	void setMaxStoredFailures(size_t max) { setProperty("max_stored_failures", max); }
+	/** sample stored failures instead of keeping the latest ones
+	 *
+	 * Once max_stored_failures is exceeded, the first half of them is kept and the other half holds
+	 * a uniform (reservoir) sample of all later failures, bounding the cost of failure-heavy stages.
+	 */
+	void setSampleFailures(bool sample) { setProperty("sample_failures", sample); }
 
 	/** set marker namespace for solutions
 	 *
@@ -212,6 +382,13 @@ public:
 	using SolutionCallbackList = std::list<SolutionCallback>;
 	/// add function to be called for every newly found solution or failure
 	SolutionCallbackList::const_iterator addSolutionCallback(SolutionCallback&& cb);
+	/** add solution callback, optionally called asynchronously to planning
+	 *
+	 * An asynchronous callback must not rely on a solution's cost or on the solutions connected to its states,
+	 * as planning might change them meanwhile. Removing it and resetting the stage wait for queued solutions.
+	 * Containers wait for the queues of all their descendants before resetting, clearing, or destroying children.
+	 */
+	SolutionCallbackList::const_iterator addSolutionCallback(SolutionCallback&& cb, const CallbackDispatch& dispatch);
 	/// remove function callback
 	void removeSolutionCallback(SolutionCallbackList::const_iterator which);
 
@@ -223,10 +400,30 @@ public:
 	void setCostTerm(T term) {
 		setCostTerm(std::make_shared<LambdaCostTerm>(term));
 	}
+	/** defer the (expensive) cost term until a solution becomes part of the best Task solution
+	 *
+	 * Meanwhile, solutions are ranked by the term's lowerBound(). See SolutionBase::costPending().
+	 */
+	void setLazyCost(bool lazy);
 
 	const ordered<SolutionBaseConstPtr>& solutions() const;
 	const std::list<SolutionBaseConstPtr>& failures() const;
+	/** consistent view of solutions and statistics as of the task's last planning step
+	 *
+	 * In contrast to all other accessors, this is safe to call from any thread while planning. It never blocks.
+	 */
+	StageSnapshotConstPtr snapshot() const;
 	size_t numFailures() const;
+	/** number of failures per reason, see SolutionBase::failureReason()
+	 *
+	 * Only counted if failures are stored (i.e. with introspection), including sampled-out ones.
+	 * At most 32 reasons are distinguished, further ones are counted as "other".
+	 */
+	const std::map<std::string, size_t>& failureReasons() const;
+	/// number and costs of solutions dropped to bound solutions() or memory
+	const EvictedSolutions& evictedSolutions() const;
+	/// number of interface states disabled by pruning within this container
+	size_t numPruned() const;
 	/// Call to increase number of failures w/o storing a (failure) trajectory
 	void silentFailure();
 	/// Should we generate failure solutions? Note: Always report a failure!
@@ -244,8 +441,68 @@ public:
 	[[noreturn]] void reportPropertyError(const Property::error& e);
 
 	double getTotalComputeTime() const;
+	/// histogram of durations of individual compute() calls
+	const LatencyHistogram& computeLatency() const;
+	/// histogram of compute time spent to find a new solution (since the previous one)
+	const LatencyHistogram& solutionLatency() const;
+	/// histogram of durations of compute() calls that found at least one solution
+	const LatencyHistogram& successLatency() const;
+	/// memory of states, scenes, trajectories, and markers created since reset() and still stored
+	/// (only tracked if memory accounting is enabled)
+	MemoryUsage memoryUsage() const;
+	/// enable process-wide memory accounting of all stages (disabled by default, as estimation has some overhead)
+	static void setMemoryAccounting(bool enabled);
+	static bool memoryAccounting();
+	/// planners employed by this stage (to collect their call statistics)
+	virtual std::vector<solvers::PlannerInterfaceConstPtr> planners() const { return {}; }
+	/** equip the stage with caches keeping results of previous planning runs, see Task::setWarmStart()
+	 *
+	 * Called by Task::init() while warm starts are enabled, so it should be idempotent. Own caches are kept.
+	 * Returns true if the configuration changed, requiring to initialize the stage again.
+	 */
+	virtual bool enableWarmStart(WarmStartCache& /*cache*/) { return false; }
+
+	/// token signaling preemption of the task, to be polled (and passed to solvers) by long-running computations
+	const PreemptionToken* preemptionToken() const;
+	/// number of continuations waiting for their future, see resumeWhenReady()
+	size_t numPendingContinuations() const;
 
 protected:
+	/** continue the work of compute() once future is ready, e.g. a planner's AsyncPlan, without blocking
+	 *
+	 * This is continuation passing in place of co_await: compute() returns after launching the expensive work.
+	 * The Task calls continuation with the future's result later on, from its planning loop and under the
+	 * same conditions as compute(): interface states and solutions may be accessed and created.
+	 * Meanwhile, the stage (and all others) can compute further jobs, interleaving in-flight computations.
+	 * Pending continuations are dropped on reset().
+	 * If planning is preempted, their optional cancel function is called to stop the pending work early.
+	 */
+	template <typename T, typename Continuation>
+	void resumeWhenReady(const std::shared_future<T>& future, Continuation continuation) {
+		addContinuation([future]() { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; },
+		                [future, continuation]() { continuation(future.get()); });
+	}
+	void addContinuation(std::function<bool()> ready, std::function<void()> resume,
+	                     std::function<void()> cancel = nullptr);
+
+	/** RAII guard releasing the task's planning lock during expensive, self-contained computations
+	 *
+	 * In concurrent planning mode (see Task::setNumThreads()), a stage's compute() holds a task-wide lock.
+	 * Wrap planner or IK calls into this guard to allow other stages to compute meanwhile.
+	 * Within its scope, neither interface states nor solutions may be accessed or created.
+	 */
+	class ComputeUnlock
+	{
+	public:
+		explicit ComputeUnlock(const Stage& stage);
+		~ComputeUnlock();
+		ComputeUnlock(const ComputeUnlock&) = delete;
+		ComputeUnlock& operator=(const ComputeUnlock&) = delete;
+
+	private:
+		std::mutex* mutex_;
+	};
+
 	/// Stage can only be instantiated through derived classes
 	Stage(StagePrivate* impl);
 	/// Stage cannot be copied
@@ -262,6 +519,9 @@ class ComputeBase : public Stage
 public:
 	PRIVATE_CLASS(ComputeBase)
 
+	/// new states together with their trajectories, to be sent at once
+	using Batch = std::vector<std::pair<InterfaceState, SubTrajectory>>;
+
 protected:
 	/// ComputeBase can only be instantiated by derived classes in stage.cpp
 	ComputeBase(ComputeBasePrivate* impl);
@@ -308,6 +568,21 @@ protected:
 		send<Interface::BACKWARD>(to, std::move(from), std::move(trajectory));
 	}
 
+	/** send many states at once
+	 *
+	 * Compared to individual send() calls, all states are sorted into the push interface at once
+	 * and the parent container processes all new solutions in a single onNewSolutions() call.
+	 */
+	template <Interface::Direction dir>
+	void sendMany(const InterfaceState& start, Batch&& batch);
+
+	inline void sendForwardMany(const InterfaceState& from, Batch&& to) {
+		sendMany<Interface::FORWARD>(from, std::move(to));
+	}
+	inline void sendBackwardMany(Batch&& from, const InterfaceState& to) {
+		sendMany<Interface::BACKWARD>(to, std::move(from));
+	}
+
 private:
 	virtual bool compute(const InterfaceState& /*state*/, planning_scene::PlanningScenePtr& /*scene*/,
 	                     SubTrajectory& /*trajectory*/, Interface::Direction /*dir*/) {
@@ -329,6 +604,7 @@ private:
 	// restrict access to backward method to provide compile-time check
 	void computeBackward(const InterfaceState& to) override;
 	using PropagatingEitherWay::sendBackward;
+	using PropagatingEitherWay::sendBackwardMany;
 };
 
 class PropagatingBackwardPrivate;
@@ -342,6 +618,7 @@ private:
 	// restrict access to forward method to provide compile-time check
 	void computeForward(const InterfaceState& from) override;
 	using PropagatingEitherWay::sendForward;
+	using PropagatingEitherWay::sendForwardMany;
 };
 
 class GeneratorPrivate;
@@ -359,6 +636,18 @@ public:
 		trajectory.setCost(cost);
 		spawn(std::move(state), std::move(trajectory));
 	}
+	/** spawn many states at once
+	 *
+	 * Compared to individual spawn() calls, all states are sorted into the interfaces at once
+	 * and the parent container processes all new solutions in a single onNewSolutions() call.
+	 */
+	void spawnMany(Batch&& batch);
+
+	/** pause spawning while a downstream stage has this many pending jobs (0 = unlimited)
+	 *
+	 * This bounds the number of unexpanded states, if the consumers are slower than the generator.
+	 */
+	void setHighWaterMark(size_t jobs) { setProperty("high_water_mark", jobs); }
 
 protected:
 	Generator(GeneratorPrivate* impl);
@@ -380,12 +669,20 @@ public:
 	void setMonitoredStage(Stage* monitored);
 
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	/// invalidate own solutions and hand over all solutions of the monitored stage again
+	void regenerate() override;
 
 protected:
 	MonitoringGenerator(MonitoringGeneratorPrivate* impl);
 
 	/// called by monitored stage when a new solution was generated
 	virtual void onNewSolution(const SolutionBase& s) = 0;
+	/** called by monitored stage with all successful solutions of a compute() step, sorted by cost
+	 *
+	 * Solutions generated outside of compute(), e.g. by containers, are handed over individually.
+	 * The default implementation calls onNewSolution() for each solution.
+	 */
+	virtual void onNewSolutions(const std::vector<const SolutionBase*>& solutions);
 };
 
 class ConnectingPrivate;
@@ -42,11 +42,22 @@
 #include <moveit/task_constructor/storage.h>
 #include <moveit/task_constructor/cost_terms.h>
 #include <moveit/task_constructor/cost_queue.h>
+#include <moveit/task_constructor/event_log.h>
+#include <moveit/task_constructor/pool_allocator.h>
+#include <moveit/task_constructor/preemption.h>
+#include <moveit/task_constructor/histogram.h>
+#include <moveit/task_constructor/trace.h>
 
+#include <moveit_msgs/PlanningScene.h>
 #include <ros/console.h>
 
+#include <atomic>
 #include <ostream>
 #include <chrono>
+#include <map>
+#include <random>
+#include <set>
+#include <unordered_map>
 
 // define pimpl() functions accessing correctly casted pimpl_ pointer
 #define PIMPL_FUNCTIONS(Class)                                                                       \
@@ -56,10 +67,28 @@
 namespace moveit {
 namespace task_constructor {
 
+/// changes of world objects, applied to all stored states of a task for incremental replanning
+struct SceneUpdate
+{
+	explicit SceneUpdate(const moveit_msgs::PlanningScene& diff);
+
+	/// replace the scene of the given state by an updated diff (shared by all states sharing the original scene)
+	void apply(InterfaceState& state);
+	/// check whether the solution's trajectories collide with any of the changed objects
+	bool collides(const SolutionBase& solution, const planning_scene::PlanningScene& scene) const;
+
+	std::vector<moveit_msgs::CollisionObject> objects;  // changed objects
+	std::set<std::string> ids;  // ids of changed objects
+	// updated diffs of the original scenes
+	std::map<const planning_scene::PlanningScene*, planning_scene::PlanningSceneConstPtr> updated;
+};
+
 class ContainerBase;
+class MonitoringGeneratorPrivate;
 class StagePrivate
 {
 	friend class Stage;
+	friend class StatisticsRecord;
 	friend std::ostream& operator<<(std::ostream& os, const StagePrivate& stage);
 
 public:
@@ -80,8 +109,39 @@ public:
 	/// validate connectivity of children (after init() was done)
 	virtual void validateConnectivity() const;
 
+	/** does init() need to run (again), because the robot model, own or inherited properties, or planners changed?
+	 *
+	 * Containers also need to be initialized if any of their children needs so.
+	 */
+	virtual bool needsInit(const moveit::core::RobotModelConstPtr& robot_model) const;
+	/// did own or parent's properties change since the last successful init()?
+	bool propertiesChanged() const;
+	/// were planners of Stage::planners() replaced or their properties changed since the last successful init()?
+	bool plannersChanged() const;
+	/// remember configuration of a successful init()
+	void markInitialized(const moveit::core::RobotModelConstPtr& robot_model);
+	/// enforce init() on next occasion, e.g. after structural changes
+	inline void markDirty() { init_dirty_ = true; }
+
 	virtual bool canCompute() const = 0;
 	virtual void compute() = 0;
+	/// priority of the job processed by the next compute() call, used for best-first scheduling
+	virtual InterfaceState::Priority jobPriority() const { return InterfaceState::Priority(0, 0.0); }
+	/// number of (estimated) jobs waiting for compute(), used for backpressure on generators
+	virtual size_t pendingJobs() const { return 0; }
+	/// id of this stage in the EventLog
+	inline EventLog::Source eventSource() const { return event_source_; }
+	/// number of states created by this stage, including pruned ones
+	inline size_t numStoredStates() const { return states_.size(); }
+	/// failure comments of solutions made obsolete by Stage::regenerate() resp. composed of invalidated ones
+	static const std::string REGENERATED;
+	static const std::string COMPOSED_OF_INVALID;
+	/// maximum number of distinguished failure reasons per stage
+	static constexpr size_t MAX_FAILURE_REASONS = 32;
+	/// release obsolete failures, which the parent doesn't refer to anymore
+	void releaseObsoleteFailures();
+	/// next stage in given direction of a serial container consuming the states we push
+	const StagePrivate* consumer(Interface::Direction dir) const;
 
 	inline const Stage* me() const { return me_; }
 	inline Stage* me() { return me_; }
@@ -98,6 +158,17 @@ public:
 	inline InterfaceConstPtr ends() const { return ends_; }
 	inline InterfaceConstPtr prevEnds() const { return prev_ends_.lock(); }
 	inline InterfaceConstPtr nextStarts() const { return next_starts_.lock(); }
+	/// push interfaces without locking the weak pointers, if cached by freezeInterfaces()
+	inline Interface* prevEndsRaw() { return frozen_prev_ends_ ? frozen_prev_ends_ : prev_ends_.lock().get(); }
+	inline Interface* nextStartsRaw() { return frozen_next_starts_ ? frozen_next_starts_ : next_starts_.lock().get(); }
+	/** cache push interfaces as raw pointers, once the task structure is fixed after init()
+	 *
+	 * The interfaces are owned by the sibling stages. The cache is dropped when the links change or on reset().
+	 */
+	inline void freezeInterfaces() {
+		frozen_prev_ends_ = prev_ends_.lock().get();
+		frozen_next_starts_ = next_starts_.lock().get();
+	}
 
 	/// direction-based access to pull interface
 	template <Interface::Direction dir>
@@ -113,6 +184,7 @@ public:
 			throw std::runtime_error("Tried to add stage '" + name() + "' to two parents");
 		}
 		parent_ = parent;
+		markDirty();
 	}
 
 	/// explicitly orphan stage
@@ -125,9 +197,57 @@ public:
 	/// to setup the connection structure of their children
 	inline void setParentPosition(container_type::iterator it) { it_ = it; }
 	inline void setIntrospection(Introspection* introspection) { introspection_ = introspection; }
-
-	inline void setPrevEnds(const InterfacePtr& prev_ends) { prev_ends_ = prev_ends; }
-	inline void setNextStarts(const InterfacePtr& next_starts) { next_starts_ = next_starts; }
+	inline Introspection* introspection() const { return introspection_; }
+	/// task-wide lock held during compute(), only defined in concurrent planning mode
+	inline void setPlanningMutex(std::mutex* mutex) { planning_mutex_ = mutex; }
+	inline std::mutex* planningMutex() const { return planning_mutex_; }
+	inline void setPreemptionToken(const PreemptionToken* token) { preempt_token_ = token; }
+	inline const PreemptionToken* preemptionToken() const { return preempt_token_; }
+	/// was preemption requested for this stage? Preempted stages are not scheduled anymore.
+	inline bool preempted() const { return PreemptionToken::requested(preempt_token_); }
+	/// is the deadline of any ancestor container (or this one) exceeded? Such stages are not scheduled anymore.
+	bool deadlineExceeded() const;
+	/// upper bound for a single computation, assigned by the task in anytime planning mode
+	inline void setTimeBudget(double budget) { time_budget_ = budget; }
+	inline double timeBudget() const { return time_budget_; }
+	/// flatten scene diff chains of new states exceeding this depth (0 = unlimited)
+	inline void setMaxSceneDepth(size_t depth) { max_scene_depth_ = depth; }
+	inline size_t maxSceneDepth() const { return max_scene_depth_; }
+	/// merge new states into previously sent ones of equal content, quantizing joints to resolution (0 = disabled)
+	inline void setStateDeduplication(double resolution) { dedup_resolution_ = resolution; }
+	inline double stateDeduplication() const { return dedup_resolution_; }
+	/// task-wide timeout policy, applying unless the stage has an own one
+	inline void inheritTimeoutPolicy(const TimeoutPolicy& policy) {
+		if (!own_timeout_policy_)
+			timeout_policy_ = policy;
+	}
+	/// task-wide stall policy, arming a deadline for each compute() while enabled
+	inline void setStallPolicy(const StallPolicy& policy) { stall_policy_ = policy; }
+	/// note the input state of the running compute(), reported by the stall watchdog by its Introspection::stateId()
+	void noteComputeInput(const InterfaceState& state);
+	/// has the running compute() exceeded its stall deadline (thread-safe)?
+	bool stalled(std::chrono::steady_clock::time_point now) const;
+	/** claim the report of a stall detected by stalled(), providing the running time and input state id (thread-safe)
+	 *
+	 * Returns false if the stall was already reported (or compute() finished meanwhile).
+	 * The id of the input state is 0 if unknown, e.g. without introspection.
+	 */
+	bool claimStall(std::chrono::steady_clock::time_point now, double& running, uint32_t& input);
+
+	/// cost of the best known task solution, assigned by the task in cost pruning mode
+	inline void setCostBound(double bound) { cost_bound_ = bound; }
+	inline double costBound() const { return cost_bound_; }
+	/// can a job with given (lower bound of) cost still improve on the best known solution?
+	inline bool exceedsCostBound(double cost) const { return cost >= cost_bound_; }
+
+	inline void setPrevEnds(const InterfacePtr& prev_ends) {
+		prev_ends_ = prev_ends;
+		frozen_prev_ends_ = nullptr;
+	}
+	inline void setNextStarts(const InterfacePtr& next_starts) {
+		next_starts_ = next_starts;
+		frozen_next_starts_ = nullptr;
+	}
 
 	void composePropertyErrorMsg(const std::string& name, std::ostream& os);
 
@@ -140,26 +260,116 @@ public:
 	void connect(const InterfaceState& from, const InterfaceState& to, const SolutionBasePtr& solution);
 
 	bool storeSolution(const SolutionBasePtr& solution, const InterfaceState* from, const InterfaceState* to);
+	/** state previously sent in direction dir with the same content as state (see setStateDeduplication())
+	 *
+	 * The duplicate's priority is improved if the new solution is cheaper. hash returns the content hash of state.
+	 */
+	InterfaceState* findDuplicate(Interface::Direction dir, const InterfaceState& state, const SolutionBase& solution,
+	                              size_t& hash);
+	/// register a state sent in direction dir for deduplication
+	void indexState(Interface::Direction dir, InterfaceState& state, size_t hash);
+	/// index a new state and add it to the push interface of direction dir (deferred within a batch)
+	void announceState(Interface::Direction dir, InterfaceState& state, size_t hash);
+	/** collect all states and solutions sent until endBatch()
+	 *
+	 * States are added to the push interfaces at once. The parent is notified about all solutions with a
+	 * single onNewSolutions() call. States of a batch are only deduplicated against those of earlier batches.
+	 */
+	void beginBatch();
+	void endBatch();
+	/// account memory of a new state, whose scene is only counted if it differs from the given one
+	void accountState(const InterfaceState& state, const planning_scene::PlanningSceneConstPtr& known_scene);
+	/// account memory of generated markers (may be called from any thread)
+	void accountMarkers(size_t bytes) const { marker_memory_ += bytes; }
+	void releaseMarkers(size_t bytes) const;
+	/** reduce memory when approaching the task's memory budget
+	 *
+	 * Drops markers and failures, and optionally the worse half of all solutions not being part of a parent solution.
+	 */
+	void reduceMemory(bool evict_solutions);
+	/// compress trajectories of all solutions except the best one within tolerance, returns number of compressed
+	size_t compressSolutions(double tolerance);
 	void newSolution(const SolutionBasePtr& solution);
+	/// hand over new solutions to monitoring generators, sorted by cost
+	void notifyMonitors();
+	/// call all solution callbacks, passing shared ownership of solution (if available) to asynchronous ones
+	void callSolutionCallbacks(const SolutionBase& solution, const SolutionBaseConstPtr& shared) const;
+	/// wait for asynchronous solution callbacks to process their queued solutions
+	void flushSolutionCallbacks() const;
+	bool hasAsyncSolutionCallbacks() const { return num_async_cbs_ > 0; }
+	/// publish a new snapshot for concurrent readers, if solutions or statistics changed since the last one
+	void publishSnapshot(uint64_t epoch);
 	bool storeFailures() const { return introspection_ != nullptr; }
-	void runCompute() {
-		ROS_DEBUG_STREAM_NAMED("Stage", "Computing stage '" << name() << "'");
-		auto compute_start_time = std::chrono::steady_clock::now();
-		try {
-			compute();
-		} catch (const Property::error& e) {
-			me()->reportPropertyError(e);
-		}
-		auto compute_stop_time = std::chrono::steady_clock::now();
-		total_compute_time_ += compute_stop_time - compute_start_time;
-	}
+	void runCompute() { runStep([this]() { compute(); }); }
+	/// run step, i.e. compute() or a continuation (resumed), accounting its time to the stage
+	/// Only compute() calls are recorded by the latency statistics, as continuations complete an earlier call.
+	/// (defined out of line: trace points depend on the library's MTC_TRACING configuration)
+	void runStep(const std::function<void()>& step, bool resumed = false);
+
+	/// account compute time to the deadlines of this container and its ancestors not accounting it themselves
+	void chargeDeadlines(std::chrono::steady_clock::duration elapsed);
+
+	/// run all continuations whose future is ready (unless compute() is running), returns their number
+	size_t resumeContinuations();
+	bool hasContinuations() const { return !continuations_.empty(); }
+	/// request the work of pending continuations to stop, which are resumed (or dropped) as usual
+	void cancelContinuations();
 
 	/** compute cost for solution through configured CostTerm */
 	void computeCost(const InterfaceState& from, const InterfaceState& to, SolutionBase& solution);
 
+	/** evaluate the deferred CostTerm of a stored COST_PENDING solution, re-ranking it
+	 *
+	 * Returns the change of the solution's cost. A failing cost invalidates the solution and prunes its branch.
+	 */
+	double resolvePendingCost(const SolutionBase& solution);
+	/** re-evaluate the cost of a stored solution after the costs of its sub solutions changed by delta
+	 *
+	 * Returns the change of the solution's cost.
+	 */
+	double shiftCost(const SolutionBase& solution, double delta);
+
+	/** apply scene update to all stored states and invalidate solutions affected by it
+	 *
+	 * Returns the number of invalidated solutions.
+	 */
+	virtual size_t revalidate(SceneUpdate& update);
+
+	/** collision-check all VALIDATION_PENDING trajectories of the given (stored) solution
+	 *
+	 * Returns false if a collision was found. The solution is invalidated then and its branch pruned.
+	 */
+	bool validatePending(const SolutionBase& solution);
+
 protected:
 	StagePrivate& operator=(StagePrivate&& other);
 
+	/// mark solution as failure and move it to failures_, keeping it alive for all states referring to it
+	void invalidateSolution(ordered<SolutionBaseConstPtr>::iterator it, const std::string& msg);
+	/// handle a stored solution that became invalid: prune its solution branch
+	virtual void onInvalidSolution(const SolutionBase& solution);
+	/// evaluate cost_term_ for a solution with (temporarily) known states, appending the term's comment
+	void evaluateCost(SolutionBase& solution);
+	/// restore sort order of a stored solution after its cost changed, invalidating it if the cost failed
+	void rerankSolution(const SolutionBase& solution, const std::string& msg);
+
+	/// drop worst solutions exceeding max_stored_solutions, which are not part of any parent solution
+	void evictSolutions();
+	/// drop oldest failures exceeding max_stored_failures (after the sampling head if sample_failures is set)
+	void evictFailures();
+	/// decide whether to keep a new failure in the reservoir sample, possibly evicting a sampled one
+	bool sampleFailure();
+	/// count a failure under its reason, folding reasons beyond MAX_FAILURE_REASONS into "other"
+	void countFailureReason(const std::string& reason);
+	/// unlink a solution from its states and introspection before dropping it
+	void releaseSolution(const SolutionBase& solution);
+	/// prune and release an evicted solution, see releaseStates()
+	void evictSolution(const SolutionBase& solution);
+	/// release the scenes of states created for a dropped solution, which are not part of any other solution
+	void releaseStates(const SolutionBase& solution);
+	/// memory of already generated markers of a solution
+	static size_t solutionMarkerMemory(const SolutionBase& solution);
+
 	// associated/owning Stage instance
 	Stage* me_;
 
@@ -172,17 +382,64 @@ protected:
 
 	// user-configurable cost estimator
 	CostTermConstPtr cost_term_;
+	bool lazy_cost_ = false;  // defer cost_term_ until solutions compete for the best Task solution
 
 	// The total compute time
 	std::chrono::duration<double> total_compute_time_;
+	// duration of individual compute() calls
+	LatencyHistogram compute_latency_;
+	// compute time spent until a new solution was found
+	LatencyHistogram solution_latency_;
+	// duration of compute() calls that found a solution, used to adapt the timeout
+	LatencyHistogram success_latency_;
+	size_t timed_out_ = 0;  // failed compute() calls reaching their timeout, i.e. censored success durations
+	std::chrono::duration<double> compute_since_solution_;
+	std::chrono::steady_clock::time_point solution_mark_;  // start of compute() or time of last solution within
+	std::atomic<bool> computing_{ false };  // within runCompute()? (read by concurrently computing children)
+	bool compute_succeeded_ = false;  // running compute() found a solution?
+	TimeoutPolicy timeout_policy_;  // adaptive timeout (disabled by default)
+	bool own_timeout_policy_ = false;  // timeout_policy_ set by the stage itself, not inherited from the task
+	// running compute() as seen by the stall watchdog: start and deadline in steady_clock ticks
+	// (deadline 0: idle, STALL_REPORTED: stall already reported), id of the input state if known
+	static constexpr int64_t STALL_REPORTED = -1;
+	StallPolicy stall_policy_;
+	std::atomic<int64_t> compute_start_{ 0 };
+	std::atomic<int64_t> stall_deadline_{ 0 };
+	std::atomic<uint32_t> compute_input_{ 0 };
+	void armStallDeadline(std::chrono::steady_clock::time_point start);
+	void disarmStallDeadline();
 
 	// functions called for each new solution
 	std::list<Stage::SolutionCallback> solution_cbs_;
+	size_t num_async_cbs_ = 0;  // number of asynchronous ones among them
+	// monitoring generators subscribed to our solutions, which keep raw pointers to them
+	std::vector<MonitoringGeneratorPrivate*> monitors_;
+	std::vector<const SolutionBase*> monitor_batch_;  // solutions of the running compute(), not yet handed over
+	// states and solutions of a running batch, see beginBatch()
+	bool batching_ = false;
+	std::vector<std::pair<InterfaceState*, size_t>> batch_states_[2];  // per direction, with content hash
+	std::vector<SolutionBasePtr> batch_solutions_;
+	// work of compute() waiting for a future, see Stage::resumeWhenReady()
+	struct Continuation
+	{
+		std::function<bool()> ready;
+		std::function<void()> resume;
+		std::function<void()> cancel;  // optional, stopping the work waited for
+	};
+	std::list<Continuation> continuations_;
 
-	std::list<InterfaceState> states_;  // storage for created states
+	PoolList<InterfaceState> states_;  // storage for created states
 	ordered<SolutionBaseConstPtr> solutions_;
 	std::list<SolutionBaseConstPtr> failures_;
 	std::size_t num_failures_ = 0;  // num of failures if not stored
+	std::size_t num_offered_failures_ = 0;  // num of failures considered for storage (with sample_failures)
+	std::map<std::string, size_t> failure_reasons_;  // failure counts per reason, bounded by MAX_FAILURE_REASONS
+	std::minstd_rand failure_rng_;
+	EvictedSolutions evicted_;  // summary of solutions dropped from solutions_
+	std::size_t num_pruned_ = 0;  // num of interface states disabled by pruning (containers only)
+	MemoryUsage memory_;  // memory of created objects, except markers (only if memory accounting is enabled)
+	mutable std::atomic<size_t> marker_memory_{ 0 };  // deferred markers might be generated from other threads
+	uint64_t changes_ = 0;  // modification counter of solutions and statistics, see publishSnapshot()
 
 private:
 	// !! items write-accessed only by ContainerBasePrivate to maintain hierarchy !!
@@ -193,10 +450,36 @@ private:
 	// linking to previous/next sibling's pull interfaces
 	InterfaceWeakPtr prev_ends_;  // interface to be used for sendBackward()
 	InterfaceWeakPtr next_starts_;  // interface to be used for sendForward()
+	Interface* frozen_prev_ends_;  // cached prev_ends_ (see freezeInterfaces())
+	Interface* frozen_next_starts_;  // cached next_starts_
+
+	// configuration of last successful init(), see needsInit()
+	std::weak_ptr<const moveit::core::RobotModel> init_model_;  // expired if not initialized
+	uint64_t init_version_;  // version of properties_
+	uint64_t init_parent_version_;  // version of parent's properties
+	// planners and the versions of their properties
+	std::vector<std::pair<std::weak_ptr<const solvers::PlannerInterface>, uint64_t>> init_planners_;
+	bool init_dirty_;  // init() enforced by markDirty()
 
 	Introspection* introspection_;  // task's introspection instance
+	std::mutex* planning_mutex_;  // task's planning lock (only in concurrent mode)
+	const PreemptionToken* preempt_token_;  // task's preemption token
+	double time_budget_;  // time available for a single computation (infinite by default)
+	double cost_bound_;  // jobs reaching this cost are skipped (infinite by default)
+	size_t max_scene_depth_ = 0;  // max depth of scene diff chains of created states (0 = unlimited)
+	double dedup_resolution_ = 0.0;  // joint resolution of state deduplication (0 = disabled)
+	// states sent to next starts (FORWARD) and previous ends (BACKWARD) by their content hash
+	std::unordered_multimap<size_t, InterfaceState*> dedup_index_[2];
+
+	uint64_t published_changes_ = 0;  // changes_ reflected by snapshot_
+	uint64_t published_revision_ = 0;  // solutions_.revision() reflected by snapshot_->ranking
+	StageSnapshotConstPtr snapshot_;  // shared with concurrent readers, only accessed via std::atomic_load/store
+	const EventLog::Source event_source_ = EventLog::newSource();  // not reassigned by operator=
 };
 PIMPL_FUNCTIONS(Stage)
+
+/// estimated memory [bytes] of a marker
+size_t markerMemory(const visualization_msgs::Marker& marker);
 std::ostream& operator<<(std::ostream& os, const StagePrivate& stage);
 
 template <>
@@ -251,6 +534,8 @@ public:
 
 	bool canCompute() const override;
 	void compute() override;
+	InterfaceState::Priority jobPriority() const override;
+	size_t pendingJobs() const override;
 
 	bool hasStartState() const;
 	const InterfaceState& fetchStartState();
@@ -282,6 +567,9 @@ public:
 	InterfaceFlags requiredInterface() const override;
 	bool canCompute() const override;
 	void compute() override;
+
+	/// is a consumer of our states busy with more pending jobs than high_water_mark?
+	bool congested() const;
 };
 PIMPL_FUNCTIONS(Generator)
 
@@ -291,13 +579,12 @@ class MonitoringGeneratorPrivate : public GeneratorPrivate
 
 public:
 	Stage* monitored_;
-	Stage::SolutionCallbackList::const_iterator cb_;
-	bool registered_;
+	bool registered_;  // in monitored_'s monitors_?
 
 	inline MonitoringGeneratorPrivate(MonitoringGenerator* me, const std::string& name);
 
-private:
-	void solutionCB(const SolutionBase& s);
+	/// hand over new solutions of the monitored stage
+	void notify(const std::vector<const SolutionBase*>& solutions);
 };
 PIMPL_FUNCTIONS(MonitoringGenerator)
 
@@ -332,6 +619,8 @@ public:
 	InterfaceFlags requiredInterface() const override;
 	bool canCompute() const override;
 	void compute() override;
+	InterfaceState::Priority jobPriority() const override;
+	size_t pendingJobs() const override;
 
 	// Check whether there are pending feasible states that could connect to source
 	template <Interface::Direction dir>
@@ -339,6 +628,10 @@ public:
 
 	std::ostream& printPendingPairs(std::ostream& os = std::cerr) const;
 
+protected:
+	// re-schedule state pair of an invalidated solution
+	void onInvalidSolution(const SolutionBase& solution) override;
+
 private:
 	// Create a pair of Interface states for pending list, such that the order (start, end) is maintained
 	template <Interface::Direction other>
@@ -348,8 +641,25 @@ private:
 	template <Interface::Direction other>
 	void newState(Interface::iterator it, Interface::UpdateFlags updated);
 
-	// ordered list of pending state pairs
+	// Is the state pair still pending in the lazy frontier of starts_ x ends_?
+	inline bool isPending(const StatePair& pair) const { return !done_.count({ &*pair.first, &*pair.second }); }
+	// Find the best enabled pair of the lazy frontier
+	bool findPendingPair(StatePair& best) const;
+	// Best enabled pair of both, the lazy frontier and explicitly scheduled pairs (nullptr if there is none)
+	const StatePair* bestPendingPair() const;
+
+	// Pending state pairs are enumerated lazily from the sorted starts_ and ends_ interfaces.
+	// Only pairs removed from this frontier, i.e. already computed or incompatible ones, are stored.
+	std::set<std::pair<const InterfaceState*, const InterfaceState*>> done_;
+	// ordered list of explicitly scheduled state pairs (re-scheduled invalid solutions, jobs passed by Fallbacks)
 	ordered<StatePair> pending;
+
+	mutable StatePair best_;  // cached result of findPendingPair()
+	mutable bool best_found_ = false;
+	mutable bool best_valid_ = false;  // cache is invalidated by any interface update
+	// first candidate end state per start state, valid as long as the order of starts_ and ends_ is unchanged
+	mutable std::unordered_map<const InterfaceState*, Interface::const_iterator> cursors_;
+	mutable std::pair<uint64_t, uint64_t> frontier_revision_{ 0, 0 };  // revisions of starts_ and ends_
 };
 PIMPL_FUNCTIONS(Connecting)
 }  // namespace task_constructor
@@ -0,0 +1,111 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Registry creating stages by class id, bypassing pluginlib for built-in stages
+*/
+
+#pragma once
+
+#include <moveit/task_constructor/stage.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Process-wide registry creating stages from their class id
+ *
+ * Built-in stages of the core package are registered under the class ids of their pluginlib
+ * declaration, e.g. "moveit_task_constructor/Current State", and are created without involving pluginlib.
+ * The registry is populated on first access, loading the stages library if needed.
+ * Other class ids are created from plugins through a single, cached pluginlib::ClassLoader,
+ * which parses the plugin descriptions only once per process.
+ * If the environment variable MTC_PRELOAD_PLUGINS is set on first access,
+ * the class loader and all (non built-in) plugin libraries are loaded upfront.
+ */
+class StageRegistry
+{
+public:
+	using Factory = std::function<Stage*()>;
+	struct Entry
+	{
+		std::string class_id;
+		std::string description;
+		Factory factory;
+	};
+
+	static StageRegistry& instance();
+
+	/// register (or replace) a built-in stage type
+	void add(const std::string& class_id, const std::string& description, const Factory& factory);
+	template <class T>
+	void add(const std::string& class_id, const std::string& description = "") {
+		add(class_id, description, [] { return new T(); });
+	}
+	bool contains(const std::string& class_id) const;
+	/// all built-in entries, sorted by class id
+	std::vector<Entry> entries() const;
+
+	/// factory for given class id (built-in or plugin), throws std::runtime_error if unknown
+	Factory factory(const std::string& class_id) const;
+	/// create a stage of given class id (built-in or plugin), throws std::runtime_error if unknown
+	Stage::pointer create(const std::string& class_id) const;
+	/// class ids of built-ins and declared plugins
+	std::vector<std::string> declaredClasses() const;
+	/// load the plugin class loader and the libraries of all declared (non built-in) plugins
+	void preloadPlugins() const;
+
+private:
+	StageRegistry();
+	StageRegistry(const StageRegistry&) = delete;
+	/// register the stages of the stages library
+	void addPrimitiveStages();
+	StageRegistry& operator=(const StageRegistry&) = delete;
+
+	struct PluginLoader;
+	PluginLoader& pluginLoader() const;
+
+	mutable std::mutex mutex_;  // protects built_ins_
+	std::unordered_map<std::string, Entry> built_ins_;
+	// separate lock: loading plugin libraries might register further built-ins
+	mutable std::mutex plugin_mutex_;
+	mutable std::unique_ptr<PluginLoader> plugin_loader_;  // created on first use
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -44,6 +44,7 @@
 #include "stages/fix_collision_objects.h"
 #include "stages/fixed_cartesian_poses.h"
 #include "stages/fixed_state.h"
+#include "stages/generate_database_grasps.h"
 #include "stages/generate_grasp_pose.h"
 #include "stages/generate_place_pose.h"
 #include "stages/generate_pose.h"
@@ -38,13 +38,20 @@
 
 #include <moveit/task_constructor/container.h>
 #include <moveit/task_constructor/cost_queue.h>
+#include <moveit/task_constructor/reachability_map.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <Eigen/Geometry>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
 
 namespace moveit {
 namespace core {
 MOVEIT_CLASS_FORWARD(RobotState);
 MOVEIT_CLASS_FORWARD(JointModelGroup);
+MOVEIT_CLASS_FORWARD(LinkModel);
 }  // namespace core
 }  // namespace moveit
 
@@ -52,6 +59,49 @@ namespace moveit {
 namespace task_constructor {
 namespace stages {
 
+MOVEIT_CLASS_FORWARD(IKCache);
+
+/** Cache of IK solutions, keyed by robot model, group, IK link, and quantized target pose
+ *
+ * ComputeIK uses cached solutions as first seeds, which converge quickly for (nearly) identical targets.
+ * As seeded solutions are validated as usual, cached solutions are re-checked against the current scene.
+ * Share a single instance between stages to reuse solutions across Task instances.
+ * Memory is bounded by max_targets: storing for a new target evicts the least recently stored one.
+ */
+class IKCache
+{
+public:
+	IKCache(double position_resolution = 0.005, double orientation_resolution = 0.01,
+	        size_t max_solutions_per_target = 8, size_t max_targets = 10000);
+
+	/// cached solutions for the given target pose of link, most recent first
+	std::vector<std::vector<double>> lookup(const core::JointModelGroup* jmg, const core::LinkModel* link,
+	                                        const Eigen::Isometry3d& pose) const;
+	/// add a valid solution, dropping the oldest one exceeding max_solutions_per_target
+	void store(const core::JointModelGroup* jmg, const core::LinkModel* link, const Eigen::Isometry3d& pose,
+	           const std::vector<double>& solution);
+
+	size_t size() const;
+	void clear();
+
+private:
+	std::string key(const core::JointModelGroup* jmg, const core::LinkModel* link, const Eigen::Isometry3d& pose) const;
+
+	const double position_resolution_;
+	const double orientation_resolution_;
+	const size_t max_solutions_per_target_;
+	const size_t max_targets_;
+
+	struct Entry
+	{
+		std::deque<std::vector<double>> solutions;  // most recent first
+		std::list<std::string>::iterator usage;  // position in usage_
+	};
+	mutable std::mutex mutex_;
+	std::map<std::string, Entry> entries_;
+	std::list<std::string> usage_;  // keys of entries_, most recently stored first
+};
+
 /** Wrapper for any pose generator stage to compute IK poses for a Cartesian pose.
  *
  * The wrapper reads a target_pose from the interface state of solutions provided
@@ -68,9 +118,21 @@ namespace stages {
 class ComputeIK : public WrapperBase
 {
 public:
+	/** filter for valid IK solutions, called before their scene and interface state are created
+	 *
+	 * Receives the target's scene, the solution's robot state, and the IK link.
+	 * Returning false rejects the solution, optionally giving a reason in comment.
+	 */
+	using SolutionFilter = std::function<bool(const planning_scene::PlanningSceneConstPtr& scene,
+	                                          const moveit::core::RobotState& state,
+	                                          const moveit::core::LinkModel& link, std::string& comment)>;
+
 	ComputeIK(const std::string& name = "IK", Stage::pointer&& child = Stage::pointer());
 
 	void reset() override;
+	/// unless an own IK cache is set, seed IK with previous solutions from a task-wide cache
+	bool enableWarmStart(WarmStartCache& cache) override;
+	void regenerate() override;
 	void init(const core::RobotModelConstPtr& robot_model) override;
 	void onNewSolution(const SolutionBase& s) override;
 
@@ -109,9 +171,37 @@ public:
 	void setMaxIKSolutions(uint32_t n) { setProperty("max_ik_solutions", n); }
 	void setIgnoreCollisions(bool flag) { setProperty("ignore_collisions", flag); }
 	void setMinSolutionDistance(double distance) { setProperty("min_solution_distance", distance); }
+	/// run up to num IK attempts from different seeds concurrently (requires a thread-safe IK solver)
+	void setNumThreads(uint32_t num) { setProperty("num_threads", num); }
+	/// seed IK with (and store valid solutions in) the given cache
+	void setIKCache(const IKCachePtr& cache) { setProperty("ik_cache", cache); }
+	/** solve up to num targets of the wrapped generator concurrently, spawning the best results first
+	 *
+	 * Each target spawns its own threads according to num_threads.
+	 */
+	void setBatchSize(uint32_t num) { setProperty("batch_size", num); }
+	/// reject valid IK solutions early, e.g. if a subsequent motion is known to fail from them
+	void setSolutionFilter(const SolutionFilter& filter) { setProperty("ik_filter", filter); }
+	/** reject targets outside the reachability map of the group's IK link before attempting IK
+	 *
+	 * Targets within the map are penalized by weight * (1 - score), preferring well reachable ones.
+	 * Targets in voxels never reached while sampling the map are attempted nevertheless.
+	 */
+	void setReachabilityMap(const ReachabilityMapPtr& map, double weight = 0.0) {
+		setProperty("reachability_map", map);
+		setProperty("reachability_weight", weight);
+	}
 
 protected:
 	ordered<const SolutionBase*> upstream_solutions_;
+
+	/// targets of a batch, solved concurrently
+	struct IKJob;
+	/// collision matrix of the end-effector pre-check, reused for scenes sharing the same matrix
+	struct EEFCollisionMatrix;
+	void solveTarget(IKJob& job, EEFCollisionMatrix& eef_acm, bool unlock);
+
+	std::vector<std::shared_ptr<EEFCollisionMatrix>> eef_acm_;  // per batch slot
 };
 }  // namespace stages
 }  // namespace task_constructor
@@ -40,9 +40,14 @@
 
 #include <moveit/task_constructor/stage.h>
 #include <moveit/task_constructor/solvers/planner_interface.h>
+#include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/task_constructor/pool_allocator.h>
 
 #include <moveit_msgs/Constraints.h>
 
+#include <list>
+#include <unordered_map>
+
 namespace moveit {
 namespace core {
 MOVEIT_CLASS_FORWARD(RobotState);
@@ -60,6 +65,12 @@ namespace stages {
  * specified order. Each planner only plan for joints within the corresponding planning group.
  * Finally, an attempt is made to merge the sub trajectories of individual planning results.
  * If this fails, the sequential planning result is returned.
+ *
+ * Optionally, a cheap pre-screening attempts joint interpolation first, using its trajectory if collision-free.
+ * Pairs whose joint-space distance exceeds prescreen_max_distance are rejected without planning at all.
+ *
+ * Pairs usually share the same collision objects: multi-query planners (see PipelinePlanner::setMultiQuery())
+ * reuse their roadmap across pairs then.
  */
 class Connect : public Connecting
 {
@@ -74,29 +85,87 @@ public:
 	};
 
 	using GroupPlannerVector = std::vector<std::pair<std::string, solvers::PlannerInterfacePtr> >;
+
+	/// counters of the pre-screening
+	struct PrescreenStatistics
+	{
+		size_t gated = 0;  // pairs rejected due to their joint-space distance
+		size_t passed = 0;  // group motions solved by joint interpolation
+		size_t failed = 0;  // group motions passed on to the actual planner
+	};
+
 	Connect(const std::string& name = "connect", const GroupPlannerVector& planners = {});
+	~Connect() override;
 
 	void setPathConstraints(moveit_msgs::Constraints path_constraints) {
 		setProperty("path_constraints", std::move(path_constraints));
 	}
 
+	/// try joint interpolation before calling the actual planners
+	void setPrescreen(bool prescreen) { setProperty("prescreen", prescreen); }
+	/// reject pairs farther apart (summed joint-space distance of all planned groups) when pre-screening
+	void setPrescreenMaxDistance(double distance) { setProperty("prescreen_max_distance", distance); }
+	const PrescreenStatistics& prescreenStatistics() const { return prescreen_stats_; }
+	/** plan asynchronously, continuing with further pairs while up to max_in_flight plans are running
+	 *
+	 * Only applies to a single planning group without pre-screening. See Stage::resumeWhenReady().
+	 * Running plans are canceled on reset() and once the task is preempted.
+	 */
+	void setAsyncPlanning(bool async, uint32_t max_in_flight = 4) {
+		setProperty("async_planning", async);
+		setProperty("max_in_flight", max_in_flight);
+	}
+
 	void reset() override;
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
 	void compute(const InterfaceState& from, const InterfaceState& to) override;
+	std::vector<solvers::PlannerInterfaceConstPtr> planners() const override;
+	/// first try previous trajectories between (nearly) identical states again
+	bool enableWarmStart(WarmStartCache& cache) override;
 
 protected:
 	SolutionSequencePtr makeSequential(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
 	                                   const std::vector<planning_scene::PlanningSceneConstPtr>& intermediate_scenes,
-	                                   const InterfaceState& from, const InterfaceState& to);
+	                                   const InterfaceState& from, const InterfaceState& to,
+	                                   bool validation_pending = false,
+	                                   const std::vector<SubTrajectory::TimeParameterizer>& timings = {});
+	/// merge or sequence the planned sub trajectories and connect from and to with the resulting solution
+	void storeResult(const InterfaceState& from, const InterfaceState& to,
+	                 const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
+	                 const std::vector<planning_scene::PlanningSceneConstPtr>& intermediate_scenes, bool success,
+	                 bool validation_pending, const std::vector<SubTrajectory::TimeParameterizer>& timings);
+	/// merge sub trajectories, deferring time parameterization if all timings are deferred
 	SubTrajectoryPtr merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
 	                       const std::vector<planning_scene::PlanningSceneConstPtr>& intermediate_scenes,
-	                       const moveit::core::RobotState& state);
+	                       const moveit::core::RobotState& state,
+	                       const std::vector<SubTrajectory::TimeParameterizer>& timings = {});
+
+	/// positions of all joints not planned for, which need to match between connected states
+	struct JointSignature
+	{
+		size_t hash;
+		Eigen::VectorXd positions;
+	};
+	/// signature of state, computed on first access
+	const JointSignature& signature(const InterfaceState& state) const;
 
 protected:
 	GroupPlannerVector planner_;
+	solvers::JointInterpolationPlannerPtr prescreen_planner_;
+	PrescreenStatistics prescreen_stats_;
+	std::list<solvers::PlannerInterface::AsyncPlan> in_flight_;  // running asynchronous plans
+	void cancelAsyncPlans();
+
+	// property handles, resolved in init()
+	PropertyHandle<MergeMode> merge_mode_;
+	PropertyHandle<moveit_msgs::Constraints> path_constraints_;
+	PropertyHandle<bool> prescreen_;
+	PropertyHandle<double> prescreen_max_distance_;
 	moveit::core::JointModelGroupPtr merged_jmg_;
-	std::list<SubTrajectory> subsolutions_;
-	std::list<InterfaceState> states_;
+	std::vector<const moveit::core::JointModel*> fixed_joints_;  // joints not planned for, resolved in init()
+	mutable std::unordered_map<const InterfaceState*, JointSignature> signatures_;
+	PoolList<SubTrajectory> subsolutions_;
+	PoolList<InterfaceState> states_;
 };
 }  // namespace stages
 }  // namespace task_constructor
@@ -41,16 +41,32 @@
 
 #include <moveit/task_constructor/stage.h>
 
+namespace planning_scene_monitor {
+MOVEIT_CLASS_FORWARD(PlanningSceneMonitor);
+}
+
 namespace moveit {
 namespace task_constructor {
 namespace stages {
 
-/** Fetch the current PlanningScene state via get_planning_scene service */
+/** Fetch the current PlanningScene state via get_planning_scene service
+ *
+ * Alternatively, the scene is copied from a (running) in-process PlanningSceneMonitor,
+ * avoiding the service roundtrip and message serialization.
+ */
 class CurrentState : public Generator
 {
 public:
 	CurrentState(const std::string& name = "current state");
 
+	/// copy the scene from the given monitor instead of calling the service
+	void setPlanningSceneMonitor(const planning_scene_monitor::PlanningSceneMonitorPtr& monitor) {
+		monitor_ = monitor;
+	}
+	/// moveit_msgs::PlanningSceneComponents to request (or copy from the monitor)
+	void setComponents(uint32_t components) { setProperty("components", components); }
+
+	void reset() override;
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
 	bool canCompute() const override;
 	void compute() override;
@@ -58,6 +74,7 @@ public:
 protected:
 	moveit::core::RobotModelConstPtr robot_model_;
 	planning_scene::PlanningScenePtr scene_;
+	planning_scene_monitor::PlanningSceneMonitorPtr monitor_;
 };
 }  // namespace stages
 }  // namespace task_constructor
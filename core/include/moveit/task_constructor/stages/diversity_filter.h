@@ -0,0 +1,102 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Wrapper forwarding only solutions that are sufficiently different from each other
+*/
+
+#pragma once
+
+#include <moveit/task_constructor/container.h>
+
+#include <memory>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+/** Stage Wrapper forwarding a diverse subset of the generated solutions
+ *
+ * A solution is accepted only if the end state differs by at least min_distance from the end states of all
+ * solutions accepted before. Others are forwarded as failures. Thus, expensive subsequent stages only
+ * process solutions that differ significantly, e.g. not grasps that are only a few degrees apart.
+ *
+ * Selection is greedy in the order solutions arrive. Solutions of a single compute() of the child,
+ * e.g. all grasp candidates of a GenerateGraspPose, are considered by increasing cost. Hence, among close
+ * solutions of one batch, the cheapest one is forwarded. A cheaper solution arriving later is rejected
+ * if it is close to an already forwarded one.
+ *
+ * The JOINTS metric compares the variable values of group (all variables if empty) by Euclidean distance,
+ * taking the shorter way around for continuous joints.
+ * The POSE metric compares the pose of link by its translation plus the rotation angle scaled by rotation_weight.
+ * Accepted states are kept in a grid of cell size min_distance, such that each check considers only neighbours.
+ */
+class DiversityFilter : public WrapperBase
+{
+public:
+	enum Metric
+	{
+		JOINTS = 0,
+		POSE = 1
+	};
+
+	DiversityFilter(const std::string& name, Stage::pointer&& child = Stage::pointer());
+	~DiversityFilter() override;
+
+	void reset() override;
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+
+	void onNewSolution(const SolutionBase& s) override;
+	void onNewSolutions(const std::vector<const SolutionBase*>& solutions) override;
+
+	void setMinDistance(double distance) { setProperty("min_distance", distance); }
+	void setMetric(Metric metric) { setProperty("metric", metric); }
+	/// group whose variables are compared by the JOINTS metric (all variables if empty)
+	void setGroup(const std::string& group) { setProperty("group", group); }
+	/// link (or other known frame) whose pose is compared by the POSE metric
+	void setLink(const std::string& link) { setProperty("link", link); }
+	/// distance corresponding to a rotation of one radian in the POSE metric
+	void setRotationWeight(double weight) { setProperty("rotation_weight", weight); }
+	void setIgnoreFilter(bool ignore) { setProperty("ignore_filter", ignore); }
+
+protected:
+	struct Index;
+	std::unique_ptr<Index> index_;  // accepted states, created on first solution
+	// JOINTS metric: compared variables (resolved in init), with the num_wrapped_ continuous ones last
+	std::vector<int> variables_;
+	size_t num_wrapped_ = 0;
+};
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
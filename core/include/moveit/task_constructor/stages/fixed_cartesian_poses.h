@@ -41,6 +41,8 @@
 #include <moveit/task_constructor/stage.h>
 #include <moveit/task_constructor/cost_queue.h>
 #include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/PoseArray.h>
+#include <Eigen/Core>
 
 namespace moveit {
 namespace task_constructor {
@@ -52,14 +54,34 @@ public:
 	FixedCartesianPoses(const std::string& name = "generate poses");
 
 	void reset() override;
+	void regenerate() override;
 	bool canCompute() const override;
 	void compute() override;
 
 	void addPose(const geometry_msgs::PoseStamped& pose);
+	/// add all poses of the array, expressed w.r.t. its header's frame
+	void addPoses(const geometry_msgs::PoseArray& poses);
+	/// add poses from a binary file written by savePoses()
+	bool loadPoses(const std::string& file);
+	/** write poses grouped by frame into a binary file
+	 *
+	 * Layout: magic "MTCPOSE1", uint64 number of frames, followed by each frame's char[64] id,
+	 * uint64 number of poses, and their double values: position x,y,z and orientation x,y,z,w
+	 */
+	static bool savePoses(const std::string& file, const std::vector<geometry_msgs::PoseStamped>& poses);
 
 protected:
 	void onNewSolution(const SolutionBase& s) override;
 	ordered<const SolutionBase*> upstream_solutions_;
+
+	/// bulk poses sharing a frame, one column per pose, transformed together into the planning frame
+	struct PoseSet
+	{
+		std::string frame_id;
+		Eigen::Matrix3Xd positions;
+		Eigen::Matrix4Xd orientations;  // x, y, z, w
+	};
+	std::vector<PoseSet> pose_sets_;
 };
 }  // namespace stages
 }  // namespace task_constructor
@@ -39,17 +39,32 @@
 #pragma once
 
 #include <moveit/task_constructor/stage.h>
+#include <moveit/robot_state/robot_state.h>
+
+#include <vector>
 
 namespace moveit {
 namespace task_constructor {
 namespace stages {
 
-/** Spawn a pre-defined PlanningScene state */
+/** Spawn a pre-defined PlanningScene state
+ *
+ * Alternatively, spawn many robot states sharing a single base scene, see setStates().
+ */
 class FixedState : public Generator
 {
 public:
 	FixedState(const std::string& name = "initial state", planning_scene::PlanningScenePtr = nullptr);
+	/// spawn the given scene (dropping states set by setStates())
 	void setState(const planning_scene::PlanningScenePtr& scene);
+	/** spawn each of the robot states as diffs of the shared base scene (dropping a scene set by setState())
+	 *
+	 * This is a lightweight alternative to many FixedStates under Alternatives, e.g. for a set of home poses:
+	 * The scene of a state is only created when it is spawned, with one state spawned per compute() call.
+	 * States are spawned in order of increasing priority (all 0.0 if empty), keeping their order for equal priorities.
+	 */
+	void setStates(const planning_scene::PlanningSceneConstPtr& base,
+	               const std::vector<moveit::core::RobotState>& states, const std::vector<double>& priorities = {});
 
 	void reset() override;
 	bool canCompute() const override;
@@ -58,6 +73,11 @@ public:
 protected:
 	planning_scene::PlanningScenePtr scene_;
 	bool ran_ = false;
+
+	/// shared base scene and states sorted by priority, of which the first next_ ones were spawned already
+	planning_scene::PlanningSceneConstPtr base_;
+	std::vector<moveit::core::RobotState> states_;
+	size_t next_ = 0;
 };
 }  // namespace stages
 }  // namespace task_constructor
@@ -0,0 +1,130 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Spawn precomputed grasps from a memory-mapped database file
+*/
+
+#pragma once
+
+#include <moveit/task_constructor/stages/generate_pose.h>
+#include <Eigen/Geometry>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+MOVEIT_CLASS_FORWARD(GraspDatabase);
+
+/** Read-only, memory-mapped file of precomputed grasps per object
+ *
+ * Layout (native byte order): 8 byte magic, uint64 number of objects, a table of objects
+ * (64 byte zero-terminated id, uint64 index of first grasp, uint64 number of grasps),
+ * followed by all Grasp records. The grasps of each object are sorted by decreasing quality.
+ */
+class GraspDatabase
+{
+public:
+	/// grasp pose w.r.t. the object frame, pre-grasp width of the gripper, and quality in [0, 1]
+	struct Grasp
+	{
+		float position[3];
+		float orientation[4];  // quaternion: x, y, z, w
+		float width;
+		float quality;
+
+		Eigen::Isometry3d pose() const;
+	};
+
+	/// contiguous grasps of a single object, sorted by decreasing quality
+	struct Range
+	{
+		const Grasp* begin = nullptr;
+		const Grasp* end = nullptr;
+		size_t size() const { return end - begin; }
+	};
+
+	GraspDatabase() = default;
+	~GraspDatabase();
+	GraspDatabase(const GraspDatabase&) = delete;
+	GraspDatabase& operator=(const GraspDatabase&) = delete;
+
+	/// map file (without copying), validating its layout
+	bool open(const std::string& file);
+	void close();
+
+	Range grasps(const std::string& object) const;
+	std::vector<std::string> objects() const;
+
+	/// write grasps per object (sorted on the fly) to file
+	static bool write(const std::string& file, const std::map<std::string, std::vector<Grasp>>& grasps);
+
+private:
+	void* data_ = nullptr;
+	size_t size_ = 0;
+	std::map<std::string, Range> objects_;
+};
+
+/** Spawn grasps of an object from a GraspDatabase in order of decreasing quality
+ *
+ * Grasp poses are spawned as target_pose w.r.t. the object frame (e.g. for ComputeIK), with costs
+ * quality_weight * (1 - quality). Grasps can be filtered by quality and by their approach direction
+ * (z-axis of the grasp frame) given the current object pose. The pre-grasp width is provided as
+ * grasp_width property of the spawned states.
+ */
+class GenerateDatabaseGrasps : public GeneratePose
+{
+public:
+	GenerateDatabaseGrasps(const std::string& name = "generate database grasps");
+
+	void init(const core::RobotModelConstPtr& robot_model) override;
+	void compute() override;
+
+	void setDatabase(const GraspDatabaseConstPtr& database) { setProperty("database", database); }
+	void setObject(const std::string& object) { setProperty("object", object); }
+	void setMaxGrasps(uint32_t num) { setProperty("max_grasps", num); }
+	void setMinQuality(double quality) { setProperty("min_quality", quality); }
+	void setQualityWeight(double weight) { setProperty("quality_weight", weight); }
+	/// only accept grasps approaching along direction (planning frame) within max_angle
+	void setApproachDirection(const Eigen::Vector3d& direction, double max_angle) {
+		setProperty("approach_direction", direction);
+		setProperty("max_approach_angle", max_angle);
+	}
+};
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
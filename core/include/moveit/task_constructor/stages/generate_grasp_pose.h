@@ -39,6 +39,7 @@
 #pragma once
 
 #include <moveit/task_constructor/stages/generate_pose.h>
+#include <moveit/task_constructor/utils.h>
 
 namespace moveit {
 namespace task_constructor {
@@ -49,12 +50,20 @@ class GenerateGraspPose : public GeneratePose
 public:
 	GenerateGraspPose(const std::string& name = "generate grasp pose");
 
+	void reset() override;
+	void regenerate() override;
 	void init(const core::RobotModelConstPtr& robot_model) override;
+	bool canCompute() const override;
 	void compute() override;
 
 	void setEndEffector(const std::string& eef) { setProperty("eef", eef); }
 	void setObject(const std::string& object) { setProperty("object", object); }
 	void setAngleDelta(double delta) { setProperty("angle_delta", delta); }
+	/** spawn only num angle samples per compute(), in low-discrepancy order (0: all samples at once)
+	 *
+	 * Wrapped into ComputeIK, further samples are generated only when ComputeIK asks for more targets.
+	 */
+	void setSamplesPerCompute(uint32_t num) { setProperty("samples_per_compute", num); }
 
 	void setPreGraspPose(const std::string& pregrasp) { properties().set("pregrasp", pregrasp); }
 	void setPreGraspPose(const moveit_msgs::RobotState& pregrasp) { properties().set("pregrasp", pregrasp); }
@@ -63,6 +72,18 @@ public:
 
 protected:
 	void onNewSolution(const SolutionBase& s) override;
+	/// add a grasp candidate rotated about the object's z-axis, its parent indexes the comment
+	static void addSample(PoseCandidates& candidates, std::vector<std::string>& comments, double angle,
+	                      const std::string& comment);
+	/// filter and spawn candidates, exposing the grasp postures
+	void spawnSamples(PoseCandidates& candidates, const std::vector<std::string>& comments,
+	                  const planning_scene::PlanningScenePtr& scene);
+
+	// streaming mode: scene (with pregrasp posture) of currently sampled upstream solution and next sample
+	planning_scene::PlanningScenePtr sample_scene_;
+	size_t next_sample_ = 0;
+	// pregrasp posture, compiled in init()
+	utils::JointPosture pregrasp_;
 };
 }  // namespace stages
 }  // namespace task_constructor
@@ -56,6 +56,15 @@ public:
 	void compute() override;
 
 	void setObject(const std::string& object) { setProperty("object", object); }
+	/** only spawn place poses supported by the given world object
+	 *
+	 * Candidates are pre-filtered with bounding boxes: the object's footprint center needs to lie above the
+	 * support's footprint, while the object's bottom is not lower than the support's top (minus tolerance).
+	 */
+	void setSupportSurface(const std::string& surface, double tolerance = 0.01) {
+		setProperty("support_surface", surface);
+		setProperty("support_tolerance", tolerance);
+	}
 
 protected:
 	void onNewSolution(const SolutionBase& s) override;
@@ -40,6 +40,7 @@
 
 #include <moveit/task_constructor/stage.h>
 #include <moveit/task_constructor/cost_queue.h>
+#include <moveit/task_constructor/pose_candidates.h>
 #include <geometry_msgs/PoseStamped.h>
 
 namespace moveit {
@@ -52,13 +53,29 @@ public:
 	GeneratePose(const std::string& name = "generate pose");
 
 	void reset() override;
+	void regenerate() override;
 	bool canCompute() const override;
 	void compute() override;
 
 	void setPose(const geometry_msgs::PoseStamped& pose) { setProperty("pose", pose); }
+	/** process all candidate poses of a compute() call as a batch, before their InterfaceStates are created
+	 *
+	 * The filter might reject candidates via PoseCandidates::retain() or modify their poses and scores.
+	 * Rejected candidates count as silent failures.
+	 */
+	void setCandidateFilter(const PoseCandidates::Filter& filter) { setProperty("candidate_filter", filter); }
 
 protected:
 	void onNewSolution(const SolutionBase& s) override;
+	/// called for each materialized candidate (given by its index into the filtered batch) before it's spawned
+	using Decorator = std::function<void(size_t index, InterfaceState& state, SubTrajectory& trajectory)>;
+	/** filter candidates and spawn the remaining ones in order, setting their target_pose and cost (from score)
+	 *
+	 * Returns the number of spawned candidates.
+	 */
+	size_t spawnCandidates(PoseCandidates& candidates, const planning_scene::PlanningScenePtr& scene,
+	                       const std::string& marker_name, const Decorator& decorate = Decorator());
+
 	ordered<const SolutionBase*> upstream_solutions_;
 };
 }  // namespace stages
@@ -145,6 +145,15 @@ protected:
 		bool allow;
 	};
 	std::list<CollisionMatrixPairs> collision_matrix_edits_;
+	// collision_matrix_edits_ coalesced into batches, each applying object-wide entries followed by
+	// the last value of each individual pair; (re)built on demand
+	struct CollisionMatrixBatch
+	{
+		std::vector<std::pair<std::string, bool>> objects;
+		std::map<std::pair<std::string, std::string>, bool> pairs;
+	};
+	std::vector<CollisionMatrixBatch> collision_matrix_batches_;
+	bool collision_matrix_coalesced_ = false;
 	ApplyCallback callback_;
 
 protected:
@@ -153,7 +162,8 @@ protected:
 	void processCollisionObject(planning_scene::PlanningScene& scene, const moveit_msgs::CollisionObject& object);
 	void attachObjects(planning_scene::PlanningScene& scene, const std::pair<std::string, std::pair<Names, bool>>& pair,
 	                   bool invert);
-	void allowCollisions(planning_scene::PlanningScene& scene, const CollisionMatrixPairs& pairs, bool invert);
+	void allowCollisions(planning_scene::PlanningScene& scene, const CollisionMatrixBatch& batch, bool invert);
+	void coalesceCollisionMatrixEdits();
 };
 
 inline void ModifyPlanningScene::attachObject(const std::string& object, const std::string& link) {
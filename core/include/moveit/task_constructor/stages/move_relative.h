@@ -43,6 +43,7 @@
 #include <moveit_msgs/Constraints.h>
 #include <geometry_msgs/TwistStamped.h>
 #include <geometry_msgs/Vector3Stamped.h>
+#include <eigen_stl_containers/eigen_stl_containers.h>
 
 namespace moveit {
 namespace core {
@@ -93,13 +94,41 @@ public:
 	/// move specified joint variables by given amount
 	void setDirection(const std::map<std::string, double>& joint_deltas) { setProperty("direction", joint_deltas); }
 
+	/// alternative translation directions, e.g. several approach directions
+	using Directions = std::vector<geometry_msgs::Vector3Stamped>;
+	/// translate link along the first feasible direction (in order), planned in parallel by a CartesianPath planner
+	void setDirections(const Directions& directions) { setProperty("direction", directions); }
+
+	std::vector<solvers::PlannerInterfaceConstPtr> planners() const override { return { planner_ }; }
+	/// reuse previous trajectories for (nearly) identical requests
+	bool enableWarmStart(WarmStartCache& cache) override;
+
 protected:
 	// return false if trajectory shouldn't be stored
 	bool compute(const InterfaceState& state, planning_scene::PlanningScenePtr& scene, SubTrajectory& trajectory,
 	             Interface::Direction dir) override;
+	// plan to alternative targets, returning the index of the first feasible one or -1
+	int planCandidates(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	                   const EigenSTL::vector_Isometry3d& targets, const moveit::core::JointModelGroup* jmg,
+	                   double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	                   const moveit_msgs::Constraints& path_constraints);
+	// resolve ik_frame to robot link and its global pose, reusing the link lookup of previous calls
+	bool resolveIKFrame(const planning_scene::PlanningScene& scene, const moveit::core::JointModelGroup* jmg,
+	                    SolutionBase& solution, const moveit::core::LinkModel*& link, Eigen::Isometry3d& ik_pose_world);
 
 protected:
 	solvers::PlannerInterfacePtr planner_;
+
+	/// ik_frame resolved for a group, valid for all states as long as it refers to robot links only
+	struct IKFrame
+	{
+		const moveit::core::JointModelGroup* jmg = nullptr;
+		std::string frame_id;
+		const moveit::core::LinkModel* link = nullptr;
+		// frame w.r.t. link (unaligned, as the stage is not allocated with Eigen's aligned new)
+		Eigen::Transform<double, 3, Eigen::Isometry, Eigen::DontAlign> offset;
+	};
+	IKFrame ik_frame_;
 };
 }  // namespace stages
 }  // namespace task_constructor
@@ -40,10 +40,13 @@
 
 #include <moveit/task_constructor/stage.h>
 #include <moveit/task_constructor/solvers/planner_interface.h>
+#include <moveit/task_constructor/utils.h>
 #include <moveit_msgs/Constraints.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/PointStamped.h>
 
+#include <unordered_map>
+
 namespace moveit {
 namespace core {
 class RobotState;
@@ -88,14 +91,33 @@ public:
 	/// move joints by name to their mapped target value
 	void setGoal(const std::map<std::string, double>& joints);
 
+	/// alternative goals, each of them of a type accepted by setGoal()
+	using GoalSet = std::vector<boost::any>;
+	/// plan to all goals (in parallel), yielding a solution for each reachable one
+	void setGoals(const GoalSet& goals) { setProperty("goal", goals); }
+	/// number of goals of a GoalSet planned for in parallel (raising the num_instances of a PipelinePlanner)
+	void setNumThreads(uint32_t num_threads) { setProperty("num_threads", num_threads); }
+
 	void setPathConstraints(moveit_msgs::Constraints path_constraints) {
 		setProperty("path_constraints", std::move(path_constraints));
 	}
 
+	std::vector<solvers::PlannerInterfaceConstPtr> planners() const override { return { planner_ }; }
+	/// reuse previous trajectories for (nearly) identical requests
+	bool enableWarmStart(WarmStartCache& cache) override;
+
+	void computeForward(const InterfaceState& from) override;
+	void computeBackward(const InterfaceState& to) override;
+
 protected:
 	// return false if trajectory shouldn't be stored
 	bool compute(const InterfaceState& state, planning_scene::PlanningScenePtr& scene, SubTrajectory& trajectory,
 	             Interface::Direction dir) override;
+	// plan for a single goal, optionally releasing the task's lock while planning
+	bool computeGoal(const InterfaceState& state, const boost::any& goal, planning_scene::PlanningScenePtr& scene,
+	                 SubTrajectory& trajectory, Interface::Direction dir, bool unlock);
+	template <Interface::Direction dir>
+	void computeGoalSet(const InterfaceState& state, const GoalSet& goals);
 	bool getJointStateGoal(const boost::any& goal, const core::JointModelGroup* jmg, moveit::core::RobotState& state);
 	bool getPoseGoal(const boost::any& goal, const planning_scene::PlanningScenePtr& scene,
 	                 Eigen::Isometry3d& target_eigen);
@@ -104,6 +126,8 @@ protected:
 
 protected:
 	solvers::PlannerInterfacePtr planner_;
+	// joint-space goals compiled in init(), identified by their (serialized) value
+	std::unordered_map<std::string, utils::JointPosture> compiled_goals_;
 };
 }  // namespace stages
 }  // namespace task_constructor
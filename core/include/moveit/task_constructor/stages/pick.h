@@ -71,6 +71,7 @@ class PickPlaceBase : public SerialContainer
 	Stage* grasp_stage_ = nullptr;
 	Stage* approach_stage_ = nullptr;
 	Stage* lift_stage_ = nullptr;
+	bool forward_;
 
 public:
 	PickPlaceBase(Stage::pointer&& grasp_stage, const std::string& name, bool forward);
@@ -86,6 +87,13 @@ public:
 
 	void setLiftPlace(const geometry_msgs::TwistStamped& motion, double min_distance, double max_distance);
 	void setLiftPlace(const std::map<std::string, double>& joints);
+
+	/** reject IK solutions of the grasp stage whose approach / retract motion (of min_distance) is infeasible
+	 *
+	 * The check runs the Cartesian solver from the IK solution before its scene and state are created.
+	 * Only Cartesian motions are checked. Requires a grasp stage exposing ComputeIK's ik_filter, like SimpleGrasp.
+	 */
+	void setApproachPrecheck(bool flag) { setProperty("approach_precheck", flag); }
 };
 
 /// specialization of PickPlaceBase to realize picking
@@ -37,6 +37,8 @@
 
 #include <moveit/task_constructor/container.h>
 
+#include <memory>
+
 namespace moveit {
 namespace core {
 MOVEIT_CLASS_FORWARD(RobotState);
@@ -52,6 +54,9 @@ namespace stages {
  * All solutions of the wrapped class are passed to predicate.
  * Solutions are accepted if predicate(s) == true.
  * Rejected solutions are forwarded as failures with an optional comment
+ *
+ * Multiple predicates are evaluated in order of increasing expense, stopping at the first rejection.
+ * Optionally, predicates are evaluated asynchronously on a pool of threads.
  */
 class PredicateFilter : public WrapperBase
 {
@@ -59,13 +64,36 @@ public:
 	using Predicate = std::function<bool(const SolutionBase&, std::string&)>;
 
 	PredicateFilter(const std::string& name, Stage::pointer&& child = Stage::pointer());
+	~PredicateFilter() override;
 
+	void reset() override;
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	bool canCompute() const override;
+	void compute() override;
 
 	void onNewSolution(const SolutionBase& s) override;
 
 	void setPredicate(const Predicate& p) { setProperty("predicate", p); }
 	void setIgnoreFilter(bool ignore) { setProperty("ignore_filter", ignore); }
+
+	/// add another predicate; predicates are evaluated by increasing expense (the predicate property has expense 1)
+	void addPredicate(const Predicate& p, double expense = 1.0) { predicates_.emplace_back(expense, p); }
+	/// evaluate predicates on this many threads (0: synchronously within onNewSolution())
+	void setNumThreads(uint32_t num_threads) { setProperty("num_threads", num_threads); }
+	/// forward asynchronously filtered solutions in input order, or as soon as they are evaluated
+	void setKeepOrder(bool keep_order) { setProperty("keep_order", keep_order); }
+
+protected:
+	// evaluate predicates (thread-safe)
+	bool evaluate(const SolutionBase& s, std::string& comment) const;
+	// lift evaluated solutions, waiting for one if requested
+	void liftEvaluated(bool wait);
+
+	std::vector<std::pair<double, Predicate>> predicates_;
+	std::vector<Predicate> ordered_predicates_;  // all predicates by expense, resolved in init()
+
+	struct AsyncEvaluation;
+	std::unique_ptr<AsyncEvaluation> async_;
 };
 }  // namespace stages
 }  // namespace task_constructor
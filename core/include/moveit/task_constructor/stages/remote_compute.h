@@ -0,0 +1,113 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Offload computation of a stage to remote worker nodes
+*/
+
+#pragma once
+
+#include <moveit/task_constructor/container.h>
+#include <moveit_task_constructor_msgs/ComputeStage.h>
+
+#include <ros/node_handle.h>
+#include <ros/service_client.h>
+#include <ros/service_server.h>
+
+#include <functional>
+#include <map>
+
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(RobotModel);
+}
+}  // namespace moveit
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+/** Wrapper computing its (propagating) child on remote worker nodes
+ *
+ * Instead of computing the wrapped stage locally, the scene of each incoming state
+ * is sent together with the child's properties to one of the worker services,
+ * which are used round-robin. Returned solutions are fed back as solutions of the child.
+ * Workers are implemented by RemoteComputeServer.
+ */
+class RemoteCompute : public WrapperBase
+{
+public:
+	RemoteCompute(const std::string& name = "remote compute", Stage::pointer&& child = Stage::pointer());
+
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	bool canCompute() const override;
+	void compute() override;
+	void onNewSolution(const SolutionBase& s) override;
+
+	/// names of worker services (ComputeStage.srv)
+	void setWorkers(const std::vector<std::string>& workers) { setProperty("workers", workers); }
+	void setMaxSolutions(uint32_t max_solutions) { setProperty("max_solutions", max_solutions); }
+
+private:
+	std::vector<ros::ServiceClient> clients_;
+	size_t next_client_ = 0;
+};
+
+/** Worker service computing stages on behalf of RemoteCompute
+ *
+ * Stages are created by per-name factories and planned within a temporary task,
+ * starting from (or ending at) the received scene.
+ */
+class RemoteComputeServer
+{
+public:
+	using StageFactory = std::function<Stage::pointer()>;
+
+	RemoteComputeServer(const moveit::core::RobotModelConstPtr& robot_model,
+	                    const std::string& service_name = "compute_stage");
+
+	/// register factory for the stage name used by RemoteCompute's wrapped child
+	void add(const std::string& stage_name, StageFactory&& factory);
+
+	bool compute(moveit_task_constructor_msgs::ComputeStage::Request& req,
+	             moveit_task_constructor_msgs::ComputeStage::Response& res);
+
+private:
+	moveit::core::RobotModelConstPtr robot_model_;
+	std::map<std::string, StageFactory> factories_;
+	ros::NodeHandle nh_;
+	ros::ServiceServer server_;
+};
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,252 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    containers with a child layout fixed at compile time
+*/
+
+#pragma once
+
+#include <moveit/task_constructor/container.h>
+
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Interface flags of a stage type, as far as they are known at compile time
+ *
+ * The value is 0 if the interface is only determined at runtime, e.g. for PropagatingEitherWay.
+ * Specialize this trait for custom stage types to include them into the compile-time checks.
+ */
+template <typename T, typename = void>
+struct StaticInterface
+  : std::integral_constant<unsigned, std::is_base_of<Generator, T>::value ?
+                                         GENERATE :
+                                         std::is_base_of<Connecting, T>::value ?
+                                         CONNECT :
+                                         std::is_base_of<PropagatingForward, T>::value ?
+                                         PROPAGATE_FORWARDS :
+                                         std::is_base_of<PropagatingBackward, T>::value ? PROPAGATE_BACKWARDS : 0u>
+{};
+
+namespace static_detail {
+
+template <bool... B>
+struct bool_pack
+{};
+template <bool... B>
+struct all_of : std::is_same<bool_pack<true, B...>, bool_pack<B..., true>>
+{};
+
+/// can a stage with interface next follow a stage with interface prev in a serial container?
+constexpr bool chainable(unsigned prev, unsigned next) {
+	return !prev || !next ||
+	       (bool(prev & WRITES_NEXT_START) == bool(next & READS_START) &&
+	        bool(next & WRITES_PREV_END) == bool(prev & READS_END));
+}
+
+template <unsigned... F>
+struct chain : std::true_type
+{};
+template <unsigned A, unsigned B, unsigned... R>
+struct chain<A, B, R...> : std::integral_constant<bool, chainable(A, B) && chain<B, R...>::value>
+{};
+
+/// interface of a serial chain: start-side flags of the first stage, end-side flags of the last one
+template <unsigned... F>
+struct serial;
+template <unsigned F>
+struct serial<F> : std::integral_constant<unsigned, F>
+{};
+template <unsigned A, unsigned B, unsigned... R>
+struct serial<A, B, R...>
+  : std::integral_constant<unsigned, A && serial<B, R...>::value ?
+                                         (A & (READS_START | WRITES_PREV_END)) |
+                                             (serial<B, R...>::value & (READS_END | WRITES_NEXT_START)) :
+                                         0u>
+{};
+
+/// interface shared by parallel children: ~0u signals a conflict
+template <unsigned... F>
+struct parallel;
+template <unsigned F>
+struct parallel<F> : std::integral_constant<unsigned, F>
+{};
+template <unsigned A, unsigned B, unsigned... R>
+struct parallel<A, B, R...>
+  : std::integral_constant<unsigned, parallel<B, R...>::value == ~0u ?
+                                         ~0u :
+                                         !A ? parallel<B, R...>::value :
+                                              !parallel<B, R...>::value || parallel<B, R...>::value == A ? A : ~0u>
+{};
+}  // namespace static_detail
+
+/** Base class of containers whose children are fixed at compile time
+ *
+ * All children are default-constructed and inserted on construction. They remain accessible with their
+ * concrete type via get<I>(), without any lookup by name or dynamic_cast.
+ * Only the layout is fixed: planning still runs through the virtual Stage interface and the
+ * runtime property and interface machinery, exactly as for a dynamically composed container.
+ * Don't remove children from such a container: the typed accessors would dangle.
+ */
+template <typename Container, typename... Stages>
+class StaticContainer : public Container
+{
+	static_assert(sizeof...(Stages) > 0, "static containers need at least one child");
+	static_assert(static_detail::all_of<std::is_base_of<Stage, Stages>::value...>::value,
+	              "children of static containers need to be stages");
+	static_assert(static_detail::all_of<std::is_default_constructible<Stages>::value...>::value,
+	              "children of static containers need to be default-constructible");
+
+public:
+	using stage_types = std::tuple<Stages...>;
+
+	template <typename... Args>
+	StaticContainer(Args&&... args) : Container(std::forward<Args>(args)...) {
+		construct(std::index_sequence_for<Stages...>());
+	}
+
+	/// typed access to the I-th child
+	template <std::size_t I>
+	std::tuple_element_t<I, stage_types>& get() {
+		return *std::get<I>(stages_);
+	}
+	template <std::size_t I>
+	const std::tuple_element_t<I, stage_types>& get() const {
+		return *std::get<I>(stages_);
+	}
+
+	/** Declare property name of type T and let all children declaring it inherit its value
+	 *
+	 * Throws Property::type_error immediately if a child declared the property with another type,
+	 * instead of failing only when planning.
+	 */
+	template <typename T>
+	void bind(const std::string& name) {
+		this->properties().template declare<T>(name);
+		bindChildren<T>(name, std::index_sequence_for<Stages...>());
+	}
+	template <typename T>
+	void bind(const std::string& name, const T& value) {
+		bind<T>(name);
+		this->properties().set(name, value);
+	}
+
+private:
+	template <std::size_t... I>
+	void construct(std::index_sequence<I...> /*unused*/) {
+		(void)std::initializer_list<int>{ (insertChild<I>(), 0)... };
+	}
+	template <std::size_t I>
+	void insertChild() {
+		auto stage = std::make_unique<std::tuple_element_t<I, stage_types>>();
+		std::get<I>(stages_) = stage.get();
+		Container::insert(std::move(stage));
+	}
+
+	template <typename T, std::size_t... I>
+	void bindChildren(const std::string& name, std::index_sequence<I...> /*unused*/) {
+		(void)std::initializer_list<int>{ (bindChild<T>(*std::get<I>(stages_), name), 0)... };
+	}
+	template <typename T>
+	static void bindChild(Stage& child, const std::string& name) {
+		PropertyMap& props = child.properties();
+		if (!props.hasProperty(name))
+			return;
+		props.handle<T>(name);  // throws on type mismatch
+		props.configureInitFrom(Stage::PARENT, { name });
+	}
+
+	std::tuple<Stages*...> stages_;
+};
+
+/** SerialContainer with a fixed sequence of children
+ *
+ * Adjacent children with incompatible interfaces, e.g. two generators, are rejected at compile time.
+ */
+template <typename... Stages>
+class StaticSerial : public StaticContainer<SerialContainer, Stages...>
+{
+	static_assert(static_detail::chain<StaticInterface<Stages>::value...>::value,
+	              "adjacent children of StaticSerial have incompatible interfaces");
+
+public:
+	StaticSerial(const std::string& name = "serial container") : StaticContainer<SerialContainer, Stages...>(name) {}
+};
+
+/** Alternatives with a fixed set of children
+ *
+ * Children with different interfaces are rejected at compile time.
+ */
+template <typename... Stages>
+class StaticAlternatives : public StaticContainer<Alternatives, Stages...>
+{
+	static_assert(static_detail::parallel<StaticInterface<Stages>::value...>::value != ~0u,
+	              "children of StaticAlternatives have incompatible interfaces");
+
+public:
+	StaticAlternatives(const std::string& name = "alternatives") : StaticContainer<Alternatives, Stages...>(name) {}
+};
+
+/** Wrapper W around a default-constructed child of type Child, e.g. Wrapped<ComputeIK, GenerateGraspPose>
+ *
+ * W needs to provide a constructor W(name, Stage::pointer&& child).
+ */
+template <typename W, typename Child>
+class Wrapped : public W
+{
+	static_assert(std::is_base_of<WrapperBase, W>::value, "Wrapped requires a wrapper type");
+
+public:
+	Wrapped(const std::string& name = "wrapper") : W(name, std::make_unique<Child>()) {}
+
+	Child& child() { return static_cast<Child&>(*this->wrapped()); }
+	const Child& child() const { return static_cast<const Child&>(*this->wrapped()); }
+};
+
+template <typename... Stages>
+struct StaticInterface<StaticSerial<Stages...>> : static_detail::serial<StaticInterface<Stages>::value...>
+{};
+template <typename... Stages>
+struct StaticInterface<StaticAlternatives<Stages...>> : static_detail::parallel<StaticInterface<Stages>::value...>
+{};
+/// wrappers pass through the interface of their child
+template <typename W, typename Child>
+struct StaticInterface<Wrapped<W, Child>> : StaticInterface<Child>
+{};
+}  // namespace task_constructor
+}  // namespace moveit
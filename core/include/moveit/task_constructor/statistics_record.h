@@ -0,0 +1,91 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Persist stage statistics across planning processes
+*/
+
+#pragma once
+
+#include <moveit_task_constructor_msgs/LatencyHistogram.h>
+#include <moveit_task_constructor_msgs/StageStatisticsRecord.h>
+#include <moveit/macros/class_forward.h>
+
+#include <map>
+#include <string>
+
+namespace moveit {
+namespace task_constructor {
+
+class LatencyHistogram;
+class Stage;
+class StagePrivate;
+MOVEIT_CLASS_FORWARD(StatisticsRecord);
+
+void fillHistogram(const LatencyHistogram& h, moveit_task_constructor_msgs::LatencyHistogram& msg);
+/// restore histogram from msg, returns false if msg uses a different bucket layout
+bool restoreHistogram(const moveit_task_constructor_msgs::LatencyHistogram& msg, LatencyHistogram& h);
+
+/** Statistics of stages persisted across planning processes, keyed by their path in the stage tree
+ *
+ * Adaptive heuristics, like TimeoutPolicy or Fallbacks::setAdaptiveOrder(), learn from a stage's latency
+ * histograms and order statistics. Restoring them, these heuristics work from the first planning cycle.
+ * Stages are identified by their names, which thus need to be stable across processes.
+ */
+class StatisticsRecord
+{
+public:
+	/// names of the stage and its ancestors below the root, joined by '/'
+	static std::string stagePath(const Stage& stage);
+
+	/// samples kept per histogram resp. attempts per Fallbacks child: older ones decay, adapting to recent behavior
+	static constexpr size_t MAX_SAMPLES = 10000;
+
+	/// store the current statistics of stage (decayed to MAX_SAMPLES), replacing previously stored ones
+	void collect(const StagePrivate& stage);
+	/// restore stored statistics into stage, if it didn't collect own ones yet (e.g. after reset())
+	bool restore(StagePrivate& stage) const;
+
+	size_t size() const { return stages_.size(); }
+	const moveit_task_constructor_msgs::StageStatisticsRecord* find(const std::string& path) const;
+
+	/// write record to file in a compact binary format, atomically replacing an existing file
+	bool save(const std::string& file) const;
+	/// load record from file (nullptr on failure)
+	static StatisticsRecordPtr load(const std::string& file);
+
+private:
+	std::map<std::string, moveit_task_constructor_msgs::StageStatisticsRecord> stages_;
+};
+}  // namespace task_constructor
+}  // namespace moveit
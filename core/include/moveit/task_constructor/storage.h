@@ -42,6 +42,7 @@
 #include <moveit/macros/class_forward.h>
 #include <moveit/task_constructor/properties.h>
 #include <moveit/task_constructor/cost_queue.h>
+#include <moveit/task_constructor/trajectory_compression.h>
 #include <moveit/task_constructor/utils.h>
 #include <moveit_task_constructor_msgs/Solution.h>
 #include <visualization_msgs/MarkerArray.h>
@@ -49,8 +50,15 @@
 #include <list>
 #include <vector>
 #include <deque>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
 
 namespace planning_scene {
 MOVEIT_CLASS_FORWARD(PlanningScene);
@@ -64,6 +72,7 @@ namespace moveit {
 namespace task_constructor {
 
 class SolutionBase;
+struct SceneUpdate;
 MOVEIT_CLASS_FORWARD(InterfaceState);
 MOVEIT_CLASS_FORWARD(Interface);
 MOVEIT_CLASS_FORWARD(Stage);
@@ -78,6 +87,8 @@ class InterfaceState
 	friend class SolutionBase;  // addIncoming() / addOutgoing() should be called only by SolutionBase
 	friend class Interface;  // allow Interface to set owner_ and priority_
 	friend class ContainerBasePrivate;  // allow setting priority_ for pruning
+	friend struct SceneUpdate;  // allow replacing scene_ for incremental replanning
+	friend class StagePrivate;  // allow releasing scene_ of states of evicted solutions
 
 public:
 	enum Status
@@ -91,33 +102,59 @@ public:
 	/** InterfaceStates are ordered according to two values:
 	 *  Depth of interlinked trajectory parts and accumulated trajectory costs along that path.
 	 *  Preference ordering considers high-depth first and within same depth, minimal cost paths.
+	 *
+	 *  Status, depth, and cost are stored as a pair of precomputed, totally ordered integer keys,
+	 *  such that comparisons don't need to branch over the individual values.
 	 */
-	struct Priority : std::tuple<Status, unsigned int, double>
+	struct Priority
 	{
 		Priority(unsigned int depth, double cost, Status status = ENABLED)
-		  : std::tuple<Status, unsigned int, double>(status, depth, cost) {
+		  : rank_(uint64_t(status) << 32 | uint32_t(~depth)), cost_(costKey(cost)) {
 			assert(std::isfinite(cost));
 		}
 		// Constructor copying depth and cost, but modifying its status
-		Priority(const Priority& other, Status status) : Priority(other.depth(), other.cost(), status) {}
+		Priority(const Priority& other, Status status)
+		  : rank_(uint64_t(status) << 32 | uint32_t(other.rank_)), cost_(other.cost_) {}
 
-		inline Status status() const { return std::get<0>(*this); }
-		inline bool enabled() const { return std::get<0>(*this) == ENABLED; }
+		inline Status status() const { return static_cast<Status>(rank_ >> 32); }
+		inline bool enabled() const { return status() == ENABLED; }
 
-		inline unsigned int depth() const { return std::get<1>(*this); }
-		inline double cost() const { return std::get<2>(*this); }
+		inline unsigned int depth() const { return ~uint32_t(rank_); }
+		inline double cost() const { return costValue(cost_); }
 
 		// add priorities
 		Priority operator+(const Priority& other) const {
 			return Priority(depth() + other.depth(), cost() + other.cost(), std::min(status(), other.status()));
 		}
 		// comparison operators
-		bool operator<(const Priority& rhs) const;
+		inline bool operator==(const Priority& rhs) const { return (rank_ == rhs.rank_) & (cost_ == rhs.cost_); }
+		inline bool operator!=(const Priority& rhs) const { return !(*this == rhs); }
+		inline bool operator<(const Priority& rhs) const {
+			return (rank_ < rhs.rank_) | ((rank_ == rhs.rank_) & (cost_ < rhs.cost_));
+		}
 		inline bool operator>(const Priority& rhs) const { return rhs < *this; }
 		inline bool operator<=(const Priority& rhs) const { return !(rhs < *this); }
 		inline bool operator>=(const Priority& rhs) const { return !(*this < rhs); }
+
+	private:
+		// map cost to an unsigned integer with the same order: flip all bits of negative values, only the sign of others
+		static inline uint64_t costKey(double cost) {
+			cost += 0.0;  // normalize -0.0 to 0.0
+			uint64_t bits;
+			std::memcpy(&bits, &cost, sizeof(bits));
+			return (bits >> 63) ? ~bits : bits | (uint64_t(1) << 63);
+		}
+		static inline double costValue(uint64_t key) {
+			const uint64_t bits = (key >> 63) ? key & ~(uint64_t(1) << 63) : ~key;
+			double cost;
+			std::memcpy(&cost, &bits, sizeof(cost));
+			return cost;
+		}
+
+		uint64_t rank_;  // status (high word) and inverted depth (low word): enabled and deeper states first
+		uint64_t cost_;  // order-preserving bits of cost
 	};
-	using Solutions = std::deque<SolutionBase*>;
+	using Solutions = std::vector<SolutionBase*>;
 
 	/// create an InterfaceState from a planning scene
 	InterfaceState(const planning_scene::PlanningScenePtr& ps);
@@ -126,17 +163,41 @@ public:
 	/// provide an initial priority for the state (for internal use only)
 	InterfaceState(const planning_scene::PlanningSceneConstPtr& ps, const Priority& p);
 
-	/// copy an existing InterfaceState, but not including incoming/outgoing trajectories
+	/** copy an existing InterfaceState, but not including incoming/outgoing trajectories
+	 *
+	 * Copies are cheap: scene and properties are shared until the properties of a copy are modified.
+	 */
 	InterfaceState(const InterfaceState& other);
 	InterfaceState(InterfaceState&& other) = default;
 	InterfaceState& operator=(const InterfaceState& other) = default;
 
 	inline const planning_scene::PlanningSceneConstPtr& scene() const { return scene_; }
+	/** Flatten the scene's chain of diffs if it is deeper than max_depth (0 = unlimited)
+	 *
+	 * The flattened copy shares the collision objects with the original scene.
+	 */
+	void compactScene(size_t max_depth);
+
+	/** hash of the state's content: joint positions and object positions quantized to resolution, and properties
+	 *
+	 * States of equal content (see sameContent()) have equal hashes. The scene is hashed via its attached
+	 * and world objects only, without serializing its diff.
+	 */
+	size_t contentHash(double resolution) const;
+	/** joint positions are equal after quantization, scenes share their parent and deviate in joint positions only,
+	 * and properties are equal
+	 *
+	 * Property values are compared via their serialization. Unserializable values are only equal if shared.
+	 */
+	bool sameContent(const InterfaceState& other, double resolution) const;
 	inline const Solutions& incomingTrajectories() const { return incoming_trajectories_; }
 	inline const Solutions& outgoingTrajectories() const { return outgoing_trajectories_; }
 
-	PropertyMap& properties() { return properties_; }
-	const PropertyMap& properties() const { return properties_; }
+	/// writable access detaches properties shared with copies of this state
+	PropertyMap& properties();
+	/// replace all properties by (copy-on-write) shared ones of other
+	void shareProperties(const InterfaceState& other) { properties_ = other.properties_; }
+	const PropertyMap& properties() const { return properties_ ? *properties_ : emptyProperties(); }
 
 	/// states are ordered by priority
 	inline bool operator<(const InterfaceState& other) const { return this->priority_ < other.priority_; }
@@ -153,12 +214,22 @@ private:
 	// these methods should be only called by SolutionBase::set[Start|End]State()
 	inline void addIncoming(SolutionBase* t) { incoming_trajectories_.push_back(t); }
 	inline void addOutgoing(SolutionBase* t) { outgoing_trajectories_.push_back(t); }
+	// these methods should be only called by SolutionBase::unregisterFromStates()
+	inline void removeIncoming(const SolutionBase* t) { remove(incoming_trajectories_, t); }
+	inline void removeOutgoing(const SolutionBase* t) { remove(outgoing_trajectories_, t); }
+	static void remove(Solutions& solutions, const SolutionBase* t) {
+		auto it = std::find(solutions.begin(), solutions.end(), t);
+		if (it != solutions.end())
+			solutions.erase(it);
+	}
 	// Set new priority without updating the owning interface (USE WITH CARE)
 	inline void setPriority(const Priority& prio) { priority_ = prio; }
+	static const PropertyMap& emptyProperties();
 
 private:
 	planning_scene::PlanningSceneConstPtr scene_;
-	PropertyMap properties_;
+	// copy-on-write, shared with copies of this state, e.g. in the interfaces of nested containers
+	std::shared_ptr<PropertyMap> properties_;
 	/// trajectories which are *timewise before* this state
 	Solutions incoming_trajectories_;
 	/// trajectories which are *timewise after* this state
@@ -211,6 +282,22 @@ public:
 	using UpdateFlags = utils::Flags<Update>;
 	using NotifyFunction = std::function<void(iterator, UpdateFlags)>;
 
+	/// live and historical metrics of the search frontier formed by an interface, see metrics()
+	struct Metrics
+	{
+		size_t states = 0;  ///< states currently in the interface
+		size_t enabled = 0;  ///< ... of which are enabled
+		size_t pruned = 0;  ///< ... of which are pruned
+		unsigned int max_depth = 0;  ///< maximum depth of partial solutions of states since clear()
+		// only tracked if metrics are enabled, see setMetricsEnabled()
+		size_t pending = 0;  ///< states not yet expanded
+		size_t added = 0;  ///< total number of added states
+		size_t expanded = 0;  ///< total number of expanded states
+		double mean_age = 0.0;  ///< mean time [s] from adding a state until its first expansion
+		double max_age = 0.0;  ///< maximum time [s] from adding a state until its first expansion
+		double expansion_rate = 0.0;  ///< expanded states per second since the first state was added
+	};
+
 	class DisableNotify
 	{
 		Interface& if_;
@@ -222,25 +309,100 @@ public:
 	};
 	friend class DisableNotify;
 
+	/** Defer re-sorting and notification of priority updates until destruction
+	 *
+	 * Collects all priority updates, which don't change a state's status, across all interfaces of the current thread.
+	 * On destruction, each affected interface is sorted once and notifications for all of its changed states
+	 * are dispatched thereafter. Status updates are still processed immediately.
+	 * Nested instances are merged into the outermost one.
+	 */
+	class BatchUpdate
+	{
+	public:
+		BatchUpdate();
+		~BatchUpdate();
+
+	private:
+		friend class Interface;
+		struct Change
+		{
+			InterfaceState::Priority old_priority;  // priority before first update
+			bool notify;  // was notification enabled for any of the updates?
+		};
+		using Changes = std::unordered_map<InterfaceState*, Change>;
+
+		void record(Interface* interface, InterfaceState* state, bool notify);
+		/// drop state's deferred update, returns true if other states of interface are still deferred
+		bool forget(Interface* interface, InterfaceState* state);
+
+		static thread_local BatchUpdate* current_;
+		bool active_;  // only the outermost instance is active
+		std::vector<Interface*> interfaces_;  // affected interfaces in order of their first update
+		std::unordered_map<Interface*, Changes> changes_;
+	};
+	friend class BatchUpdate;
+
 	Interface(const NotifyFunction& notify = NotifyFunction());
 
 	/// add a new InterfaceState
 	void add(InterfaceState& state);
+	/** add a batch of new InterfaceStates
+	 *
+	 * All states are sorted into the interface at once. Notifications are dispatched thereafter,
+	 * in order of the given states.
+	 */
+	void add(const std::vector<InterfaceState*>& states);
 
 	/// remove a state from the interface and return it as a one-element list
 	container_type remove(iterator it);
+	/// remove all states, resetting metrics
+	void clear();
 
 	/// update state's priority (and call notify_ if it really has changed)
 	void updatePriority(InterfaceState* state, const InterfaceState::Priority& priority);
 	inline bool notifyEnabled() const { return static_cast<bool>(notify_); }
 
+	/// count effective priority updates across all interfaces of the process (default: false, for performance tests)
+	static void setCountPriorityUpdates(bool enabled);
+	static size_t numPriorityUpdates();
+
+	/// record age and expansion of states in all interfaces of the process (default: false)
+	static void setMetricsEnabled(bool enabled);
+	static bool metricsEnabled();
+	/// mark a state of this interface as expanded by the owning (propagating or connecting) stage
+	/// Only the first expansion of a state counts.
+	void noteExpanded(const InterfaceState& state);
+	/// current metrics, maintained as running aggregates
+	Metrics metrics() const;
+
 private:
 	NotifyFunction notify_;
 
+	// frontier tracking, only if metrics are enabled
+	using Clock = std::chrono::steady_clock;
+	std::unordered_map<const InterfaceState*, Clock::time_point> pending_;  // time each pending state was added
+	Clock::time_point first_added_;
+	size_t num_added_ = 0;
+	size_t num_expanded_ = 0;
+	double total_age_ = 0.0;
+	double max_age_ = 0.0;
+	// live counts, always tracked
+	size_t num_enabled_ = 0;
+	size_t num_pruned_ = 0;
+	unsigned int max_depth_ = 0;
+
+	/// add (sign = 1) or subtract (sign = -1) a state's priority to the live counts
+	void count(const InterfaceState::Priority& priority, int sign);
+	/// sort once after a BatchUpdate and notify about changed states
+	void processBatch(const BatchUpdate::Changes& changes);
+	/// claim ownership of a new state, moving it into container
+	iterator adopt(InterfaceState& state, container_type& container);
+
 	// restrict access to some functions to ensure consistency
 	// (we need to set/unset InterfaceState::owner_)
 	using base_type::erase;
 	using base_type::insert;
+	using base_type::merge;
 	using base_type::moveFrom;
 	using base_type::moveTo;
 	using base_type::remove_if;
@@ -267,6 +429,7 @@ struct TmpSolutionContext;
 /// abstract base class for solutions (primitive and sequences)
 class SolutionBase
 {
+	friend StagePrivate;
 	friend ContainerBasePrivate;
 	friend TmpSolutionContext;
 
@@ -296,19 +459,67 @@ public:
 		const_cast<InterfaceState&>(state).addIncoming(this);
 	}
 
+	/** Remove the solution from the incoming/outgoing trajectories of its start and end state
+	 *
+	 * Required before the solution is disposed while its states remain.
+	 * start() and end() remain valid.
+	 */
+	void unregisterFromStates();
+
 	inline const Stage* creator() const { return creator_; }
 	void setCreator(Stage* creator);
 
 	inline double cost() const { return cost_; }
 	void setCost(double cost);
 	void markAsFailure(const std::string& msg = std::string());
+	/// mark as failure, prepending a message that is only formatted when the comment is accessed
+	void markAsFailure(std::function<std::string()> msg);
+	/// stable category of a failure, under which stages count it (see Stage::failureReasons())
+	void setFailureReason(const std::string& reason) { failure_reason_ = reason; }
+	/** category of a failure: the explicitly set reason or else the first line of the comment up to a colon
+	 *
+	 * Never applies deferred formatters, i.e. only considers the comment formatted so far.
+	 */
+	std::string failureReason() const;
 	inline bool isFailure() const { return !std::isfinite(cost_); }
+	/** COST_PENDING status: cost() is a provisional lower bound, as the stage defers its CostTerm (see lazy cost)
+	 *
+	 * The Task evaluates pending costs once the solution becomes part of its best solution.
+	 */
+	inline bool costPending() const { return cost_pending_; }
+
+	/// comment, applying deferred formatters on first access
+	const std::string& comment() const;
+	/// whether there is a (possibly not yet formatted) comment, without applying deferred formatters
+	bool hasComment() const;
+	/// replace the comment, discarding deferred formatters
+	void setComment(const std::string& comment);
+
+	/// callback modifying the comment, e.g. appending a message
+	using CommentFormatter = std::function<void(std::string&)>;
+	/** Defer formatting of the comment until comment() is accessed, usually when the solution is introspected
+	 *
+	 * Like marker generators, formatters must own (copies of) all the data they refer to.
+	 * Multiple formatters are applied in the order they were added.
+	 */
+	void formatComment(CommentFormatter formatter);
 
-	const std::string& comment() const { return comment_; }
-	void setComment(const std::string& comment) { comment_ = comment; }
+	/// markers of this solution, generating deferred ones on first access
+	std::deque<visualization_msgs::Marker>& markers();
+	const std::deque<visualization_msgs::Marker>& markers() const;
 
-	auto& markers() { return markers_; }
-	const auto& markers() const { return markers_; }
+	/// callback appending markers to the given list
+	using MarkerGenerator = std::function<void(std::deque<visualization_msgs::Marker>&)>;
+	/** Defer marker generation until markers() are accessed, usually when the solution is introspected
+	 *
+	 * The generator is called at most once, possibly from another thread and long after the stage's compute().
+	 * Thus it must own (copies of) all the data it refers to. If markers are disabled, it is dropped immediately.
+	 */
+	void addMarkers(MarkerGenerator generator);
+
+	/// globally enable/disable solution markers (enabled by default), e.g. to skip their cost in headless runs
+	static void setMarkersEnabled(bool enabled);
+	static bool markersEnabled();
 
 	/// append this solution to Solution msg
 	virtual void fillMessage(moveit_task_constructor_msgs::Solution& solution,
@@ -317,6 +528,12 @@ public:
 
 	/// required to dispatch to type-specific CostTerm methods via vtable
 	virtual double computeCost(const CostTerm& cost, std::string& comment) const = 0;
+	/** computeCost(), evaluating each CostTerm only once for this solution
+	 *
+	 * Composite and wrapper costs reuse the values already computed for their (shared) sub solutions.
+	 * Like solutions, cost terms are identified by address and need to outlive the solution.
+	 */
+	double memoizedCost(const CostTerm& cost, std::string& comment) const;
 
 	/// order solutions by their cost
 	bool operator<(const SolutionBase& other) const { return this->cost_ < other.cost_; }
@@ -330,10 +547,40 @@ private:
 	Stage* creator_;
 	// associated cost
 	double cost_;
+	// cost provided by the stage while the CostTerm evaluation is deferred
+	double deferred_cost_ = 0.0;
+	bool cost_pending_ = false;
 	// comment for this solution, e.g. explanation of failure
-	std::string comment_;
+	mutable std::string comment_;
+	// deferred formatters, which are applied to comment_ on first access
+	mutable std::vector<CommentFormatter> comment_formatters_;
+	// category of a failure, derived from the comment if empty
+	std::string failure_reason_;
+	// serializes the formatting of this solution's comment, a fresh lock for every copy
+	struct CommentLock
+	{
+		CommentLock() = default;
+		CommentLock(const CommentLock& /*unused*/) {}
+		CommentLock& operator=(const CommentLock& /*unused*/) { return *this; }
+		std::mutex mutex;
+	};
+	mutable CommentLock comment_lock_;
+	void formatComments() const;
 	// markers for this solution, e.g. target frame or collision indicators
-	std::deque<visualization_msgs::Marker> markers_;
+	mutable std::deque<visualization_msgs::Marker> markers_;
+	// deferred markers, which are appended to markers_ on first access
+	mutable std::vector<MarkerGenerator> marker_generators_;
+	void generateMarkers() const;
+	/// drop generated and deferred markers, returning the generated ones
+	std::deque<visualization_msgs::Marker> dropMarkers() const;
+	// values (and comments) of cost terms evaluated for this solution, typically only one or two
+	struct MemoizedCost
+	{
+		const CostTerm* term;
+		double cost;
+		std::string comment;
+	};
+	mutable std::vector<MemoizedCost> memoized_costs_;
 
 	// begin and end InterfaceState of this solution/trajectory
 	const InterfaceState* start_ = nullptr;
@@ -350,9 +597,77 @@ public:
 	    double cost = 0.0, std::string comment = "")
 	  : SolutionBase(nullptr, cost, std::move(comment)), trajectory_(trajectory) {}
 
-	robot_trajectory::RobotTrajectoryConstPtr trajectory() const { return trajectory_; }
-	void setTrajectory(const robot_trajectory::RobotTrajectoryPtr& t) { trajectory_ = t; }
+	/// trajectory of this solution, approximately rebuilt from the compressed representation if needed (see compress())
+	robot_trajectory::RobotTrajectoryConstPtr trajectory() const;
+	/// number of waypoints of trajectory(), without rebuilding a compressed trajectory
+	size_t waypointCount() const;
+	void setTrajectory(const robot_trajectory::RobotTrajectoryPtr& t) {
+		std::atomic_store(&trajectory_, robot_trajectory::RobotTrajectoryConstPtr(t));
+		std::atomic_store(&compressed_, CompressedTrajectoryConstPtr());
+		dropMessageCache();
+		shared_data_.clear();
+	}
+
+	/** replace the trajectory by a compressed one, reproducing all variables within tolerance
+	 *
+	 * Cached messages and shared data are dropped. trajectory() returns a rebuilt trajectory afterwards,
+	 * which only approximates the original one. Hence, Task::execute() refuses compressed solutions.
+	 * Returns false if the trajectory wasn't compressed (already compressed, too short, or out of range).
+	 */
+	bool compress(double tolerance);
+	CompressedTrajectoryConstPtr compressed() const { return std::atomic_load(&compressed_); }
+
+	/** per-trajectory data shared between cost terms, computed by compute() on first request of key
+	 *
+	 * Keys should be prefixed by the kind of data to avoid clashes. Failures (nullptr) are not cached.
+	 */
+	template <typename T>
+	std::shared_ptr<const T> sharedData(const std::string& key,
+	                                    const std::function<std::shared_ptr<const T>()>& compute) const {
+		auto it = shared_data_.find(key);
+		if (it != shared_data_.end())
+			return std::static_pointer_cast<const T>(it->second);
+		std::shared_ptr<const T> data = compute();
+		if (data)
+			shared_data_[key] = data;
+		return data;
+	}
+
+	/** positions of frame at all waypoints (see utils::computeFramePositions), shared by link-based cost terms
+	 *
+	 * Returns nullptr if there is no trajectory or the frame is unknown.
+	 */
+	std::shared_ptr<const Eigen::Matrix3Xd> framePositions(const std::string& frame) const;
+	/// positions of all variables at all waypoints (variables x waypoints), nullptr if there is no trajectory
+	std::shared_ptr<const Eigen::MatrixXd> variablePositions() const;
+
+	/** VALIDATION_PENDING status: the trajectory was planned with lazy validation and wasn't collision-checked yet
+	 *
+	 * The Task validates pending trajectories once they become part of its best solution.
+	 */
+	bool validationPending() const { return validation_pending_; }
+	void setValidationPending(bool pending) { validation_pending_ = pending; }
+
+	/// full time parameterization of trajectory(), whose timing is only estimated so far
+	using TimeParameterizer = std::function<bool(robot_trajectory::RobotTrajectory&)>;
+	/** defer time parameterization of the trajectory until the solution's message is created for publishing
+	 *
+	 * Meanwhile, trajectory() keeps its estimated timing, e.g. for ranking by cost terms.
+	 * An empty function applies the trajectory's timing as is.
+	 */
+	void deferTimeParameterization(TimeParameterizer timing) {
+		pending_timing_ = std::move(timing);
+		dropMessageCache();
+	}
+	bool timeParameterizationPending() const { return static_cast<bool>(pending_timing_); }
+	/// copy of trajectory() with the deferred time parameterization applied (nullptr if it fails or there is none)
+	robot_trajectory::RobotTrajectoryPtr timedTrajectory() const;
 
+	/** append this solution to msg, converting trajectory and end scene only once (until either changes)
+	 *
+	 * If the deferred time parameterization fails, the estimated timing isn't published:
+	 * the message's trajectory is left empty and its info reports a failure (infinite cost).
+	 */
 	void fillMessage(moveit_task_constructor_msgs::Solution& msg, Introspection* introspection = nullptr) const override;
 
 	double computeCost(const CostTerm& cost, std::string& comment) const override;
@@ -364,8 +679,23 @@ public:
 	}
 
 private:
-	// actual trajectory, might be empty
+	// actual trajectory, might be empty, accessed atomically
 	robot_trajectory::RobotTrajectoryConstPtr trajectory_;
+	// replaces trajectory_ after compress(), accessed atomically
+	CompressedTrajectoryConstPtr compressed_;
+	bool validation_pending_ = false;
+	TimeParameterizer pending_timing_;  // applied to a copy of the trajectory by fillMessage()
+	// converted trajectory and scene_diff (info is filled per message), accessed atomically
+	struct MessageCache
+	{
+		moveit_task_constructor_msgs::SubTrajectory msg;
+		std::weak_ptr<const planning_scene::PlanningScene> end_scene;  // converted scene, replaced e.g. by replan()
+		bool timing_failed = false;  // deferred time parameterization failed: msg has no trajectory
+	};
+	mutable std::shared_ptr<const MessageCache> msg_cache_;
+	void dropMessageCache() const { std::atomic_store(&msg_cache_, std::shared_ptr<const MessageCache>()); }
+	// data computed by cost terms (i.e. while holding the task's planning lock), see sharedData()
+	mutable std::unordered_map<std::string, std::shared_ptr<const void>> shared_data_;
 };
 MOVEIT_CLASS_FORWARD(SubTrajectory);
 
@@ -392,12 +722,34 @@ public:
 
 	const container_type& solutions() const { return subsolutions_; }
 
+	/// primitive SubTrajectory of a flattened sequence
+	struct Leaf
+	{
+		const SubTrajectory* trajectory;
+		double cost_offset;  // accumulated cost of all previous leaves
+		size_t waypoint_offset;  // accumulated number of waypoints of all previous leaves
+	};
+	struct Flattened
+	{
+		std::vector<Leaf> leaves;  // in execution order
+		double cost = 0.0;  // accumulated cost of all leaves
+		size_t waypoints = 0;  // accumulated number of waypoints of all leaves
+	};
+	/** primitive sub trajectories of this sequence, resolving nested sequences and wrapped solutions
+	 *
+	 * Computed on first request and cached thereafter, nested sequences reuse their cached leaves.
+	 * push_back() invalidates the cache (and thus previously returned references).
+	 */
+	const Flattened& flattened() const;
+
 	inline const InterfaceState* internalStart() const { return subsolutions_.front()->start(); }
 	inline const InterfaceState* internalEnd() const { return subsolutions_.back()->end(); }
 
 private:
 	/// series of sub solutions
 	container_type subsolutions_;
+	// flattened leaves, accessed atomically
+	mutable std::shared_ptr<const Flattened> flattened_;
 };
 MOVEIT_CLASS_FORWARD(SolutionSequence);
 
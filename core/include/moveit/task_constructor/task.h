@@ -42,19 +42,27 @@
 #include "container.h"
 
 #include <moveit/task_constructor/introspection.h>
+#include <moveit/task_constructor/solution_stream.h>
+#include <moveit/task_constructor/task_executor.h>
 #include <moveit_task_constructor_msgs/Solution.h>
 
 #include <moveit/macros/class_forward.h>
 
 #include <moveit_msgs/MoveItErrorCodes.h>
+#include <moveit_msgs/PlanningScene.h>
 #include <moveit/utils/moveit_error_code.h>
 
+#include <future>
+
 namespace moveit {
 namespace core {
 MOVEIT_CLASS_FORWARD(RobotModel);
 MOVEIT_CLASS_FORWARD(RobotState);
 }  // namespace core
 }  // namespace moveit
+namespace plan_execution {
+class PlanExecution;
+}
 
 namespace moveit {
 namespace task_constructor {
@@ -62,6 +70,7 @@ namespace task_constructor {
 MOVEIT_CLASS_FORWARD(Stage);
 MOVEIT_CLASS_FORWARD(ContainerBase);
 MOVEIT_CLASS_FORWARD(Task);
+class StatisticsRecord;
 
 class TaskPrivate;
 /** A Task is the root of a tree of stages.
@@ -86,7 +95,7 @@ public:
 	const moveit::core::RobotModelConstPtr& getRobotModel() const;
 	/// setting the robot model also resets the task
 	void setRobotModel(const moveit::core::RobotModelConstPtr& robot_model);
-	/// load robot model from given parameter
+	/// load robot model from given parameter, reusing a cached one if available (see RobotModelCache)
 	void loadRobotModel(const std::string& robot_description = "robot_description");
 
 	void add(Stage::pointer&& stage);
@@ -112,6 +121,134 @@ public:
 	using WrapperBase::setTimeout;
 	using WrapperBase::timeout;
 
+	/** set number of threads used for planning (default: 1)
+	 *
+	 * With multiple threads, independent stages compute concurrently.
+	 * SerialContainers and Alternatives are descended, while all other containers are computed as a whole.
+	 * Stages release the task's planning lock only within Stage::ComputeUnlock scopes.
+	 */
+	void setNumThreads(size_t num_threads);
+	size_t numThreads() const;
+
+	/** executor of the task's threads: planning workers, planAsync(), the stall watchdog, and introspection
+	 *
+	 * Several tasks may share an executor, limiting their concurrent computations in total.
+	 * nullptr (default) selects the process-wide TaskExecutor::instance().
+	 * While the task initializes and plans, stages and solvers find it as TaskExecutor::current().
+	 * With a single planning thread, plan() computes in the calling thread, which is not configured.
+	 */
+	void setExecutor(const TaskExecutorPtr& executor);
+	TaskExecutorPtr executor() const;
+	/// limit number of concurrently planning workers of this task (0: unlimited), not applicable to PIPELINED
+	void setMaxConcurrency(size_t max_concurrency);
+	size_t maxConcurrency() const;
+
+	/// strategy to select the next stage to compute
+	enum SchedulingPolicy
+	{
+		RECURSIVE,  ///< recursively compute all children of containers (default)
+		BEST_FIRST,  ///< always compute the stage whose pending job has globally highest priority
+		/** every independently computable stage has its own worker (ignoring setNumThreads()),
+		 *  such that throughput of a chain is limited by its slowest stage, not by the sum of all stages */
+		PIPELINED,
+	};
+	void setSchedulingPolicy(SchedulingPolicy policy);
+	SchedulingPolicy schedulingPolicy() const;
+
+	/** branch-and-bound: skip pending jobs that cannot improve on the best solution found so far
+	 *
+	 * A job's cost bound comprises the costs of all solutions it necessarily builds upon
+	 * and, for Connecting stages, the CostTerm::lowerBound() of the connection.
+	 * Assuming non-negative, additive costs, plan(0) still finds the optimal solution,
+	 * but generally won't enumerate all alternatives anymore.
+	 */
+	void enableCostPruning(bool enable = true);
+	bool costPruning() const;
+
+	/** flatten PlanningScene diff chains of new interface states once they exceed the given depth (0 = unlimited)
+	 *
+	 * Long diff chains, e.g. after many ModifyPlanningScene stages, slow down collision checking.
+	 * Flattened scenes share collision objects with their parents, but serialize as complete scenes.
+	 */
+	void setMaxSceneDiffDepth(size_t depth);
+	size_t maxSceneDiffDepth() const;
+
+	/** merge new interface states into earlier ones of the same stage with equal content (0 = disabled)
+	 *
+	 * States are equal if their joint positions match after quantization to resolution and their scenes only
+	 * differ in joint positions from a common parent. A merged state collects the solutions of all its duplicates,
+	 * but is planned from only once by subsequent stages. Its properties remain those of the first state.
+	 */
+	void setStateDeduplication(double resolution);
+	double stateDeduplication() const;
+
+	/// adapt the timeouts of all stages without an own TimeoutPolicy to their successful computations
+	void setTimeoutPolicy(const TimeoutPolicy& policy);
+	const TimeoutPolicy& timeoutPolicy() const;
+	/** watch running compute() calls of all stages for stalls while planning (disabled by default)
+	 *
+	 * A watchdog thread checks the running computations every policy.check_interval seconds.
+	 * Each stall is reported once, as a warning naming the stage path and input state, and as an EventLog::STALL event.
+	 * With policy.preempt, the first stall preempts planning cooperatively, i.e. at the stages' next check.
+	 */
+	void setStallPolicy(const StallPolicy& policy);
+	const StallPolicy& stallPolicy() const;
+	/** warm-start planning from the results of previous runs (disabled by default)
+	 *
+	 * Stages keep caches surviving reset(), which seed the next plan(), e.g. IK with previous solutions,
+	 * and reuse previous trajectories for (nearly) identical planning requests, once revalidated in the current scene.
+	 * Disabling warm starts only stops equipping new stages: stages already equipped keep their caches.
+	 */
+	void setWarmStart(bool enable);
+	bool warmStart() const;
+
+	/// error code of plan() if planning was stopped, because the memory budget was exceeded
+	static constexpr int32_t MEMORY_BUDGET_EXCEEDED = -100;
+	/** limit the estimated memory (in bytes) of all stages during planning (0 = unlimited)
+	 *
+	 * A non-zero budget enables Stage::setMemoryAccounting(). When exceeding 90% of the budget,
+	 * markers and failures are dropped, followed by the worse half of solutions not being part of a parent solution.
+	 * If memory still exceeds the budget, planning stops with MEMORY_BUDGET_EXCEEDED (even if there are solutions).
+	 */
+	void setMemoryBudget(size_t bytes);
+	size_t memoryBudget() const;
+	/** compress trajectories within the given tolerance before dropping anything to meet the memory budget (0 = off)
+	 *
+	 * All but the best solution of each stage are replaced by a compact representation (see CompressedTrajectory),
+	 * which is rebuilt on demand, e.g. for display. As compression is lossy, execute() refuses solutions
+	 * comprising compressed trajectories: plan again without compression to execute them.
+	 */
+	void setTrajectoryCompression(double tolerance);
+	double trajectoryCompression() const;
+	/// memory currently used by all stages of the task (requires memory accounting)
+	MemoryUsage memoryUsage() const;
+	/// format up to max (0: all) most recent events of the process-wide EventLog, naming stages of this task
+	/// Recording is opt-in via EventLog::instance().enable().
+	std::string dumpEvents(size_t max = 0) const;
+
+	/** record each planning run to file (an empty file name disables recording)
+	 *
+	 * std::rand() is reseeded before planning. Its seed, the scenes fetched by CurrentState stages,
+	 * all stage properties, and all planner responses are recorded, to be replayed with setReplay().
+	 */
+	void setRecording(const std::string& file);
+	/** replay planning runs from a file written by setRecording() (an empty file name disables replay)
+	 *
+	 * Returns false if the file could not be loaded. Replay is deterministic for sequential planning.
+	 */
+	bool setReplay(const std::string& file);
+
+	/** persist statistics of all stages in file across processes (an empty file name disables persistence)
+	 *
+	 * The file is loaded (if it exists) by the next init(), restoring statistics into all stages without own
+	 * ones. Statistics are carried across reset() and saved when planning finishes, on destruction, and,
+	 * if save_interval > 0, at least every save_interval seconds of planning.
+	 * Restored statistics are reported as part of the stages' latency histograms.
+	 */
+	void setStatisticsFile(const std::string& file, double save_interval = 0.0);
+	/// persisted statistics (nullptr if persistence is disabled or init() didn't load them yet)
+	const StatisticsRecord* statistics() const;
+
 	/// reset all stages
 	void reset() final;
 	/// initialize all stages with given scene
@@ -119,10 +256,59 @@ public:
 
 	/// reset, init scene (if not yet done), and init all stages, then start planning
 	moveit::core::MoveItErrorCode plan(size_t max_solutions = 0);
+	/** anytime planning: keep improving solutions until the wall-clock budget (in seconds) is exhausted
+	 *
+	 * The remaining budget is split across stages according to their compute time per solution so far,
+	 * limiting each stage's timeout() such that planning reliably finishes in time.
+	 * The best solution found is available as solutions().front().
+	 */
+	moveit::core::MoveItErrorCode planAnytime(double time_budget);
+	/** plan(max_solutions) in a background thread, returning the planning result as a future
+	 *
+	 * While planning, the task should only be accessed via preempt() and solutionStream().
+	 * A pending asynchronous planning run is awaited by the next planAsync() call or the destructor.
+	 */
+	std::future<moveit::core::MoveItErrorCode> planAsync(size_t max_solutions = 0);
+	/// stream of all new top-level solutions, closed when the current (or next) planning run finishes
+	SolutionStreamPtr solutionStream();
+	/** incrementally replan after world objects changed
+	 *
+	 * Instead of reset() and plan(), apply the world changes of diff to all stored states,
+	 * invalidate solutions whose trajectories collide with any of the changed objects, and continue planning.
+	 * Invalidated Connecting trajectories are planned again, other invalidated branches are pruned.
+	 * Requires a previous call to plan().
+	 */
+	moveit::core::MoveItErrorCode replan(const moveit_msgs::PlanningScene& diff, size_t max_solutions = 0);
+	/** incrementally replan after a world object moved, regenerating the stages depending on it
+	 *
+	 * Like replan(), but additionally regenerates all generators depending on the object, i.e. referring to it
+	 * by their "object" property or the frame of a pose property, including their wrappers (e.g. ComputeIK).
+	 * Monitoring generators receive the solutions of their monitored stage again, now with the updated scene.
+	 * All other solutions, e.g. approaching the object's previous pose, are reused.
+	 */
+	moveit::core::MoveItErrorCode replanObject(const moveit_msgs::CollisionObject& object, size_t max_solutions = 0);
+	/** continuously replan for a moving object, whose poses are received on topic (geometry_msgs/PoseStamped)
+	 *
+	 * Plans until preempt(), applying each pose update via replanObject(). Each planning cycle is limited to
+	 * latency seconds (as in planAnytime()) before pending updates are processed. Returns the last cycle's result.
+	 * As pruned states and invalidated solutions accumulate with every update, planning restarts from scratch
+	 * once they amount to twice those of the previous full plan. Requires MoveIt 1.1.6 or newer.
+	 */
+	moveit::core::MoveItErrorCode planContinuously(const std::string& object, const std::string& topic,
+	                                               double latency);
 	/// interrupt current planning (or execution)
 	void preempt();
 	/// execute solution, return the result
 	moveit::core::MoveItErrorCode execute(const SolutionBase& s);
+	/** execute solution in-process with the given executor, e.g. move_group's, return the result
+	 *
+	 * In contrast to execute(), the solution isn't serialized and sent to the execute_task_solution action:
+	 * The trajectories of the solution are handed to the executor as they are. Like the capability,
+	 * execution groups are resolved from the trajectories' joints, and each trajectory is validated in
+	 * the monitored scene, as predicted by the effects of all preceding ones. Failed solutions are refused.
+	 * preempt() stops the execution.
+	 */
+	moveit::core::MoveItErrorCode execute(const SolutionBase& s, plan_execution::PlanExecution& executor);
 
 	/// print current task state (number of found solutions and propagated states) to std::cout
 	void printState(std::ostream& os = std::cout) const;
@@ -130,9 +316,13 @@ public:
 	size_t numSolutions() const { return solutions().size(); }
 	const ordered<SolutionBaseConstPtr>& solutions() const { return stages()->solutions(); }
 	const std::list<SolutionBaseConstPtr>& failures() const { return stages()->failures(); }
+	/// view of solutions that can be safely accessed from other threads while planning, see Stage::snapshot()
+	StageSnapshotConstPtr snapshot() const { return stages()->snapshot(); }
 
 	/// publish all top-level solutions
 	void publishAllSolutions(bool wait = true);
+	/// publish count top-level solutions (ranked by cost) starting at first, see Introspection::publishSolutions()
+	size_t publishSolutions(size_t count, size_t first = 0);
 
 	// +1 TODO: convenient access to arbitrary stage by name. traverse hierarchy using / separator?
 	/// access stage tree
@@ -153,6 +343,8 @@ protected:
 
 private:
 	using WrapperBase::init;
+	/// run the planning loop on the already initialized stages
+	moveit::core::MoveItErrorCode continuePlanning(size_t max_solutions);
 };
 
 inline std::ostream& operator<<(std::ostream& os, const Task& task) {
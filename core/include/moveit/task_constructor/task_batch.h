@@ -0,0 +1,106 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Plan multiple instances of a task concurrently
+*/
+
+#pragma once
+
+#include "task.h"
+
+#include <functional>
+#include <vector>
+
+namespace robot_model_loader {
+MOVEIT_CLASS_FORWARD(RobotModelLoader);
+}
+
+namespace moveit {
+namespace task_constructor {
+
+/** Plan a batch of similar tasks, e.g. one per candidate object, concurrently.
+ *
+ * All tasks share a single RobotModel (and thus cached planning pipelines).
+ * Each task is planned by its own worker thread, up to a configured number of threads.
+ * Worker threads are started by the process-wide TaskExecutor, which tasks use by default as well.
+ */
+class TaskBatch
+{
+public:
+	/// create the task instance with given index
+	using TaskFactory = std::function<TaskPtr(size_t index)>;
+
+	struct Result
+	{
+		size_t index;  ///< index of task in batch
+		moveit::core::MoveItErrorCode error_code;
+		double cost;  ///< cost of the best solution (infinite if there is none)
+		double planning_time;  ///< wall time [s] spent planning this task
+	};
+
+	/// default to one thread per core
+	TaskBatch(size_t num_threads = 0);
+	~TaskBatch();
+
+	void setRobotModel(const moveit::core::RobotModelConstPtr& robot_model);
+	/// load robot model from given parameter
+	void loadRobotModel(const std::string& robot_description = "robot_description");
+	const moveit::core::RobotModelConstPtr& getRobotModel() const { return robot_model_; }
+
+	void setNumThreads(size_t num_threads);
+	size_t numThreads() const { return num_threads_; }
+
+	/// add a single task instance
+	void add(TaskPtr task);
+	/// add num tasks created by factory
+	void create(size_t num, const TaskFactory& factory);
+	void clear();
+
+	size_t size() const { return tasks_.size(); }
+	Task& task(size_t index) { return *tasks_.at(index); }
+	const Task& task(size_t index) const { return *tasks_.at(index); }
+
+	/// plan all tasks concurrently, returning results ranked by cost (failures last)
+	std::vector<Result> plan(size_t max_solutions = 1);
+	/// preempt planning of all tasks
+	void preempt();
+
+private:
+	robot_model_loader::RobotModelLoaderPtr robot_model_loader_;
+	moveit::core::RobotModelConstPtr robot_model_;
+	std::vector<TaskPtr> tasks_;
+	size_t num_threads_;
+};
+}  // namespace task_constructor
+}  // namespace moveit
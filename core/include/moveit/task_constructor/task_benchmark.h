@@ -0,0 +1,128 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Benchmark repeated planning of a task, exporting the results as JSON
+*/
+
+#pragma once
+
+#include "task.h"
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Repeatedly plan freshly created instances of a task and record its planning performance
+ *
+ * Before creating the task instance of repetition i, std::rand() is seeded with seed + i.
+ * Creating the task is not timed, planning is measured as wall time.
+ */
+class TaskBenchmark
+{
+public:
+	/// create the task instance for given seed
+	using TaskFactory = std::function<TaskPtr(unsigned int seed)>;
+
+	struct StageResult
+	{
+		std::string name;
+		unsigned int depth;  ///< nesting depth of stage (0: task's root container)
+		size_t solutions;
+		size_t failures;
+		double compute_time;  ///< total compute time [s]
+		size_t compute_calls;
+		double compute_latency_median;  ///< median duration of compute() calls [s]
+		double solution_latency_mean;  ///< mean compute time to find a new solution [s]
+		MemoryUsage memory;  ///< only recorded if Stage::memoryAccounting() is enabled
+	};
+
+	struct Run
+	{
+		unsigned int seed;
+		moveit::core::MoveItErrorCode error_code;
+		double time_to_first_solution;  ///< wall time [s] until first solution (infinite if there is none)
+		double planning_time;  ///< wall time [s] of plan()
+		size_t solutions;
+		double solutions_per_second;
+		double best_cost;  ///< cost of best solution (infinite if there is none)
+		/** peak resident set size [kB] while planning this run
+		 *
+		 * The process' peak is reset before each run, which requires Linux >= 4.0.
+		 * Otherwise (peak_rss_per_run == false), this is the process' overall peak, which never decreases.
+		 */
+		long peak_rss;
+		bool peak_rss_per_run;
+		std::vector<StageResult> stages;
+	};
+
+	TaskBenchmark(const std::string& name, const TaskFactory& factory);
+
+	const std::string& name() const { return name_; }
+
+	void setRepetitions(size_t repetitions) { repetitions_ = repetitions; }
+	size_t repetitions() const { return repetitions_; }
+
+	/// seed of first repetition
+	void setSeed(unsigned int seed) { seed_ = seed; }
+	unsigned int seed() const { return seed_; }
+
+	/// solutions to plan per repetition (0: plan until exhaustion)
+	void setMaxSolutions(size_t max_solutions) { max_solutions_ = max_solutions; }
+	size_t maxSolutions() const { return max_solutions_; }
+
+	/// plan all repetitions, returning their results
+	const std::vector<Run>& run();
+	const std::vector<Run>& runs() const { return runs_; }
+
+	/// write configuration, results of all runs, and their summary
+	void writeJson(std::ostream& os) const;
+	/// write JSON to given file, returns false on failure
+	bool writeJson(const std::string& file) const;
+
+private:
+	Run runOnce(unsigned int seed);
+
+	std::string name_;
+	TaskFactory factory_;
+	size_t repetitions_ = 10;
+	unsigned int seed_ = 0;
+	size_t max_solutions_ = 0;
+	std::vector<Run> runs_;
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,156 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    executor running the threads of planning, asynchronous planners, publishing, and callbacks
+*/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+MOVEIT_CLASS_FORWARD(TaskExecutor);
+
+/** Executor controlling where and how planning threads run
+ *
+ * All threads of planning workers, asynchronous planners, introspection publishing, and solution callbacks
+ * are started via spawn() or post() and configured with the executor's Options, e.g. to keep planning away
+ * from cores reserved for real-time controllers. Several tasks can share an executor (see Task::setExecutor()),
+ * which then limits their total number of concurrent computations to Options::max_concurrency.
+ * Stages and solvers, which don't know their task, use current(): the executor activated
+ * by their task while initializing and planning, or the process-wide instance().
+ */
+class TaskExecutor
+{
+public:
+	struct Options
+	{
+		/// number of pooled threads running posted jobs (0: one per core, but at least 2)
+		unsigned int num_threads = 0;
+		/// max number of concurrent computations of all tasks using this executor (0: unlimited)
+		unsigned int max_concurrency = 0;
+		/// CPUs to run threads on (empty: inherit affinity)
+		std::vector<int> cpus;
+		/// nice value of threads (0: inherit)
+		int nice = 0;
+		/// scheduling policy, e.g. SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, SCHED_FIFO, or SCHED_RR (-1: inherit)
+		int policy = -1;
+		/// static priority for SCHED_FIFO and SCHED_RR
+		int priority = 0;
+
+		/// any thread configuration requested?
+		bool configures() const { return !cpus.empty() || nice != 0 || policy >= 0; }
+	};
+
+	/** RAII activation of an executor for the calling thread, see current()
+	 *
+	 * The executor is referenced weakly. Threads started via spawn() and jobs run via post() inherit
+	 * the active executor of the calling thread.
+	 */
+	class Activation
+	{
+		std::weak_ptr<TaskExecutor> previous_;
+
+	public:
+		explicit Activation(std::weak_ptr<TaskExecutor> executor);
+		~Activation();
+		Activation(const Activation&) = delete;
+		Activation& operator=(const Activation&) = delete;
+	};
+
+	/// RAII slot of a concurrent computation, see acquire()
+	class Slot
+	{
+		TaskExecutor* executor_ = nullptr;
+
+	public:
+		Slot() = default;
+		explicit Slot(TaskExecutor* executor) : executor_(executor) {}
+		Slot(Slot&& other) : executor_(other.executor_) { other.executor_ = nullptr; }
+		Slot& operator=(Slot&& other);
+		~Slot() { release(); }
+		void release();
+	};
+
+	explicit TaskExecutor(Options options = Options());
+	TaskExecutor(const TaskExecutor&) = delete;
+	/// finishes all posted jobs
+	~TaskExecutor();
+
+	const Options& options() const { return options_; }
+
+	/// apply options to the calling thread, returns false if (some of) them could not be applied
+	static bool configureThread(const Options& options);
+	bool configureThread() const { return configureThread(options_); }
+
+	/// start a dedicated thread running fn, configured according to options() and inheriting the active PlanningRecord
+	std::thread spawn(std::function<void()> fn) const;
+	/// run job by a pooled thread, which are started on first use
+	void post(std::function<void()> job);
+
+	/// wait for a slot of a concurrent computation (immediately available if max_concurrency is unlimited)
+	Slot acquire();
+
+	/// process-wide executor, a default-configured one unless replaced
+	static TaskExecutorPtr instance();
+	/// replace process-wide executor, nullptr restores the default
+	static void setInstance(const TaskExecutorPtr& executor);
+	/// executor activated for the calling thread (if still alive), instance() otherwise
+	static TaskExecutorPtr current();
+
+private:
+	void run();
+
+	const Options options_;
+
+	std::mutex mutex_;
+	std::condition_variable jobs_cv_;
+	std::condition_variable slots_cv_;
+	std::deque<std::function<void()>> jobs_;
+	std::vector<std::thread> workers_;
+	unsigned int busy_slots_ = 0;
+	bool stop_ = false;
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -40,10 +40,25 @@
 
 #include <moveit/task_constructor/container_p.h>
 #include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/preemption.h>
+#include <moveit/task_constructor/recording.h>
+#include <moveit/task_constructor/statistics_record.h>
+#include <moveit/task_constructor/warm_start.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace robot_model_loader {
 MOVEIT_CLASS_FORWARD(RobotModelLoader);
 }
+namespace plan_execution {
+class PlanExecution;
+struct ExecutableMotionPlan;
+}
 
 namespace moveit {
 namespace task_constructor {
@@ -58,16 +73,142 @@ public:
 
 	const std::string& ns() const { return ns_; }
 	const ContainerBase* stages() const;
+	/// executor of the task's threads (process-wide instance if none was set)
+	TaskExecutorPtr taskExecutor() const { return task_executor_ ? task_executor_ : TaskExecutor::instance(); }
+
+	/// flat record of a stage in the compiled stage tree
+	struct StageRecord
+	{
+		StagePrivate* stage;
+		uint32_t parent;  // index of the parent's record (own index for the root container)
+		uint32_t depth;  // 0: root container
+		bool container;
+	};
+	/// records of all stages in depth-first order, compiled on demand until the structure changes
+	const std::vector<StageRecord>& stageRecords() const;
+
+	/** convert solution s into plan for in-process execution, returns false if it cannot be executed (yet)
+	 *
+	 * Like the execute_task_solution capability, each trajectory is executed by the group actuating its
+	 * joints and validated in the scene predicted from scene by the effects of all preceding trajectories.
+	 * On success, the effects are applied to plan.planning_scene_monitor_.
+	 */
+	static bool constructMotionPlan(const SolutionBase& s, const planning_scene::PlanningScenePtr& scene,
+	                                plan_execution::ExecutableMotionPlan& plan);
 
 private:
+	/** compile the stage tree into a flat, depth-first array of StageRecords and the compute units of
+	 * planScheduled(), and cache all push interfaces. Called by Task::init(), once the structure is fixed.
+	 */
+	void freeze();
+	/// drop compiled stage records after structural changes
+	void unfreeze();
+	/// stages were added during planning, e.g. by ForEach: recompile the stage records at the next refresh
+	void onStageTreeChanged() override { stage_tree_changed_ = true; }
+	/** recompile the stage records if stages were added meanwhile
+	 *
+	 * Called by the planning loops in between computations, when nobody iterates the records.
+	 * Compute units are kept: stages adding children during planning are computed as a whole.
+	 */
+	void refreshStageRecords();
+	/// stage records in depth-first order, built from scratch
+	std::vector<StageRecord> compileStageRecords() const;
+
+	/// plan with num_threads_ workers, each computing an independent stage selected by scheduling_policy_
+	int32_t planScheduled(size_t max_solutions, double available_time);
+	/// split remaining time across computing stages, weighted by their compute time per solution
+	void distributeTimeBudget(double remaining);
+	/// shared pointer of a top-level solution (nullptr if not stored)
+	SolutionBaseConstPtr findSolution(const SolutionBase& s) const;
+	/// forward a new top-level solution to all solution streams
+	void streamSolution(const SolutionBase& s);
+	/// true if some stage solution composing solution awaits lazy validation
+	static bool validationPending(const SolutionBase& solution);
+	/// call solution callbacks and stream a (validated) top-level solution
+	void announceSolution(const SolutionBase& s, const SolutionBaseConstPtr& shared);
+	/// announce solutions of unannounced_ that were validated meanwhile, dropping invalidated ones
+	void announceValidated();
+	void closeSolutionStreams();
+	/// propagate cost of best solution to all stages (if cost pruning is enabled)
+	void updateCostBound();
+	/// regenerate all generators depending on world object (and their wrappers), returning their number
+	size_t regenerate(const std::string& object);
+	/// number of states (including pruned ones) and failures stored by all stages
+	size_t numStoredItems() const;
+	/** validate VALIDATION_PENDING trajectories of the best solution, dropping invalid ones until a valid one is found
+	 *
+	 * COST_PENDING parts of the best solution are evaluated first, re-ranking it until its cost is final.
+	 */
+	void validateBestSolution();
+	/// reduce memory when approaching the memory budget, returns false if it is still exceeded
+	bool enforceMemoryBudget();
+	/// resume all stages' continuations whose future is ready, returns their number
+	size_t resumeContinuations();
+	bool hasContinuations() const;
+	/// cancel the work of pending continuations of all stages, e.g. when planning is preempted
+	void cancelContinuations();
+	/// start a new epoch, publishing snapshots of all stages changed by the last planning step
+	void publishSnapshots();
+	/// start recording or replaying a planning run (if enabled), returning the record to activate
+	PlanningRecord* beginRecording();
+	/// save the recording or report unused replay responses
+	void endRecording();
+	/// load persisted statistics (if not yet done) and restore them into all stages without own ones
+	void restoreStatistics();
+	/// store current statistics of all stages in statistics_ (if persistence is enabled)
+	void collectStatistics();
+	/// collect and save statistics, unless the last save is more recent than statistics_interval_ (and not forced)
+	void saveStatistics(bool force);
+	/// watchdog loop of continuePlanning(): report stalled computations until stop is set
+	void watchStalls(std::mutex& mutex, std::condition_variable& cv, const bool& stop);
+
 	std::string ns_;
 	robot_model_loader::RobotModelLoaderPtr robot_model_loader_;
 	moveit::core::RobotModelConstPtr robot_model_;
-	bool preempt_requested_;
+	PreemptionToken preempt_;
+
+	size_t num_threads_;
+	size_t max_concurrency_;  // max concurrently planning workers (0 = unlimited)
+	TaskExecutorPtr task_executor_;  // executor of the task's threads (null: process-wide instance)
+	Task::SchedulingPolicy scheduling_policy_;
+	double time_budget_;  // wall-clock budget of anytime planning (infinite if disabled)
+	bool cost_pruning_;
+	size_t max_scene_depth_;  // flatten deeper scene diff chains (0 = unlimited)
+	double dedup_resolution_;  // joint resolution for merging equal states (0 = disabled)
+	TimeoutPolicy timeout_policy_;  // task-wide adaptive timeout (disabled by default)
+	StallPolicy stall_policy_;  // watchdog of running computations (disabled by default)
+	WarmStartCachePtr warm_start_;  // caches of previous planning runs (null if disabled)
+	size_t memory_budget_;  // max memory of all stages (0 = unlimited)
+	double compression_tolerance_;  // tolerance of trajectory compression under memory pressure (0 = disabled)
+	std::string record_file_;  // file to record planning runs to (empty if disabled)
+	PlanningRecordPtr record_;  // record of the current (or last) planning run, or the replayed one
+	std::string statistics_file_;  // file to persist stage statistics to (empty if disabled)
+	double statistics_interval_;  // min time between periodic saves of statistics (0 = only when planning finishes)
+	StatisticsRecordPtr statistics_;  // persisted statistics (loaded by init())
+	std::chrono::steady_clock::time_point statistics_saved_;
+	bool interfaces_resolved_;  // still valid interfaces of the last init(), which can be skipped then
+	bool description_published_;  // task description was published by the current introspection instance
+	uint64_t epoch_;  // number of planning steps published via publishSnapshots()
+	std::mutex planning_mutex_;  // serializes all bookkeeping in concurrent planning mode
+	mutable std::vector<StageRecord> stage_records_;  // compiled stage tree (empty if not compiled)
+	mutable std::mutex stage_records_mutex_;  // guards refreshStageRecords() against the watchdog
+	std::atomic<bool> stage_tree_changed_{ false };  // stages were added since the records were compiled
+	mutable std::vector<StagePrivate*> compute_units_;  // independently computable stages, see planScheduled()
 
 	// introspection and monitoring
 	std::unique_ptr<Introspection> introspection_;
 	std::list<Task::TaskCallback> task_cbs_;  // functions to monitor task's planning progress
+
+	// asynchronous planning
+	std::thread async_thread_;
+	bool reset_preempt_ = true;  // reset preempt_ when planning starts (false if planAsync() did so already)
+	std::mutex streams_mutex_;  // protects streams_, which are accessed from planning and user threads
+	std::vector<SolutionStreamPtr> streams_;
+	std::vector<SolutionBaseConstPtr> unannounced_;  // new solutions awaiting lazy validation
+
+	// in-process execution
+	std::mutex executor_mutex_;  // protects executor_, which is stopped by preempt()
+	plan_execution::PlanExecution* executor_;  // executor of the running in-process execution (if any)
 };
 PIMPL_FUNCTIONS(Task)
 }  // namespace task_constructor
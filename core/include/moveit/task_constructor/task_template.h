@@ -0,0 +1,117 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Declarative task descriptions, compiled once into templates for cheap instantiation
+*/
+
+#pragma once
+
+#include "task.h"
+#include "stage_registry.h"
+
+#include <boost/any.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace XmlRpc {
+class XmlRpcValue;
+}
+
+namespace moveit {
+namespace task_constructor {
+
+/** Declarative description of a stage tree
+ *
+ * Stages are identified by their StageRegistry class id; property values are given as text
+ * and parsed by the deserializers registered for the declared property types (see PropertySerializer).
+ * Properties declared as boost::any without a default value, e.g. the goal of MoveTo, receive the text
+ * as std::string, e.g. the name of a named target. Other types, e.g. poses, cannot be given as text.
+ * The root description refers to the Task itself: its class_id is ignored, its properties are task properties.
+ */
+struct StageDescription
+{
+	std::string class_id;
+	std::string name;  ///< stage name, the stage's default name if empty
+	std::map<std::string, std::string> properties;  ///< textual property values
+	std::vector<StageDescription> children;
+
+	/** parse a description from XmlRpc, e.g. YAML loaded onto the parameter server:
+	 *
+	 * {type: "moveit_task_constructor/Move To", name: "home", properties: {group: "arm", goal: "ready"},
+	 *  stages: [...]}
+	 *
+	 * Throws std::runtime_error on malformed input.
+	 */
+	static StageDescription fromXmlRpc(XmlRpc::XmlRpcValue& value);
+};
+
+/** Task template compiled from a StageDescription
+ *
+ * Compilation resolves all class ids, parses all property values and validates them against the declared
+ * properties of the stages (throwing std::runtime_error on errors). instantiate() then only creates stages
+ * and assigns the pre-parsed values, without any parsing or lookup of class ids.
+ */
+class TaskTemplate
+{
+public:
+	explicit TaskTemplate(const StageDescription& description);
+
+	/// create a new task from the template
+	TaskPtr instantiate() const;
+
+	const std::string& name() const { return root_.name; }
+
+private:
+	using Properties = std::vector<std::pair<std::string, boost::any>>;
+	struct Node
+	{
+		StageRegistry::Factory factory;  // empty for the task
+		std::string name;
+		Properties properties;
+		std::vector<Node> children;
+	};
+
+	static Properties compileProperties(const StageDescription& description, PropertyMap& declared,
+	                                    const std::string& path);
+	static std::vector<Node> compileChildren(const StageDescription& description, ContainerBase& prototype,
+	                                         const std::string& path);
+	static Node compile(const StageDescription& description, const std::string& path);
+	static Stage::pointer create(const Node& node);
+
+	Node root_;
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,144 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Lightweight tracing of compute timelines, exported as Chrome trace JSON
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Process-wide recorder of timed events
+ *
+ * Tracing is enabled at startup if the environment variable MTC_TRACE_FILE names an output file,
+ * which is written at program exit, or at runtime via enable().
+ * Recorded events can be saved in the Chrome trace JSON format, which is understood by
+ * chrome://tracing and https://ui.perfetto.dev.
+ * While disabled, a TraceScope costs a single relaxed atomic load.
+ * Building with -DMTC_TRACING=OFF removes all trace points from the library.
+ */
+class Tracer
+{
+public:
+	struct Event
+	{
+		const char* category;  // string literal
+		std::string name;
+		uint32_t id;  // solution id, 0 if n/a
+		uint32_t thread;
+		int64_t start;  // µs since tracer creation
+		int64_t duration;  // µs
+	};
+	/// limit memory footprint: further events are dropped
+	static constexpr std::size_t MAX_EVENTS = 1000000;
+
+	static Tracer& instance();
+	static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+	void enable() { enabled_ = true; }
+	void disable() { enabled_ = false; }
+	void clear();
+
+	void record(const char* category, const char* name, uint32_t id, std::chrono::steady_clock::time_point start,
+	            std::chrono::steady_clock::time_point stop);
+
+	std::vector<Event> events() const;
+	/// write events in Chrome trace JSON format
+	void write(std::ostream& os) const;
+	bool save(const std::string& file) const;
+
+private:
+	Tracer();
+	~Tracer();
+
+	static std::atomic<bool> enabled_;
+
+	const std::chrono::steady_clock::time_point origin_;
+	std::string file_;  // written on destruction
+	mutable std::mutex mutex_;
+	std::vector<Event> events_;
+	std::size_t dropped_ = 0;
+};
+
+/// RAII helper recording the duration of its scope, if tracing is enabled
+class TraceScope
+{
+public:
+	TraceScope(const char* category, const char* name, uint32_t id = 0)
+	  : category_(category), name_(name), id_(id), active_(Tracer::enabled()) {
+		if (active_)
+			start_ = std::chrono::steady_clock::now();
+	}
+	/// name needs to outlive the scope
+	TraceScope(const char* category, const std::string& name, uint32_t id = 0)
+	  : TraceScope(category, name.c_str(), id) {}
+	TraceScope(const char* category, std::string&& name, uint32_t id = 0) = delete;
+	~TraceScope() {
+		if (active_)
+			Tracer::instance().record(category_, name_, id_, start_, std::chrono::steady_clock::now());
+	}
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+	void setId(uint32_t id) { id_ = id; }
+
+private:
+	const char* category_;
+	const char* name_;
+	uint32_t id_;
+	bool active_;
+	std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace task_constructor
+}  // namespace moveit
+
+#define MTC_TRACE_CONCAT_(a, b) a##b
+#define MTC_TRACE_CONCAT(a, b) MTC_TRACE_CONCAT_(a, b)
+#ifdef MTC_TRACING
+/// trace the remainder of the current scope: MTC_TRACE_SCOPE(category, name [, solution id])
+#define MTC_TRACE_SCOPE(...) \
+	::moveit::task_constructor::TraceScope MTC_TRACE_CONCAT(mtc_trace_scope_, __LINE__)(__VA_ARGS__)
+#else
+#define MTC_TRACE_SCOPE(...)
+#endif
@@ -0,0 +1,100 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    lossy, error-bounded compression of robot trajectories
+*/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <trajectory_msgs/JointTrajectory.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(RobotState);
+}  // namespace core
+}  // namespace moveit
+namespace robot_trajectory {
+MOVEIT_CLASS_FORWARD(RobotTrajectory);
+}
+
+namespace moveit {
+namespace task_constructor {
+
+MOVEIT_CLASS_FORWARD(CompressedTrajectory);
+
+/** Compact, lossy representation of a RobotTrajectory, reproducing every variable within a given tolerance
+ *
+ * Waypoints that are linearly interpolated (in time) from their retained neighbours within tolerance/2 are dropped.
+ * The positions of retained waypoints are quantized to steps of tolerance/2 and stored as 32bit deltas.
+ * First and last waypoint are kept exactly. decompress() rebuilds a trajectory with the original waypoint timing.
+ * As the rebuilt trajectory only approximates the original one, it is meant for inspection and display, not execution.
+ */
+class CompressedTrajectory
+{
+public:
+	/// compress trajectory, nullptr if it has less than 3 waypoints or positions exceed the quantization range
+	static CompressedTrajectoryConstPtr compress(const robot_trajectory::RobotTrajectory& trajectory, double tolerance);
+
+	/// rebuild a trajectory with all original waypoints, velocities and accelerations are finite differences
+	robot_trajectory::RobotTrajectoryPtr decompress() const;
+
+	double tolerance() const { return 2.0 * quantum_; }
+	size_t waypointCount() const { return durations_.size(); }
+	size_t retainedCount() const { return retained_.size(); }
+	/// estimated memory in bytes
+	size_t memory() const;
+
+private:
+	CompressedTrajectory() = default;
+
+	std::string group_;
+	double quantum_ = 0.0;
+	size_t variables_ = 0;
+	moveit::core::RobotStatePtr first_;
+	moveit::core::RobotStatePtr last_;
+	std::vector<float> durations_;  // duration from previous of all original waypoints
+	std::vector<uint32_t> retained_;  // indices of retained waypoints (ascending, including first and last)
+	std::vector<int32_t> deltas_;  // quantized position deltas (variables x retained)
+};
+
+/// drop waypoints of msg that are linearly interpolated from the remaining ones within tolerance
+void decimateTrajectory(trajectory_msgs::JointTrajectory& msg, double tolerance);
+}  // namespace task_constructor
+}  // namespace moveit
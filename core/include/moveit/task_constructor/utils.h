@@ -38,23 +38,32 @@
 
 #pragma once
 
+#include <initializer_list>
+#include <map>
+#include <memory>
 #include <string>
 #include <type_traits>
-#include <initializer_list>
+#include <vector>
 
 #include <Eigen/Geometry>
 
 #include <moveit/macros/class_forward.h>
+#include <moveit_msgs/PlanningScene.h>
+#include <moveit_msgs/RobotState.h>
 
 namespace planning_scene {
 MOVEIT_CLASS_FORWARD(PlanningScene);
 }
+namespace robot_trajectory {
+MOVEIT_CLASS_FORWARD(RobotTrajectory);
+}
 
 namespace moveit {
 
 namespace core {
 MOVEIT_CLASS_FORWARD(LinkModel);
 MOVEIT_CLASS_FORWARD(JointModelGroup);
+MOVEIT_CLASS_FORWARD(RobotModel);
 MOVEIT_CLASS_FORWARD(RobotState);
 }  // namespace core
 
@@ -146,6 +155,84 @@ const moveit::core::LinkModel* getRigidlyConnectedParentLinkModel(const moveit::
 bool getRobotTipForFrame(const Property& property, const planning_scene::PlanningScene& scene,
                          const moveit::core::JointModelGroup* jmg, SolutionBase& solution,
                          const moveit::core::LinkModel*& robot_link, Eigen::Isometry3d& tip_in_global_frame);
+
+/** check the motion between two (updated) states for collisions
+ *
+ * With a collision detector supporting it (Bullet), collisions with the world are checked continuously
+ * along the segment and self-collisions at the end state only. Other detectors (e.g. FCL) fall back to
+ * discrete checks of states interpolated with a max joint distance of resolution.
+ */
+bool isSegmentColliding(const planning_scene::PlanningScene& scene, const moveit::core::RobotState& from,
+                        const moveit::core::RobotState& to, const std::string& group, double resolution = 0.01);
+
+/// true if scene_diff changes the scene beyond the robot's joint state, e.g. world, ACM, or attached bodies
+bool changesScene(const moveit_msgs::PlanningScene& scene_diff);
+
+/** predict the scene after executing a sub trajectory with the given scene_diff, e.g. to validate its successor
+ *
+ * Returns a diff of scene with scene_diff applied, or scene itself if scene_diff doesn't change it
+ * beyond the robot's joint state (which is defined by the trajectories anyway).
+ * Applied to consecutive sub trajectories, this yields the cumulative scene each of them is executed in.
+ */
+planning_scene::PlanningScenePtr predictScene(const planning_scene::PlanningScenePtr& scene,
+                                              const moveit_msgs::PlanningScene& scene_diff);
+
+/** find a group to execute a trajectory of the given joints with, i.e. whose controllers actuate them
+ *
+ * The group needs to comprise all joints, further ones are only accepted if passive, mimic, or fixed.
+ * Returns nullptr if there is no such group.
+ */
+const moveit::core::JointModelGroup* findJointModelGroup(const moveit::core::RobotModel& model,
+                                                         const std::vector<std::string>& joints);
+
+/** positions of frame at all waypoints of trajectory (3 x waypoints)
+ *
+ * Forward kinematics is computed along the kinematic chain of the frame's link only,
+ * starting from the first joint that changed w.r.t. the previous waypoint.
+ * Requires an updated first waypoint. Returns false if frame is unknown.
+ */
+bool computeFramePositions(const robot_trajectory::RobotTrajectory& trajectory, const std::string& frame,
+                           Eigen::Matrix3Xd& positions);
+
+/** cheap estimate of a trajectory's timing, replacing full time parameterization for ranking
+ *
+ * Each segment takes as long as its slowest group variable at (scaled) max velocity, ignoring acceleration.
+ * Thus the estimated duration is a lower bound of the parameterized one. Velocities are not set.
+ */
+void estimateTimeStamps(robot_trajectory::RobotTrajectory& trajectory, double velocity_scaling = 1.0);
+
+/** (partial) joint posture of a group, resolved to variable indices once for repeated application
+ *
+ * Compile a named group state or a RobotState diff once, e.g. in Stage::init().
+ * apply() then only writes the stored variable positions. Diffs comprising more than joint positions
+ * (multi-dof joints, velocities, efforts, or attached bodies) are applied via robotStateMsgToRobotState().
+ * compile() throws moveit::Exception for unknown states or joints not part of the group.
+ */
+class JointPosture
+{
+public:
+	void compile(const moveit::core::JointModelGroup* jmg, const std::string& named_state);
+	void compile(const moveit::core::JointModelGroup* jmg, const moveit_msgs::RobotState& diff,
+	             bool copy_attached_bodies = true);
+	void compile(const moveit::core::JointModelGroup* jmg, const std::map<std::string, double>& joints);
+
+	/// group the posture was compiled for (nullptr if not compiled)
+	const moveit::core::JointModelGroup* group() const { return jmg_; }
+	void clear();
+
+	/// set the variables of the posture in state (update() is left to the caller)
+	void apply(moveit::core::RobotState& state) const;
+
+private:
+	void validate(const std::string& joint);
+	void add(const std::string& joint, double value);
+
+	const moveit::core::JointModelGroup* jmg_ = nullptr;
+	std::vector<int> indices_;
+	std::vector<double> values_;
+	std::shared_ptr<const moveit_msgs::RobotState> fallback_;  // diff not expressible by positions only
+	bool copy_attached_bodies_ = true;
+};
 }  // namespace utils
 }  // namespace task_constructor
 }  // namespace moveit
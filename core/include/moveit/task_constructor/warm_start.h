@@ -0,0 +1,90 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Caches keeping results of previous planning runs to warm-start the next ones
+*/
+
+#pragma once
+
+#include <moveit/task_constructor/solvers/planner_interface.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace moveit {
+namespace task_constructor {
+
+MOVEIT_CLASS_FORWARD(WarmStartCache);
+
+/** Caches surviving Task::reset(), which stages use to warm-start planning, see Task::setWarmStart()
+ *
+ * Stages look up typed caches by key (creating them on first use), e.g. ComputeIK an IKCache of previous solutions.
+ * Planners are wrapped into a CachingPlanner, shared by all stages employing the same planner instance,
+ * which reuses previous trajectories for (nearly) identical requests once they are revalidated.
+ * The caches are bounded themselves (see IKCache and CachingPlanner's max_entries). Wrappers are only
+ * referenced weakly, i.e. they are dropped together with the last stage using them.
+ */
+class WarmStartCache
+{
+public:
+	/// cache of type T registered for key, default-constructed on first request
+	template <typename T>
+	std::shared_ptr<T> get(const std::string& key) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto& cache = caches_[key];
+		if (!cache)
+			cache = std::make_shared<T>();
+		return std::static_pointer_cast<T>(cache);
+	}
+
+	/// caching wrapper of planner (planner itself if it is a CachingPlanner already)
+	solvers::PlannerInterfacePtr cachingPlanner(const solvers::PlannerInterfacePtr& planner);
+	/// forget wrappers not used by any stage anymore, called by Task::reset()
+	void prune();
+	/// number of wrappers still in use
+	size_t numPlanners() const;
+
+private:
+	using PlannerWeakPtr = std::weak_ptr<solvers::PlannerInterface>;
+	void pruneLocked();
+
+	mutable std::mutex mutex_;
+	std::map<std::string, std::shared_ptr<void>> caches_;
+	// wrappers of planners, keyed by the planner's control block (not its possibly reused address)
+	std::map<PlannerWeakPtr, PlannerWeakPtr, std::owner_less<PlannerWeakPtr>> planners_;
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,164 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    backend for batched collision and distance queries
+*/
+
+#include <moveit/task_constructor/collision_backend.h>
+#include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/task_constructor/preemption.h>
+#include <moveit/task_constructor/scratch_state.h>
+#include <moveit/task_constructor/task_executor.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+struct Registry
+{
+	std::mutex mutex;
+	CollisionBackendPtr backend;
+};
+
+Registry& registry() {
+	static Registry registry;
+	return registry;
+}
+
+/** evaluate check(index, robot) for all indices, distributed over num_threads
+ *
+ * Thread k evaluates indices k, k + num_threads, ... States with up-to-date transforms, e.g. trajectory waypoints,
+ * are checked as they are. Only dirty ones are updated on a scratch copy of the thread.
+ * Once check() returns true, all threads skip larger indices. Returns the smallest such index or n.
+ */
+template <typename Check>
+size_t sweep(const CollisionBackend::States& states, unsigned int num_threads, const Check& check) {
+	const size_t n = states.size();
+	std::atomic<size_t> stop_at{ n };
+	auto evaluate = [&](size_t first, size_t step) {
+		if (first >= n)
+			return;
+		std::unique_ptr<ScratchState> scratch;  // leased on first dirty state
+		for (size_t i = first; i < n && i < stop_at; i += step) {
+			const moveit::core::RobotState* robot = states[i];
+			if (robot->dirtyCollisionBodyTransforms()) {
+				if (!scratch)
+					scratch.reset(new ScratchState(*robot));
+				else
+					(*scratch)->setVariablePositions(robot->getVariablePositions());
+				(*scratch)->updateCollisionBodyTransforms();
+				robot = &**scratch;
+			}
+			if (check(i, *robot)) {
+				size_t current = stop_at;
+				while (i < current && !stop_at.compare_exchange_weak(current, i)) {
+				}
+			}
+		}
+	};
+	num_threads = std::max<size_t>(1, std::min<size_t>(num_threads, n));
+	std::vector<std::thread> threads;
+	const TaskExecutorPtr executor = TaskExecutor::current();
+	for (size_t t = 1; t < num_threads; ++t)
+		threads.push_back(executor->spawn([&evaluate, t, num_threads]() { evaluate(t, num_threads); }));
+	evaluate(0, num_threads);
+	for (auto& thread : threads)
+		thread.join();
+	return stop_at;
+}
+}  // namespace
+
+CollisionBackendPtr CollisionBackend::instance() {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	if (!r.backend)
+		r.backend = std::make_shared<ThreadedCollisionBackend>();
+	return r.backend;
+}
+
+void CollisionBackend::setInstance(const CollisionBackendPtr& backend) {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	r.backend = backend;
+}
+
+size_t ThreadedCollisionBackend::firstColliding(const planning_scene::PlanningScene& scene, const std::string& group,
+                                                const States& states, unsigned int num_threads,
+                                                const PreemptionToken* preempt) const {
+	// threads only pay off for long sweeps
+	static const size_t MIN_CHECKS_PER_THREAD = 16;
+	num_threads = std::max<size_t>(1, std::min<size_t>(num_threads, states.size() / MIN_CHECKS_PER_THREAD));
+
+	std::atomic<bool> preempted{ false };
+	const size_t index = sweep(states, num_threads, [&](size_t /*index*/, const moveit::core::RobotState& robot) {
+		if (PreemptionToken::requested(preempt)) {
+			preempted = true;
+			return true;
+		}
+		return group.empty() ? scene.isStateColliding(robot) : scene.isStateColliding(robot, group);
+	});
+	return preempted ? states.size() : index;
+}
+
+size_t ThreadedCollisionBackend::distances(const planning_scene::PlanningScene& scene,
+                                           const collision_detection::DistanceRequest& request, bool with_world,
+                                           const States& states, Distances& results, unsigned int num_threads,
+                                           const DistanceStop& stop) const {
+	results.assign(states.size(), collision_detection::DistanceResult());
+	return sweep(states, num_threads, [&](size_t index, const moveit::core::RobotState& robot) {
+		collision_detection::DistanceResult& result = results[index];
+		if (with_world)
+#if MOVEIT_HAS_COLLISION_ENV
+			scene.getCollisionEnv()->distanceRobot(request, result, robot);
+#else
+			scene.getCollisionWorld()->distanceRobot(request, result, *scene.getCollisionRobot(), robot);
+#endif
+		else
+#if MOVEIT_HAS_COLLISION_ENV
+			scene.getCollisionEnv()->distanceSelf(request, result, robot);
+#else
+			scene.getCollisionRobot()->distanceSelf(request, result, robot);
+#endif
+		return stop && stop(result);
+	});
+}
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,171 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    cache of collision and distance results shared by stages, solvers, and cost terms
+*/
+
+#include <moveit/task_constructor/collision_cache.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_state/robot_state.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+struct Registry
+{
+	std::mutex mutex;
+	CollisionCachePtr cache;  // disabled by default
+};
+
+Registry& registry() {
+	static Registry registry;
+	return registry;
+}
+}  // namespace
+
+CollisionCache::CollisionCache(double resolution, size_t max_scenes)
+  : resolution_(resolution), max_scenes_(std::max<size_t>(1, max_scenes)) {}
+
+std::string CollisionCache::key(const moveit::core::RobotState& state, const std::string& query) const {
+	const size_t num_variables = state.getVariableCount();
+	std::string key;
+	key.reserve(query.size() + 1 + num_variables * sizeof(long long));
+	key.append(query).push_back('\0');
+	const double* positions = state.getVariablePositions();
+	for (size_t i = 0; i != num_variables; ++i) {
+		const long long quantized = std::llround(positions[i] / resolution_);
+		key.append(reinterpret_cast<const char*>(&quantized), sizeof(quantized));
+	}
+	std::vector<const moveit::core::AttachedBody*> attached;
+	state.getAttachedBodies(attached);
+	for (const moveit::core::AttachedBody* body : attached)
+		key.append(body->getName()).push_back('\0');
+	return key;
+}
+
+CollisionCache::SceneResults& CollisionCache::results(const planning_scene::PlanningSceneConstPtr& scene) {
+	auto it = scenes_.find(scene.get());
+	if (it != scenes_.end()) {
+		if (it->second.scene.lock() != scene)  // a destroyed scene used the same address
+			it->second = SceneResults{ scene, {}, {} };
+		return it->second;
+	}
+	if (scenes_.size() >= max_scenes_) {  // drop results of destroyed scenes, all if necessary
+		for (auto next = scenes_.begin(); next != scenes_.end();)
+			next = next->second.scene.expired() ? scenes_.erase(next) : std::next(next);
+		if (scenes_.size() >= max_scenes_)
+			scenes_.clear();
+	}
+	return scenes_.emplace(scene.get(), SceneResults{ scene, {}, {} }).first->second;
+}
+
+bool CollisionCache::isColliding(const planning_scene::PlanningSceneConstPtr& scene,
+                                 const moveit::core::RobotState& state, const std::string& group,
+                                 const std::function<bool()>& check) {
+	const std::string k = key(state, group);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto& colliding = results(scene).colliding;
+		auto it = colliding.find(k);
+		if (it != colliding.end()) {
+			++hits_;
+			return it->second;
+		}
+	}
+	++misses_;
+	// check without holding the lock, allowing concurrent checks
+	const bool result = check();
+	std::lock_guard<std::mutex> lock(mutex_);
+	results(scene).colliding[k] = result;
+	return result;
+}
+
+void CollisionCache::storeColliding(const planning_scene::PlanningSceneConstPtr& scene,
+                                    const moveit::core::RobotState& state, const std::string& group,
+                                    bool colliding) {
+	const std::string k = key(state, group);
+	std::lock_guard<std::mutex> lock(mutex_);
+	results(scene).colliding[k] = colliding;
+}
+
+collision_detection::DistanceResult
+CollisionCache::distance(const planning_scene::PlanningSceneConstPtr& scene, const moveit::core::RobotState& state,
+                         const std::string& request,
+                         const std::function<collision_detection::DistanceResult()>& compute) {
+	const std::string k = key(state, request);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto& distances = results(scene).distances;
+		auto it = distances.find(k);
+		if (it != distances.end()) {
+			++hits_;
+			return it->second;
+		}
+	}
+	++misses_;
+	collision_detection::DistanceResult result = compute();
+	std::lock_guard<std::mutex> lock(mutex_);
+	results(scene).distances[k] = result;
+	return result;
+}
+
+size_t CollisionCache::size() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return scenes_.size();
+}
+
+void CollisionCache::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	scenes_.clear();
+}
+
+CollisionCachePtr CollisionCache::instance() {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	return r.cache;
+}
+
+void CollisionCache::setInstance(const CollisionCachePtr& cache) {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	r.cache = cache;
+}
+}  // namespace task_constructor
+}  // namespace moveit
@@ -38,6 +38,7 @@
 #include <moveit/task_constructor/introspection.h>
 #include <moveit/task_constructor/merge.h>
 #include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/task_constructor/task_executor.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
 
@@ -49,6 +50,13 @@
 #include <boost/range/adaptor/reversed.hpp>
 #include <boost/format.hpp>
 #include <functional>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <queue>
+#include <tuple>
+#include <type_traits>
 
 using namespace std::placeholders;
 using namespace trajectory_processing;
@@ -146,6 +154,16 @@ bool ContainerBasePrivate::traverseStages(const ContainerBase::StageCallback& pr
 	return true;
 }
 
+void ContainerBasePrivate::flushSolutionCallbacksRecursively() const {
+	flushSolutionCallbacks();
+	traverseStages(
+	    [](const Stage& stage, unsigned int /*depth*/) {
+		    stage.pimpl()->flushSolutionCallbacks();
+		    return true;
+	    },
+	    0, UINT_MAX);
+}
+
 void ContainerBasePrivate::validateConnectivity() const {
 	// recursively validate all children and accumulate errors
 	for (const auto& child : children())
@@ -153,6 +171,8 @@ void ContainerBasePrivate::validateConnectivity() const {
 }
 
 bool ContainerBasePrivate::canCompute() const {
+	if (ownDeadlineExceeded())
+		return false;
 	// call the method of the public interface
 	return static_cast<ContainerBase*>(me_)->canCompute();
 }
@@ -162,33 +182,74 @@ void ContainerBasePrivate::compute() {
 	static_cast<ContainerBase*>(me_)->compute();
 }
 
+InterfaceState::Priority ContainerBasePrivate::jobPriority() const {
+	const StagePrivate* best = nullptr;
+	for (const auto& child : children()) {
+		const StagePrivate* impl = child->pimpl();
+		if (impl->canCompute() && (!best || impl->jobPriority() < best->jobPriority()))
+			best = impl;
+	}
+	return best ? best->jobPriority() : StagePrivate::jobPriority();
+}
+
+size_t ContainerBasePrivate::pendingJobs() const {
+	size_t jobs = 0;
+	for (const auto& child : children())
+		jobs += child->pimpl()->pendingJobs();
+	return jobs;
+}
+
 template <Interface::Direction dir>
 void ContainerBasePrivate::setStatus(const Stage* creator, const InterfaceState* source, const InterfaceState* target,
                                      InterfaceState::Status status) {
+	// Traverse the solution tree depth-first using an explicit stack instead of recursion.
+	// Nested calls push on top of the stack and are completed before they return.
+	const size_t base = status_jobs_.size();
+	status_jobs_.push_back(StatusJob{ creator, source, target, status });
+	while (status_jobs_.size() > base) {
+		StatusJob job = status_jobs_.back();
+		status_jobs_.pop_back();
+		if (!applyStatus<dir>(job.creator, job.source, job.target, job.status))
+			continue;
+
+		// traverse solution tree, maintaining the order of recursive traversal
+		const auto& successors = trajectories<dir>(*job.target);
+		for (auto it = successors.rbegin(), end = successors.rend(); it != end; ++it)
+			status_jobs_.push_back(StatusJob{ (*it)->creator(), job.target, state<dir>(**it), job.status });
+	}
+}
+
+template <Interface::Direction dir>
+bool ContainerBasePrivate::applyStatus(const Stage* creator, const InterfaceState* source,
+                                       const InterfaceState* target, InterfaceState::Status& status) {
+	// The status itself marks visited states: a state reached again via another path is skipped here.
+	if (target->priority().status() == status)
+		return false;  // nothing changing
+
 	if (status != InterfaceState::Status::ENABLED && creator) {
 		if (const auto* conn = dynamic_cast<const Connecting*>(creator)) {
 			auto cimpl = conn->pimpl();
 			// if creator is a Connecting stage and target has enabled opposite states (other than source)
 			if (cimpl->hasPendingOpposites<dir>(source, target))
-				return;  // don't prune
+				return false;  // don't prune
 		}
 	}
-	if (target->priority().status() == status)
-		return;  // nothing changing
 
 	// Skip disabling the state, if there are alternative enabled solutions
 	if (status != InterfaceState::ENABLED) {
 		auto solution_is_enabled = [](auto&& solution) {
-			return state<opposite<dir>()>(*solution)->priority().enabled();
+			return !solution->isFailure() && state<opposite<dir>()>(*solution)->priority().enabled();
 		};
 		const auto& alternatives = trajectories<opposite<dir>()>(*target);
 		auto alternative_path = std::find_if(alternatives.cbegin(), alternatives.cend(), solution_is_enabled);
 		if (alternative_path != alternatives.cend())
-			return;
+			return false;
 	}
 
 	// actually enable/disable the state
 	const_cast<InterfaceState*>(target)->updateStatus(status);
+	if (status != InterfaceState::ENABLED && target->priority().status() == status)
+		++num_pruned_;
 
 	// if possible (i.e. if target has an external counterpart), escalate setStatus to external interface
 	if (parent() && trajectories<dir>(*target).empty()) {
@@ -202,7 +263,7 @@ void ContainerBasePrivate::setStatus(const Stage* creator, const InterfaceState*
 			auto other_path{ std::find_if(internals.first, internals.second, is_enabled) };
 			if (other_path == internals.second)
 				parent()->pimpl()->setStatus<dir>(nullptr, nullptr, external->get<EXTERNAL>(), status);
-			return;
+			return false;
 		}
 	}
 
@@ -213,10 +274,7 @@ void ContainerBasePrivate::setStatus(const Stage* creator, const InterfaceState*
 	// For details, https://github.com/ros-planning/moveit_task_constructor/pull/309#issuecomment-974636202
 	if (status == InterfaceState::Status::ARMED)
 		status = InterfaceState::Status::PRUNED;  // only the first state is marked as ARMED
-
-	// traverse solution tree
-	for (const SolutionBase* successor : trajectories<dir>(*target))
-		setStatus<dir>(successor->creator(), target, state<dir>(*successor), status);
+	return true;
 }
 
 // recursively update state priorities along solution path
@@ -230,8 +288,14 @@ inline void updateStatePrios(const InterfaceState& s, const InterfaceState::Prio
 		updateStatePrios<dir>(*state<dir>(*successor), prio);
 }
 
+void ContainerBasePrivate::onStageTreeChanged() {
+	if (parent())
+		parent()->pimpl()->onStageTreeChanged();
+}
+
 void ContainerBasePrivate::onNewFailure(const Stage& child, const InterfaceState* from, const InterfaceState* to) {
 	ROS_DEBUG_STREAM_NAMED("Pruning", "'" << child.name() << "' generated a failure");
+	logEvent(eventSource(), EventLog::CHILD_FAILURE, 0.0, child.pimpl()->eventSource());
 	switch (child.pimpl()->interfaceFlags()) {
 		case GENERATE:
 			// just ignore: the pair of (new) states isn't known to us anyway
@@ -253,6 +317,66 @@ void ContainerBasePrivate::onNewFailure(const Stage& child, const InterfaceState
 	// printChildrenInterfaces(*this, false, child);
 }
 
+void ContainerBasePrivate::pruneInvalidSolution(const Stage& child, const SolutionBase& solution) {
+	ROS_DEBUG_STREAM_NAMED("Pruning", "'" << child.name() << "' invalidated a solution");
+	logEvent(eventSource(), EventLog::CHILD_INVALIDATED, 0.0, child.pimpl()->eventSource());
+	// prune both ends: the invalid solution doesn't count as an alternative path anymore
+	setStatus<Interface::FORWARD>(nullptr, nullptr, solution.end(), InterfaceState::Status::PRUNED);
+	setStatus<Interface::BACKWARD>(nullptr, nullptr, solution.start(), InterfaceState::Status::PRUNED);
+}
+
+void ContainerBasePrivate::pruneEvictedSolution(const Stage& child, const SolutionBase& solution) {
+	ROS_DEBUG_STREAM_NAMED("Pruning", "'" << child.name() << "' dropped a solution");
+	logEvent(eventSource(), EventLog::CHILD_DROPPED, 0.0, child.pimpl()->eventSource());
+	// states created by the dropped solution don't have any other incoming resp. outgoing trajectory
+	const InterfaceFlags flags = child.pimpl()->interfaceFlags();
+	if (flags & WRITES_NEXT_START)
+		setStatus<Interface::FORWARD>(nullptr, nullptr, solution.end(), InterfaceState::Status::PRUNED);
+	if (flags & WRITES_PREV_END)
+		setStatus<Interface::BACKWARD>(nullptr, nullptr, solution.start(), InterfaceState::Status::PRUNED);
+}
+
+bool ContainerBasePrivate::refersTo(const SolutionBase& child_solution) const {
+	auto refers = [&child_solution](const SolutionBaseConstPtr& solution) {
+		if (const auto* sequence = dynamic_cast<const SolutionSequence*>(solution.get()))
+			return std::find(sequence->solutions().begin(), sequence->solutions().end(), &child_solution) !=
+			       sequence->solutions().end();
+		if (const auto* wrapped = dynamic_cast<const WrappedSolution*>(solution.get()))
+			return wrapped->wrapped() == &child_solution;
+		return false;
+	};
+	return std::any_of(solutions_.begin(), solutions_.end(), refers) ||
+	       std::any_of(failures_.begin(), failures_.end(), refers);
+}
+
+size_t ContainerBasePrivate::revalidate(SceneUpdate& update) {
+	size_t num_invalidated = 0;
+	for (const auto& child : children())
+		num_invalidated += child->pimpl()->revalidate(update);
+
+	for (InterfaceState& state : states_)
+		update.apply(state);
+
+	// solutions of containers are composed of child solutions
+	auto is_invalid = [](const SolutionBase& solution) {
+		if (const auto* sequence = dynamic_cast<const SolutionSequence*>(&solution))
+			return std::any_of(sequence->solutions().begin(), sequence->solutions().end(),
+			                   [](const SolutionBase* s) { return s->isFailure(); });
+		if (const auto* wrapped = dynamic_cast<const WrappedSolution*>(&solution))
+			return wrapped->wrapped()->isFailure();
+		return false;
+	};
+	for (auto it = solutions_.begin(); it != solutions_.end();) {
+		auto next = std::next(it);
+		if (is_invalid(**it)) {
+			invalidateSolution(it, COMPOSED_OF_INVALID);
+			++num_invalidated;
+		}
+		it = next;
+	}
+	return num_invalidated;
+}
+
 template <Interface::Direction dir>
 void ContainerBasePrivate::copyState(Interface::iterator external, const InterfacePtr& target,
                                      Interface::UpdateFlags updated) {
@@ -314,14 +438,32 @@ void ContainerBasePrivate::liftSolution(const SolutionBasePtr& solution, const I
 
 	// spawn created states in external interfaces
 	if (created_from)
-		prevEnds()->add(*external_from);
+		prevEndsRaw()->add(*external_from);
 	if (created_to)
-		nextStarts()->add(*external_to);
+		nextStartsRaw()->add(*external_to);
 
 	newSolution(solution);
 }
 
-ContainerBase::ContainerBase(ContainerBasePrivate* impl) : Stage(impl) {}
+ContainerBase::ContainerBase(ContainerBasePrivate* impl) : Stage(impl) {
+	properties().declare<double>("deadline", 0.0, "compute time limit [s] of this container (0: unlimited)");
+}
+
+ContainerBase::~ContainerBase() {
+	pimpl()->flushSolutionCallbacksRecursively();  // before any child is destroyed
+}
+
+void ContainerBase::refillDeadline() {
+	pimpl()->refillDeadline();
+}
+
+double ContainerBase::deadlineUsed() const {
+	return pimpl()->deadlineUsed();
+}
+
+bool ContainerBase::deadlineExceeded() const {
+	return pimpl()->deadlineExceeded();
+}
 
 size_t ContainerBase::numChildren() const {
 	return pimpl()->children().size();
@@ -362,6 +504,7 @@ void ContainerBase::insert(Stage::pointer&& stage, int before) {
 	ContainerBasePrivate::const_iterator where = pimpl()->childByIndex(before, true);
 	ContainerBasePrivate::iterator it = pimpl()->children_.insert(where, std::move(stage));
 	impl->setParentPosition(it);
+	pimpl()->markDirty();
 }
 
 Stage::pointer ContainerBasePrivate::remove(ContainerBasePrivate::const_iterator pos) {
@@ -369,11 +512,21 @@ Stage::pointer ContainerBasePrivate::remove(ContainerBasePrivate::const_iterator
 		return Stage::pointer();
 
 	(*pos)->pimpl()->unparent();
+	markDirty();
 	Stage::pointer result = std::move(*children_.erase(pos, pos));  // stage from non-const iterator to pos
 	children_.erase(pos);  // actually erase stage
 	return result;
 }
 
+bool ContainerBasePrivate::needsInit(const moveit::core::RobotModelConstPtr& robot_model) const {
+	if (StagePrivate::needsInit(robot_model))
+		return true;
+	for (const auto& child : children_)
+		if (child->pimpl()->needsInit(robot_model))
+			return true;
+	return false;
+}
+
 Stage::pointer ContainerBase::remove(int pos) {
 	return pimpl()->remove(pimpl()->childByIndex(pos, false));
 }
@@ -386,11 +539,15 @@ Stage::pointer ContainerBase::remove(Stage* child) {
 }
 
 void ContainerBase::clear() {
+	pimpl()->flushSolutionCallbacksRecursively();
 	pimpl()->children_.clear();
+	pimpl()->markDirty();
 }
 
 void ContainerBase::reset() {
 	auto impl = pimpl();
+	// queued solutions of any descendant might refer to states of the children reset below
+	impl->flushSolutionCallbacksRecursively();
 
 	// recursively reset children
 	for (auto& child : impl->children())
@@ -406,6 +563,7 @@ void ContainerBase::reset() {
 	impl->required_interface_ = UNKNOWN;
 	impl->starts_.reset();
 	impl->ends_.reset();
+	impl->refillDeadline();
 
 	Stage::reset();
 }
@@ -415,16 +573,20 @@ void ContainerBase::init(const moveit::core::RobotModelConstPtr& robot_model) {
 	auto& children = impl->children();
 
 	Stage::init(robot_model);
+	impl->deadline_ = properties().get<double>("deadline");
 
 	// we need to have some children to do the actual work
 	if (children.empty())
 		throw InitStageException(*this, "no children");
 
-	// recursively init all children and accumulate errors
+	// recursively init all (changed) children and accumulate errors
 	InitStageException errors;
 	for (auto& child : children) {
+		if (!child->pimpl()->needsInit(robot_model))
+			continue;
 		try {
 			child->init(robot_model);
+			child->pimpl()->markInitialized(robot_model);
 		} catch (const Property::error& e) {
 			std::ostringstream oss;
 			oss << e.what();
@@ -439,6 +601,11 @@ void ContainerBase::init(const moveit::core::RobotModelConstPtr& robot_model) {
 		throw errors;
 }
 
+void ContainerBase::onNewSolutions(const std::vector<const SolutionBase*>& solutions) {
+	for (const SolutionBase* s : solutions)
+		onNewSolution(*s);
+}
+
 std::ostream& operator<<(std::ostream& os, const ContainerBase& container) {
 	ContainerBase::StageCallback processor = [&os](const Stage& stage, unsigned int depth) -> bool {
 		os << std::string(2 * depth, ' ') << *stage.pimpl() << std::endl;
@@ -448,41 +615,95 @@ std::ostream& operator<<(std::ostream& os, const ContainerBase& container) {
 	return os;
 }
 
-/** Collect all partial solution sequences originating from start into given direction */
+/** Lazily enumerate partial solution paths of given depth originating from start into given direction
+ *
+ * Best-first search over the solution graph yields complete paths in order of increasing cost
+ * (assuming non-negative costs), such that only requested paths need to be assembled.
+ */
 template <Interface::Direction dir>
-struct SolutionCollector
+class SolutionPathEnumerator
 {
-	SolutionCollector(size_t max_depth, const SolutionBase& start) : max_depth(max_depth) {
-		trace.reserve(max_depth);
-		traverse(start, InterfaceState::Priority(0, 0.0));
-		assert(trace.empty());
+public:
+	using Path = std::pair<SolutionSequence::container_type, double>;  // solutions (starting at start) + their cost
+
+	SolutionPathEnumerator(const SolutionBase& start, size_t depth) : depth_(depth) {
+		queue_.push(std::make_shared<const Node>(Node{ nullptr, nullptr, state<dir>(start), 0u, 0.0 }));
 	}
 
-	void traverse(const SolutionBase& start, const InterfaceState::Priority& prio) {
-		const InterfaceState::Solutions& next = trajectories<dir>(*state<dir>(start));
-		if (next.empty()) {  // when reaching the end, add the trace to solutions
-			assert(prio.depth() == trace.size());
-			assert(prio.depth() <= max_depth);
-			solutions.emplace_back(std::make_pair(trace, prio));
-		} else {
-			for (SolutionBase* successor : next) {
-				assert(!successor->isFailure());  // We shouldn't have invalid solutions
-				trace.push_back(successor);
-				traverse(*successor, prio + InterfaceState::Priority(1, successor->cost()));
-				trace.pop_back();
+	/// retrieve next cheapest path, returns false if there are no more
+	bool next(Path& path) {
+		while (!queue_.empty()) {
+			NodePtr node = queue_.top();
+			queue_.pop();
+
+			bool extended = false;
+			for (const SolutionBase* successor : trajectories<dir>(*node->state)) {
+				if (successor->isFailure())
+					continue;
+				queue_.push(std::make_shared<const Node>(
+				    Node{ successor, node, state<dir>(*successor), node->depth + 1, node->cost + successor->cost() }));
+				extended = true;
 			}
+			if (extended || node->depth != depth_)
+				continue;  // only consider paths reaching the container's boundary
+
+			path.first.resize(node->depth);
+			auto it = path.first.rbegin();
+			for (const Node* n = node.get(); n->solution; n = n->prefix.get())
+				*it++ = n->solution;
+			path.second = node->cost;
+			return true;
 		}
+		return false;
 	}
 
-	using SolutionCostPairs = std::list<std::pair<SolutionSequence::container_type, InterfaceState::Priority>>;
-	SolutionCostPairs solutions;
-	const size_t max_depth;
-	SolutionSequence::container_type trace;
+private:
+	// partial paths share their common prefix
+	struct Node
+	{
+		const SolutionBase* solution;  // last solution of the path (nullptr for an empty path)
+		std::shared_ptr<const Node> prefix;
+		const InterfaceState* state;  // state reached by the path
+		unsigned int depth;
+		double cost;
+	};
+	using NodePtr = std::shared_ptr<const Node>;
+	struct Greater
+	{
+		bool operator()(const NodePtr& lhs, const NodePtr& rhs) const { return lhs->cost > rhs->cost; }
+	};
+
+	const size_t depth_;
+	std::priority_queue<NodePtr, std::vector<NodePtr>, Greater> queue_;
 };
 
+/// priority of the path originating from s, which always follows the latest solution
+template <Interface::Direction dir>
+InterfaceState::Priority latestPathPriority(const InterfaceState& s) {
+	InterfaceState::Priority prio(0, 0.0);
+	for (const InterfaceState* current = &s;;) {
+		const InterfaceState::Solutions& next = trajectories<dir>(*current);
+		auto successor = std::find_if(next.rbegin(), next.rend(), [](const SolutionBase* solution) {
+			return !solution->isFailure();
+		});
+		if (successor == next.rend())
+			return prio;
+		prio = prio + InterfaceState::Priority(1, (*successor)->cost());
+		current = state<dir>(**successor);
+	}
+}
+
+void SerialContainer::onNewSolutions(const std::vector<const SolutionBase*>& solutions) {
+	// re-sort interfaces only once for all solutions of the batch
+	Interface::BatchUpdate batch;
+	ContainerBase::onNewSolutions(solutions);
+}
+
 void SerialContainer::onNewSolution(const SolutionBase& current) {
 	ROS_DEBUG_STREAM_NAMED("SerialContainer", "'" << this->name() << "' received solution of child stage '"
 	                                              << current.creator()->name() << "'");
+	logEvent(pimpl()->eventSource(), EventLog::CHILD_SOLUTION, current.cost(),
+	         current.creator()->pimpl()->eventSource());
 
 	// failures should never trigger this callback
 	assert(!current.isFailure());
@@ -499,35 +720,61 @@ void SerialContainer::onNewSolution(const SolutionBase& current) {
 	assert(num_before < children.size());  // creator should be one of our children
 	num_after = children.size() - 1 - num_before;
 
-	// find all incoming and outgoing solution paths originating from current solution
-	SolutionCollector<Interface::BACKWARD> incoming(num_before, current);
-	SolutionCollector<Interface::FORWARD> outgoing(num_after, current);
-
-	// collect (and sort) all solutions spanning from start to end of this container
-	ordered<SolutionSequencePtr> sorted;
-	for (auto& in : incoming.solutions) {
-		for (auto& out : outgoing.solutions) {
-			InterfaceState::Priority prio = in.second + InterfaceState::Priority(1u, current.cost()) + out.second;
-			assert(prio.enabled());
-			// found a complete solution path connecting start to end?
-			if (prio.depth() == children.size()) {
-				SolutionSequence::container_type solution;
-				solution.reserve(children.size());
-				// insert incoming solutions in reverse order
-				solution.insert(solution.end(), in.first.rbegin(), in.first.rend());
-				// insert current solution
-				solution.push_back(&current);
-				// insert outgoing solutions in normal order
-				solution.insert(solution.end(), out.first.begin(), out.first.end());
-				// store solution in sorted list
-				sorted.insert(std::make_shared<SolutionSequence>(std::move(solution), prio.cost(), this));
-			}
-			if (prio.depth() > 1) {
-				// update state priorities along the whole partial solution path
-				updateStatePrios<Interface::BACKWARD>(*current.start(), prio);
-				updateStatePrios<Interface::FORWARD>(*current.end(), prio);
-			}
-		}
+	// update state priorities along the whole partial solution path
+	InterfaceState::Priority prio = latestPathPriority<Interface::BACKWARD>(*current.start()) +
+	                                InterfaceState::Priority(1u, current.cost()) +
+	                                latestPathPriority<Interface::FORWARD>(*current.end());
+	if (prio.depth() > 1) {
+		// re-sort interfaces only once after updating all state priorities
+		Interface::BatchUpdate batch;
+		updateStatePrios<Interface::BACKWARD>(*current.start(), prio);
+		updateStatePrios<Interface::FORWARD>(*current.end(), prio);
+	}
+
+	// lazily enumerate complete solution paths through current solution in order of increasing cost:
+	// combining the sorted incoming and outgoing paths, successors of pair (i, j) are (i+1, j) and (i, j+1)
+	using Incoming = SolutionPathEnumerator<Interface::BACKWARD>;
+	using Outgoing = SolutionPathEnumerator<Interface::FORWARD>;
+	Incoming incoming(current, num_before);
+	Outgoing outgoing(current, num_after);
+	std::vector<Incoming::Path> in;
+	std::vector<Outgoing::Path> out;
+	auto available = [](auto& enumerator, auto& paths, size_t index) {
+		typename std::decay_t<decltype(paths)>::value_type path;
+		while (paths.size() <= index && enumerator.next(path))
+			paths.push_back(std::move(path));
+		return index < paths.size();
+	};
+
+	using Candidate = std::tuple<double, size_t, size_t>;  // cost, index into in, index into out
+	std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+	auto add_candidate = [&](size_t i, size_t j) {
+		if (available(incoming, in, i) && available(outgoing, out, j))
+			candidates.emplace(in[i].second + current.cost() + out[j].second, i, j);
+	};
+	add_candidate(0, 0);
+
+	const size_t max_paths = properties().get<size_t>("max_solution_paths");
+	std::vector<SolutionSequencePtr> sorted;
+	while (!candidates.empty() && (max_paths == 0 || sorted.size() < max_paths)) {
+		double cost;
+		size_t i, j;
+		std::tie(cost, i, j) = candidates.top();
+		candidates.pop();
+
+		SolutionSequence::container_type solution;
+		solution.reserve(children.size());
+		// insert incoming solutions in reverse order
+		solution.insert(solution.end(), in[i].first.rbegin(), in[i].first.rend());
+		// insert current solution
+		solution.push_back(&current);
+		// insert outgoing solutions in normal order
+		solution.insert(solution.end(), out[j].first.begin(), out[j].first.end());
+		sorted.push_back(std::make_shared<SolutionSequence>(std::move(solution), cost, this));
+
+		if (j == 0)
+			add_candidate(i + 1, j);
+		add_candidate(i, j + 1);
 	}
 	// printChildrenInterfaces(*this->pimpl(), true, *current.creator());
 
@@ -536,7 +783,10 @@ void SerialContainer::onNewSolution(const SolutionBase& current) {
 		impl->liftSolution(solution, solution->internalStart(), solution->internalEnd());
 }
 
-SerialContainer::SerialContainer(SerialContainerPrivate* impl) : ContainerBase(impl) {}
+SerialContainer::SerialContainer(SerialContainerPrivate* impl) : ContainerBase(impl) {
+	properties().declare<size_t>("max_solution_paths", 0,
+	                             "max number of (cheapest) solutions assembled per new child solution (0: all)");
+}
 SerialContainer::SerialContainer(const std::string& name) : SerialContainer(new SerialContainerPrivate(this, name)) {}
 
 SerialContainerPrivate::SerialContainerPrivate(SerialContainer* me, const std::string& name)
@@ -817,26 +1067,77 @@ void WrapperBase::compute() {
 	wrapped()->pimpl()->runCompute();
 }
 
+AlternativesPrivate::AlternativesPrivate(Alternatives* me, const std::string& name)
+  : ParallelContainerBasePrivate(me, name) {}
+
+const PreemptionToken* AlternativesPrivate::childPreemptionToken(const StagePrivate* child) {
+	auto& token = child_tokens_[child];
+	if (!token)
+		token = std::make_unique<PreemptionToken>();
+	token->setParent(preemptionToken());
+	return token.get();
+}
+
+void AlternativesPrivate::finishRace(const Stage* winner) {
+	winner_ = winner;
+	for (const Stage::pointer& child : children()) {
+		if (child.get() == winner)
+			continue;
+		auto it = child_tokens_.find(child->pimpl());
+		if (it != child_tokens_.end())
+			it->second->request();
+	}
+}
+
+Alternatives::Alternatives(const std::string& name) : Alternatives(new AlternativesPrivate(this, name)) {}
+
+Alternatives::Alternatives(AlternativesPrivate* impl) : ParallelContainerBase(impl) {
+	properties().declare<bool>("racing", false, "preempt other children once one found a good enough solution");
+	properties().declare<double>("race_cost_threshold", std::numeric_limits<double>::infinity(),
+	                             "max cost of a solution deciding the race");
+}
+
+const Stage* Alternatives::raceWinner() const {
+	return pimpl()->winner_;
+}
+
+void Alternatives::reset() {
+	auto impl = pimpl();
+	impl->winner_ = nullptr;
+	for (auto& token : impl->child_tokens_)
+		token.second->reset();
+	ParallelContainerBase::reset();
+}
+
 bool Alternatives::canCompute() const {
 	for (const auto& stage : pimpl()->children())
-		if (stage->pimpl()->canCompute())
+		if (!stage->pimpl()->preempted() && stage->pimpl()->canCompute())
 			return true;
 	return false;
 }
 
 void Alternatives::compute() {
 	for (const auto& stage : pimpl()->children()) {
-		stage->pimpl()->runCompute();
+		if (!stage->pimpl()->preempted())
+			stage->pimpl()->runCompute();
 	}
 }
 
 void Alternatives::onNewSolution(const SolutionBase& s) {
 	liftSolution(s);
+
+	auto impl = pimpl();
+	if (!impl->winner_ && !s.isFailure() && properties().get<bool>("racing") &&
+	    s.cost() <= properties().get<double>("race_cost_threshold"))
+		impl->finishRace(s.creator());
 }
 
 Fallbacks::Fallbacks(const std::string& name) : Fallbacks(new FallbacksPrivate(this, name)) {}
 
-Fallbacks::Fallbacks(FallbacksPrivate* impl) : ParallelContainerBase(impl) {}
+Fallbacks::Fallbacks(FallbacksPrivate* impl) : ParallelContainerBase(impl) {
+	properties().declare<bool>("speculative", false, "speculatively compute next child in concurrent planning");
+	properties().declare<bool>("adaptive_order", false, "try children by their success rate per compute time");
+}
 
 void Fallbacks::reset() {
 	ParallelContainerBase::reset();
@@ -852,6 +1153,25 @@ void Fallbacks::onNewSolution(const SolutionBase& s) {
 	pimpl()->onNewSolution(s);
 }
 
+void Fallbacks::setStateClassifier(const StateClassifier& classifier) {
+	pimpl()->classifier_ = classifier;
+}
+
+const Fallbacks::OrderStatistics& Fallbacks::orderStatistics() const {
+	return pimpl()->order_stats_;
+}
+
+void Fallbacks::setOrderStatistics(const OrderStatistics& statistics) {
+	pimpl()->order_stats_ = statistics;
+}
+
+std::vector<std::string> Fallbacks::childOrder(const std::string& state_class) const {
+	std::vector<std::string> names;
+	for (const auto& it : pimpl()->childOrder(state_class))
+		names.push_back((*it)->name());
+	return names;
+}
+
 inline void Fallbacks::replaceImpl() {
 	FallbacksPrivate *impl = pimpl();
 	switch (pimpl()->requiredInterface()) {
@@ -881,6 +1201,8 @@ FallbacksPrivate::FallbacksPrivate(FallbacksPrivate&& other)
 : ParallelContainerBasePrivate(static_cast<Fallbacks*>(other.me()), "") {
 	// move contents of other
 	this->ParallelContainerBasePrivate::operator=(std::move(other));
+	classifier_ = std::move(other.classifier_);
+	order_stats_ = std::move(other.order_stats_);
 }
 
 void FallbacksPrivate::initializeExternalInterfaces() {
@@ -903,8 +1225,64 @@ void FallbacksPrivate::onNewFailure(const Stage& child, const InterfaceState* /*
 	(void)child;
 }
 
+std::string FallbacksPrivate::stateClass(const InterfaceState* state) const {
+	return (state && classifier_) ? classifier_(state) : std::string();
+}
+
+std::vector<container_type::const_iterator> FallbacksPrivate::childOrder(const std::string& state_class) const {
+	std::vector<container_type::const_iterator> order;
+	for (auto it = children().begin(), end = children().end(); it != end; ++it)
+		order.push_back(it);
+
+	auto stats = order_stats_.find(state_class);
+	if (!properties_.get<bool>("adaptive_order") || stats == order_stats_.end())
+		return order;
+
+	// untried children are assumed to take the class' mean compute time
+	size_t attempts = 0;
+	double time = 0.0;
+	for (const auto& child : stats->second) {
+		attempts += child.second.attempts;
+		time += child.second.compute_time;
+	}
+	const double mean_time = attempts ? time / attempts : 1.0;
+
+	// score: success rate (Laplace-smoothed, i.e. 0.5 without attempts) per mean compute time
+	std::map<const Stage*, double> scores;
+	for (const auto& it : order) {
+		auto child = stats->second.find((*it)->name());
+		double score = 0.5 / std::max(mean_time, 1e-6);
+		if (child != stats->second.end() && child->second.attempts > 0) {
+			const Fallbacks::ChildStatistics& s = child->second;
+			score = (s.successes + 1.0) / (s.attempts + 2.0) / std::max(s.compute_time / s.attempts, 1e-6);
+		}
+		scores[it->get()] = score;
+	}
+	std::stable_sort(order.begin(), order.end(), [&scores](const auto& a, const auto& b) {
+		return scores[a->get()] > scores[b->get()];
+	});
+	return order;
+}
+
 void FallbacksPrivateCommon::reset() {
-	current_ = children().begin();
+	startOrder(nullptr);
+}
+
+void FallbacksPrivateCommon::startOrder(const InterfaceState* state) {
+	job_class_ = stateClass(state);
+	order_ = childOrder(job_class_);
+	rank_ = 0;
+	current_ = order_.empty() ? children().end() : order_.front();
+	time_mark_ = current_ == children().end() ? 0.0 : (*current_)->getTotalComputeTime();
+}
+
+void FallbacksPrivateCommon::recordAttempt(bool success) {
+	assert(current_ != children().end());
+	const Stage& child = **current_;
+	Fallbacks::ChildStatistics& s = order_stats_[job_class_][child.name()];
+	++s.attempts;
+	s.successes += success;
+	s.compute_time += std::max(0.0, child.getTotalComputeTime() - time_mark_);
 }
 
 bool FallbacksPrivateCommon::canCompute() const {
@@ -921,9 +1299,14 @@ void FallbacksPrivateCommon::compute() {
 }
 
 inline void FallbacksPrivateCommon::nextChild() {
-	if (std::next(current_) != children().end())
+	recordAttempt(false);
+	if (rank_ + 1 < order_.size()) {
 		ROS_DEBUG_STREAM_NAMED("Fallbacks", "Child '" << (*current_)->name() << "' failed, trying next one.");
-	++current_;  // advance to next child
+		logEvent(eventSource(), EventLog::FALLBACK, 0.0, (*current_)->pimpl()->eventSource());
+	}
+	// advance to next child
+	current_ = ++rank_ < order_.size() ? order_[rank_] : children().end();
+	time_mark_ = current_ == children().end() ? 0.0 : (*current_)->getTotalComputeTime();
 }
 
 FallbacksPrivateGenerator::FallbacksPrivateGenerator(FallbacksPrivate&& old)
@@ -934,6 +1317,7 @@ bool FallbacksPrivateGenerator::nextJob() {
 
 	// don't advance to next child when we already produced solutions
 	if (!solutions_.empty()) {
+		recordAttempt(true);
 		current_ = children().end();  // indicate that we are exhausted
 		return false;
 	}
@@ -967,13 +1351,65 @@ void FallbacksPrivatePropagator::reset() {
 	FallbacksPrivateCommon::reset();
 	job_ = pullInterface(dir_)->end();  // indicate fresh start
 	job_has_solutions_ = false;
+	speculated_ = children().end();
+	speculation_time_mark_ = 0.0;
+	speculative_solutions_.clear();
+}
+
+void FallbacksPrivatePropagator::compute() {
+	std::mutex* mutex = planningMutex();
+	auto next = rank_ + 1 < order_.size() ? order_[rank_ + 1] : children().end();
+	if (!mutex || next == children().end() || speculated_ != children().end() ||
+	    !properties_.get<bool>("speculative"))
+		return FallbacksPrivateCommon::compute();
+
+	// feed the current job to the next child as well and compute both in parallel:
+	// their ComputeUnlock scopes interleave on the planning lock
+	speculated_ = next;
+	speculation_time_mark_ = (*next)->getTotalComputeTime();
+	copyState(dir_, job_, (*next)->pimpl()->pullInterface(dir_), Interface::UpdateFlags());
+	std::exception_ptr speculation_exception;
+	std::thread speculation = TaskExecutor::current()->spawn([next, mutex, &speculation_exception]() {
+		std::lock_guard<std::mutex> lock(*mutex);
+		try {
+			while ((*next)->pimpl()->canCompute())
+				(*next)->pimpl()->runCompute();
+		} catch (...) {
+			speculation_exception = std::current_exception();
+		}
+	});
+
+	std::exception_ptr exception;
+	try {
+		(*current_)->pimpl()->runCompute();
+	} catch (...) {
+		exception = std::current_exception();
+	}
+	mutex->unlock();  // allow speculation to finish
+	speculation.join();
+	mutex->lock();
+
+	if (exception)
+		std::rethrow_exception(exception);
+	if (speculation_exception)
+		std::rethrow_exception(speculation_exception);
 }
 
 void FallbacksPrivatePropagator::onNewSolution(const SolutionBase& s) {
+	if (speculated_ != children().end() && s.creator() == speculated_->get()) {
+		speculative_solutions_.push_back(&s);  // only lift them if current child fails
+		return;
+	}
 	job_has_solutions_ = true;
 	FallbacksPrivateCommon::onNewSolution(s);
 }
 
+bool FallbacksPrivatePropagator::refersTo(const SolutionBase& child_solution) const {
+	return FallbacksPrivateCommon::refersTo(child_solution) ||
+	       std::find(speculative_solutions_.begin(), speculative_solutions_.end(), &child_solution) !=
+	           speculative_solutions_.end();
+}
+
 bool FallbacksPrivatePropagator::nextJob() {
 	assert(current_ != children().end() && !(*current_)->pimpl()->canCompute());
 	const auto jobs = pullInterface(dir_);
@@ -981,24 +1417,43 @@ bool FallbacksPrivatePropagator::nextJob() {
 	if (job_ != jobs->end()) { // current job exists, but is exhausted on current child
 		if (!job_has_solutions_) // job didn't produce solutions -> feed to next child
 			nextChild();
-		else
+		else {
+			recordAttempt(true);
 			current_ = children().end();  // indicate that this job is exhausted on all children
+		}
 	}
 	job_has_solutions_ = false;
 
+	if (current_ != children().end() && current_ == speculated_) {
+		// current child already processed job_ speculatively: adopt its solutions
+		speculated_ = children().end();
+		time_mark_ = speculation_time_mark_;  // account for the speculative computation
+		for (const SolutionBase* s : speculative_solutions_) {
+			job_has_solutions_ = true;
+			FallbacksPrivateCommon::onNewSolution(*s);
+		}
+		speculative_solutions_.clear();
+		return nextJob();  // advance as speculated_ is exhausted on job_
+	}
+
 	if (current_ == children().end()) {  // all children processed the job_
+		// discard results of speculation
+		speculated_ = children().end();
+		speculative_solutions_.clear();
 		if (job_ != jobs->end()) {
 			jobs->remove(job_);  // we don't need the job in our interface list anymore
 			job_ = jobs->end();  // indicate that we need to fetch a new job
 		}
-		current_ = children().begin();  // start next job with first child again
+		rank_ = 0;  // start next job with first child again
+		current_ = order_.front();
 	}
 
 	// pick next job if needed and possible
 	if (job_ == jobs->end()) {  // need to pick next job
-		if (!jobs->empty() && jobs->front()->priority().enabled())
- 			job_ = jobs->begin();
-		else
+		if (!jobs->empty() && jobs->front()->priority().enabled()) {
+			job_ = jobs->begin();
+			startOrder(*job_);  // order children for the new job's class
+		} else
 			return false; // no more jobs available
 	}
 
@@ -1090,6 +1545,9 @@ void MergerPrivate::resolveInterface(InterfaceFlags expected) {
 Merger::Merger(const std::string& name) : Merger(new MergerPrivate(this, name)) {
 	properties().declare<TimeParameterizationPtr>("time_parameterization",
 	                                                 std::make_shared<TimeOptimalTrajectoryGeneration>());
+	properties().declare<uint32_t>("max_combinations", 0, "max merge attempts per new solution (0 = unlimited)");
+	properties().declare<uint32_t>("num_threads", 1, "number of combinations to merge in parallel");
+	properties().declare<bool>("concurrent", false, "compute children concurrently");
 }
 
 void Merger::reset() {
@@ -1097,6 +1555,7 @@ void Merger::reset() {
 	auto impl = pimpl();
 	impl->jmg_merged_.reset();
 	impl->source_state_to_solutions_.clear();
+	impl->pair_conflicts_.clear();
 }
 
 void Merger::init(const core::RobotModelConstPtr& robot_model) {
@@ -1113,9 +1572,74 @@ bool Merger::canCompute() const {
 }
 
 void Merger::compute() {
-	for (const auto& stage : pimpl()->children()) {
-		stage->pimpl()->runCompute();
+	auto impl = pimpl();
+	std::vector<StagePrivate*> computable;
+	for (const auto& stage : impl->children())
+		if (stage->pimpl()->canCompute())
+			computable.push_back(stage->pimpl());
+	if (!properties().get<bool>("concurrent")) {
+		for (StagePrivate* child : computable)
+			child->runCompute();
+		return;
 	}
+	impl->computeConcurrently(computable);
+}
+
+void ParallelContainerBasePrivate::computeConcurrently(const std::vector<StagePrivate*>& computable) {
+	if (computable.size() < 2) {
+		for (StagePrivate* child : computable)
+			child->runCompute();
+		return;
+	}
+
+	// compute all children in parallel: each thread holds the planning lock for bookkeeping,
+	// particularly onNewSolution(), and releases it in ComputeUnlock scopes, such that planning interleaves
+	std::mutex* mutex = planningMutex();
+	std::mutex own_mutex;
+	auto set_mutex = [this](std::mutex* m) {
+		setPlanningMutex(m);
+		traverseStages(
+		    [m](Stage& stage, unsigned int /*depth*/) {
+			    stage.pimpl()->setPlanningMutex(m);
+			    return true;
+		    },
+		    0, UINT_MAX);
+	};
+	if (!mutex) {  // sequential planning: provide a lock local to this compute() call
+		mutex = &own_mutex;
+		mutex->lock();
+		set_mutex(mutex);
+	}
+
+	std::vector<std::exception_ptr> exceptions(computable.size());
+	std::vector<std::thread> threads;
+	const TaskExecutorPtr executor = TaskExecutor::current();
+	for (size_t i = 1; i < computable.size(); ++i)
+		threads.push_back(executor->spawn([child = computable[i], mutex, &exception = exceptions[i]]() {
+			std::lock_guard<std::mutex> lock(*mutex);
+			try {
+				child->runCompute();
+			} catch (...) {
+				exception = std::current_exception();
+			}
+		}));
+	try {
+		computable[0]->runCompute();
+	} catch (...) {
+		exceptions[0] = std::current_exception();
+	}
+	mutex->unlock();  // allow remaining children to finish
+	for (auto& thread : threads)
+		thread.join();
+	mutex->lock();
+
+	if (mutex == &own_mutex) {
+		set_mutex(nullptr);
+		mutex->unlock();
+	}
+	for (const auto& exception : exceptions)
+		if (exception)
+			std::rethrow_exception(exception);
 }
 
 void Merger::onNewSolution(const SolutionBase& s) {
@@ -1198,42 +1722,152 @@ void MergerPrivate::onNewGeneratorSolution(const SolutionBase& /* s */) {
 void MergerPrivate::mergeAnyCombination(const ChildSolutionMap& all_solutions, const SolutionBase& current,
                                         const planning_scene::PlanningSceneConstPtr& start_scene,
                                         const Spawner& spawner) {
-	std::vector<size_t> indices;  // which solution index was considered last for i-th child?
-	indices.reserve(children().size());
-
-	ChildSolutionList sub_solutions;
-	sub_solutions.reserve(children().size());
-
-	// initialize vector of sub solutions
+	// candidate solutions of all children, sorted by cost
+	// current solution's creator only contributes the current solution, which was added last
+	std::vector<ChildSolutionList> candidates;
+	candidates.reserve(children().size());
+	const SubTrajectory* current_solution = nullptr;
 	for (const auto& pair : all_solutions) {
-		// all children, except current solution's creator, start with zero index
-		indices.push_back(pair.first != current.creator() ? 0 : pair.second.size() - 1);
-		sub_solutions.push_back(pair.second[indices.back()]);
+		if (pair.first == current.creator()) {
+			current_solution = pair.second.back();
+			candidates.push_back({ current_solution });
+			continue;
+		}
+		candidates.push_back(pair.second);
+		std::stable_sort(candidates.back().begin(), candidates.back().end(),
+		                 [](const SubTrajectory* a, const SubTrajectory* b) { return a->cost() < b->cost(); });
 	}
-	while (true) {
-		merge(sub_solutions, start_scene, spawner);
-
-		// compose next combination
-		size_t child = 0;
-		for (auto it = all_solutions.cbegin(), end = all_solutions.cend(); it != end; ++it, ++child) {
-			if (it->first == current.creator())
-				continue;  // skip current solution's child
-			if (++indices[child] >= it->second.size()) {
-				indices[child] = 0;  // start over with zero
-				sub_solutions[child] = it->second[indices[child]];
-				continue;  // and continue with next child
+
+	// best-first enumeration of index tuples in order of increasing total cost:
+	// successors only increment children >= pivot, such that each tuple is reached exactly once
+	struct Combination
+	{
+		double cost;
+		std::vector<size_t> indices;
+		size_t pivot;
+		bool operator<(const Combination& other) const { return cost > other.cost; }
+	};
+	std::priority_queue<Combination> frontier;
+	Combination first{ 0.0, std::vector<size_t>(candidates.size(), 0), 0 };
+	for (const auto& list : candidates)
+		first.cost += list.front()->cost();
+	frontier.push(std::move(first));
+
+	const uint32_t max_combinations = me_->properties().get<uint32_t>("max_combinations");
+	const uint32_t num_threads = std::max(1u, me_->properties().get<uint32_t>("num_threads"));
+	uint32_t attempts = 0;
+	auto exhausted = [&]() { return frontier.empty() || (max_combinations != 0 && attempts >= max_combinations); };
+
+	std::vector<ChildSolutionList> batch;
+	while (!exhausted()) {
+		// collect a batch of the cheapest combinations not known to conflict
+		// the merged group needs to be created in a serial merge first
+		const size_t batch_size = jmg_merged_ ? num_threads : 1;
+		batch.clear();
+		while (batch.size() < batch_size && !exhausted()) {
+			Combination combination = frontier.top();
+			frontier.pop();
+
+			ChildSolutionList sub_solutions(candidates.size());
+			for (size_t child = 0; child != candidates.size(); ++child)
+				sub_solutions[child] = candidates[child][combination.indices[child]];
+			if (!knownConflict(sub_solutions)) {
+				++attempts;
+				batch.push_back(std::move(sub_solutions));
+			}
+
+			for (size_t child = combination.pivot; child != candidates.size(); ++child) {
+				const ChildSolutionList& list = candidates[child];
+				size_t index = combination.indices[child];
+				if (index + 1 >= list.size())
+					continue;
+				Combination next = combination;
+				next.cost += list[index + 1]->cost() - list[index]->cost();
+				next.indices[child] = index + 1;
+				next.pivot = child;
+				frontier.push(std::move(next));
 			}
-			// otherwise, a new solution combination is available
-			sub_solutions[child] = it->second[indices[child]];
-			break;
 		}
-		if (child == children().size())  // all combinations exhausted?
-			break;
+
+		// merge and validate the batch in parallel
+		std::vector<SubTrajectory> results(batch.size());
+		if (batch.size() > 1) {
+			std::vector<std::exception_ptr> exceptions(batch.size());
+			auto work = [this, &batch, &results, &exceptions, &start_scene](size_t i) {
+				try {
+					results[i] = merge(batch[i], start_scene);
+				} catch (...) {
+					exceptions[i] = std::current_exception();
+				}
+			};
+			{
+				Merger::ComputeUnlock unlock(*me());  // allow other stages to compute meanwhile
+				std::vector<std::thread> threads;
+				const TaskExecutorPtr executor = TaskExecutor::current();
+				for (size_t i = 1; i < batch.size(); ++i)
+					threads.push_back(executor->spawn([&work, i]() { work(i); }));
+				work(0);
+				for (auto& thread : threads)
+					thread.join();
+			}
+			for (const auto& exception : exceptions)
+				if (exception)
+					std::rethrow_exception(exception);
+		} else if (!batch.empty())
+			results[0] = merge(batch[0], start_scene);
+
+		// spawn successful merges in cost order first
+		std::vector<size_t> order(batch.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&results](size_t a, size_t b) {
+			return std::make_pair(results[a].isFailure(), results[a].cost()) <
+			       std::make_pair(results[b].isFailure(), results[b].cost());
+		});
+		for (size_t i : order) {
+			const bool failed = results[i].isFailure();
+			spawner(std::move(results[i]));
+			// on failure, learn which pairs with the current solution conflict to skip them in future
+			if (failed && batch[i].size() > 2)
+				for (const SubTrajectory* other : batch[i])
+					if (other != current_solution)
+						conflicting(current_solution, other, start_scene);
+		}
 	}
 }
 
-void MergerPrivate::merge(const ChildSolutionList& sub_solutions,
-                          const planning_scene::PlanningSceneConstPtr& start_scene, const Spawner& spawner) {
+bool MergerPrivate::knownConflict(const ChildSolutionList& sub_solutions) const {
+	for (auto a = sub_solutions.cbegin(), end = sub_solutions.cend(); a != end; ++a)
+		for (auto b = a + 1; b != end; ++b) {
+			auto it = pair_conflicts_.find(std::minmax(*a, *b));
+			if (it != pair_conflicts_.end() && it->second)
+				return true;
+		}
+	return false;
+}
+
+bool MergerPrivate::conflicting(const SubTrajectory* a, const SubTrajectory* b,
+                                const planning_scene::PlanningSceneConstPtr& start_scene) {
+	const std::pair<const SubTrajectory*, const SubTrajectory*> key = std::minmax(a, b);
+	auto it = pair_conflicts_.find(key);
+	if (it != pair_conflicts_.end())
+		return it->second;
+	// the merged group comprises the pair's joints too, but creating a pair-only group would spoil it
+	moveit::core::JointModelGroup* jmg = jmg_merged_.get();
+	if (!jmg)
+		return false;
+
+	bool conflict = true;
+	try {
+		// the path suffices for collision checking
+		auto merged = task_constructor::merge({ a->trajectory(), b->trajectory() }, start_scene->getCurrentState(), jmg);
+		conflict = !start_scene->isPathValid(*merged, "", true);
+	} catch (const std::runtime_error&) {
+	}
+	return pair_conflicts_.emplace(key, conflict).first->second;
+}
+
+SubTrajectory MergerPrivate::merge(const ChildSolutionList& sub_solutions,
+                                   const planning_scene::PlanningSceneConstPtr& start_scene) {
 	// transform vector of SubTrajectories into vector of RobotTrajectories
 	std::vector<robot_trajectory::RobotTrajectoryConstPtr> sub_trajectories;
 	sub_trajectories.reserve(sub_solutions.size());
@@ -1249,8 +1883,7 @@ void MergerPrivate::merge(const ChildSolutionList& sub_solutions,
 		SubTrajectory t;
 		t.markAsFailure();
 		t.setComment(e.what());
-		spawner(std::move(t));
-		return;
+		return t;
 	}
 	if (jmg_merged_.get() != jmg)
 		jmg_merged_.reset(jmg);
@@ -1261,14 +1894,17 @@ void MergerPrivate::merge(const ChildSolutionList& sub_solutions,
 	// check merged trajectory for collisions
 	std::vector<std::size_t> invalid_index;
 	if (!start_scene->isPathValid(*merged, "", true, &invalid_index)) {
-		t.markAsFailure();
-		std::ostringstream oss;
-		oss << "Invalid waypoint(s): ";
-		if (invalid_index.size() == merged->getWayPointCount())
-			oss << "all";
-		else for (size_t i : invalid_index)
-			oss << i << ", ";
-		t.setComment(oss.str());
+		const bool all = invalid_index.size() == merged->getWayPointCount();
+		t.setFailureReason("Invalid waypoint(s)");
+		t.markAsFailure([all, invalid_index = std::move(invalid_index)] {
+			std::ostringstream oss;
+			oss << "Invalid waypoint(s): ";
+			if (all)
+				oss << "all";
+			else for (size_t i : invalid_index)
+				oss << i << ", ";
+			return oss.str();
+		});
 	} else {
 		// accumulate costs and markers
 		double costs = 0.0;
@@ -1278,7 +1914,158 @@ void MergerPrivate::merge(const ChildSolutionList& sub_solutions,
 		}
 		t.setCost(costs);
 	}
-	spawner(std::move(t));
+	return t;
+}
+
+ForEachPrivate::ForEachPrivate(ForEach* me, const std::string& name) : ParallelContainerBasePrivate(me, name) {}
+
+Stage* ForEachPrivate::instantiateNext(bool connect) {
+	const auto& elements = properties_.get<ForEach::Elements>("elements");
+	assert(next_element_ < elements.size());
+	Stage::pointer child = factory_(elements[next_element_], next_element_);
+	if (!child)
+		throw std::runtime_error(name() + ": child factory returned no stage for element " +
+		                         std::to_string(next_element_));
+	++next_element_;
+
+	Stage* stage = child.get();
+	static_cast<ForEach*>(me())->add(std::move(child));
+	if (connect)
+		connectLate(*stage);
+	return stage;
+}
+
+void ForEachPrivate::connectLate(Stage& child) {
+	StagePrivate* impl = child.pimpl();
+	child.init(robot_model_);
+	impl->markInitialized(robot_model_);
+	markInitialized(robot_model_);  // adding the child marked us dirty
+
+	impl->resolveInterface(required_interface_);
+	InterfaceFlags expected = required_interface_;
+	validateInterfaces(*impl, expected);
+	setChildsPushBackwardInterface(impl);
+	setChildsPushForwardInterface(impl);
+
+	// settings distributed by the task to all stages of its (earlier compiled) stage tree
+	auto inherit = [this](Stage& stage, unsigned int /*depth*/) {
+		StagePrivate* s = stage.pimpl();
+		s->setIntrospection(introspection());
+		s->setPlanningMutex(planningMutex());
+		s->setPreemptionToken(s->parent()->pimpl()->childPreemptionToken(s));
+		s->setMaxSceneDepth(maxSceneDepth());
+		s->setStateDeduplication(stateDeduplication());
+		s->inheritTimeoutPolicy(timeout_policy_);
+		s->setCostBound(costBound());
+		return true;
+	};
+	inherit(child, 0);
+	if (auto* container = dynamic_cast<ContainerBase*>(&child))
+		container->pimpl()->traverseStages(inherit, 1, UINT_MAX);
+
+	// finally, hand over all states received so far
+	if (required_interface_ & READS_START)
+		for (auto it = starts()->begin(), end = starts()->end(); it != end; ++it)
+			copyState<Interface::FORWARD>(it, impl->starts(), Interface::UpdateFlags());
+	if (required_interface_ & READS_END)
+		for (auto it = ends()->begin(), end = ends()->end(); it != end; ++it)
+			copyState<Interface::BACKWARD>(it, impl->ends(), Interface::UpdateFlags());
+
+	// let the task compile the new stages into its stage tree, e.g. to watch them or resume their continuations
+	onStageTreeChanged();
+}
+
+bool ForEachPrivate::canInstantiate() const {
+	if (next_element_ >= properties_.get<ForEach::Elements>("elements").size())
+		return false;
+	if (!(required_interface_ & (READS_START | READS_END)))
+		return true;  // generator-like children don't need input
+	return (starts() && !starts()->empty()) || (ends() && !ends()->empty());
+}
+
+bool ForEachPrivate::enoughSolutions() const {
+	const size_t max = properties_.get<size_t>("max_solutions");
+	return max > 0 && solutions_.size() >= max;
+}
+
+uint32_t ForEachPrivate::maxConcurrency() const {
+	const uint32_t max = properties_.get<uint32_t>("max_concurrency");
+	return max > 0 ? max : std::max(1u, std::thread::hardware_concurrency());
+}
+
+ForEach::ForEach(const std::string& name, const ChildFactory& factory) : ForEach(new ForEachPrivate(this, name)) {
+	setChildFactory(factory);
+}
+
+ForEach::ForEach(ForEachPrivate* impl) : ParallelContainerBase(impl) {
+	properties().declare<Elements>("elements", Elements(), "elements to create a child for");
+	properties().declare<uint32_t>("max_concurrency", 0, "max children computed in parallel (0 = one per core)");
+	properties().declare<size_t>("max_solutions", 0, "stop after this many solutions (0 = unlimited)");
+}
+
+void ForEach::setChildFactory(const ChildFactory& factory) {
+	pimpl()->factory_ = factory;
+}
+
+size_t ForEach::numInstantiated() const {
+	return pimpl()->next_element_;
+}
+
+void ForEach::reset() {
+	ParallelContainerBase::reset();
+	// drop all children, the next init() starts over with the first wave
+	clear();
+	pimpl()->next_element_ = 0;
+}
+
+void ForEach::init(const moveit::core::RobotModelConstPtr& robot_model) {
+	auto impl = pimpl();
+	if (!impl->factory_)
+		throw InitStageException(*this, "no child factory");
+	const size_t num_elements = properties().get<Elements>("elements").size();
+	if (num_elements == 0)
+		throw InitStageException(*this, "no elements");
+
+	// start with the first wave of children only, further ones are created on demand
+	impl->robot_model_ = robot_model;
+	const size_t initial = std::min<size_t>(num_elements, impl->maxConcurrency());
+	while (impl->next_element_ < initial)
+		impl->instantiateNext(false);
+
+	ParallelContainerBase::init(robot_model);
+}
+
+bool ForEach::canCompute() const {
+	auto impl = pimpl();
+	if (impl->enoughSolutions())
+		return false;
+	for (const auto& stage : impl->children())
+		if (stage->pimpl()->canCompute())
+			return true;
+	return impl->canInstantiate();
+}
+
+void ForEach::compute() {
+	auto impl = pimpl();
+	if (impl->enoughSolutions())
+		return;
+
+	const uint32_t limit = impl->maxConcurrency();
+	std::vector<StagePrivate*> computable;
+	for (const auto& stage : impl->children())
+		if (computable.size() < limit && stage->pimpl()->canCompute())
+			computable.push_back(stage->pimpl());
+	// fill free slots with children of further elements
+	while (computable.size() < limit && impl->canInstantiate()) {
+		StagePrivate* child = impl->instantiateNext(true)->pimpl();
+		if (child->canCompute())
+			computable.push_back(child);
+	}
+	impl->computeConcurrently(computable);
+}
+
+void ForEach::onNewSolution(const SolutionBase& s) {
+	liftSolution(s);
 }
 }  // namespace task_constructor
 }  // namespace moveit
@@ -35,17 +35,23 @@
 /* Authors: Michael Goerner */
 
 #include <moveit/task_constructor/cost_terms.h>
+#include <moveit/task_constructor/collision_backend.h>
+#include <moveit/task_constructor/collision_cache.h>
 #include <moveit/task_constructor/stage.h>
 #include <moveit/task_constructor/moveit_compat.h>
 
 #include <moveit/collision_detection/collision_common.h>
+#include <moveit/robot_model/revolute_joint_model.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/planning_scene/planning_scene.h>
 
 #include <Eigen/Geometry>
 
 #include <boost/format.hpp>
+#include <algorithm>
+#include <cmath>
 #include <utility>
+#include <vector>
 
 namespace moveit {
 namespace task_constructor {
@@ -62,11 +68,16 @@ double CostTerm::operator()(const WrappedSolution& s, std::string& /*comment*/)
 	return s.cost();
 }
 
+double CostTerm::lowerBound(const InterfaceState& /*from*/, const InterfaceState& /*to*/) const {
+	return 0.0;
+}
+
 double TrajectoryCostTerm::operator()(const SolutionSequence& s, std::string& comment) const {
 	double cost{ 0.0 };
 	std::string subcomment;
-	for (auto& solution : s.solutions()) {
-		cost += solution->computeCost((*this), subcomment);
+	// wrapped solutions forward to their wrapped solution, thus summing over all leaves is equivalent
+	for (const SolutionSequence::Leaf& leaf : s.flattened().leaves) {
+		cost += leaf.trajectory->memoizedCost(*this, subcomment);
 		if (!subcomment.empty()) {
 			if (!comment.empty())
 				comment.append(", ");
@@ -79,7 +90,7 @@ double TrajectoryCostTerm::operator()(const SolutionSequence& s, std::string& co
 }
 
 double TrajectoryCostTerm::operator()(const WrappedSolution& s, std::string& comment) const {
-	return s.wrapped()->computeCost(*this, comment);
+	return s.wrapped()->memoizedCost(*this, comment);
 }
 
 LambdaCostTerm::LambdaCostTerm(const SubTrajectorySignature& term)
@@ -95,6 +106,33 @@ double LambdaCostTerm::operator()(const SubTrajectory& s, std::string& comment)
 
 namespace cost {
 
+namespace {
+using WeightedJoints = std::vector<std::pair<const moveit::core::JointModel*, double>>;
+
+// joints contributing to PathLength with their weights
+WeightedJoints weightedJoints(const moveit::core::RobotModel& model, const std::vector<std::string>& joints,
+                              const std::map<std::string, double>& weights) {
+	WeightedJoints result;
+	if (joints.empty() && weights.empty()) {
+		for (const moveit::core::JointModel* jm : model.getActiveJointModels())
+			result.emplace_back(jm, jm->getDistanceFactor());
+		return result;
+	}
+	auto add = [&](const std::string& name, double weight) {
+		if (const moveit::core::JointModel* jm = model.getJointModel(name))
+			result.emplace_back(jm, weight);
+	};
+	for (const auto& joint : joints) {
+		auto it = weights.find(joint);
+		add(joint, it == weights.end() ? 1.0 : it->second);
+	}
+	for (const auto& weight : weights)
+		if (std::find(joints.begin(), joints.end(), weight.first) == joints.end())
+			add(weight.first, weight.second);
+	return result;
+}
+}  // namespace
+
 double Constant::operator()(const SubTrajectory& /*s*/, std::string& /*comment*/) const {
 	return cost;
 }
@@ -107,34 +145,71 @@ double Constant::operator()(const WrappedSolution& /*s*/, std::string& /*comment
 	return cost;
 }
 
+double Constant::lowerBound(const InterfaceState& /*from*/, const InterfaceState& /*to*/) const {
+	return cost;
+}
+
 double PathLength::operator()(const SubTrajectory& s, std::string& /*comment*/) const {
 	const auto& traj = s.trajectory();
 
 	if (traj == nullptr || traj->getWayPointCount() == 0)
 		return 0.0;
 
-	std::vector<const robot_model::JointModel*> joint_models;
-	joint_models.reserve(joints.size());
-	const auto& first_waypoint = traj->getWayPoint(0);
-	for (auto& joint : joints) {
-		joint_models.push_back(first_waypoint.getJointModel(joint));
+	// revolute and prismatic joints are evaluated at once on a (variables x waypoints) matrix,
+	// all others (e.g. planar or floating joints) by their specific distance metric
+	std::vector<int> indices;
+	std::vector<double> factors;
+	std::vector<size_t> continuous;  // rows requiring angle wrapping
+	WeightedJoints others;
+	for (const auto& joint : weightedJoints(*traj->getRobotModel(), joints, weights)) {
+		const moveit::core::JointModel* jm = joint.first;
+		if (jm->getType() == moveit::core::JointModel::REVOLUTE) {
+			if (static_cast<const moveit::core::RevoluteJointModel*>(jm)->isContinuous())
+				continuous.push_back(indices.size());
+		} else if (jm->getType() != moveit::core::JointModel::PRISMATIC) {
+			others.push_back(joint);
+			continue;
+		}
+		indices.push_back(jm->getFirstVariableIndex());
+		factors.push_back(joint.second);
 	}
 
-	double path_length{ 0.0 };
-	for (size_t i = 1; i < traj->getWayPointCount(); ++i) {
-		auto& last = traj->getWayPoint(i - 1);
-		auto& curr = traj->getWayPoint(i);
-		if (joints.empty()) {
-			path_length += last.distance(curr);
-		} else {
-			for (const auto& model : joint_models) {
-				path_length += last.distance(curr, model);
-			}
-		}
+	const size_t count = traj->getWayPointCount();
+	const auto variables = s.variablePositions();
+	Eigen::MatrixXd positions(indices.size(), count);
+	for (size_t row = 0; row < indices.size(); ++row)
+		positions.row(row) = variables->row(indices[row]);
+	Eigen::ArrayXXd steps = (positions.rightCols(count - 1) - positions.leftCols(count - 1)).array().abs();
+	for (size_t row : continuous)
+		steps.row(row) = steps.row(row).unaryExpr([](double d) {
+			d = std::fmod(d, 2.0 * M_PI);
+			return d > M_PI ? 2.0 * M_PI - d : d;
+		});
+	double path_length = Eigen::Map<const Eigen::VectorXd>(factors.data(), factors.size())
+	                         .dot(steps.rowwise().sum().matrix());
+
+	for (size_t i = 1; i < count; ++i) {
+		const auto& last = traj->getWayPoint(i - 1);
+		const auto& curr = traj->getWayPoint(i);
+		for (const auto& joint : others)
+			path_length += joint.second * last.distance(curr, joint.first);
 	}
 	return path_length;
 }
 
+double PathLength::lowerBound(const InterfaceState& from, const InterfaceState& to) const {
+	// any path is at least as long as the straight line
+	const auto& start = from.scene()->getCurrentState();
+	const auto& end = to.scene()->getCurrentState();
+	if (joints.empty() && weights.empty())
+		return start.distance(end);
+
+	double distance{ 0.0 };
+	for (const auto& joint : weightedJoints(*start.getRobotModel(), joints, weights))
+		distance += joint.second * start.distance(end, joint.first);
+	return distance;
+}
+
 double TrajectoryDuration::operator()(const SubTrajectory& s, std::string& /*comment*/) const {
 	return s.trajectory() ? s.trajectory()->getDuration() : 0.0;
 }
@@ -147,21 +222,16 @@ double LinkMotion::operator()(const SubTrajectory& s, std::string& comment) cons
 	if (traj == nullptr || traj->getWayPointCount() == 0)
 		return 0.0;
 
-	if (!traj->getWayPoint(0).knowsFrameTransform(link_name)) {
+	const auto positions{ s.framePositions(link_name) };
+	if (!positions) {
 		boost::format desc("LinkMotionCost: frame '%1%' unknown in trajectory");
 		desc % link_name;
 		comment = desc.str();
 		return std::numeric_limits<double>::infinity();
 	}
 
-	double distance{ 0.0 };
-	Eigen::Vector3d position{ traj->getWayPoint(0).getFrameTransform(link_name).translation() };
-	for (size_t i{ 1 }; i < traj->getWayPointCount(); ++i) {
-		const auto& new_position{ traj->getWayPoint(i).getFrameTransform(link_name).translation() };
-		distance += (new_position - position).norm();
-		position = new_position;
-	}
-	return distance;
+	const Eigen::Index steps{ positions->cols() - 1 };
+	return (positions->rightCols(steps) - positions->leftCols(steps)).colwise().norm().sum();
 }
 
 Clearance::Clearance(bool with_world, bool cumulative, std::string group_property, Mode mode)
@@ -192,37 +262,36 @@ double Clearance::operator()(const SubTrajectory& s, std::string& comment) const
 	request.enableGroup(state->scene()->getRobotModel());
 	request.acm = &state->scene()->getAllowedCollisionMatrix();
 
-	// compute relevant distance data for state & robot
-	auto check_distance{ [=](const InterfaceState* state, const moveit::core::RobotState& robot) {
-		collision_detection::DistanceResult result;
-		if (with_world)
-#if MOVEIT_HAS_COLLISION_ENV
-			state->scene()->getCollisionEnv()->distanceRobot(request, result, robot);
-#else
-			state->scene()->getCollisionWorld()->distanceRobot(request, result, *state->scene()->getCollisionRobot(),
-			                                                   robot);
-#endif
-		else
-#if MOVEIT_HAS_COLLISION_ENV
-			state->scene()->getCollisionEnv()->distanceSelf(request, result, robot);
-#else
-			state->scene()->getCollisionRobot()->distanceSelf(request, result, robot);
-#endif
-
-		if (result.minimum_distance.distance <= 0) {
-			return result.minimum_distance;
-		}
+	// reduce distance data of a robot state to its relevant (minimum or cumulative) distance
+	auto summarize{ [this](const collision_detection::DistanceResult& result) {
+		collision_detection::DistanceResultsData data{ result.minimum_distance };
+		if (data.distance <= 0 || !cumulative)
+			return data;
 
-		if (cumulative) {
-			double distance{ 0.0 };
-			for (const auto& distance_of_pair : result.distances) {
-				assert(distance_of_pair.second.size() == 1);
-				distance += distance_of_pair.second[0].distance;
-			}
-			result.minimum_distance.distance = distance;
+		double distance{ 0.0 };
+		for (const auto& distance_of_pair : result.distances) {
+			assert(distance_of_pair.second.size() == 1);
+			distance += distance_of_pair.second[0].distance;
 		}
+		data.distance = distance;
+		return data;
+	} };
 
-		return result.minimum_distance;
+	// distance queries are batched by the process-wide collision backend
+	const CollisionBackendPtr backend{ CollisionBackend::instance() };
+	// distances of interface states are shared with other stages and cost terms evaluating the same state
+	const CollisionCachePtr collision_cache{ CollisionCache::instance() };
+	auto check_distance{ [&](const InterfaceState* state, const moveit::core::RobotState& robot) {
+		auto compute{ [&]() {
+			CollisionBackend::Distances results;
+			backend->distances(*state->scene(), request, with_world, { &robot }, results);
+			return results.front();
+		} };
+		if (!collision_cache)
+			return summarize(compute());
+		boost::format key("clearance/%1%/%2%/%3%");
+		key % request.group_name % with_world % cumulative;
+		return summarize(collision_cache->distance(state->scene(), robot, key.str(), compute));
 	} };
 
 	auto collision_comment{ [=](const auto& distance) {
@@ -249,15 +318,64 @@ double Clearance::operator()(const SubTrajectory& s, std::string& comment) const
 			comment = PREFIX + "cumulative distance " + std::to_string(distance);
 		}
 	} else {  // check trajectory
-		for (size_t i = 0; i < s.trajectory()->getWayPointCount(); ++i) {
-			auto distance_data = check_distance(state, s.trajectory()->getWayPoint(i));
-			if (distance_data.distance < 0) {
-				comment = collision_comment(distance_data);
+		const auto traj = s.trajectory();  // keep a rebuilt trajectory alive
+		const robot_trajectory::RobotTrajectory& trajectory = *traj;
+		const size_t count = trajectory.getWayPointCount();
+		std::vector<size_t> waypoints;
+		for (size_t i = 0; i < count; i += std::max<size_t>(1, stride))
+			waypoints.push_back(i);
+		if (count > 0 && waypoints.back() != count - 1)
+			waypoints.push_back(count - 1);
+
+		auto terminates = [this](const collision_detection::DistanceResultsData& d) {
+			return d.distance < 0 || d.distance < stop_distance;
+		};
+
+		// samples beyond the first terminating one (collision or below stop_distance) are skipped
+		using Distances = std::vector<collision_detection::DistanceResultsData>;
+		Distances partial;  // results of an early terminated evaluation, which are not shared
+		auto compute = [&]() -> std::shared_ptr<const Distances> {
+			CollisionBackend::States states;
+			states.reserve(waypoints.size());
+			for (size_t i : waypoints)
+				states.push_back(&trajectory.getWayPoint(i));
+			CollisionBackend::Distances results;
+			const size_t stop_at =
+			    backend->distances(*state->scene(), request, with_world, states, results, num_threads,
+			                       [&](const collision_detection::DistanceResult& r) { return terminates(summarize(r)); });
+
+			Distances distances;
+			distances.reserve(results.size());
+			for (const auto& result : results)
+				distances.push_back(summarize(result));
+			if (stop_at == waypoints.size())
+				return std::make_shared<Distances>(std::move(distances));
+			partial = std::move(distances);
+			return nullptr;
+		};
+		// complete evaluations are shared with other Clearance terms using the same distance queries
+		boost::format key("clearance/%1%/%2%/%3%/%4%");
+		key % request.group_name % with_world % cumulative % std::max<size_t>(1, stride);
+		const auto shared = s.sharedData<Distances>(key.str(), compute);
+		const Distances& distances = shared ? *shared : partial;
+
+		auto stop = std::find_if(distances.begin(), distances.end(), terminates);
+		if (stop != distances.end()) {
+			if (stop->distance < 0) {
+				comment = collision_comment(*stop);
 				return std::numeric_limits<double>::infinity();
 			}
-			distance += distance_data.distance;
+			distance = stop->distance;
+			boost::format desc(PREFIX + "%1% distance %2% below %3% at waypoint %4%");
+			desc % (cumulative ? "cumulative" : "minimum") % distance % stop_distance;
+			desc % waypoints[stop - distances.begin()];
+			comment = desc.str();
+			return distance_to_cost(distance);
 		}
-		distance /= s.trajectory()->getWayPointCount();
+
+		for (const auto& distance_data : distances)
+			distance += distance_data.distance;
+		distance /= std::max<size_t>(1, distances.size());
 
 		boost::format desc(PREFIX + "average%1% distance: %2%");
 		desc % (cumulative ? " cumulative" : "") % distance;
@@ -266,6 +384,42 @@ double Clearance::operator()(const SubTrajectory& s, std::string& comment) const
 
 	return distance_to_cost(distance);
 }
+
+double Composite::sum(const SolutionBase& s, std::string& comment) const {
+	double cost{ 0.0 };
+	for (const auto& term : terms) {
+		std::string subcomment;
+		const double value{ s.memoizedCost(*term.first, subcomment) };
+		if (!subcomment.empty()) {
+			if (!comment.empty())
+				comment.append(", ");
+			comment.append(subcomment);
+		}
+		if (!std::isfinite(value))
+			return value;  // failure, regardless of its weight
+		cost += term.second * value;
+	}
+	return cost;
+}
+
+double Composite::operator()(const SubTrajectory& s, std::string& comment) const {
+	return sum(s, comment);
+}
+
+double Composite::operator()(const SolutionSequence& s, std::string& comment) const {
+	return sum(s, comment);
+}
+
+double Composite::operator()(const WrappedSolution& s, std::string& comment) const {
+	return sum(s, comment);
+}
+
+double Composite::lowerBound(const InterfaceState& from, const InterfaceState& to) const {
+	double bound{ 0.0 };
+	for (const auto& term : terms)
+		bound += term.second * term.first->lowerBound(from, to);
+	return bound;
+}
 }  // namespace cost
 }  // namespace task_constructor
 }  // namespace moveit
@@ -0,0 +1,162 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Lock-free ring buffer of binary events from hot paths, formatted as text on demand only
+*/
+
+#include <moveit/task_constructor/event_log.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace moveit {
+namespace task_constructor {
+
+std::atomic<bool> EventLog::enabled_{ false };
+std::atomic<EventLog::Source> EventLog::next_source_{ 1 };
+constexpr std::size_t EventLog::CAPACITY;
+
+EventLog::EventLog() : origin_(std::chrono::steady_clock::now()), slots_(new Slot[CAPACITY]) {}
+
+EventLog& EventLog::instance() {
+	static EventLog log;
+	return log;
+}
+
+EventLog::Source EventLog::newSource() {
+	return next_source_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EventLog::clear() {
+	cleared_.store(head_.load());
+}
+
+void EventLog::record(Source source, Code code, double value, uint64_t arg) {
+	const int64_t time =
+	    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin_).count();
+	const uint64_t sequence = head_.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = slots_[sequence % CAPACITY];
+	slot.version.store(2 * sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.time.store(time, std::memory_order_relaxed);
+	slot.source.store(source, std::memory_order_relaxed);
+	slot.code.store(code, std::memory_order_relaxed);
+	slot.value.store(value, std::memory_order_relaxed);
+	slot.arg.store(arg, std::memory_order_relaxed);
+	slot.version.store(2 * (sequence + 1), std::memory_order_release);
+}
+
+std::vector<EventLog::Event> EventLog::events(std::size_t max) const {
+	const uint64_t head = head_.load();
+	uint64_t first = std::max(cleared_.load(), head > CAPACITY ? head - CAPACITY : 0);
+	if (max > 0 && head - first > max)
+		first = head - max;
+
+	std::vector<Event> result;
+	result.reserve(head - first);
+	for (uint64_t sequence = first; sequence != head; ++sequence) {
+		const Slot& slot = slots_[sequence % CAPACITY];
+		const uint64_t version = slot.version.load(std::memory_order_acquire);
+		Event event;
+		event.sequence = sequence;
+		event.time = slot.time.load(std::memory_order_relaxed);
+		event.source = slot.source.load(std::memory_order_relaxed);
+		event.code = static_cast<Code>(slot.code.load(std::memory_order_relaxed));
+		event.value = slot.value.load(std::memory_order_relaxed);
+		event.arg = slot.arg.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		// skip events still being written or already overwritten
+		if (version == 2 * (sequence + 1) && slot.version.load(std::memory_order_relaxed) == version)
+			result.push_back(event);
+	}
+	return result;
+}
+
+const char* EventLog::name(Code code) {
+	switch (code) {
+		case COMPUTE:
+			return "compute";
+		case CHILD_SOLUTION:
+			return "child solution";
+		case CHILD_FAILURE:
+			return "child failure";
+		case CHILD_INVALIDATED:
+			return "child invalidated solution";
+		case CHILD_DROPPED:
+			return "child dropped solution";
+		case FALLBACK:
+			return "fallback";
+		case JOINT_DEVIATION:
+			return "joint deviation";
+		case STALL:
+			return "stall";
+	}
+	return "unknown";
+}
+
+void EventLog::dump(std::ostream& os, const NameLookup& names, std::size_t max) const {
+	auto stage_name = [&names](Source source) {
+		std::string name = names ? names(source) : std::string();
+		return name.empty() ? "#" + std::to_string(source) : "'" + name + "'";
+	};
+	for (const Event& event : events(max)) {
+		os << std::setw(12) << event.time << "us " << stage_name(event.source) << ": " << name(event.code);
+		switch (event.code) {
+			case COMPUTE:
+				os << " took " << event.value << "s" << (event.arg ? ", succeeded" : "");
+				break;
+			case CHILD_SOLUTION:
+				os << " from " << stage_name(event.arg) << ", cost " << event.value;
+				break;
+			case CHILD_FAILURE:
+			case CHILD_INVALIDATED:
+			case CHILD_DROPPED:
+			case FALLBACK:
+				os << " of " << stage_name(event.arg);
+				break;
+			case JOINT_DEVIATION:
+				os << " of joint " << event.arg << " by " << event.value;
+				break;
+			case STALL:
+				os << " running for " << event.value << "s";
+				if (event.arg)
+					os << " on state #" << event.arg;
+				break;
+		}
+		os << '\n';
+	}
+}
+}  // namespace task_constructor
+}  // namespace moveit
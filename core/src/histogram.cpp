@@ -0,0 +1,134 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Fixed-size streaming histogram of durations
+*/
+
+#include <moveit/task_constructor/histogram.h>
+#include <algorithm>
+#include <cmath>
+
+namespace moveit {
+namespace task_constructor {
+
+constexpr double LatencyHistogram::MIN_VALUE;
+constexpr unsigned int LatencyHistogram::BUCKETS_PER_OCTAVE;
+constexpr unsigned int LatencyHistogram::NUM_BUCKETS;
+
+void LatencyHistogram::reset() {
+	buckets_.fill(0);
+	count_ = 0;
+	sum_ = 0.0;
+	min_ = std::numeric_limits<double>::infinity();
+	max_ = 0.0;
+}
+
+unsigned int LatencyHistogram::bucketIndex(double value) {
+	if (!(value >= MIN_VALUE))  // also catches NaN
+		return 0;
+	double index = 1.0 + std::floor(std::log2(value / MIN_VALUE) * BUCKETS_PER_OCTAVE);
+	return static_cast<unsigned int>(std::min<double>(index, NUM_BUCKETS - 1));
+}
+
+double LatencyHistogram::bucketLowerBound(unsigned int bucket) {
+	if (bucket == 0)
+		return 0.0;
+	return MIN_VALUE * std::exp2(static_cast<double>(bucket - 1) / BUCKETS_PER_OCTAVE);
+}
+
+void LatencyHistogram::record(double value) {
+	++buckets_[bucketIndex(value)];
+	++count_;
+	sum_ += value;
+	min_ = std::min(min_, value);
+	max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+	for (unsigned int i = 0; i != NUM_BUCKETS; ++i)
+		buckets_[i] += other.buckets_[i];
+	count_ += other.count_;
+	sum_ += other.sum_;
+	min_ = std::min(min_, other.min_);
+	max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::decay(std::size_t max_count) {
+	if (count_ <= max_count)
+		return;
+	const double factor = static_cast<double>(max_count) / count_;
+	// round cumulative counts, such that sparse buckets don't vanish all together
+	double cumulative = 0.0;
+	std::size_t count = 0;
+	for (uint32_t& bucket : buckets_) {
+		cumulative += bucket * factor;
+		const std::size_t rounded = static_cast<std::size_t>(std::llround(cumulative));
+		bucket = static_cast<uint32_t>(rounded - count);
+		count = rounded;
+	}
+	sum_ *= static_cast<double>(count) / count_;
+	count_ = count;
+}
+
+void LatencyHistogram::assign(const std::array<uint32_t, NUM_BUCKETS>& buckets, double sum, double min,
+                              double max) {
+	buckets_ = buckets;
+	count_ = 0;
+	for (uint32_t count : buckets_)
+		count_ += count;
+	sum_ = sum;
+	min_ = count_ ? min : std::numeric_limits<double>::infinity();
+	max_ = count_ ? max : 0.0;
+}
+
+double LatencyHistogram::quantile(double q) const {
+	if (count_ == 0)
+		return 0.0;
+	const double rank = std::max(0.0, std::min(1.0, q)) * count_;
+	double seen = 0.0;
+	for (unsigned int i = 0; i != NUM_BUCKETS; ++i) {
+		if (buckets_[i] == 0 || seen + buckets_[i] < rank) {
+			seen += buckets_[i];
+			continue;
+		}
+		// interpolate within bucket, clamped by the exact extrema
+		const double lower = std::max(min_, bucketLowerBound(i));
+		const double upper = i + 1 < NUM_BUCKETS ? std::min(max_, bucketLowerBound(i + 1)) : max_;
+		return lower + (upper - lower) * (rank - seen) / buckets_[i];
+	}
+	return max_;
+}
+
+}  // namespace task_constructor
+}  // namespace moveit
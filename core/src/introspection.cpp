@@ -37,22 +37,44 @@
 #include <moveit/task_constructor/stage_p.h>
 #include <moveit/task_constructor/task_p.h>
 #include <moveit/task_constructor/introspection.h>
+#include <moveit/task_constructor/statistics_record.h>
 #include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/task_executor.h>
 #include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/solvers/planner_interface.h>
 #include <moveit_task_constructor_msgs/Property.h>
 
 #include <ros/node_handle.h>
 #include <ros/publisher.h>
+#include <ros/serialization.h>
 #include <ros/service.h>
+#include <ros/single_subscriber_publisher.h>
 #include <moveit/planning_scene/planning_scene.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <set>
 #include <sstream>
-#include <boost/bimap.hpp>
+#include <thread>
+#include <unordered_map>
+#include <boost/functional/hash.hpp>
+#include <boost/make_shared.hpp>
 
 namespace moveit {
 namespace task_constructor {
 
 namespace {
+// queue size of description publishers, bounding the number of messages describing the task at once
+constexpr uint32_t DESCRIPTION_QUEUE_SIZE = 100;
+// keyframe interval of remote statistics, if delta encoding is disabled for the statistics topic
+constexpr unsigned int REMOTE_KEYFRAME_INTERVAL = 100;
+
 std::string getTaskId(const TaskPrivate* task) {
 	std::ostringstream oss;
 	char our_hostname[256] = { 0 };
@@ -62,6 +84,16 @@ std::string getTaskId(const TaskPrivate* task) {
 	oss << our_hostname << "_" << getpid() << "_" << reinterpret_cast<std::size_t>(task);
 	return oss.str();
 }
+
+// content hash of a scene msg, computed from its serialization
+std::string sceneId(const moveit_msgs::PlanningScene& msg) {
+	std::string buffer(ros::serialization::serializationLength(msg), '\0');
+	ros::serialization::OStream stream(reinterpret_cast<uint8_t*>(&buffer[0]), buffer.size());
+	ros::serialization::serialize(stream, msg);
+	std::ostringstream oss;
+	oss << std::hex << std::hash<std::string>()(buffer);
+	return oss.str();
+}
 }  // namespace
 
 class IntrospectionPrivate
@@ -71,8 +103,11 @@ public:
 	  : nh_(std::string("~/") + task->ns())  // topics + services are advertised in private namespace
 	  , task_(task)
 	  , task_id_(getTaskId(task)) {
-		task_description_publisher_ =
-		    nh_.advertise<moveit_task_constructor_msgs::TaskDescription>(DESCRIPTION_TOPIC, 2, true);
+		// the queue allows to stream incremental descriptions, new subscribers need to receive them in full
+		task_description_publisher_ = nh_.advertise<moveit_task_constructor_msgs::TaskDescription>(
+		    DESCRIPTION_TOPIC, DESCRIPTION_QUEUE_SIZE,
+		    [this](const ros::SingleSubscriberPublisher& pub) { describeTo(pub); },
+		    ros::SubscriberStatusCallback(), ros::VoidConstPtr(), true);
 		// send reset message as early as possible to give subscribers time to see it
 		indicateReset();
 
@@ -82,24 +117,347 @@ public:
 
 		get_solution_service_ =
 		    nh_.advertiseService(std::string(GET_SOLUTION_SERVICE "_") + task_id_, &Introspection::getSolution, self);
+		get_solutions_service_ =
+		    nh_.advertiseService(std::string(GET_SOLUTIONS_SERVICE "_") + task_id_, &Introspection::getSolutions, self);
+		get_event_log_service_ =
+		    nh_.advertiseService(std::string(GET_EVENT_LOG_SERVICE "_") + task_id_, &Introspection::getEventLog, self);
 
 		resetMaps();
+		executor_ = task->taskExecutor();
+		publisher_thread_ = std::thread(&IntrospectionPrivate::publishLoop, this);
+	}
+	~IntrospectionPrivate() {
+		{
+			std::lock_guard<std::mutex> lock(publish_mutex_);
+			stop_publishing_ = true;
+		}
+		publish_cv_.notify_one();
+		publisher_thread_.join();  // publishes all pending messages
+		indicateReset();
 	}
-	~IntrospectionPrivate() { indicateReset(); }
 
 	void indicateReset() {
 		// send empty task description message to indicate reset
 		::moveit_task_constructor_msgs::TaskDescription msg;
 		msg.task_id = task_id_;
-		task_description_publisher_.publish(msg);
+		publishDescription(std::move(msg));
+	}
+
+	/** publish msg from the publisher thread (if running), preserving the order of messages
+	 *
+	 * Messages are passed as shared pointers, which allows ROS to hand them to subscribers
+	 * in the same process (e.g. nodelets) without serialization.
+	 * If a (valid) mirror is given, the message is published there as well.
+	 */
+	template <typename Msg>
+	void publish(ros::Publisher& publisher, Msg&& msg, const ros::Publisher* mirror = nullptr) {
+		auto shared = boost::make_shared<typename std::decay<Msg>::type>(std::forward<Msg>(msg));
+		ros::Publisher mirrored = mirror ? *mirror : ros::Publisher();
+		schedule([&publisher, mirrored, shared]() {
+			publisher.publish(shared);
+			if (mirrored)
+				mirrored.publish(shared);
+		});
+	}
+
+	/// run job in the publisher thread (if running, otherwise immediately), preserving the order of jobs
+	void schedule(std::function<void()>&& job) {
+		if (!publisher_thread_.joinable()) {
+			job();
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(publish_mutex_);
+			publish_jobs_.emplace_back(std::move(job));
+		}
+		publish_cv_.notify_one();
+	}
+
+	/// publish description msg, mirrored to the remote profile
+	void publishDescription(moveit_task_constructor_msgs::TaskDescription&& msg) {
+		publish(task_description_publisher_, std::move(msg), &remote_description_publisher_);
+	}
+
+	uint32_t numStatisticsSubscribers() const {
+		return task_statistics_publisher_.getNumSubscribers() +
+		       (remote_statistics_publisher_ ? remote_statistics_publisher_.getNumSubscribers() : 0);
+	}
+
+	/// keyframe interval of delta-encoded statistics (local or remote ones), 0 if delta encoding is disabled
+	unsigned int deltaInterval() const {
+		return keyframe_interval_ ? keyframe_interval_ : (remote_statistics_publisher_ ? REMOTE_KEYFRAME_INTERVAL : 0);
+	}
+
+	/** publish statistics msg with latency histograms and planner statistics stripped (if remote profile is enabled)
+	 *
+	 * The last keyframe and all later deltas are kept to replay them to new subscribers.
+	 * Keeping and publishing a message is atomic w.r.t. replaying, such that new subscribers
+	 * only receive messages missing from the replay after it.
+	 */
+	void publishRemoteStatistics(const moveit_task_constructor_msgs::TaskStatistics& msg) {
+		if (!remote_statistics_publisher_)
+			return;
+		auto remote = boost::make_shared<moveit_task_constructor_msgs::TaskStatistics>();
+		remote->task_id = msg.task_id;
+		remote->seq = msg.seq;
+		remote->delta = msg.delta;
+		remote->stages.reserve(msg.stages.size());
+		for (const auto& stage : msg.stages) {
+			remote->stages.emplace_back(stage);
+			remote->stages.back().compute_latency = moveit_task_constructor_msgs::LatencyHistogram();
+			remote->stages.back().solution_latency = moveit_task_constructor_msgs::LatencyHistogram();
+		}
+		ros::Publisher publisher = remote_statistics_publisher_;
+		schedule([this, publisher, remote]() {
+			std::lock_guard<std::mutex> lock(remote_statistics_mutex_);
+			if (!remote->delta)
+				remote_statistics_.clear();
+			remote_statistics_.push_back(remote);
+			publisher.publish(remote);
+		});
+	}
+
+	/// replay the last remote keyframe and all later deltas to a new subscriber
+	void replayRemoteStatistics(const ros::SingleSubscriberPublisher& pub) {
+		std::lock_guard<std::mutex> lock(remote_statistics_mutex_);
+		for (const auto& msg : remote_statistics_)
+			pub.publish(*msg);
+	}
+
+	/// publish summary of solution msg: ids, costs, comments, and stage ids only (if remote profile is enabled)
+	void publishSummary(const moveit_task_constructor_msgs::Solution& msg) {
+		if (!remote_solution_publisher_)
+			return;
+		auto copy_info = [](const moveit_task_constructor_msgs::SolutionInfo& from,
+		                    moveit_task_constructor_msgs::SolutionInfo& to) {
+			to.id = from.id;
+			to.cost = from.cost;
+			to.comment = from.comment;
+			to.stage_id = from.stage_id;
+		};
+		moveit_task_constructor_msgs::Solution summary;
+		summary.task_id = msg.task_id;
+		summary.summary = true;
+		summary.sub_solution.resize(msg.sub_solution.size());
+		for (size_t i = 0; i != msg.sub_solution.size(); ++i) {
+			copy_info(msg.sub_solution[i].info, summary.sub_solution[i].info);
+			summary.sub_solution[i].sub_solution_id = msg.sub_solution[i].sub_solution_id;
+		}
+		summary.sub_trajectory.resize(msg.sub_trajectory.size());
+		for (size_t i = 0; i != msg.sub_trajectory.size(); ++i)
+			copy_info(msg.sub_trajectory[i].info, summary.sub_trajectory[i].info);
+		publish(remote_solution_publisher_, std::move(summary));
+	}
+
+	/// publish msg, waiting while max_jobs (or more) publications are pending
+	template <typename Msg>
+	void publishBounded(ros::Publisher& publisher, Msg&& msg, size_t max_jobs) {
+		{
+			std::unique_lock<std::mutex> lock(publish_mutex_);
+			jobs_cv_.wait(lock, [&]() { return publish_jobs_.size() < max_jobs || stop_publishing_; });
+		}
+		publish(publisher, std::forward<Msg>(msg));
+	}
+
+	/** publish stages as delta messages of description_chunk_size_ stages each (requires description_mutex_)
+	 *
+	 * With skeleton, a full message of all stages, omitting their properties, is published first.
+	 * Chunks are enlarged if needed to fit all messages (and a preceding reset) into the publisher queue.
+	 */
+	template <typename Publish>
+	void streamDescription(const std::vector<moveit_task_constructor_msgs::StageDescription>& stages, bool skeleton,
+	                       const Publish& publish) {
+		if (skeleton) {
+			moveit_task_constructor_msgs::TaskDescription msg;
+			msg.task_id = task_id_;
+			msg.stages.reserve(stages.size());
+			for (const auto& stage : stages) {
+				msg.stages.emplace_back();
+				auto& desc = msg.stages.back();
+				desc.id = stage.id;
+				desc.parent_id = stage.parent_id;
+				desc.name = stage.name;
+				desc.flags = stage.flags;
+				desc.properties_omitted = true;
+			}
+			publish(std::move(msg));
+		}
+		const size_t max_chunks = DESCRIPTION_QUEUE_SIZE - 2;  // reserve skeleton and reset messages
+		const size_t chunk_size = std::max(description_chunk_size_, (stages.size() + max_chunks - 1) / max_chunks);
+		// stages are ordered depth-first: parents are always described before their children
+		for (auto begin = stages.begin(); begin != stages.end();) {
+			auto end = begin + std::min<size_t>(chunk_size, stages.end() - begin);
+			moveit_task_constructor_msgs::TaskDescription msg;
+			msg.task_id = task_id_;
+			msg.delta = true;
+			msg.stages.assign(begin, end);
+			publish(std::move(msg));
+			begin = end;
+		}
+	}
+
+	/** publish description incrementally: only stages changed since the last published one
+	 *
+	 * Deltas cannot remove stages: if stages were removed, subscribers are reset and receive a new skeleton.
+	 */
+	void publishIncrementally(moveit_task_constructor_msgs::TaskDescription&& msg) {
+		std::lock_guard<std::mutex> lock(description_mutex_);
+		bool keyframe = description_.empty();
+		std::vector<moveit_task_constructor_msgs::StageDescription> changed;
+		std::unordered_map<uint32_t, size_t> hashes;
+		for (const auto& stage : msg.stages) {
+			ros::SerializedMessage serialized = ros::serialization::serializeMessage(stage);
+			const size_t hash = boost::hash_range(serialized.buf.get(), serialized.buf.get() + serialized.num_bytes);
+			hashes[stage.id] = hash;
+			auto it = description_hashes_.find(stage.id);
+			if (!keyframe && (it == description_hashes_.end() || it->second != hash))
+				changed.push_back(stage);
+		}
+		if (!keyframe && std::any_of(description_hashes_.begin(), description_hashes_.end(),
+		                             [&hashes](const auto& entry) { return hashes.count(entry.first) == 0; })) {
+			indicateReset();
+			keyframe = true;
+		}
+		description_hashes_ = std::move(hashes);
+		description_ = std::move(msg.stages);
+
+		auto publish = [this](moveit_task_constructor_msgs::TaskDescription&& m) { publishDescription(std::move(m)); };
+		if (keyframe)
+			streamDescription(description_, true, publish);
+		else
+			streamDescription(changed, false, publish);
+	}
+
+	/// stream the last published description to a new subscriber (in incremental mode)
+	void describeTo(const ros::SingleSubscriberPublisher& pub) {
+		std::lock_guard<std::mutex> lock(description_mutex_);
+		if (description_chunk_size_ == 0 || description_.empty())
+			return;  // the latched message is complete
+		streamDescription(description_, true,
+		                  [&pub](moveit_task_constructor_msgs::TaskDescription&& msg) { pub.publish(msg); });
+	}
+
+	/// start scenes known to subscribers of the solution topic
+	std::set<std::string>* publishedScenes() {
+		// new subscribers need to receive all scenes again
+		uint32_t num_subscribers = solution_publisher_.getNumSubscribers();
+		if (num_subscribers > num_solution_subscribers_)
+			published_scene_ids_.clear();
+		num_solution_subscribers_ = num_subscribers;
+		return &published_scene_ids_;
+	}
+
+	/** publish solution at limited rate, replacing a still pending one
+	 *
+	 * Without a rate limit, all solutions are queued in order.
+	 * The start scene of a replaced solution is passed on to the next solution referring to it.
+	 */
+	void publishThrottled(moveit_task_constructor_msgs::Solution&& msg) {
+		if (max_solution_rate_ <= 0.0) {
+			publish(solution_publisher_, std::move(msg));
+			return;
+		}
+		// filled start scenes always name their robot model
+		auto has_scene = [](const moveit_task_constructor_msgs::Solution& m) {
+			return !m.start_scene.robot_model_name.empty();
+		};
+		auto next = boost::make_shared<moveit_task_constructor_msgs::Solution>(std::move(msg));
+		moveit_task_constructor_msgs::SolutionPtr dropped;
+		{
+			std::lock_guard<std::mutex> lock(publish_mutex_);
+			dropped = std::move(pending_solution_);
+			if (dropped && has_scene(*dropped) && dropped->start_scene_id == next->start_scene_id && !has_scene(*next)) {
+				next->start_scene = std::move(dropped->start_scene);
+				dropped.reset();
+			}
+			pending_solution_ = std::move(next);
+		}
+		publish_cv_.notify_one();
+		if (dropped && has_scene(*dropped)) {
+			// subscribers never received this scene: send it again with the next solution referring to it
+			std::lock_guard<std::mutex> lock(scene_ids_mutex_);
+			published_scene_ids_.erase(dropped->start_scene_id);
+		}
+	}
+
+	/// is a rate-limited publication due at time now? If so, schedule the next one.
+	static bool due(double max_rate, std::chrono::steady_clock::time_point now,
+	                std::chrono::steady_clock::time_point& next) {
+		if (max_rate <= 0.0)
+			return true;
+		if (now < next)
+			return false;
+		next = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		                 std::chrono::duration<double>(1.0 / max_rate));
+		return true;
+	}
+
+	void publishLoop() {
+		std::unique_lock<std::mutex> lock(publish_mutex_);
+		while (true) {
+			if (executor_ != configured_executor_) {
+				configured_executor_ = executor_;
+				lock.unlock();
+				if (configured_executor_)
+					configured_executor_->configureThread();
+				lock.lock();
+				continue;
+			}
+			if (!publish_jobs_.empty()) {
+				auto job = std::move(publish_jobs_.front());
+				publish_jobs_.pop_front();
+				lock.unlock();
+				jobs_cv_.notify_all();
+				{
+					MTC_TRACE_SCOPE("publish", "Introspection::publish");
+					job();
+				}
+				lock.lock();
+				continue;
+			}
+			if (pending_solution_ &&
+			    (stop_publishing_ || due(max_solution_rate_, std::chrono::steady_clock::now(), next_solution_time_))) {
+				auto msg = std::move(pending_solution_);
+				lock.unlock();
+				{
+					MTC_TRACE_SCOPE("publish", "Introspection::publishSolution");
+					solution_publisher_.publish(msg);
+				}
+				lock.lock();
+				continue;
+			}
+			if (stop_publishing_)
+				break;
+			if (pending_solution_)
+				publish_cv_.wait_until(lock, next_solution_time_);
+			else
+				publish_cv_.wait(lock);
+		}
 	}
 
 	void resetMaps() {
-		// reset maps
-		stage_to_id_map_.clear();
-		stage_to_id_map_[task_] = 0;  // root is task having ID = 0
+		{  // reset maps
+			std::lock_guard<std::mutex> lock(ids_mutex_);
+			stage_to_id_map_.clear();
+			stage_to_id_map_[task_] = 0;  // root is task having ID = 0
+
+			solution_to_id_map_.clear();
+			id_to_solution_.clear();
+			next_solution_id_ = 1;
+		}
 
-		id_solution_bimap_.clear();
+		stage_deltas_.clear();
+		num_deltas_ = 0;  // start with a keyframe
+
+		{  // the next description is published in full again
+			std::lock_guard<std::mutex> lock(description_mutex_);
+			description_.clear();
+			description_hashes_.clear();
+		}
+
+		std::lock_guard<std::mutex> lock(scene_ids_mutex_);
+		scene_ids_.clear();
+		published_scene_ids_.clear();
 	}
 
 	ros::NodeHandle nh_;
@@ -112,12 +470,84 @@ public:
 	ros::Publisher task_statistics_publisher_;
 	/// publish new solutions
 	ros::Publisher solution_publisher_;
-	/// services to provide an individual Solution
+	/// services to provide an individual Solution or several ones
 	ros::ServiceServer get_solution_service_;
+	ros::ServiceServer get_solutions_service_;
+	ros::ServiceServer get_event_log_service_;
+	/// remote profile: reduced topics and services in the remote namespace (invalid if disabled)
+	ros::Publisher remote_description_publisher_;
+	ros::Publisher remote_statistics_publisher_;
+	ros::Publisher remote_solution_publisher_;
+	std::vector<ros::ServiceServer> remote_services_;
 
 	/// mapping from stages to their id
-	std::map<const StagePrivate*, moveit_task_constructor_msgs::StageStatistics::_id_type> stage_to_id_map_;
-	boost::bimap<uint32_t, const SolutionBase*> id_solution_bimap_;
+	std::unordered_map<const StagePrivate*, moveit_task_constructor_msgs::StageStatistics::_id_type> stage_to_id_map_;
+	/// mapping from registered solutions to their id and back, both sized by the number of registered solutions
+	std::unordered_map<const SolutionBase*, uint32_t> solution_to_id_map_;
+	std::unordered_map<uint32_t, const SolutionBase*> id_to_solution_;
+	uint32_t next_solution_id_ = 1;  // ids are never reused (until reset)
+	mutable std::mutex ids_mutex_;  // guards id maps, which are accessed by threads filling solution messages
+	bool binary_properties_ = false;
+
+	/// incremental descriptions: max stages per message (0 = complete descriptions)
+	size_t description_chunk_size_ = 0;
+	/// last published stage descriptions and hashes of their content by stage id (in incremental mode)
+	std::vector<moveit_task_constructor_msgs::StageDescription> description_;
+	std::unordered_map<uint32_t, size_t> description_hashes_;
+	std::mutex description_mutex_;
+	std::atomic<double> trajectory_tolerance_{ 0.0 };  // decimation tolerance of published trajectories
+
+	/// changes of a stage since the last published TaskStatistics (in delta mode)
+	struct StageDelta
+	{
+		std::vector<uint32_t> solved;
+		std::vector<uint32_t> failed;
+		std::vector<uint32_t> removed;
+		// last published values
+		uint32_t num_failed = 0;
+		uint32_t num_pruned = 0;
+		double total_compute_time = 0.0;
+		size_t memory = 0;
+		size_t frontier = 0;  // signature of frontier metrics
+	};
+	std::unordered_map<const StagePrivate*, StageDelta> stage_deltas_;
+	unsigned int keyframe_interval_ = 0;  // 0 = delta encoding (of the statistics topic) disabled
+	unsigned int num_deltas_ = 0;  // delta messages since last keyframe
+	uint32_t statistics_seq_ = 0;
+	/// remote statistics since the last keyframe (published by the publisher thread), replayed to new subscribers
+	std::vector<boost::shared_ptr<const moveit_task_constructor_msgs::TaskStatistics>> remote_statistics_;
+	std::mutex remote_statistics_mutex_;
+
+	/// rate limiting of task_statistics (applied by the planning thread)
+	double max_statistics_rate_ = 0.0;  // 0 = unlimited
+	std::chrono::steady_clock::time_point next_statistics_time_;
+	bool statistics_pending_ = false;  // skipped updates not yet published
+
+	/// content hashes of start scenes, computed once per scene instance
+	std::map<const planning_scene::PlanningScene*,
+	         std::pair<std::weak_ptr<const planning_scene::PlanningScene>, std::string>>
+	    scene_ids_;
+	/// ids of start scenes already published on the solution topic
+	std::set<std::string> published_scene_ids_;
+	uint32_t num_solution_subscribers_ = 0;
+	std::mutex scene_ids_mutex_;
+
+	/// time spent by the planning thread in publishTaskState() and publishSolution()
+	LatencyHistogram publish_latency_;
+
+	/// background publishing: jobs are processed in order, solutions are rate-limited
+	std::thread publisher_thread_;
+	std::mutex publish_mutex_;
+	std::condition_variable publish_cv_;
+	std::condition_variable jobs_cv_;  // notified when a job was taken from publish_jobs_
+	bool stop_publishing_ = false;
+	std::deque<std::function<void()>> publish_jobs_;
+	moveit_task_constructor_msgs::SolutionPtr pending_solution_;
+	double max_solution_rate_ = 0.0;  // 0 = unlimited
+	std::chrono::steady_clock::time_point next_solution_time_;
+	/// executor whose thread configuration the publisher thread should apply, and the one it applied
+	TaskExecutorPtr executor_;
+	TaskExecutorPtr configured_executor_;
 };
 
 Introspection::Introspection(const TaskPrivate* task) : impl(new IntrospectionPrivate(task, this)) {}
@@ -128,12 +558,131 @@ Introspection::~Introspection() {
 
 void Introspection::publishTaskDescription() {
 	::moveit_task_constructor_msgs::TaskDescription msg;
-	impl->task_description_publisher_.publish(fillTaskDescription(msg));
+	fillTaskDescription(msg);
+	if (impl->description_chunk_size_ > 0)
+		impl->publishIncrementally(std::move(msg));
+	else
+		impl->publishDescription(std::move(msg));
+}
+
+void Introspection::setDescriptionChunkSize(size_t num_stages) {
+	std::lock_guard<std::mutex> lock(impl->description_mutex_);
+	if (num_stages != impl->description_chunk_size_) {
+		impl->description_chunk_size_ = num_stages;
+		impl->description_.clear();  // start with a skeleton
+		impl->description_hashes_.clear();
+	}
+}
+
+void Introspection::setBinaryProperties(bool enable) {
+	impl->binary_properties_ = enable;
+}
+
+void Introspection::setTrajectoryTolerance(double tolerance) {
+	impl->trajectory_tolerance_ = tolerance;
 }
 
 void Introspection::publishTaskState() {
+	// coalesce updates while nobody listens or the rate limit is exceeded
+	if (impl->numStatisticsSubscribers() == 0 ||
+	    !impl->due(impl->max_statistics_rate_, std::chrono::steady_clock::now(), impl->next_statistics_time_)) {
+		impl->statistics_pending_ = true;
+		return;
+	}
+	flushTaskState(true);
+}
+
+void Introspection::flushTaskState(bool force) {
+	if (!force && !impl->statistics_pending_)
+		return;
+	impl->statistics_pending_ = false;
+
+	MTC_TRACE_SCOPE("introspection", "Introspection::fillTaskStatistics");
+	const auto start = std::chrono::steady_clock::now();
 	::moveit_task_constructor_msgs::TaskStatistics msg;
-	impl->task_statistics_publisher_.publish(fillTaskStatistics(msg));
+	if (impl->deltaInterval() == 0)
+		fillTaskStatistics(msg);
+	else
+		fillTaskStatisticsDelta(msg);
+	msg.seq = ++impl->statistics_seq_;
+	impl->publishRemoteStatistics(msg);
+	if (impl->keyframe_interval_ == 0 && impl->deltaInterval() != 0) {  // deltas were for the remote profile only
+		const uint32_t seq = msg.seq;
+		msg = ::moveit_task_constructor_msgs::TaskStatistics();
+		fillTaskStatistics(msg);
+		msg.seq = seq;
+	}
+	impl->publish(impl->task_statistics_publisher_, std::move(msg));
+	impl->publish_latency_.record(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void Introspection::setMaxStatisticsRate(double rate) {
+	impl->max_statistics_rate_ = rate;
+}
+
+void Introspection::setMaxSolutionRate(double rate) {
+	std::lock_guard<std::mutex> lock(impl->publish_mutex_);
+	impl->max_solution_rate_ = rate;
+}
+
+void Introspection::setStatisticsKeyframeInterval(unsigned int interval) {
+	if (interval != impl->keyframe_interval_) {
+		impl->keyframe_interval_ = interval;
+		impl->stage_deltas_.clear();
+		impl->num_deltas_ = 0;  // start with a keyframe
+	}
+}
+
+void Introspection::setRemoteProfile(bool enable) {
+	if (enable == bool(impl->remote_statistics_publisher_))
+		return;
+	if (!enable) {
+		impl->remote_description_publisher_.shutdown();
+		impl->remote_statistics_publisher_.shutdown();
+		impl->remote_solution_publisher_.shutdown();
+		impl->remote_services_.clear();  // shuts down the services
+		impl->remote_description_publisher_ = ros::Publisher();
+		impl->remote_statistics_publisher_ = ros::Publisher();
+		impl->remote_solution_publisher_ = ros::Publisher();
+		std::lock_guard<std::mutex> lock(impl->remote_statistics_mutex_);
+		impl->remote_statistics_.clear();
+		if (impl->keyframe_interval_ == 0)
+			impl->stage_deltas_.clear();  // not maintained anymore
+		return;
+	}
+
+	if (impl->keyframe_interval_ == 0) {  // start delta encoding of remote statistics with a keyframe
+		impl->stage_deltas_.clear();
+		impl->num_deltas_ = 0;
+	}
+
+	ros::NodeHandle nh(impl->nh_, REMOTE_NAMESPACE);
+	impl->remote_description_publisher_ = nh.advertise<moveit_task_constructor_msgs::TaskDescription>(
+	    DESCRIPTION_TOPIC, DESCRIPTION_QUEUE_SIZE,
+	    [this](const ros::SingleSubscriberPublisher& pub) { impl->describeTo(pub); },
+	    ros::SubscriberStatusCallback(), ros::VoidConstPtr(), true);
+	// deltas are queued instead of latched: new subscribers receive the last keyframe and all later deltas
+	impl->remote_statistics_publisher_ = nh.advertise<moveit_task_constructor_msgs::TaskStatistics>(
+	    STATISTICS_TOPIC, std::max(REMOTE_KEYFRAME_INTERVAL, impl->keyframe_interval_),
+	    [this](const ros::SingleSubscriberPublisher& pub) { impl->replayRemoteStatistics(pub); });
+	// summaries are small: queue them instead of dropping the data of earlier solutions
+	impl->remote_solution_publisher_ = nh.advertise<moveit_task_constructor_msgs::Solution>(SOLUTION_TOPIC, 100, true);
+
+	const std::string& task_id = impl->task_id_;
+	impl->remote_services_.push_back(
+	    nh.advertiseService(std::string(GET_SOLUTION_SERVICE "_") + task_id, &Introspection::getSolution, this));
+	impl->remote_services_.push_back(
+	    nh.advertiseService(std::string(GET_SOLUTIONS_SERVICE "_") + task_id, &Introspection::getSolutions, this));
+	impl->remote_services_.push_back(
+	    nh.advertiseService(std::string(GET_EVENT_LOG_SERVICE "_") + task_id, &Introspection::getEventLog, this));
+}
+
+void Introspection::setExecutor(const TaskExecutorPtr& executor) {
+	{
+		std::lock_guard<std::mutex> lock(impl->publish_mutex_);
+		impl->executor_ = executor;
+	}
+	impl->publish_cv_.notify_one();
 }
 
 void Introspection::reset() {
@@ -142,25 +691,85 @@ void Introspection::reset() {
 }
 
 void Introspection::registerSolution(const SolutionBase& s) {
-	solutionId(s);
+	uint32_t id = solutionId(s);
+	if (impl->deltaInterval() == 0 || !s.creator())
+		return;
+
+	auto& delta = impl->stage_deltas_[s.creator()->pimpl()];
+	(s.isFailure() ? delta.failed : delta.solved).push_back(id);
+}
+
+void Introspection::unregisterSolution(const SolutionBase& s) {
+	std::lock_guard<std::mutex> lock(impl->ids_mutex_);
+	auto it = impl->solution_to_id_map_.find(&s);
+	if (it == impl->solution_to_id_map_.end())
+		return;
+
+	if (impl->deltaInterval() != 0 && s.creator()) {
+		auto& delta = impl->stage_deltas_[s.creator()->pimpl()];
+		auto& added = s.isFailure() ? delta.failed : delta.solved;
+		auto pos = std::find(added.begin(), added.end(), it->second);
+		if (pos != added.end())
+			added.erase(pos);  // not yet published
+		else
+			delta.removed.push_back(it->second);
+	}
+	impl->id_to_solution_.erase(it->second);
+	impl->solution_to_id_map_.erase(it);
 }
 
-void Introspection::fillSolution(moveit_task_constructor_msgs::Solution& msg, const SolutionBase& s) {
+void Introspection::fillSolution(moveit_task_constructor_msgs::Solution& msg, const SolutionBase& s,
+                                 std::set<std::string>* known_scenes) {
 	s.fillMessage(msg, this);
-	s.start()->scene()->getPlanningSceneMsg(msg.start_scene);
+	const double tolerance = impl->trajectory_tolerance_;
+	if (tolerance > 0.0)
+		for (auto& sub : msg.sub_trajectory)
+			decimateTrajectory(sub.trajectory.joint_trajectory, tolerance);
+
+	const planning_scene::PlanningSceneConstPtr& scene = s.start()->scene();
+	std::lock_guard<std::mutex> lock(impl->scene_ids_mutex_);
+	auto& entry = impl->scene_ids_[scene.get()];
+	bool filled = false;  // start_scene filled already?
+	if (entry.first.lock() != scene) {  // unknown scene (or reused address)
+		scene->getPlanningSceneMsg(msg.start_scene);
+		entry = std::make_pair(scene, sceneId(msg.start_scene));
+		filled = true;
+	}
+	msg.start_scene_id = entry.second;
+
+	const bool omit = known_scenes && !known_scenes->insert(entry.second).second;
+	if (omit && filled)
+		msg.start_scene = moveit_msgs::PlanningScene();
+	else if (!omit && !filled)
+		scene->getPlanningSceneMsg(msg.start_scene);
 
 	msg.task_id = impl->task_id_;
 }
 
 void Introspection::publishSolution(const SolutionBase& s) {
+	MTC_TRACE_SCOPE("introspection", "Introspection::fillSolution", solutionId(s));
+	const auto start = std::chrono::steady_clock::now();
 	moveit_task_constructor_msgs::Solution msg;
-	fillSolution(msg, s);
-	impl->solution_publisher_.publish(msg);
+	fillSolution(msg, s, impl->publishedScenes());
+	impl->publishSummary(msg);
+	impl->publishThrottled(std::move(msg));
+	impl->publish_latency_.record(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+const LatencyHistogram& Introspection::publishLatency() const {
+	return impl->publish_latency_;
 }
 
 void Introspection::publishAllSolutions(bool wait) {
+	if (!wait) {
+		publishSolutions(std::numeric_limits<size_t>::max());
+		return;
+	}
 	for (const auto& solution : impl->task_->stages()->solutions()) {
-		publishSolution(*solution);
+		moveit_task_constructor_msgs::Solution msg;  // not rate-limited
+		fillSolution(msg, *solution, impl->publishedScenes());
+		impl->publishSummary(msg);
+		impl->publish(impl->solution_publisher_, std::move(msg));
 
 		if (wait) {
 			std::cout << "Press <Enter> to continue ..." << std::endl;
@@ -171,11 +780,80 @@ void Introspection::publishAllSolutions(bool wait) {
 	};
 }
 
+size_t Introspection::publishSolutions(size_t count, size_t first, unsigned int num_threads) {
+	std::vector<const SolutionBase*> solutions;
+	for (const auto& solution : impl->task_->stages()->solutions()) {
+		if (solutions.size() == count)
+			break;
+		if (first > 0)
+			--first;
+		else
+			solutions.push_back(solution.get());
+	}
+	if (solutions.empty())
+		return 0;
+
+	if (num_threads == 0)
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	num_threads = std::min<size_t>(num_threads, solutions.size());
+	// bound of messages filled ahead of publishing, and of pending publications
+	const size_t max_pending = 2 * num_threads;
+
+	// workers fill messages (including all start scenes) in order of their index, but at most max_pending ahead
+	std::vector<moveit_task_constructor_msgs::Solution> msgs(solutions.size());
+	std::vector<bool> filled(solutions.size(), false);
+	size_t next = 0;  // next message to fill
+	size_t published = 0;  // messages published so far
+	std::mutex mutex;
+	std::condition_variable cv;
+	auto fill = [&]() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			cv.wait(lock, [&]() { return next == msgs.size() || next < published + max_pending; });
+			if (next == msgs.size())
+				return;
+			const size_t index = next++;
+			lock.unlock();
+			fillSolution(msgs[index], *solutions[index]);
+			lock.lock();
+			filled[index] = true;
+			cv.notify_all();
+		}
+	};
+	std::vector<std::thread> threads;
+	const TaskExecutorPtr executor = impl->task_->taskExecutor();
+	for (unsigned int i = 0; i != num_threads; ++i)
+		threads.push_back(executor->spawn(fill));
+
+	// publish in order, omitting start scenes already known to subscribers
+	std::set<std::string>* known_scenes = impl->publishedScenes();
+	for (size_t index = 0; index != msgs.size(); ++index) {
+		moveit_task_constructor_msgs::Solution msg;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&]() { return filled[index]; });
+			msg = std::move(msgs[index]);
+		}
+		{
+			std::lock_guard<std::mutex> lock(impl->scene_ids_mutex_);
+			if (!known_scenes->insert(msg.start_scene_id).second)
+				msg.start_scene = moveit_msgs::PlanningScene();
+		}
+		impl->publishSummary(msg);
+		impl->publishBounded(impl->solution_publisher_, std::move(msg), max_pending);
+		std::lock_guard<std::mutex> lock(mutex);
+		++published;
+		cv.notify_all();
+	}
+	for (auto& thread : threads)
+		thread.join();
+	return msgs.size();
+}
+
 const SolutionBase* Introspection::solutionFromId(uint id) const {
-	auto it = impl->id_solution_bimap_.left.find(id);
-	if (it == impl->id_solution_bimap_.left.end())
-		return nullptr;
-	return it->second;
+	std::lock_guard<std::mutex> lock(impl->ids_mutex_);
+	auto it = impl->id_to_solution_.find(id);
+	return it == impl->id_to_solution_.end() ? nullptr : it->second;
 }
 
 bool Introspection::getSolution(moveit_task_constructor_msgs::GetSolution::Request& req,
@@ -188,10 +866,41 @@ bool Introspection::getSolution(moveit_task_constructor_msgs::GetSolution::Reque
 	return true;
 }
 
+bool Introspection::getSolutions(moveit_task_constructor_msgs::GetSolutions::Request& req,
+                                 moveit_task_constructor_msgs::GetSolutions::Response& res) {
+	std::vector<const SolutionBase*> solutions;
+	for (uint32_t id : req.solution_ids)
+		if (const SolutionBase* solution = solutionFromId(id))
+			solutions.push_back(solution);
+	uint32_t remaining = req.top_n;
+	for (const auto& solution : impl->task_->stages()->solutions()) {
+		if (remaining-- == 0)
+			break;
+		solutions.push_back(solution.get());
+	}
+
+	std::set<std::string> known_scenes;
+	res.solutions.resize(solutions.size());
+	res.solution_ids.reserve(solutions.size());
+	for (size_t i = 0; i != solutions.size(); ++i) {
+		fillSolution(res.solutions[i], *solutions[i], &known_scenes);
+		res.solution_ids.push_back(solutionId(*solutions[i]));
+	}
+	return true;
+}
+
+bool Introspection::getEventLog(moveit_task_constructor_msgs::GetEventLog::Request& req,
+                                moveit_task_constructor_msgs::GetEventLog::Response& res) {
+	res.log = static_cast<const Task*>(impl->task_->me())->dumpEvents(req.max_events);
+	return true;
+}
+
 uint32_t Introspection::stageId(const Stage* const s) {
+	std::lock_guard<std::mutex> lock(impl->ids_mutex_);
 	return impl->stage_to_id_map_.insert(std::make_pair(s->pimpl(), impl->stage_to_id_map_.size())).first->second;
 }
 uint32_t Introspection::stageId(const Stage* const s) const {
+	std::lock_guard<std::mutex> lock(impl->ids_mutex_);
 	auto it = impl->stage_to_id_map_.find(s->pimpl());
 	if (it == impl->stage_to_id_map_.end())
 		throw std::runtime_error("unregistered stage: " + s->name());
@@ -199,10 +908,69 @@ uint32_t Introspection::stageId(const Stage* const s) const {
 }
 
 uint32_t Introspection::solutionId(const SolutionBase& s) {
-	auto result = impl->id_solution_bimap_.left.insert(std::make_pair(1 + impl->id_solution_bimap_.size(), &s));
-	return result.first->first;
+	std::lock_guard<std::mutex> lock(impl->ids_mutex_);
+	auto inserted = impl->solution_to_id_map_.emplace(&s, impl->next_solution_id_);
+	if (inserted.second)
+		impl->id_to_solution_.emplace(impl->next_solution_id_++, &s);
+	return inserted.first->second;
+}
+
+uint32_t Introspection::stateId(const InterfaceState& s) {
+	// states are the end (or start) of the solution propagating (or generating) them
+	const InterfaceState::Solutions& creators =
+	    s.incomingTrajectories().empty() ? s.outgoingTrajectories() : s.incomingTrajectories();
+	return creators.empty() ? 0 : solutionId(*creators.front());
+}
+
+namespace {
+void fillMemoryUsage(const MemoryUsage& usage, moveit_task_constructor_msgs::StageStatistics& msg) {
+	msg.memory_states = usage.states;
+	msg.memory_scenes = usage.scenes;
+	msg.memory_trajectories = usage.trajectories;
+	msg.memory_markers = usage.markers;
 }
 
+void fillInterfaceMetrics(const InterfaceConstPtr& interface,
+                          std::vector<moveit_task_constructor_msgs::InterfaceMetrics>& msgs) {
+	msgs.clear();
+	if (!interface)
+		return;
+	const Interface::Metrics m = interface->metrics();
+	moveit_task_constructor_msgs::InterfaceMetrics msg;
+	msg.states = m.states;
+	msg.enabled = m.enabled;
+	msg.pruned = m.pruned;
+	msg.max_depth = m.max_depth;
+	msg.pending = m.pending;
+	msg.added = m.added;
+	msg.expanded = m.expanded;
+	msg.mean_age = m.mean_age;
+	msg.max_age = m.max_age;
+	msg.expansion_rate = m.expansion_rate;
+	msgs.push_back(msg);
+}
+
+// fill frontier metrics of stage's interfaces, if enabled, and return a signature of their history
+size_t fillFrontier(const Stage& stage, moveit_task_constructor_msgs::StageStatistics& msg) {
+	if (!Interface::metricsEnabled())
+		return 0;
+	fillInterfaceMetrics(stage.pimpl()->starts(), msg.starts);
+	fillInterfaceMetrics(stage.pimpl()->ends(), msg.ends);
+	size_t signature = 0;
+	for (const auto* metrics : { &msg.starts, &msg.ends })
+		for (const auto& m : *metrics)
+			signature += m.added + m.expanded + m.states + m.enabled;
+	return signature;
+}
+
+void fillFailureReasons(const Stage& stage, moveit_task_constructor_msgs::StageStatistics& msg) {
+	for (const auto& pair : stage.failureReasons()) {
+		msg.failure_reasons.push_back(pair.first);
+		msg.failure_counts.push_back(pair.second);
+	}
+}
+}  // namespace
+
 void Introspection::fillStageStatistics(const Stage& stage, moveit_task_constructor_msgs::StageStatistics& s) {
 	// successful solutions
 	for (const auto& solution : stage.solutions())
@@ -214,6 +982,78 @@ void Introspection::fillStageStatistics(const Stage& stage, moveit_task_construc
 
 	s.total_compute_time = stage.getTotalComputeTime();
 	s.num_failed = stage.numFailures();
+	s.num_pruned = stage.numPruned();
+	fillFailureReasons(stage, s);
+	fillMemoryUsage(stage.memoryUsage(), s);
+	fillHistogram(stage.computeLatency(), s.compute_latency);
+	fillHistogram(stage.solutionLatency(), s.solution_latency);
+	fillFrontier(stage, s);
+}
+
+void Introspection::fillTaskStatisticsDelta(moveit_task_constructor_msgs::TaskStatistics& msg) {
+	const bool keyframe = impl->num_deltas_ == 0;
+	impl->num_deltas_ = (impl->num_deltas_ + 1) % impl->deltaInterval();
+
+	ContainerBase::StageCallback stage_processor = [this, &msg, keyframe](const Stage& stage,
+	                                                                      unsigned int /*depth*/) -> bool {
+		auto& delta = impl->stage_deltas_[stage.pimpl()];
+		moveit_task_constructor_msgs::StageStatistics stat;
+		stat.id = stageId(&stage);
+		stat.num_failed = stage.numFailures();
+		stat.num_pruned = stage.numPruned();
+		stat.total_compute_time = stage.getTotalComputeTime();
+		const MemoryUsage memory = stage.memoryUsage();
+		fillMemoryUsage(memory, stat);
+		const size_t frontier = fillFrontier(stage, stat);
+
+		if (keyframe) {
+			fillStageStatistics(stage, stat);
+			msg.stages.push_back(std::move(stat));
+		} else if (!delta.solved.empty() || !delta.failed.empty() || !delta.removed.empty() ||
+		           stat.num_failed != delta.num_failed || stat.num_pruned != delta.num_pruned ||
+		           stat.total_compute_time != delta.total_compute_time || memory.total() != delta.memory ||
+		           frontier != delta.frontier) {
+			if (!delta.solved.empty()) {  // locate new solutions in the cost-sorted list
+				std::sort(delta.solved.begin(), delta.solved.end());
+				uint32_t index = 0;
+				for (const auto& solution : stage.solutions()) {
+					uint32_t id = solutionId(*solution);
+					if (std::binary_search(delta.solved.begin(), delta.solved.end(), id)) {
+						stat.solved.push_back(id);
+						stat.solved_index.push_back(index);
+						if (stat.solved.size() == delta.solved.size())
+							break;
+					}
+					++index;
+				}
+			}
+			stat.failed = std::move(delta.failed);
+			stat.removed = std::move(delta.removed);
+			if (stat.num_failed != delta.num_failed)
+				fillFailureReasons(stage, stat);
+			fillHistogram(stage.computeLatency(), stat.compute_latency);
+			fillHistogram(stage.solutionLatency(), stat.solution_latency);
+			msg.stages.push_back(std::move(stat));
+		}
+
+		// remember published state
+		delta.solved.clear();
+		delta.failed.clear();
+		delta.removed.clear();
+		delta.num_failed = stage.numFailures();
+		delta.num_pruned = stage.numPruned();
+		delta.total_compute_time = stage.getTotalComputeTime();
+		delta.memory = memory.total();
+		delta.frontier = frontier;
+		return true;
+	};
+
+	msg.stages.clear();
+	impl->task_->stages()->traverseRecursively(stage_processor);
+	fillPlannerStatistics(msg);
+
+	msg.task_id = impl->task_id_;
+	msg.delta = !keyframe;
 }
 
 moveit_task_constructor_msgs::TaskDescription&
@@ -231,8 +1071,11 @@ Introspection::fillTaskDescription(moveit_task_constructor_msgs::TaskDescription
 			p.name = pair.first;
 			p.description = pair.second.description();
 			p.type = pair.second.typeName();
-			p.value = pair.second.serialize();
-			desc.properties.push_back(p);
+			if (impl->binary_properties_ && Property::serializeBinary(pair.second.value(), p.data))
+				p.encoding = moveit_task_constructor_msgs::Property::BINARY;
+			else
+				p.value = pair.second.serialize();
+			desc.properties.push_back(std::move(p));
 		}
 
 		auto it = impl->stage_to_id_map_.find(stage.pimpl()->parent()->pimpl());
@@ -266,9 +1109,46 @@ Introspection::fillTaskStatistics(moveit_task_constructor_msgs::TaskStatistics&
 
 	msg.stages.clear();
 	impl->task_->stages()->traverseRecursively(stage_processor);
+	fillPlannerStatistics(msg);
 
 	msg.task_id = impl->task_id_;
 	return msg;
 }
+
+void Introspection::fillPlannerStatistics(moveit_task_constructor_msgs::TaskStatistics& msg) {
+	// planner instances might be shared between stages: visit each once
+	std::set<solvers::PlannerInterfaceConstPtr> planners;
+	impl->task_->stages()->traverseRecursively([&planners](const Stage& stage, unsigned int /*depth*/) {
+		for (const auto& planner : stage.planners())
+			if (planner)
+				planners.insert(planner);
+		return true;
+	});
+
+	// aggregate statistics of different instances with same (group, planner id)
+	solvers::PlannerInterface::Statistics stats;
+	for (const auto& planner : planners) {
+		for (const auto& pair : planner->statistics()) {
+			auto& s = stats[pair.first];
+			s.calls += pair.second.calls;
+			s.successes += pair.second.successes;
+			s.waypoints += pair.second.waypoints;
+			s.planning_time.merge(pair.second.planning_time);
+		}
+	}
+
+	msg.planners.clear();
+	msg.planners.reserve(stats.size());
+	for (const auto& pair : stats) {
+		moveit_task_constructor_msgs::PlannerStatistics p;
+		p.group = pair.first.first;
+		p.planner_id = pair.first.second;
+		p.calls = pair.second.calls;
+		p.successes = pair.second.successes;
+		p.waypoints = pair.second.waypoints;
+		fillHistogram(pair.second.planning_time, p.planning_time);
+		msg.planners.push_back(std::move(p));
+	}
+}
 }  // namespace task_constructor
 }  // namespace moveit
@@ -2,6 +2,10 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_state/robot_state.h>
 #include <eigen_conversions/eigen_msg.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace vm = visualization_msgs;
 
@@ -99,6 +103,67 @@ std::vector<std::string> linkNames(const std::vector<const moveit::core::LinkMod
 	return names;
 }
 
+/// marker templates for links of a URDF model, placed w.r.t. their link frame
+struct LinkMarkerTemplates
+{
+	std::mutex mutex;
+	// link name -> markers of all its elements
+	std::unordered_map<std::string, std::vector<visualization_msgs::Marker>> links;
+};
+
+/// process-wide cache of marker templates, shared by all RobotModels using the same URDF model
+template <class T>  // with T = urdf::Visual or urdf::Collision
+std::shared_ptr<LinkMarkerTemplates> markerTemplates(const urdf::ModelInterfaceSharedPtr& model) {
+	using Key = std::weak_ptr<const urdf::ModelInterface>;
+	static std::mutex mutex;
+	static std::map<Key, std::shared_ptr<LinkMarkerTemplates>, std::owner_less<Key>> cache;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = cache.find(model);
+	if (it != cache.end())
+		return it->second;
+
+	// drop templates of released models
+	for (auto pruned = cache.begin(); pruned != cache.end();)
+		pruned = pruned->first.expired() ? cache.erase(pruned) : std::next(pruned);
+	return cache.emplace(model, std::make_shared<LinkMarkerTemplates>()).first->second;
+}
+
+/// retrieve (and create if needed) marker templates of link name, nullptr if link is unknown
+template <class T>
+const std::vector<visualization_msgs::Marker>* linkMarkers(LinkMarkerTemplates& templates,
+                                                           const urdf::ModelInterface& model, const std::string& name) {
+	std::lock_guard<std::mutex> lock(templates.mutex);
+	auto it = templates.links.find(name);
+	if (it != templates.links.end())
+		return &it->second;
+
+	const urdf::LinkConstSharedPtr& link = model.getLink(name);
+	if (!link)
+		return nullptr;
+
+	// code adapted from rviz::RobotLink::createVisual() / createCollision()
+	std::vector<visualization_msgs::Marker> markers;
+	auto element_handler = [&](const T& element) {
+		if (element && element->geometry) {
+			markers.emplace_back();
+			createGeometryMarker(markers.back(), *element->geometry, element->origin,
+			                     materialColor(model, materialName(*element)));
+		}
+	};
+
+	// either we have an array of collision/visual elements
+	for (const auto& element : elements_vector<T>(*link))
+		element_handler(element);
+
+	// or there is a single such element
+	if (markers.empty())
+		element_handler(element<T>(*link));
+
+	// unordered_map never invalidates references to its elements
+	return &templates.links.emplace(name, std::move(markers)).first->second;
+}
+
 /** generate marker msgs to visualize the robot state, calling the given callback for each of them
  *  link_names: set of links to include (or all if empty) */
 template <class T>  // with T = urdf::Visual or urdf::Collision
@@ -110,32 +175,22 @@ void generateMarkers(const moveit::core::RobotState& robot_state, const MarkerCa
 	if (!model)
 		return;
 
-	visualization_msgs::Marker m;
-	m.header.frame_id = robot_state.getRobotModel()->getModelFrame();
+	// geometry markers are created once per link, only their pose needs to be filled in per state
+	const std::shared_ptr<LinkMarkerTemplates> templates = markerTemplates<T>(model);
+	const std::string& model_frame = robot_state.getRobotModel()->getModelFrame();
 
-	// code adapted from rviz::RobotLink::createVisual() / createCollision()
+	visualization_msgs::Marker m;
 	for (const auto& name : *names) {
-		const urdf::LinkConstSharedPtr& link = model->getLink(name);
-		if (!link)
+		const std::vector<visualization_msgs::Marker>* link_markers = linkMarkers<T>(*templates, *model, name);
+		if (!link_markers)
 			return;
 
-		bool valid_found = false;
-		auto element_handler = [&](const T& element) {
-			if (element && element->geometry) {
-				createGeometryMarker(m, *element->geometry, element->origin, materialColor(*model, materialName(*element)));
-				m.pose = rviz_marker_tools::composePoses(robot_state.getGlobalLinkTransform(name), m.pose);
-				callback(m, name);
-				valid_found = true;
-			}
-		};
-
-		// either we have an array of collision/visual elements
-		for (const auto& element : elements_vector<T>(*link))
-			element_handler(element);
-
-		// or there is a single such element
-		if (!valid_found)
-			element_handler(element<T>(*link));
+		for (const visualization_msgs::Marker& t : *link_markers) {
+			m = t;
+			m.header.frame_id = model_frame;
+			m.pose = rviz_marker_tools::composePoses(robot_state.getGlobalLinkTransform(name), t.pose);
+			callback(m, name);
+		}
 	}
 }
 
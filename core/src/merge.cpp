@@ -107,6 +107,14 @@ robot_trajectory::RobotTrajectoryPtr
 merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
       const robot_state::RobotState& base_state, moveit::core::JointModelGroup*& merged_group,
       const trajectory_processing::TimeParameterization& time_parameterization) {
+	auto merged_traj = merge(sub_trajectories, base_state, merged_group);
+	time_parameterization.computeTimeStamps(*merged_traj, 1.0, 1.0);
+	return merged_traj;
+}
+
+robot_trajectory::RobotTrajectoryPtr
+merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
+      const robot_state::RobotState& base_state, moveit::core::JointModelGroup*& merged_group) {
 	if (sub_trajectories.size() <= 1)
 		throw std::runtime_error("Expected multiple sub solutions");
 
@@ -117,56 +125,53 @@ merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajecto
 			groups.push_back(sub->getGroup());
 		merged_group = merge(groups);
 	}
-	const std::vector<const moveit::core::JointModel*>* merged_joints = &merged_group->getJointModels();
 
 	// sanity checks: all sub solutions must share the same robot model and use disjoint joint sets
 	const moveit::core::RobotModelConstPtr& robot_model = base_state.getRobotModel();
-	unsigned int max_num_vars = 0;  // maximum number of joint variables across sub groups
+	std::vector<bool> merged_joints(robot_model->getJointModelCount(), false);
+	for (const moveit::core::JointModel* jm : merged_group->getJointModels())
+		merged_joints[jm->getJointIndex()] = true;
+
+	size_t num_waypoints = 0;
 	for (const robot_trajectory::RobotTrajectoryConstPtr& sub : sub_trajectories) {
 		if (sub->getRobotModel() != robot_model)
 			throw std::runtime_error("subsolutions refer to multiple robot models");
 
-		const moveit::core::JointModelGroup* jmg = sub->getGroup();
-		const auto& joints = jmg->getJointModels();
 		// validate that the joint model is known
-		for (const moveit::core::JointModel* jm : joints) {
-			if (std::find(merged_joints->cbegin(), merged_joints->cend(), jm) == merged_joints->cend())
+		for (const moveit::core::JointModel* jm : sub->getGroup()->getJointModels()) {
+			if (!merged_joints[jm->getJointIndex()])
 				throw std::runtime_error("subsolutions refers to unknown joint: " + jm->getName());
 		}
-		max_num_vars = std::max(max_num_vars, jmg->getVariableCount());
+		num_waypoints = std::max(num_waypoints, sub->getWayPointCount());
 	}
 
-	// do the actual trajectory merging
-	auto merged_traj = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model, merged_group);
-	std::vector<double> values;
-	values.reserve(max_num_vars);
-
-	auto merged_state = std::make_shared<robot_state::RobotState>(base_state);
-	while (true) {
-		bool finished = true;
-		size_t index = merged_traj->getWayPointCount();
-
-		for (const robot_trajectory::RobotTrajectoryConstPtr& sub : sub_trajectories) {
-			if (index >= sub->getWayPointCount())
-				continue;  // no more waypoints in this sub solution
-
-			finished = false;  // there was a waypoint, continue while loop
-			const robot_state::RobotState& sub_state = sub->getWayPoint(index);
-			sub_state.copyJointGroupPositions(sub->getGroup(), values);
-			merged_state->setJointGroupPositions(sub->getGroup(), values);
+	// fill all waypoints' positions in a column-major buffer, one contiguous column per waypoint
+	// sub trajectories that finished early hold their last waypoint
+	const size_t num_vars = robot_model->getVariableCount();
+	std::vector<double> positions(num_vars * num_waypoints);
+	const double* base_positions = base_state.getVariablePositions();
+	for (size_t index = 0; index != num_waypoints; ++index)
+		std::copy(base_positions, base_positions + num_vars, positions.begin() + index * num_vars);
+	for (const robot_trajectory::RobotTrajectoryConstPtr& sub : sub_trajectories) {
+		const std::vector<int>& variables = sub->getGroup()->getVariableIndexList();
+		const size_t count = sub->getWayPointCount();
+		for (size_t index = 0; count > 0 && index != num_waypoints; ++index) {
+			const double* src = sub->getWayPoint(std::min(index, count - 1)).getVariablePositions();
+			double* dst = positions.data() + index * num_vars;
+			for (int variable : variables)
+				dst[variable] = src[variable];
 		}
-		if (finished)
-			break;
+	}
 
+	// do the actual trajectory merging
+	auto merged_traj = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model, merged_group);
+	for (size_t index = 0; index != num_waypoints; ++index) {
+		auto merged_state = std::make_shared<robot_state::RobotState>(base_state);
+		merged_state->setVariablePositions(positions.data() + index * num_vars);
 		merged_state->update();
 		// add waypoint without timing
 		merged_traj->addSuffixWayPoint(merged_state, 0.0);
-		// create new RobotState for next waypoint
-		merged_state = std::make_shared<robot_state::RobotState>(*merged_state);
 	}
-
-	// add timing
-	time_parameterization.computeTimeStamps(*merged_traj, 1.0, 1.0);
 	return merged_traj;
 }
 }  // namespace task_constructor
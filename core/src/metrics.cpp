@@ -0,0 +1,297 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Export planning statistics of a task as Prometheus metrics
+*/
+
+#include <moveit/task_constructor/metrics.h>
+#include <moveit/task_constructor/task_p.h>
+#include <moveit/task_constructor/solvers/planner_interface.h>
+#include <ros/console.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+const std::pair<double, const char*> QUANTILES[] = { { 0.5, "0.5" }, { 0.9, "0.9" }, { 0.99, "0.99" } };
+
+void writeEscaped(std::ostream& os, const std::string& s) {
+	for (char c : s) {
+		if (c == '"' || c == '\\')
+			os << '\\' << c;
+		else if (c == '\n')
+			os << "\\n";
+		else
+			os << c;
+	}
+}
+
+struct Labels
+{
+	std::vector<std::pair<const char*, std::string>> pairs;
+
+	Labels& add(const char* name, const std::string& value) {
+		pairs.emplace_back(name, value);
+		return *this;
+	}
+};
+
+std::ostream& operator<<(std::ostream& os, const Labels& labels) {
+	if (labels.pairs.empty())
+		return os;
+	const char* sep = "{";
+	for (const auto& pair : labels.pairs) {
+		os << sep << pair.first << "=\"";
+		writeEscaped(os, pair.second);
+		os << '"';
+		sep = ",";
+	}
+	return os << '}';
+}
+
+void writeHeader(std::ostream& os, const char* name, const char* type, const char* help) {
+	os << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+}
+
+void writeSample(std::ostream& os, const char* name, const Labels& labels, double value) {
+	os << name << labels << ' ' << value << '\n';
+}
+
+// summary of histogram: quantiles, _sum, and _count
+void writeSummary(std::ostream& os, const char* name, const Labels& labels, const LatencyHistogram& histogram) {
+	for (const auto& q : QUANTILES) {
+		Labels quantile = labels;
+		writeSample(os, name, quantile.add("quantile", q.second), histogram.quantile(q.first));
+	}
+	os << name << "_sum" << labels << ' ' << histogram.sum() << '\n';
+	os << name << "_count" << labels << ' ' << histogram.count() << '\n';
+}
+
+struct StageEntry
+{
+	const Stage* stage;
+	Labels labels;
+};
+}  // namespace
+
+MetricsExporter::MetricsExporter(Task& task, unsigned short port, double rate, const std::string& address)
+  : task_(task)
+  , period_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(rate > 0.0 ? 1.0 / rate : 0.0))) {
+	update();
+	callback_ = task_.addTaskCallback([this](const Task& /*task*/) {
+		if (std::chrono::steady_clock::now() >= next_update_)
+			update();
+	});
+	if (port == 0)
+		return;
+
+	sockaddr_in endpoint{};
+	endpoint.sin_family = AF_INET;
+	endpoint.sin_port = htons(port);
+	if (::inet_pton(AF_INET, address.c_str(), &endpoint.sin_addr) != 1) {
+		task_.eraseTaskCallback(callback_);
+		throw std::runtime_error("Cannot serve metrics: invalid IPv4 address '" + address + "'");
+	}
+	socket_ = ::socket(AF_INET, SOCK_STREAM, 0);
+	int reuse = 1;
+	if (socket_ < 0 || ::setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+	    ::bind(socket_, reinterpret_cast<sockaddr*>(&endpoint), sizeof(endpoint)) != 0 || ::listen(socket_, 4) != 0) {
+		const std::string error = std::strerror(errno);
+		if (socket_ >= 0)
+			::close(socket_);
+		task_.eraseTaskCallback(callback_);
+		throw std::runtime_error("Cannot serve metrics on " + address + ":" + std::to_string(port) + ": " + error);
+	}
+	port_ = port;
+	server_thread_ = std::thread(&MetricsExporter::serve, this);
+}
+
+MetricsExporter::~MetricsExporter() {
+	task_.eraseTaskCallback(callback_);
+	stop_ = true;
+	if (server_thread_.joinable())
+		server_thread_.join();
+	if (socket_ >= 0)
+		::close(socket_);
+}
+
+void MetricsExporter::update() {
+	std::ostringstream os;
+	write(os, task_);
+	next_update_ = std::chrono::steady_clock::now() + period_;
+	std::lock_guard<std::mutex> lock(text_mutex_);
+	text_ = os.str();
+}
+
+std::string MetricsExporter::text() const {
+	std::lock_guard<std::mutex> lock(text_mutex_);
+	return text_;
+}
+
+void MetricsExporter::serve() {
+	pollfd fd{ socket_, POLLIN, 0 };
+	while (!stop_) {
+		if (::poll(&fd, 1, 100) <= 0)  // regularly check for stop_
+			continue;
+		int client = ::accept(socket_, nullptr, nullptr);
+		if (client < 0)
+			continue;
+		// any request is answered with the metrics: consume (the start of) it, but don't parse it
+		char request[1024];
+		pollfd client_fd{ client, POLLIN, 0 };
+		if (::poll(&client_fd, 1, 1000) > 0)
+			::recv(client, request, sizeof(request), 0);
+
+		const std::string body = text();
+		std::ostringstream response;
+		response << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " << body.size()
+		         << "\r\nConnection: close\r\n\r\n"
+		         << body;
+		const std::string data = response.str();
+		for (size_t sent = 0; sent < data.size();) {
+			ssize_t n = ::send(client, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0)
+				break;
+			sent += n;
+		}
+		::close(client);
+	}
+}
+
+void MetricsExporter::write(std::ostream& os, const Task& task) {
+	// stages labeled by their path within the task
+	std::vector<StageEntry> stages;
+	std::vector<std::string> path;
+	std::set<solvers::PlannerInterfaceConstPtr> planners;
+	task.stages()->traverseRecursively([&](const Stage& stage, unsigned int depth) {
+		path.resize(depth);
+		path.push_back(stage.name());
+		std::string name = path.front();
+		for (size_t i = 1; i < path.size(); ++i)
+			name += "/" + path[i];
+		stages.push_back(StageEntry{ &stage, Labels().add("task", task.name()).add("stage", name) });
+		for (const auto& planner : stage.planners())
+			if (planner)
+				planners.insert(planner);
+		return true;
+	});
+
+	writeHeader(os, "mtc_stage_solutions", "gauge", "Number of solutions stored by the stage");
+	for (const StageEntry& e : stages)
+		writeSample(os, "mtc_stage_solutions", e.labels, e.stage->solutions().size());
+	writeHeader(os, "mtc_stage_solutions_found_total", "counter", "Number of solutions found by the stage");
+	for (const StageEntry& e : stages)
+		writeSample(os, "mtc_stage_solutions_found_total", e.labels, e.stage->solutionLatency().count());
+	writeHeader(os, "mtc_stage_failures_total", "counter", "Number of failures of the stage");
+	for (const StageEntry& e : stages)
+		writeSample(os, "mtc_stage_failures_total", e.labels, e.stage->numFailures());
+	// failureReasons() are bounded per stage, keeping the number of label values small
+	const std::string reasons_help = "Number of failures of the stage per reason (only counted if failures are stored, "
+	                                 "further reasons beyond " +
+	                                 std::to_string(StagePrivate::MAX_FAILURE_REASONS) + " are counted as 'other')";
+	writeHeader(os, "mtc_stage_failure_reasons_total", "counter", reasons_help.c_str());
+	for (const StageEntry& e : stages)
+		for (const auto& reason : e.stage->failureReasons()) {
+			Labels labels = e.labels;
+			writeSample(os, "mtc_stage_failure_reasons_total", labels.add("reason", reason.first), reason.second);
+		}
+	writeHeader(os, "mtc_stage_compute_seconds", "summary", "Durations of compute() calls of the stage");
+	for (const StageEntry& e : stages)
+		writeSummary(os, "mtc_stage_compute_seconds", e.labels, e.stage->computeLatency());
+	writeHeader(os, "mtc_stage_solution_seconds", "summary", "Compute time of the stage per found solution");
+	for (const StageEntry& e : stages)
+		writeSummary(os, "mtc_stage_solution_seconds", e.labels, e.stage->solutionLatency());
+	if (Stage::memoryAccounting()) {
+		writeHeader(os, "mtc_stage_memory_bytes", "gauge", "Estimated memory of objects created by the stage");
+		for (const StageEntry& e : stages) {
+			const MemoryUsage memory = e.stage->memoryUsage();
+			const std::pair<const char*, size_t> kinds[] = {
+				{ "states", memory.states },
+				{ "scenes", memory.scenes },
+				{ "trajectories", memory.trajectories },
+				{ "markers", memory.markers },
+			};
+			for (const auto& kind : kinds) {
+				Labels labels = e.labels;
+				writeSample(os, "mtc_stage_memory_bytes", labels.add("kind", kind.first), kind.second);
+			}
+		}
+	}
+
+	// planner instances might be shared between stages: aggregate per (group, planner id)
+	solvers::PlannerInterface::Statistics stats;
+	for (const auto& planner : planners) {
+		for (const auto& pair : planner->statistics()) {
+			auto& s = stats[pair.first];
+			s.calls += pair.second.calls;
+			s.successes += pair.second.successes;
+			s.planning_time.merge(pair.second.planning_time);
+		}
+	}
+	auto plannerLabels = [&task](const solvers::PlannerInterface::StatisticsKey& key) {
+		return Labels().add("task", task.name()).add("group", key.first).add("planner", key.second);
+	};
+	writeHeader(os, "mtc_planner_calls_total", "counter", "Number of planner calls");
+	for (const auto& pair : stats)
+		writeSample(os, "mtc_planner_calls_total", plannerLabels(pair.first), pair.second.calls);
+	writeHeader(os, "mtc_planner_successes_total", "counter", "Number of successful planner calls");
+	for (const auto& pair : stats)
+		writeSample(os, "mtc_planner_successes_total", plannerLabels(pair.first), pair.second.successes);
+	writeHeader(os, "mtc_planner_seconds", "summary", "Durations of planner calls");
+	for (const auto& pair : stats)
+		writeSummary(os, "mtc_planner_seconds", plannerLabels(pair.first), pair.second.planning_time);
+
+	if (const Introspection* introspection = task.pimpl()->introspection_.get()) {
+		writeHeader(os, "mtc_introspection_publish_seconds", "summary",
+		            "Time spent by the planning thread to publish task states and solutions");
+		writeSummary(os, "mtc_introspection_publish_seconds", Labels().add("task", task.name()),
+		             introspection->publishLatency());
+	}
+}
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,110 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    structure-of-arrays batch of pose candidates, filtered by pose generators before spawning states
+*/
+
+#include <moveit/task_constructor/pose_candidates.h>
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+namespace moveit {
+namespace task_constructor {
+
+void PoseCandidates::reserve(size_t n) {
+	poses_.reserve(n);
+	scores_.reserve(n);
+	parents_.reserve(n);
+}
+
+void PoseCandidates::clear() {
+	poses_.clear();
+	scores_.clear();
+	parents_.clear();
+}
+
+void PoseCandidates::add(const Eigen::Isometry3d& pose, double score, uint32_t parent) {
+	poses_.push_back(pose);
+	scores_.push_back(score);
+	parents_.push_back(parent);
+}
+
+void PoseCandidates::transform(const Eigen::Isometry3d& tf, const std::string& frame) {
+	for (Eigen::Isometry3d& pose : poses_)
+		pose = tf * pose;
+	frame_ = frame;
+}
+
+size_t PoseCandidates::retain(const std::vector<uint8_t>& mask) {
+	assert(mask.size() == size());
+	size_t kept = 0;
+	for (size_t i = 0; i != mask.size(); ++i) {
+		if (!mask[i])
+			continue;
+		if (kept != i) {
+			poses_[kept] = poses_[i];
+			scores_[kept] = scores_[i];
+			parents_[kept] = parents_[i];
+		}
+		++kept;
+	}
+	const size_t removed = size() - kept;
+	poses_.resize(kept);
+	scores_.resize(kept);
+	parents_.resize(kept);
+	return removed;
+}
+
+size_t PoseCandidates::retain(const std::function<bool(size_t index)>& predicate) {
+	std::vector<uint8_t> mask(size());
+	for (size_t i = 0; i != mask.size(); ++i)
+		mask[i] = predicate(i);
+	return retain(mask);
+}
+
+void PoseCandidates::sortByScore() {
+	std::vector<size_t> order(size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return scores_[a] < scores_[b]; });
+
+	PoseCandidates sorted(frame_);
+	sorted.reserve(size());
+	for (size_t i : order)
+		sorted.add(poses_[i], scores_[i], parents_[i]);
+	*this = std::move(sorted);
+}
+}  // namespace task_constructor
+}  // namespace moveit
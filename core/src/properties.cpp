@@ -38,6 +38,7 @@
 
 #include <moveit/task_constructor/properties.h>
 #include <boost/format.hpp>
+#include <atomic>
 #include <functional>
 #include <ros/console.h>
 
@@ -53,6 +54,9 @@ class PropertyTypeRegistry
 		std::string name_;
 		PropertySerializerBase::SerializeFunction serialize_;
 		PropertySerializerBase::DeserializeFunction deserialize_;
+		PropertySerializerBase::AssignFunction assign_;
+		PropertySerializerBase::BinarySerializeFunction serialize_binary_;
+		PropertySerializerBase::BinaryDeserializeFunction deserialize_binary_;
 	};
 	Entry dummy_;
 
@@ -65,11 +69,20 @@ class PropertyTypeRegistry
 
 public:
 	PropertyTypeRegistry()
-	  : dummy_{ "", PropertySerializerBase::dummySerialize, PropertySerializerBase::dummyDeserialize } {}
+	  : dummy_{ "", PropertySerializerBase::dummySerialize, PropertySerializerBase::dummyDeserialize, nullptr, nullptr,
+	            nullptr } {}
 	inline bool insert(const std::type_index& type_index, const std::string& type_name,
 	                   PropertySerializerBase::SerializeFunction serialize,
-	                   PropertySerializerBase::DeserializeFunction deserialize);
+	                   PropertySerializerBase::DeserializeFunction deserialize,
+	                   PropertySerializerBase::AssignFunction assign,
+	                   PropertySerializerBase::BinarySerializeFunction serialize_binary,
+	                   PropertySerializerBase::BinaryDeserializeFunction deserialize_binary);
 
+	/// in-place assignment function for given type (nullptr if not available)
+	PropertySerializerBase::AssignFunction assignFunction(const std::type_index& type_index) const {
+		auto it = types_.find(type_index);
+		return it == types_.end() ? nullptr : it->second.assign_;
+	}
 	const Entry& entry(const std::type_index& type_index) const {
 		auto it = types_.find(type_index);
 		if (it == types_.end()) {
@@ -87,13 +100,28 @@ public:
 };
 static PropertyTypeRegistry REGISTRY_SINGLETON;
 
+// assign source to target, reusing target's storage if it already holds the same type
+static void assign(boost::any& target, const boost::any& source) {
+	if (!source.empty() && !target.empty() && source.type() == target.type()) {
+		if (auto assign_fn = REGISTRY_SINGLETON.assignFunction(source.type())) {
+			assign_fn(target, source);
+			return;
+		}
+	}
+	target = source;
+}
+
 bool PropertyTypeRegistry::insert(const std::type_index& type_index, const std::string& type_name,
                                   PropertySerializerBase::SerializeFunction serialize,
-                                  PropertySerializerBase::DeserializeFunction deserialize) {
+                                  PropertySerializerBase::DeserializeFunction deserialize,
+                                  PropertySerializerBase::AssignFunction assign,
+                                  PropertySerializerBase::BinarySerializeFunction serialize_binary,
+                                  PropertySerializerBase::BinaryDeserializeFunction deserialize_binary) {
 	if (type_index == std::type_index(typeid(boost::any)))
 		return false;
 
-	auto it_inserted = types_.insert(std::make_pair(type_index, Entry{ type_name, serialize, deserialize }));
+	auto it_inserted = types_.insert(std::make_pair(
+	    type_index, Entry{ type_name, serialize, deserialize, assign, serialize_binary, deserialize_binary }));
 	if (!it_inserted.second)
 		return false;  // was already registered before
 
@@ -105,8 +133,12 @@ bool PropertyTypeRegistry::insert(const std::type_index& type_index, const std::
 
 bool PropertySerializerBase::insert(const std::type_index& type_index, const std::string& type_name,
                                     PropertySerializerBase::SerializeFunction serialize,
-                                    PropertySerializerBase::DeserializeFunction deserialize) {
-	return REGISTRY_SINGLETON.insert(type_index, type_name, serialize, deserialize);
+                                    PropertySerializerBase::DeserializeFunction deserialize,
+                                    PropertySerializerBase::AssignFunction assign,
+                                    PropertySerializerBase::BinarySerializeFunction serialize_binary,
+                                    PropertySerializerBase::BinaryDeserializeFunction deserialize_binary) {
+	return REGISTRY_SINGLETON.insert(type_index, type_name, serialize, deserialize, assign, serialize_binary,
+	                                 deserialize_binary);
 }
 
 Property::Property(const type_info& type_info, const std::string& description, const boost::any& default_value)
@@ -118,25 +150,39 @@ Property::Property(const type_info& type_info, const std::string& description, c
 
 Property::Property() : Property(typeid(boost::any), "", boost::any()) {}
 
+void Property::checkType(const boost::any& value) const {
+	if (!value.empty() && type_info_ != typeid(boost::any) && value.type() != type_info_)
+		throw Property::type_error(value.type().name(), type_info_.name());
+}
+
 void Property::setValue(const boost::any& value) {
 	setCurrentValue(value);
-	default_ = value_;
+	assign(default_, value_);
+	initialized_from_ = 0;
+}
+
+void Property::setValue(boost::any&& value) {
+	checkType(value);
+	assign(default_, value);
+	value_ = std::move(value);
 	initialized_from_ = 0;
 }
 
 void Property::setCurrentValue(const boost::any& value) {
-	if (!value.empty() && type_info_ != typeid(boost::any) && value.type() != type_info_)
-		throw Property::type_error(value.type().name(), type_info_.name());
+	checkType(value);
+	assign(value_, value);
+	initialized_from_ = 1;  // manually initialized TODO: use enums
+}
 
-	value_ = value;
+void Property::setCurrentValue(boost::any&& value) {
+	checkType(value);
+	value_ = std::move(value);
 	initialized_from_ = 1;  // manually initialized TODO: use enums
 }
 
 void Property::setDefaultValue(const boost::any& value) {
-	if (!value.empty() && type_info_ != typeid(boost::any) && value.type() != type_info_)
-		throw Property::type_error(value.type().name(), type_info_.name());
-
-	default_ = value;
+	checkType(value);
+	assign(default_, value);
 }
 
 void Property::reset() {
@@ -159,6 +205,28 @@ boost::any Property::deserialize(const std::string& type_name, const std::string
 		return REGISTRY_SINGLETON.entry(type_name).deserialize_(wire);
 }
 
+bool Property::serializeBinary(const boost::any& value, std::vector<uint8_t>& data) {
+	if (value.empty())
+		return false;
+	auto fn = REGISTRY_SINGLETON.entry(value.type()).serialize_binary_;
+	if (!fn)
+		return false;
+	fn(value, data);
+	return true;
+}
+
+boost::any Property::deserializeBinary(const std::string& type_name, const std::vector<uint8_t>& data) {
+	auto fn = REGISTRY_SINGLETON.entry(type_name).deserialize_binary_;
+	if (!fn || data.empty())
+		return boost::any();
+	try {
+		return fn(data);
+	} catch (const ros::serialization::StreamOverrunException& e) {
+		ROS_WARN_STREAM_NAMED(LOGNAME, "Failed to deserialize binary value of type " << type_name << ": " << e.what());
+		return boost::any();
+	}
+}
+
 std::string Property::typeName() const {
 	if (value().empty())
 		return typeName(type_info_);
@@ -183,15 +251,24 @@ Property& Property::configureInitFrom(SourceFlags source, const Property::Initia
 
 	source_flags_ = f ? source : SourceFlags();
 	initializer_ = f;
+	initializer_name_.clear();
 	return *this;
 }
 
 Property& Property::configureInitFrom(SourceFlags source, const std::string& name) {
-	return configureInitFrom(source, [name](const PropertyMap& other) { return fromName(other, name); });
+	configureInitFrom(source, [name](const PropertyMap& other) { return fromName(other, name); });
+	initializer_name_ = name;
+	return *this;
+}
+
+void PropertyMap::touch() {
+	static std::atomic<uint64_t> last_version{ 0 };
+	version_ = ++last_version;
 }
 
 Property& PropertyMap::declare(const std::string& name, const Property::type_info& type_info,
                                const std::string& description, const boost::any& default_value) {
+	touch();
 	auto it_inserted = props_.insert(std::make_pair(name, Property(type_info, description, default_value)));
 	// if name was already declared, the new declaration should match in type (except it was boost::any)
 	if (!it_inserted.second && it_inserted.first->second.type_info_ != typeid(boost::any) &&
@@ -200,12 +277,25 @@ Property& PropertyMap::declare(const std::string& name, const Property::type_inf
 	return it_inserted.first->second;
 }
 
+void PropertyMap::checkType(const Property& property, const Property::type_info& type_info) {
+	if (property.type_info_ != typeid(boost::any) && property.type_info_ != type_info)
+		throw Property::type_error(type_info.name(), property.type_info_.name());
+}
+
 bool PropertyMap::hasProperty(const std::string& name) const {
 	auto it = props_.find(name);
 	return it != props_.end();
 }
 
 Property& PropertyMap::property(const std::string& name) {
+	auto it = props_.find(name);
+	if (it == props_.end())
+		throw Property::undeclared(name);
+	touch();  // the property might be modified via the returned reference
+	return it->second;
+}
+
+const Property& PropertyMap::property(const std::string& name) const {
 	auto it = props_.find(name);
 	if (it == props_.end())
 		throw Property::undeclared(name);
@@ -223,10 +313,11 @@ void PropertyMap::exposeTo(PropertyMap& other, const std::string& name, const st
 }
 
 void PropertyMap::configureInitFrom(Property::SourceFlags source, const std::set<std::string>& properties) {
+	touch();
 	for (auto& pair : props_) {
 		if (properties.empty() || properties.count(pair.first))
 			try {
-				pair.second.configureInitFrom(source, std::bind(&fromName, std::placeholders::_1, pair.first));
+				pair.second.configureInitFrom(source, pair.first);
 			} catch (Property::error& e) {
 				e.setName(pair.first);
 				throw;
@@ -244,6 +335,7 @@ void PropertyMap::set<boost::any>(const std::string& name, const boost::any& val
 		it->second.setValue(value);
 	} else
 		range.first->second.setValue(value);
+	touch();
 }
 
 void PropertyMap::setCurrent(const std::string& name, const boost::any& value) {
@@ -264,11 +356,19 @@ size_t PropertyMap::countDefined(const std::vector<std::string>& list) const {
 }
 
 void PropertyMap::reset() {
+	touch();
 	for (auto& pair : props_)
 		pair.second.reset();
 }
 
 void PropertyMap::performInitFrom(Property::SourceFlags source, const PropertyMap& other) {
+	// same inputs yield the same result
+	if (version_ != 0 && last_init_.source == source && last_init_.other == other.version_ &&
+	    last_init_.result == version_)
+		return;
+
+	// renew version before any modification: an exception shouldn't leave a stale version
+	touch();
 	for (auto& pair : props_) {
 		Property& p = pair.second;
 
@@ -280,6 +380,18 @@ void PropertyMap::performInitFrom(Property::SourceFlags source, const PropertyMa
 		if (!p.initsFrom(source))
 			continue;
 
+		if (!p.initializer_name_.empty()) {  // initialized by name: copy other's value w/o temporary
+			auto it = other.props_.find(p.initializer_name_);
+			if (it == other.props_.end())
+				continue;  // ignore undeclared
+			const boost::any& value = it->second.value();
+			ROS_DEBUG_STREAM_NAMED(LOGNAME, pair.first << ": " << p.initialized_from_ << " -> " << source << ": "
+			                                           << Property::serialize(value));
+			p.setCurrentValue(value);
+			p.initialized_from_ = source;
+			continue;
+		}
+
 		boost::any value;
 		try {
 			value = p.initializer_(other);
@@ -291,9 +403,10 @@ void PropertyMap::performInitFrom(Property::SourceFlags source, const PropertyMa
 
 		ROS_DEBUG_STREAM_NAMED(LOGNAME, pair.first << ": " << p.initialized_from_ << " -> " << source << ": "
 		                                           << Property::serialize(value));
-		p.setCurrentValue(value);
+		p.setCurrentValue(std::move(value));
 		p.initialized_from_ = source;
 	}
+	last_init_ = InitStamp{ source, other.version_, version_ };
 }
 
 boost::any fromName(const PropertyMap& other, const std::string& other_name) {
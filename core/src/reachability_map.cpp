@@ -0,0 +1,223 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    voxelized reachability map of a link, used to reject out-of-reach IK targets early
+*/
+
+#include <moveit/task_constructor/reachability_map.h>
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <random_numbers/random_numbers.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+constexpr char MAGIC[8] = { 'M', 'T', 'C', 'R', 'E', 'A', 'C', 'H' };
+constexpr uint32_t VERSION = 1;
+
+// fixed-size part of the file, followed by group and link names, and the cells
+struct Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t dims[3];
+	double origin[3];
+	double resolution;
+	uint32_t group_length;
+	uint32_t link_length;
+};
+}  // namespace
+
+const moveit::core::LinkModel* ReachabilityMap::rootLink(const moveit::core::JointModelGroup* jmg) {
+	const moveit::core::LinkModel* root = jmg->getCommonRoot()->getParentLinkModel();
+	return root ? root : jmg->getParentModel().getRootLink();
+}
+
+ReachabilityMapPtr ReachabilityMap::generate(const moveit::core::JointModelGroup* jmg,
+                                             const moveit::core::LinkModel* link, double resolution,
+                                             size_t num_samples, unsigned int seed) {
+	if (resolution <= 0.0 || num_samples == 0)
+		throw std::runtime_error("ReachabilityMap: resolution and num_samples need to be positive");
+
+	// link positions of random configurations, w.r.t. the root link
+	moveit::core::RobotState state(jmg->getParentModel().shared_from_this());
+	state.setToDefaultValues();
+	random_numbers::RandomNumberGenerator rng(seed);
+	const moveit::core::LinkModel* root = rootLink(jmg);
+	std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d>> positions;
+	positions.reserve(num_samples);
+	Eigen::Vector3d lower = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+	Eigen::Vector3d upper = -lower;
+	for (size_t i = 0; i != num_samples; ++i) {
+		state.setToRandomPositions(jmg, rng);
+		state.updateLinkTransforms();
+		const Eigen::Isometry3d& root_tf = state.getGlobalLinkTransform(root);
+		positions.push_back(root_tf.inverse() * state.getGlobalLinkTransform(link).translation());
+		lower = lower.cwiseMin(positions.back());
+		upper = upper.cwiseMax(positions.back());
+	}
+
+	ReachabilityMapPtr map(new ReachabilityMap());
+	map->group_ = jmg->getName();
+	map->link_ = link->getName();
+	map->resolution_ = resolution;
+	map->origin_ = lower;
+	for (int d = 0; d != 3; ++d)
+		map->dims_[d] = static_cast<uint32_t>(std::floor((upper[d] - lower[d]) / resolution + 0.5)) + 1;
+
+	std::vector<uint32_t> counts(map->size(), 0);
+	auto index = [&map](const Eigen::Vector3d& p) {
+		size_t result = 0;
+		for (int d = 2; d >= 0; --d) {
+			const auto i = static_cast<uint32_t>(std::floor((p[d] - map->origin_[d]) / map->resolution_ + 0.5));
+			result = result * map->dims_[d] + std::min(i, map->dims_[d] - 1);
+		}
+		return result;
+	};
+	for (const Eigen::Vector3d& p : positions)
+		++counts[index(p)];
+
+	// normalize w.r.t. the most often reached voxel, keeping any reached voxel non-zero
+	const double max_count = *std::max_element(counts.begin(), counts.end());
+	map->owned_.resize(counts.size());
+	for (size_t i = 0; i != counts.size(); ++i)
+		map->owned_[i] = static_cast<uint8_t>(counts[i] ? std::max(1l, std::lround(255 * counts[i] / max_count)) : 0);
+	map->cells_ = map->owned_.data();
+	return map;
+}
+
+ReachabilityMapPtr ReachabilityMap::load(const std::string& path) {
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("ReachabilityMap: cannot open '" + path + "'");
+	struct stat info;
+	const bool valid = ::fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(Header);
+	void* mapping = valid ? ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		throw std::runtime_error("ReachabilityMap: cannot map '" + path + "'");
+
+	ReachabilityMapPtr map(new ReachabilityMap());
+	map->mapping_ = mapping;
+	map->mapping_size_ = info.st_size;
+
+	Header header;
+	const auto* data = static_cast<const uint8_t*>(mapping);
+	std::memcpy(&header, data, sizeof(Header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+		throw std::runtime_error("ReachabilityMap: '" + path + "' is not a reachability map");
+	size_t offset = sizeof(Header);
+	if (offset + header.group_length + header.link_length > map->mapping_size_)
+		throw std::runtime_error("ReachabilityMap: '" + path + "' is truncated");
+	map->group_.assign(reinterpret_cast<const char*>(data + offset), header.group_length);
+	offset += header.group_length;
+	map->link_.assign(reinterpret_cast<const char*>(data + offset), header.link_length);
+	offset += header.link_length;
+
+	for (int d = 0; d != 3; ++d) {
+		map->dims_[d] = header.dims[d];
+		map->origin_[d] = header.origin[d];
+	}
+	map->resolution_ = header.resolution;
+	if (map->resolution_ <= 0.0 || offset + map->size() > map->mapping_size_)
+		throw std::runtime_error("ReachabilityMap: '" + path + "' is truncated");
+	map->cells_ = data + offset;
+	return map;
+}
+
+void ReachabilityMap::save(const std::string& path) const {
+	Header header;
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	for (int d = 0; d != 3; ++d) {
+		header.dims[d] = dims_[d];
+		header.origin[d] = origin_[d];
+	}
+	header.resolution = resolution_;
+	header.group_length = group_.size();
+	header.link_length = link_.size();
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	file.write(group_.data(), group_.size());
+	file.write(link_.data(), link_.size());
+	file.write(reinterpret_cast<const char*>(cells_), size());
+	if (!file)
+		throw std::runtime_error("ReachabilityMap: failed to write '" + path + "'");
+}
+
+ReachabilityMap::~ReachabilityMap() {
+	if (mapping_)
+		::munmap(mapping_, mapping_size_);
+}
+
+bool ReachabilityMap::matches(const moveit::core::JointModelGroup* jmg, const moveit::core::LinkModel* link) const {
+	return jmg->getName() == group_ && link->getName() == link_;
+}
+
+bool ReachabilityMap::contains(const Eigen::Vector3d& position) const {
+	for (int d = 0; d != 3; ++d) {
+		const double i = std::floor((position[d] - origin_[d]) / resolution_ + 0.5);
+		if (i < -1 || i > dims_[d])
+			return false;
+	}
+	return true;
+}
+
+double ReachabilityMap::score(const Eigen::Vector3d& position) const {
+	size_t index = 0;
+	for (int d = 2; d >= 0; --d) {
+		const double i = std::floor((position[d] - origin_[d]) / resolution_ + 0.5);
+		if (i < 0 || i >= dims_[d])
+			return 0.0;  // outside of the map
+		index = index * dims_[d] + static_cast<size_t>(i);
+	}
+	return cells_[index] / 255.0;
+}
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,247 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Record and deterministically replay planning runs
+*/
+
+#include <moveit/task_constructor/recording.h>
+#include <moveit/task_constructor/task.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <ros/serialization.h>
+#include <ros/console.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+const std::string FILE_MAGIC = "MTC_PLANNING_RECORD_1";
+// per thread, such that concurrently planned tasks record independently
+thread_local PlanningRecord* active_record = nullptr;
+
+std::vector<moveit_task_constructor_msgs::StageDescription> describeStages(const Task& task) {
+	std::vector<moveit_task_constructor_msgs::StageDescription> stages;
+	task.stages()->traverseRecursively([&stages](const Stage& stage, unsigned int /*depth*/) {
+		moveit_task_constructor_msgs::StageDescription desc;
+		desc.id = stages.size();
+		desc.name = stage.name();
+		for (const auto& pair : stage.properties()) {
+			moveit_task_constructor_msgs::Property p;
+			p.name = pair.first;
+			p.type = pair.second.typeName();
+			p.value = pair.second.serialize();
+			desc.properties.push_back(std::move(p));
+		}
+		stages.push_back(std::move(desc));
+		return true;
+	});
+	return stages;
+}
+}  // namespace
+
+PlanningRecord::Activation::Activation(PlanningRecord* record) : previous_(active_record) {
+	if (previous_ && record && previous_ != record)
+		ROS_WARN_NAMED("PlanningRecord", "replacing active planning record");
+	active_record = record;
+}
+
+PlanningRecord::Activation::~Activation() {
+	active_record = previous_;
+}
+
+PlanningRecord::PlanningRecord(uint32_t seed) : mode_(RECORD) {
+	msg_.seed = seed;
+}
+
+PlanningRecord::PlanningRecord(moveit_task_constructor_msgs::PlanningRecord msg)
+  : mode_(REPLAY), msg_(std::move(msg)) {
+	rewind();
+}
+
+PlanningRecord* PlanningRecord::active() {
+	return active_record;
+}
+
+void PlanningRecord::rewind() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	pending_.clear();
+	for (size_t i = 0; i < msg_.responses.size(); ++i) {
+		const auto& r = msg_.responses[i];
+		pending_[std::make_pair(r.group, r.planner_id)].push_back(i);
+	}
+}
+
+void PlanningRecord::recordScene(const std::string& stage, const planning_scene::PlanningScene& scene) {
+	moveit_msgs::PlanningScene scene_msg;
+	scene.getPlanningSceneMsg(scene_msg);
+	std::lock_guard<std::mutex> lock(mutex_);
+	msg_.scene_stages.push_back(stage);
+	msg_.scenes.push_back(std::move(scene_msg));
+}
+
+planning_scene::PlanningScenePtr
+PlanningRecord::replayScene(const std::string& stage, const moveit::core::RobotModelConstPtr& robot_model) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = std::find(msg_.scene_stages.cbegin(), msg_.scene_stages.cend(), stage);
+	if (it == msg_.scene_stages.cend() || static_cast<size_t>(it - msg_.scene_stages.cbegin()) >= msg_.scenes.size())
+		return nullptr;
+	auto scene = std::make_shared<planning_scene::PlanningScene>(robot_model);
+	scene->setPlanningSceneMsg(msg_.scenes[it - msg_.scene_stages.cbegin()]);
+	return scene;
+}
+
+void PlanningRecord::recordProperties(const Task& task) {
+	auto stages = describeStages(task);
+	std::lock_guard<std::mutex> lock(mutex_);
+	msg_.stages = std::move(stages);
+}
+
+size_t PlanningRecord::checkProperties(const Task& task) const {
+	const auto stages = describeStages(task);
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (stages.size() != msg_.stages.size()) {
+		ROS_WARN_STREAM_NAMED("PlanningRecord", "task has " << stages.size() << " stages, but recording has "
+		                                                    << msg_.stages.size());
+		return 1;
+	}
+
+	size_t differences = 0;
+	for (size_t i = 0; i < stages.size(); ++i) {
+		const auto& current = stages[i];
+		const auto& recorded = msg_.stages[i];
+		if (current.name != recorded.name) {
+			ROS_WARN_STREAM_NAMED("PlanningRecord", "stage '" << current.name << "' was recorded as '" << recorded.name
+			                                                    << "'");
+			++differences;
+			continue;
+		}
+		std::map<std::string, const moveit_task_constructor_msgs::Property*> recorded_properties;
+		for (const auto& p : recorded.properties)
+			recorded_properties[p.name] = &p;
+		for (const auto& p : current.properties) {
+			auto it = recorded_properties.find(p.name);
+			if (it != recorded_properties.end() && it->second->type == p.type && it->second->value == p.value)
+				continue;
+			ROS_WARN_STREAM_NAMED("PlanningRecord", "property '" << p.name << "' of stage '" << current.name
+			                                                       << "' differs from recording");
+			++differences;
+		}
+	}
+	return differences;
+}
+
+void PlanningRecord::recordResponse(const std::string& planner_id, const moveit::core::JointModelGroup* jmg,
+                                    bool success, const robot_trajectory::RobotTrajectoryConstPtr& trajectory) {
+	moveit_task_constructor_msgs::PlannerResponse response;
+	response.group = jmg ? jmg->getName() : std::string();
+	response.planner_id = planner_id;
+	response.success = success;
+	if (trajectory)
+		trajectory->getRobotTrajectoryMsg(response.trajectory);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	msg_.responses.push_back(std::move(response));
+}
+
+bool PlanningRecord::replayResponse(const std::string& planner_id, const planning_scene::PlanningSceneConstPtr& from,
+                                    const moveit::core::JointModelGroup* jmg, bool& success,
+                                    robot_trajectory::RobotTrajectoryPtr& trajectory) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = pending_.find(std::make_pair(jmg ? jmg->getName() : std::string(), planner_id));
+	if (it == pending_.end() || it->second.empty())
+		return false;
+	const auto& response = msg_.responses[it->second.front()];
+	it->second.pop_front();
+	lock.unlock();  // responses are not modified while replaying
+
+	success = response.success;
+	if (response.trajectory.joint_trajectory.points.empty() &&
+	    response.trajectory.multi_dof_joint_trajectory.points.empty()) {
+		trajectory.reset();
+		return true;
+	}
+	trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(from->getRobotModel(), jmg);
+	trajectory->setRobotTrajectoryMsg(from->getCurrentState(), response.trajectory);
+	return true;
+}
+
+size_t PlanningRecord::pendingResponses() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	size_t pending = 0;
+	for (const auto& pair : pending_)
+		pending += pair.second.size();
+	return pending;
+}
+
+bool PlanningRecord::save(const std::string& file) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::string bytes(ros::serialization::serializationLength(msg_), '\0');
+	ros::serialization::OStream stream(reinterpret_cast<uint8_t*>(&bytes[0]), bytes.size());
+	ros::serialization::serialize(stream, msg_);
+
+	std::ofstream os(file, std::ios::binary);
+	os << FILE_MAGIC;
+	os.write(bytes.data(), bytes.size());
+	if (!os) {
+		ROS_ERROR_STREAM_NAMED("PlanningRecord", "Failed to write planning record to '" << file << "'");
+		return false;
+	}
+	return true;
+}
+
+PlanningRecordPtr PlanningRecord::load(const std::string& file) {
+	std::ifstream is(file, std::ios::binary);
+	std::string bytes((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+	if (bytes.compare(0, FILE_MAGIC.size(), FILE_MAGIC) != 0) {
+		ROS_ERROR_STREAM_NAMED("PlanningRecord", "'" << file << "' is not a planning record file");
+		return nullptr;
+	}
+
+	moveit_task_constructor_msgs::PlanningRecord msg;
+	try {
+		ros::serialization::IStream stream(reinterpret_cast<uint8_t*>(&bytes[FILE_MAGIC.size()]),
+		                                   bytes.size() - FILE_MAGIC.size());
+		ros::serialization::deserialize(stream, msg);
+	} catch (const ros::Exception& e) {
+		ROS_ERROR_STREAM_NAMED("PlanningRecord", "Corrupt planning record file '" << file << "': " << e.what());
+		return nullptr;
+	}
+	return std::make_shared<PlanningRecord>(std::move(msg));
+}
+}  // namespace task_constructor
+}  // namespace moveit
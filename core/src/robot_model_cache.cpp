@@ -0,0 +1,117 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    process-wide cache of robot models loaded from the parameter server
+*/
+
+#include <moveit/task_constructor/robot_model_cache.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+
+#include <ros/node_handle.h>
+#include <ros/console.h>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+struct CachedLoader
+{
+	size_t hash;  // of URDF and SRDF strings
+	robot_model_loader::RobotModelLoaderPtr loader;
+};
+
+struct Cache
+{
+	std::mutex mutex;  // serializes loading, such that concurrent Task constructions load only once
+	std::map<std::string, CachedLoader> loaders;
+};
+
+Cache& cache() {
+	// intentionally leaked: kinematics plugins must not be unloaded during static destruction
+	static Cache* cache = new Cache();
+	return *cache;
+}
+
+// read parameter like rdf_loader does, returning an empty string if not found
+std::string readParam(const ros::NodeHandle& nh, const std::string& name) {
+	std::string resolved, value;
+	if (nh.searchParam(name, resolved))
+		nh.getParam(resolved, value);
+	return value;
+}
+
+size_t descriptionHash(const std::string& robot_description) {
+	ros::NodeHandle nh("~");
+	std::hash<std::string> hasher;
+	const size_t urdf = hasher(readParam(nh, robot_description));
+	const size_t srdf = hasher(readParam(nh, robot_description + "_semantic"));
+	return urdf ^ (srdf + 0x9e3779b9 + (urdf << 6) + (urdf >> 2));
+}
+}  // namespace
+
+robot_model_loader::RobotModelLoaderPtr RobotModelCache::load(const std::string& robot_description) {
+	const size_t hash = descriptionHash(robot_description);
+	Cache& c = cache();
+	std::lock_guard<std::mutex> lock(c.mutex);
+	auto it = c.loaders.find(robot_description);
+	if (it != c.loaders.end() && it->second.hash == hash)
+		return it->second.loader;
+
+	if (it != c.loaders.end())
+		ROS_INFO_STREAM_NAMED("RobotModelCache", "Reloading changed robot model '" << robot_description << "'");
+	auto loader = std::make_shared<robot_model_loader::RobotModelLoader>(robot_description);
+	if (!loader->getModel())
+		throw std::runtime_error("Failed to load robot model from '" + robot_description + "'");
+	c.loaders[robot_description] = CachedLoader{ hash, loader };
+	return loader;
+}
+
+void RobotModelCache::clear() {
+	Cache& c = cache();
+	std::lock_guard<std::mutex> lock(c.mutex);
+	c.loaders.clear();
+}
+
+size_t RobotModelCache::size() {
+	Cache& c = cache();
+	std::lock_guard<std::mutex> lock(c.mutex);
+	return c.loaders.size();
+}
+}  // namespace task_constructor
+}  // namespace moveit
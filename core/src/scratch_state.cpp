@@ -0,0 +1,152 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    thread-local pool of scratch RobotStates
+*/
+
+#include <moveit/task_constructor/scratch_state.h>
+#include <moveit/robot_state/robot_state.h>
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+// idle states kept per thread, limiting the memory (and robot models) retained by a thread
+constexpr size_t MAX_POOLED_STATES = 16;
+
+class StatePool;
+
+// all pools of running threads, such that purge() can reach them
+struct PoolRegistry
+{
+	std::mutex mutex;
+	std::set<StatePool*> pools;
+};
+PoolRegistry& registry() {
+	static PoolRegistry registry;
+	return registry;
+}
+
+// Only purge() accesses a pool from another thread. Hence, locking its mutex is uncontended otherwise.
+class StatePool
+{
+public:
+	StatePool() {
+		idle_.reserve(MAX_POOLED_STATES);
+		PoolRegistry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		r.pools.insert(this);
+	}
+	~StatePool() {
+		PoolRegistry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		r.pools.erase(this);
+	}
+
+	std::unique_ptr<moveit::core::RobotState> lease(const moveit::core::RobotModelConstPtr& robot_model) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		// most recently returned states first
+		for (auto it = idle_.rbegin(); it != idle_.rend(); ++it) {
+			if ((*it)->getRobotModel() != robot_model)
+				continue;
+			std::unique_ptr<moveit::core::RobotState> state = std::move(*it);
+			idle_.erase(std::next(it).base());
+			return state;
+		}
+		return std::make_unique<moveit::core::RobotState>(robot_model);
+	}
+
+	void release(std::unique_ptr<moveit::core::RobotState>&& state) {
+		state->clearAttachedBodies();  // don't retain attached objects
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (idle_.size() == MAX_POOLED_STATES)
+			idle_.erase(idle_.begin());  // drop least recently used state
+		idle_.push_back(std::move(state));
+	}
+
+	size_t size() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return idle_.size();
+	}
+
+	void purge(const moveit::core::RobotModel* robot_model) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		idle_.erase(std::remove_if(idle_.begin(), idle_.end(),
+		                           [robot_model](const std::unique_ptr<moveit::core::RobotState>& state) {
+			                           return state->getRobotModel().get() == robot_model;
+		                           }),
+		            idle_.end());
+	}
+
+private:
+	std::mutex mutex_;
+	std::vector<std::unique_ptr<moveit::core::RobotState>> idle_;
+};
+
+StatePool& pool() {
+	thread_local StatePool pool;
+	return pool;
+}
+}  // namespace
+
+ScratchState::ScratchState(const moveit::core::RobotModelConstPtr& robot_model)
+  : state_(pool().lease(robot_model)) {}
+
+ScratchState::ScratchState(const moveit::core::RobotState& state) : state_(pool().lease(state.getRobotModel())) {
+	*state_ = state;  // copies into the already allocated memory
+}
+
+ScratchState::~ScratchState() {
+	if (state_)  // not moved from
+		pool().release(std::move(state_));
+}
+
+size_t ScratchState::pooled() {
+	return pool().size();
+}
+
+void ScratchState::purge(const moveit::core::RobotModel* robot_model) {
+	PoolRegistry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	for (StatePool* pool : r.pools)
+		pool->purge(robot_model);
+}
+}  // namespace task_constructor
+}  // namespace moveit
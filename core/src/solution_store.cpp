@@ -0,0 +1,389 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Persistent, memory-mapped store of task solutions
+*/
+
+#include <moveit/task_constructor/solution_store.h>
+#include <moveit/task_constructor/task.h>
+#include <ros/serialization.h>
+#include <ros/console.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+constexpr char FILE_MAGIC[8] = { 'M', 'T', 'C', 'S', 'O', 'L', 'S', '1' };
+constexpr size_t TASK_NAME_LENGTH = 64;
+constexpr size_t ALIGNMENT = 8;
+
+// stage names of the sub trajectories of a solution, in the order of its message's sub_trajectory
+void collectStageNames(const SolutionBase& solution, std::vector<std::string>& names) {
+	if (const auto* sequence = dynamic_cast<const SolutionSequence*>(&solution)) {
+		for (const SolutionBase* sub : sequence->solutions())
+			collectStageNames(*sub, names);
+	} else if (const auto* wrapped = dynamic_cast<const WrappedSolution*>(&solution))
+		collectStageNames(*wrapped->wrapped(), names);
+	else
+		names.push_back(solution.creator() ? solution.creator()->name() : std::string());
+}
+
+template <typename Msg>
+std::string serialize(const Msg& msg) {
+	std::string bytes(ros::serialization::serializationLength(msg), '\0');
+	ros::serialization::OStream stream(reinterpret_cast<uint8_t*>(&bytes[0]), bytes.size());
+	ros::serialization::serialize(stream, msg);
+	return bytes;
+}
+
+template <typename Msg>
+void deserialize(const char* bytes, size_t size, Msg& msg) {
+	// IStream only reads, although it requires a non-const pointer
+	ros::serialization::IStream stream(reinterpret_cast<uint8_t*>(const_cast<char*>(bytes)), size);
+	ros::serialization::deserialize(stream, msg);
+}
+
+template <typename T>
+void writePod(std::ostream& os, const T& value) {
+	os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+size_t aligned(size_t size) {
+	return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+struct Header
+{
+	char magic[sizeof(FILE_MAGIC)];
+	uint64_t num_blobs;
+	uint64_t num_solutions;
+	uint64_t num_subs;
+};
+}  // namespace
+
+struct SolutionStore::Blob
+{
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct SolutionStore::SolutionRecord
+{
+	char task[TASK_NAME_LENGTH];
+	double cost;
+	uint64_t solution;
+	uint64_t joint_names;
+	uint64_t joint_positions;
+	uint64_t first_sub;
+	uint64_t num_subs;
+};
+
+struct SolutionStore::SubRecord
+{
+	uint32_t scene;
+	uint32_t stage;
+};
+
+const std::string& SolutionStore::Entry::taskName() const {
+	return store_->task_names_[index_];
+}
+
+double SolutionStore::Entry::cost() const {
+	return store_->solutions_[index_].cost;
+}
+
+double SolutionStore::Entry::distance(const sensor_msgs::JointState& state) const {
+	const SolutionRecord& record = store_->solutions_[index_];
+	size_t names_size, positions_size;
+	const char* names = store_->blobData(record.joint_names, names_size);
+	const auto* positions =
+	    reinterpret_cast<const double*>(store_->blobData(record.joint_positions, positions_size));
+
+	std::map<std::string, double> reference;
+	for (size_t i = 0; i < std::min(state.name.size(), state.position.size()); ++i)
+		reference[state.name[i]] = state.position[i];
+
+	double squared = 0.0;
+	bool common = false;
+	const char* end = names + names_size;
+	for (size_t i = 0; names < end && i < positions_size / sizeof(double); ++i) {
+		const size_t length = strnlen(names, end - names);
+		auto it = reference.find(std::string(names, length));
+		if (it != reference.end()) {
+			squared += std::pow(positions[i] - it->second, 2);
+			common = true;
+		}
+		names += length + 1;
+	}
+	return common ? std::sqrt(squared) : std::numeric_limits<double>::infinity();
+}
+
+std::vector<std::string> SolutionStore::Entry::stages() const {
+	const SolutionRecord& record = store_->solutions_[index_];
+	std::vector<std::string> result;
+	result.reserve(record.num_subs);
+	for (uint64_t i = 0; i != record.num_subs; ++i) {
+		size_t size;
+		const char* name = store_->blobData(store_->subs_[record.first_sub + i].stage, size);
+		result.emplace_back(name, size);
+	}
+	return result;
+}
+
+void SolutionStore::Entry::toMsg(moveit_task_constructor_msgs::Solution& msg) const {
+	const SolutionRecord& record = store_->solutions_[index_];
+	size_t size;
+	const char* bytes = store_->blobData(record.solution, size);
+	deserialize(bytes, size, msg);
+	for (uint64_t i = 0; i != std::min<uint64_t>(record.num_subs, msg.sub_trajectory.size()); ++i) {
+		bytes = store_->blobData(store_->subs_[record.first_sub + i].scene, size);
+		deserialize(bytes, size, msg.sub_trajectory[i].scene_diff);
+	}
+}
+
+uint32_t SolutionStore::Writer::blob(std::string bytes) {
+	auto it = blob_index_.find(bytes);
+	if (it != blob_index_.end())
+		return it->second;
+	const uint32_t index = blobs_.size();
+	blob_index_.emplace(bytes, index);
+	blobs_.push_back(std::move(bytes));
+	return index;
+}
+
+void SolutionStore::Writer::add(const std::string& task_name, const moveit_task_constructor_msgs::Solution& msg,
+                                double cost, const std::vector<std::string>& stages) {
+	Solution s;
+	s.task_name = task_name;
+	s.cost = cost;
+
+	// store scene diffs separately, to share them across solutions
+	moveit_task_constructor_msgs::Solution stripped = msg;
+	for (size_t i = 0; i < stripped.sub_trajectory.size(); ++i) {
+		auto& sub = stripped.sub_trajectory[i];
+		const uint32_t scene = blob(serialize(sub.scene_diff));
+		sub.scene_diff = moveit_msgs::PlanningScene();
+		s.subs.emplace_back(scene, blob(i < stages.size() ? stages[i] : std::string()));
+	}
+	s.solution = blob(serialize(stripped));
+
+	const auto& joints = msg.start_scene.robot_state.joint_state;
+	const size_t num_joints = std::min(joints.name.size(), joints.position.size());
+	std::string names;
+	for (size_t i = 0; i < num_joints; ++i)
+		names.append(joints.name[i]).push_back('\0');
+	s.joint_names = blob(std::move(names));
+	s.joint_positions =
+	    blob(std::string(reinterpret_cast<const char*>(joints.position.data()), num_joints * sizeof(double)));
+	solutions_.push_back(std::move(s));
+}
+
+void SolutionStore::Writer::add(const Task& task, size_t max_solutions) {
+	size_t count = 0;
+	for (const auto& solution : task.solutions()) {
+		if (max_solutions > 0 && count++ >= max_solutions)
+			break;
+		// don't enable the task's introspection: stage names are taken from the solution tree instead
+		moveit_task_constructor_msgs::Solution msg;
+		solution->fillMessage(msg);
+		solution->start()->scene()->getPlanningSceneMsg(msg.start_scene);
+		std::vector<std::string> stages;
+		collectStageNames(*solution, stages);
+		add(task.name(), msg, solution->cost(), stages);
+	}
+}
+
+bool SolutionStore::Writer::write(const std::string& file) const {
+	Header header{};
+	std::copy(FILE_MAGIC, FILE_MAGIC + sizeof(FILE_MAGIC), header.magic);
+	header.num_blobs = blobs_.size();
+	header.num_solutions = solutions_.size();
+	for (const Solution& s : solutions_)
+		header.num_subs += s.subs.size();
+
+	std::ofstream os(file, std::ios::binary);
+	writePod(os, header);
+
+	uint64_t offset = aligned(sizeof(Header) + header.num_blobs * sizeof(Blob) +
+	                          header.num_solutions * sizeof(SolutionRecord) + header.num_subs * sizeof(SubRecord));
+	for (const std::string& bytes : blobs_) {
+		writePod(os, Blob{ offset, bytes.size() });
+		offset += aligned(bytes.size());
+	}
+
+	uint64_t first_sub = 0;
+	for (const Solution& s : solutions_) {
+		if (s.task_name.size() >= TASK_NAME_LENGTH) {
+			ROS_ERROR_STREAM_NAMED("SolutionStore", "task name too long: " << s.task_name);
+			return false;
+		}
+		SolutionRecord record{};
+		std::copy(s.task_name.begin(), s.task_name.end(), record.task);
+		record.cost = s.cost;
+		record.solution = s.solution;
+		record.joint_names = s.joint_names;
+		record.joint_positions = s.joint_positions;
+		record.first_sub = first_sub;
+		record.num_subs = s.subs.size();
+		writePod(os, record);
+		first_sub += record.num_subs;
+	}
+	for (const Solution& s : solutions_)
+		for (const auto& sub : s.subs)
+			writePod(os, SubRecord{ sub.first, sub.second });
+
+	const char padding[ALIGNMENT] = {};
+	const size_t tables_end = os.tellp();
+	os.write(padding, aligned(tables_end) - tables_end);
+	for (const std::string& bytes : blobs_) {
+		os.write(bytes.data(), bytes.size());
+		os.write(padding, aligned(bytes.size()) - bytes.size());
+	}
+	if (!os)
+		ROS_ERROR_STREAM_NAMED("SolutionStore", "Failed to write solution store '" << file << "'");
+	return static_cast<bool>(os);
+}
+
+SolutionStore::~SolutionStore() {
+	close();
+}
+
+void SolutionStore::close() {
+	if (data_)
+		munmap(data_, size_);
+	data_ = nullptr;
+	size_ = 0;
+	num_solutions_ = 0;
+	blobs_ = nullptr;
+	solutions_ = nullptr;
+	subs_ = nullptr;
+	task_names_.clear();
+}
+
+bool SolutionStore::open(const std::string& file) {
+	close();
+	int fd = ::open(file.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		ROS_ERROR_STREAM_NAMED("SolutionStore", "Cannot open '" << file << "'");
+		if (fd >= 0)
+			::close(fd);
+		return false;
+	}
+	size_ = st.st_size;
+	data_ = size_ > 0 ? mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	::close(fd);  // mapping stays valid
+	if (data_ == MAP_FAILED) {
+		data_ = nullptr;
+		size_ = 0;
+		ROS_ERROR_STREAM_NAMED("SolutionStore", "Cannot map '" << file << "'");
+		return false;
+	}
+
+	auto fail = [this, &file](const char* reason) {
+		ROS_ERROR_STREAM_NAMED("SolutionStore", "Invalid solution store '" << file << "': " << reason);
+		close();
+		return false;
+	};
+	const char* bytes = static_cast<const char*>(data_);
+	Header header;
+	if (size_ < sizeof(header) || std::memcmp(bytes, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+		return fail("wrong magic");
+	std::memcpy(&header, bytes, sizeof(header));
+
+	if (header.num_blobs > size_ / sizeof(Blob) || header.num_solutions > size_ / sizeof(SolutionRecord) ||
+	    header.num_subs > size_ / sizeof(SubRecord) ||
+	    sizeof(Header) + header.num_blobs * sizeof(Blob) + header.num_solutions * sizeof(SolutionRecord) +
+	            header.num_subs * sizeof(SubRecord) >
+	        size_)
+		return fail("truncated tables");
+	const auto* blobs = reinterpret_cast<const Blob*>(bytes + sizeof(Header));
+	const auto* solutions = reinterpret_cast<const SolutionRecord*>(blobs + header.num_blobs);
+	const auto* subs = reinterpret_cast<const SubRecord*>(solutions + header.num_solutions);
+
+	for (uint64_t i = 0; i != header.num_blobs; ++i)
+		if (blobs[i].offset > size_ || blobs[i].size > size_ - blobs[i].offset)
+			return fail("blob exceeds file");
+	for (uint64_t i = 0; i != header.num_subs; ++i)
+		if (subs[i].scene >= header.num_blobs || subs[i].stage >= header.num_blobs)
+			return fail("invalid blob index");
+	for (uint64_t i = 0; i != header.num_solutions; ++i) {
+		const SolutionRecord& record = solutions[i];
+		if (record.solution >= header.num_blobs || record.joint_names >= header.num_blobs ||
+		    record.joint_positions >= header.num_blobs)
+			return fail("invalid blob index");
+		if (record.first_sub > header.num_subs || record.num_subs > header.num_subs - record.first_sub)
+			return fail("sub trajectory range exceeds table");
+		task_names_.emplace_back(record.task, strnlen(record.task, TASK_NAME_LENGTH));
+	}
+
+	num_solutions_ = header.num_solutions;
+	blobs_ = blobs;
+	solutions_ = solutions;
+	subs_ = subs;
+	return true;
+}
+
+const char* SolutionStore::blobData(size_t index, size_t& size) const {
+	size = blobs_[index].size;
+	return static_cast<const char*>(data_) + blobs_[index].offset;
+}
+
+std::vector<SolutionStore::Entry> SolutionStore::query(const Query& query) const {
+	std::vector<Entry> result;
+	for (size_t i = 0; i != num_solutions_; ++i) {
+		Entry entry(this, i);
+		if ((!query.task_name.empty() && entry.taskName() != query.task_name) || entry.cost() > query.max_cost)
+			continue;
+		if (query.start && entry.distance(*query.start) > query.max_distance)
+			continue;
+		result.push_back(entry);
+	}
+	std::stable_sort(result.begin(), result.end(),
+	                 [](const Entry& a, const Entry& b) { return a.cost() < b.cost(); });
+	if (query.limit > 0 && result.size() > query.limit)
+		result.erase(result.begin() + query.limit, result.end());
+	return result;
+}
+}  // namespace task_constructor
+}  // namespace moveit
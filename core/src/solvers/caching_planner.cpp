@@ -0,0 +1,329 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    cache trajectories of another planner, keyed by start, goal, and scene
+*/
+
+#include <moveit/task_constructor/solvers/caching_planner.h>
+#include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <ros/serialization.h>
+#include <ros/console.h>
+
+#include <cmath>
+#include <fstream>
+#include <cstdint>
+#include <sstream>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+namespace {
+template <typename Msg>
+std::string serialize(const Msg& msg) {
+	std::string bytes(ros::serialization::serializationLength(msg), '\0');
+	ros::serialization::OStream stream(reinterpret_cast<uint8_t*>(&bytes[0]), bytes.size());
+	ros::serialization::serialize(stream, msg);
+	return bytes;
+}
+
+template <typename Msg>
+void deserialize(std::string& bytes, Msg& msg) {
+	ros::serialization::IStream stream(reinterpret_cast<uint8_t*>(&bytes[0]), bytes.size());
+	ros::serialization::deserialize(stream, msg);
+}
+
+void quantize(std::ostream& os, double value, double resolution) {
+	os << std::lround(value / resolution) << ',';
+}
+
+void quantize(std::ostream& os, const Eigen::Isometry3d& pose, double position_resolution,
+              double orientation_resolution) {
+	for (int i = 0; i < 3; ++i)
+		quantize(os, pose.translation()[i], position_resolution);
+	Eigen::Quaterniond q(pose.linear());
+	if (q.w() < 0)  // q and -q denote the same rotation
+		q.coeffs() = -q.coeffs();
+	for (int i = 0; i < 4; ++i)
+		quantize(os, q.coeffs()[i], orientation_resolution);
+}
+
+void quantize(std::ostream& os, const moveit::core::RobotState& state, const moveit::core::JointModelGroup* jmg,
+              double resolution) {
+	std::vector<double> positions;
+	state.copyJointGroupPositions(jmg, positions);
+	for (double value : positions)
+		quantize(os, value, resolution);
+}
+
+// 64-bit FNV-1a hash: unlike std::hash, it is stable across platforms and builds, as required for saved keys
+void stableHash(std::ostream& os, const std::string& bytes) {
+	uint64_t hash = 14695981039346656037ull;
+	for (unsigned char c : bytes) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	const auto flags = os.flags();
+	os << std::hex << hash;
+	os.flags(flags);
+}
+
+// goal / key separators: keys of scene goals and Cartesian goals never collide
+constexpr char JOINT_GOAL[] = "|J";
+constexpr char POSE_GOAL[] = "|P";
+
+bool write(std::ostream& os, const std::string& bytes) {
+	uint32_t size = bytes.size();
+	os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	os.write(bytes.data(), size);
+	return static_cast<bool>(os);
+}
+
+bool read(std::istream& is, std::string& bytes) {
+	uint32_t size;
+	if (!is.read(reinterpret_cast<char*>(&size), sizeof(size)))
+		return false;
+	bytes.resize(size);
+	return static_cast<bool>(is.read(&bytes[0], size));
+}
+
+const char FILE_MAGIC[] = "MTC_PLAN_CACHE_2";  // version 1 used platform-dependent hashes in keys
+}  // namespace
+
+CachingPlanner::CachingPlanner(const PlannerInterfacePtr& planner) : planner_(planner) {
+	if (!planner_)
+		throw std::runtime_error("CachingPlanner requires a planner");
+
+	auto& p = properties();
+	p.declare<double>("joint_resolution", 1e-3, "quantization of joint positions (rad or m)");
+	p.declare<double>("position_resolution", 1e-4, "quantization of Cartesian target positions (m)");
+	p.declare<double>("orientation_resolution", 1e-3, "quantization of Cartesian target orientations (quaternion)");
+	p.declare<size_t>("max_entries", 1000, "maximum number of cached trajectories (oldest are dropped first)");
+}
+
+void CachingPlanner::init(const core::RobotModelConstPtr& robot_model) {
+	planner_->init(robot_model);
+}
+
+std::string CachingPlanner::startKey(const planning_scene::PlanningSceneConstPtr& from,
+                                     const core::JointModelGroup* jmg,
+                                     const moveit_msgs::Constraints& path_constraints) const {
+	const auto& p = properties();
+	const double joint_res = p.get<double>("joint_resolution");
+	const double pos_res = p.get<double>("position_resolution");
+	const double rot_res = p.get<double>("orientation_resolution");
+
+	std::ostringstream os;
+	os << from->getRobotModel()->getName() << '|' << jmg->getName() << '|';
+	quantize(os, from->getCurrentState(), jmg, joint_res);
+	os << '|';
+	stableHash(os, serialize(path_constraints));
+	os << '|';
+
+	// fingerprint of collision objects (sorted by name) and attached bodies
+	std::ostringstream scene;
+	for (const auto& pair : *from->getWorld()) {
+		const collision_detection::World::Object& object = *pair.second;
+		scene << pair.first << ':' << object.shapes_.size() << ':';
+#if MOVEIT_HAS_OBJECT_POSE
+		quantize(scene, object.pose_, pos_res, rot_res);
+#endif
+		for (const auto& pose : object.shape_poses_)
+			quantize(scene, pose, pos_res, rot_res);
+		for (const auto& shape : object.shapes_)
+			scene << shape->type << ',';
+		scene << ';';
+	}
+	std::vector<const moveit::core::AttachedBody*> attached;
+	from->getCurrentState().getAttachedBodies(attached);
+	for (const moveit::core::AttachedBody* body : attached)
+		scene << body->getName() << '@' << body->getAttachedLinkName() << ';';
+	stableHash(os, scene.str());
+	return os.str();
+}
+
+bool CachingPlanner::lookup(const std::string& key, const planning_scene::PlanningSceneConstPtr& from,
+                            const core::JointModelGroup* jmg, const moveit_msgs::Constraints& path_constraints,
+                            robot_trajectory::RobotTrajectoryPtr& result) {
+	moveit_msgs::RobotTrajectory msg;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = entries_.find(key);
+		if (it == entries_.end())
+			return false;
+		msg = it->second;
+	}
+
+	auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(from->getRobotModel(), jmg);
+	trajectory->setRobotTrajectoryMsg(from->getCurrentState(), msg);
+	if (trajectory->empty())
+		return false;
+	// start exactly at the requested state, which might differ within quantization
+	*trajectory->getFirstWayPointPtr() = from->getCurrentState();
+
+	// re-validate: the trajectory might collide with an (unfingerprinted) change of the scene
+	kinematic_constraints::KinematicConstraintSet kcs(from->getRobotModel());
+	kcs.add(path_constraints, from->getTransforms());
+	for (std::size_t i = 0; i < trajectory->getWayPointCount(); ++i) {
+		moveit::core::RobotState& state = trajectory->getWayPoint(i);
+		state.update();
+		if (from->isStateColliding(state, jmg->getName()) || !kcs.decide(state).satisfied) {
+			ROS_DEBUG_STREAM_NAMED("CachingPlanner", "cached trajectory became invalid at waypoint " << i);
+			std::lock_guard<std::mutex> lock(mutex_);
+			entries_.erase(key);
+			order_.remove(key);
+			return false;
+		}
+	}
+	result = trajectory;
+	return true;
+}
+
+void CachingPlanner::store(const std::string& key, const robot_trajectory::RobotTrajectory& trajectory) {
+	moveit_msgs::RobotTrajectory msg;
+	trajectory.getRobotTrajectoryMsg(msg);
+
+	const size_t max_entries = properties().get<size_t>("max_entries");
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto inserted = entries_.emplace(key, msg);
+	if (!inserted.second) {
+		inserted.first->second = std::move(msg);
+		return;
+	}
+	order_.push_back(key);
+	while (entries_.size() > max_entries) {
+		entries_.erase(order_.front());
+		order_.pop_front();
+	}
+}
+
+bool CachingPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
+                          const planning_scene::PlanningSceneConstPtr& to, const moveit::core::JointModelGroup* jmg,
+                          double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+                          const moveit_msgs::Constraints& path_constraints, const PreemptionToken* preempt) {
+	std::ostringstream key;
+	key << startKey(from, jmg, path_constraints) << JOINT_GOAL;
+	quantize(key, to->getCurrentState(), jmg, properties().get<double>("joint_resolution"));
+
+	if (lookup(key.str(), from, jmg, path_constraints, result)) {
+		// reach goal exactly
+		std::vector<double> goal;
+		to->getCurrentState().copyJointGroupPositions(jmg, goal);
+		result->getLastWayPointPtr()->setJointGroupPositions(jmg, goal);
+		result->getLastWayPointPtr()->update();
+		++hits_;
+		return true;
+	}
+	++misses_;
+
+	bool success = planner_->plan(from, to, jmg, timeout, result, path_constraints, preempt);
+	if (success && result)
+		store(key.str(), *result);
+	return success;
+}
+
+bool CachingPlanner::plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+                          const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg, double timeout,
+                          robot_trajectory::RobotTrajectoryPtr& result,
+                          const moveit_msgs::Constraints& path_constraints, const PreemptionToken* preempt) {
+	const auto& p = properties();
+	std::ostringstream key;
+	key << startKey(from, jmg, path_constraints) << POSE_GOAL << link.getName() << ':';
+	quantize(key, target, p.get<double>("position_resolution"), p.get<double>("orientation_resolution"));
+
+	if (lookup(key.str(), from, jmg, path_constraints, result)) {
+		++hits_;
+		return true;
+	}
+	++misses_;
+
+	bool success = planner_->plan(from, link, target, jmg, timeout, result, path_constraints, preempt);
+	if (success && result)
+		store(key.str(), *result);
+	return success;
+}
+
+std::size_t CachingPlanner::size() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return entries_.size();
+}
+
+void CachingPlanner::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_.clear();
+	order_.clear();
+}
+
+bool CachingPlanner::save(const std::string& file) const {
+	std::ofstream os(file, std::ios::binary);
+	std::lock_guard<std::mutex> lock(mutex_);
+	bool ok = write(os, FILE_MAGIC);
+	for (auto it = order_.cbegin(); ok && it != order_.cend(); ++it)
+		ok = write(os, *it) && write(os, serialize(entries_.at(*it)));
+	if (!ok)
+		ROS_ERROR_STREAM_NAMED("CachingPlanner", "Failed to write plan cache to '" << file << "'");
+	return ok;
+}
+
+bool CachingPlanner::load(const std::string& file) {
+	std::ifstream is(file, std::ios::binary);
+	std::string magic;
+	if (!read(is, magic) || magic != FILE_MAGIC) {
+		ROS_ERROR_STREAM_NAMED("CachingPlanner", "'" << file << "' is not a plan cache file");
+		return false;
+	}
+
+	std::string key, bytes;
+	while (read(is, key)) {
+		moveit_msgs::RobotTrajectory msg;
+		try {
+			if (!read(is, bytes))
+				throw ros::Exception("truncated file");
+			deserialize(bytes, msg);
+		} catch (const ros::Exception& e) {
+			ROS_ERROR_STREAM_NAMED("CachingPlanner", "Corrupt plan cache file '" << file << "': " << e.what());
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (entries_.emplace(key, std::move(msg)).second)
+			order_.push_back(key);
+	}
+	return true;
+}
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
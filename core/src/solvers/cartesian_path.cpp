@@ -37,15 +37,26 @@
 */
 
 #include <moveit/task_constructor/solvers/cartesian_path.h>
+#include <moveit/task_constructor/trace.h>
 #include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/task_constructor/scratch_state.h>
+#include <moveit/task_constructor/task_executor.h>
+#include <moveit/task_constructor/utils.h>
 
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/trajectory_processing/time_parameterization.h>
 #include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #if MOVEIT_HAS_CARTESIAN_INTERPOLATOR
 #include <moveit/robot_state/cartesian_interpolator.h>
 #endif
 
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <thread>
+
 using namespace trajectory_processing;
 
 namespace moveit {
@@ -57,16 +68,32 @@ CartesianPath::CartesianPath() {
 	p.declare<double>("step_size", 0.01, "step size between consecutive waypoints");
 	p.declare<double>("jump_threshold", 1.5, "acceptable fraction of mean joint motion per step");
 	p.declare<double>("min_fraction", 1.0, "fraction of motion required for success");
+	p.declare<unsigned int>("num_threads", 1u, "threads used by planCandidates()");
+	p.declare<bool>("continuous_collision_checking", false,
+	                "check segments between waypoints continuously, allowing for a coarser step_size "
+	                "(detectors without continuous support, e.g. FCL, densely sample each segment instead)");
+	p.declare<bool>("lazy_validation", false, "skip collision checking, leaving the path to the Task");
+	p.declare<double>("coarse_step_factor", 1.0,
+	                  "step_size multiplier of an initial coarse pass, refined near obstacles or singularities");
 	p.declare<kinematics::KinematicsQueryOptions>("kinematics_options", kinematics::KinematicsQueryOptions(),
 	                                              "KinematicsQueryOptions to pass to CartesianInterpolator");
 }
 
 void CartesianPath::init(const core::RobotModelConstPtr& /*robot_model*/) {}
 
+bool CartesianPath::validatesLazily() const {
+	return properties().get<bool>("lazy_validation");
+}
+
 bool CartesianPath::plan(const planning_scene::PlanningSceneConstPtr& from,
                          const planning_scene::PlanningSceneConstPtr& to, const moveit::core::JointModelGroup* jmg,
                          double timeout, robot_trajectory::RobotTrajectoryPtr& result,
-                         const moveit_msgs::Constraints& path_constraints) {
+                         const moveit_msgs::Constraints& path_constraints, const PreemptionToken* preempt) {
+	MTC_TRACE_SCOPE("plan", "CartesianPath::plan");
+	CallRecorder recorder(*this, jmg, "cartesian", result);
+	bool success;
+	if (recorder.replay(from, success))
+		return recorder.finish(success);
 	const moveit::core::LinkModel* link = jmg->getOnlyOneEndEffectorTip();
 	if (!link) {
 		ROS_WARN_STREAM("no unique tip for joint model group: " << jmg->getName());
@@ -74,50 +101,159 @@ bool CartesianPath::plan(const planning_scene::PlanningSceneConstPtr& from,
 	}
 
 	// reach pose of forward kinematics
-	return plan(from, *link, to->getCurrentState().getGlobalLinkTransform(link), jmg, timeout, result, path_constraints);
+	return recorder.finish(plan(from, *link, to->getCurrentState().getGlobalLinkTransform(link), jmg, timeout, result,
+	                            path_constraints, preempt));
 }
 
 bool CartesianPath::plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
                          const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg, double timeout,
                          robot_trajectory::RobotTrajectoryPtr& result,
-                         const moveit_msgs::Constraints& path_constraints) {
+                         const moveit_msgs::Constraints& path_constraints, const PreemptionToken* preempt) {
+	MTC_TRACE_SCOPE("plan", "CartesianPath::plan");
+	CallRecorder recorder(*this, jmg, "cartesian", result);
+	bool success;
+	if (recorder.replay(from, success))
+		return recorder.finish(success);
 	const auto& props = properties();
 	planning_scene::PlanningScenePtr sandbox_scene = from->diff();
 
 	kinematic_constraints::KinematicConstraintSet kcs(sandbox_scene->getRobotModel());
 	kcs.add(path_constraints, sandbox_scene->getTransforms());
 
-	auto is_valid = [&sandbox_scene, &kcs](moveit::core::RobotState* state, const moveit::core::JointModelGroup* jmg,
-	                                       const double* joint_positions) {
+	// in continuous mode or with substeps > 1, check the segment from the previous (valid) waypoint
+	const bool continuous = props.get<bool>("continuous_collision_checking");
+	unsigned int substeps = 1;  // discretely checked states per segment
+	const bool lazy = validatesLazily();
+	ScratchState prev_state{ from->getCurrentState() };
+	moveit::core::RobotState& prev = *prev_state;
+	ScratchState substep_state{ from->getCurrentState() };
+	auto is_colliding = [&](const moveit::core::RobotState& current, const std::string& group) {
+		if (continuous)
+			return utils::isSegmentColliding(*sandbox_scene, prev, current, group);
+		moveit::core::RobotState& substep = *substep_state;
+		for (unsigned int i = 1; i < substeps; ++i) {
+			prev.interpolate(current, static_cast<double>(i) / substeps, substep);
+			substep.update();
+			if (sandbox_scene->isStateColliding(substep, group))
+				return true;
+		}
+		return sandbox_scene->isStateColliding(current, group);
+	};
+	auto is_valid = [&is_colliding, &kcs, preempt, continuous, &substeps, lazy, &prev](
+	                    moveit::core::RobotState* state, const moveit::core::JointModelGroup* jmg,
+	                    const double* joint_positions) {
+		if (PreemptionToken::requested(preempt))
+			return false;  // abort path computation at current waypoint
 		state->setJointGroupPositions(jmg, joint_positions);
 		state->update();
-		return !sandbox_scene->isStateColliding(const_cast<const robot_state::RobotState&>(*state), jmg->getName()) &&
-		       kcs.decide(*state).satisfied;
+		const robot_state::RobotState& current = *state;
+		bool valid = (lazy || !is_colliding(current, jmg->getName())) && kcs.decide(current).satisfied;
+		if (valid && (continuous || substeps > 1))
+			prev = current;
+		return valid;
 	};
 
-	std::vector<moveit::core::RobotStatePtr> trajectory;
+	auto interpolate = [&](moveit::core::RobotState& start, double step_size,
+	                       std::vector<moveit::core::RobotStatePtr>& trajectory) {
 #if MOVEIT_HAS_CARTESIAN_INTERPOLATOR
-	double achieved_fraction = moveit::core::CartesianInterpolator::computeCartesianPath(
-	    &(sandbox_scene->getCurrentStateNonConst()), jmg, trajectory, &link, target, true,
-	    moveit::core::MaxEEFStep(props.get<double>("step_size")),
-	    moveit::core::JumpThreshold(props.get<double>("jump_threshold")), is_valid,
-	    props.get<kinematics::KinematicsQueryOptions>("kinematics_options"));
+		return moveit::core::CartesianInterpolator::computeCartesianPath(
+		    &start, jmg, trajectory, &link, target, true, moveit::core::MaxEEFStep(step_size),
+		    moveit::core::JumpThreshold(props.get<double>("jump_threshold")), is_valid,
+		    props.get<kinematics::KinematicsQueryOptions>("kinematics_options"));
 #else
-	double achieved_fraction = sandbox_scene->getCurrentStateNonConst().computeCartesianPath(
-	    jmg, trajectory, &link, target, true, props.get<double>("step_size"), props.get<double>("jump_threshold"),
-	    is_valid, props.get<kinematics::KinematicsQueryOptions>("kinematics_options"));
+		return start.computeCartesianPath(jmg, trajectory, &link, target, true, step_size,
+		                                  props.get<double>("jump_threshold"), is_valid,
+		                                  props.get<kinematics::KinematicsQueryOptions>("kinematics_options"));
 #endif
+	};
+
+	std::vector<moveit::core::RobotStatePtr> trajectory;
+	const double step_size = props.get<double>("step_size");
+	const double coarse_factor = props.get<double>("coarse_step_factor");
+	double achieved_fraction;
+	if (coarse_factor > 1.0) {
+		// coarse steps are checked along their segments to not miss obstacles between waypoints:
+		// continuously if requested, otherwise at (joint-space interpolated) fine substeps
+		substeps = static_cast<unsigned int>(std::ceil(coarse_factor));
+		achieved_fraction = interpolate(sandbox_scene->getCurrentStateNonConst(), coarse_factor * step_size, trajectory);
+		substeps = 1;
+
+		if (achieved_fraction < 1.0 && !PreemptionToken::requested(preempt)) {
+			// refine the remainder, starting from the last valid coarse waypoint
+			ScratchState start_state{ *trajectory.back() };
+			moveit::core::RobotState& start = *start_state;
+			prev = start;
+			std::vector<moveit::core::RobotStatePtr> refined;
+			double refined_fraction = interpolate(start, step_size, refined);
+			// the remainder is a straight line again: fractions combine linearly
+			achieved_fraction += (1.0 - achieved_fraction) * refined_fraction;
+			if (!refined.empty())
+				trajectory.insert(trajectory.end(), refined.begin() + 1, refined.end());
+		}
+	} else
+		achieved_fraction = interpolate(sandbox_scene->getCurrentStateNonConst(), step_size, trajectory);
 
 	assert(!trajectory.empty());  // there should be at least the start state
 	result = std::make_shared<robot_trajectory::RobotTrajectory>(sandbox_scene->getRobotModel(), jmg);
 	for (const auto& waypoint : trajectory)
 		result->addSuffixWayPoint(waypoint, 0.0);
 
-	auto timing = props.get<TimeParameterizationPtr>("time_parameterization");
-	timing->computeTimeStamps(*result, props.get<double>("max_velocity_scaling_factor"),
-	                          props.get<double>("max_acceleration_scaling_factor"));
+	addTiming(*result);
+
+	return recorder.finish(achieved_fraction >= props.get<double>("min_fraction"));
+}
+
+int CartesianPath::planCandidates(const planning_scene::PlanningSceneConstPtr& from,
+                                  const moveit::core::LinkModel& link, const EigenSTL::vector_Isometry3d& targets,
+                                  const moveit::core::JointModelGroup* jmg, double timeout,
+                                  robot_trajectory::RobotTrajectoryPtr& result,
+                                  const moveit_msgs::Constraints& path_constraints, CandidatePolicy policy,
+                                  const PreemptionToken* preempt) {
+	const std::size_t num_threads =
+	    std::max<std::size_t>(1, std::min<std::size_t>(properties().get<unsigned int>("num_threads"), targets.size()));
+
+	std::mutex mutex;
+	int chosen = -1;
+	double best_length = std::numeric_limits<double>::infinity();
+	std::atomic<std::size_t> next{ 0 };
+
+	auto worker = [&]() {
+		for (std::size_t i = next++; i < targets.size(); i = next++) {
+			if (PreemptionToken::requested(preempt))
+				return;
+			{  // with FIRST_FEASIBLE, later candidates cannot win anymore
+				std::lock_guard<std::mutex> lock(mutex);
+				if (policy == FIRST_FEASIBLE && chosen >= 0 && static_cast<std::size_t>(chosen) < i)
+					return;
+			}
+
+			robot_trajectory::RobotTrajectoryPtr trajectory;
+			if (!plan(from, link, targets[i], jmg, timeout, trajectory, path_constraints, preempt) || !trajectory)
+				continue;
+
+			double length = 0.0;
+			for (std::size_t k = 1; k < trajectory->getWayPointCount(); ++k)
+				length += trajectory->getWayPoint(k - 1).distance(trajectory->getWayPoint(k), jmg);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			bool better = policy == FIRST_FEASIBLE ? chosen < 0 || static_cast<std::size_t>(chosen) > i :
+			                                         length < best_length;
+			if (better) {
+				chosen = static_cast<int>(i);
+				best_length = length;
+				result = trajectory;
+			}
+		}
+	};
 
-	return achieved_fraction >= props.get<double>("min_fraction");
+	std::vector<std::thread> threads;
+	const TaskExecutorPtr executor = TaskExecutor::current();
+	for (std::size_t t = 1; t < num_threads; ++t)
+		threads.push_back(executor->spawn(worker));
+	worker();
+	for (auto& thread : threads)
+		thread.join();
+	return chosen;
 }
 }  // namespace solvers
 }  // namespace task_constructor
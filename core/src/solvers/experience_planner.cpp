@@ -0,0 +1,260 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    repair stored trajectories of similar queries before falling back to a planner
+*/
+
+#include <moveit/task_constructor/solvers/experience_planner.h>
+#include <moveit/task_constructor/scratch_state.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit/trajectory_processing/time_parameterization.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+namespace {
+double squaredDistance(const std::vector<double>& a, const std::vector<double>& b) {
+	double d = 0.0;
+	for (std::size_t i = 0; i < a.size(); ++i)
+		d += (a[i] - b[i]) * (a[i] - b[i]);
+	return d;
+}
+
+double maxDistance(const std::vector<double>& a, const std::vector<double>& b) {
+	double d = 0.0;
+	for (std::size_t i = 0; i < a.size(); ++i)
+		d = std::max(d, std::abs(a[i] - b[i]));
+	return d;
+}
+
+/** deform path to connect start and goal
+ *
+ * The start and goal offsets are blended linearly along the path's (normalized) arc length.
+ */
+void deform(std::vector<std::vector<double>>& path, const std::vector<double>& start, const std::vector<double>& goal) {
+	std::vector<double> arc(path.size(), 0.0);
+	for (std::size_t i = 1; i < path.size(); ++i)
+		arc[i] = arc[i - 1] + std::sqrt(squaredDistance(path[i - 1], path[i]));
+	const double length = arc.back();
+
+	const std::vector<double> start_offset = [&]() {
+		std::vector<double> o(start.size());
+		for (std::size_t j = 0; j < start.size(); ++j)
+			o[j] = start[j] - path.front()[j];
+		return o;
+	}();
+	const std::vector<double> goal_offset = [&]() {
+		std::vector<double> o(goal.size());
+		for (std::size_t j = 0; j < goal.size(); ++j)
+			o[j] = goal[j] - path.back()[j];
+		return o;
+	}();
+
+	const double denominator = length > 0.0 ? length : std::max<std::size_t>(1, path.size() - 1);
+	for (std::size_t i = 0; i < path.size(); ++i) {
+		const double t = (length > 0.0 ? arc[i] : i) / denominator;
+		for (std::size_t j = 0; j < path[i].size(); ++j)
+			path[i][j] += (1.0 - t) * start_offset[j] + t * goal_offset[j];
+	}
+	path.front() = start;
+	path.back() = goal;
+}
+}  // namespace
+
+ExperiencePlanner::ExperiencePlanner(const PlannerInterfacePtr& planner) : planner_(planner) {
+	if (!planner_)
+		throw std::runtime_error("ExperiencePlanner requires a planner");
+
+	auto& p = properties();
+	p.declare<size_t>("num_neighbors", 3, "number of nearest experiences to try repairing");
+	p.declare<double>("max_step", 0.05, "max joint step when validating repaired paths");
+	p.declare<size_t>("max_experiences", 1000, "maximum number of stored paths per group (oldest are dropped first)");
+	p.declare<double>("max_deformation", 0.5, "max joint offset of start and goal for repairing a stored path");
+}
+
+void ExperiencePlanner::init(const core::RobotModelConstPtr& robot_model) {
+	planner_->init(robot_model);
+}
+
+std::size_t ExperiencePlanner::size() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::size_t result = 0;
+	for (const auto& pair : experiences_)
+		result += pair.second.size();
+	return result;
+}
+
+void ExperiencePlanner::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	experiences_.clear();
+}
+
+std::vector<ExperiencePlanner::Path> ExperiencePlanner::nearest(const std::string& group,
+                                                                const std::vector<double>& start,
+                                                                const std::vector<double>& goal) const {
+	const size_t k = properties().get<size_t>("num_neighbors");
+	// (distance, experience, reversed)
+	std::vector<std::tuple<double, const Experience*, bool>> candidates;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = experiences_.find(group);
+	if (it == experiences_.end())
+		return {};
+
+	// a linear scan over a few thousand contiguous entries is faster than maintaining a kd-tree
+	for (const Experience& e : it->second) {
+		candidates.emplace_back(squaredDistance(start, e.start) + squaredDistance(goal, e.goal), &e, false);
+		candidates.emplace_back(squaredDistance(start, e.goal) + squaredDistance(goal, e.start), &e, true);
+	}
+	const auto by_distance = [](const auto& a, const auto& b) { return std::get<0>(a) < std::get<0>(b); };
+	const auto end = candidates.begin() + std::min(k, candidates.size());
+	std::partial_sort(candidates.begin(), end, candidates.end(), by_distance);
+
+	std::vector<Path> result;
+	for (auto c = candidates.begin(); c != end; ++c) {
+		result.push_back(std::get<1>(*c)->path);
+		if (std::get<2>(*c))
+			std::reverse(result.back().begin(), result.back().end());
+	}
+	return result;
+}
+
+void ExperiencePlanner::record(const robot_trajectory::RobotTrajectory& trajectory) {
+	const moveit::core::JointModelGroup* jmg = trajectory.getGroup();
+	if (!jmg || trajectory.getWayPointCount() < 2)
+		return;
+
+	Experience e;
+	e.path.resize(trajectory.getWayPointCount());
+	for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+		trajectory.getWayPoint(i).copyJointGroupPositions(jmg, e.path[i]);
+	e.start = e.path.front();
+	e.goal = e.path.back();
+
+	const size_t max = properties().get<size_t>("max_experiences");
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto& group = experiences_[jmg->getName()];
+	group.push_back(std::move(e));
+	while (group.size() > max)
+		group.pop_front();
+}
+
+bool ExperiencePlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
+                             const planning_scene::PlanningSceneConstPtr& to, const moveit::core::JointModelGroup* jmg,
+                             double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+                             const moveit_msgs::Constraints& path_constraints, const PreemptionToken* preempt) {
+	const auto& props = properties();
+	std::vector<double> start, goal;
+	from->getCurrentState().copyJointGroupPositions(jmg, start);
+	to->getCurrentState().copyJointGroupPositions(jmg, goal);
+
+	kinematic_constraints::KinematicConstraintSet kcs(from->getRobotModel());
+	kcs.add(path_constraints, from->getTransforms());
+	const double max_step = props.get<double>("max_step");
+	const double max_deformation = props.get<double>("max_deformation");
+	ScratchState scratch{ from->getCurrentState() };
+	moveit::core::RobotState& state = *scratch;
+
+	// deformed waypoints might leave the joint limits
+	auto valid = [&](const std::vector<double>& positions) {
+		state.setJointGroupPositions(jmg, positions);
+		if (!state.satisfiesBounds(jmg))
+			return false;
+		state.update();
+		return from->isStateValid(state, kcs, jmg->getName());
+	};
+
+	for (Path& path : nearest(jmg->getName(), start, goal)) {
+		if (PreemptionToken::requested(preempt))
+			return false;
+		// shifting a path too far doesn't preserve its clearance
+		if (maxDistance(path.front(), start) > max_deformation || maxDistance(path.back(), goal) > max_deformation)
+			continue;
+		deform(path, start, goal);
+
+		// validate the deformed path, sampling each segment at max_step
+		bool ok = valid(goal);
+		std::vector<double> sample(start.size());
+		for (std::size_t i = 1; ok && i < path.size(); ++i) {
+			const std::vector<double>& a = path[i - 1];
+			const std::vector<double>& b = path[i];
+			double d = 0.0;
+			for (std::size_t j = 0; j < a.size(); ++j)
+				d = std::max(d, std::abs(b[j] - a[j]));
+			const std::size_t steps = std::max<std::size_t>(1, std::ceil(d / max_step));
+			for (std::size_t s = 1; ok && s <= steps; ++s) {
+				const double t = static_cast<double>(s) / steps;
+				for (std::size_t j = 0; j < a.size(); ++j)
+					sample[j] = a[j] + t * (b[j] - a[j]);
+				ok = valid(sample);
+			}
+		}
+		if (!ok)
+			continue;
+
+		result = std::make_shared<robot_trajectory::RobotTrajectory>(from->getRobotModel(), jmg);
+		for (const auto& positions : path) {
+			state.setJointGroupPositions(jmg, positions);
+			state.update();
+			result->addSuffixWayPoint(state, 0.0);
+		}
+		addTiming(*result);
+		++repairs_;
+		return true;
+	}
+
+	bool success = planner_->plan(from, to, jmg, timeout, result, path_constraints, preempt);
+	if (success && result)
+		record(*result);
+	return success;
+}
+
+bool ExperiencePlanner::plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+                             const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg,
+                             double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+                             const moveit_msgs::Constraints& path_constraints, const PreemptionToken* preempt) {
+	bool success = planner_->plan(from, link, target, jmg, timeout, result, path_constraints, preempt);
+	if (success && result)
+		record(*result);
+	return success;
+}
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
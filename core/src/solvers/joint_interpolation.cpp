@@ -37,11 +37,20 @@
 */
 
 #include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/task_constructor/collision_backend.h>
+#include <moveit/task_constructor/collision_cache.h>
+#include <moveit/task_constructor/task_executor.h>
+#include <moveit/task_constructor/trace.h>
 #include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/task_constructor/utils.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/trajectory_processing/time_parameterization.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <deque>
+#include <thread>
 
 namespace moveit {
 namespace task_constructor {
@@ -49,18 +58,111 @@ namespace solvers {
 
 using namespace trajectory_processing;
 
+namespace {
+/// indices [0, n) ordered by bisection: last one first, then midpoints of ever finer intervals
+std::vector<std::size_t> bisectionOrder(std::size_t n) {
+	std::vector<std::size_t> order;
+	if (n == 0)
+		return order;
+	order.reserve(n);
+	order.push_back(n - 1);
+
+	// open intervals (lo, hi) of unchecked indices, processed breadth-first (-1 denotes the start)
+	std::deque<std::pair<long, long>> intervals{ { -1, static_cast<long>(n) - 1 } };
+	while (!intervals.empty()) {
+		long lo = intervals.front().first;
+		long hi = intervals.front().second;
+		intervals.pop_front();
+		if (hi - lo < 2)
+			continue;
+		long mid = (lo + hi) / 2;
+		order.push_back(mid);
+		intervals.emplace_back(lo, mid);
+		intervals.emplace_back(mid, hi);
+	}
+	return order;
+}
+
+/** find a colliding waypoint, checking in given order
+ *
+ * Discrete checks are batched by the process-wide CollisionBackend.
+ * In continuous mode, the segment reaching a waypoint (from its predecessor or start) is checked.
+ * Long sweeps are distributed over num_threads: thread k checks order[k], order[k + num_threads], ...,
+ * all stopping as soon as a collision was found. Returns the smallest colliding index found,
+ * or waypoints.size() if all are valid.
+ */
+std::size_t findInvalid(const planning_scene::PlanningScene& scene, const moveit::core::JointModelGroup* jmg,
+                        const moveit::core::RobotState& start, const std::vector<moveit::core::RobotState>& waypoints,
+                        const std::vector<std::size_t>& order, bool continuous, unsigned int num_threads,
+                        const PreemptionToken* preempt) {
+	const std::size_t none = waypoints.size();
+	if (!continuous) {
+		CollisionBackend::States states;
+		states.reserve(order.size());
+		for (std::size_t index : order)
+			states.push_back(&waypoints[index]);
+		const std::size_t first =
+		    CollisionBackend::instance()->firstColliding(scene, jmg->getName(), states, num_threads, preempt);
+		return first < order.size() ? order[first] : none;
+	}
+
+	// threads only pay off for long sweeps
+	static const std::size_t MIN_CHECKS_PER_THREAD = 16;
+	num_threads = std::max<std::size_t>(1, std::min<std::size_t>(num_threads, order.size() / MIN_CHECKS_PER_THREAD));
+
+	std::atomic<std::size_t> invalid{ none };
+	auto sweep = [&](unsigned int thread) {
+		for (std::size_t k = thread; k < order.size(); k += num_threads) {
+			if (invalid.load(std::memory_order_relaxed) != none || PreemptionToken::requested(preempt))
+				return;
+			const std::size_t index = order[k];
+			const moveit::core::RobotState& prev = index == 0 ? start : waypoints[index - 1];
+			if (utils::isSegmentColliding(scene, prev, waypoints[index], jmg->getName())) {
+				std::size_t current = invalid.load();
+				while (index < current && !invalid.compare_exchange_weak(current, index)) {
+				}
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	const TaskExecutorPtr executor = TaskExecutor::current();
+	for (unsigned int thread = 1; thread < num_threads; ++thread)
+		threads.push_back(executor->spawn([&sweep, thread]() { sweep(thread); }));
+	sweep(0);
+	for (auto& thread : threads)
+		thread.join();
+	return invalid;
+}
+}  // namespace
+
 JointInterpolationPlanner::JointInterpolationPlanner() {
 	auto& p = properties();
 	p.declare<double>("max_step", 0.1, "max joint step");
+	p.declare<unsigned int>("num_threads", 1u, "threads used for collision checking of long motions");
+	p.declare<bool>("continuous_collision_checking", false,
+	                "check segments between waypoints continuously, allowing for a coarser max_step "
+	                "(detectors without continuous support, e.g. FCL, densely sample each segment instead)");
+	p.declare<bool>("lazy_validation", false, "only collision-check the goal, leaving the path to the Task");
 }
 
 void JointInterpolationPlanner::init(const core::RobotModelConstPtr& /*robot_model*/) {}
 
+bool JointInterpolationPlanner::validatesLazily() const {
+	return properties().get<bool>("lazy_validation");
+}
+
 bool JointInterpolationPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
                                      const planning_scene::PlanningSceneConstPtr& to,
                                      const moveit::core::JointModelGroup* jmg, double /*timeout*/,
                                      robot_trajectory::RobotTrajectoryPtr& result,
-                                     const moveit_msgs::Constraints& /*path_constraints*/) {
+                                     const moveit_msgs::Constraints& /*path_constraints*/,
+                                     const PreemptionToken* preempt) {
+	MTC_TRACE_SCOPE("plan", "JointInterpolationPlanner::plan");
+	CallRecorder recorder(*this, jmg, "joint_interpolation", result);
+	bool success;
+	if (recorder.replay(from, success))
+		return recorder.finish(success);
 	const auto& props = properties();
 
 	// Get maximum joint distance
@@ -74,36 +176,54 @@ bool JointInterpolationPlanner::plan(const planning_scene::PlanningSceneConstPtr
 
 	// add first point
 	result->addSuffixWayPoint(from->getCurrentState(), 0.0);
-	if (from->isStateColliding(from_state, jmg->getName()))
+	// the start state was usually checked already, e.g. by the stage generating it
+	auto check_start = [&]() { return from->isStateColliding(from_state, jmg->getName()); };
+	const CollisionCachePtr collision_cache = CollisionCache::instance();
+	if (collision_cache ? collision_cache->isColliding(from, from_state, jmg->getName(), check_start) : check_start())
 		return false;
 
-	moveit::core::RobotState waypoint(from_state);
+	// interpolate all waypoints upfront
 	double delta = d < 1e-6 ? 1.0 : props.get<double>("max_step") / d;
+	std::vector<moveit::core::RobotState> waypoints;
+	waypoints.reserve(static_cast<std::size_t>(1.0 / delta) + 1);
 	for (double t = delta; t < 1.0; t += delta) {  // NOLINT(clang-analyzer-security.FloatLoopCounter)
-		from_state.interpolate(to_state, t, waypoint);
-		result->addSuffixWayPoint(waypoint, t);
-
-		if (from->isStateColliding(waypoint, jmg->getName()))
-			return false;
+		waypoints.emplace_back(from_state);
+		from_state.interpolate(to_state, t, waypoints.back());
+		waypoints.back().update();  // const collision checks require up-to-date transforms
 	}
+	waypoints.push_back(to_state);
+
+	// check goal first, then coarse-to-fine midpoints, aborting on first collision
+	const std::vector<std::size_t> order =
+	    validatesLazily() ? std::vector<std::size_t>{ waypoints.size() - 1 } : bisectionOrder(waypoints.size());
+	const std::size_t invalid =
+	    findInvalid(*from, jmg, from_state, waypoints, order, props.get<bool>("continuous_collision_checking"),
+	                props.get<unsigned int>("num_threads"), preempt);
+	if (PreemptionToken::requested(preempt))
+		return false;
 
-	// add goal point
-	result->addSuffixWayPoint(to_state, 1.0);
-	if (from->isStateColliding(to_state, jmg->getName()))
+	// on failure, report the trajectory up to (and including) the colliding waypoint
+	double t = delta;
+	for (std::size_t i = 0; i < waypoints.size() && i <= invalid; ++i, t += delta)
+		result->addSuffixWayPoint(waypoints[i], std::min(t, 1.0));
+	if (invalid < waypoints.size())
 		return false;
 
-	auto timing = props.get<TimeParameterizationPtr>("time_parameterization");
-	timing->computeTimeStamps(*result, props.get<double>("max_velocity_scaling_factor"),
-	                          props.get<double>("max_acceleration_scaling_factor"));
+	addTiming(*result);
 
-	return true;
+	return recorder.finish(true);
 }
 
 bool JointInterpolationPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
                                      const moveit::core::LinkModel& link, const Eigen::Isometry3d& target_eigen,
                                      const moveit::core::JointModelGroup* jmg, double timeout,
                                      robot_trajectory::RobotTrajectoryPtr& result,
-                                     const moveit_msgs::Constraints& path_constraints) {
+                                     const moveit_msgs::Constraints& path_constraints, const PreemptionToken* preempt) {
+	MTC_TRACE_SCOPE("plan", "JointInterpolationPlanner::plan");
+	CallRecorder recorder(*this, jmg, "joint_interpolation", result);
+	bool success;
+	if (recorder.replay(from, success))
+		return recorder.finish(success);
 	const auto start_time = std::chrono::steady_clock::now();
 
 	auto to{ from->diff() };
@@ -111,8 +231,11 @@ bool JointInterpolationPlanner::plan(const planning_scene::PlanningSceneConstPtr
 	kinematic_constraints::KinematicConstraintSet constraints{ to->getRobotModel() };
 	constraints.add(path_constraints, from->getTransforms());
 
-	auto is_valid{ [&constraints, &to](moveit::core::RobotState* robot_state, const moveit::core::JointModelGroup* jmg,
-		                                const double* joint_values) -> bool {
+	auto is_valid{ [&constraints, &to, preempt](moveit::core::RobotState* robot_state,
+		                                         const moveit::core::JointModelGroup* jmg,
+		                                         const double* joint_values) -> bool {
+		if (PreemptionToken::requested(preempt))
+			return false;
 		robot_state->setJointGroupPositions(jmg, joint_values);
 		robot_state->update();
 		return to->isStateValid(*robot_state, constraints, jmg->getName());
@@ -130,7 +253,7 @@ bool JointInterpolationPlanner::plan(const planning_scene::PlanningSceneConstPtr
 	if (timeout <= 0.0)
 		return false;
 
-	return plan(from, to, jmg, timeout, result, path_constraints);
+	return recorder.finish(plan(from, to, jmg, timeout, result, path_constraints, preempt));
 }
 }  // namespace solvers
 }  // namespace task_constructor
@@ -37,24 +37,50 @@
 */
 
 #include <moveit/task_constructor/solvers/pipeline_planner.h>
+#include <moveit/task_constructor/trace.h>
 #include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/task_executor.h>
+#include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/collision_detection/collision_matrix.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/planning_pipeline/planning_pipeline.h>
 #include <moveit_msgs/MotionPlanRequest.h>
 #include <moveit/kinematic_constraints/utils.h>
 #include <tf2_eigen/tf2_eigen.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
 namespace moveit {
 namespace task_constructor {
 namespace solvers {
 
 struct PlannerCache
 {
-	using PlannerID = std::tuple<std::string, std::string>;
+	using PlannerID = std::tuple<std::string, std::string, std::size_t>;
 	using PlannerMap = std::map<PlannerID, std::weak_ptr<planning_pipeline::PlanningPipeline> >;
 	using ModelList = std::list<std::pair<std::weak_ptr<const robot_model::RobotModel>, PlannerMap> >;
 	ModelList cache_;
+	std::mutex mutex_;  // tasks might be initialized concurrently, e.g. by TaskBatch
+
+	template <typename Factory>
+	planning_pipeline::PlanningPipelinePtr acquire(const robot_model::RobotModelConstPtr& model, const PlannerID& id,
+	                                               const Factory& create) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::weak_ptr<planning_pipeline::PlanningPipeline>& entry = retrieve(model, id);
+		planning_pipeline::PlanningPipelinePtr planner = entry.lock();
+		if (!planner) {
+			planner = create();
+			entry = planner;
+		}
+		return planner;
+	}
 
+private:
 	PlannerMap::mapped_type& retrieve(const robot_model::RobotModelConstPtr& model, const PlannerID& id) {
 		// find model in cache_ and remove expired entries while doing so
 		ModelList::iterator model_it = cache_.begin();
@@ -74,11 +100,10 @@ struct PlannerCache
 	}
 };
 
-planning_pipeline::PlanningPipelinePtr PipelinePlanner::create(const PipelinePlanner::Specification& spec) {
-	static PlannerCache cache;
-
-	static constexpr char const* PLUGIN_PARAMETER_NAME = "planning_plugin";
+namespace {
+constexpr char const* PLUGIN_PARAMETER_NAME = "planning_plugin";
 
+std::string pipelineNamespace(const PipelinePlanner::Specification& spec) {
 	std::string pipeline_ns = spec.ns + "/planning_pipelines/" + spec.pipeline;
 	// fallback to old structure for pipeline parameters in MoveIt
 	if (!ros::NodeHandle(pipeline_ns).hasParam(PLUGIN_PARAMETER_NAME)) {
@@ -86,24 +111,164 @@ planning_pipeline::PlanningPipelinePtr PipelinePlanner::create(const PipelinePla
 		         "Attempting to load pipeline from old parameter structure. Please update your MoveIt config.");
 		pipeline_ns = spec.ns;
 	}
+	return pipeline_ns;
+}
+
+}  // namespace
+
+std::string PipelinePlanner::sceneFingerprint(const planning_scene::PlanningScene& scene,
+                                              const moveit::core::JointModelGroup* jmg) {
+	std::ostringstream os;
+	os.precision(17);
+	for (const auto& pair : *scene.getWorld()) {
+		const collision_detection::World::Object& object = *pair.second;
+		os << pair.first << ':';
+#if MOVEIT_HAS_OBJECT_POSE
+		os << object.pose_.matrix() << ':';
+#endif
+		for (std::size_t i = 0; i < object.shapes_.size(); ++i)
+			os << object.shapes_[i].get() << '@' << object.shape_poses_[i].matrix() << ',';
+		os << ';';
+	}
+	const moveit::core::RobotState& state = scene.getCurrentState();
+	std::vector<const moveit::core::AttachedBody*> attached;
+	state.getAttachedBodies(attached);
+	for (const moveit::core::AttachedBody* body : attached)
+		os << body->getName() << '@' << body->getAttachedLinkName() << ';';
+
+	// joints not planned for are obstacles too
+	const std::vector<int>& planned = jmg ? jmg->getVariableIndexList() : std::vector<int>();
+	for (std::size_t i = 0; i < state.getVariableCount(); ++i)
+		if (std::find(planned.begin(), planned.end(), static_cast<int>(i)) == planned.end())
+			os << state.getVariablePosition(i) << ',';
+	os << ';';
+
+	// allowed collisions
+	moveit_msgs::AllowedCollisionMatrix acm;
+	scene.getAllowedCollisionMatrix().getMessage(acm);
+	for (std::size_t i = 0; i < acm.entry_names.size(); ++i) {
+		os << acm.entry_names[i] << ':';
+		for (bool allowed : acm.entry_values[i].enabled)
+			os << allowed;
+		os << ',';
+	}
+	for (std::size_t i = 0; i < acm.default_entry_names.size(); ++i)
+		os << acm.default_entry_names[i] << '=' << static_cast<bool>(acm.default_entry_values[i]) << ',';
+	return os.str();
+}
+
+/// dedicated pipeline instance of a multi-query session
+struct PipelinePlanner::Session
+{
+	planning_pipeline::PlanningPipelinePtr pipeline;
+	std::string ns;  // parameter namespace of the planner plugin, required to reset it
+	std::string scene;  // fingerprint of the scene the planner's state refers to
+	std::mutex mutex;  // serializes planning within the session
+};
+
+planning_pipeline::PlanningPipelinePtr PipelinePlanner::create(const PipelinePlanner::Specification& spec) {
+	static PlannerCache cache;
+
+	const std::string pipeline_ns = pipelineNamespace(spec);
+	PlannerCache::PlannerID id(pipeline_ns, spec.adapter_param, spec.instance);
+	return cache.acquire(spec.model, id, [&]() {
+		return std::make_shared<planning_pipeline::PlanningPipeline>(spec.model, ros::NodeHandle(pipeline_ns),
+		                                                             PLUGIN_PARAMETER_NAME, spec.adapter_param);
+	});
+}
 
-	PlannerCache::PlannerID id(pipeline_ns, spec.adapter_param);
+namespace {
+/// mutex serializing the use of a pipeline instance, shared by all PipelinePlanners using that (cached) instance
+std::shared_ptr<std::mutex> pipelineMutex(const planning_pipeline::PlanningPipelinePtr& pipeline) {
+	using Entry = std::pair<std::weak_ptr<planning_pipeline::PlanningPipeline>, std::weak_ptr<std::mutex>>;
+	static std::mutex registry_mutex;
+	static std::map<const planning_pipeline::PlanningPipeline*, Entry> registry;
 
-	std::weak_ptr<planning_pipeline::PlanningPipeline>& entry = cache.retrieve(spec.model, id);
-	planning_pipeline::PlanningPipelinePtr planner = entry.lock();
-	if (!planner) {
-		// create new entry
-		planner = std::make_shared<planning_pipeline::PlanningPipeline>(spec.model, ros::NodeHandle(pipeline_ns),
-		                                                                PLUGIN_PARAMETER_NAME, spec.adapter_param);
-		// store in cache
-		entry = planner;
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	for (auto it = registry.begin(); it != registry.end();)  // drop expired entries
+		it = it->second.first.expired() || it->second.second.expired() ? registry.erase(it) : std::next(it);
+	Entry& entry = registry[pipeline.get()];
+	std::shared_ptr<std::mutex> mutex = entry.second.lock();
+	if (!mutex) {
+		mutex = std::make_shared<std::mutex>();
+		entry = Entry(pipeline, mutex);
 	}
-	return planner;
+	return mutex;
 }
+}  // namespace
+
+/** pool of pipeline instances, handing out instances for exclusive use
+ *
+ * Planning plugins are usually not reentrant: concurrent calls wait for a free instance.
+ * As instances are cached and thus shared by PipelinePlanners, a leased instance is additionally
+ * locked by its pipelineMutex().
+ */
+class PipelineInstances
+{
+public:
+	explicit PipelineInstances(std::vector<planning_pipeline::PlanningPipelinePtr> pipelines)
+	  : pipelines_(std::move(pipelines)), busy_(pipelines_.size(), false) {
+		for (const auto& pipeline : pipelines_)
+			mutexes_.push_back(pipelineMutex(pipeline));
+	}
+
+	/// RAII handle of a checked-out pipeline
+	class Lease
+	{
+	public:
+		Lease(Lease&& other) : pool_(other.pool_), index_(other.index_), lock_(std::move(other.lock_)) {
+			other.pool_ = nullptr;
+		}
+		~Lease() {
+			if (!pool_)
+				return;
+			lock_.unlock();
+			pool_->release(index_);
+		}
+		const planning_pipeline::PlanningPipelinePtr& pipeline() const { return pool_->pipelines_[index_]; }
+
+	private:
+		friend class PipelineInstances;
+		Lease(PipelineInstances* pool, std::size_t index)
+		  : pool_(pool), index_(index), lock_(*pool->mutexes_[index]) {}
+		PipelineInstances* pool_;
+		std::size_t index_;
+		std::unique_lock<std::mutex> lock_;  // of the instance's pipelineMutex()
+	};
+
+	Lease acquire() {
+		std::size_t index;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			std::vector<bool>::iterator it;
+			cv_.wait(lock, [&]() { return (it = std::find(busy_.begin(), busy_.end(), false)) != busy_.end(); });
+			*it = true;
+			index = it - busy_.begin();
+		}
+		// might wait for other PipelinePlanners using the same instance
+		return Lease(this, index);
+	}
+
+private:
+	void release(std::size_t index) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			busy_[index] = false;
+		}
+		cv_.notify_one();
+	}
+
+	const std::vector<planning_pipeline::PlanningPipelinePtr> pipelines_;
+	std::vector<std::shared_ptr<std::mutex>> mutexes_;  // pipelineMutex() of pipelines_
+	std::vector<bool> busy_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+};
 
 PipelinePlanner::PipelinePlanner(const std::string& pipeline_name) : pipeline_name_{ pipeline_name } {
 	auto& p = properties();
 	p.declare<std::string>("planner", "", "planner id");
+	p.declare<size_t>("num_instances", 1, "number of pipeline instances for concurrent planning");
 
 	p.declare<uint>("num_planning_attempts", 1u, "number of planning attempts");
 	p.declare<moveit_msgs::WorkspaceParameters>("workspace_parameters", moveit_msgs::WorkspaceParameters(),
@@ -113,6 +278,10 @@ PipelinePlanner::PipelinePlanner(const std::string& pipeline_name) : pipeline_na
 	p.declare<double>("goal_position_tolerance", 1e-4, "tolerance for reaching position goals");
 	p.declare<double>("goal_orientation_tolerance", 1e-4, "tolerance for reaching orientation goals");
 
+	p.declare<std::vector<std::string>>("race_planners", {}, "planner ids to race in parallel with planner");
+	p.declare<RacePolicy>("race_policy", FIRST_SUCCESS, "policy to pick the result of raced planners");
+	p.declare<bool>("multi_query", false, "reuse the planner's state (e.g. a roadmap) while the scene is unchanged");
+
 	p.declare<bool>("display_motion_plans", false,
 	                "publish generated solutions on topic " + planning_pipeline::PlanningPipeline::DISPLAY_PATH_TOPIC);
 	p.declare<bool>("publish_planning_requests", false,
@@ -122,21 +291,60 @@ PipelinePlanner::PipelinePlanner(const std::string& pipeline_name) : pipeline_na
 
 PipelinePlanner::PipelinePlanner(const planning_pipeline::PlanningPipelinePtr& planning_pipeline) : PipelinePlanner() {
 	planner_ = planning_pipeline;
+	custom_ = true;
 }
 
 void PipelinePlanner::init(const core::RobotModelConstPtr& robot_model) {
-	if (!planner_) {
-		Specification spec;
-		spec.model = robot_model;
-		spec.pipeline = pipeline_name_;
-		planner_ = create(spec);
+	Specification spec;
+	spec.model = robot_model;
+	spec.pipeline = pipeline_name_;
+	if (!custom_) {
+		planner_ = create(spec);  // cache lookup, valid for a changed robot model too
 	} else if (robot_model != planner_->getRobotModel()) {
 		throw std::runtime_error(
 		    "The robot model of the planning pipeline isn't the same as the task's robot model -- "
 		    "use Task::setRobotModel for setting the robot model when using custom planning pipeline");
 	}
-	planner_->displayComputedMotionPlans(properties().get<bool>("display_motion_plans"));
-	planner_->publishReceivedRequests(properties().get<bool>("publish_planning_requests"));
+
+	// create additional instances upfront: loading plugins is expensive
+	std::vector<planning_pipeline::PlanningPipelinePtr> pipelines{ planner_ };
+	size_t num_instances = properties().get<size_t>("num_instances");
+	// raced planners run concurrently, each requiring an instance of its own
+	const size_t num_racing = properties().get<std::vector<std::string>>("race_planners").size();
+	if (num_racing > 0 && !custom_)
+		num_instances = std::max(num_instances, num_racing + 1);
+	if (num_instances > 1 && custom_)
+		ROS_WARN_NAMED("PipelinePlanner", "Cannot create additional instances of a custom planning pipeline");
+	else
+		for (spec.instance = 1; spec.instance < num_instances; ++spec.instance)
+			pipelines.push_back(create(spec));
+	for (const auto& pipeline : pipelines) {
+		pipeline->displayComputedMotionPlans(properties().get<bool>("display_motion_plans"));
+		pipeline->publishReceivedRequests(properties().get<bool>("publish_planning_requests"));
+	}
+	// racing planners on a single (custom) instance serializes them
+	instances_ = std::make_shared<PipelineInstances>(std::move(pipelines));
+
+	// the session's instance is private: shared instances would mix the planner state of different scenes
+	if (!properties().get<bool>("multi_query")) {
+		session_.reset();
+		return;
+	}
+	if (custom_) {
+		ROS_WARN_NAMED("PipelinePlanner", "Multi-query sessions are not supported for custom planning pipelines");
+		return;
+	}
+	const std::string pipeline_ns = pipelineNamespace(spec);
+	// keep the session (and the planner state) of a previous init(), it is reset on scene changes anyway
+	if (!session_ || session_->pipeline->getRobotModel() != robot_model ||
+	    session_->ns != ros::NodeHandle(pipeline_ns).getNamespace()) {
+		session_ = std::make_shared<Session>();
+		session_->pipeline = std::make_shared<planning_pipeline::PlanningPipeline>(
+		    robot_model, ros::NodeHandle(pipeline_ns), PLUGIN_PARAMETER_NAME, spec.adapter_param);
+		session_->ns = ros::NodeHandle(pipeline_ns).getNamespace();
+	}
+	session_->pipeline->displayComputedMotionPlans(properties().get<bool>("display_motion_plans"));
+	session_->pipeline->publishReceivedRequests(properties().get<bool>("publish_planning_requests"));
 }
 
 void initMotionPlanRequest(moveit_msgs::MotionPlanRequest& req, const PropertyMap& p,
@@ -152,10 +360,152 @@ void initMotionPlanRequest(moveit_msgs::MotionPlanRequest& req, const PropertyMa
 	req.workspace_parameters = p.get<moveit_msgs::WorkspaceParameters>("workspace_parameters");
 }
 
+std::string PipelinePlanner::plannerId() const {
+	const std::string& planner = properties().get<std::string>("planner");
+	return planner.empty() ? pipeline_name_ : pipeline_name_ + "/" + planner;
+}
+
+namespace {
+// plan with pipeline, terminating it once preemption is requested
+bool generatePlan(const planning_pipeline::PlanningPipeline& pipeline,
+                  const planning_scene::PlanningSceneConstPtr& scene, const moveit_msgs::MotionPlanRequest& req,
+                  ::planning_interface::MotionPlanResponse& res, const PreemptionToken* preempt) {
+	if (!preempt)
+		return pipeline.generatePlan(scene, req, res);
+
+	// the pipeline only blocks its calling thread: watch the token from a helper thread
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool done = false;
+	std::thread watcher = TaskExecutor::current()->spawn([&]() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!cv.wait_for(lock, std::chrono::milliseconds(20), [&done]() { return done; }))
+			if (preempt->requested()) {
+				pipeline.terminate();
+				return;
+			}
+	});
+	bool success = pipeline.generatePlan(scene, req, res);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+	}
+	cv.notify_one();
+	watcher.join();
+	return success && !preempt->requested();
+}
+
+double pathLength(const robot_trajectory::RobotTrajectory& trajectory) {
+	double length = 0.0;
+	for (std::size_t i = 1; i < trajectory.getWayPointCount(); ++i)
+		length += trajectory.getWayPoint(i - 1).distance(trajectory.getWayPoint(i), trajectory.getGroup());
+	return length;
+}
+
+// plan with all race_planners in parallel, picking a result according to race_policy
+bool race(const std::shared_ptr<PipelineInstances>& instances, const PropertyMap& p,
+          const planning_scene::PlanningSceneConstPtr& from, const moveit_msgs::MotionPlanRequest& req,
+          robot_trajectory::RobotTrajectoryPtr& result, const PreemptionToken* preempt) {
+	std::vector<std::string> planners = p.get<std::vector<std::string>>("race_planners");
+	if (std::find(planners.begin(), planners.end(), req.planner_id) == planners.end())
+		planners.insert(planners.begin(), req.planner_id);
+	const auto policy = p.get<PipelinePlanner::RacePolicy>("race_policy");
+
+	// shared with (possibly outliving) planning threads
+	struct Race
+	{
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::size_t pending;
+		robot_trajectory::RobotTrajectoryPtr best;
+		double best_cost = std::numeric_limits<double>::infinity();
+		PreemptionToken decided;  // requested once a result was picked
+	};
+	auto state = std::make_shared<Race>();
+	state->pending = planners.size();
+	const TaskExecutorPtr executor = TaskExecutor::current();
+
+	for (const std::string& planner_id : planners) {
+		moveit_msgs::MotionPlanRequest request = req;
+		request.planner_id = planner_id;
+		planning_scene::PlanningSceneConstPtr scene = from->diff();
+		executor->spawn([state, instances, scene, request, policy]() {
+			::planning_interface::MotionPlanResponse res;
+			bool success = false;
+			{
+				auto lease = instances->acquire();  // might wait for an instance still used by a previous race
+				// once a result was picked, running losers are terminated and waiting ones are skipped
+				if (!state->decided.requested())
+					success = generatePlan(*lease.pipeline(), scene, request, res, &state->decided) && res.trajectory_;
+			}
+			double cost = success && policy == PipelinePlanner::SHORTEST_PATH ? pathLength(*res.trajectory_) : 0.0;
+
+			std::lock_guard<std::mutex> lock(state->mutex);
+			--state->pending;
+			if (success && cost < state->best_cost) {
+				state->best = res.trajectory_;
+				state->best_cost = cost;
+			}
+			state->cv.notify_one();
+		}).detach();
+	}
+
+	// planners should respect the timeout, but don't rely on it
+	const std::chrono::duration<double> max_wait(req.allowed_planning_time + 1.0);
+	const auto deadline =
+	    std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(max_wait);
+	auto done = [&]() {
+		return state->pending == 0 || (policy == PipelinePlanner::FIRST_SUCCESS && state->best);
+	};
+	std::unique_lock<std::mutex> lock(state->mutex);
+	// poll the (caller-owned) token, which cannot be handed to the possibly outliving planning threads
+	const auto interval = std::chrono::milliseconds(50);
+	while (!done() && !PreemptionToken::requested(preempt) && std::chrono::steady_clock::now() < deadline) {
+		const std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now() + interval;
+		state->cv.wait_until(lock, std::min(deadline, next), done);
+	}
+	state->decided.request();
+	result = PreemptionToken::requested(preempt) ? nullptr : state->best;
+	return result != nullptr;
+}
+
+}  // namespace
+
+bool PipelinePlanner::solve(const planning_scene::PlanningSceneConstPtr& from,
+                            const moveit_msgs::MotionPlanRequest& req, robot_trajectory::RobotTrajectoryPtr& result,
+                            const PreemptionToken* preempt) {
+	const auto& p = properties();
+	if (!p.get<std::vector<std::string>>("race_planners").empty())
+		return race(instances_, p, from, req, result, preempt);
+
+	::planning_interface::MotionPlanResponse res;
+	bool success;
+	if (session_) {
+		std::lock_guard<std::mutex> lock(session_->mutex);
+		const moveit::core::JointModelGroup* jmg = from->getRobotModel()->getJointModelGroup(req.group_name);
+		std::string scene = sceneFingerprint(*from, jmg);
+		if (scene != session_->scene) {
+			// the planner's state (e.g. roadmap edges) might be invalid in the new scene
+			if (!session_->scene.empty())
+				session_->pipeline->getPlannerManager()->initialize(from->getRobotModel(), session_->ns);
+			session_->scene = std::move(scene);
+		}
+		success = generatePlan(*session_->pipeline, from, req, res, preempt);
+	} else
+		success = generatePlan(*instances_->acquire().pipeline(), from, req, res, preempt);
+	result = res.trajectory_;
+	return success;
+}
+
 bool PipelinePlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
                            const planning_scene::PlanningSceneConstPtr& to, const moveit::core::JointModelGroup* jmg,
                            double timeout, robot_trajectory::RobotTrajectoryPtr& result,
-                           const moveit_msgs::Constraints& path_constraints) {
+                           const moveit_msgs::Constraints& path_constraints, const PreemptionToken* preempt) {
+	MTC_TRACE_SCOPE("plan", "PipelinePlanner::plan");
+	CallRecorder recorder(*this, jmg, plannerId(), result);
+	bool success;
+	if (recorder.replay(from, success))
+		return recorder.finish(success);
 	const auto& props = properties();
 	moveit_msgs::MotionPlanRequest req;
 	initMotionPlanRequest(req, props, jmg, timeout);
@@ -165,16 +515,21 @@ bool PipelinePlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
 	                                                                          props.get<double>("goal_joint_tolerance"));
 	req.path_constraints = path_constraints;
 
-	::planning_interface::MotionPlanResponse res;
-	bool success = planner_->generatePlan(from, req, res);
-	result = res.trajectory_;
-	return success;
+	if (PreemptionToken::requested(preempt))
+		return false;
+
+	return recorder.finish(solve(from, req, result, preempt));
 }
 
 bool PipelinePlanner::plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
                            const Eigen::Isometry3d& target_eigen, const moveit::core::JointModelGroup* jmg,
                            double timeout, robot_trajectory::RobotTrajectoryPtr& result,
-                           const moveit_msgs::Constraints& path_constraints) {
+                           const moveit_msgs::Constraints& path_constraints, const PreemptionToken* preempt) {
+	MTC_TRACE_SCOPE("plan", "PipelinePlanner::plan");
+	CallRecorder recorder(*this, jmg, plannerId(), result);
+	bool success;
+	if (recorder.replay(from, success))
+		return recorder.finish(success);
 	const auto& props = properties();
 	moveit_msgs::MotionPlanRequest req;
 	initMotionPlanRequest(req, props, jmg, timeout);
@@ -189,10 +544,46 @@ bool PipelinePlanner::plan(const planning_scene::PlanningSceneConstPtr& from, co
 	    props.get<double>("goal_orientation_tolerance"));
 	req.path_constraints = path_constraints;
 
-	::planning_interface::MotionPlanResponse res;
-	bool success = planner_->generatePlan(from, req, res);
-	result = res.trajectory_;
-	return success;
+	if (PreemptionToken::requested(preempt))
+		return false;
+
+	return recorder.finish(solve(from, req, result, preempt));
+}
+
+namespace {
+void runDetached(std::function<void()> job) {
+	TaskExecutor::current()->spawn(std::move(job)).detach();
+}
+}  // namespace
+
+PlannerInterface::AsyncPlan PipelinePlanner::planAsync(const planning_scene::PlanningSceneConstPtr& from,
+                                                       const planning_scene::PlanningSceneConstPtr& to,
+                                                       const moveit::core::JointModelGroup* jmg, double timeout,
+                                                       const moveit_msgs::Constraints& path_constraints) {
+	return launch(
+	    [this, from, to, jmg, timeout, path_constraints](const PreemptionToken* preempt) {
+		    PlanResult result;
+		    result.success = plan(from, to, jmg, timeout, result.trajectory, path_constraints, preempt);
+		    return result;
+	    },
+	    runDetached);
+}
+
+PlannerInterface::AsyncPlan PipelinePlanner::planAsync(const planning_scene::PlanningSceneConstPtr& from,
+                                                       const moveit::core::LinkModel& link,
+                                                       const Eigen::Isometry3d& target,
+                                                       const moveit::core::JointModelGroup* jmg, double timeout,
+                                                       const moveit_msgs::Constraints& path_constraints) {
+	const moveit::core::LinkModel* link_ptr = &link;
+	const Eigen::Matrix<double, 4, 4, Eigen::DontAlign> pose = target.matrix();  // see PlannerInterface::planAsync
+	return launch(
+	    [this, from, link_ptr, pose, jmg, timeout, path_constraints](const PreemptionToken* preempt) {
+		    PlanResult result;
+		    result.success = plan(from, *link_ptr, Eigen::Isometry3d(Eigen::Matrix4d(pose)), jmg, timeout,
+		                          result.trajectory, path_constraints, preempt);
+		    return result;
+	    },
+	    runDetached);
 }
 }  // namespace solvers
 }  // namespace task_constructor
@@ -38,7 +38,13 @@
 
 #include <moveit/task_constructor/solvers/planner_interface.h>
 #include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/task_constructor/recording.h>
+#include <moveit/task_constructor/task_executor.h>
+#include <moveit/task_constructor/utils.h>
 #include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <moveit/robot_model/joint_model_group.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <ros/console.h>
 
 using namespace trajectory_processing;
 
@@ -51,6 +57,144 @@ PlannerInterface::PlannerInterface() {
 	p.declare<double>("max_velocity_scaling_factor", 1.0, "scale down max velocity by this factor");
 	p.declare<double>("max_acceleration_scaling_factor", 1.0, "scale down max acceleration by this factor");
 	p.declare<TimeParameterizationPtr>("time_parameterization", std::make_shared<TimeOptimalTrajectoryGeneration>());
+	p.declare<bool>("defer_time_parameterization", false, "only estimate timing until a solution is published");
+}
+
+namespace {
+// depth of nested plan() calls of the current call chain, handed down to asynchronous jobs by launch()
+thread_local unsigned int plan_call_depth = 0;
+
+// adopt the plan() call depth of the launching thread while running a job on another thread
+class CallDepthScope
+{
+	unsigned int previous_;
+
+public:
+	explicit CallDepthScope(unsigned int depth) : previous_(plan_call_depth) { plan_call_depth = depth; }
+	~CallDepthScope() { plan_call_depth = previous_; }
+};
+}  // namespace
+
+PlannerInterface::AsyncPlan PlannerInterface::launch(PlanJob job,
+                                                     const std::function<void(std::function<void()>)>& executor) {
+	auto token = std::make_shared<PreemptionToken>();
+	// plan() calls of the job are nested into the caller's plan() call (if any), although running on another thread
+	const unsigned int depth = plan_call_depth;
+	auto task = std::make_shared<std::packaged_task<PlanResult()>>([job = std::move(job), token, depth]() {
+		CallDepthScope scope(depth);
+		return job(token.get());
+	});
+	AsyncPlan handle(task->get_future().share(), token);
+	std::function<void()> run = [task]() { (*task)(); };
+	if (executor)
+		executor(std::move(run));
+	else
+		TaskExecutor::current()->post(std::move(run));
+	return handle;
+}
+
+PlannerInterface::AsyncPlan PlannerInterface::planAsync(const planning_scene::PlanningSceneConstPtr& from,
+                                                        const planning_scene::PlanningSceneConstPtr& to,
+                                                        const moveit::core::JointModelGroup* jmg, double timeout,
+                                                        const moveit_msgs::Constraints& path_constraints) {
+	return launch([this, from, to, jmg, timeout, path_constraints](const PreemptionToken* preempt) {
+		PlanResult result;
+		result.success = plan(from, to, jmg, timeout, result.trajectory, path_constraints, preempt);
+		return result;
+	});
+}
+
+PlannerInterface::AsyncPlan PlannerInterface::planAsync(const planning_scene::PlanningSceneConstPtr& from,
+                                                        const moveit::core::LinkModel& link,
+                                                        const Eigen::Isometry3d& target,
+                                                        const moveit::core::JointModelGroup* jmg, double timeout,
+                                                        const moveit_msgs::Constraints& path_constraints) {
+	const moveit::core::LinkModel* link_ptr = &link;
+	// unaligned copy: lambda captures don't respect Eigen's alignment requirements
+	const Eigen::Matrix<double, 4, 4, Eigen::DontAlign> pose = target.matrix();
+	return launch([this, from, link_ptr, pose, jmg, timeout, path_constraints](const PreemptionToken* preempt) {
+		PlanResult result;
+		result.success = plan(from, *link_ptr, Eigen::Isometry3d(Eigen::Matrix4d(pose)), jmg, timeout,
+		                      result.trajectory, path_constraints, preempt);
+		return result;
+	});
+}
+
+bool PlannerInterface::defersTimeParameterization() const {
+	return properties().get<bool>("defer_time_parameterization");
+}
+
+bool PlannerInterface::timeParameterize(robot_trajectory::RobotTrajectory& trajectory) const {
+	const auto& props = properties();
+	auto timing = props.get<TimeParameterizationPtr>("time_parameterization");
+	return timing->computeTimeStamps(trajectory, props.get<double>("max_velocity_scaling_factor"),
+	                                 props.get<double>("max_acceleration_scaling_factor"));
+}
+
+std::function<bool(robot_trajectory::RobotTrajectory&)>
+PlannerInterface::deferredTimeParameterization(const PlannerInterfacePtr& planner) {
+	if (!planner || !planner->defersTimeParameterization())
+		return nullptr;
+	return [planner](robot_trajectory::RobotTrajectory& trajectory) { return planner->timeParameterize(trajectory); };
+}
+
+bool PlannerInterface::addTiming(robot_trajectory::RobotTrajectory& trajectory) const {
+	if (!defersTimeParameterization())
+		return timeParameterize(trajectory);
+	utils::estimateTimeStamps(trajectory, properties().get<double>("max_velocity_scaling_factor"));
+	return true;
+}
+
+PlannerInterface::Statistics PlannerInterface::statistics() const {
+	std::lock_guard<std::mutex> lock(statistics_mutex_);
+	return statistics_;
+}
+
+void PlannerInterface::resetStatistics() {
+	std::lock_guard<std::mutex> lock(statistics_mutex_);
+	statistics_.clear();
+}
+
+PlannerInterface::CallRecorder::CallRecorder(PlannerInterface& planner, const moveit::core::JointModelGroup* jmg,
+                                             std::string planner_id,
+                                             robot_trajectory::RobotTrajectoryPtr& result)
+  : planner_(plan_call_depth == 0 ? &planner : nullptr)
+  , jmg_(jmg)
+  , planner_id_(std::move(planner_id))
+  , result_(result)
+  , start_(std::chrono::steady_clock::now()) {
+	++plan_call_depth;
+}
+
+PlannerInterface::CallRecorder::~CallRecorder() {
+	--plan_call_depth;
+	if (!planner_)
+		return;
+
+	PlanningRecord* record = PlanningRecord::active();
+	if (record && record->mode() == PlanningRecord::RECORD)
+		record->recordResponse(planner_id_, jmg_, success_, result_);
+
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+	std::lock_guard<std::mutex> lock(planner_->statistics_mutex_);
+	CallStatistics& s = planner_->statistics_[std::make_pair(jmg_ ? jmg_->getName() : std::string(), planner_id_)];
+	++s.calls;
+	s.planning_time.record(elapsed);
+	if (success_) {
+		++s.successes;
+		if (result_)
+			s.waypoints += result_->getWayPointCount();
+	}
+}
+
+bool PlannerInterface::CallRecorder::replay(const planning_scene::PlanningSceneConstPtr& from, bool& success) {
+	PlanningRecord* record = PlanningRecord::active();
+	if (!planner_ || !record || record->mode() != PlanningRecord::REPLAY)
+		return false;
+	if (record->replayResponse(planner_id_, from, jmg_, success, result_))
+		return true;
+	ROS_WARN_STREAM_NAMED("PlannerInterface", "no recorded response left for planner '" << planner_id_ << "'");
+	return false;
 }
 }  // namespace solvers
 }  // namespace task_constructor
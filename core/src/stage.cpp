@@ -37,23 +37,165 @@
 
 #include <moveit/task_constructor/stage_p.h>
 #include <moveit/task_constructor/container_p.h>
+#include <moveit/task_constructor/collision_backend.h>
 #include <moveit/task_constructor/introspection.h>
 #include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/task_constructor/task_executor.h>
+#include <moveit/task_constructor/solvers/planner_interface.h>
 
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 
 #include <ros/console.h>
+#include <ros/serialization.h>
 
 #include <boost/format.hpp>
 
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
 
 namespace moveit {
 namespace task_constructor {
 
+namespace {
+std::atomic<bool> memory_accounting{ false };
+
+// size of the scene's diff w.r.t. its parent, as a proxy for its memory
+size_t sceneMemory(const planning_scene::PlanningSceneConstPtr& scene) {
+	if (!scene)
+		return 0;
+	moveit_msgs::PlanningScene msg;
+	scene->getPlanningSceneDiffMsg(msg);
+	return sizeof(planning_scene::PlanningScene) + ros::serialization::serializationLength(msg);
+}
+
+size_t trajectoryMemory(const SolutionBase& solution) {
+	const auto* sub = dynamic_cast<const SubTrajectory*>(&solution);
+	if (!sub)
+		return 0;
+	if (auto compressed = sub->compressed())
+		return compressed->memory();
+	const auto traj = sub->trajectory();
+	if (!traj)
+		return 0;
+	const robot_trajectory::RobotTrajectory& trajectory = *traj;
+	const moveit::core::RobotModel& model = *trajectory.getRobotModel();
+	// each waypoint stores positions, velocities, accelerations, and link transforms
+	const size_t waypoint = sizeof(moveit::core::RobotState) + sizeof(double) +
+	                        3 * model.getVariableCount() * sizeof(double) +
+	                        (model.getJointModelCount() + model.getLinkModelCount()) * sizeof(Eigen::Isometry3d);
+	return sizeof(robot_trajectory::RobotTrajectory) + trajectory.getWayPointCount() * waypoint;
+}
+
+// dedicated thread calling a solution callback for queued solutions, see CallbackDispatch
+class SolutionCallbackExecutor
+{
+public:
+	SolutionCallbackExecutor(Stage::SolutionCallback&& cb, const CallbackDispatch& dispatch)
+	  : cb_(std::move(cb)), capacity_(std::max<size_t>(1, dispatch.queue_size)), overflow_(dispatch.overflow) {
+		thread_ = TaskExecutor::current()->spawn([this]() { run(); });
+	}
+	// process all queued solutions before finishing
+	~SolutionCallbackExecutor() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopped_ = true;
+		}
+		cv_.notify_all();
+		thread_.join();
+		if (dropped_)
+			ROS_WARN_STREAM_NAMED("Stage", "Asynchronous solution callback dropped " << dropped_ << " solutions");
+	}
+
+	void push(const SolutionBaseConstPtr& solution) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (queue_.size() >= capacity_) {
+			switch (overflow_) {
+				case CallbackDispatch::BLOCK:
+					cv_.wait(lock, [this]() { return queue_.size() < capacity_; });
+					break;
+				case CallbackDispatch::DROP_NEWEST:
+					++dropped_;
+					return;
+				case CallbackDispatch::DROP_OLDEST:
+					++dropped_;
+					queue_.pop_front();
+					break;
+			}
+		}
+		queue_.push_back(solution);
+		lock.unlock();
+		cv_.notify_all();
+	}
+
+	void flush() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		cv_.wait(lock, [this]() { return queue_.empty() && !busy_; });
+	}
+
+	// synchronous call, never concurrent to the executor's thread
+	void call(const SolutionBase& solution) {
+		std::lock_guard<std::mutex> lock(call_mutex_);
+		try {
+			cb_(solution);
+		} catch (const std::exception& e) {
+			ROS_ERROR_STREAM_NAMED("Stage", "Asynchronous solution callback failed: " << e.what());
+		}
+	}
+
+private:
+	void run() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (true) {
+			cv_.wait(lock, [this]() { return !queue_.empty() || stopped_; });
+			if (queue_.empty())
+				return;  // stopped and drained
+			SolutionBaseConstPtr solution = std::move(queue_.front());
+			queue_.pop_front();
+			busy_ = true;
+			lock.unlock();
+			cv_.notify_all();  // wake up a blocked producer
+			call(*solution);
+			solution.reset();
+			lock.lock();
+			busy_ = false;
+			cv_.notify_all();  // wake up flush()
+		}
+	}
+
+	Stage::SolutionCallback cb_;
+	const size_t capacity_;
+	const CallbackDispatch::Overflow overflow_;
+
+	std::mutex mutex_;  // protects all items below
+	std::condition_variable cv_;
+	std::deque<SolutionBaseConstPtr> queue_;
+	size_t dropped_ = 0;
+	bool busy_ = false;
+	bool stopped_ = false;
+
+	std::mutex call_mutex_;
+	std::thread thread_;
+};
+
+// solution callback forwarding solutions to a SolutionCallbackExecutor, identified via std::function::target()
+struct AsyncSolutionCallback
+{
+	std::shared_ptr<SolutionCallbackExecutor> executor;
+	void operator()(const SolutionBase& solution) const { executor->call(solution); }
+};
+}  // namespace
+
 template <>
 const char* flowSymbol<START_IF_MASK>(InterfaceFlags f) {
 	f = f & START_IF_MASK;
@@ -103,8 +245,19 @@ StagePrivate::StagePrivate(Stage* me, const std::string& name)
   , name_{ name }
   , cost_term_{ std::make_unique<CostTerm>() }
   , total_compute_time_{}
+  , compute_since_solution_{}
   , parent_{ nullptr }
-  , introspection_{ nullptr } {}
+  , frozen_prev_ends_{ nullptr }
+  , frozen_next_starts_{ nullptr }
+  , init_version_{ 0 }
+  , init_parent_version_{ 0 }
+  , init_dirty_{ true }
+  , introspection_{ nullptr }
+  , planning_mutex_{ nullptr }
+  , preempt_token_{ nullptr }
+  , time_budget_{ std::numeric_limits<double>::infinity() }
+  , cost_bound_{ std::numeric_limits<double>::infinity() }
+  , snapshot_{ std::make_shared<const StageSnapshot>() } {}
 
 StagePrivate& StagePrivate::operator=(StagePrivate&& other) {
 	assert(typeid(*this) == typeid(other));
@@ -119,12 +272,24 @@ StagePrivate& StagePrivate::operator=(StagePrivate&& other) {
 	name_ = std::move(other.name_);
 	properties_ = std::move(other.properties_);
 	cost_term_ = std::move(other.cost_term_);
+	lazy_cost_ = other.lazy_cost_;
+	timeout_policy_ = other.timeout_policy_;
+	own_timeout_policy_ = other.own_timeout_policy_;
 	solution_cbs_ = std::move(other.solution_cbs_);
+	num_async_cbs_ = other.num_async_cbs_;
+	other.num_async_cbs_ = 0;
+	monitors_ = std::move(other.monitors_);
 
 	starts_ = std::move(other.starts_);
 	ends_ = std::move(other.ends_);
 	prev_ends_ = std::move(other.prev_ends_);
 	next_starts_ = std::move(other.next_starts_);
+	frozen_prev_ends_ = frozen_next_starts_ = nullptr;
+	init_model_ = other.init_model_;
+	init_planners_ = other.init_planners_;
+	init_version_ = other.init_version_;
+	init_parent_version_ = other.init_parent_version_;
+	init_dirty_ = other.init_dirty_;
 
 	parent_ = std::move(other.parent_);
 	it_ = std::move(other.it_);
@@ -133,6 +298,74 @@ StagePrivate& StagePrivate::operator=(StagePrivate&& other) {
 	return *this;
 }
 
+bool StagePrivate::needsInit(const moveit::core::RobotModelConstPtr& robot_model) const {
+	// an expired model never equals a valid one, even if a new model reuses its address
+	return init_dirty_ || init_model_.lock() != robot_model || propertiesChanged() || plannersChanged();
+}
+
+bool StagePrivate::propertiesChanged() const {
+	return init_model_.expired() || properties_.version() != init_version_ ||
+	       (parent_ && parent_->properties().version() != init_parent_version_);
+}
+
+bool StagePrivate::plannersChanged() const {
+	const std::vector<solvers::PlannerInterfaceConstPtr> planners = me()->planners();
+	if (planners.size() != init_planners_.size())
+		return true;
+	for (size_t i = 0; i < planners.size(); ++i)
+		if (init_planners_[i].first.lock() != planners[i] ||
+		    (planners[i] && planners[i]->properties().version() != init_planners_[i].second))
+			return true;
+	return false;
+}
+
+void StagePrivate::markInitialized(const moveit::core::RobotModelConstPtr& robot_model) {
+	init_model_ = robot_model;
+	init_version_ = properties_.version();
+	init_parent_version_ = parent_ ? parent_->properties().version() : 0;
+	init_planners_.clear();
+	for (const solvers::PlannerInterfaceConstPtr& planner : me()->planners())
+		init_planners_.emplace_back(planner, planner ? planner->properties().version() : 0);
+	init_dirty_ = false;
+}
+
+bool StagePrivate::deadlineExceeded() const {
+	if (const auto* container = dynamic_cast<const ContainerBasePrivate*>(this))
+		if (container->ownDeadlineExceeded())
+			return true;
+	for (const StagePrivate* stage = this; stage->parent(); stage = stage->parent()->pimpl())
+		if (stage->parent()->pimpl()->ownDeadlineExceeded())
+			return true;
+	return false;
+}
+
+void StagePrivate::chargeDeadlines(std::chrono::steady_clock::duration elapsed) {
+	if (auto* container = dynamic_cast<ContainerBasePrivate*>(this))
+		container->chargeDeadline(elapsed);
+	// a computing ancestor accounts the time of its children on its own
+	for (StagePrivate* stage = this; stage->parent(); stage = stage->parent()->pimpl()) {
+		ContainerBasePrivate* parent = stage->parent()->pimpl();
+		if (parent->computing_)
+			break;
+		parent->chargeDeadline(elapsed);
+	}
+}
+
+const StagePrivate* StagePrivate::consumer(Interface::Direction dir) const {
+	for (const StagePrivate* stage = this; stage->parent(); stage = stage->parent()->pimpl()) {
+		const ContainerBasePrivate* parent = stage->parent()->pimpl();
+		if (!dynamic_cast<const SerialContainerPrivate*>(parent))
+			continue;  // parallel siblings don't consume our states: ask the parent's neighbors
+		const auto& siblings = parent->children();
+		auto it = stage->it();
+		if (dir == Interface::FORWARD && ++it != siblings.end())
+			return (*it)->pimpl();
+		if (dir == Interface::BACKWARD && it != siblings.begin())
+			return (*--it)->pimpl();
+	}
+	return nullptr;
+}
+
 InterfaceFlags StagePrivate::interfaceFlags() const {
 	InterfaceFlags f;
 	if (starts())
@@ -163,6 +396,7 @@ bool StagePrivate::storeSolution(const SolutionBasePtr& solution, const Interfac
 	solution->setCreator(me());
 	if (introspection_)
 		introspection_->registerSolution(*solution);
+	++changes_;
 
 	if (solution->isFailure()) {
 		++num_failures_;
@@ -170,10 +404,20 @@ bool StagePrivate::storeSolution(const SolutionBasePtr& solution, const Interfac
 			parent()->pimpl()->onNewFailure(*me(), from, to);
 		if (!storeFailures())
 			return false;  // drop solution
+		countFailureReason(solution->failureReason());
+		if (!sampleFailure()) {
+			introspection_->unregisterSolution(*solution);
+			return false;  // not sampled
+		}
 		failures_.push_back(solution);
 	} else {
 		solutions_.insert(solution);
 	}
+
+	if (Stage::memoryAccounting()) {
+		memory_.trajectories += trajectoryMemory(*solution);
+		accountMarkers(solutionMarkerMemory(*solution));  // deferred markers aren't generated yet
+	}
 	return true;
 }
 
@@ -186,15 +430,25 @@ void StagePrivate::sendForward(const InterfaceState& from, InterfaceState&& to,
 		return;  // solution dropped
 
 	me()->forwardProperties(from, to);
+	to.compactScene(max_scene_depth_);
+
+	size_t hash = 0;
+	if (InterfaceState* duplicate = findDuplicate(Interface::FORWARD, to, *solution, hash)) {
+		solution->setStartState(from);
+		solution->setEndState(*duplicate);
+		newSolution(solution);
+		return;
+	}
 
 	auto to_it = states_.insert(states_.end(), std::move(to));
+	accountState(*to_it, from.scene());
 
 	// register stored interfaces with solution
 	solution->setStartState(from);
 	solution->setEndState(*to_it);
 
 	if (!solution->isFailure())
-		nextStarts()->add(*to_it);
+		announceState(Interface::FORWARD, *to_it, hash);
 
 	newSolution(solution);
 }
@@ -208,14 +462,24 @@ void StagePrivate::sendBackward(InterfaceState&& from, const InterfaceState& to,
 		return;  // solution dropped
 
 	me()->forwardProperties(to, from);
+	from.compactScene(max_scene_depth_);
+
+	size_t hash = 0;
+	if (InterfaceState* duplicate = findDuplicate(Interface::BACKWARD, from, *solution, hash)) {
+		solution->setStartState(*duplicate);
+		solution->setEndState(to);
+		newSolution(solution);
+		return;
+	}
 
 	auto from_it = states_.insert(states_.end(), std::move(from));
+	accountState(*from_it, to.scene());
 
 	solution->setStartState(*from_it);
 	solution->setEndState(to);
 
 	if (!solution->isFailure())
-		prevEnds()->add(*from_it);
+		announceState(Interface::BACKWARD, *from_it, hash);
 
 	newSolution(solution);
 }
@@ -228,20 +492,119 @@ void StagePrivate::spawn(InterfaceState&& state, const SolutionBasePtr& solution
 	if (!storeSolution(solution, nullptr, nullptr))
 		return;  // solution dropped
 
-	auto from = states_.insert(states_.end(), InterfaceState(state));  // copy
-	auto to = states_.insert(states_.end(), std::move(state));
+	state.compactScene(max_scene_depth_);
+	size_t from_hash = 0, to_hash = 0;
+	InterfaceState* from_duplicate = findDuplicate(Interface::BACKWARD, state, *solution, from_hash);
+	InterfaceState* to_duplicate = findDuplicate(Interface::FORWARD, state, *solution, to_hash);
+
+	InterfaceState* from = from_duplicate;
+	InterfaceState* to = to_duplicate;
+	planning_scene::PlanningSceneConstPtr known_scene;
+	if (!from) {
+		from = &*states_.insert(states_.end(), InterfaceState(state));  // copy
+		accountState(*from, nullptr);
+		known_scene = from->scene();
+	}
+	if (!to) {
+		to = &*states_.insert(states_.end(), std::move(state));
+		accountState(*to, known_scene);  // shared scene
+	}
 
 	solution->setStartState(*from);
 	solution->setEndState(*to);
 
 	if (!solution->isFailure()) {
-		prevEnds()->add(*from);
-		nextStarts()->add(*to);
+		if (!from_duplicate)
+			announceState(Interface::BACKWARD, *from, from_hash);
+		if (!to_duplicate)
+			announceState(Interface::FORWARD, *to, to_hash);
 	}
 
 	newSolution(solution);
 }
 
+InterfaceState* StagePrivate::findDuplicate(Interface::Direction dir, const InterfaceState& state,
+                                            const SolutionBase& solution, size_t& hash) {
+	if (!(dedup_resolution_ > 0.0) || solution.isFailure())
+		return nullptr;
+	hash = state.contentHash(dedup_resolution_);
+	auto range = dedup_index_[dir].equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		InterfaceState* duplicate = it->second;
+		if (!duplicate->sameContent(state, dedup_resolution_))
+			continue;
+		// containers update priorities along the whole solution path, otherwise the cheapest solution counts
+		const InterfaceState::Priority& prio = duplicate->priority();
+		if (prio.depth() == 1 && solution.cost() < prio.cost())
+			duplicate->updatePriority(InterfaceState::Priority(1, solution.cost(), prio.status()));
+		return duplicate;
+	}
+	return nullptr;
+}
+
+void StagePrivate::indexState(Interface::Direction dir, InterfaceState& state, size_t hash) {
+	if (dedup_resolution_ > 0.0)
+		dedup_index_[dir].emplace(hash, &state);
+}
+
+void StagePrivate::announceState(Interface::Direction dir, InterfaceState& state, size_t hash) {
+	if (batching_) {
+		batch_states_[dir].emplace_back(&state, hash);
+		return;
+	}
+	indexState(dir, state, hash);
+	(dir == Interface::FORWARD ? nextStartsRaw() : prevEndsRaw())->add(state);
+}
+
+void StagePrivate::beginBatch() {
+	assert(!batching_);
+	batching_ = true;
+}
+
+void StagePrivate::endBatch() {
+	assert(batching_);
+	batching_ = false;
+
+	for (Interface::Direction dir : { Interface::BACKWARD, Interface::FORWARD }) {
+		auto& pending = batch_states_[dir];
+		if (pending.empty())
+			continue;
+		std::vector<InterfaceState*> states;
+		states.reserve(pending.size());
+		for (const auto& entry : pending) {
+			indexState(dir, *entry.first, entry.second);
+			states.push_back(entry.first);
+		}
+		pending.clear();
+		(dir == Interface::FORWARD ? nextStartsRaw() : prevEndsRaw())->add(states);
+	}
+
+	std::vector<SolutionBasePtr> solutions;
+	solutions.swap(batch_solutions_);
+	std::vector<const SolutionBase*> valid;
+	valid.reserve(solutions.size());
+	for (const SolutionBasePtr& solution : solutions)
+		if (!solution->isFailure())  // might have failed meanwhile, e.g. by lazy validation
+			valid.push_back(solution.get());
+	if (parent() && !valid.empty())
+		parent()->onNewSolutions(valid);
+
+	// monitoring generators keep raw pointers to our solutions
+	if (!solution_cbs_.empty() || !monitors_.empty())
+		return;
+	evictFailures();
+	evictSolutions();
+}
+
+void StagePrivate::accountState(const InterfaceState& state,
+                                const planning_scene::PlanningSceneConstPtr& known_scene) {
+	if (!Stage::memoryAccounting())
+		return;
+	memory_.states += sizeof(InterfaceState);
+	if (state.scene() != known_scene)
+		memory_.scenes += sceneMemory(state.scene());
+}
+
 void StagePrivate::connect(const InterfaceState& from, const InterfaceState& to, const SolutionBasePtr& solution) {
 	computeCost(from, to, *solution);
 
@@ -255,12 +618,377 @@ void StagePrivate::connect(const InterfaceState& from, const InterfaceState& to,
 }
 
 void StagePrivate::newSolution(const SolutionBasePtr& solution) {
+	if (!solution->isFailure()) {
+		auto now = std::chrono::steady_clock::now();
+		std::chrono::duration<double> elapsed = compute_since_solution_;
+		if (computing_) {  // account for the running compute() call
+			elapsed += now - solution_mark_;
+			solution_mark_ = now;
+		}
+		solution_latency_.record(elapsed.count());
+		compute_since_solution_ = std::chrono::duration<double>::zero();
+		compute_succeeded_ |= computing_;
+	}
+
 	// call solution callbacks for both, valid solutions and failures
-	for (const auto& cb : solution_cbs_)
-		cb(*solution);
+	callSolutionCallbacks(*solution, solution);
+	if (!monitors_.empty() && !solution->isFailure()) {
+		monitor_batch_.push_back(solution.get());
+		if (!computing_)  // otherwise hand over all solutions of compute() at once
+			notifyMonitors();
+	}
+
+	if (batching_) {  // parent notification and eviction are deferred to endBatch()
+		if (!solution->isFailure())
+			batch_solutions_.push_back(solution);
+		return;
+	}
 
 	if (parent() && !solution->isFailure())
 		parent()->onNewSolution(*solution);
+
+	// monitoring generators keep raw pointers to our solutions
+	if (!solution_cbs_.empty() || !monitors_.empty())
+		return;
+	if (solution->isFailure())
+		evictFailures();
+	else
+		evictSolutions();
+}
+
+void StagePrivate::notifyMonitors() {
+	if (monitor_batch_.empty())
+		return;
+	std::vector<const SolutionBase*> batch;
+	batch.swap(monitor_batch_);  // monitors might trigger new solutions
+	// solutions might have failed meanwhile, e.g. by lazy validation
+	batch.erase(std::remove_if(batch.begin(), batch.end(), [](const SolutionBase* s) { return s->isFailure(); }),
+	            batch.end());
+	std::stable_sort(batch.begin(), batch.end(),
+	                 [](const SolutionBase* a, const SolutionBase* b) { return a->cost() < b->cost(); });
+	for (MonitoringGeneratorPrivate* monitor : monitors_)
+		monitor->notify(batch);
+}
+
+void StagePrivate::callSolutionCallbacks(const SolutionBase& solution, const SolutionBaseConstPtr& shared) const {
+	for (const auto& cb : solution_cbs_) {
+		const auto* async = cb.target<AsyncSolutionCallback>();
+		if (async && shared)
+			async->executor->push(shared);
+		else
+			cb(solution);
+	}
+}
+
+void StagePrivate::runStep(const std::function<void()>& step, bool resumed) {
+	ROS_DEBUG_STREAM_NAMED("Stage", "Computing stage '" << name() << "'");
+	MTC_TRACE_SCOPE("compute", name());
+	auto compute_start_time = std::chrono::steady_clock::now();
+	solution_mark_ = compute_start_time;
+	if (stall_policy_.enabled())
+		armStallDeadline(compute_start_time);
+	computing_ = true;
+	compute_succeeded_ = false;
+	// timeout of this call, only needed to detect censored durations for the adaptive timeout
+	const double limit = timeout_policy_.enabled() && !properties_.get("timeout").empty() ? me()->timeout() : 0.0;
+	try {
+		step();
+	} catch (const Property::error& e) {
+		computing_ = false;
+		me()->reportPropertyError(e);
+	}
+	computing_ = false;
+	if (stall_policy_.enabled())
+		disarmStallDeadline();
+	notifyMonitors();
+	auto compute_stop_time = std::chrono::steady_clock::now();
+	std::chrono::duration<double> elapsed = compute_stop_time - compute_start_time;
+	total_compute_time_ += elapsed;
+	chargeDeadlines(compute_stop_time - compute_start_time);
+	++changes_;
+	compute_since_solution_ += compute_stop_time - solution_mark_;
+	if (!resumed) {
+		compute_latency_.record(elapsed.count());
+		if (compute_succeeded_)
+			success_latency_.record(elapsed.count());
+		else if (limit > 0.0 && elapsed.count() >= limit)
+			++timed_out_;
+	}
+	logEvent(event_source_, EventLog::COMPUTE, elapsed.count(), compute_succeeded_);
+}
+
+void StagePrivate::flushSolutionCallbacks() const {
+	if (!num_async_cbs_)
+		return;
+	for (const auto& cb : solution_cbs_)
+		if (const auto* async = cb.target<AsyncSolutionCallback>())
+			async->executor->flush();
+}
+
+void StagePrivate::publishSnapshot(uint64_t epoch) {
+	if (changes_ == published_changes_)
+		return;
+	auto snapshot = std::make_shared<StageSnapshot>();
+	snapshot->epoch = epoch;
+	const StageSnapshotConstPtr previous = std::atomic_load(&snapshot_);
+	if (solutions_.revision() == published_revision_)
+		snapshot->ranking = previous->ranking;  // only statistics changed
+	else {
+		auto ranking = std::make_shared<StageSnapshot::Ranking>();
+		ranking->solutions.assign(solutions_.begin(), solutions_.end());
+		ranking->costs.reserve(solutions_.size());
+		for (const SolutionBaseConstPtr& solution : solutions_)
+			ranking->costs.push_back(solution->cost());
+		snapshot->ranking = std::move(ranking);
+		published_revision_ = solutions_.revision();
+	}
+	snapshot->num_failures = num_failures_;
+	snapshot->total_compute_time = total_compute_time_.count();
+	std::atomic_store(&snapshot_, StageSnapshotConstPtr(std::move(snapshot)));
+	published_changes_ = changes_;
+}
+
+constexpr int64_t StagePrivate::STALL_REPORTED;
+
+void StagePrivate::armStallDeadline(std::chrono::steady_clock::time_point start) {
+	// Stage::timeout() throws for undefined timeouts, which are common
+	double timeout = properties_.get("timeout").empty() ? 0.0 : me()->timeout();
+	if (timeout <= 0.0 || !std::isfinite(timeout))
+		timeout = stall_policy_.default_timeout;
+	// limit to a year to avoid overflows of huge timeouts
+	const double limit = std::min(stall_policy_.factor * timeout, 3.15e7);
+	const auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+	                                  std::chrono::duration<double>(limit));
+	compute_start_.store(start.time_since_epoch().count(), std::memory_order_relaxed);
+	stall_deadline_.store(deadline.time_since_epoch().count(), std::memory_order_release);
+}
+
+void StagePrivate::disarmStallDeadline() {
+	stall_deadline_.store(0, std::memory_order_release);
+	compute_input_.store(0, std::memory_order_relaxed);
+}
+
+void StagePrivate::noteComputeInput(const InterfaceState& state) {
+	// resolve the id in the computing thread: the watchdog must not access the state, nor keep a dangling pointer
+	if (stall_policy_.enabled() && introspection_)
+		compute_input_.store(introspection_->stateId(state), std::memory_order_relaxed);
+}
+
+bool StagePrivate::stalled(std::chrono::steady_clock::time_point now) const {
+	const int64_t deadline = stall_deadline_.load(std::memory_order_acquire);
+	return deadline == STALL_REPORTED || (deadline != 0 && now.time_since_epoch().count() > deadline);
+}
+
+bool StagePrivate::claimStall(std::chrono::steady_clock::time_point now, double& running, uint32_t& input) {
+	int64_t deadline = stall_deadline_.load(std::memory_order_acquire);
+	if (deadline == 0 || deadline == STALL_REPORTED || now.time_since_epoch().count() <= deadline ||
+	    !stall_deadline_.compare_exchange_strong(deadline, STALL_REPORTED))
+		return false;
+	const std::chrono::steady_clock::duration start(compute_start_.load(std::memory_order_relaxed));
+	running = std::chrono::duration<double>(now.time_since_epoch() - start).count();
+	input = compute_input_.load(std::memory_order_relaxed);
+	return true;
+}
+
+void StagePrivate::evictSolutions() {
+	const size_t max = properties_.get<size_t>("max_stored_solutions");
+	if (max == 0 || solutions_.size() <= max)
+		return;
+
+	// drop worst solutions first
+	for (auto it = solutions_.end(); it != solutions_.begin() && solutions_.size() > max;) {
+		--it;
+		const SolutionBase& solution = **it;
+		if (parent() && parent()->pimpl()->refersTo(solution))
+			continue;
+		evictSolution(solution);
+		it = solutions_.erase(it);
+	}
+}
+
+void StagePrivate::evictFailures() {
+	const size_t max = properties_.get<size_t>("max_stored_failures");
+	if (max == 0)
+		return;
+
+	// drop oldest failures first, but keep the head of sampled failures
+	auto it = failures_.begin();
+	if (properties_.get<bool>("sample_failures"))
+		std::advance(it, std::min(failures_.size(), max / 2));
+	while (it != failures_.end() && failures_.size() > max) {
+		if (parent() && parent()->pimpl()->refersTo(**it)) {
+			++it;
+			continue;
+		}
+		releaseSolution(**it);
+		releaseStates(**it);
+		it = failures_.erase(it);
+	}
+}
+
+constexpr size_t StagePrivate::MAX_FAILURE_REASONS;
+
+void StagePrivate::countFailureReason(const std::string& reason) {
+	auto it = failure_reasons_.find(reason);
+	if (it == failure_reasons_.end() && failure_reasons_.size() >= MAX_FAILURE_REASONS)
+		it = failure_reasons_.find("other");
+	if (it == failure_reasons_.end())
+		it = failure_reasons_.emplace(failure_reasons_.size() + 1 < MAX_FAILURE_REASONS ? reason : "other", 0).first;
+	++it->second;
+}
+
+bool StagePrivate::sampleFailure() {
+	const size_t max = properties_.get<size_t>("max_stored_failures");
+	if (max == 0 || !properties_.get<bool>("sample_failures"))
+		return true;
+
+	// reservoir sampling of all failures beyond the head
+	const size_t head = max / 2;
+	const size_t reservoir = max - head;
+	const size_t offered = ++num_offered_failures_;
+	if (offered <= max || failures_.size() < max)
+		return true;
+
+	const size_t slot = std::uniform_int_distribution<size_t>(0, offered - head - 1)(failure_rng_);
+	if (slot >= reservoir)
+		return false;
+	auto it = std::next(failures_.begin(), std::min(failures_.size() - 1, head + slot));
+	if (parent() && parent()->pimpl()->refersTo(**it))
+		return false;  // cannot drop the sampled failure: skip the new one instead
+	releaseSolution(**it);
+	failures_.erase(it);
+	return true;
+}
+
+void StagePrivate::releaseSolution(const SolutionBase& solution) {
+	const_cast<SolutionBase&>(solution).unregisterFromStates();
+	if (introspection_)
+		introspection_->unregisterSolution(solution);
+	if (Stage::memoryAccounting()) {
+		memory_.trajectories -= std::min(memory_.trajectories, trajectoryMemory(solution));
+		releaseMarkers(solutionMarkerMemory(solution));
+	}
+}
+
+void StagePrivate::evictSolution(const SolutionBase& solution) {
+	if (parent())
+		parent()->pimpl()->pruneEvictedSolution(*me(), solution);
+	evicted_.add(solution.cost());
+	releaseSolution(solution);
+	releaseStates(solution);
+	++changes_;
+}
+
+void StagePrivate::releaseStates(const SolutionBase& solution) {
+	// states created for the solution, which are not connected to any other solution anymore
+	std::vector<InterfaceState*> dead;
+	auto collect = [&dead](const InterfaceState* state) {
+		if (state && state->incomingTrajectories().empty() && state->outgoingTrajectories().empty() &&
+		    std::find(dead.begin(), dead.end(), state) == dead.end())
+			dead.push_back(const_cast<InterfaceState*>(state));
+	};
+	const InterfaceFlags flags = interfaceFlags();
+	if (flags & WRITES_PREV_END)
+		collect(solution.start());
+	if (flags & WRITES_NEXT_START)
+		collect(solution.end());
+
+	for (InterfaceState* state : dead) {
+		// pruned states must not be found as duplicates anymore
+		if (dedup_resolution_ > 0.0) {
+			const size_t hash = state->contentHash(dedup_resolution_);
+			for (auto& index : dedup_index_) {
+				auto range = index.equal_range(hash);
+				for (auto it = range.first; it != range.second;)
+					it = it->second == state ? index.erase(it) : std::next(it);
+			}
+		}
+		if (Stage::memoryAccounting())
+			memory_.states -= std::min(memory_.states, sizeof(InterfaceState));
+	}
+	// Dead states remain (pruned) in their interfaces, but their own scene diffs aren't needed anymore:
+	// replace them with their parent scene if not shared with other states.
+	for (InterfaceState* state : dead) {
+		const planning_scene::PlanningSceneConstPtr scene = state->scene();
+		if (!scene || !scene->getParent())
+			continue;
+		const long holders = std::count_if(dead.begin(), dead.end(),
+		                                   [&scene](const InterfaceState* s) { return s->scene() == scene; });
+		if (scene.use_count() != holders + 1)  // + local copy
+			continue;
+		if (Stage::memoryAccounting())
+			memory_.scenes -= std::min(memory_.scenes, sceneMemory(scene));
+		for (InterfaceState* s : dead)
+			if (s->scene() == scene)
+				s->scene_ = scene->getParent();
+	}
+}
+
+size_t StagePrivate::solutionMarkerMemory(const SolutionBase& solution) {
+	size_t bytes = 0;
+	for (const visualization_msgs::Marker& marker : solution.markers_)
+		bytes += markerMemory(marker);
+	return bytes;
+}
+
+void StagePrivate::releaseMarkers(size_t bytes) const {
+	// markers accounted before accounting was enabled were never added
+	size_t current = marker_memory_;
+	while (!marker_memory_.compare_exchange_weak(current, current - std::min(current, bytes)))
+		;
+}
+
+void StagePrivate::reduceMemory(bool evict_solutions) {
+	// drop all markers, which are only needed for visualization
+	auto drop_markers = [this](const SolutionBaseConstPtr& solution) {
+		size_t bytes = 0;
+		for (const visualization_msgs::Marker& marker : solution->dropMarkers())
+			bytes += markerMemory(marker);
+		releaseMarkers(bytes);
+	};
+	std::for_each(solutions_.begin(), solutions_.end(), drop_markers);
+	std::for_each(failures_.begin(), failures_.end(), drop_markers);
+
+	// drop failure traces (except those referred to by the parent)
+	for (auto it = failures_.begin(); it != failures_.end();) {
+		if (parent() && parent()->pimpl()->refersTo(**it)) {
+			++it;
+			continue;
+		}
+		releaseSolution(**it);
+		releaseStates(**it);
+		it = failures_.erase(it);
+	}
+
+	if (!evict_solutions)
+		return;
+
+	// drop the worse half of solutions, which are not part of any parent solution, always keeping the best one
+	const size_t keep = std::max<size_t>(1, solutions_.size() / 2);
+	for (auto it = solutions_.end(); it != solutions_.begin() && solutions_.size() > keep;) {
+		--it;
+		const SolutionBase& solution = **it;
+		if (parent() && parent()->pimpl()->refersTo(solution))
+			continue;
+		evictSolution(solution);
+		it = solutions_.erase(it);
+	}
+}
+
+size_t StagePrivate::compressSolutions(double tolerance) {
+	size_t compressed = 0;
+	for (auto it = solutions_.begin(); it != solutions_.end(); ++it) {
+		auto* sub = dynamic_cast<SubTrajectory*>(const_cast<SolutionBase*>(it->get()));
+		if (it == solutions_.begin() || !sub || sub->compressed())
+			continue;
+		const size_t before = trajectoryMemory(*sub);
+		if (!sub->compress(tolerance))
+			continue;
+		if (Stage::memoryAccounting())
+			memory_.trajectories = memory_.trajectories - std::min(memory_.trajectories, before) + trajectoryMemory(*sub);
+		++compressed;
+	}
+	return compressed;
 }
 
 // To solve the chicken-egg problem in computeCost() and provide proper states at both ends of the solution,
@@ -288,36 +1016,242 @@ void StagePrivate::computeCost(const InterfaceState& from, const InterfaceState&
 	if (solution.isFailure())
 		return;
 
+	assert(cost_term_);
+	if (lazy_cost_) {
+		// rank by the term's lower bound until the Task asks for the actual cost via resolvePendingCost()
+		solution.deferred_cost_ = solution.cost_;
+		solution.cost_pending_ = true;
+		solution.setCost(cost_term_->lowerBound(from, to));
+		return;
+	}
+
 	// Temporarily set start/end states of the solution w/o actually registering the solution with them
 	// This allows CostTerms to compute costs based on the InterfaceState.
 	TmpSolutionContext tip(solution, me(), from, to);
+	evaluateCost(solution);
+}
 
+void StagePrivate::evaluateCost(SolutionBase& solution) {
 	std::string comment;
-	assert(cost_term_);
-	solution.setCost(solution.computeCost(*cost_term_, comment));
+	{
+		MTC_TRACE_SCOPE("cost", name());
+		solution.setCost(solution.memoizedCost(*cost_term_, comment));
+	}
 
 	// If a comment was specified, add it to the solution
-	if (!comment.empty() && !solution.comment().empty()) {
-		solution.setComment(solution.comment() + " (" + comment + ")");
-	} else if (!comment.empty()) {
-		solution.setComment(comment);
+	if (!comment.empty())
+		solution.formatComment([comment = std::move(comment)](std::string& c) {
+			c = c.empty() ? comment : c + " (" + comment + ")";
+		});
+}
+
+double StagePrivate::resolvePendingCost(const SolutionBase& solution) {
+	if (!solution.costPending())
+		return 0.0;
+
+	auto& s = const_cast<SolutionBase&>(solution);
+	const double provisional = s.cost();
+	s.setCost(s.deferred_cost_);
+	s.cost_pending_ = false;
+	evaluateCost(s);  // solution is stored, i.e. its states are known
+	rerankSolution(s, "cost term failed");
+	return s.cost() - provisional;
+}
+
+double StagePrivate::shiftCost(const SolutionBase& solution, double delta) {
+	auto& s = const_cast<SolutionBase&>(solution);
+	if (s.cost_pending_) {  // provisional cost doesn't depend on sub solutions
+		s.deferred_cost_ += delta;
+		return 0.0;
+	}
+
+	const double previous = s.cost();
+	s.setCost(previous + delta);
+	s.memoized_costs_.clear();  // outdated by the changed sub solutions
+	std::string comment;
+	s.setCost(s.memoizedCost(*cost_term_, comment));  // keep the comment of the initial evaluation
+	rerankSolution(s, "cost term failed");
+	return s.cost() - previous;
+}
+
+void StagePrivate::rerankSolution(const SolutionBase& solution, const std::string& msg) {
+	auto it = std::find_if(solutions_.begin(), solutions_.end(),
+	                       [&solution](const SolutionBaseConstPtr& s) { return s.get() == &solution; });
+	if (it == solutions_.end())
+		return;  // not stored (anymore)
+	++changes_;
+	if (solution.isFailure()) {
+		invalidateSolution(it, msg);
+		// prune instead of onInvalidSolution(): planning the same state pair again would yield the same cost
+		StagePrivate::onInvalidSolution(solution);
+	} else
+		solutions_.update(it);
+}
+
+SceneUpdate::SceneUpdate(const moveit_msgs::PlanningScene& diff) : objects(diff.world.collision_objects) {
+	for (const auto& object : objects)
+		ids.insert(object.id);
+}
+
+void SceneUpdate::apply(InterfaceState& state) {
+	if (objects.empty())
+		return;
+	// scenes are shared (and immutable): create an updated diff only once per original scene
+	auto& scene = updated[state.scene().get()];
+	if (!scene) {
+		auto diff = state.scene()->diff();
+		for (const auto& object : objects)
+			diff->processCollisionObjectMsg(object);
+		scene = diff;
+	}
+	state.scene_ = scene;
+}
+
+bool SceneUpdate::collides(const SolutionBase& solution, const planning_scene::PlanningScene& scene) const {
+	if (ids.empty())
+		return false;
+	if (const auto* sequence = dynamic_cast<const SolutionSequence*>(&solution)) {
+		for (const SolutionSequence::Leaf& leaf : sequence->flattened().leaves)
+			if (collides(*leaf.trajectory, scene))
+				return true;
+		return false;
+	}
+	const auto* sub = dynamic_cast<const SubTrajectory*>(&solution);
+	const auto traj = sub ? sub->trajectory() : nullptr;
+	if (!traj)
+		return false;
+
+	collision_detection::CollisionRequest req;
+	req.contacts = true;
+	req.max_contacts = 100;
+	const auto& trajectory = *traj;
+	for (size_t i = 0; i != trajectory.getWayPointCount(); ++i) {
+		collision_detection::CollisionResult res;
+		scene.checkCollision(req, res, trajectory.getWayPoint(i));
+		// only consider contacts with changed objects: all others were validated before
+		for (const auto& contact : res.contacts)
+			if (ids.count(contact.first.first) || ids.count(contact.first.second))
+				return true;
+	}
+	return false;
+}
+
+size_t StagePrivate::revalidate(SceneUpdate& update) {
+	for (InterfaceState& state : states_)
+		update.apply(state);
+
+	size_t num_invalidated = 0;
+	for (auto it = solutions_.begin(); it != solutions_.end();) {
+		const SolutionBase& solution = **it;
+		if (solution.start() && update.collides(solution, *solution.start()->scene())) {
+			auto next = std::next(it);
+			invalidateSolution(it, "collision with changed object");
+			onInvalidSolution(solution);
+			it = next;
+			++num_invalidated;
+		} else
+			++it;
+	}
+	return num_invalidated;
+}
+
+namespace {
+void collectPending(const SolutionBase& solution, std::vector<const SubTrajectory*>& pending) {
+	if (const auto* sequence = dynamic_cast<const SolutionSequence*>(&solution)) {
+		for (const SolutionSequence::Leaf& leaf : sequence->flattened().leaves)
+			collectPending(*leaf.trajectory, pending);
+	} else if (const auto* sub = dynamic_cast<const SubTrajectory*>(&solution)) {
+		if (sub->validationPending() && sub->trajectory())
+			pending.push_back(sub);
+	}
+}
+}  // namespace
+
+bool StagePrivate::validatePending(const SolutionBase& solution) {
+	std::vector<const SubTrajectory*> pending;
+	collectPending(solution, pending);
+	for (const SubTrajectory* sub : pending) {
+		const planning_scene::PlanningScene& scene = *(sub->start() ? sub->start() : solution.start())->scene();
+		const auto traj = sub->trajectory();
+		const auto& trajectory = *traj;
+		CollisionBackend::States states;
+		states.reserve(trajectory.getWayPointCount());
+		for (size_t i = 0; i != trajectory.getWayPointCount(); ++i)
+			states.push_back(&trajectory.getWayPoint(i));
+		if (CollisionBackend::instance()->firstColliding(scene, trajectory.getGroupName(), states) == states.size()) {
+			const_cast<SubTrajectory*>(sub)->setValidationPending(false);
+			continue;
+		}
+
+		auto it = std::find_if(solutions_.begin(), solutions_.end(),
+		                       [&solution](const SolutionBaseConstPtr& s) { return s.get() == &solution; });
+		if (it != solutions_.end()) {
+			invalidateSolution(it, "collision detected by lazy validation");
+			// prune instead of onInvalidSolution(): planning the same state pair again would yield the same result
+			StagePrivate::onInvalidSolution(solution);
+		}
+		return false;
+	}
+	return true;
+}
+
+void StagePrivate::invalidateSolution(ordered<SolutionBaseConstPtr>::iterator it, const std::string& msg) {
+	const_cast<SolutionBase&>(**it).markAsFailure(msg);
+	failures_.push_back(*it);
+	solutions_.erase(it);
+	++changes_;
+}
+
+const std::string StagePrivate::REGENERATED = "regenerated after object moved";
+const std::string StagePrivate::COMPOSED_OF_INVALID = "composed of invalidated solution";
+
+void StagePrivate::releaseObsoleteFailures() {
+	for (auto it = failures_.begin(); it != failures_.end();) {
+		const std::string& comment = (*it)->comment();
+		if ((comment != REGENERATED && comment != COMPOSED_OF_INVALID) ||
+		    (parent() && parent()->pimpl()->refersTo(**it))) {
+			++it;
+			continue;
+		}
+		releaseSolution(**it);
+		releaseStates(**it);
+		it = failures_.erase(it);
 	}
 }
 
+void StagePrivate::onInvalidSolution(const SolutionBase& solution) {
+	if (parent())
+		parent()->pimpl()->pruneInvalidSolution(*me(), solution);
+}
+
 Stage::Stage(StagePrivate* impl) : pimpl_(impl) {
 	assert(impl);
 	auto& p = properties();
 	p.declare<double>("timeout", "timeout per run (s)");
 	p.declare<std::string>("marker_ns", name(), "marker namespace");
+	p.declare<size_t>("max_stored_solutions", 0, "max number of stored solutions (0 = unlimited)");
+	p.declare<size_t>("max_stored_failures", 0, "max number of stored failures (0 = unlimited)");
+	p.declare<bool>("sample_failures", false, "store a sample of failures beyond max_stored_failures / 2");
 
 	p.declare<std::set<std::string>>("forwarded_properties", std::set<std::string>(),
 	                                 "set of interface properties to forward");
 }
 
 Stage::~Stage() {
+	pimpl_->solution_cbs_.clear();  // finish asynchronous callbacks while their solutions are still valid
 	delete pimpl_;
 }
 
+Stage::ComputeUnlock::ComputeUnlock(const Stage& stage) : mutex_(stage.pimpl()->planningMutex()) {
+	if (mutex_)
+		mutex_->unlock();
+}
+
+Stage::ComputeUnlock::~ComputeUnlock() {
+	if (mutex_)
+		mutex_->lock();
+}
+
 Stage::operator StagePrivate*() {
 	return pimpl();
 }
@@ -328,11 +1262,25 @@ Stage::operator const StagePrivate*() const {
 
 void Stage::reset() {
 	auto impl = pimpl();
+	impl->flushSolutionCallbacks();
 	// clear solutions + associated states
 	impl->solutions_.clear();
 	impl->failures_.clear();
 	impl->num_failures_ = 0u;
+	impl->num_offered_failures_ = 0u;
+	impl->failure_reasons_.clear();
+	impl->evicted_ = EvictedSolutions();
+	impl->continuations_.clear();
+	impl->num_pruned_ = 0u;
+	impl->published_changes_ = ++impl->changes_;
+	impl->published_revision_ = impl->solutions_.revision();
+	std::atomic_store(&impl->snapshot_, std::make_shared<const StageSnapshot>());
+	impl->memory_ = MemoryUsage();
+	impl->marker_memory_ = 0u;
 	impl->states_.clear();
+	impl->monitor_batch_.clear();
+	impl->dedup_index_[Interface::FORWARD].clear();
+	impl->dedup_index_[Interface::BACKWARD].clear();
 	// clear pull interfaces
 	if (impl->starts_)
 		impl->starts_->clear();
@@ -341,13 +1289,23 @@ void Stage::reset() {
 	// reset push interfaces
 	impl->prev_ends_.reset();
 	impl->next_starts_.reset();
-	// reset inherited properties
-	impl->properties_.reset();
+	impl->frozen_prev_ends_ = impl->frozen_next_starts_ = nullptr;
+	// reset inherited properties, unless they are still as initialized by init()
+	if (impl->init_model_.expired() || impl->properties_.version() != impl->init_version_)
+		impl->properties_.reset();
 	impl->total_compute_time_ = std::chrono::duration<double>::zero();
+	impl->compute_since_solution_ = std::chrono::duration<double>::zero();
+	impl->compute_latency_.reset();
+	impl->solution_latency_.reset();
+	impl->success_latency_.reset();
+	impl->timed_out_ = 0;
 }
 
 void Stage::init(const moveit::core::RobotModelConstPtr& /* robot_model */) {
 	auto impl = pimpl();
+	// inherited properties are still valid
+	if (!impl->propertiesChanged())
+		return;
 
 	// init properties once from parent
 	impl->properties_.reset();
@@ -365,6 +1323,16 @@ void Stage::init(const moveit::core::RobotModelConstPtr& /* robot_model */) {
 	}
 }
 
+void Stage::regenerate() {
+	auto impl = pimpl();
+	while (!impl->solutions_.empty()) {
+		auto it = impl->solutions_.begin();
+		const SolutionBaseConstPtr solution = *it;  // keep alive while pruning
+		impl->invalidateSolution(it, StagePrivate::REGENERATED);
+		impl->onInvalidSolution(*solution);
+	}
+}
+
 const ContainerBase* Stage::parent() const {
 	return pimpl_->parent_;
 }
@@ -385,8 +1353,20 @@ uint32_t Stage::introspectionId() const {
 
 void Stage::forwardProperties(const InterfaceState& source, InterfaceState& dest) {
 	const PropertyMap& src = source.properties();
+	if (src.begin() == src.end())
+		return;
+	const auto& names = properties().get<std::set<std::string>>("forwarded_properties");
+
+	// forwarding all properties to a fresh state: share them instead of copying
+	const PropertyMap& dst_const = static_cast<const InterfaceState&>(dest).properties();
+	if (dst_const.begin() == dst_const.end() &&
+	    std::all_of(src.begin(), src.end(), [&names](const auto& pair) { return names.count(pair.first) > 0; })) {
+		dest.shareProperties(source);
+		return;
+	}
+
 	PropertyMap& dst = dest.properties();
-	for (const auto& name : forwardedProperties()) {
+	for (const auto& name : names) {
 		if (!src.hasProperty(name))
 			continue;
 		dst.set(name, src.get(name));
@@ -398,8 +1378,24 @@ Stage::SolutionCallbackList::const_iterator Stage::addSolutionCallback(SolutionC
 	impl->solution_cbs_.emplace_back(std::move(cb));
 	return --impl->solution_cbs_.cend();
 }
+Stage::SolutionCallbackList::const_iterator Stage::addSolutionCallback(SolutionCallback&& cb,
+                                                                       const CallbackDispatch& dispatch) {
+	if (!dispatch.asynchronous)
+		return addSolutionCallback(std::move(cb));
+	auto impl = pimpl();
+	++impl->num_async_cbs_;
+	return addSolutionCallback(
+	    AsyncSolutionCallback{ std::make_shared<SolutionCallbackExecutor>(std::move(cb), dispatch) });
+}
 void Stage::removeSolutionCallback(SolutionCallbackList::const_iterator which) {
-	pimpl()->solution_cbs_.erase(which);
+	auto impl = pimpl();
+	if (which->target<AsyncSolutionCallback>())
+		--impl->num_async_cbs_;
+	impl->solution_cbs_.erase(which);
+}
+
+void Stage::setLazyCost(bool lazy) {
+	pimpl()->lazy_cost_ = lazy;
 }
 
 void Stage::setCostTerm(const CostTermConstPtr& term) {
@@ -417,12 +1413,29 @@ const std::list<SolutionBaseConstPtr>& Stage::failures() const {
 	return pimpl()->failures_;
 }
 
+StageSnapshotConstPtr Stage::snapshot() const {
+	return std::atomic_load(&pimpl()->snapshot_);
+}
+
 size_t Stage::numFailures() const {
 	return pimpl()->num_failures_;
 }
 
+const std::map<std::string, size_t>& Stage::failureReasons() const {
+	return pimpl()->failure_reasons_;
+}
+
+const EvictedSolutions& Stage::evictedSolutions() const {
+	return pimpl()->evicted_;
+}
+
+size_t Stage::numPruned() const {
+	return pimpl()->num_pruned_;
+}
+
 void Stage::silentFailure() {
 	++(pimpl()->num_failures_);
+	++(pimpl()->changes_);
 }
 
 bool Stage::storeFailures() const {
@@ -437,10 +1450,105 @@ void Stage::setProperty(const std::string& name, const boost::any& value) {
 	pimpl()->properties_.set(name, value);
 }
 
+double Stage::timeout() const {
+	auto impl = pimpl();
+	double timeout = properties().get<double>("timeout");
+	const TimeoutPolicy& policy = impl->timeout_policy_;
+	const size_t successes = impl->success_latency_.count();
+	if (policy.enabled() && successes >= policy.min_samples) {
+		// timed-out calls rank above all successes: the quantile might lie beyond the observed durations
+		const double q = policy.quantile * (successes + impl->timed_out_) / successes;
+		if (q <= 1.0) {
+			double adapted = (1.0 + policy.margin) * impl->success_latency_.quantile(q);
+			adapted = std::max(adapted, policy.min_timeout);
+			if (timeout <= 0.0 || adapted < timeout)
+				timeout = adapted;
+		}
+	}
+	double budget = impl->timeBudget();
+	// non-positive timeouts denote unlimited waiting
+	if (std::isfinite(budget) && (timeout <= 0.0 || budget < timeout))
+		return budget;
+	return timeout;
+}
+
+void Stage::setTimeoutPolicy(const TimeoutPolicy& policy) {
+	auto impl = pimpl();
+	impl->timeout_policy_ = policy;
+	impl->own_timeout_policy_ = true;
+}
+
+const TimeoutPolicy& Stage::timeoutPolicy() const {
+	return pimpl()->timeout_policy_;
+}
+
 double Stage::getTotalComputeTime() const {
 	return pimpl()->total_compute_time_.count();
 }
 
+const LatencyHistogram& Stage::computeLatency() const {
+	return pimpl()->compute_latency_;
+}
+
+const LatencyHistogram& Stage::solutionLatency() const {
+	return pimpl()->solution_latency_;
+}
+
+const LatencyHistogram& Stage::successLatency() const {
+	return pimpl()->success_latency_;
+}
+
+MemoryUsage Stage::memoryUsage() const {
+	MemoryUsage usage = pimpl()->memory_;
+	usage.markers = pimpl()->marker_memory_;
+	return usage;
+}
+
+void Stage::setMemoryAccounting(bool enabled) {
+	memory_accounting = enabled;
+}
+
+bool Stage::memoryAccounting() {
+	return memory_accounting;
+}
+
+const PreemptionToken* Stage::preemptionToken() const {
+	return pimpl()->preemptionToken();
+}
+
+size_t Stage::numPendingContinuations() const {
+	return pimpl()->continuations_.size();
+}
+
+void Stage::addContinuation(std::function<bool()> ready, std::function<void()> resume,
+                            std::function<void()> cancel) {
+	pimpl()->continuations_.push_back({ std::move(ready), std::move(resume), std::move(cancel) });
+}
+
+void StagePrivate::cancelContinuations() {
+	for (const Continuation& continuation : continuations_)
+		if (continuation.cancel)
+			continuation.cancel();
+}
+
+size_t StagePrivate::resumeContinuations() {
+	if (computing_)  // running compute() in another thread
+		return 0;
+	size_t resumed = 0;
+	// continuations might add new ones, which are appended
+	for (auto it = continuations_.begin(); it != continuations_.end();) {
+		if (!it->ready()) {
+			++it;
+			continue;
+		}
+		std::function<void()> resume = std::move(it->resume);
+		it = continuations_.erase(it);
+		runStep(resume, true);
+		++resumed;
+	}
+	return resumed;
+}
+
 void StagePrivate::composePropertyErrorMsg(const std::string& property_name, std::ostream& os) {
 	if (property_name.empty())
 		return;
@@ -494,6 +1602,13 @@ std::ostream& operator<<(std::ostream& os, const StagePrivate& impl) {
 	}
 	// name
 	os << " / " << impl.name();
+	if (Stage::memoryAccounting()) {
+		const MemoryUsage usage = impl.me()->memoryUsage();
+		boost::format memory(" [%.1f kB: states %.1f, scenes %.1f, trajectories %.1f, markers %.1f]");
+		for (size_t bytes : { usage.total(), usage.states, usage.scenes, usage.trajectories, usage.markers })
+			memory % (bytes / 1024.0);
+		os << memory;
+	}
 	return os;
 }
 
@@ -553,12 +1668,63 @@ InterfaceFlags PropagatingEitherWayPrivate::requiredInterface() const {
 	return required_interface_;
 }
 
+namespace {
+/// number of enabled states of interface, which are sorted first
+size_t countEnabled(const InterfacePtr& interface) {
+	size_t enabled = 0;
+	if (!interface)
+		return enabled;
+	for (const InterfaceState* state : *interface) {
+		if (!state->priority().enabled())
+			break;
+		++enabled;
+	}
+	return enabled;
+}
+
+/** Sum of solution costs that each full solution path through state necessarily includes in direction dir
+ *
+ * States created by propagation have a single, fixed trajectory towards their origin.
+ * Follow those trajectories back as long as they were created by propagating stages.
+ * All other trajectories might be complemented by cheaper alternatives in future.
+ */
+template <Interface::Direction dir>
+double mandatoryCost(const InterfaceState& state) {
+	const InterfaceFlags propagating(dir == Interface::BACKWARD ? PROPAGATE_FORWARDS : PROPAGATE_BACKWARDS);
+	double cost = 0.0;
+	const InterfaceState* s = &state;
+	while (trajectories<dir>(*s).size() == 1) {
+		const SolutionBase* solution = trajectories<dir>(*s).front();
+		cost += solution->cost();
+		if (!solution->creator() || solution->creator()->pimpl()->interfaceFlags() != propagating)
+			break;
+		s = state<dir>(*solution);
+	}
+	return cost;
+}
+
+// send all items of batch at once, see StagePrivate::beginBatch()
+template <typename Send>
+void sendBatch(StagePrivate* impl, ComputeBase::Batch& batch, const Send& send) {
+	impl->beginBatch();
+	try {
+		for (auto& item : batch)
+			send(std::move(item.first), std::make_shared<SubTrajectory>(std::move(item.second)));
+	} catch (...) {
+		impl->endBatch();
+		throw;
+	}
+	impl->endBatch();
+}
+}  // namespace
+
 inline bool PropagatingEitherWayPrivate::hasStartState() const {
 	return starts_ && !starts_->empty() && starts_->front()->priority().enabled();
 }
 
 const InterfaceState& PropagatingEitherWayPrivate::fetchStartState() {
 	assert(hasStartState());
+	starts_->noteExpanded(*starts_->front());
 	return *starts_->remove(starts_->begin()).front();
 }
 
@@ -568,6 +1734,7 @@ inline bool PropagatingEitherWayPrivate::hasEndState() const {
 
 const InterfaceState& PropagatingEitherWayPrivate::fetchEndState() {
 	assert(hasEndState());
+	ends_->noteExpanded(*ends_->front());
 	return *ends_->remove(ends_->begin()).front();
 }
 
@@ -575,20 +1742,42 @@ bool PropagatingEitherWayPrivate::canCompute() const {
 	return hasStartState() || hasEndState();
 }
 
+size_t PropagatingEitherWayPrivate::pendingJobs() const {
+	return countEnabled(starts_) + countEnabled(ends_);
+}
+
+InterfaceState::Priority PropagatingEitherWayPrivate::jobPriority() const {
+	if (hasStartState() && hasEndState())
+		return std::min(starts_->front()->priority(), ends_->front()->priority());
+	if (hasStartState())
+		return starts_->front()->priority();
+	if (hasEndState())
+		return ends_->front()->priority();
+	return ComputeBasePrivate::jobPriority();
+}
+
 void PropagatingEitherWayPrivate::compute() {
 	PropagatingEitherWay* me = static_cast<PropagatingEitherWay*>(me_);
 
+	const bool prune = std::isfinite(costBound());
 	if (hasStartState()) {
 		const InterfaceState& state = fetchStartState();
-		// enforce property initialization from INTERFACE
-		properties_.performInitFrom(Stage::INTERFACE, state.properties());
-		me->computeForward(state);
+		// skip states that cannot improve on the best known solution
+		if (!prune || !exceedsCostBound(mandatoryCost<Interface::BACKWARD>(state))) {
+			// enforce property initialization from INTERFACE
+			properties_.performInitFrom(Stage::INTERFACE, state.properties());
+			noteComputeInput(state);
+			me->computeForward(state);
+		}
 	}
 	if (hasEndState()) {
 		const InterfaceState& state = fetchEndState();
-		// enforce property initialization from INTERFACE
-		properties_.performInitFrom(Stage::INTERFACE, state.properties());
-		me->computeBackward(state);
+		if (!prune || !exceedsCostBound(mandatoryCost<Interface::FORWARD>(state))) {
+			// enforce property initialization from INTERFACE
+			properties_.performInitFrom(Stage::INTERFACE, state.properties());
+			noteComputeInput(state);
+			me->computeBackward(state);
+		}
 	}
 }
 
@@ -617,12 +1806,22 @@ template void PropagatingEitherWay::send<Interface::FORWARD>(const InterfaceStat
 template void PropagatingEitherWay::send<Interface::BACKWARD>(const InterfaceState& start, InterfaceState&& end,
                                                               SubTrajectory&& trajectory);
 
+template <Interface::Direction dir>
+void PropagatingEitherWay::sendMany(const InterfaceState& start, Batch&& batch) {
+	auto impl = pimpl();
+	sendBatch(impl, batch, [impl, &start](InterfaceState&& end, const SolutionBasePtr& solution) {
+		impl->send<dir>(start, std::move(end), solution);
+	});
+}
+template void PropagatingEitherWay::sendMany<Interface::FORWARD>(const InterfaceState& start, Batch&& batch);
+template void PropagatingEitherWay::sendMany<Interface::BACKWARD>(const InterfaceState& start, Batch&& batch);
+
 template <Interface::Direction dir>
 void PropagatingEitherWay::computeGeneric(const InterfaceState& start) {
 	planning_scene::PlanningScenePtr end;
 	SubTrajectory trajectory;
 
-	if (!compute(start, end, trajectory, dir) && trajectory.comment().empty())
+	if (!compute(start, end, trajectory, dir) && !trajectory.hasComment())
 		silentFailure();  // there is nothing to report (comment is empty)
 	else
 		send<dir>(start, InterfaceState(end), std::move(trajectory));
@@ -661,20 +1860,40 @@ InterfaceFlags GeneratorPrivate::requiredInterface() const {
 }
 
 bool GeneratorPrivate::canCompute() const {
-	return static_cast<Generator*>(me_)->canCompute();
+	return !congested() && static_cast<Generator*>(me_)->canCompute();
+}
+
+bool GeneratorPrivate::congested() const {
+	const size_t mark = properties_.get<size_t>("high_water_mark");
+	if (mark == 0)
+		return false;
+	// only a consumer that can compute will drain its jobs
+	auto is_congested = [mark](const StagePrivate* consumer) {
+		return consumer && consumer->pendingJobs() >= mark && consumer->canCompute();
+	};
+	return is_congested(consumer(Interface::FORWARD)) || is_congested(consumer(Interface::BACKWARD));
 }
 
 void GeneratorPrivate::compute() {
 	static_cast<Generator*>(me_)->compute();
 }
 
-Generator::Generator(GeneratorPrivate* impl) : ComputeBase(impl) {}
+Generator::Generator(GeneratorPrivate* impl) : ComputeBase(impl) {
+	properties().declare<size_t>("high_water_mark", 0, "max pending jobs of consumers before spawning (0 = unlimited)");
+}
 Generator::Generator(const std::string& name) : Generator(new GeneratorPrivate(this, name)) {}
 
 void Generator::spawn(InterfaceState&& state, SubTrajectory&& t) {
 	pimpl()->spawn(std::move(state), std::make_shared<SubTrajectory>(std::move(t)));
 }
 
+void Generator::spawnMany(Batch&& batch) {
+	auto impl = pimpl();
+	sendBatch(impl, batch, [impl](InterfaceState&& state, const SolutionBasePtr& solution) {
+		impl->spawn(std::move(state), solution);
+	});
+}
+
 MonitoringGeneratorPrivate::MonitoringGeneratorPrivate(MonitoringGenerator* me, const std::string& name)
   : GeneratorPrivate(me, name), monitored_(nullptr), registered_(false) {}
 
@@ -689,7 +1908,8 @@ void MonitoringGenerator::setMonitoredStage(Stage* monitored) {
 		return;
 
 	if (impl->monitored_ && impl->registered_) {
-		impl->monitored_->removeSolutionCallback(impl->cb_);
+		auto& monitors = impl->monitored_->pimpl()->monitors_;
+		monitors.erase(std::remove(monitors.begin(), monitors.end(), impl), monitors.end());
 		impl->registered_ = false;
 	}
 
@@ -703,16 +1923,30 @@ void MonitoringGenerator::init(const moveit::core::RobotModelConstPtr& robot_mod
 	if (!impl->monitored_)
 		throw InitStageException(*this, "no monitored stage defined");
 	if (!impl->registered_) {  // register only once
-		impl->cb_ = impl->monitored_->addSolutionCallback(
-		    std::bind(&MonitoringGeneratorPrivate::solutionCB, impl, std::placeholders::_1));
+		impl->monitored_->pimpl()->monitors_.push_back(impl);
 		impl->registered_ = true;
 	}
 }
 
-void MonitoringGeneratorPrivate::solutionCB(const SolutionBase& s) {
-	// forward only successful solutions to monitor
-	if (!s.isFailure())
-		static_cast<MonitoringGenerator*>(me())->onNewSolution(s);
+void MonitoringGenerator::regenerate() {
+	Generator::regenerate();
+	auto impl = pimpl();
+	if (!impl->monitored_)
+		return;
+	std::vector<const SolutionBase*> solutions;
+	for (const SolutionBaseConstPtr& s : impl->monitored_->solutions())
+		solutions.push_back(s.get());
+	if (!solutions.empty())
+		onNewSolutions(solutions);
+}
+
+void MonitoringGeneratorPrivate::notify(const std::vector<const SolutionBase*>& solutions) {
+	static_cast<MonitoringGenerator*>(me())->onNewSolutions(solutions);
+}
+
+void MonitoringGenerator::onNewSolutions(const std::vector<const SolutionBase*>& solutions) {
+	for (const SolutionBase* s : solutions)
+		onNewSolution(*s);
 }
 
 ConnectingPrivate::ConnectingPrivate(Connecting* me, const std::string& name) : ComputeBasePrivate(me, name) {
@@ -743,6 +1977,7 @@ void ConnectingPrivate::newState(Interface::iterator it, Interface::UpdateFlags
 	// disable current interface to break loop (jumping back and forth between both interfaces)
 	// this will be checked by notifyEnabled() below
 	Interface::DisableNotify disable_source_interface(*pullInterface<dir>());
+	best_valid_ = false;
 	if (updated) {
 		if (updated.testFlag(Interface::STATUS) &&  // only perform these costly operations if needed
 		    pullInterface<opposite<dir>()>()->notifyEnabled())  // suppressing recursive loop?
@@ -752,10 +1987,18 @@ void ConnectingPrivate::newState(Interface::iterator it, Interface::UpdateFlags
 			if (status == InterfaceState::Status::PRUNED)  // PRUNED becomes ARMED on opposite side
 				status = InterfaceState::Status::ARMED;  // (only for pending state pairs)
 
-			for (const auto& candidate : this->pending) {
-				if (std::get<opposite<dir>()>(candidate) != it)  // only consider pairs with source state == state
-					continue;
-				auto oit = std::get<dir>(candidate);  // opposite target state
+			// collect opposite target states of pending pairs with source state == state
+			std::vector<const InterfaceState*> targets;
+			InterfacePtr other_interface = pullInterface<dir>();
+			for (Interface::const_iterator oit = other_interface->cbegin(); oit != other_interface->cend(); ++oit)
+				if (isPending(make_pair<dir>(it, oit)))
+					targets.push_back(&*oit);
+			for (const auto& candidate : this->pending)
+				if (std::get<opposite<dir>()>(candidate) == it)
+					targets.push_back(&*std::get<dir>(candidate));
+
+			// status updates reorder the opposite interface: thus iterate over the collected targets
+			for (const InterfaceState* oit : targets) {
 				auto ostatus = oit->priority().status();
 				if (ostatus != status) {
 					if (status != InterfaceState::Status::ENABLED) {
@@ -768,20 +2011,23 @@ void ConnectingPrivate::newState(Interface::iterator it, Interface::UpdateFlags
 							continue;
 					}
 					// pass creator=nullptr to skip hasPendingOpposites() check
-					parent_pimpl->setStatus<opposite<dir>()>(nullptr, nullptr, &*oit, status);
+					parent_pimpl->setStatus<opposite<dir>()>(nullptr, nullptr, oit, status);
 				}
 			}
 		}
 
-		// many pairs will have changed priorities: resort pending list
+		// explicitly scheduled pairs might have changed priorities: resort them
 		pending.sort();
-	} else {  // new state: insert all pairs with other interface
+	} else {  // new state: lazily consider all compatible pairs with other interface
 		assert(it->priority().enabled());  // new solutions are feasible, aren't they?
 		InterfacePtr other_interface = pullInterface<dir>();
 		bool have_enabled_opposites = false;
 		for (Interface::iterator oit = other_interface->begin(), oend = other_interface->end(); oit != oend; ++oit) {
-			if (!static_cast<Connecting*>(me_)->compatible(*it, *oit))
+			if (!static_cast<Connecting*>(me_)->compatible(*it, *oit)) {
+				const StatePair pair = make_pair<dir>(it, oit);
+				done_.emplace(&*pair.first, &*pair.second);  // remove incompatible pair from frontier
 				continue;
+			}
 
 			// re-enable the opposing state oit (and its associated solution branch) if its status is ARMED
 			// https://github.com/ros-planning/moveit_task_constructor/pull/309#issuecomment-974636202
@@ -789,9 +2035,6 @@ void ConnectingPrivate::newState(Interface::iterator it, Interface::UpdateFlags
 				parent_pimpl->setStatus<opposite<dir>()>(me(), &*it, &*oit, InterfaceState::Status::ENABLED);
 			if (oit->priority().enabled())
 				have_enabled_opposites = true;
-
-			// Remember all pending states, regardless of their status!
-			pending.insert(make_pair<dir>(it, oit));
 		}
 		if (!have_enabled_opposites)  // prune new state and associated branch if necessary
 			// pass creator=nullptr to skip hasPendingOpposites() check as we did this here already
@@ -819,9 +2062,21 @@ void ConnectingPrivate::newState(Interface::iterator it, Interface::UpdateFlags
 // If not, we exhausted all solution candidates for target and thus should mark it as failure.
 template <Interface::Direction dir>
 inline bool ConnectingPrivate::hasPendingOpposites(const InterfaceState* source, const InterfaceState* target) const {
+	static_assert(Interface::FORWARD == 0 && Interface::BACKWARD == 1,
+	              "This code assumes FORWARD=0, BACKWARD=1. Don't change their order!");
+	std::pair<const InterfaceState*, const InterfaceState*> pair;
+	std::get<opposite<dir>()>(pair) = target;
+	// sources are sorted: consider enabled ones only
+	const Interface& sources = dir == Interface::FORWARD ? *starts_ : *ends_;
+	for (const InterfaceState* src : sources) {
+		if (!src->priority().enabled())
+			break;
+		std::get<dir>(pair) = src;
+		if (src != source && !done_.count(pair))
+			return true;
+	}
+
 	for (const auto& candidate : this->pending) {
-		static_assert(Interface::FORWARD == 0 && Interface::BACKWARD == 1,
-		              "This code assumes FORWARD=0, BACKWARD=1. Don't change their order!");
 		const InterfaceState* src = &*std::get<dir>(candidate);
 		const InterfaceState* tgt = &*std::get<opposite<dir>()>(candidate);
 
@@ -840,37 +2095,143 @@ template bool ConnectingPrivate::hasPendingOpposites<Interface::FORWARD>(const I
 template bool ConnectingPrivate::hasPendingOpposites<Interface::BACKWARD>(const InterfaceState* end,
                                                                           const InterfaceState* start) const;
 
+bool ConnectingPrivate::findPendingPair(StatePair& best) const {
+	bool found = false;
+	if (ends_->empty())
+		return found;
+	const InterfaceState::Priority& best_end = ends_->front()->priority();
+	for (Interface::const_iterator from = starts_->cbegin(); from != starts_->cend(); ++from) {
+		if (!from->priority().enabled())
+			break;  // only disabled start states are to come
+		// Both interfaces are sorted: later start states cannot improve on the best pair found so far
+		if (found && !StatePair::less(from->priority(), best_end, best.first->priority(), best.second->priority()))
+			break;
+		// end states before the cursor were already found done
+		auto cursor = cursors_.emplace(&*from, ends_->cbegin()).first;
+		Interface::const_iterator to = cursor->second;
+		for (; to != ends_->cend() && to->priority().enabled(); ++to) {
+			StatePair candidate(from, to);
+			if (!isPending(candidate))
+				continue;
+			if (!found || candidate < best) {
+				best = candidate;
+				found = true;
+			}
+			break;  // later end states cannot improve on this one
+		}
+		cursor->second = to;
+	}
+	return found;
+}
+
+const ConnectingPrivate::StatePair* ConnectingPrivate::bestPendingPair() const {
+	// cursors remain valid until the interfaces are modified
+	const auto revision = std::make_pair(starts_->revision(), ends_->revision());
+	if (revision != frontier_revision_) {
+		cursors_.clear();
+		best_valid_ = false;
+		frontier_revision_ = revision;
+	}
+	if (!best_valid_) {
+		best_found_ = findPendingPair(best_);
+		best_valid_ = true;
+	}
+	const StatePair* best = best_found_ ? &best_ : nullptr;
+	if (!pending.empty() && pending.front().first->priority().enabled() &&
+	    pending.front().second->priority().enabled() && (!best || pending.front() < *best))
+		best = &pending.front();
+	return best;
+}
+
+size_t ConnectingPrivate::pendingJobs() const {
+	// all enabled state pairs of the lazy frontier, which weren't computed yet, plus rescheduled ones
+	// pairs involving pruned (or otherwise disabled) states will never be computed
+	auto enabled = [](const InterfaceState* a, const InterfaceState* b) {
+		return a->priority().enabled() && b->priority().enabled();
+	};
+	const size_t pairs = countEnabled(starts_) * countEnabled(ends_);
+	size_t done = 0;
+	for (const auto& pair : done_)
+		done += enabled(pair.first, pair.second);
+	size_t rescheduled = 0;
+	for (const StatePair& pair : pending)
+		rescheduled += enabled(&*pair.first, &*pair.second);
+	return pairs - std::min(pairs, done) + rescheduled;
+}
+
 bool ConnectingPrivate::canCompute() const {
 	// Do we still have feasible pending state pairs?
-	return !pending.empty() && pending.front().first->priority().enabled() &&
-	       pending.front().second->priority().enabled();
+	return bestPendingPair() != nullptr;
+}
+
+InterfaceState::Priority ConnectingPrivate::jobPriority() const {
+	const StatePair* best = bestPendingPair();
+	if (!best)
+		return ComputeBasePrivate::jobPriority();
+	return best->first->priority() + best->second->priority();
 }
 
 void ConnectingPrivate::compute() {
-	const StatePair& top = pending.pop();
+	const StatePair* best = bestPendingPair();
+	if (!best)
+		return;
+	const StatePair top = *best;
+	if (best == &pending.front())
+		pending.pop();
+	done_.emplace(&*top.first, &*top.second);
+	best_valid_ = false;
+
 	const InterfaceState& from = *top.first;
 	const InterfaceState& to = *top.second;
 	assert(from.priority().enabled() && to.priority().enabled());
+	starts()->noteExpanded(from);
+	ends()->noteExpanded(to);
+	// skip state pairs that cannot improve on the best known solution
+	if (std::isfinite(costBound()) &&
+	    exceedsCostBound(mandatoryCost<Interface::BACKWARD>(from) + mandatoryCost<Interface::FORWARD>(to) +
+	                     cost_term_->lowerBound(from, to)))
+		return;
+	noteComputeInput(from);
 	static_cast<Connecting*>(me_)->compute(from, to);
 }
 
 std::ostream& ConnectingPrivate::printPendingPairs(std::ostream& os) const {
 	const char* reset = InterfaceState::STATUS_COLOR[3];
-	for (const auto& candidate : pending) {
+	bool empty = true;
+	auto print = [&](const StatePair& candidate) {
 		size_t first = getIndex(*starts(), candidate.first);
 		size_t second = getIndex(*ends(), candidate.second);
 		os << InterfaceState::STATUS_COLOR[candidate.first->priority().status()] << first << reset << ":"
 		   << InterfaceState::STATUS_COLOR[candidate.second->priority().status()] << second << reset << " ";
-	}
-	if (pending.empty())
+		empty = false;
+	};
+	for (Interface::const_iterator from = starts_->cbegin(); from != starts_->cend(); ++from)
+		for (Interface::const_iterator to = ends_->cbegin(); to != ends_->cend(); ++to)
+			if (isPending(StatePair(from, to)))
+				print(StatePair(from, to));
+	for (const auto& candidate : pending)
+		print(candidate);
+	if (empty)
 		os << "---";
 	return os;
 }
 
+void ConnectingPrivate::onInvalidSolution(const SolutionBase& solution) {
+	// instead of pruning, schedule the state pair again to plan with the updated scenes
+	auto from = std::find(starts_->cbegin(), starts_->cend(), solution.start());
+	auto to = std::find(ends_->cbegin(), ends_->cend(), solution.end());
+	if (from != starts_->cend() && to != ends_->cend())
+		pending.insert(StatePair(from, to));
+}
+
 Connecting::Connecting(const std::string& name) : ComputeBase(new ConnectingPrivate(this, name)) {}
 
 void Connecting::reset() {
-	pimpl()->pending.clear();
+	auto impl = pimpl();
+	impl->pending.clear();
+	impl->done_.clear();
+	impl->best_valid_ = false;
+	impl->cursors_.clear();
 	ComputeBase::reset();
 }
 
@@ -0,0 +1,175 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Registry creating stages by class id, bypassing pluginlib for built-in stages
+*/
+
+#include <moveit/task_constructor/stage_registry.h>
+#include <moveit/task_constructor/container.h>
+
+#include <pluginlib/class_loader.hpp>
+#include <ros/console.h>
+
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace moveit {
+namespace task_constructor {
+
+struct StageRegistry::PluginLoader
+{
+	PluginLoader() : loader("moveit_task_constructor_core", "moveit::task_constructor::Stage") {}
+	pluginlib::ClassLoader<Stage> loader;
+};
+
+StageRegistry& StageRegistry::instance() {
+	static StageRegistry registry;
+	// preload plugins on first access if requested, not at library load time
+	static const bool preloaded = [] {
+		if (!std::getenv("MTC_PRELOAD_PLUGINS"))
+			return false;
+		try {
+			registry.preloadPlugins();
+		} catch (const std::exception& e) {
+			ROS_WARN_STREAM_NAMED("StageRegistry", "Failed to preload plugins: " << e.what());
+		}
+		return true;
+	}();
+	(void)preloaded;
+	return registry;
+}
+
+StageRegistry::StageRegistry() {
+	add<SerialContainer>("moveit_task_constructor/Serial Container", "Sequence of stages, planned as a chain");
+	add<Alternatives>("moveit_task_constructor/Alternatives", "Parallel alternatives, all of them are planned");
+	add<Fallbacks>("moveit_task_constructor/Fallbacks", "Parallel alternatives, planned until one succeeds");
+	add<Merger>("moveit_task_constructor/Merger", "Parallel sub tasks, merged into a single trajectory");
+	addPrimitiveStages();
+}
+
+void StageRegistry::addPrimitiveStages() {
+	// The stages library links against us, so we cannot call it directly. Instead of relying on
+	// a static initializer there (skipped if the linker drops the unreferenced library), load it explicitly.
+	// If it is loaded already, this just returns its handle. The library is never unloaded.
+	void* library = dlopen(MTC_STAGES_LIBRARY, RTLD_NOW | RTLD_GLOBAL);
+	if (!library) {
+		ROS_WARN_STREAM_NAMED("StageRegistry", "Cannot load built-in stages: " << dlerror());
+		return;
+	}
+	using Register = void (*)(StageRegistry*);
+	auto register_stages = reinterpret_cast<Register>(dlsym(library, "moveit_task_constructor_register_stages"));
+	if (!register_stages) {
+		ROS_WARN_STREAM_NAMED("StageRegistry", "Cannot register built-in stages: " << dlerror());
+		return;
+	}
+	register_stages(this);
+}
+
+void StageRegistry::add(const std::string& class_id, const std::string& description, const Factory& factory) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	built_ins_[class_id] = Entry{ class_id, description, factory };
+}
+
+bool StageRegistry::contains(const std::string& class_id) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return built_ins_.count(class_id) > 0;
+}
+
+std::vector<StageRegistry::Entry> StageRegistry::entries() const {
+	std::vector<Entry> result;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (const auto& pair : built_ins_)
+			result.push_back(pair.second);
+	}
+	std::sort(result.begin(), result.end(), [](const Entry& a, const Entry& b) { return a.class_id < b.class_id; });
+	return result;
+}
+
+StageRegistry::PluginLoader& StageRegistry::pluginLoader() const {
+	// plugin_mutex_ is locked by caller
+	if (!plugin_loader_)
+		plugin_loader_.reset(new PluginLoader());
+	return *plugin_loader_;
+}
+
+StageRegistry::Factory StageRegistry::factory(const std::string& class_id) const {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = built_ins_.find(class_id);
+		if (it != built_ins_.end())
+			return it->second.factory;
+	}
+	{
+		std::lock_guard<std::mutex> lock(plugin_mutex_);
+		if (!pluginLoader().loader.isClassAvailable(class_id))
+			throw std::runtime_error("Unknown stage type '" + class_id + "'");
+	}
+	return [this, class_id]() -> Stage* {
+		std::lock_guard<std::mutex> lock(plugin_mutex_);
+		try {
+			return pluginLoader().loader.createUnmanagedInstance(class_id);
+		} catch (const pluginlib::PluginlibException& e) {
+			throw std::runtime_error("Cannot create stage '" + class_id + "': " + e.what());
+		}
+	};
+}
+
+Stage::pointer StageRegistry::create(const std::string& class_id) const {
+	return Stage::pointer(factory(class_id)());
+}
+
+std::vector<std::string> StageRegistry::declaredClasses() const {
+	std::vector<std::string> result;
+	for (const Entry& entry : entries())
+		result.push_back(entry.class_id);
+	std::lock_guard<std::mutex> lock(plugin_mutex_);
+	for (const std::string& class_id : pluginLoader().loader.getDeclaredClasses())
+		if (!contains(class_id))
+			result.push_back(class_id);
+	return result;
+}
+
+void StageRegistry::preloadPlugins() const {
+	std::lock_guard<std::mutex> lock(plugin_mutex_);
+	auto& loader = pluginLoader().loader;
+	for (const std::string& class_id : loader.getDeclaredClasses())
+		if (!contains(class_id))
+			loader.loadLibraryForClass(class_id);
+}
+}  // namespace task_constructor
+}  // namespace moveit
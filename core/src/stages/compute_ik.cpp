@@ -36,8 +36,14 @@
 
 #include <moveit/task_constructor/stages/compute_ik.h>
 #include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/collision_cache.h>
 #include <moveit/task_constructor/marker_tools.h>
 #include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/task_constructor/preemption.h>
+#include <moveit/task_constructor/reachability_map.h>
+#include <moveit/task_constructor/scratch_state.h>
+#include <moveit/task_constructor/task_executor.h>
+#include <moveit/task_constructor/warm_start.h>
 
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_state/conversions.h>
@@ -45,9 +51,15 @@
 
 #include <Eigen/Geometry>
 #include <tf2_eigen/tf2_eigen.h>
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
 #include <functional>
 #include <iterator>
+#include <mutex>
+#include <sstream>
+#include <thread>
 #include <ros/console.h>
 
 namespace moveit {
@@ -63,6 +75,13 @@ ComputeIK::ComputeIK(const std::string& name, Stage::pointer&& child) : WrapperB
 	p.declare<bool>("ignore_collisions", false);
 	p.declare<double>("min_solution_distance", 0.1,
 	                  "minimum distance between seperate IK solutions for the same target");
+	p.declare<uint32_t>("num_threads", 1, "number of concurrent IK attempts from different seeds");
+	p.declare<IKCachePtr>("ik_cache", IKCachePtr(), "cache of IK solutions used as seeds");
+	p.declare<uint32_t>("batch_size", 1, "number of targets solved concurrently");
+	p.declare<SolutionFilter>("ik_filter", SolutionFilter(), "filter for valid IK solutions");
+	p.declare<ReachabilityMapPtr>("reachability_map", ReachabilityMapPtr(),
+	                              "reachability map of the IK link, rejecting unreachable targets before IK");
+	p.declare<double>("reachability_weight", 0.0, "cost weight of poorly reachable targets");
 
 	// ik_frame and target_pose are read from the interface
 	p.declare<geometry_msgs::PoseStamped>("ik_frame", "frame to be moved towards goal pose");
@@ -88,23 +107,204 @@ using IKSolutions = std::vector<std::vector<double>>;
 
 namespace {
 
+void quantize(std::ostream& os, double value, double resolution) {
+	os << std::lround(value / resolution) << ',';
+}
+
+// fingerprint of kinematic structure and limits, distinguishing equally named models
+size_t modelHash(const moveit::core::RobotModel& model) {
+	std::ostringstream os;
+	os << model.getName() << '|';
+	for (const moveit::core::JointModel* jm : model.getActiveJointModels()) {
+		os << jm->getName() << ':' << jm->getParentLinkModel()->getName() << ':';
+		for (const auto& bounds : jm->getVariableBounds())
+			os << bounds.min_position_ << ',' << bounds.max_position_ << ';';
+	}
+	return std::hash<std::string>()(os.str());
+}
+}  // namespace
+
+IKCache::IKCache(double position_resolution, double orientation_resolution, size_t max_solutions_per_target,
+                 size_t max_targets)
+  : position_resolution_(position_resolution)
+  , orientation_resolution_(orientation_resolution)
+  , max_solutions_per_target_(max_solutions_per_target)
+  , max_targets_(std::max<size_t>(1, max_targets)) {}
+
+std::string IKCache::key(const core::JointModelGroup* jmg, const core::LinkModel* link,
+                         const Eigen::Isometry3d& pose) const {
+	std::ostringstream os;
+	os << modelHash(*jmg->getParentModel()) << '|' << jmg->getName() << '|' << link->getName() << '|';
+	for (int i = 0; i < 3; ++i)
+		quantize(os, pose.translation()[i], position_resolution_);
+	Eigen::Quaterniond q(pose.linear());
+	if (q.w() < 0)  // q and -q denote the same rotation
+		q.coeffs() = -q.coeffs();
+	for (int i = 0; i < 4; ++i)
+		quantize(os, q.coeffs()[i], orientation_resolution_);
+	return os.str();
+}
+
+std::vector<std::vector<double>> IKCache::lookup(const core::JointModelGroup* jmg, const core::LinkModel* link,
+                                                 const Eigen::Isometry3d& pose) const {
+	const std::string k = key(jmg, link, pose);
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = entries_.find(k);
+	if (it == entries_.end())
+		return {};
+	return { it->second.solutions.begin(), it->second.solutions.end() };
+}
+
+void IKCache::store(const core::JointModelGroup* jmg, const core::LinkModel* link, const Eigen::Isometry3d& pose,
+                    const std::vector<double>& solution) {
+	const std::string k = key(jmg, link, pose);
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = entries_.find(k);
+	if (it == entries_.end()) {
+		if (entries_.size() >= max_targets_) {  // evict least recently stored target
+			entries_.erase(usage_.back());
+			usage_.pop_back();
+		}
+		usage_.push_front(k);
+		it = entries_.emplace(k, Entry{ {}, usage_.begin() }).first;
+	} else
+		usage_.splice(usage_.begin(), usage_, it->second.usage);
+
+	auto& solutions = it->second.solutions;
+	for (const auto& s : solutions)
+		if (jmg->distance(s.data(), solution.data()) < 1e-6)
+			return;  // already known
+	solutions.push_front(solution);
+	if (solutions.size() > max_solutions_per_target_)
+		solutions.pop_back();
+}
+
+size_t IKCache::size() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return entries_.size();
+}
+
+void IKCache::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_.clear();
+	usage_.clear();
+}
+
+namespace {
+
+/// markers shared by all solutions of an IK target, generated once on first demand
+class SharedMarkers
+{
+	std::once_flag generated_;
+	SolutionBase::MarkerGenerator generator_;
+	std::deque<visualization_msgs::Marker> markers_;
+
+public:
+	explicit SharedMarkers(SolutionBase::MarkerGenerator generator) : generator_(std::move(generator)) {}
+
+	static SolutionBase::MarkerGenerator appender(const std::shared_ptr<SharedMarkers>& shared) {
+		return [shared](std::deque<visualization_msgs::Marker>& markers) {
+			std::call_once(shared->generated_, [&shared]() {
+				shared->generator_(shared->markers_);
+				shared->generator_ = nullptr;
+			});
+			markers.insert(markers.end(), shared->markers_.begin(), shared->markers_.end());
+		};
+	}
+};
+
+/** Grid over (up to) three bounded single-variable joints, to find solutions closer than min_distance
+ *
+ * A joint's weighted distance never exceeds the group's distance.
+ * Hence, close solutions are found in adjacent cells and grid lookup is logarithmic in the number of solutions.
+ */
+class SolutionIndex
+{
+public:
+	SolutionIndex(const robot_model::JointModelGroup* jmg, double min_distance)
+	  : jmg_(jmg), min_distance_(min_distance) {
+		std::vector<Dimension> candidates;
+		for (const robot_model::JointModel* jm : jmg->getActiveJointModels()) {
+			const auto type = jm->getType();
+			if (jm->getVariableCount() != 1 || jm->getDistanceFactor() <= 0.0 ||
+			    !(type == robot_model::JointModel::PRISMATIC ||
+			      (type == robot_model::JointModel::REVOLUTE &&
+			       !static_cast<const robot_model::RevoluteJointModel*>(jm)->isContinuous())))
+				continue;  // no simple bound for the variable difference
+			const auto& bounds = jm->getVariableBounds()[0];
+			candidates.push_back({ static_cast<size_t>(jmg->getVariableGroupIndex(jm->getName())),
+			                       min_distance / jm->getDistanceFactor(), bounds.max_position_ - bounds.min_position_ });
+		}
+		// index joints with largest range (in cells) for best spread
+		std::sort(candidates.begin(), candidates.end(), [](const Dimension& a, const Dimension& b) {
+			return a.range / a.cell > b.range / b.cell;
+		});
+		candidates.resize(std::min<size_t>(candidates.size(), 3));
+		dims_ = candidates;
+	}
+
+	bool hasNeighbor(const double* positions) const {
+		if (min_distance_ <= 0.0)
+			return false;
+		Cell lower = cell(positions), upper = lower;
+		for (size_t i = 0; i != dims_.size(); ++i)
+			--lower[i], ++upper[i];
+		// iterate cells in [lower, upper], map is ordered lexicographically
+		Cell c = lower;
+		while (true) {
+			auto it = cells_.find(c);
+			if (it != cells_.end())
+				for (const auto& s : it->second)
+					if (jmg_->distance(positions, s.data()) < min_distance_)
+						return true;
+			size_t i = 0;
+			for (; i != dims_.size() && c[i] == upper[i]; ++i)
+				c[i] = lower[i];
+			if (i == dims_.size())
+				return false;
+			++c[i];
+		}
+	}
+
+	void insert(const std::vector<double>& positions) { cells_[cell(positions.data())].push_back(positions); }
+
+private:
+	using Cell = std::array<long, 3>;
+	struct Dimension
+	{
+		size_t index;  // variable index in group
+		double cell;  // cell size
+		double range;
+	};
+	Cell cell(const double* positions) const {
+		Cell c{ 0, 0, 0 };
+		for (size_t i = 0; i != dims_.size(); ++i)
+			c[i] = static_cast<long>(std::floor(positions[dims_[i].index] / dims_[i].cell));
+		return c;
+	}
+
+	const robot_model::JointModelGroup* jmg_;
+	const double min_distance_;
+	std::vector<Dimension> dims_;
+	std::map<Cell, IKSolutions> cells_;
+};
+
+// a single setFromIK() call from a given seed
+struct IKAttempt
+{
+	explicit IKAttempt(const robot_state::RobotState& seed) : state(seed) {}
+	ScratchState state;
+	IKSolutions candidates;  // all solutions passed to the validity callback, the last one is valid on success
+	bool succeeded = false;
+};
+
 // ??? TODO: provide callback methods in PlanningScene class / probably not very useful here though...
 // TODO: move into MoveIt core, lift active_components_only_ from fcl to common interface
-bool isTargetPoseCollidingInEEF(const planning_scene::PlanningSceneConstPtr& scene,
-                                robot_state::RobotState& robot_state, Eigen::Isometry3d pose,
-                                const robot_model::LinkModel* link,
-                                collision_detection::CollisionResult* collision_result = nullptr) {
-	// consider all rigidly connected parent links as well
+// copy of the scene's ACM, disabling collision checking for the parent links of link (except links fixed to root)
+collision_detection::AllowedCollisionMatrix eefCollisionMatrix(const planning_scene::PlanningScene& scene,
+                                                               const robot_model::LinkModel* link) {
+	auto acm = scene.getAllowedCollisionMatrix();
 	const robot_model::LinkModel* parent = robot_model::RobotModel::getRigidlyConnectedParentLinkModel(link);
-	if (parent != link)  // transform pose into pose suitable to place parent
-		pose = pose * robot_state.getGlobalLinkTransform(link).inverse() * robot_state.getGlobalLinkTransform(parent);
-
-	// place links at given pose
-	robot_state.updateStateWithLinkAt(parent, pose);
-	robot_state.updateCollisionBodyTransforms();
-
-	// disable collision checking for parent links (except links fixed to root)
-	auto acm = scene->getAllowedCollisionMatrix();
 	std::vector<const std::string*> pending_links;  // parent link names that might be rigidly connected to root
 	while (parent) {
 		pending_links.push_back(&parent->getName());
@@ -118,6 +318,22 @@ bool isTargetPoseCollidingInEEF(const planning_scene::PlanningSceneConstPtr& sce
 			pending_links.clear();
 		}
 	}
+	return acm;
+}
+
+bool isTargetPoseCollidingInEEF(const planning_scene::PlanningSceneConstPtr& scene,
+                                robot_state::RobotState& robot_state, Eigen::Isometry3d pose,
+                                const robot_model::LinkModel* link,
+                                const collision_detection::AllowedCollisionMatrix& acm,
+                                collision_detection::CollisionResult* collision_result = nullptr) {
+	// consider all rigidly connected parent links as well
+	const robot_model::LinkModel* parent = robot_model::RobotModel::getRigidlyConnectedParentLinkModel(link);
+	if (parent != link)  // transform pose into pose suitable to place parent
+		pose = pose * robot_state.getGlobalLinkTransform(link).inverse() * robot_state.getGlobalLinkTransform(parent);
+
+	// place links at given pose
+	robot_state.updateStateWithLinkAt(parent, pose);
+	robot_state.updateCollisionBodyTransforms();
 
 	// check collision with the world using the padded version
 	collision_detection::CollisionRequest req;
@@ -175,11 +391,51 @@ bool validateGroup(const PropertyMap& props, const moveit::core::RobotModelConst
 
 }  // anonymous namespace
 
+struct ComputeIK::IKJob
+{
+	struct Result
+	{
+		planning_scene::PlanningScenePtr scene;
+		SubTrajectory solution;
+		bool forward_properties;  // forward properties of the target's interface state
+	};
+
+	const SolutionBase* solution;  // upstream solution providing the target
+	PropertyMap properties;  // stage properties initialized from the target's interface state
+	std::vector<Result> results;
+};
+
+struct ComputeIK::EEFCollisionMatrix
+{
+	// scene diffs share their parent's ACM unless modified, hence successive targets usually reuse the matrix
+	bool matches(const planning_scene::PlanningSceneConstPtr& s, const robot_model::LinkModel* l) const {
+		return link == l && base == &s->getAllowedCollisionMatrix();
+	}
+
+	planning_scene::PlanningSceneConstPtr scene;  // keeps base alive
+	const collision_detection::AllowedCollisionMatrix* base = nullptr;
+	const robot_model::LinkModel* link = nullptr;
+	collision_detection::AllowedCollisionMatrix acm;
+};
+
 void ComputeIK::reset() {
 	upstream_solutions_.clear();
+	eef_acm_.clear();
 	WrapperBase::reset();
 }
 
+bool ComputeIK::enableWarmStart(WarmStartCache& cache) {
+	if (properties().get<IKCachePtr>("ik_cache"))
+		return false;
+	setIKCache(cache.get<IKCache>("ik_cache"));
+	return true;
+}
+
+void ComputeIK::regenerate() {
+	upstream_solutions_.clear();
+	WrapperBase::regenerate();
+}
+
 void ComputeIK::init(const moveit::core::RobotModelConstPtr& robot_model) {
 	InitStageException errors;
 	try {
@@ -216,20 +472,9 @@ bool ComputeIK::canCompute() const {
 	return !upstream_solutions_.empty() || WrapperBase::canCompute();
 }
 
-void ComputeIK::compute() {
-	if (WrapperBase::canCompute())
-		WrapperBase::compute();
-
-	if (upstream_solutions_.empty())
-		return;
-
-	const SolutionBase& s = *upstream_solutions_.pop();
-
-	// -1 TODO: this should not be necessary in my opinion: Why do you think so?
-	// It is, because the properties on the interface might change from call to call...
-	// enforced initialization from interface ensures that new target_pose is read
-	properties().performInitFrom(INTERFACE, s.start()->properties());
-	const auto& props = properties();
+void ComputeIK::solveTarget(IKJob& job, EEFCollisionMatrix& eef_acm, bool unlock) {
+	const SolutionBase& s = *job.solution;
+	const auto& props = job.properties;
 
 	const planning_scene::PlanningSceneConstPtr& scene{ s.start()->scene() };
 
@@ -251,7 +496,7 @@ void ComputeIK::compute() {
 		ROS_WARN_STREAM_NAMED("ComputeIK", "Neither eef nor group are well defined");
 		return;
 	}
-	properties().property("timeout").setDefaultValue(jmg->getDefaultIKTimeout());
+	job.properties.property("timeout").setDefaultValue(jmg->getDefaultIKTimeout());
 
 	// extract target_pose
 	geometry_msgs::PoseStamped target_pose_msg = props.get<geometry_msgs::PoseStamped>("target_pose");
@@ -300,118 +545,254 @@ void ComputeIK::compute() {
 		target_pose = target_pose * ik_pose.inverse() * scene->getCurrentState().getFrameTransform(link->getName());
 	}
 
+	// markers are only generated on demand (if a solution gets introspected) and shared by all solutions
+	// frames at target pose and ik frame
+	auto frame_markers = SharedMarkers::appender(std::make_shared<SharedMarkers>(
+	    [target_pose_msg, ik_pose_msg](std::deque<visualization_msgs::Marker>& markers) {
+		    rviz_marker_tools::appendFrame(markers, target_pose_msg, 0.1, "target frame");
+		    rviz_marker_tools::appendFrame(markers, ik_pose_msg, 0.1, "ik frame");
+	    }));
+
+	// pre-filter targets outside the reachable workspace, which would only exhaust IK attempts
+	double reachability_cost = 0.0;
+	const ReachabilityMapPtr& reachability = props.get<ReachabilityMapPtr>("reachability_map");
+	if (reachability && reachability->matches(jmg, link)) {
+		const Eigen::Isometry3d& root_tf =
+		    scene->getCurrentState().getGlobalLinkTransform(ReachabilityMap::rootLink(jmg));
+		const Eigen::Vector3d position = root_tf.inverse() * target_pose.translation();
+		if (!reachability->contains(position)) {
+			SubTrajectory solution;
+			solution.addMarkers(frame_markers);
+			solution.setComment(s.comment());
+			solution.markAsFailure("target unreachable according to reachability map");
+			job.results.push_back({ scene->diff(), std::move(solution), false });
+			return;
+		}
+		// voxels never sampled might still be reachable: only penalize them
+		reachability_cost = props.get<double>("reachability_weight") * (1.0 - reachability->score(position));
+	}
+
 	// validate placed link for collisions
 	collision_detection::CollisionResult collisions;
-	robot_state::RobotState sandbox_state{ scene->getCurrentState() };
-	bool colliding =
-	    !ignore_collisions && isTargetPoseCollidingInEEF(scene, sandbox_state, target_pose, link, &collisions);
+	ScratchState sandbox{ scene->getCurrentState() };
+	robot_state::RobotState& sandbox_state = *sandbox;
+	bool colliding = false;
+	if (!ignore_collisions) {
+		if (!eef_acm.matches(scene, link)) {
+			eef_acm.scene = scene;
+			eef_acm.base = &scene->getAllowedCollisionMatrix();
+			eef_acm.link = link;
+			eef_acm.acm = eefCollisionMatrix(*scene, link);
+		}
+		colliding = isTargetPoseCollidingInEEF(scene, sandbox_state, target_pose, link, eef_acm.acm, &collisions);
+	}
 
-	// frames at target pose and ik frame
-	std::deque<visualization_msgs::Marker> frame_markers;
-	rviz_marker_tools::appendFrame(frame_markers, target_pose_msg, 0.1, "target frame");
-	rviz_marker_tools::appendFrame(frame_markers, ik_pose_msg, 0.1, "ik frame");
-	// end-effector markers
-	std::deque<visualization_msgs::Marker> eef_markers;
-	// visualize placed end-effector
-	auto appender = [&eef_markers](visualization_msgs::Marker& marker, const std::string& /*name*/) {
-		marker.ns = "ik target";
-		marker.color.a *= 0.5;
-		eef_markers.push_back(marker);
+	// end-effector markers, visualizing the placed end-effector of sandbox_state
+	const std::vector<const moveit::core::LinkModel*>* links_to_visualize =
+	    &moveit::core::RobotModel::getRigidlyConnectedParentLinkModel(link)
+	         ->getParentJointModel()
+	         ->getDescendantLinkModels();
+	std::shared_ptr<const robot_state::RobotState> eef_state;
+	if (SolutionBase::markersEnabled())
+		eef_state = std::make_shared<const robot_state::RobotState>(sandbox_state);
+	auto eef_markers = [eef_state, links_to_visualize, colliding](bool tinted) {
+		return SharedMarkers::appender(std::make_shared<SharedMarkers>(
+		    [eef_state, links_to_visualize, colliding, tinted](std::deque<visualization_msgs::Marker>& markers) {
+			    auto appender = [&markers, tinted](visualization_msgs::Marker& marker, const std::string& /*name*/) {
+				    marker.ns = "ik target";
+				    marker.color.a *= 0.5;
+				    if (tinted) {  // red
+					    marker.color.r = 1.0;
+					    marker.color.g = 0.0;
+					    marker.color.b = 0.0;
+					    marker.color.a = 0.5;
+				    }
+				    markers.push_back(marker);
+			    };
+			    if (!eef_state)  // markers were disabled when the target was processed
+				    return;
+			    if (colliding)
+				    generateCollisionMarkers(*eef_state, appender, *links_to_visualize);
+			    else
+				    generateVisualMarkers(*eef_state, appender, *links_to_visualize);
+		    }));
 	};
-	const auto& links_to_visualize = moveit::core::RobotModel::getRigidlyConnectedParentLinkModel(link)
-	                                     ->getParentJointModel()
-	                                     ->getDescendantLinkModels();
 	if (colliding) {
 		SubTrajectory solution;
-		std::copy(frame_markers.begin(), frame_markers.end(), std::back_inserter(solution.markers()));
-		generateCollisionMarkers(sandbox_state, appender, links_to_visualize);
-		std::copy(eef_markers.begin(), eef_markers.end(), std::back_inserter(solution.markers()));
+		solution.addMarkers(frame_markers);
+		solution.addMarkers(eef_markers(false));
 		solution.markAsFailure();
 		// TODO: visualize collisions
-		solution.setComment(s.comment() + " eef in collision: " + listCollisionPairs(collisions.contacts, ", "));
+		solution.setComment(s.comment());
+		solution.setFailureReason("eef in collision");
+		solution.formatComment([contacts = std::move(collisions.contacts)](std::string& comment) {
+			comment.append(" eef in collision: ").append(listCollisionPairs(contacts, ", "));
+		});
 		auto colliding_scene{ scene->diff() };
 		colliding_scene->setCurrentState(sandbox_state);
-		spawn(InterfaceState(colliding_scene), std::move(solution));
+		job.results.push_back({ colliding_scene, std::move(solution), false });
 		return;
-	} else
-		generateVisualMarkers(sandbox_state, appender, links_to_visualize);
+	}
+	auto placed_eef_markers = eef_markers(false);
 
 	// determine joint values of robot pose to compare IK solution with for costs
 	std::vector<double> compare_pose;
 	const std::string& compare_pose_name = props.get<std::string>("default_pose");
 	if (!compare_pose_name.empty()) {
-		robot_state::RobotState compare_state(robot_model);
-		compare_state.setToDefaultValues(jmg, compare_pose_name);
-		compare_state.copyJointGroupPositions(jmg, compare_pose);
+		ScratchState compare_state(robot_model);
+		compare_state->setToDefaultValues(jmg, compare_pose_name);
+		compare_state->copyJointGroupPositions(jmg, compare_pose);
 	} else
 		scene->getCurrentState().copyJointGroupPositions(jmg, compare_pose);
 
 	double min_solution_distance = props.get<double>("min_solution_distance");
 
 	IKSolutions ik_solutions;
-	auto is_valid = [scene, ignore_collisions, min_solution_distance,
-	                 &ik_solutions](robot_state::RobotState* state, const robot_model::JointModelGroup* jmg,
-	                                const double* joint_positions) {
-		for (const auto& sol : ik_solutions) {
+	SolutionIndex ik_index(jmg, min_solution_distance);  // spatial index of ik_solutions
+	const PreemptionToken* preempt = preemptionToken();
+	auto too_close = [min_solution_distance](const IKSolutions& solutions, const robot_model::JointModelGroup* jmg,
+	                                         const double* joint_positions) {
+		for (const auto& sol : solutions) {
 			if (jmg->distance(joint_positions, sol.data()) < min_solution_distance)
-				return false;  // too close to already found solution
+				return true;
 		}
-		state->setJointGroupPositions(jmg, joint_positions);
-		ik_solutions.emplace_back();
-		state->copyJointGroupPositions(jmg, ik_solutions.back());
-
-		return ignore_collisions || !scene->isStateColliding(*state, jmg->getName());
+		return false;
+	};
+	// collision results are shared with later stages checking the same state, e.g. Connect
+	const CollisionCachePtr collision_cache = CollisionCache::instance();
+	// attempts of a round only read ik_index, which is extended after all attempts finished
+	auto solve = [&](IKAttempt& attempt, double time_limit) {
+		auto is_valid = [&](robot_state::RobotState* state, const robot_model::JointModelGroup* jmg,
+		                    const double* joint_positions) {
+			if (PreemptionToken::requested(preempt))
+				return false;  // reject further solutions
+			if (ik_index.hasNeighbor(joint_positions) || too_close(attempt.candidates, jmg, joint_positions))
+				return false;  // too close to already found solution
+			state->setJointGroupPositions(jmg, joint_positions);
+			attempt.candidates.emplace_back();
+			state->copyJointGroupPositions(jmg, attempt.candidates.back());
+
+			if (ignore_collisions)
+				return true;
+			auto check = [&]() { return scene->isStateColliding(*state, jmg->getName()); };
+			return !(collision_cache ? collision_cache->isColliding(scene, *state, jmg->getName(), check) : check());
+		};
+		attempt.succeeded = attempt.state->setFromIK(jmg, target_pose, link->getName(), time_limit, is_valid);
 	};
 
 	uint32_t max_ik_solutions = props.get<uint32_t>("max_ik_solutions");
+	const uint32_t num_threads = std::max<uint32_t>(1, props.get<uint32_t>("num_threads"));
 	bool tried_current_state_as_seed = false;
 
-	double remaining_time = timeout();
+	// try cached solutions first, which are still to be validated in the current scene
+	const IKCachePtr& cache = props.get<IKCachePtr>("ik_cache");
+	IKSolutions cached_seeds;
+	if (cache)
+		cached_seeds = cache->lookup(jmg, link, target_pose);
+	auto next_seed = cached_seeds.cbegin();
+
+	const SolutionFilter& filter = props.get<SolutionFilter>("ik_filter");
+	ScratchState filter{ sandbox_state };
+	robot_state::RobotState& filter_state = *filter;
+	size_t num_rejected = 0;
+	std::string rejection;
+
+	double remaining_time = props.get<double>("timeout");
 	auto start_time = std::chrono::steady_clock::now();
-	while (ik_solutions.size() < max_ik_solutions && remaining_time > 0) {
-		if (tried_current_state_as_seed)
-			sandbox_state.setToRandomPositions(jmg);
-		tried_current_state_as_seed = true;
+	while (ik_solutions.size() < max_ik_solutions && remaining_time > 0 && !PreemptionToken::requested(preempt)) {
+		// seed with cached solutions, then the current state, and randomly afterwards (each with its own state)
+		const size_t num_attempts = std::min<size_t>(num_threads, max_ik_solutions - ik_solutions.size());
+		std::vector<IKAttempt> attempts;
+		attempts.reserve(num_attempts);
+		for (size_t i = 0; i != num_attempts; ++i)
+			attempts.emplace_back(sandbox_state);
+		const bool cached_round = next_seed != cached_seeds.cend();
+		for (IKAttempt& attempt : attempts) {
+			if (next_seed != cached_seeds.cend())
+				attempt.state->setJointGroupPositions(jmg, *next_seed++);
+			else if (tried_current_state_as_seed)
+				attempt.state->setToRandomPositions(jmg);
+			else
+				tried_current_state_as_seed = true;
+		}
 
-		size_t previous = ik_solutions.size();
-		bool succeeded = sandbox_state.setFromIK(jmg, target_pose, link->getName(), remaining_time, is_valid);
+		{
+			std::unique_ptr<ComputeUnlock> unlocked;
+			if (unlock)  // allow other stages to compute meanwhile
+				unlocked.reset(new ComputeUnlock(*this));
+			std::vector<std::thread> threads;
+			const TaskExecutorPtr executor = TaskExecutor::current();
+			for (size_t i = 1; i < num_attempts; ++i)
+				threads.push_back(executor->spawn([&solve, &attempt = attempts[i], remaining_time]() {
+					solve(attempt, remaining_time);
+				}));
+			solve(attempts[0], remaining_time);
+			for (auto& thread : threads)
+				thread.join();
+		}
 
 		auto now = std::chrono::steady_clock::now();
 		remaining_time -= std::chrono::duration<double>(now - start_time).count();
 		start_time = now;
 
-		// for all new solutions (successes and failures)
-		for (size_t i = previous; i != ik_solutions.size(); ++i) {
-			// create a new scene for each solution as they will have different robot states
-			planning_scene::PlanningScenePtr solution_scene = scene->diff();
-			SubTrajectory solution;
-			solution.setComment(s.comment());
-			std::copy(frame_markers.begin(), frame_markers.end(), std::back_inserter(solution.markers()));
-
-			if (succeeded && i + 1 == ik_solutions.size())
-				// compute cost as distance to compare_pose
-				solution.setCost(s.cost() + jmg->distance(ik_solutions.back().data(), compare_pose.data()));
-			else  // found an IK solution, but this was not valid
-				solution.markAsFailure();
-
-			// set scene's robot state
-			robot_state::RobotState& solution_state = solution_scene->getCurrentStateNonConst();
-			solution_state.setJointGroupPositions(jmg, ik_solutions[i].data());
-			solution_state.update();
-
-			InterfaceState state(solution_scene);
-			forwardProperties(*s.start(), state);
-
-			// ik target link placement
-			std::copy(eef_markers.begin(), eef_markers.end(), std::back_inserter(solution.markers()));
-
-			spawn(std::move(state), std::move(solution));
+		bool succeeded = false;
+		for (const IKAttempt& attempt : attempts) {
+			succeeded = succeeded || attempt.succeeded;
+			// for all new solutions (successes and failures)
+			for (size_t i = 0; i != attempt.candidates.size(); ++i) {
+				const std::vector<double>& candidate = attempt.candidates[i];
+				// concurrent attempts might have found nearby solutions
+				if (ik_index.hasNeighbor(candidate.data()))
+					continue;
+				const bool valid = attempt.succeeded && i + 1 == attempt.candidates.size();
+				if (valid && cache)
+					cache->store(jmg, link, target_pose, candidate);
+				if (valid && filter) {
+					filter_state.setJointGroupPositions(jmg, candidate.data());
+					filter_state.update();
+					std::string comment;
+					if (!filter(scene, filter_state, *link, comment)) {
+						// keep searching elsewhere, but skip creating a scene and state for this solution
+						ik_index.insert(candidate);
+						++num_rejected;
+						rejection = comment;
+						continue;
+					}
+				}
+				ik_solutions.push_back(candidate);
+				ik_index.insert(candidate);
+
+				// create a new scene for each solution as they will have different robot states
+				planning_scene::PlanningScenePtr solution_scene = scene->diff();
+				SubTrajectory solution;
+				solution.setComment(s.comment());
+				solution.addMarkers(frame_markers);
+
+				if (valid)  // compute cost as distance to compare_pose
+					solution.setCost(s.cost() + jmg->distance(candidate.data(), compare_pose.data()) +
+					                 reachability_cost);
+				else  // found an IK solution, but this was not valid
+					solution.markAsFailure();
+
+				// set scene's robot state
+				robot_state::RobotState& solution_state = solution_scene->getCurrentStateNonConst();
+				solution_state.setJointGroupPositions(jmg, candidate.data());
+				solution_state.update();
+				// the solution scene only differs in the robot state: share its collision check
+				if (valid && !ignore_collisions && collision_cache)
+					collision_cache->storeColliding(solution_scene, solution_state, jmg->getName(), false);
+
+				// ik target link placement
+				solution.addMarkers(placed_eef_markers);
+
+				job.results.push_back({ solution_scene, std::move(solution), true });
+			}
 		}
 
 		// TODO: magic constant should be a property instead ("current_seed_only", or equivalent)
 		// Yeah, you are right, these are two different semantic concepts:
 		// One could also have multiple IK solutions derived from the same seed
-		if (!succeeded && max_ik_solutions == 1)
+		if (!succeeded && max_ik_solutions == 1 && !cached_round)
 			break;  // first and only attempt failed
 	}
 
@@ -420,20 +801,70 @@ void ComputeIK::compute() {
 		SubTrajectory solution;
 
 		solution.markAsFailure();
-		solution.setComment(s.comment() + " no IK found");
-		std::copy(frame_markers.begin(), frame_markers.end(), std::back_inserter(solution.markers()));
-
-		// ik target link placement
-		std_msgs::ColorRGBA tint_color;
-		tint_color.r = 1.0;
-		tint_color.g = 0.0;
-		tint_color.b = 0.0;
-		tint_color.a = 0.5;
-		for (auto& marker : eef_markers)
-			marker.color = tint_color;
-		std::copy(eef_markers.begin(), eef_markers.end(), std::back_inserter(solution.markers()));
-
-		spawn(InterfaceState(scene), std::move(solution));
+		solution.setComment(s.comment());
+		solution.setFailureReason(num_rejected ? "IK solutions rejected" : "no IK found");
+		solution.formatComment([num_rejected, rejection](std::string& comment) {
+			if (num_rejected)
+				comment += " " + std::to_string(num_rejected) + " IK solution(s) rejected" +
+				           (rejection.empty() ? "" : ": " + rejection);
+			else
+				comment += " no IK found";
+		});
+		solution.addMarkers(frame_markers);
+
+		// ik target link placement, tinted red
+		solution.addMarkers(eef_markers(true));
+
+		job.results.push_back({ scene, std::move(solution), false });
+	}
+}
+
+void ComputeIK::compute() {
+	if (WrapperBase::canCompute())
+		WrapperBase::compute();
+
+	// collect a batch of targets
+	const uint32_t batch_size = std::max<uint32_t>(1, properties().get<uint32_t>("batch_size"));
+	std::vector<IKJob> jobs;
+	while (!upstream_solutions_.empty() && jobs.size() < batch_size) {
+		const SolutionBase& s = *upstream_solutions_.pop();
+
+		// -1 TODO: this should not be necessary in my opinion: Why do you think so?
+		// It is, because the properties on the interface might change from call to call...
+		// enforced initialization from interface ensures that new target_pose is read
+		properties().performInitFrom(INTERFACE, s.start()->properties());
+		jobs.push_back(IKJob{ &s, properties(), {} });  // snapshot properties per target
+	}
+	if (jobs.empty())
+		return;
+
+	while (eef_acm_.size() < jobs.size())
+		eef_acm_.push_back(std::make_shared<EEFCollisionMatrix>());
+	if (jobs.size() == 1)
+		solveTarget(jobs[0], *eef_acm_[0], true);
+	else {
+		ComputeUnlock unlock(*this);  // allow other stages to compute meanwhile
+		std::vector<std::thread> threads;
+		const TaskExecutorPtr executor = TaskExecutor::current();
+		for (size_t i = 1; i < jobs.size(); ++i)
+			threads.push_back(executor->spawn([this, &jobs, i]() { solveTarget(jobs[i], *eef_acm_[i], false); }));
+		solveTarget(jobs[0], *eef_acm_[0], false);
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	// spawn the most promising results of the batch first
+	std::vector<std::pair<const SolutionBase*, IKJob::Result*>> results;
+	for (IKJob& job : jobs)
+		for (IKJob::Result& result : job.results)
+			results.emplace_back(job.solution, &result);
+	std::stable_sort(results.begin(), results.end(),
+	                 [](const auto& a, const auto& b) { return a.second->solution.cost() < b.second->solution.cost(); });
+	for (const auto& result : results) {
+		InterfaceState state(result.second->scene);
+		if (result.second->forward_properties)
+			forwardProperties(*result.first->start(), state);
+		spawn(std::move(state), std::move(result.second->solution));
 	}
 }
 }  // namespace stages
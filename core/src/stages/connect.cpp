@@ -37,20 +37,51 @@
 */
 
 #include <moveit/task_constructor/stages/connect.h>
+#include <moveit/task_constructor/stage_p.h>
 #include <moveit/task_constructor/merge.h>
 #include <moveit/task_constructor/moveit_compat.h>
 #include <moveit/task_constructor/cost_terms.h>
+#include <moveit/task_constructor/event_log.h>
+#include <moveit/task_constructor/utils.h>
+#include <moveit/task_constructor/warm_start.h>
 
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
 
+#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <limits>
+
 using namespace trajectory_processing;
 
 namespace moveit {
 namespace task_constructor {
 namespace stages {
 
-Connect::Connect(const std::string& name, const GroupPlannerVector& planners) : Connecting(name), planner_(planners) {
+namespace {
+bool isEmpty(const moveit_msgs::Constraints& constraints) {
+	return constraints.joint_constraints.empty() && constraints.position_constraints.empty() &&
+	       constraints.orientation_constraints.empty() && constraints.visibility_constraints.empty();
+}
+
+// start scene with the goal's joint positions of group jmg
+planning_scene::PlanningSceneConstPtr intermediateGoal(const planning_scene::PlanningSceneConstPtr& start,
+                                                       const moveit::core::RobotState& goal,
+                                                       const moveit::core::JointModelGroup* jmg) {
+	planning_scene::PlanningScenePtr end = start->diff();
+	std::vector<double> positions;
+	goal.copyJointGroupPositions(jmg, positions);
+	robot_state::RobotState& goal_state = end->getCurrentStateNonConst();
+	goal_state.setJointGroupPositions(jmg, positions);
+	goal_state.update();
+	return end;
+}
+}  // namespace
+
+Connect::Connect(const std::string& name, const GroupPlannerVector& planners)
+  : Connecting(name), planner_(planners), prescreen_planner_(std::make_shared<solvers::JointInterpolationPlanner>()) {
 	setTimeout(1.0);
 	setCostTerm(std::make_unique<cost::PathLength>());
 
@@ -60,21 +91,65 @@ Connect::Connect(const std::string& name, const GroupPlannerVector& planners) :
 	                                    "constraints to maintain during trajectory");
 	properties().declare<TimeParameterizationPtr>("merge_time_parameterization",
 	                                              std::make_shared<TimeOptimalTrajectoryGeneration>());
+	p.declare<bool>("prescreen", false, "try joint interpolation before planning");
+	p.declare<double>("prescreen_max_distance", std::numeric_limits<double>::infinity(),
+	                  "max joint-space distance of pairs to consider when pre-screening");
+	p.declare<bool>("async_planning", false, "continue with further pairs while planning");
+	p.declare<uint32_t>("max_in_flight", 4, "max number of concurrently running asynchronous plans");
+}
+
+Connect::~Connect() {
+	cancelAsyncPlans();
+}
+
+void Connect::cancelAsyncPlans() {
+	for (solvers::PlannerInterface::AsyncPlan& plan : in_flight_)
+		plan.cancel();
+	in_flight_.clear();
 }
 
 void Connect::reset() {
+	cancelAsyncPlans();  // their continuations are dropped by Connecting::reset()
 	Connecting::reset();
-	merged_jmg_.reset();
+	prescreen_stats_ = PrescreenStatistics();
+	// keep merged_jmg_: init() might be skipped on next planning if the configuration didn't change
+	signatures_.clear();
 	subsolutions_.clear();
 	states_.clear();
 }
 
+std::vector<solvers::PlannerInterfaceConstPtr> Connect::planners() const {
+	std::vector<solvers::PlannerInterfaceConstPtr> result;
+	for (const auto& pair : planner_)
+		result.push_back(pair.second);
+	if (prescreen_planner_)
+		result.push_back(prescreen_planner_);
+	return result;
+}
+
+bool Connect::enableWarmStart(WarmStartCache& cache) {
+	bool changed = false;
+	for (auto& pair : planner_) {
+		const solvers::PlannerInterfacePtr planner = cache.cachingPlanner(pair.second);
+		changed |= planner != pair.second;
+		pair.second = planner;
+	}
+	return changed;
+}
+
 void Connect::init(const core::RobotModelConstPtr& robot_model) {
 	Connecting::init(robot_model);
 
 	InitStageException errors;
 	if (planner_.empty())
 		errors.push_back(*this, "empty set of groups");
+	prescreen_planner_->init(robot_model);
+
+	const auto& props = properties();
+	merge_mode_ = props.handle<MergeMode>("merge_mode");
+	path_constraints_ = props.handle<moveit_msgs::Constraints>("path_constraints");
+	prescreen_ = props.handle<bool>("prescreen");
+	prescreen_max_distance_ = props.handle<double>("prescreen_max_distance");
 
 	std::vector<const moveit::core::JointModelGroup*> groups;
 	for (const GroupPlannerVector::value_type& pair : planner_) {
@@ -90,7 +165,18 @@ void Connect::init(const core::RobotModelConstPtr& robot_model) {
 		}
 	}
 
-	if (!errors && groups.size() >= 2 && !merged_jmg_) {  // enable merging?
+	// all joints that we don't plan for should match in compatible states
+	std::set<const moveit::core::JointModel*> planned_joints;
+	for (const moveit::core::JointModelGroup* jmg : groups)
+		planned_joints.insert(jmg->getJointModels().begin(), jmg->getJointModels().end());
+	fixed_joints_.clear();
+	for (const moveit::core::JointModel* jm : robot_model->getJointModels())
+		if (jm->getVariableCount() > 0 && !planned_joints.count(jm))
+			fixed_joints_.push_back(jm);
+	signatures_.clear();
+
+	merged_jmg_.reset();  // groups might have changed
+	if (!errors && groups.size() >= 2) {  // enable merging?
 		try {
 			merged_jmg_.reset(task_constructor::merge(groups));
 		} catch (const std::runtime_error& e) {
@@ -106,40 +192,97 @@ bool Connect::compatible(const InterfaceState& from_state, const InterfaceState&
 	if (!Connecting::compatible(from_state, to_state))
 		return false;
 
-	const moveit::core::RobotState& from = from_state.scene()->getCurrentState();
-	const moveit::core::RobotState& to = to_state.scene()->getCurrentState();
-
-	// compose set of joint names we plan for
-	std::set<std::string> planned_joint_names;
-	for (const GroupPlannerVector::value_type& pair : planner_) {
-		const moveit::core::JointModelGroup* jmg = from.getJointModelGroup(pair.first);
-		const auto& names = jmg->getJointModelNames();
-		planned_joint_names.insert(names.begin(), names.end());
-	}
-	// all active joints that we don't plan for should match
-	for (const moveit::core::JointModel* jm : from.getRobotModel()->getJointModels()) {
-		if (planned_joint_names.count(jm->getName()))
-			continue;  // ignore joints we plan for
-
+	const JointSignature& from = signature(from_state);
+	const JointSignature& to = signature(to_state);
+	// usually, states share the very same joint values: equal hashes only need an exact check
+	if (from.hash == to.hash && from.positions == to.positions)
+		return true;
+	if ((from.positions - to.positions).isZero(1e-4))
+		return true;
+
+	// report the first deviating joint
+	Eigen::Index offset = 0;
+	for (const moveit::core::JointModel* jm : fixed_joints_) {
 		const unsigned int num = jm->getVariableCount();
-		Eigen::Map<const Eigen::VectorXd> positions_from(from.getJointPositions(jm), num);
-		Eigen::Map<const Eigen::VectorXd> positions_to(to.getJointPositions(jm), num);
+		auto positions_from = from.positions.segment(offset, num);
+		auto positions_to = to.positions.segment(offset, num);
 		if (!(positions_from - positions_to).isZero(1e-4)) {
 			ROS_INFO_STREAM_NAMED("Connect", "Deviation in joint " << jm->getName() << ": [" << positions_from.transpose()
 			                                                       << "] != [" << positions_to.transpose() << "]");
-			return false;
+			logEvent(pimpl()->eventSource(), EventLog::JOINT_DEVIATION,
+			         (positions_from - positions_to).cwiseAbs().maxCoeff(), jm->getJointIndex());
+			break;
 		}
+		offset += num;
+	}
+	return false;
+}
+
+const Connect::JointSignature& Connect::signature(const InterfaceState& state) const {
+	auto it = signatures_.find(&state);
+	if (it != signatures_.end())
+		return it->second;
+
+	const moveit::core::RobotState& robot_state = state.scene()->getCurrentState();
+	JointSignature sig{ 0, Eigen::VectorXd() };
+	Eigen::Index size = 0;
+	for (const moveit::core::JointModel* jm : fixed_joints_)
+		size += jm->getVariableCount();
+	sig.positions.resize(size);
+
+	Eigen::Index offset = 0;
+	for (const moveit::core::JointModel* jm : fixed_joints_) {
+		const unsigned int num = jm->getVariableCount();
+		sig.positions.segment(offset, num) = Eigen::Map<const Eigen::VectorXd>(robot_state.getJointPositions(jm), num);
+		offset += num;
 	}
-	return true;
+	boost::hash_range(sig.hash, sig.positions.data(), sig.positions.data() + size);
+	return signatures_.emplace(&state, std::move(sig)).first->second;
 }
 
 void Connect::compute(const InterfaceState& from, const InterfaceState& to) {
-	const auto& props = properties();
 	double timeout = this->timeout();
-	MergeMode mode = props.get<MergeMode>("merge_mode");
-	const auto& path_constraints = props.get<moveit_msgs::Constraints>("path_constraints");
+	const auto& path_constraints = path_constraints_.get();
 
 	const moveit::core::RobotState& final_goal_state = to.scene()->getCurrentState();
+	const bool prescreen = prescreen_.get();
+	if (prescreen) {  // gate pairs that are too far apart
+		const moveit::core::RobotState& from_state = from.scene()->getCurrentState();
+		double distance = 0.0;
+		for (const GroupPlannerVector::value_type& pair : planner_)
+			distance += from_state.distance(final_goal_state, final_goal_state.getJointModelGroup(pair.first));
+		if (distance > prescreen_max_distance_.get()) {
+			++prescreen_stats_.gated;
+			auto solution = std::make_shared<SubTrajectory>();
+			solution->markAsFailure("joint-space distance exceeds prescreen limit");
+			connect(from, to, solution);
+			return;
+		}
+	}
+
+	const auto& props = properties();
+	if (planner_.size() == 1 && !prescreen && props.get<bool>("async_planning") &&
+	    in_flight_.size() < props.get<uint32_t>("max_in_flight")) {
+		const solvers::PlannerInterfacePtr& planner = planner_.front().second;
+		const moveit::core::JointModelGroup* jmg = final_goal_state.getJointModelGroup(planner_.front().first);
+		planning_scene::PlanningSceneConstPtr end = intermediateGoal(from.scene(), final_goal_state, jmg);
+		auto plan = in_flight_.insert(in_flight_.end(),
+		                              planner->planAsync(from.scene(), end, jmg, timeout, path_constraints));
+		auto ready = [future = plan->future()]() {
+			return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		};
+		// from, to, and the plan persist until reset(), which drops the continuation
+		auto resume = [this, &from, &to, end, planner, plan]() {
+			const solvers::PlannerInterface::PlanResult r = plan->get();
+			in_flight_.erase(plan);
+			storeResult(from, to, { r.trajectory }, { from.scene(), end }, r.success, planner->validatesLazily(),
+			            { solvers::PlannerInterface::deferredTimeParameterization(planner) });
+		};
+		// on preemption, the planner fails early and its result is resumed as usual
+		addContinuation(ready, resume, [plan]() { plan->cancel(); });
+		return;
+	}
+
 	std::vector<robot_trajectory::RobotTrajectoryConstPtr> sub_trajectories;
 
 	std::vector<planning_scene::PlanningSceneConstPtr> intermediate_scenes;
@@ -147,19 +290,35 @@ void Connect::compute(const InterfaceState& from, const InterfaceState& to) {
 	intermediate_scenes.push_back(start);
 
 	bool success = false;
-	std::vector<double> positions;
+	bool validation_pending = false;  // any sub trajectory planned with lazy validation
+	std::vector<SubTrajectory::TimeParameterizer> timings;  // deferred time parameterization of sub trajectories
 	for (const GroupPlannerVector::value_type& pair : planner_) {
 		// set intermediate goal state
-		planning_scene::PlanningScenePtr end = start->diff();
 		const moveit::core::JointModelGroup* jmg = final_goal_state.getJointModelGroup(pair.first);
-		final_goal_state.copyJointGroupPositions(jmg, positions);
-		robot_state::RobotState& goal_state = end->getCurrentStateNonConst();
-		goal_state.setJointGroupPositions(jmg, positions);
-		goal_state.update();
+		planning_scene::PlanningSceneConstPtr end = intermediateGoal(start, final_goal_state, jmg);
 		intermediate_scenes.push_back(end);
 
 		robot_trajectory::RobotTrajectoryPtr trajectory;
-		success = pair.second->plan(start, end, jmg, timeout, trajectory, path_constraints);
+		bool swept = false;
+		{
+			ComputeUnlock unlock(*this);  // allow other stages to compute meanwhile
+			// cheap joint-space sweep first: only checks collisions, thus validate path constraints separately
+			if (prescreen)
+				swept = prescreen_planner_->plan(start, end, jmg, timeout, trajectory, path_constraints,
+				                                 preemptionToken()) &&
+				        (isEmpty(path_constraints) || start->isPathValid(*trajectory, path_constraints, jmg->getName()));
+			if (!swept) {
+				trajectory.reset();
+				success = pair.second->plan(start, end, jmg, timeout, trajectory, path_constraints, preemptionToken());
+			} else
+				success = true;
+		}
+		if (prescreen)
+			++(swept ? prescreen_stats_.passed : prescreen_stats_.failed);
+		validation_pending = validation_pending ||
+		                     (swept ? prescreen_planner_->validatesLazily() : pair.second->validatesLazily());
+		timings.push_back(solvers::PlannerInterface::deferredTimeParameterization(
+		    swept ? solvers::PlannerInterfacePtr(prescreen_planner_) : pair.second));
 		sub_trajectories.push_back(trajectory);  // include failed trajectory
 
 		if (!success)
@@ -168,12 +327,26 @@ void Connect::compute(const InterfaceState& from, const InterfaceState& to) {
 		// continue from reached state
 		start = end;
 	}
+	storeResult(from, to, sub_trajectories, intermediate_scenes, success, validation_pending, timings);
+}
 
+void Connect::storeResult(const InterfaceState& from, const InterfaceState& to,
+                          const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
+                          const std::vector<planning_scene::PlanningSceneConstPtr>& intermediate_scenes,
+                          bool success, bool validation_pending,
+                          const std::vector<SubTrajectory::TimeParameterizer>& timings) {
 	SolutionBasePtr solution;
-	if (success && mode != SEQUENTIAL)  // try to merge
-		solution = merge(sub_trajectories, intermediate_scenes, from.scene()->getCurrentState());
+	if (success && merge_mode_.get() != SEQUENTIAL) {  // try to merge
+		SubTrajectoryPtr merged =
+		    merge(sub_trajectories, intermediate_scenes, from.scene()->getCurrentState(), timings);
+		// merged trajectories are validated as a whole, but a single trajectory is used as is
+		if (merged && sub_trajectories.size() == 1)
+			merged->setValidationPending(validation_pending);
+		solution = merged;
+	}
 	if (!solution)  // success == false or merging failed: store sequentially
-		solution = makeSequential(sub_trajectories, intermediate_scenes, from, to);
+		solution =
+		    makeSequential(sub_trajectories, intermediate_scenes, from, to, success && validation_pending, timings);
 	if (!success)  // error during sequential planning
 		solution->markAsFailure();
 	connect(from, to, solution);
@@ -182,7 +355,8 @@ void Connect::compute(const InterfaceState& from, const InterfaceState& to) {
 SolutionSequencePtr
 Connect::makeSequential(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
                         const std::vector<planning_scene::PlanningSceneConstPtr>& intermediate_scenes,
-                        const InterfaceState& from, const InterfaceState& to) {
+                        const InterfaceState& from, const InterfaceState& to, bool validation_pending,
+                        const std::vector<SubTrajectory::TimeParameterizer>& timings) {
 	assert(!sub_trajectories.empty());
 	assert(sub_trajectories.size() + 1 == intermediate_scenes.size());
 
@@ -198,6 +372,9 @@ Connect::makeSequential(const std::vector<robot_trajectory::RobotTrajectoryConst
 		inserted->setCreator(this);
 		if (!sub)  // a null RobotTrajectoryPtr indicates a failure
 			inserted->markAsFailure();
+		inserted->setValidationPending(validation_pending);
+		if (sub_solutions.size() < timings.size())
+			inserted->deferTimeParameterization(timings[sub_solutions.size()]);
 		// push back solution pointer
 		sub_solutions.push_back(&*inserted);
 
@@ -218,24 +395,41 @@ Connect::makeSequential(const std::vector<robot_trajectory::RobotTrajectoryConst
 
 SubTrajectoryPtr Connect::merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
                                 const std::vector<planning_scene::PlanningSceneConstPtr>& intermediate_scenes,
-                                const moveit::core::RobotState& state) {
+                                const moveit::core::RobotState& state,
+                                const std::vector<SubTrajectory::TimeParameterizer>& timings) {
 	// no need to merge if there is only a single sub trajectory
-	if (sub_trajectories.size() == 1)
-		return std::make_shared<SubTrajectory>(sub_trajectories[0]);
+	if (sub_trajectories.size() == 1) {
+		auto solution = std::make_shared<SubTrajectory>(sub_trajectories[0]);
+		if (!timings.empty())
+			solution->deferTimeParameterization(timings[0]);
+		return solution;
+	}
 
 	auto jmg = merged_jmg_.get();
 	assert(jmg);
 	auto timing = properties().get<TimeParameterizationPtr>("merge_time_parameterization");
-	robot_trajectory::RobotTrajectoryPtr trajectory = task_constructor::merge(sub_trajectories, state, jmg, *timing);
+	const bool deferred =
+	    !timings.empty() && std::all_of(timings.begin(), timings.end(), [](const SubTrajectory::TimeParameterizer& t) {
+		    return static_cast<bool>(t);
+	    });
+	robot_trajectory::RobotTrajectoryPtr trajectory = deferred ?
+	                                                      task_constructor::merge(sub_trajectories, state, jmg) :
+	                                                      task_constructor::merge(sub_trajectories, state, jmg, *timing);
 	if (!trajectory)
 		return SubTrajectoryPtr();
 
 	// check merged trajectory for collisions
-	if (!intermediate_scenes.front()->isPathValid(*trajectory,
-	                                              properties().get<moveit_msgs::Constraints>("path_constraints")))
+	if (!intermediate_scenes.front()->isPathValid(*trajectory, path_constraints_.get()))
 		return SubTrajectoryPtr();
 
-	return std::make_shared<SubTrajectory>(trajectory);
+	auto solution = std::make_shared<SubTrajectory>(trajectory);
+	if (deferred) {
+		utils::estimateTimeStamps(*trajectory);
+		solution->deferTimeParameterization([timing](robot_trajectory::RobotTrajectory& t) {
+			return timing->computeTimeStamps(t, 1.0, 1.0);
+		});
+	}
+	return solution;
 }
 }  // namespace stages
 }  // namespace task_constructor
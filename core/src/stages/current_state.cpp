@@ -37,21 +37,39 @@
 
 #include <moveit/task_constructor/stages/current_state.h>
 #include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/recording.h>
 #include <moveit_msgs/GetPlanningScene.h>
 #include <moveit_msgs/PlanningSceneComponents.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <ros/ros.h>
 
 namespace moveit {
 namespace task_constructor {
 namespace stages {
 
+namespace {
+using Components = moveit_msgs::PlanningSceneComponents;
+// all scene components (as required for planning)
+const uint32_t FULL_SCENE = Components::SCENE_SETTINGS | Components::ROBOT_STATE |
+                            Components::ROBOT_STATE_ATTACHED_OBJECTS | Components::WORLD_OBJECT_NAMES |
+                            Components::WORLD_OBJECT_GEOMETRY | Components::OCTOMAP | Components::TRANSFORMS |
+                            Components::ALLOWED_COLLISION_MATRIX | Components::LINK_PADDING_AND_SCALING |
+                            Components::OBJECT_COLORS;
+}  // namespace
+
 CurrentState::CurrentState(const std::string& name) : Generator(name) {
 	auto& p = properties();
 	Property& timeout = p.property("timeout");
 	timeout.setDescription("max time to wait for get_planning_scene service");
 	timeout.setValue(-1.0);
+	p.declare<uint32_t>("components", FULL_SCENE, "moveit_msgs::PlanningSceneComponents to fetch");
+}
+
+void CurrentState::reset() {
+	Generator::reset();
+	scene_.reset();
 }
 
 void CurrentState::init(const moveit::core::RobotModelConstPtr& robot_model) {
@@ -65,6 +83,38 @@ bool CurrentState::canCompute() const {
 }
 
 void CurrentState::compute() {
+	PlanningRecord* record = PlanningRecord::active();
+	if (record && record->mode() == PlanningRecord::REPLAY && (scene_ = record->replayScene(name(), robot_model_))) {
+		spawn(InterfaceState(scene_), 0.0);
+		return;
+	}
+
+	const uint32_t components = properties().get<uint32_t>("components");
+	if (monitor_) {
+		{
+			planning_scene_monitor::LockedPlanningSceneRO monitored(monitor_);
+			if (monitored->getRobotModel() != robot_model_) {
+				ROS_WARN("PlanningSceneMonitor uses a different robot model");
+				return;
+			}
+			// a diff would refer to the monitored scene, which keeps changing: copy instead
+			if ((components & FULL_SCENE) == FULL_SCENE)
+				scene_ = planning_scene::PlanningScene::clone(monitored);
+			else {
+				moveit_msgs::PlanningScene msg;
+				Components comps;
+				comps.components = components;
+				monitored->getPlanningSceneMsg(msg, comps);
+				scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
+				scene_->setPlanningSceneMsg(msg);
+			}
+		}
+		if (record && record->mode() == PlanningRecord::RECORD)
+			record->recordScene(name(), *scene_);
+		spawn(InterfaceState(scene_), 0.0);
+		return;
+	}
+
 	scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
 
 	ros::NodeHandle h;
@@ -75,18 +125,12 @@ void CurrentState::compute() {
 		moveit_msgs::GetPlanningScene::Request req;
 		moveit_msgs::GetPlanningScene::Response res;
 
-		req.components.components =
-		    moveit_msgs::PlanningSceneComponents::SCENE_SETTINGS | moveit_msgs::PlanningSceneComponents::ROBOT_STATE |
-		    moveit_msgs::PlanningSceneComponents::ROBOT_STATE_ATTACHED_OBJECTS |
-		    moveit_msgs::PlanningSceneComponents::WORLD_OBJECT_NAMES |
-		    moveit_msgs::PlanningSceneComponents::WORLD_OBJECT_GEOMETRY | moveit_msgs::PlanningSceneComponents::OCTOMAP |
-		    moveit_msgs::PlanningSceneComponents::TRANSFORMS |
-		    moveit_msgs::PlanningSceneComponents::ALLOWED_COLLISION_MATRIX |
-		    moveit_msgs::PlanningSceneComponents::LINK_PADDING_AND_SCALING |
-		    moveit_msgs::PlanningSceneComponents::OBJECT_COLORS;
+		req.components.components = components;
 
 		if (client.call(req, res)) {
 			scene_->setPlanningSceneMsg(res.scene);
+			if (record && record->mode() == PlanningRecord::RECORD)
+				record->recordScene(name(), *scene_);
 			spawn(InterfaceState(scene_), 0.0);
 			return;
 		}
@@ -0,0 +1,245 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Wrapper forwarding only solutions that are sufficiently different from each other
+*/
+
+#include <moveit/task_constructor/stages/diversity_filter.h>
+
+#include <moveit/task_constructor/storage.h>
+
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <moveit/robot_state/robot_state.h>
+
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+namespace {
+bool isContinuous(const moveit::core::JointModel* joint) {
+	return joint->getType() == moveit::core::JointModel::REVOLUTE &&
+	       static_cast<const moveit::core::RevoluteJointModel*>(joint)->isContinuous();
+}
+}  // namespace
+
+// grid of accepted feature vectors, indexed by their first (up to) dims coordinates
+struct DiversityFilter::Index
+{
+	using Cell = std::array<int64_t, 3>;
+	struct CellHash
+	{
+		size_t operator()(const Cell& cell) const {
+			size_t seed = 0;
+			for (int64_t c : cell)
+				seed ^= std::hash<int64_t>()(c) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+			return seed;
+		}
+	};
+
+	Index(double cell_size, size_t dims) : cell_size(cell_size), dims(std::min<size_t>(3, dims)) {}
+
+	Cell cell(const Eigen::VectorXd& features) const {
+		Cell cell{ 0, 0, 0 };
+		for (size_t i = 0; i != dims; ++i)
+			cell[i] = static_cast<int64_t>(std::floor(features[i] / cell_size));
+		return cell;
+	}
+
+	/* smallest distance to any entry closer than cell_size (infinity if there is none)
+	 *
+	 * distance needs to be bounded from below by the difference of each grid coordinate:
+	 * then, all closer entries are found in the neighbouring cells.
+	 */
+	template <typename Distance>
+	double nearest(const Eigen::VectorXd& features, const Distance& distance) const {
+		const Cell center = cell(features);
+		size_t neighbours = 1;
+		for (size_t i = 0; i != dims; ++i)
+			neighbours *= 3;
+
+		double result = std::numeric_limits<double>::infinity();
+		for (size_t n = 0; n != neighbours; ++n) {
+			Cell neighbour = center;
+			for (size_t i = 0, code = n; i != dims; ++i, code /= 3)
+				neighbour[i] += static_cast<int64_t>(code % 3) - 1;
+			auto it = cells.find(neighbour);
+			if (it == cells.end())
+				continue;
+			for (const Eigen::VectorXd& entry : it->second)
+				result = std::min(result, distance(features, entry));
+		}
+		return result;
+	}
+
+	void insert(Eigen::VectorXd&& features) {
+		const Cell key = cell(features);
+		cells[key].push_back(std::move(features));
+	}
+
+	double cell_size;
+	size_t dims;  // grid coordinates: leading features, which are not wrapped around
+	std::unordered_map<Cell, std::vector<Eigen::VectorXd>, CellHash> cells;
+};
+
+DiversityFilter::DiversityFilter(const std::string& name, Stage::pointer&& child)
+  : WrapperBase(name, std::move(child)) {
+	auto& p = properties();
+	p.declare<double>("min_distance", "minimal distance between end states of forwarded solutions");
+	p.declare<Metric>("metric", JOINTS, "distance metric: JOINTS or POSE");
+	p.declare<std::string>("group", "", "group compared by JOINTS metric (all variables if empty)");
+	p.declare<std::string>("link", "", "frame compared by POSE metric");
+	p.declare<double>("rotation_weight", 0.1, "distance of a rotation by one radian in POSE metric");
+	p.declare<bool>("ignore_filter", false, "forward all solutions");
+}
+
+DiversityFilter::~DiversityFilter() = default;
+
+void DiversityFilter::reset() {
+	index_.reset();
+	WrapperBase::reset();
+}
+
+void DiversityFilter::init(const moveit::core::RobotModelConstPtr& robot_model) {
+	InitStageException errors;
+
+	try {
+		WrapperBase::init(robot_model);
+	} catch (InitStageException& e) {
+		errors.append(e);
+	}
+
+	const auto& props = properties();
+	if (props.get("min_distance").empty())
+		errors.push_back(*this, "min_distance is not specified");
+
+	variables_.clear();
+	num_wrapped_ = 0;
+	const std::string& group = props.get<std::string>("group");
+	if (props.get<Metric>("metric") == JOINTS) {
+		const moveit::core::JointModelGroup* jmg = group.empty() ? nullptr : robot_model->getJointModelGroup(group);
+		if (!group.empty() && !jmg)
+			errors.push_back(*this, "unknown group: " + group);
+		// continuous joints last: they cannot serve as grid coordinates
+		std::vector<int> wrapped;
+		for (const moveit::core::JointModel* joint :
+		     jmg ? jmg->getActiveJointModels() : robot_model->getActiveJointModels()) {
+			auto& target = isContinuous(joint) ? wrapped : variables_;
+			for (size_t i = 0; i != joint->getVariableCount(); ++i)
+				target.push_back(joint->getFirstVariableIndex() + i);
+		}
+		num_wrapped_ = wrapped.size();
+		variables_.insert(variables_.end(), wrapped.begin(), wrapped.end());
+	}
+	if (props.get<Metric>("metric") == POSE && props.get<std::string>("link").empty())
+		errors.push_back(*this, "POSE metric requires a link");
+
+	if (errors)
+		throw errors;
+}
+
+void DiversityFilter::onNewSolutions(const std::vector<const SolutionBase*>& solutions) {
+	// prefer the cheapest among close solutions of a batch
+	std::vector<const SolutionBase*> sorted(solutions);
+	std::stable_sort(sorted.begin(), sorted.end(),
+	                 [](const SolutionBase* a, const SolutionBase* b) { return a->cost() < b->cost(); });
+	for (const SolutionBase* s : sorted)
+		onNewSolution(*s);
+}
+
+void DiversityFilter::onNewSolution(const SolutionBase& s) {
+	const auto& props = properties();
+	const double min_distance = props.get<double>("min_distance");
+	if (props.get<bool>("ignore_filter") || !(min_distance > 0.0)) {
+		liftSolution(s);
+		return;
+	}
+
+	// features of the end state, such that the metric bounds the difference of their first three coordinates
+	const planning_scene::PlanningScene& scene = *s.end()->scene();
+	const moveit::core::RobotState& state = scene.getCurrentState();
+	const Metric metric = props.get<Metric>("metric");
+	Eigen::VectorXd features;
+	if (metric == JOINTS) {
+		features.resize(variables_.size());
+		for (size_t i = 0; i != variables_.size(); ++i)
+			features[i] = state.getVariablePosition(variables_[i]);
+	} else {
+		const std::string& link = props.get<std::string>("link");
+		if (!scene.knowsFrameTransform(link)) {
+			liftSolution(s, std::numeric_limits<double>::infinity(), "unknown frame: " + link);
+			return;
+		}
+		const Eigen::Isometry3d& pose = scene.getFrameTransform(link);
+		const Eigen::Quaterniond q(pose.linear());
+		features.resize(7);
+		features << pose.translation(), q.w(), q.x(), q.y(), q.z();
+	}
+
+	const double rotation_weight = props.get<double>("rotation_weight");
+	const Eigen::Index wrapped_start = variables_.size() - num_wrapped_;
+	auto distance = [metric, rotation_weight, wrapped_start](const Eigen::VectorXd& a, const Eigen::VectorXd& b) {
+		if (metric == JOINTS) {
+			double squared = (a.head(wrapped_start) - b.head(wrapped_start)).squaredNorm();
+			for (Eigen::Index i = wrapped_start; i < a.size(); ++i)
+				squared += std::pow(std::remainder(a[i] - b[i], 2.0 * M_PI), 2);
+			return std::sqrt(squared);
+		}
+		const double cos_half = std::min(1.0, std::abs(a.tail<4>().dot(b.tail<4>())));
+		return (a.head<3>() - b.head<3>()).norm() + rotation_weight * 2.0 * std::acos(cos_half);
+	};
+
+	if (!index_)
+		index_.reset(new Index(min_distance, metric == JOINTS ? variables_.size() - num_wrapped_ : 3));
+	const double nearest = index_->nearest(features, distance);
+	if (nearest < min_distance) {
+		liftSolution(s, std::numeric_limits<double>::infinity(),
+		             "distance " + std::to_string(nearest) + " to a forwarded solution is below min_distance");
+		return;
+	}
+	index_->insert(std::move(features));
+	liftSolution(s);
+}
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
@@ -48,6 +48,8 @@
 #include <tf2_eigen/tf2_eigen.h>
 #include <ros/console.h>
 
+#include <map>
+
 namespace vm = visualization_msgs;
 namespace cd = collision_detection;
 
@@ -114,19 +116,34 @@ SubTrajectory FixCollisionObjects::fixCollisions(planning_scene::PlanningScene&
 	m.header.frame_id = scene.getPlanningFrame();
 	m.ns = "collisions";
 
+	// robot bodies (links and attached objects) world objects might collide with
+	std::vector<std::string> robot_bodies = scene.getRobotModel()->getLinkModelNamesWithCollisionGeometry();
+	std::vector<const moveit::core::AttachedBody*> attached;
+	scene.getCurrentState().getAttachedBodies(attached);
+	for (const moveit::core::AttachedBody* body : attached)
+		robot_bodies.push_back(body->getName());
+	// after the first pass, only objects moved in the previous iteration need to be checked again
+	cd::AllowedCollisionMatrix acm = scene.getAllowedCollisionMatrix();
+
 	bool failure = false;
-	while (!failure) {
+	for (size_t iteration = 1; !failure; ++iteration) {
 		res.clear();
 #if MOVEIT_HAS_COLLISION_ENV
-		scene.getCollisionEnv()->checkRobotCollision(req, res, scene.getCurrentState(),
-		                                             scene.getAllowedCollisionMatrix());
+		scene.getCollisionEnv()->checkRobotCollision(req, res, scene.getCurrentState(), acm);
 #else
 		scene.getCollisionWorld()->checkRobotCollision(req, res, *scene.getCollisionRobotUnpadded(),
-		                                               scene.getCurrentState(), scene.getAllowedCollisionMatrix());
+		                                               scene.getCurrentState(), acm);
 #endif
-		if (!res.collision)
+		if (!res.collision) {
+			if (iteration > 1)
+				result.formatComment([iteration](std::string& comment) {
+					comment = "fixed collisions in " + std::to_string(iteration - 1) + " iteration(s)";
+				});
 			return result;
+		}
 
+		// collect the largest correction of each object: corrections of different objects are independent
+		std::map<std::string, Eigen::Vector3d> corrections;
 		for (const auto& info : res.contacts) {
 			Eigen::Vector3d correction;
 			failure = !computeCorrection(info.second, correction, max_penetration);
@@ -150,8 +167,21 @@ SubTrajectory FixCollisionObjects::fixCollisions(planning_scene::PlanningScene&
 				tf2::fromMsg(boost::any_cast<geometry_msgs::Vector3>(dir), correction);
 
 			const std::string& name = c.body_type_1 == cd::BodyTypes::WORLD_OBJECT ? c.body_name_1 : c.body_name_2;
-			scene.getWorldNonConst()->moveObject(name, Eigen::Isometry3d(Eigen::Translation3d(correction)));
+			auto it = corrections.insert(std::make_pair(name, correction)).first;
+			if (correction.squaredNorm() > it->second.squaredNorm())
+				it->second = correction;
 		}
+		if (failure)
+			break;
+
+		// apply all corrections at once
+		for (const auto& correction : corrections)
+			scene.getWorldNonConst()->moveObject(correction.first,
+			                                     Eigen::Isometry3d(Eigen::Translation3d(correction.second)));
+		// objects not moved have been checked already: skip them in subsequent passes
+		for (const auto& object : *scene.getWorld())
+			if (!corrections.count(object.first))
+				acm.setEntry(object.first, robot_bodies, true);
 	}
 
 	// failure
@@ -42,12 +42,32 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <rviz_marker_tools/marker_creation.h>
 
+#include <ros/console.h>
+#include <cstring>
+#include <fstream>
+#include <map>
+
 namespace moveit {
 namespace task_constructor {
 namespace stages {
 
 using PosesList = std::vector<geometry_msgs::PoseStamped>;
 
+namespace {
+constexpr char FILE_MAGIC[8] = { 'M', 'T', 'C', 'P', 'O', 'S', 'E', '1' };
+constexpr size_t ID_LENGTH = 64;
+
+// matrix of quaternion left-multiplication q * p for p given as (x, y, z, w)
+Eigen::Matrix4d leftMultiplication(const Eigen::Quaterniond& q) {
+	Eigen::Matrix4d m;
+	m << q.w(), -q.z(), q.y(), q.x(),  //
+	    q.z(), q.w(), -q.x(), q.y(),  //
+	    -q.y(), q.x(), q.w(), q.z(),  //
+	    -q.x(), -q.y(), -q.z(), q.w();
+	return m;
+}
+}  // namespace
+
 FixedCartesianPoses::FixedCartesianPoses(const std::string& name) : MonitoringGenerator(name) {
 	setCostTerm(std::make_unique<cost::Constant>(0.0));
 
@@ -63,11 +83,105 @@ void FixedCartesianPoses::addPose(const geometry_msgs::PoseStamped& pose) {
 		boost::any_cast<PosesList&>(poses.value()).push_back(pose);
 }
 
+void FixedCartesianPoses::addPoses(const geometry_msgs::PoseArray& poses) {
+	PoseSet set;
+	set.frame_id = poses.header.frame_id;
+	set.positions.resize(3, poses.poses.size());
+	set.orientations.resize(4, poses.poses.size());
+	for (size_t i = 0; i != poses.poses.size(); ++i) {
+		const geometry_msgs::Pose& pose = poses.poses[i];
+		set.positions.col(i) << pose.position.x, pose.position.y, pose.position.z;
+		set.orientations.col(i) << pose.orientation.x, pose.orientation.y, pose.orientation.z, pose.orientation.w;
+	}
+	pose_sets_.push_back(std::move(set));
+}
+
+bool FixedCartesianPoses::loadPoses(const std::string& file) {
+	std::ifstream is(file, std::ios::binary | std::ios::ate);
+	if (!is) {
+		ROS_ERROR_STREAM_NAMED("FixedCartesianPoses", "Cannot open '" << file << "'");
+		return false;
+	}
+	auto fail = [&file](const char* reason) {
+		ROS_ERROR_STREAM_NAMED("FixedCartesianPoses", "Invalid pose file '" << file << "': " << reason);
+		return false;
+	};
+	uint64_t remaining = is.tellg();
+	is.seekg(0);
+
+	char magic[sizeof(FILE_MAGIC)];
+	uint64_t num_frames;
+	if (!is.read(magic, sizeof(magic)) || std::memcmp(magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+		return fail("wrong magic");
+	if (!is.read(reinterpret_cast<char*>(&num_frames), sizeof(num_frames)))
+		return fail("truncated header");
+	remaining -= sizeof(magic) + sizeof(num_frames);
+
+	std::vector<PoseSet> sets;
+	for (uint64_t i = 0; i != num_frames; ++i) {
+		char frame_id[ID_LENGTH];
+		uint64_t num_poses;
+		if (!is.read(frame_id, ID_LENGTH) || !is.read(reinterpret_cast<char*>(&num_poses), sizeof(num_poses)))
+			return fail("truncated frame header");
+		remaining -= ID_LENGTH + sizeof(num_poses);
+		if (num_poses > remaining / (7 * sizeof(double)))
+			return fail("truncated poses");
+		remaining -= num_poses * 7 * sizeof(double);
+
+		// read all poses at once: one column of 7 values per pose
+		Eigen::Matrix<double, 7, Eigen::Dynamic> values(7, num_poses);
+		is.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(double));
+		PoseSet set;
+		set.frame_id = std::string(frame_id, strnlen(frame_id, ID_LENGTH));
+		set.positions = values.topRows<3>();
+		set.orientations = values.bottomRows<4>();
+		set.orientations.array().rowwise() /= set.orientations.colwise().norm().array();
+		sets.push_back(std::move(set));
+	}
+	pose_sets_.insert(pose_sets_.end(), sets.begin(), sets.end());
+	return true;
+}
+
+bool FixedCartesianPoses::savePoses(const std::string& file, const std::vector<geometry_msgs::PoseStamped>& poses) {
+	std::map<std::string, std::vector<const geometry_msgs::Pose*>> frames;
+	for (const geometry_msgs::PoseStamped& pose : poses) {
+		if (pose.header.frame_id.size() >= ID_LENGTH) {
+			ROS_ERROR_STREAM_NAMED("FixedCartesianPoses", "frame id too long: " << pose.header.frame_id);
+			return false;
+		}
+		frames[pose.header.frame_id].push_back(&pose.pose);
+	}
+
+	std::ofstream os(file, std::ios::binary);
+	const uint64_t num_frames = frames.size();
+	os.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+	os.write(reinterpret_cast<const char*>(&num_frames), sizeof(num_frames));
+	for (const auto& frame : frames) {
+		char frame_id[ID_LENGTH] = {};
+		std::copy(frame.first.begin(), frame.first.end(), frame_id);
+		const uint64_t num_poses = frame.second.size();
+		os.write(frame_id, ID_LENGTH);
+		os.write(reinterpret_cast<const char*>(&num_poses), sizeof(num_poses));
+		for (const geometry_msgs::Pose* pose : frame.second) {
+			const double values[7] = { pose->position.x,    pose->position.y,    pose->position.z,
+				                        pose->orientation.x, pose->orientation.y, pose->orientation.z,
+				                        pose->orientation.w };
+			os.write(reinterpret_cast<const char*>(values), sizeof(values));
+		}
+	}
+	return static_cast<bool>(os);
+}
+
 void FixedCartesianPoses::reset() {
 	upstream_solutions_.clear();
 	MonitoringGenerator::reset();
 }
 
+void FixedCartesianPoses::regenerate() {
+	upstream_solutions_.clear();
+	MonitoringGenerator::regenerate();
+}
+
 void FixedCartesianPoses::onNewSolution(const SolutionBase& s) {
 	// It's safe to store a pointer to this solution, as the generating stage stores it
 	upstream_solutions_.push(&s);
@@ -82,14 +196,8 @@ void FixedCartesianPoses::compute() {
 		return;
 
 	planning_scene::PlanningScenePtr scene = upstream_solutions_.pop()->end()->scene()->diff();
-	for (geometry_msgs::PoseStamped pose : properties().get<PosesList>("poses")) {
-		if (pose.header.frame_id.empty())
-			pose.header.frame_id = scene->getPlanningFrame();
-		else if (!scene->knowsFrameTransform(pose.header.frame_id)) {
-			ROS_WARN_NAMED("FixedCartesianPoses", "Unknown frame: '%s'", pose.header.frame_id.c_str());
-			continue;
-		}
-
+	Batch batch;
+	auto spawn_pose = [&batch, &scene](const geometry_msgs::PoseStamped& pose) {
 		InterfaceState state(scene);
 		state.properties().set("target_pose", pose);
 
@@ -98,8 +206,44 @@ void FixedCartesianPoses::compute() {
 
 		rviz_marker_tools::appendFrame(trajectory.markers(), pose, 0.1, "pose frame");
 
-		spawn(std::move(state), std::move(trajectory));
+		batch.emplace_back(std::move(state), std::move(trajectory));
+	};
+
+	for (geometry_msgs::PoseStamped pose : properties().get<PosesList>("poses")) {
+		if (pose.header.frame_id.empty())
+			pose.header.frame_id = scene->getPlanningFrame();
+		else if (!scene->knowsFrameTransform(pose.header.frame_id)) {
+			ROS_WARN_NAMED("FixedCartesianPoses", "Unknown frame: '%s'", pose.header.frame_id.c_str());
+			continue;
+		}
+		spawn_pose(pose);
+	}
+
+	geometry_msgs::PoseStamped pose;
+	pose.header.frame_id = scene->getPlanningFrame();
+	for (const PoseSet& set : pose_sets_) {
+		if (!set.frame_id.empty() && !scene->knowsFrameTransform(set.frame_id)) {
+			ROS_WARN_NAMED("FixedCartesianPoses", "Unknown frame: '%s'", set.frame_id.c_str());
+			continue;
+		}
+		// transform all poses of the set into the planning frame at once
+		const Eigen::Isometry3d& frame =
+		    set.frame_id.empty() ? Eigen::Isometry3d::Identity() : scene->getFrameTransform(set.frame_id);
+		const Eigen::Matrix3Xd positions = (frame.linear() * set.positions).colwise() + frame.translation();
+		const Eigen::Matrix4Xd orientations = leftMultiplication(Eigen::Quaterniond(frame.linear())) * set.orientations;
+
+		for (Eigen::Index i = 0; i != positions.cols(); ++i) {
+			pose.pose.position.x = positions(0, i);
+			pose.pose.position.y = positions(1, i);
+			pose.pose.position.z = positions(2, i);
+			pose.pose.orientation.x = orientations(0, i);
+			pose.pose.orientation.y = orientations(1, i);
+			pose.pose.orientation.z = orientations(2, i);
+			pose.pose.orientation.w = orientations(3, i);
+			spawn_pose(pose);
+		}
 	}
+	spawnMany(std::move(batch));
 }
 }  // namespace stages
 }  // namespace task_constructor
@@ -39,6 +39,9 @@
 
 #include <moveit/planning_scene/planning_scene.h>
 
+#include <algorithm>
+#include <numeric>
+
 namespace moveit {
 namespace task_constructor {
 namespace stages {
@@ -51,25 +54,56 @@ FixedState::FixedState(const std::string& name, planning_scene::PlanningScenePtr
 
 void FixedState::setState(const planning_scene::PlanningScenePtr& scene) {
 	scene_ = scene;
+	base_.reset();
+	states_.clear();
+}
+
+void FixedState::setStates(const planning_scene::PlanningSceneConstPtr& base,
+                           const std::vector<moveit::core::RobotState>& states, const std::vector<double>& priorities) {
+	if (!priorities.empty() && priorities.size() != states.size())
+		throw std::invalid_argument("FixedState: number of priorities doesn't match number of states");
+
+	std::vector<size_t> order(states.size());
+	std::iota(order.begin(), order.end(), 0);
+	if (!priorities.empty())
+		std::stable_sort(order.begin(), order.end(),
+		                 [&priorities](size_t a, size_t b) { return priorities[a] < priorities[b]; });
+
+	scene_.reset();
+	base_ = base;
+	states_.clear();
+	states_.reserve(states.size());
+	for (size_t i : order)
+		states_.push_back(states[i]);
+	next_ = 0;
 }
 
 void FixedState::reset() {
 	Generator::reset();
 	ran_ = false;
+	next_ = 0;
 }
 
 bool FixedState::canCompute() const {
+	if (base_)
+		return next_ < states_.size();
 	return !ran_ && scene_;
 }
 
 void FixedState::compute() {
+	planning_scene::PlanningScenePtr scene = scene_;
+	if (base_) {  // create diff scene of next state
+		scene = base_->diff();
+		scene->setCurrentState(states_[next_++]);
+	} else
+		ran_ = true;
+
 	SubTrajectory trajectory;
-	if (!properties().get<bool>("ignore_collisions") && scene_->isStateColliding()) {
+	if (!properties().get<bool>("ignore_collisions") && scene->isStateColliding()) {
 		trajectory.markAsFailure("in collision");
 	}
 
-	spawn(InterfaceState(scene_), std::move(trajectory));
-	ran_ = true;
+	spawn(InterfaceState(scene), std::move(trajectory));
 }
 }  // namespace stages
 }  // namespace task_constructor
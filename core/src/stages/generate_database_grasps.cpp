@@ -0,0 +1,281 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Spawn precomputed grasps from a memory-mapped database file
+*/
+
+#include <moveit/task_constructor/stages/generate_database_grasps.h>
+#include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/cost_terms.h>
+#include <moveit/task_constructor/marker_tools.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <rviz_marker_tools/marker_creation.h>
+#include <tf2_eigen/tf2_eigen.h>
+
+#include <ros/console.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+namespace {
+constexpr char FILE_MAGIC[8] = { 'M', 'T', 'C', 'G', 'R', 'S', 'P', '1' };
+constexpr size_t ID_LENGTH = 64;
+
+struct ObjectEntry
+{
+	char id[ID_LENGTH];
+	uint64_t first;
+	uint64_t count;
+};
+static_assert(sizeof(GraspDatabase::Grasp) == 9 * sizeof(float), "Grasp records need to be packed");
+}  // namespace
+
+Eigen::Isometry3d GraspDatabase::Grasp::pose() const {
+	const Eigen::Quaterniond q(orientation[3], orientation[0], orientation[1], orientation[2]);
+	Eigen::Isometry3d pose(q.normalized());
+	pose.translation() = Eigen::Vector3d(position[0], position[1], position[2]);
+	return pose;
+}
+
+GraspDatabase::~GraspDatabase() {
+	close();
+}
+
+void GraspDatabase::close() {
+	if (data_)
+		munmap(data_, size_);
+	data_ = nullptr;
+	size_ = 0;
+	objects_.clear();
+}
+
+bool GraspDatabase::open(const std::string& file) {
+	close();
+	int fd = ::open(file.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		ROS_ERROR_STREAM_NAMED("GraspDatabase", "Cannot open '" << file << "'");
+		if (fd >= 0)
+			::close(fd);
+		return false;
+	}
+	size_ = st.st_size;
+	data_ = size_ > 0 ? mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	::close(fd);  // mapping stays valid
+	if (data_ == MAP_FAILED) {
+		data_ = nullptr;
+		size_ = 0;
+		ROS_ERROR_STREAM_NAMED("GraspDatabase", "Cannot map '" << file << "'");
+		return false;
+	}
+
+	auto fail = [this, &file](const char* reason) {
+		ROS_ERROR_STREAM_NAMED("GraspDatabase", "Invalid grasp database '" << file << "': " << reason);
+		close();
+		return false;
+	};
+	const char* bytes = static_cast<const char*>(data_);
+	uint64_t num_objects;
+	if (size_ < sizeof(FILE_MAGIC) + sizeof(num_objects) || std::memcmp(bytes, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+		return fail("wrong magic");
+	std::memcpy(&num_objects, bytes + sizeof(FILE_MAGIC), sizeof(num_objects));
+
+	const size_t table = sizeof(FILE_MAGIC) + sizeof(num_objects);
+	const size_t records = table + num_objects * sizeof(ObjectEntry);
+	if (num_objects > size_ / sizeof(ObjectEntry) || records > size_)
+		return fail("truncated object table");
+	const size_t num_grasps = (size_ - records) / sizeof(Grasp);
+	const auto* entries = reinterpret_cast<const ObjectEntry*>(bytes + table);
+	const auto* grasps = reinterpret_cast<const Grasp*>(bytes + records);
+	for (uint64_t i = 0; i != num_objects; ++i) {
+		const ObjectEntry& entry = entries[i];
+		if (entry.first > num_grasps || entry.count > num_grasps - entry.first)
+			return fail("grasp range exceeds file");
+		Range range{ grasps + entry.first, grasps + entry.first + entry.count };
+		if (!std::is_sorted(range.begin, range.end,
+		                    [](const Grasp& a, const Grasp& b) { return a.quality > b.quality; }))
+			return fail("grasps not sorted by quality");
+		objects_[std::string(entry.id, strnlen(entry.id, ID_LENGTH))] = range;
+	}
+	return true;
+}
+
+GraspDatabase::Range GraspDatabase::grasps(const std::string& object) const {
+	auto it = objects_.find(object);
+	return it == objects_.end() ? Range() : it->second;
+}
+
+std::vector<std::string> GraspDatabase::objects() const {
+	std::vector<std::string> result;
+	for (const auto& pair : objects_)
+		result.push_back(pair.first);
+	return result;
+}
+
+bool GraspDatabase::write(const std::string& file, const std::map<std::string, std::vector<Grasp>>& grasps) {
+	std::ofstream os(file, std::ios::binary);
+	const uint64_t num_objects = grasps.size();
+	os.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+	os.write(reinterpret_cast<const char*>(&num_objects), sizeof(num_objects));
+
+	uint64_t first = 0;
+	for (const auto& pair : grasps) {
+		if (pair.first.size() >= ID_LENGTH) {
+			ROS_ERROR_STREAM_NAMED("GraspDatabase", "object id too long: " << pair.first);
+			return false;
+		}
+		ObjectEntry entry{};
+		std::copy(pair.first.begin(), pair.first.end(), entry.id);
+		entry.first = first;
+		entry.count = pair.second.size();
+		os.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+		first += entry.count;
+	}
+	for (const auto& pair : grasps) {
+		std::vector<Grasp> sorted = pair.second;
+		std::stable_sort(sorted.begin(), sorted.end(),
+		                 [](const Grasp& a, const Grasp& b) { return a.quality > b.quality; });
+		os.write(reinterpret_cast<const char*>(sorted.data()), sorted.size() * sizeof(Grasp));
+	}
+	return static_cast<bool>(os);
+}
+
+GenerateDatabaseGrasps::GenerateDatabaseGrasps(const std::string& name) : GeneratePose(name) {
+	setCostTerm(std::make_unique<CostTerm>());  // keep quality costs
+
+	auto& p = properties();
+	p.declare<GraspDatabaseConstPtr>("database", GraspDatabaseConstPtr(), "grasp database");
+	p.declare<std::string>("object", "object id in database and scene");
+	p.declare<uint32_t>("max_grasps", 0, "maximum number of grasps spawned per upstream solution (0: all)");
+	p.declare<double>("min_quality", 0.0, "minimum grasp quality");
+	p.declare<double>("quality_weight", 1.0, "cost per missing quality (1 - quality)");
+	p.declare<Eigen::Vector3d>("approach_direction", Eigen::Vector3d::UnitZ(),
+	                           "allowed approach direction (z-axis of grasp frame) in planning frame");
+	p.declare<double>("max_approach_angle", M_PI, "maximum angle between approach direction and grasp z-axis");
+}
+
+void GenerateDatabaseGrasps::init(const core::RobotModelConstPtr& robot_model) {
+	InitStageException errors;
+	try {
+		GeneratePose::init(robot_model);
+	} catch (InitStageException& e) {
+		errors.append(e);
+	}
+
+	const auto& props = properties();
+	if (!props.get<GraspDatabaseConstPtr>("database"))
+		errors.push_back(*this, "no grasp database");
+	props.get<std::string>("object");  // check availability of object
+
+	if (errors)
+		throw errors;
+}
+
+void GenerateDatabaseGrasps::compute() {
+	if (upstream_solutions_.empty())
+		return;
+	planning_scene::PlanningScenePtr scene = upstream_solutions_.pop()->end()->scene()->diff();
+
+	const auto& props = properties();
+	const std::string& object = props.get<std::string>("object");
+	if (!scene->knowsFrameTransform(object)) {
+		spawn(InterfaceState{ scene }, SubTrajectory::failure("object '" + object + "' not in scene"));
+		return;
+	}
+	const GraspDatabase::Range range = props.get<GraspDatabaseConstPtr>("database")->grasps(object);
+
+	// grasps are sorted by quality: cut off low-quality ones
+	const float min_quality = props.get<double>("min_quality");
+	const GraspDatabase::Grasp* end = std::partition_point(
+	    range.begin, range.end, [min_quality](const GraspDatabase::Grasp& g) { return g.quality >= min_quality; });
+	const size_t num = end - range.begin;
+
+	// approach filter: z-axis of grasp rotation, compared to approach direction w.r.t. object frame
+	std::vector<uint8_t> accepted(num, 1);
+	const double max_angle = props.get<double>("max_approach_angle");
+	if (max_angle < M_PI) {
+		const Eigen::Vector3f d = (scene->getFrameTransform(object).linear().transpose() *
+		                           props.get<Eigen::Vector3d>("approach_direction").normalized())
+		                              .cast<float>();
+		const float min_cos = std::cos(max_angle);
+		const GraspDatabase::Grasp* g = range.begin;
+		for (size_t i = 0; i != num; ++i) {  // branch-free loop over the mapped records
+			const float x = g[i].orientation[0], y = g[i].orientation[1], z = g[i].orientation[2],
+			            w = g[i].orientation[3];
+			const float dot =
+			    d[0] * 2.f * (x * z + w * y) + d[1] * 2.f * (y * z - w * x) + d[2] * (1.f - 2.f * (x * x + y * y));
+			accepted[i] = dot >= min_cos;
+		}
+	}
+
+	const uint32_t max_grasps = props.get<uint32_t>("max_grasps");
+	const double quality_weight = props.get<double>("quality_weight");
+	geometry_msgs::PoseStamped target_pose_msg;
+	target_pose_msg.header.frame_id = object;
+	uint32_t spawned = 0;
+	for (size_t i = 0; i != num && (max_grasps == 0 || spawned < max_grasps); ++i) {
+		if (!accepted[i])
+			continue;
+		const GraspDatabase::Grasp& grasp = range.begin[i];
+
+		InterfaceState state(scene);
+		target_pose_msg.pose = tf2::toMsg(grasp.pose());
+		state.properties().set("target_pose", target_pose_msg);
+		state.properties().set("grasp_width", static_cast<double>(grasp.width));
+
+		SubTrajectory trajectory;
+		trajectory.setCost(quality_weight * std::max(0.0, 1.0 - grasp.quality));
+		trajectory.formatComment([quality = grasp.quality](std::string& comment) {
+			comment = "quality " + std::to_string(quality);
+		});
+		rviz_marker_tools::appendFrame(trajectory.markers(), target_pose_msg, 0.1, "grasp frame");
+
+		spawn(std::move(state), std::move(trajectory));
+		++spawned;
+	}
+	if (spawned == 0)
+		spawn(InterfaceState{ scene }, SubTrajectory::failure("no matching grasps for '" + object + "'"));
+}
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
@@ -37,13 +37,12 @@
 #include <moveit/task_constructor/stages/generate_grasp_pose.h>
 #include <moveit/task_constructor/storage.h>
 #include <moveit/task_constructor/marker_tools.h>
-#include <rviz_marker_tools/marker_creation.h>
 
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_state/conversions.h>
 
 #include <Eigen/Geometry>
-#include <tf2_eigen/tf2_eigen.h>
+#include <cmath>
 
 namespace moveit {
 namespace task_constructor {
@@ -54,40 +53,44 @@ GenerateGraspPose::GenerateGraspPose(const std::string& name) : GeneratePose(nam
 	p.declare<std::string>("eef", "name of end-effector");
 	p.declare<std::string>("object");
 	p.declare<double>("angle_delta", 0.1, "angular steps (rad)");
+	p.declare<uint32_t>("samples_per_compute", 0, "number of angle samples spawned per compute() (0: all)");
 
 	p.declare<boost::any>("pregrasp", "pregrasp posture");
 	p.declare<boost::any>("grasp", "grasp posture");
 }
 
-static void applyPreGrasp(moveit::core::RobotState& state, const moveit::core::JointModelGroup* jmg,
-                          const Property& diff_property) {
-	try {
-		// try named joint pose
-		const std::string& diff_state_name{ boost::any_cast<std::string>(diff_property.value()) };
-		if (!state.setToDefaultValues(jmg, diff_state_name)) {
-			throw moveit::Exception{ "unknown state '" + diff_state_name + "'" };
-		}
-		return;
-	} catch (const boost::bad_any_cast&) {
-	}
+static void compilePreGrasp(utils::JointPosture& posture, const moveit::core::JointModelGroup* jmg,
+                            const Property& diff_property) {
+	posture.clear();
+	const boost::any& value = diff_property.value();
+	if (const std::string* diff_state_name = boost::any_cast<std::string>(&value))  // named joint pose
+		posture.compile(jmg, *diff_state_name);
+	else if (const auto* robot_state_msg = boost::any_cast<moveit_msgs::RobotState>(&value))  // RobotState
+		posture.compile(jmg, *robot_state_msg);
+	else
+		throw moveit::Exception{ "no named pose or RobotState message" };
+}
 
-	try {
-		// try RobotState
-		const moveit_msgs::RobotState& robot_state_msg = boost::any_cast<moveit_msgs::RobotState>(diff_property.value());
-		if (!robot_state_msg.is_diff)
-			throw moveit::Exception{ "RobotState message must be a diff" };
-		const auto& accepted = jmg->getJointModelNames();
-		for (const auto& joint_name_list :
-		     { robot_state_msg.joint_state.name, robot_state_msg.multi_dof_joint_state.joint_names })
-			for (const auto& name : joint_name_list)
-				if (std::find(accepted.cbegin(), accepted.cend(), name) == accepted.cend())
-					throw moveit::Exception("joint '" + name + "' is not part of group '" + jmg->getName() + "'");
-		robotStateMsgToRobotState(robot_state_msg, state);
-		return;
-	} catch (const boost::bad_any_cast&) {
-	}
+namespace {
+// van der Corput sequence in base 2 over [0, 2^bits): reversed bits of i
+size_t reverseBits(size_t i, unsigned int bits) {
+	size_t result = 0;
+	for (unsigned int b = 0; b != bits; ++b, i >>= 1)
+		result = (result << 1) | (i & 1);
+	return result;
+}
+}  // namespace
+
+void GenerateGraspPose::reset() {
+	sample_scene_.reset();
+	next_sample_ = 0;
+	GeneratePose::reset();
+}
 
-	throw moveit::Exception{ "no named pose or RobotState message" };
+void GenerateGraspPose::regenerate() {
+	sample_scene_.reset();
+	next_sample_ = 0;
+	GeneratePose::regenerate();
 }
 
 void GenerateGraspPose::init(const core::RobotModelConstPtr& robot_model) {
@@ -115,9 +118,8 @@ void GenerateGraspPose::init(const core::RobotModelConstPtr& robot_model) {
 
 	// check availability of eef pose
 	const moveit::core::JointModelGroup* jmg = robot_model->getEndEffector(eef);
-	moveit::core::RobotState test_state{ robot_model };
 	try {
-		applyPreGrasp(test_state, jmg, props.property("pregrasp"));
+		compilePreGrasp(pregrasp_, jmg, props.property("pregrasp"));
 	} catch (const moveit::Exception& e) {
 		errors.push_back(*this, std::string{ "invalid pregrasp: " } + e.what());
 	}
@@ -140,47 +142,85 @@ void GenerateGraspPose::onNewSolution(const SolutionBase& s) {
 	upstream_solutions_.push(&s);
 }
 
+bool GenerateGraspPose::canCompute() const {
+	return sample_scene_ || GeneratePose::canCompute();
+}
+
 void GenerateGraspPose::compute() {
+	const auto& props = properties();
+	const uint32_t samples_per_compute = props.get<uint32_t>("samples_per_compute");
+	if (sample_scene_) {  // continue sampling of current upstream solution
+		const double delta = props.get<double>("angle_delta");
+		const size_t num_samples = static_cast<size_t>(std::ceil(2. * M_PI / std::fabs(delta) - 1e-9));
+		unsigned int bits = 0;
+		while ((size_t(1) << bits) < num_samples)
+			++bits;
+		PoseCandidates candidates(props.get<std::string>("object"));
+		std::vector<std::string> comments;
+		for (uint32_t spawned = 0; spawned < samples_per_compute && next_sample_ < (size_t(1) << bits);) {
+			const size_t index = reverseBits(next_sample_++, bits);
+			if (index >= num_samples)
+				continue;  // outside of the (non-power-of-two) sample range
+			addSample(candidates, comments, index * delta, std::to_string(index * delta));
+			++spawned;
+		}
+		spawnSamples(candidates, comments, sample_scene_);
+		if (next_sample_ >= (size_t(1) << bits))
+			sample_scene_.reset();  // all samples spawned
+		return;
+	}
+
 	if (upstream_solutions_.empty())
 		return;
 	planning_scene::PlanningScenePtr scene = upstream_solutions_.pop()->end()->scene()->diff();
 
 	// set end effector pose
-	const auto& props = properties();
 	const std::string& eef = props.get<std::string>("eef");
 	const moveit::core::JointModelGroup* jmg = scene->getRobotModel()->getEndEffector(eef);
 
 	robot_state::RobotState& robot_state = scene->getCurrentStateNonConst();
 	try {
-		applyPreGrasp(robot_state, jmg, props.property("pregrasp"));
+		if (pregrasp_.group() != jmg)  // eef changed since init()
+			compilePreGrasp(pregrasp_, jmg, props.property("pregrasp"));
+		pregrasp_.apply(robot_state);
 	} catch (const moveit::Exception& e) {
 		spawn(InterfaceState{ scene }, SubTrajectory::failure(std::string{ "invalid pregrasp: " } + e.what()));
 		return;
 	}
 
-	geometry_msgs::PoseStamped target_pose_msg;
-	target_pose_msg.header.frame_id = props.get<std::string>("object");
+	if (samples_per_compute > 0) {  // stream samples in subsequent compute() calls
+		sample_scene_ = scene;
+		next_sample_ = 0;
+		compute();
+		return;
+	}
 
+	PoseCandidates candidates(props.get<std::string>("object"));
+	std::vector<std::string> comments;
 	double current_angle = 0.0;
 	while (current_angle < 2. * M_PI && current_angle > -2. * M_PI) {
-		// rotate object pose about z-axis
-		Eigen::Isometry3d target_pose(Eigen::AngleAxisd(current_angle, Eigen::Vector3d::UnitZ()));
+		const double angle = current_angle;
 		current_angle += props.get<double>("angle_delta");
+		addSample(candidates, comments, angle, std::to_string(current_angle));
+	}
+	spawnSamples(candidates, comments, scene);
+}
 
-		InterfaceState state(scene);
-		target_pose_msg.pose = tf2::toMsg(target_pose);
-		state.properties().set("target_pose", target_pose_msg);
-		props.exposeTo(state.properties(), { "pregrasp", "grasp" });
-
-		SubTrajectory trajectory;
-		trajectory.setCost(0.0);
-		trajectory.setComment(std::to_string(current_angle));
-
-		// add frame at target pose
-		rviz_marker_tools::appendFrame(trajectory.markers(), target_pose_msg, 0.1, "grasp frame");
+void GenerateGraspPose::addSample(PoseCandidates& candidates, std::vector<std::string>& comments, double angle,
+                                  const std::string& comment) {
+	// rotate object pose about z-axis
+	candidates.add(Eigen::Isometry3d(Eigen::AngleAxisd(angle, Eigen::Vector3d::UnitZ())), 0.0, comments.size());
+	comments.push_back(comment);
+}
 
-		spawn(std::move(state), std::move(trajectory));
-	}
+void GenerateGraspPose::spawnSamples(PoseCandidates& candidates, const std::vector<std::string>& comments,
+                                     const planning_scene::PlanningScenePtr& scene) {
+	const auto& props = properties();
+	spawnCandidates(candidates, scene, "grasp frame",
+	                [&](size_t index, InterfaceState& state, SubTrajectory& trajectory) {
+		                props.exposeTo(state.properties(), { "pregrasp", "grasp" });
+		                trajectory.setComment(comments[candidates.parents()[index]]);
+	                });
 }
 }  // namespace stages
 }  // namespace task_constructor
@@ -37,6 +37,7 @@
 #include <moveit/task_constructor/stages/generate_place_pose.h>
 #include <moveit/task_constructor/storage.h>
 #include <moveit/task_constructor/marker_tools.h>
+#include <moveit/task_constructor/moveit_compat.h>
 
 #include <rviz_marker_tools/marker_creation.h>
 
@@ -44,6 +45,7 @@
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_state/attached_body.h>
 
+#include <geometric_shapes/shape_operations.h>
 #include <Eigen/Geometry>
 #include <tf2_eigen/tf2_eigen.h>
 
@@ -51,11 +53,30 @@ namespace moveit {
 namespace task_constructor {
 namespace stages {
 
+namespace {
+using AlignedBox = Eigen::AlignedBox3d;
+
+// axis-aligned bounding box of shape, placed at pose
+AlignedBox boundingBox(const shapes::Shape& shape, const Eigen::Isometry3d& pose) {
+	const Eigen::Vector3d half = 0.5 * shapes::computeShapeExtents(&shape);
+	const Eigen::Vector3d extent = pose.linear().cwiseAbs() * half;
+	return AlignedBox(pose.translation() - extent, pose.translation() + extent);
+}
+
+bool supports(const AlignedBox& support, const AlignedBox& object, double tolerance) {
+	const Eigen::Vector3d center = object.center();
+	return center.x() >= support.min().x() && center.x() <= support.max().x() && center.y() >= support.min().y() &&
+	       center.y() <= support.max().y() && object.min().z() >= support.max().z() - tolerance;
+}
+}  // namespace
+
 GeneratePlacePose::GeneratePlacePose(const std::string& name) : GeneratePose(name) {
 	auto& p = properties();
 	p.declare<std::string>("object");
 	p.declare<geometry_msgs::PoseStamped>("ik_frame");
 	p.declare<bool>("allow_z_flip", false, "allow placing objects upside down");
+	p.declare<std::string>("support_surface", "", "world object to place on (pre-filters unsupported poses)");
+	p.declare<double>("support_tolerance", 0.01, "allowed penetration of support surface");
 }
 
 void GeneratePlacePose::onNewSolution(const SolutionBase& s) {
@@ -108,9 +129,40 @@ void GeneratePlacePose::compute() {
 	ik_frame = robot_state.getGlobalLinkTransform(ik_frame_msg.header.frame_id) * ik_frame;
 	Eigen::Isometry3d object_to_ik = orig_object_pose.inverse() * ik_frame;
 
+	// bounding box of support surface
+	const std::string& support_id = props.get<std::string>("support_surface");
+	AlignedBox support;
+	if (!support_id.empty()) {
+		collision_detection::World::ObjectConstPtr surface = scene->getWorld()->getObject(support_id);
+		if (!surface) {
+			ROS_WARN_STREAM_NAMED("GeneratePlacePose", "unknown support surface '" << support_id << "'");
+			return;
+		}
+		for (size_t i = 0; i != surface->shapes_.size(); ++i)
+#if MOVEIT_HAS_OBJECT_POSE
+			support.extend(boundingBox(*surface->shapes_[i], surface->pose_ * surface->shape_poses_[i]));
+#else
+			support.extend(boundingBox(*surface->shapes_[i], surface->shape_poses_[i]));
+#endif
+	}
+	const double tolerance = props.get<double>("support_tolerance");
+	// shape poses w.r.t. the first shape, which is placed at the candidate pose
+	std::vector<Eigen::Isometry3d> shape_poses;
+	for (const Eigen::Isometry3d& pose : object->getGlobalCollisionBodyTransforms())
+		shape_poses.push_back(orig_object_pose.inverse() * pose);
+	auto supported = [&](const Eigen::Isometry3d& candidate) {
+		if (support_id.empty())
+			return true;
+		AlignedBox box;
+		for (size_t i = 0; i != shape_poses.size(); ++i)
+			box.extend(boundingBox(*object->getShapes()[i], candidate * shape_poses[i]));
+		return supports(support, box, tolerance);
+	};
+
 	// spawn the nominal target object pose, considering flip about z and rotations about z-axis
-	auto spawner = [&s, &scene, &object_to_ik, this](const Eigen::Isometry3d& nominal, uint z_flips,
-	                                                 uint z_rotations = 10) {
+	size_t rejected = 0;
+	auto spawner = [&s, &scene, &object_to_ik, &supported, &rejected, this](const Eigen::Isometry3d& nominal,
+	                                                                         uint z_flips, uint z_rotations = 10) {
 		for (uint flip = 0; flip <= z_flips; ++flip) {
 			// flip about object's x-axis
 			Eigen::Isometry3d object = nominal * Eigen::AngleAxisd(flip * M_PI, Eigen::Vector3d::UnitX());
@@ -121,6 +173,12 @@ void GeneratePlacePose::compute() {
 				    .prerotate(Eigen::AngleAxisd(i * 2. * M_PI / z_rotations, Eigen::Vector3d::UnitZ()))
 				    .pretranslate(pos);
 
+				// cheap pre-filter before creating any state
+				if (!supported(object)) {
+					++rejected;
+					continue;
+				}
+
 				// target ik_frame's pose w.r.t. planning frame
 				geometry_msgs::PoseStamped target_pose_msg;
 				target_pose_msg.header.frame_id = scene->getPlanningFrame();
@@ -140,28 +198,35 @@ void GeneratePlacePose::compute() {
 	};
 
 	uint z_flips = props.get<bool>("allow_z_flip") ? 1 : 0;
+	bool handled = false;
 	if (object->getShapes().size() == 1) {
+		handled = true;
 		switch (object->getShapes()[0]->type) {
 			case shapes::CYLINDER:
 				spawner(target_pose, z_flips);
-				return;
+				break;
 
 			case shapes::BOX: {  // consider 180/90 degree rotations about z axis
 				const double* dims = static_cast<const shapes::Box&>(*object->getShapes()[0]).size;
 				spawner(target_pose, z_flips, (std::abs(dims[0] - dims[1]) < 1e-5) ? 4 : 2);
-				return;
+				break;
 			}
 			case shapes::SPHERE:  // keep original orientation and rotate about world's z
 				target_pose.linear() = orig_object_pose.linear();
 				spawner(target_pose, z_flips);
-				return;
+				break;
 			default:
+				handled = false;
 				break;
 		}
 	}
 
 	// any other case: only try given target pose
-	spawner(target_pose, 1, 1);
+	if (!handled)
+		spawner(target_pose, 1, 1);
+
+	if (rejected > 0)
+		ROS_DEBUG_STREAM_NAMED("GeneratePlacePose", rejected << " place poses not supported by '" << support_id << "'");
 }
 }  // namespace stages
 }  // namespace task_constructor
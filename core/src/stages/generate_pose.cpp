@@ -40,6 +40,7 @@
 #include <moveit/task_constructor/marker_tools.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <rviz_marker_tools/marker_creation.h>
+#include <tf2_eigen/tf2_eigen.h>
 
 namespace moveit {
 namespace task_constructor {
@@ -50,6 +51,8 @@ GeneratePose::GeneratePose(const std::string& name) : MonitoringGenerator(name)
 
 	auto& p = properties();
 	p.declare<geometry_msgs::PoseStamped>("pose", "target pose to pass on in spawned states");
+	p.declare<PoseCandidates::Filter>("candidate_filter", PoseCandidates::Filter(),
+	                                  "filter applied to all candidate poses of a compute() call");
 }
 
 void GeneratePose::reset() {
@@ -57,6 +60,11 @@ void GeneratePose::reset() {
 	MonitoringGenerator::reset();
 }
 
+void GeneratePose::regenerate() {
+	upstream_solutions_.clear();
+	MonitoringGenerator::regenerate();
+}
+
 void GeneratePose::onNewSolution(const SolutionBase& s) {
 	// It's safe to store a pointer to this solution, as the generating stage stores it
 	upstream_solutions_.push(&s);
@@ -79,15 +87,44 @@ void GeneratePose::compute() {
 		return;
 	}
 
-	InterfaceState state(scene);
-	state.properties().set("target_pose", target_pose);
+	PoseCandidates candidates(target_pose.header.frame_id);
+	Eigen::Isometry3d pose;
+	tf2::fromMsg(target_pose.pose, pose);
+	candidates.add(pose);
+	spawnCandidates(candidates, scene, "pose frame");
+}
 
-	SubTrajectory trajectory;
-	trajectory.setCost(0.0);
+size_t GeneratePose::spawnCandidates(PoseCandidates& candidates, const planning_scene::PlanningScenePtr& scene,
+                                     const std::string& marker_name, const Decorator& decorate) {
+	const size_t num_candidates = candidates.size();
+	if (const PoseCandidates::Filter& filter = properties().get<PoseCandidates::Filter>("candidate_filter"))
+		filter(candidates);
+	for (size_t i = candidates.size(); i < num_candidates; ++i)
+		silentFailure();
 
-	rviz_marker_tools::appendFrame(trajectory.markers(), target_pose, 0.1, "pose frame");
+	Batch batch;
+	batch.reserve(candidates.size());
+	for (size_t i = 0; i != candidates.size(); ++i) {
+		geometry_msgs::PoseStamped target_pose;
+		target_pose.header.frame_id = candidates.frame();
+		target_pose.pose = tf2::toMsg(candidates.poses()[i]);
 
-	spawn(std::move(state), std::move(trajectory));
+		InterfaceState state(scene);
+		state.properties().set("target_pose", target_pose);
+
+		SubTrajectory trajectory;
+		trajectory.setCost(candidates.scores()[i]);
+
+		// add frame at target pose, generated only on demand
+		trajectory.addMarkers([target_pose, marker_name](std::deque<visualization_msgs::Marker>& markers) {
+			rviz_marker_tools::appendFrame(markers, target_pose, 0.1, marker_name);
+		});
+		if (decorate)
+			decorate(i, state, trajectory);
+		batch.emplace_back(std::move(state), std::move(trajectory));
+	}
+	spawnMany(std::move(batch));
+	return candidates.size();
 }
 }  // namespace stages
 }  // namespace task_constructor
@@ -74,6 +74,7 @@ void ModifyPlanningScene::removeObject(const std::string& object_name) {
 
 void ModifyPlanningScene::allowCollisions(const Names& first, const Names& second, bool allow) {
 	collision_matrix_edits_.push_back(CollisionMatrixPairs({ first, second, allow }));
+	collision_matrix_coalesced_ = false;
 }
 
 void ModifyPlanningScene::allowCollisions(const std::string& first, const moveit::core::JointModelGroup& jmg,
@@ -106,15 +107,35 @@ void ModifyPlanningScene::attachObjects(planning_scene::PlanningScene& scene,
 	}
 }
 
-void ModifyPlanningScene::allowCollisions(planning_scene::PlanningScene& scene, const CollisionMatrixPairs& pairs,
+void ModifyPlanningScene::coalesceCollisionMatrixEdits() {
+	collision_matrix_batches_.clear();
+	for (const CollisionMatrixPairs& edit : collision_matrix_edits_) {
+		if (edit.second.empty()) {
+			// object-wide entries override previous pair entries: start a new batch
+			if (collision_matrix_batches_.empty() || !collision_matrix_batches_.back().pairs.empty())
+				collision_matrix_batches_.emplace_back();
+			for (const auto& name : edit.first)
+				collision_matrix_batches_.back().objects.emplace_back(name, edit.allow);
+		} else {
+			if (collision_matrix_batches_.empty())
+				collision_matrix_batches_.emplace_back();
+			auto& pairs = collision_matrix_batches_.back().pairs;
+			// the ACM is symmetric: later edits of a pair override earlier ones
+			for (const auto& first : edit.first)
+				for (const auto& second : edit.second)
+					pairs[first < second ? std::make_pair(first, second) : std::make_pair(second, first)] = edit.allow;
+		}
+	}
+	collision_matrix_coalesced_ = true;
+}
+
+void ModifyPlanningScene::allowCollisions(planning_scene::PlanningScene& scene, const CollisionMatrixBatch& batch,
                                           bool invert) {
 	collision_detection::AllowedCollisionMatrix& acm = scene.getAllowedCollisionMatrixNonConst();
-	bool allow = invert ? !pairs.allow : pairs.allow;
-	if (pairs.second.empty()) {
-		for (const auto& name : pairs.first)
-			acm.setEntry(name, allow);
-	} else
-		acm.setEntry(pairs.first, pairs.second, allow);
+	for (const auto& object : batch.objects)
+		acm.setEntry(object.first, invert ? !object.second : object.second);
+	for (const auto& pair : batch.pairs)
+		acm.setEntry(pair.first.first, pair.first.second, invert ? !pair.second : pair.second);
 }
 
 // invert indicates, whether to detach instead of attach (and vice versa)
@@ -131,8 +152,10 @@ InterfaceState ModifyPlanningScene::apply(const InterfaceState& from, bool inver
 		attachObjects(*scene, pair, invert);
 
 	// allow/forbid collisions
-	for (const auto& pairs : collision_matrix_edits_)
-		allowCollisions(*scene, pairs, invert);
+	if (!collision_matrix_coalesced_)
+		coalesceCollisionMatrixEdits();
+	for (const auto& batch : collision_matrix_batches_)
+		allowCollisions(*scene, batch, invert);
 
 	if (callback_)
 		callback_(scene, properties());
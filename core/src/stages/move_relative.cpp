@@ -38,6 +38,8 @@
 
 #include <moveit/task_constructor/stages/move_relative.h>
 #include <moveit/task_constructor/cost_terms.h>
+#include <moveit/task_constructor/solvers/cartesian_path.h>
+#include <moveit/task_constructor/warm_start.h>
 
 #include <moveit/planning_scene/planning_scene.h>
 #include <rviz_marker_tools/marker_creation.h>
@@ -77,6 +79,69 @@ void MoveRelative::setIKFrame(const Eigen::Isometry3d& pose, const std::string&
 void MoveRelative::init(const moveit::core::RobotModelConstPtr& robot_model) {
 	PropagatingEitherWay::init(robot_model);
 	planner_->init(robot_model);
+	ik_frame_ = IKFrame();
+}
+
+bool MoveRelative::enableWarmStart(WarmStartCache& cache) {
+	const solvers::PlannerInterfacePtr planner = cache.cachingPlanner(planner_);
+	if (planner == planner_)
+		return false;
+	planner_ = planner;
+	return true;
+}
+
+bool MoveRelative::resolveIKFrame(const planning_scene::PlanningScene& scene,
+                                  const moveit::core::JointModelGroup* jmg, SolutionBase& solution,
+                                  const moveit::core::LinkModel*& link, Eigen::Isometry3d& ik_pose_world) {
+	const Property& property = properties().property("ik_frame");
+	const moveit::core::RobotState& state = scene.getCurrentState();
+	geometry_msgs::PoseStamped ik_pose_msg;
+	ik_pose_msg.pose.orientation.w = 1.0;
+	if (!property.value().empty())
+		ik_pose_msg = boost::any_cast<geometry_msgs::PoseStamped>(property.value());
+	const std::string& frame_id = ik_pose_msg.header.frame_id;
+
+	if (ik_frame_.jmg != jmg || ik_frame_.frame_id != frame_id || !ik_frame_.link) {
+		// only frames of robot links are rigidly connected independently of the scene's attached objects
+		std::vector<const moveit::core::LinkModel*> tips;
+		if (frame_id.empty())
+			jmg->getEndEffectorTips(tips);
+		ik_frame_.jmg = jmg;
+		ik_frame_.frame_id = frame_id;
+		if (tips.size() == 1) {
+			ik_frame_.link = tips[0];
+			ik_frame_.offset.setIdentity();
+		} else if (!frame_id.empty() && state.getRobotModel()->hasLinkModel(frame_id)) {
+			ik_frame_.link = utils::getRigidlyConnectedParentLinkModel(state, frame_id);
+			ik_frame_.offset =
+			    state.getGlobalLinkTransform(ik_frame_.link).inverse() * state.getGlobalLinkTransform(frame_id);
+		} else {  // fallback to full resolution, reporting errors
+			ik_frame_ = IKFrame();
+			return utils::getRobotTipForFrame(property, scene, jmg, solution, link, ik_pose_world);
+		}
+	}
+
+	link = ik_frame_.link;
+	Eigen::Isometry3d pose;
+	tf2::fromMsg(ik_pose_msg.pose, pose);
+	ik_pose_world = state.getGlobalLinkTransform(link) * Eigen::Isometry3d(ik_frame_.offset) * pose;
+	return true;
+}
+
+int MoveRelative::planCandidates(const planning_scene::PlanningSceneConstPtr& from,
+                                 const moveit::core::LinkModel& link, const EigenSTL::vector_Isometry3d& targets,
+                                 const moveit::core::JointModelGroup* jmg, double timeout,
+                                 robot_trajectory::RobotTrajectoryPtr& result,
+                                 const moveit_msgs::Constraints& path_constraints) {
+	// CartesianPath evaluates the candidates in parallel
+	if (const auto cartesian = std::dynamic_pointer_cast<solvers::CartesianPath>(planner_))
+		return cartesian->planCandidates(from, link, targets, jmg, timeout, result, path_constraints,
+		                                 solvers::CartesianPath::FIRST_FEASIBLE, preemptionToken());
+	// other planners try them in order, leaving the last attempt in result on failure
+	for (std::size_t i = 0; i < targets.size(); ++i)
+		if (planner_->plan(from, link, targets[i], jmg, timeout, result, path_constraints, preemptionToken()))
+			return static_cast<int>(i);
+	return -1;
 }
 
 static bool getJointStateFromOffset(const boost::any& direction, const moveit::core::JointModelGroup* jmg,
@@ -105,17 +170,15 @@ static bool getJointStateFromOffset(const boost::any& direction, const moveit::c
 }
 
 static void visualizePlan(std::deque<visualization_msgs::Marker>& markers, Interface::Direction dir, bool success,
-                          const std::string& ns, const std::string& frame_id, const Eigen::Isometry3d& link_pose,
-                          const Eigen::Isometry3d& reached_pose, const Eigen::Vector3d& linear, double distance) {
+                          const std::string& ns, const std::string& frame_id, const Eigen::Vector3d& pos_link,
+                          const Eigen::Vector3d& pos_reached, const Eigen::Vector3d& linear, double distance) {
 	double linear_norm = linear.norm();
 
 	// rotation of the target direction and for the cylinder marker
 	auto quat_target = Eigen::Quaterniond::FromTwoVectors(Eigen::Vector3d::UnitX(), linear);
 	auto quat_cylinder = quat_target * Eigen::AngleAxisd(0.5 * M_PI, Eigen::Vector3d::UnitY());
 
-	// link position before planning; reached link position after planning; target link position
-	Eigen::Vector3d pos_link = link_pose.translation();
-	Eigen::Vector3d pos_reached = reached_pose.translation();
+	// link position before planning (pos_link); reached link position after planning (pos_reached); target position
 	Eigen::Vector3d pos_target = pos_reached + quat_target * Eigen::Vector3d(linear_norm - distance, 0, 0);
 
 	visualization_msgs::Marker m;
@@ -190,13 +253,17 @@ bool MoveRelative::compute(const InterfaceState& state, planning_scene::Planning
 
 	if (getJointStateFromOffset(direction, jmg, scene->getCurrentStateNonConst())) {
 		// plan to joint-space target
-		success = planner_->plan(state.scene(), scene, jmg, timeout, robot_trajectory, path_constraints);
+		{
+			ComputeUnlock unlock(*this);  // allow other stages to compute meanwhile
+			success = planner_->plan(state.scene(), scene, jmg, timeout, robot_trajectory, path_constraints,
+			                         preemptionToken());
+		}
 	} else {
 		// Cartesian targets require an IK reference frame
 		const moveit::core::LinkModel* link;
 		Eigen::Isometry3d ik_pose_world;
 
-		if (!utils::getRobotTipForFrame(props.property("ik_frame"), *scene, jmg, solution, link, ik_pose_world))
+		if (!resolveIKFrame(*scene, jmg, solution, link, ik_pose_world))
 			return false;
 
 		bool use_rotation_distance = false;  // measure achieved distance as rotation?
@@ -205,9 +272,33 @@ bool MoveRelative::compute(const InterfaceState& state, planning_scene::Planning
 		double linear_norm = 0.0, angular_norm = 0.0;
 
 		Eigen::Isometry3d target_eigen;
+		// alternative targets for Directions and their linear motions
+		EigenSTL::vector_Isometry3d candidates;
+		EigenSTL::vector_Vector3d candidate_motions;
 		Eigen::Isometry3d link_pose =
 		    scene->getCurrentState().getGlobalLinkTransform(link);  // take a copy here, pose will change on success
 
+		auto translate = [&](const geometry_msgs::Vector3Stamped& target, Eigen::Vector3d& motion) {
+			const Eigen::Isometry3d& frame_pose = scene->getFrameTransform(target.header.frame_id);
+			tf2::fromMsg(target.vector, motion);
+
+			// use max distance?
+			if (max_distance > 0.0) {
+				motion.normalize();
+				motion *= max_distance;
+			}
+
+			// invert direction?
+			if (dir == Interface::BACKWARD)
+				motion *= -1.0;
+
+			// compute absolute transform for link
+			motion = frame_pose.linear() * motion;
+			Eigen::Isometry3d target_pose = ik_pose_world;
+			target_pose.translation() += motion;
+			return target_pose;
+		};
+
 		try {  // try to extract Twist
 			const geometry_msgs::TwistStamped& target = boost::any_cast<geometry_msgs::TwistStamped>(direction);
 			const Eigen::Isometry3d& frame_pose = scene->getFrameTransform(target.header.frame_id);
@@ -251,36 +342,47 @@ bool MoveRelative::compute(const InterfaceState& state, planning_scene::Planning
 		} catch (const boost::bad_any_cast&) { /* continue with Vector */
 		}
 
-		try {  // try to extract Vector
-			const geometry_msgs::Vector3Stamped& target = boost::any_cast<geometry_msgs::Vector3Stamped>(direction);
-			const Eigen::Isometry3d& frame_pose = scene->getFrameTransform(target.header.frame_id);
-			tf2::fromMsg(target.vector, linear);
-
-			// use max distance?
-			if (max_distance > 0.0) {
-				linear.normalize();
-				linear *= max_distance;
-			}
+		if (const auto* target = boost::any_cast<geometry_msgs::Vector3Stamped>(&direction)) {
+			target_eigen = translate(*target, linear);
 			linear_norm = linear.norm();
-
-			// invert direction?
-			if (dir == Interface::BACKWARD)
-				linear *= -1.0;
-
-			// compute absolute transform for link
-			linear = frame_pose.linear() * linear;
-			target_eigen = ik_pose_world;
-			target_eigen.translation() += linear;
-		} catch (const boost::bad_any_cast&) {
+		} else if (const auto* targets = boost::any_cast<Directions>(&direction)) {
+			for (const geometry_msgs::Vector3Stamped& target : *targets) {
+				candidate_motions.emplace_back();
+				candidates.push_back(translate(target, candidate_motions.back()));
+			}
+			if (candidates.empty()) {
+				solution.markAsFailure("undefined direction");
+				return false;
+			}
+		} else {
 			solution.markAsFailure(std::string("invalid direction type: ") + direction.type().name());
 			return false;
 		}
 
 	COMPUTE:
 		// transform target pose such that ik frame will reach there if link does
-		target_eigen = target_eigen * ik_pose_world.inverse() * scene->getCurrentState().getGlobalLinkTransform(link);
-
-		success = planner_->plan(state.scene(), *link, target_eigen, jmg, timeout, robot_trajectory, path_constraints);
+		const Eigen::Isometry3d ik_to_link = ik_pose_world.inverse() * link_pose;
+		if (candidates.empty()) {
+			target_eigen = target_eigen * ik_to_link;
+			ComputeUnlock unlock(*this);  // allow other stages to compute meanwhile
+			success = planner_->plan(state.scene(), *link, target_eigen, jmg, timeout, robot_trajectory, path_constraints,
+			                         preemptionToken());
+		} else {
+			for (Eigen::Isometry3d& candidate : candidates)
+				candidate = candidate * ik_to_link;
+			int chosen = -1;
+			{
+				ComputeUnlock unlock(*this);  // allow other stages to compute meanwhile
+				chosen = planCandidates(state.scene(), *link, candidates, jmg, timeout, robot_trajectory, path_constraints);
+			}
+			success = chosen >= 0;
+			if (!robot_trajectory) {
+				solution.markAsFailure("no feasible direction");
+				return false;
+			}
+			linear = candidate_motions[success ? static_cast<std::size_t>(chosen) : candidates.size() - 1];
+			linear_norm = linear.norm();
+		}
 
 		robot_state::RobotStatePtr& reached_state = robot_trajectory->getLastWayPointPtr();
 		reached_state->updateLinkTransforms();
@@ -297,9 +399,12 @@ bool MoveRelative::compute(const InterfaceState& state, planning_scene::Planning
 		if (min_distance > 0.0) {
 			success = distance >= min_distance;
 			if (!success) {
-				char msg[100];
-				snprintf(msg, sizeof(msg), "min_distance not reached (%.3g < %.3g)", distance, min_distance);
-				solution.setComment(msg);
+				solution.setFailureReason("min_distance not reached");
+				solution.formatComment([distance, min_distance](std::string& comment) {
+					char msg[100];
+					snprintf(msg, sizeof(msg), "min_distance not reached (%.3g < %.3g)", distance, min_distance);
+					comment = msg;
+				});
 			}
 		} else if (min_distance == 0.0) {  // if min_distance is zero, we succeed in any case
 			success = true;
@@ -309,8 +414,13 @@ bool MoveRelative::compute(const InterfaceState& state, planning_scene::Planning
 		// visualize plan
 		auto ns = props.get<std::string>("marker_ns");
 		if (!ns.empty() && linear_norm > 0) {  // ensures that 'distance' is the norm of the reached distance
-			visualizePlan(solution.markers(), dir, success, ns, scene->getPlanningFrame(), link_pose, reached_pose, linear,
-			              distance);
+			// generated only on demand: capture by value (positions only, Isometry3d would require aligned storage)
+			const Eigen::Vector3d pos_link = link_pose.translation();
+			const Eigen::Vector3d pos_reached = reached_pose.translation();
+			solution.addMarkers([dir, success, ns, frame_id = scene->getPlanningFrame(), pos_link, pos_reached, linear,
+			                     distance](std::deque<visualization_msgs::Marker>& markers) {
+				visualizePlan(markers, dir, success, ns, frame_id, pos_link, pos_reached, linear, distance);
+			});
 		}
 	}
 
@@ -323,6 +433,9 @@ bool MoveRelative::compute(const InterfaceState& state, planning_scene::Planning
 
 		if (!success)
 			solution.markAsFailure();
+		else if (planner_->validatesLazily())
+			solution.setValidationPending(true);
+		solution.deferTimeParameterization(solvers::PlannerInterface::deferredTimeParameterization(planner_));
 		return true;
 	}
 	return false;
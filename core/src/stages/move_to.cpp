@@ -43,10 +43,20 @@
 #include <moveit/task_constructor/stages/move_to.h>
 #include <moveit/task_constructor/cost_terms.h>
 #include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/task_constructor/solvers/pipeline_planner.h>
+#include <moveit/task_constructor/task_executor.h>
 #include <moveit/task_constructor/utils.h>
+#include <moveit/task_constructor/warm_start.h>
+
+#include <ros/serialization.h>
 
 #include <rviz_marker_tools/marker_creation.h>
 
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <thread>
+
 namespace moveit {
 namespace task_constructor {
 namespace stages {
@@ -68,6 +78,7 @@ MoveTo::MoveTo(const std::string& name, const solvers::PlannerInterfacePtr& plan
 
 	p.declare<moveit_msgs::Constraints>("path_constraints", moveit_msgs::Constraints(),
 	                                    "constraints to maintain during trajectory");
+	p.declare<uint32_t>("num_threads", 1, "number of goals planned for in parallel");
 }
 
 void MoveTo::setIKFrame(const Eigen::Isometry3d& pose, const std::string& link) {
@@ -90,13 +101,98 @@ void MoveTo::setGoal(const std::map<std::string, double>& joints) {
 	setProperty("goal", robot_state);
 }
 
+namespace {
+// key identifying a joint-space goal by its value (type tag + content), empty for other goal types
+std::string jointGoalKey(const boost::any& goal) {
+	if (const auto* named = boost::any_cast<std::string>(&goal))
+		return 'n' + *named;
+	if (const auto* msg = boost::any_cast<moveit_msgs::RobotState>(&goal)) {
+		std::string key(1 + ros::serialization::serializationLength(*msg), 'r');
+		ros::serialization::OStream stream(reinterpret_cast<uint8_t*>(&key[1]), key.size() - 1);
+		ros::serialization::serialize(stream, *msg);
+		return key;
+	}
+	if (const auto* joints = boost::any_cast<std::map<std::string, double>>(&goal)) {
+		std::string key(1, 'j');
+		for (const auto& joint : *joints) {
+			key.append(joint.first).push_back('\0');
+			key.append(reinterpret_cast<const char*>(&joint.second), sizeof(double));
+		}
+		return key;
+	}
+	return std::string();
+}
+
+void compileJointGoal(const boost::any& goal, const moveit::core::JointModelGroup* jmg,
+                      utils::JointPosture& posture) {
+	if (const auto* named = boost::any_cast<std::string>(&goal))
+		posture.compile(jmg, *named);
+	else if (const auto* msg = boost::any_cast<moveit_msgs::RobotState>(&goal))
+		posture.compile(jmg, *msg, false);
+	else if (const auto* joints = boost::any_cast<std::map<std::string, double>>(&goal))
+		posture.compile(jmg, *joints);
+}
+}  // namespace
+
+bool MoveTo::enableWarmStart(WarmStartCache& cache) {
+	const solvers::PlannerInterfacePtr planner = cache.cachingPlanner(planner_);
+	if (planner == planner_)
+		return false;
+	planner_ = planner;
+	return true;
+}
+
 void MoveTo::init(const moveit::core::RobotModelConstPtr& robot_model) {
 	PropagatingEitherWay::init(robot_model);
+	// goals planned in parallel need a pipeline instance each, as the (shared) instances are used exclusively
+	const uint32_t num_threads = properties().get<uint32_t>("num_threads");
+	if (auto pipeline = std::dynamic_pointer_cast<solvers::PipelinePlanner>(planner_)) {
+		if (num_threads > pipeline->properties().get<size_t>("num_instances"))
+			pipeline->setNumInstances(num_threads);
+	}
 	planner_->init(robot_model);
+
+	// compile joint-space goals once, unless they are provided per interface state
+	compiled_goals_.clear();
+	const auto& props = properties();
+	const Property& goal_property = props.property("goal");
+	if (goal_property.initsFrom(Stage::INTERFACE) || props.property("group").initsFrom(Stage::INTERFACE))
+		return;
+	const std::string group = props.get<std::string>("group", std::string());
+	if (!robot_model->hasJointModelGroup(group))
+		return;  // reported by compute()
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(group);
+
+	auto compile = [this, jmg](const boost::any& goal) {
+		std::string key = jointGoalKey(goal);
+		if (key.empty())
+			return;
+		utils::JointPosture posture;
+		try {
+			compileJointGoal(goal, jmg, posture);
+		} catch (const moveit::Exception&) {
+			return;  // reported by compute()
+		}
+		compiled_goals_[std::move(key)] = std::move(posture);
+	};
+	const boost::any& goal = goal_property.value();
+	if (const auto* goals = boost::any_cast<GoalSet>(&goal))
+		std::for_each(goals->begin(), goals->end(), compile);
+	else
+		compile(goal);
 }
 
 bool MoveTo::getJointStateGoal(const boost::any& goal, const moveit::core::JointModelGroup* jmg,
                                moveit::core::RobotState& state) {
+	if (!compiled_goals_.empty()) {  // compiled in init()?
+		auto it = compiled_goals_.find(jointGoalKey(goal));
+		if (it != compiled_goals_.end() && it->second.group() == jmg) {
+			it->second.apply(state);
+			state.update();
+			return true;
+		}
+	}
+
 	try {
 		// try named joint pose
 		const std::string& named_joint_pose = boost::any_cast<std::string>(goal);
@@ -175,8 +271,87 @@ bool MoveTo::getPointGoal(const boost::any& goal, const Eigen::Isometry3d& ik_po
 	return true;
 }
 
+void MoveTo::computeForward(const InterfaceState& from) {
+	const boost::any& goal = properties().get("goal");
+	if (goal.type() == typeid(GoalSet))
+		computeGoalSet<Interface::FORWARD>(from, boost::any_cast<const GoalSet&>(goal));
+	else
+		PropagatingEitherWay::computeForward(from);
+}
+
+void MoveTo::computeBackward(const InterfaceState& to) {
+	const boost::any& goal = properties().get("goal");
+	if (goal.type() == typeid(GoalSet))
+		computeGoalSet<Interface::BACKWARD>(to, boost::any_cast<const GoalSet&>(goal));
+	else
+		PropagatingEitherWay::computeBackward(to);
+}
+
+template <Interface::Direction dir>
+void MoveTo::computeGoalSet(const InterfaceState& state, const GoalSet& goals) {
+	struct Result
+	{
+		planning_scene::PlanningScenePtr scene;
+		SubTrajectory solution;
+		bool stored = false;
+		std::exception_ptr exception;
+	};
+	std::vector<Result> results(goals.size());
+
+	std::atomic<size_t> next{ 0 };
+	auto worker = [&]() {
+		for (size_t i = next++; i < goals.size(); i = next++) {
+			Result& result = results[i];
+			try {
+				result.stored = computeGoal(state, goals[i], result.scene, result.solution, dir, false);
+			} catch (...) {
+				result.exception = std::current_exception();
+			}
+		}
+	};
+	const size_t num_threads =
+	    std::max<size_t>(1, std::min<size_t>(properties().get<uint32_t>("num_threads"), goals.size()));
+	{
+		ComputeUnlock unlock(*this);  // allow other stages to compute meanwhile
+		std::vector<std::thread> threads;
+		const TaskExecutorPtr executor = TaskExecutor::current();
+		for (size_t i = 1; i < num_threads; ++i)
+			threads.push_back(executor->spawn(worker));
+		worker();
+		for (auto& thread : threads)
+			thread.join();
+	}
+	for (const Result& result : results)
+		if (result.exception)
+			std::rethrow_exception(result.exception);
+
+	// report reached goals first
+	std::vector<size_t> order(results.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_partition(order.begin(), order.end(), [&results](size_t i) { return !results[i].solution.isFailure(); });
+
+	bool sent = false;
+	for (size_t i : order) {
+		Result& result = results[i];
+		if (!result.stored && !result.solution.hasComment())
+			continue;  // nothing to report
+		result.solution.formatComment([i](std::string& comment) {
+			comment = "goal " + std::to_string(i) + (comment.empty() ? "" : ": " + comment);
+		});
+		send<dir>(state, InterfaceState(result.scene), std::move(result.solution));
+		sent = true;
+	}
+	if (!sent)
+		silentFailure();
+}
+
 bool MoveTo::compute(const InterfaceState& state, planning_scene::PlanningScenePtr& scene, SubTrajectory& solution,
                      Interface::Direction dir) {
+	return computeGoal(state, properties().get("goal"), scene, solution, dir, true);
+}
+
+bool MoveTo::computeGoal(const InterfaceState& state, const boost::any& goal, planning_scene::PlanningScenePtr& scene,
+                         SubTrajectory& solution, Interface::Direction dir, bool unlock) {
 	scene = state.scene()->diff();
 	const robot_model::RobotModelConstPtr& robot_model = scene->getRobotModel();
 	assert(robot_model);
@@ -189,7 +364,6 @@ bool MoveTo::compute(const InterfaceState& state, planning_scene::PlanningSceneP
 		solution.markAsFailure("invalid joint model group: " + group);
 		return false;
 	}
-	boost::any goal = props.get("goal");
 	if (goal.empty()) {
 		solution.markAsFailure("undefined goal");
 		return false;
@@ -201,7 +375,13 @@ bool MoveTo::compute(const InterfaceState& state, planning_scene::PlanningSceneP
 
 	if (getJointStateGoal(goal, jmg, scene->getCurrentStateNonConst())) {
 		// plan to joint-space target
-		success = planner_->plan(state.scene(), scene, jmg, timeout, robot_trajectory, path_constraints);
+		{
+			std::unique_ptr<ComputeUnlock> unlocked;
+			if (unlock)  // allow other stages to compute meanwhile
+				unlocked.reset(new ComputeUnlock(*this));
+			success = planner_->plan(state.scene(), scene, jmg, timeout, robot_trajectory, path_constraints,
+			                         preemptionToken());
+		}
 	} else {  // Cartesian goal
 		// Where to go?
 		Eigen::Isometry3d target;
@@ -233,7 +413,13 @@ bool MoveTo::compute(const InterfaceState& state, planning_scene::PlanningSceneP
 		target = target * ik_pose_world.inverse() * scene->getCurrentState().getGlobalLinkTransform(link);
 
 		// plan to Cartesian target
-		success = planner_->plan(state.scene(), *link, target, jmg, timeout, robot_trajectory, path_constraints);
+		{
+			std::unique_ptr<ComputeUnlock> unlocked;
+			if (unlock)  // allow other stages to compute meanwhile
+				unlocked.reset(new ComputeUnlock(*this));
+			success = planner_->plan(state.scene(), *link, target, jmg, timeout, robot_trajectory, path_constraints,
+			                         preemptionToken());
+		}
 	}
 
 	// store result
@@ -250,6 +436,9 @@ bool MoveTo::compute(const InterfaceState& state, planning_scene::PlanningSceneP
 
 		if (!success)
 			solution.markAsFailure();
+		else if (planner_->validatesLazily())
+			solution.setValidationPending(true);
+		solution.deferTimeParameterization(solvers::PlannerInterface::deferredTimeParameterization(planner_));
 
 		return true;
 	}
@@ -3,20 +3,27 @@
 #include <moveit/task_constructor/solvers/cartesian_path.h>
 
 #include <moveit/task_constructor/container.h>
+#include <moveit/task_constructor/stages/compute_ik.h>
 #include <moveit/task_constructor/stages/move_relative.h>
 
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <geometry_msgs/Vector3Stamped.h>
+#include <tf2_eigen/tf2_eigen.h>
+
+#include <limits>
 
 namespace moveit {
 namespace task_constructor {
 namespace stages {
 
 PickPlaceBase::PickPlaceBase(Stage::pointer&& grasp_stage, const std::string& name, bool forward)
-  : SerialContainer(name) {
+  : SerialContainer(name), forward_(forward) {
 	PropertyMap& p = properties();
 	p.declare<std::string>("object", "name of object to grasp");
 	p.declare<std::string>("eef", "end effector name");
 	p.declare<std::string>("eef_frame", "name of end effector frame");
+	p.declare<bool>("approach_precheck", false, "reject grasps with infeasible approach before creating their states");
 
 	// internal properties (cannot be marked as such yet)
 	p.declare<std::string>("eef_group", "JMG of eef");
@@ -75,6 +82,50 @@ void PickPlaceBase::init(const moveit::core::RobotModelConstPtr& robot_model) {
 	p->set<std::string>("eef_group", jmg->getName());
 	p->set<std::string>("eef_parent_group", jmg->getEndEffectorParentGroup().first);
 
+	if (p->get<bool>("approach_precheck")) {
+		if (!grasp_stage_->properties().hasProperty("ik_filter"))
+			throw InitStageException(*this, "approach precheck requires a grasp stage providing ik_filter");
+		auto precheck = [this](const planning_scene::PlanningSceneConstPtr& scene,
+		                       const moveit::core::RobotState& state, const moveit::core::LinkModel& link,
+		                       std::string& comment) {
+			const PropertyMap& approach = approach_stage_->properties();
+			const double distance = approach.get<double>("min_distance");
+			const boost::any& direction = approach.get("direction");
+			Eigen::Vector3d linear;
+			std::string frame;
+			if (direction.type() == typeid(geometry_msgs::TwistStamped)) {
+				const auto& twist = boost::any_cast<const geometry_msgs::TwistStamped&>(direction);
+				tf2::fromMsg(twist.twist.linear, linear);
+				frame = twist.header.frame_id;
+			} else if (direction.type() == typeid(geometry_msgs::Vector3Stamped)) {
+				const auto& vector = boost::any_cast<const geometry_msgs::Vector3Stamped&>(direction);
+				tf2::fromMsg(vector.vector, linear);
+				frame = vector.header.frame_id;
+			} else
+				return true;  // joint-space motions are not checked
+			if (distance <= 0.0 || linear.norm() < std::numeric_limits<double>::epsilon() ||
+			    !scene->knowsFrameTransform(frame))
+				return true;  // leave handling of these to the approach stage
+
+			// the approach of picking is planned backwards from the grasp, the retract of placing forwards
+			linear = (forward_ ? -distance : distance) * (scene->getFrameTransform(frame).linear() * linear.normalized());
+			Eigen::Isometry3d target = state.getGlobalLinkTransform(&link);
+			target.translation() += linear;
+
+			planning_scene::PlanningScenePtr start = scene->diff();
+			start->setCurrentState(state);
+			const moveit::core::JointModelGroup* jmg =
+			    state.getJointModelGroup(properties().get<std::string>("eef_parent_group"));
+			robot_trajectory::RobotTrajectoryPtr trajectory;
+			if (cartesian_solver_->plan(start, link, target, jmg, approach_stage_->timeout(), trajectory,
+			                            approach.get<moveit_msgs::Constraints>("path_constraints")))
+				return true;
+			comment = forward_ ? "approach infeasible" : "retract infeasible";
+			return false;
+		};
+		grasp_stage_->properties().set("ik_filter", ComputeIK::SolutionFilter(precheck));
+	}
+
 	// propagate my properties to children (and do standard init)
 	SerialContainer::init(robot_model);
 }
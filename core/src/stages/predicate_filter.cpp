@@ -36,23 +36,93 @@
 #include <moveit/task_constructor/stages/predicate_filter.h>
 
 #include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/task_executor.h>
 
 #include <moveit/planning_scene/planning_scene.h>
 
 #include <moveit/robot_state/conversions.h>
 #include <moveit/robot_state/robot_state.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
 
 namespace moveit {
 namespace task_constructor {
 namespace stages {
 
+// pool of threads evaluating predicates of queued jobs
+struct PredicateFilter::AsyncEvaluation
+{
+	struct Job
+	{
+		const SolutionBase* solution;
+		std::string comment;
+		bool accepted = false;
+		bool done = false;
+	};
+
+	std::mutex mutex;
+	std::condition_variable job_available;
+	std::condition_variable job_done;
+	std::list<Job> jobs;  // in input order, only modified by the planning thread
+	std::deque<Job*> queue;  // jobs not yet evaluated
+	std::vector<std::thread> workers;
+	bool stop = false;
+
+	~AsyncEvaluation() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		job_available.notify_all();
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	void work(const PredicateFilter& filter) {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			job_available.wait(lock, [this]() { return stop || !queue.empty(); });
+			if (stop)
+				return;
+			Job* job = queue.front();
+			queue.pop_front();
+			lock.unlock();
+
+			bool accepted = false;
+			try {
+				accepted = filter.evaluate(*job->solution, job->comment);
+			} catch (const std::exception& e) {
+				job->comment = e.what();
+			}
+
+			lock.lock();
+			job->accepted = accepted;
+			job->done = true;
+			job_done.notify_all();
+		}
+	}
+};
+
 PredicateFilter::PredicateFilter(const std::string& name, Stage::pointer&& child)
   : WrapperBase(name, std::move(child)) {
 	auto& p = properties();
 	p.declare<Predicate>("predicate", "predicate to filter wrapped solutions");
 	p.declare<bool>("ignore_filter", false, "ignore predicate and forward all solutions");
+	p.declare<uint32_t>("num_threads", 0, "number of threads evaluating predicates (0: synchronous)");
+	p.declare<bool>("keep_order", true, "forward asynchronously filtered solutions in input order");
+}
+
+PredicateFilter::~PredicateFilter() = default;
+
+void PredicateFilter::reset() {
+	async_.reset();  // stop workers, dropping pending solutions
+	WrapperBase::reset();
 }
 
 void PredicateFilter::init(const moveit::core::RobotModelConstPtr& robot_model) {
@@ -68,15 +138,73 @@ void PredicateFilter::init(const moveit::core::RobotModelConstPtr& robot_model)
 
 	// In theory this could be set in interface states
 	// but we enforce it here to keep code flow sane and maintainable
-	if (props.get("predicate").empty()) {
+	if (props.get("predicate").empty() && predicates_.empty()) {
 		InitStageException e(*this, "predicate is not specified");
 		errors.append(e);
 	}
 
+	// short-circuit evaluation: cheap predicates first
+	std::vector<std::pair<double, Predicate>> predicates = predicates_;
+	if (!props.get("predicate").empty())
+		predicates.emplace_back(1.0, props.get<Predicate>("predicate"));
+	std::stable_sort(predicates.begin(), predicates.end(),
+	                 [](const auto& a, const auto& b) { return a.first < b.first; });
+	ordered_predicates_.clear();
+	for (const auto& pair : predicates)
+		ordered_predicates_.push_back(pair.second);
+
 	if (errors)
 		throw errors;
 }
 
+bool PredicateFilter::evaluate(const SolutionBase& s, std::string& comment) const {
+	for (const Predicate& predicate : ordered_predicates_)
+		if (!predicate(s, comment))
+			return false;
+	return true;
+}
+
+bool PredicateFilter::canCompute() const {
+	return WrapperBase::canCompute() || (async_ && !async_->jobs.empty());
+}
+
+void PredicateFilter::compute() {
+	if (async_)  // only block for evaluations if there is nothing else to do
+		liftEvaluated(!WrapperBase::canCompute());
+	if (WrapperBase::canCompute())
+		WrapperBase::compute();
+}
+
+void PredicateFilter::liftEvaluated(bool wait) {
+	const bool keep_order = properties().get<bool>("keep_order");
+	std::list<AsyncEvaluation::Job> finished;
+	{
+		auto ready = [this, keep_order]() {
+			if (keep_order)
+				return async_->jobs.empty() || async_->jobs.front().done;
+			return async_->jobs.empty() || std::any_of(async_->jobs.begin(), async_->jobs.end(),
+			                                           [](const AsyncEvaluation::Job& job) { return job.done; });
+		};
+		std::unique_ptr<ComputeUnlock> unlocked;
+		if (wait)  // allow other stages to compute meanwhile
+			unlocked.reset(new ComputeUnlock(*this));
+		std::unique_lock<std::mutex> lock(async_->mutex);
+		if (wait)
+			async_->job_done.wait(lock, ready);
+		for (auto it = async_->jobs.begin(); it != async_->jobs.end();) {
+			if (it->done)
+				finished.splice(finished.end(), async_->jobs, it++);
+			else if (keep_order)
+				break;
+			else
+				++it;
+		}
+	}
+	for (const AsyncEvaluation::Job& job : finished)
+		liftSolution(*job.solution, job.accepted ? job.solution->cost() : std::numeric_limits<double>::infinity(),
+		             job.comment);
+}
+
 void PredicateFilter::onNewSolution(const SolutionBase& s) {
 	const auto& props = properties();
 
@@ -84,11 +212,29 @@ void PredicateFilter::onNewSolution(const SolutionBase& s) {
 	// NOLINTNEXTLINE(performance-unnecessary-copy-initialization)
 	std::string comment = s.comment();
 
-	double cost = s.cost();
-	if (!props.get<bool>("ignore_filter") && !props.get<Predicate>("predicate")(s, comment))
-		cost = std::numeric_limits<double>::infinity();
+	if (props.get<bool>("ignore_filter")) {
+		liftSolution(s, s.cost(), comment);
+		return;
+	}
+
+	const uint32_t num_threads = props.get<uint32_t>("num_threads");
+	if (num_threads == 0) {
+		double cost = s.cost();
+		if (!evaluate(s, comment))
+			cost = std::numeric_limits<double>::infinity();
+		liftSolution(s, cost, comment);
+		return;
+	}
 
-	liftSolution(s, cost, comment);
+	if (!async_)
+		async_.reset(new AsyncEvaluation());
+	std::lock_guard<std::mutex> lock(async_->mutex);
+	const TaskExecutorPtr executor = TaskExecutor::current();
+	while (async_->workers.size() < num_threads)
+		async_->workers.push_back(executor->spawn([async = async_.get(), this]() { async->work(*this); }));
+	async_->jobs.push_back(AsyncEvaluation::Job{ &s, comment });
+	async_->queue.push_back(&async_->jobs.back());
+	async_->job_available.notify_one();
 }
 }  // namespace stages
 }  // namespace task_constructor
@@ -0,0 +1,62 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Register the primitive stages with the StageRegistry
+*/
+
+#include <moveit/task_constructor/stage_registry.h>
+#include <moveit/task_constructor/stages.h>
+
+// called by the StageRegistry on its construction
+extern "C" void moveit_task_constructor_register_stages(moveit::task_constructor::StageRegistry* registry) {
+	using namespace moveit::task_constructor::stages;
+	auto& r = *registry;
+	r.add<CurrentState>("moveit_task_constructor/Current State",
+	                    "Use the current state of the robot (when starting planning) as a target.");
+	r.add<FixedState>("moveit_task_constructor/Fixed State", "Spawn a pre-defined scene");
+	r.add<FixedCartesianPoses>("moveit_task_constructor/Fixed Cartesian Poses", "Spawn pre-defined target poses");
+	r.add<GeneratePose>("moveit_task_constructor/Generate Pose", "Sample poses around the target pose");
+	r.add<GenerateGraspPose>("moveit_task_constructor/Generate Grasp Pose", "Sample grasp poses around an object");
+	r.add<GeneratePlacePose>("moveit_task_constructor/Generate Place Pose", "Sample place poses of an object");
+	r.add<GenerateDatabaseGrasps>("moveit_task_constructor/Generate Database Grasps",
+	                              "Spawn grasp poses from a grasp database");
+	r.add<ComputeIK>("moveit_task_constructor/Compute IK", "Wrap a pose generator, computing IK solutions");
+	r.add<Connect>("moveit_task_constructor/Connect", "Connect states by a free-space motion");
+	r.add<MoveTo>("moveit_task_constructor/Move To", "Move to a given goal");
+	r.add<MoveRelative>("moveit_task_constructor/Move Relative", "Move along a given direction");
+	r.add<ModifyPlanningScene>("moveit_task_constructor/Modify Planning Scene",
+	                           "Attach or detach objects, enable or disable collisions");
+	r.add<FixCollisionObjects>("moveit_task_constructor/Fix Collision Objects",
+	                           "Move objects out of collision");
+}
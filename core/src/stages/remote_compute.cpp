@@ -0,0 +1,221 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Offload computation of a stage to remote worker nodes
+*/
+
+#include <moveit/task_constructor/stages/remote_compute.h>
+#include <moveit/task_constructor/stages/fixed_state.h>
+#include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/stage_p.h>
+
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include <ros/console.h>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+RemoteCompute::RemoteCompute(const std::string& name, Stage::pointer&& child) : WrapperBase(name, std::move(child)) {
+	auto& p = properties();
+	p.declare<std::vector<std::string>>("workers", { "compute_stage" }, "names of worker services");
+	p.declare<uint32_t>("max_solutions", 1u, "max number of solutions computed per job (0 = all)");
+}
+
+void RemoteCompute::init(const moveit::core::RobotModelConstPtr& robot_model) {
+	WrapperBase::init(robot_model);
+
+	const auto& workers = properties().get<std::vector<std::string>>("workers");
+	if (workers.empty())
+		throw InitStageException(*this, "no workers specified");
+
+	ros::NodeHandle nh;
+	clients_.clear();
+	for (const auto& worker : workers)
+		clients_.push_back(nh.serviceClient<moveit_task_constructor_msgs::ComputeStage>(worker, true));
+	next_client_ = 0;
+}
+
+namespace {
+inline bool hasJob(const InterfaceConstPtr& interface) {
+	return interface && !interface->empty() && interface->front()->priority().enabled();
+}
+}  // namespace
+
+bool RemoteCompute::canCompute() const {
+	const StagePrivate* child = wrapped()->pimpl();
+	return hasJob(child->starts()) || hasJob(child->ends());
+}
+
+void RemoteCompute::compute() {
+	StagePrivate* child = wrapped()->pimpl();
+	const bool forward = hasJob(child->starts());
+	const InterfacePtr& interface = forward ? child->starts() : child->ends();
+	const InterfaceState& state = *interface->remove(interface->begin()).front();
+
+	moveit_task_constructor_msgs::ComputeStage srv;
+	srv.request.stage = wrapped()->name();
+	srv.request.direction = forward ? srv.request.FORWARD : srv.request.BACKWARD;
+	state.scene()->getPlanningSceneMsg(srv.request.scene);
+	srv.request.max_solutions = properties().get<uint32_t>("max_solutions");
+	for (const auto& pair : wrapped()->properties()) {
+		if (!pair.second.defined())
+			continue;
+		moveit_task_constructor_msgs::Property p;
+		p.name = pair.first;
+		p.type = pair.second.typeName();
+		p.value = pair.second.serialize();
+		srv.request.properties.push_back(p);
+	}
+
+	ros::ServiceClient& client = clients_[next_client_];
+	next_client_ = (next_client_ + 1) % clients_.size();
+	bool success;
+	{
+		ComputeUnlock unlock(*this);  // allow other stages to compute meanwhile
+		success = client.call(srv);
+	}
+
+	auto send = [child, forward, &state](InterfaceState&& new_state, SubTrajectory&& solution) {
+		auto s = std::make_shared<SubTrajectory>(std::move(solution));
+		if (forward)
+			child->sendForward(state, std::move(new_state), s);
+		else
+			child->sendBackward(std::move(new_state), state, s);
+	};
+
+	if (!success) {
+		SubTrajectory failure;
+		failure.markAsFailure("calling worker '" + client.getService() + "' failed");
+		send(InterfaceState(state.scene()->diff()), std::move(failure));
+		return;
+	}
+
+	const auto& robot_model = state.scene()->getRobotModel();
+	for (const auto& msg : srv.response.solutions) {
+		planning_scene::PlanningScenePtr scene = state.scene()->diff(msg.scene_diff);
+		robot_trajectory::RobotTrajectoryPtr trajectory;
+		if (!msg.trajectory.joint_trajectory.points.empty() || !msg.trajectory.multi_dof_joint_trajectory.points.empty()) {
+			trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model, nullptr);
+			// trajectory starts at the input state (forward) or at the new state (backward)
+			trajectory->setRobotTrajectoryMsg(forward ? state.scene()->getCurrentState() : scene->getCurrentState(),
+			                                  msg.trajectory);
+		}
+		SubTrajectory solution(trajectory, msg.info.cost, msg.info.comment);
+		solution.markers() = std::deque<visualization_msgs::Marker>(msg.info.markers.begin(), msg.info.markers.end());
+		send(InterfaceState(scene), std::move(solution));
+	}
+}
+
+void RemoteCompute::onNewSolution(const SolutionBase& s) {
+	liftSolution(s);
+}
+
+RemoteComputeServer::RemoteComputeServer(const moveit::core::RobotModelConstPtr& robot_model,
+                                         const std::string& service_name)
+  : robot_model_(robot_model) {
+	server_ = nh_.advertiseService(service_name, &RemoteComputeServer::compute, this);
+}
+
+void RemoteComputeServer::add(const std::string& stage_name, StageFactory&& factory) {
+	factories_[stage_name] = std::move(factory);
+}
+
+bool RemoteComputeServer::compute(moveit_task_constructor_msgs::ComputeStage::Request& req,
+                                  moveit_task_constructor_msgs::ComputeStage::Response& res) {
+	auto it = factories_.find(req.stage);
+	if (it == factories_.end()) {
+		ROS_ERROR_STREAM_NAMED("RemoteComputeServer", "unknown stage '" << req.stage << "'");
+		return false;
+	}
+
+	auto scene = std::make_shared<planning_scene::PlanningScene>(robot_model_);
+	scene->setPlanningSceneMsg(req.scene);
+
+	Stage::pointer stage = it->second();
+	for (const auto& p : req.properties) {
+		try {
+			boost::any value = p.encoding == p.BINARY ? Property::deserializeBinary(p.type, p.data) :
+			                                            Property::deserialize(p.type, p.value);
+			if (!value.empty())
+				stage->setProperty(p.name, value);
+		} catch (const std::exception& e) {
+			ROS_WARN_STREAM_NAMED("RemoteComputeServer", "failed to set property '" << p.name << "': " << e.what());
+		}
+	}
+	const Stage* computed = stage.get();
+
+	Task task("", false);
+	task.setRobotModel(robot_model_);
+	const bool forward = req.direction == req.FORWARD;
+	if (forward) {
+		task.add(std::make_unique<FixedState>("input", scene));
+		task.add(std::move(stage));
+	} else {
+		task.add(std::move(stage));
+		task.add(std::make_unique<FixedState>("input", scene));
+	}
+
+	try {
+		task.plan(req.max_solutions);
+	} catch (const std::exception& e) {
+		ROS_ERROR_STREAM_NAMED("RemoteComputeServer", "computing '" << req.stage << "' failed: " << e.what());
+		return false;
+	}
+
+	auto fill = [&res, forward](const SolutionBase& s) {
+		const auto* sub = dynamic_cast<const SubTrajectory*>(&s);
+		if (!sub)
+			return;  // only primitive stages are supported
+		res.solutions.emplace_back();
+		auto& msg = res.solutions.back();
+		msg.info.cost = s.cost();
+		msg.info.comment = s.comment();
+		msg.info.markers.assign(s.markers().begin(), s.markers().end());
+		if (sub->trajectory())
+			sub->trajectory()->getRobotTrajectoryMsg(msg.trajectory);
+		// new state w.r.t. input scene
+		(forward ? s.end() : s.start())->scene()->getPlanningSceneDiffMsg(msg.scene_diff);
+	};
+	for (const auto& s : computed->solutions())
+		fill(*s);
+	for (const auto& s : computed->failures())
+		fill(*s);
+	return true;
+}
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
@@ -76,9 +76,9 @@ void SimpleGraspBase::setup(std::unique_ptr<Stage>&& generator, bool forward) {
 		PropertyMap& p = ik->properties();
 		p.declare<std::string>("object");
 		p.configureInitFrom(Stage::INTERFACE, { "target_pose" });  // derived from child's solution
-		p.configureInitFrom(Stage::PARENT, { "max_ik_solutions", "timeout", "object" });  // derived from parent
+		p.configureInitFrom(Stage::PARENT, { "max_ik_solutions", "timeout", "object", "ik_filter" });  // from parent
 		p.configureInitFrom(Stage::PARENT | Stage::INTERFACE, { "eef", "ik_frame" });  // derive from both
-		p.exposeTo(properties(), { "max_ik_solutions", "timeout", "ik_frame" });
+		p.exposeTo(properties(), { "max_ik_solutions", "timeout", "ik_frame", "ik_filter" });
 		insert(std::unique_ptr<ComputeIK>(ik), 0);  // ComputeIK always goes upfront
 	}
 	{
@@ -0,0 +1,231 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Persist stage statistics across planning processes
+*/
+
+#include <moveit/task_constructor/statistics_record.h>
+#include <moveit/task_constructor/container.h>
+#include <moveit/task_constructor/stage_p.h>
+#include <moveit_task_constructor_msgs/StatisticsRecord.h>
+#include <ros/serialization.h>
+#include <ros/console.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+const std::string FILE_MAGIC = "MTC_STATISTICS_RECORD_1";
+
+void fillDecayedHistogram(const LatencyHistogram& h, moveit_task_constructor_msgs::LatencyHistogram& msg) {
+	LatencyHistogram decayed = h;
+	decayed.decay(StatisticsRecord::MAX_SAMPLES);
+	fillHistogram(decayed, msg);
+}
+}  // namespace
+
+constexpr size_t StatisticsRecord::MAX_SAMPLES;
+
+void fillHistogram(const LatencyHistogram& h, moveit_task_constructor_msgs::LatencyHistogram& msg) {
+	msg.min_value = LatencyHistogram::MIN_VALUE;
+	msg.buckets_per_octave = LatencyHistogram::BUCKETS_PER_OCTAVE;
+	msg.bucket.clear();
+	msg.count.clear();
+	for (uint32_t i = 0; i != h.buckets().size(); ++i) {
+		if (h.buckets()[i] == 0)
+			continue;
+		msg.bucket.push_back(i);
+		msg.count.push_back(h.buckets()[i]);
+	}
+	msg.total_count = h.count();
+	msg.sum = h.sum();
+	msg.min = h.min();
+	msg.max = h.max();
+}
+
+bool restoreHistogram(const moveit_task_constructor_msgs::LatencyHistogram& msg, LatencyHistogram& h) {
+	if (msg.min_value != LatencyHistogram::MIN_VALUE || msg.buckets_per_octave != LatencyHistogram::BUCKETS_PER_OCTAVE ||
+	    msg.bucket.size() != msg.count.size())
+		return false;
+	std::array<uint32_t, LatencyHistogram::NUM_BUCKETS> buckets;
+	buckets.fill(0);
+	for (size_t i = 0; i != msg.bucket.size(); ++i) {
+		if (msg.bucket[i] >= buckets.size())
+			return false;
+		buckets[msg.bucket[i]] += msg.count[i];
+	}
+	h.assign(buckets, msg.sum, msg.min, msg.max);
+	return true;
+}
+
+std::string StatisticsRecord::stagePath(const Stage& stage) {
+	std::string path = stage.name();
+	for (const Stage* s = stage.parent(); s && s->parent(); s = s->parent())
+		path = s->name() + '/' + path;
+	return path;
+}
+
+void StatisticsRecord::collect(const StagePrivate& stage) {
+	const Stage& s = *stage.me();
+	const std::string path = stagePath(s);
+	moveit_task_constructor_msgs::StageStatisticsRecord& msg = stages_[path];
+	msg.path = path;
+	fillDecayedHistogram(stage.compute_latency_, msg.compute_latency);
+	fillDecayedHistogram(stage.success_latency_, msg.success_latency);
+	fillDecayedHistogram(stage.solution_latency_, msg.solution_latency);
+
+	msg.order_classes.clear();
+	msg.order_children.clear();
+	msg.order_attempts.clear();
+	msg.order_successes.clear();
+	msg.order_compute_times.clear();
+	if (const auto* fallbacks = dynamic_cast<const Fallbacks*>(&s)) {
+		for (const auto& state_class : fallbacks->orderStatistics())
+			for (const auto& child : state_class.second) {
+				const auto& stats = child.second;
+				// keep success rate and mean compute time
+				const double factor = stats.attempts > MAX_SAMPLES ? double(MAX_SAMPLES) / stats.attempts : 1.0;
+				msg.order_classes.push_back(state_class.first);
+				msg.order_children.push_back(child.first);
+				msg.order_attempts.push_back(std::llround(stats.attempts * factor));
+				msg.order_successes.push_back(std::llround(stats.successes * factor));
+				msg.order_compute_times.push_back(stats.compute_time * factor);
+			}
+	}
+}
+
+bool StatisticsRecord::restore(StagePrivate& stage) const {
+	Stage& s = *stage.me();
+	auto it = stages_.find(stagePath(s));
+	if (it == stages_.end())
+		return false;
+	const moveit_task_constructor_msgs::StageStatisticsRecord& msg = it->second;
+
+	bool restored = false;
+	if (stage.compute_latency_.count() == 0 && stage.success_latency_.count() == 0 &&
+	    stage.solution_latency_.count() == 0) {
+		LatencyHistogram compute, success, solution;
+		if (restoreHistogram(msg.compute_latency, compute) && restoreHistogram(msg.success_latency, success) &&
+		    restoreHistogram(msg.solution_latency, solution)) {
+			stage.compute_latency_ = compute;
+			stage.success_latency_ = success;
+			stage.solution_latency_ = solution;
+			restored = true;
+		} else
+			ROS_WARN_STREAM_NAMED("StatisticsRecord", "Incompatible latency histograms of stage '" << msg.path << "'");
+	}
+
+	auto* fallbacks = dynamic_cast<Fallbacks*>(&s);
+	const size_t num_orders = msg.order_classes.size();
+	if (fallbacks && fallbacks->orderStatistics().empty() && num_orders > 0 &&
+	    msg.order_children.size() == num_orders && msg.order_attempts.size() == num_orders &&
+	    msg.order_successes.size() == num_orders && msg.order_compute_times.size() == num_orders) {
+		Fallbacks::OrderStatistics order;
+		for (size_t i = 0; i != num_orders; ++i) {
+			Fallbacks::ChildStatistics& child = order[msg.order_classes[i]][msg.order_children[i]];
+			child.attempts = msg.order_attempts[i];
+			child.successes = msg.order_successes[i];
+			child.compute_time = msg.order_compute_times[i];
+		}
+		fallbacks->setOrderStatistics(order);
+		restored = true;
+	}
+	return restored;
+}
+
+const moveit_task_constructor_msgs::StageStatisticsRecord* StatisticsRecord::find(const std::string& path) const {
+	auto it = stages_.find(path);
+	return it == stages_.end() ? nullptr : &it->second;
+}
+
+bool StatisticsRecord::save(const std::string& file) const {
+	moveit_task_constructor_msgs::StatisticsRecord msg;
+	for (const auto& stage : stages_)
+		msg.stages.push_back(stage.second);
+
+	std::string bytes(ros::serialization::serializationLength(msg), '\0');
+	ros::serialization::OStream stream(reinterpret_cast<uint8_t*>(&bytes[0]), bytes.size());
+	ros::serialization::serialize(stream, msg);
+
+	// write a temporary file first: concurrent readers, or a crash, never see a partially written file
+	const std::string tmp = file + ".tmp" + std::to_string(getpid());
+	{
+		std::ofstream os(tmp, std::ios::binary);
+		os << FILE_MAGIC;
+		os.write(bytes.data(), bytes.size());
+		os.close();
+		if (!os) {
+			ROS_ERROR_STREAM_NAMED("StatisticsRecord", "Failed to write statistics to '" << tmp << "'");
+			std::remove(tmp.c_str());
+			return false;
+		}
+	}
+	if (std::rename(tmp.c_str(), file.c_str()) != 0) {
+		ROS_ERROR_STREAM_NAMED("StatisticsRecord", "Failed to replace '" << file << "'");
+		std::remove(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+StatisticsRecordPtr StatisticsRecord::load(const std::string& file) {
+	std::ifstream is(file, std::ios::binary);
+	std::string bytes((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+	if (bytes.compare(0, FILE_MAGIC.size(), FILE_MAGIC) != 0) {
+		ROS_ERROR_STREAM_NAMED("StatisticsRecord", "'" << file << "' is not a statistics record file");
+		return nullptr;
+	}
+
+	moveit_task_constructor_msgs::StatisticsRecord msg;
+	try {
+		ros::serialization::IStream stream(reinterpret_cast<uint8_t*>(&bytes[FILE_MAGIC.size()]),
+		                                   bytes.size() - FILE_MAGIC.size());
+		ros::serialization::deserialize(stream, msg);
+	} catch (const ros::Exception& e) {
+		ROS_ERROR_STREAM_NAMED("StatisticsRecord", "Corrupt statistics record file '" << file << "': " << e.what());
+		return nullptr;
+	}
+	auto record = std::make_shared<StatisticsRecord>();
+	for (auto& stage : msg.stages)
+		record->stages_[stage.path] = std::move(stage);
+	return record;
+}
+}  // namespace task_constructor
+}  // namespace moveit
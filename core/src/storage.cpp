@@ -38,10 +38,16 @@
 #include <moveit/task_constructor/stage_p.h>
 #include <moveit/task_constructor/storage.h>
 #include <moveit/task_constructor/introspection.h>
+#include <moveit/task_constructor/moveit_compat.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <ros/serialization.h>
 #include <assert.h>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <mutex>
 
 namespace moveit {
 namespace task_constructor {
@@ -69,17 +75,155 @@ InterfaceState::InterfaceState(const planning_scene::PlanningSceneConstPtr& ps,
 InterfaceState::InterfaceState(const InterfaceState& other)
   : scene_(other.scene_), properties_(other.properties_), priority_(other.priority_) {}
 
-bool InterfaceState::Priority::operator<(const InterfaceState::Priority& other) const {
-	// first order by status if that differs
-	if (status() != other.status())
-		return status() < other.status();
+PropertyMap& InterfaceState::properties() {
+	if (!properties_)
+		properties_ = std::make_shared<PropertyMap>();
+	else if (properties_.use_count() > 1)  // detach from copies
+		properties_ = std::make_shared<PropertyMap>(*properties_);
+	return *properties_;
+}
+
+const PropertyMap& InterfaceState::emptyProperties() {
+	static const PropertyMap empty;
+	return empty;
+}
+
+void InterfaceState::compactScene(size_t max_depth) {
+	if (max_depth == 0)
+		return;
+	size_t depth = 0;
+	for (auto parent = scene_->getParent(); parent; parent = parent->getParent())
+		if (++depth > max_depth)
+			break;
+	if (depth <= max_depth)
+		return;
+
+	planning_scene::PlanningScenePtr flat = scene_->diff();
+	flat->decoupleParent();  // copies parent's data, world objects are shared copy-on-write
+	scene_ = flat;
+}
+
+namespace {
+// scenes are only considered equal if they share their parent, root scenes are only equal to themselves
+const planning_scene::PlanningScene* sceneBase(const planning_scene::PlanningScene& scene) {
+	return scene.getParent() ? scene.getParent().get() : &scene;
+}
+
+// serialized diff of the scene w.r.t. its parent, excluding joint positions (but including attached bodies)
+std::string sceneDiffContent(const planning_scene::PlanningScene& scene) {
+	moveit_msgs::PlanningScene msg;
+	scene.getPlanningSceneDiffMsg(msg);
+	msg.robot_state.joint_state = sensor_msgs::JointState();
+	msg.robot_state.multi_dof_joint_state = sensor_msgs::MultiDOFJointState();
+	std::string buffer(ros::serialization::serializationLength(msg), '\0');
+	ros::serialization::OStream stream(reinterpret_cast<uint8_t*>(&buffer[0]), buffer.size());
+	ros::serialization::serialize(stream, msg);
+	return buffer;
+}
+
+int64_t quantize(double value, double resolution) {
+	return std::llround(value / resolution);
+}
+
+void hashCombine(size_t& seed, size_t value) {
+	seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+void hashPosition(size_t& seed, const Eigen::Vector3d& position, double resolution) {
+	for (int i = 0; i != 3; ++i)
+		hashCombine(seed, std::hash<int64_t>()(quantize(position[i], resolution)));
+}
 
-	// then by depth if that differs
-	if (depth() != other.depth())
-		return depth() > other.depth();  // larger depth = smaller prio!
+/** cheap hash of the scene's objects, without serializing the scene diff
+ *
+ * Equal diffs w.r.t. the same parent yield equal hashes. Other modifications, e.g. of the ACM,
+ * are only considered by sameContent().
+ */
+size_t sceneHash(const planning_scene::PlanningScene& scene, double resolution) {
+	size_t hash = std::hash<const void*>()(sceneBase(scene));
+	std::vector<const moveit::core::AttachedBody*> attached;
+	scene.getCurrentState().getAttachedBodies(attached);
+	for (const moveit::core::AttachedBody* body : attached) {
+		hashCombine(hash, std::hash<std::string>()(body->getName()));
+		hashCombine(hash, std::hash<std::string>()(body->getAttachedLinkName()));
+	}
+	for (const auto& object : *scene.getWorld()) {
+		hashCombine(hash, std::hash<std::string>()(object.first));
+#if MOVEIT_HAS_OBJECT_POSE
+		hashPosition(hash, object.second->pose_.translation(), resolution);
+#else
+		if (!object.second->shape_poses_.empty())
+			hashPosition(hash, object.second->shape_poses_.front().translation(), resolution);
+#endif
+	}
+	return hash;
+}
+
+// serialized property value (prefixed by its type), false if it cannot be serialized
+bool propertyContent(const boost::any& value, std::string& content) {
+	content = value.type().name();
+	if (value.empty())
+		return true;
+	std::vector<uint8_t> data;
+	if (Property::serializeBinary(value, data)) {
+		content.append(data.begin(), data.end());
+		return true;
+	}
+	const std::string text = Property::serialize(value);
+	content += text;
+	return !text.empty();
+}
+
+size_t propertiesHash(const PropertyMap& properties) {
+	size_t hash = 0;
+	std::string content;
+	for (const auto& p : properties) {
+		hashCombine(hash, std::hash<std::string>()(p.first));
+		if (propertyContent(p.second.value(), content))
+			hashCombine(hash, std::hash<std::string>()(content));
+	}
+	return hash;
+}
 
-	// finally by cost
-	return cost() < other.cost();
+// properties with unserializable values are only equal if they are shared (or copied unmodified)
+bool sameProperties(const PropertyMap& a, const PropertyMap& b) {
+	if (&a == &b || a.version() == b.version())
+		return true;
+	auto it = a.begin(), other = b.begin();
+	std::string content, other_content;
+	for (; it != a.end() && other != b.end(); ++it, ++other) {
+		if (it->first != other->first || !propertyContent(it->second.value(), content) ||
+		    !propertyContent(other->second.value(), other_content) || content != other_content)
+			return false;
+	}
+	return it == a.end() && other == b.end();
+}
+
+std::atomic<bool> count_priority_updates{ false };
+std::atomic<size_t> priority_updates{ 0 };
+std::atomic<bool> interface_metrics{ false };
+}  // namespace
+
+size_t InterfaceState::contentHash(double resolution) const {
+	const moveit::core::RobotState& state = scene_->getCurrentState();
+	size_t hash = sceneHash(*scene_, resolution);
+	hashCombine(hash, propertiesHash(properties()));
+	for (size_t i = 0; i != state.getVariableCount(); ++i)
+		hashCombine(hash, std::hash<int64_t>()(quantize(state.getVariablePosition(i), resolution)));
+	return hash;
+}
+
+bool InterfaceState::sameContent(const InterfaceState& other, double resolution) const {
+	const moveit::core::RobotState& a = scene_->getCurrentState();
+	const moveit::core::RobotState& b = other.scene_->getCurrentState();
+	if (sceneBase(*scene_) != sceneBase(*other.scene_) || a.getRobotModel() != b.getRobotModel())
+		return false;
+	for (size_t i = 0; i != a.getVariableCount(); ++i)
+		if (quantize(a.getVariablePosition(i), resolution) != quantize(b.getVariablePosition(i), resolution))
+			return false;
+	if (!sameProperties(properties(), other.properties()))
+		return false;
+	return scene_ == other.scene_ || sceneDiffContent(*scene_) == sceneDiffContent(*other.scene_);
 }
 
 void InterfaceState::updatePriority(const InterfaceState::Priority& priority) {
@@ -99,8 +243,7 @@ void InterfaceState::updateStatus(Status status) {
 
 Interface::Interface(const Interface::NotifyFunction& notify) : notify_(notify) {}
 
-// Announce a new InterfaceState
-void Interface::add(InterfaceState& state) {
+Interface::iterator Interface::adopt(InterfaceState& state, container_type& container) {
 	// require valid scene
 	assert(state.scene());
 	// incoming and outgoing must not contain elements both
@@ -112,10 +255,16 @@ void Interface::add(InterfaceState& state) {
 	assert(state.owner_ == nullptr);
 
 	// move state to a list node
-	std::list<InterfaceState*> container;
 	Interface::iterator it = container.insert(container.end(), &state);
 	it->owner_ = this;
 
+	if (metricsEnabled()) {
+		const Clock::time_point now = Clock::now();
+		if (num_added_++ == 0)
+			first_added_ = now;
+		pending_.emplace(&state, now);
+	}
+
 	// if either incoming or outgoing is defined, derive priority from there
 	if (!state.incomingTrajectories().empty())
 		it->priority_ = InterfaceState::Priority(1, state.incomingTrajectories().front()->cost());
@@ -125,7 +274,14 @@ void Interface::add(InterfaceState& state) {
 		assert(it->priority_.enabled());
 		assert(it->priority_.depth() >= 1u);
 	}
+	count(it->priority_, 1);
+	return it;
+}
 
+// Announce a new InterfaceState
+void Interface::add(InterfaceState& state) {
+	container_type container;
+	Interface::iterator it = adopt(state, container);
 	// move list node into interface's state list (sorted by priority)
 	moveFrom(it, container);
 	// and finally call notify callback
@@ -133,23 +289,73 @@ void Interface::add(InterfaceState& state) {
 		notify_(it, UpdateFlags());
 }
 
+void Interface::add(const std::vector<InterfaceState*>& states) {
+	container_type container;
+	std::vector<iterator> added;
+	added.reserve(states.size());
+	for (InterfaceState* state : states)
+		added.push_back(adopt(*state, container));
+	// merging keeps list nodes, and thus iterators, valid
+	merge(container);
+	if (notify_)
+		for (iterator it : added)
+			notify_(it, UpdateFlags());
+}
+
 Interface::container_type Interface::remove(iterator it) {
 	container_type result;
 	moveTo(it, result, result.end());
 	it->owner_ = nullptr;
+	pending_.erase(&*it);  // a removed state is not pending anymore
+	count(it->priority(), -1);
 	return result;
 }
 
+void Interface::clear() {
+	base_type::clear();
+	pending_.clear();
+	num_added_ = num_expanded_ = 0;
+	total_age_ = max_age_ = 0.0;
+	num_enabled_ = num_pruned_ = 0;
+	max_depth_ = 0;
+}
+
+void Interface::count(const InterfaceState::Priority& priority, int sign) {
+	if (priority.enabled())
+		num_enabled_ += sign;
+	if (priority.status() == InterfaceState::Status::PRUNED)
+		num_pruned_ += sign;
+	if (sign > 0)
+		max_depth_ = std::max(max_depth_, priority.depth());
+}
+
 void Interface::updatePriority(InterfaceState* state, const InterfaceState::Priority& priority) {
 	const auto old_prio = state->priority();
 	if (priority == old_prio)
 		return;  // nothing to do
+	if (count_priority_updates.load(std::memory_order_relaxed))
+		priority_updates.fetch_add(1, std::memory_order_relaxed);
+	count(old_prio, -1);
+	count(priority, 1);
+
+	if (BatchUpdate::current_) {
+		if (old_prio.status() == priority.status()) {  // defer re-sorting and notification
+			BatchUpdate::current_->record(this, state, notifyEnabled());
+			state->priority_ = priority;
+			return;
+		}
+		// state is handled immediately, but update() requires all other states to be sorted
+		if (BatchUpdate::current_->forget(this, state))
+			sort();
+	}
 
-	auto it = std::find(begin(), end(), state);  // find iterator to state
+	auto it = find(state);  // binary search, valid as long as the state is at its sorted position
+	if (it == end())  // state was deferred by a BatchUpdate and is not sorted yet
+		it = std::find(begin(), end(), state);
 	assert(it != end());  // state should be part of this interface
 
-	state->priority_ = priority;  // update priority
-	update(it);  // update position in ordered list
+	// update priority and position in ordered list
+	update(it, [&priority](InterfaceState* s) { s->priority_ = priority; });
 
 	if (notify_) {
 		UpdateFlags updated(Update::ALL);
@@ -160,6 +366,112 @@ void Interface::updatePriority(InterfaceState* state, const InterfaceState::Prio
 	}
 }
 
+void Interface::processBatch(const BatchUpdate::Changes& changes) {
+	sort();
+
+	// collect notifications first: callbacks might modify the interface
+	std::vector<std::pair<iterator, UpdateFlags>> notifications;
+	for (iterator it = begin(), end = this->end(); it != end; ++it) {
+		auto change = changes.find(&*it);
+		if (change == changes.end() || !change->second.notify || change->second.old_priority == it->priority())
+			continue;
+		UpdateFlags updated(Update::ALL);
+		if (change->second.old_priority.status() == it->priority().status())
+			updated &= ~STATUS;
+		notifications.emplace_back(it, updated);
+	}
+	if (!notify_)
+		return;
+	for (const auto& n : notifications)
+		notify_(n.first, n.second);
+}
+
+void Interface::setCountPriorityUpdates(bool enabled) {
+	count_priority_updates = enabled;
+}
+
+size_t Interface::numPriorityUpdates() {
+	return priority_updates.load(std::memory_order_relaxed);
+}
+
+void Interface::setMetricsEnabled(bool enabled) {
+	interface_metrics = enabled;
+}
+
+bool Interface::metricsEnabled() {
+	return interface_metrics;
+}
+
+void Interface::noteExpanded(const InterfaceState& state) {
+	auto it = pending_.find(&state);
+	if (it == pending_.end())
+		return;  // already expanded or added while metrics were disabled
+	const double age = std::chrono::duration<double>(Clock::now() - it->second).count();
+	pending_.erase(it);
+	++num_expanded_;
+	total_age_ += age;
+	max_age_ = std::max(max_age_, age);
+}
+
+Interface::Metrics Interface::metrics() const {
+	Metrics m;
+	m.states = size();
+	m.enabled = num_enabled_;
+	m.pruned = num_pruned_;
+	m.max_depth = max_depth_;
+	m.pending = pending_.size();
+	m.added = num_added_;
+	m.expanded = num_expanded_;
+	if (num_expanded_ > 0) {
+		m.mean_age = total_age_ / num_expanded_;
+		m.max_age = max_age_;
+		const double elapsed = std::chrono::duration<double>(Clock::now() - first_added_).count();
+		m.expansion_rate = elapsed > 0.0 ? num_expanded_ / elapsed : 0.0;
+	}
+	return m;
+}
+
+thread_local Interface::BatchUpdate* Interface::BatchUpdate::current_ = nullptr;
+
+Interface::BatchUpdate::BatchUpdate() : active_(current_ == nullptr) {
+	if (active_)
+		current_ = this;
+}
+
+Interface::BatchUpdate::~BatchUpdate() {
+	if (!active_)
+		return;
+	// notifications might cause further updates, which are collected again
+	while (!interfaces_.empty()) {
+		std::vector<Interface*> interfaces;
+		std::unordered_map<Interface*, Changes> changes;
+		interfaces.swap(interfaces_);
+		changes.swap(changes_);
+		for (Interface* interface : interfaces)
+			interface->processBatch(changes[interface]);
+	}
+	current_ = nullptr;
+}
+
+void Interface::BatchUpdate::record(Interface* interface, InterfaceState* state, bool notify) {
+	auto it = changes_.find(interface);
+	if (it == changes_.end()) {
+		interfaces_.push_back(interface);
+		it = changes_.emplace(interface, Changes()).first;
+	}
+	auto inserted = it->second.emplace(state, Change{ state->priority(), notify });
+	if (!inserted.second)
+		inserted.first->second.notify |= notify;
+}
+
+bool Interface::BatchUpdate::forget(Interface* interface, InterfaceState* state) {
+	auto it = changes_.find(interface);
+	if (it == changes_.end())
+		return false;
+	it->second.erase(state);
+	return !it->second.empty();
+}
+
 std::ostream& operator<<(std::ostream& os, const Interface& interface) {
 	if (interface.empty())
 		os << "---";
@@ -184,6 +496,13 @@ std::ostream& operator<<(std::ostream& os, Interface::Direction dir) {
 	return os;
 }
 
+void SolutionBase::unregisterFromStates() {
+	if (start_)
+		const_cast<InterfaceState*>(start_)->removeOutgoing(this);
+	if (end_)
+		const_cast<InterfaceState*>(end_)->removeIncoming(this);
+}
+
 void SolutionBase::setCreator(Stage* creator) {
 	assert(creator_ == nullptr || creator_ == creator);  // creator must only set once
 	creator_ = creator;
@@ -193,17 +512,145 @@ void SolutionBase::setCost(double cost) {
 	cost_ = cost;
 }
 
+namespace {
+void prependFailure(std::string& comment, const std::string& msg) {
+	if (!msg.empty())
+		comment = comment.empty() ? msg : msg + "\n" + comment;
+}
+}  // namespace
+
 void SolutionBase::markAsFailure(const std::string& msg) {
 	setCost(std::numeric_limits<double>::infinity());
-	if (!msg.empty()) {
-		std::stringstream ss;
-		ss << msg;
-		if (!comment().empty())
-			ss << "\n" << comment();
-		setComment(ss.str());
+	if (comment_formatters_.empty())
+		prependFailure(comment_, msg);
+	else if (!msg.empty())
+		formatComment([msg](std::string& comment) { prependFailure(comment, msg); });
+}
+
+void SolutionBase::markAsFailure(std::function<std::string()> msg) {
+	setCost(std::numeric_limits<double>::infinity());
+	if (msg)
+		formatComment([msg = std::move(msg)](std::string& comment) { prependFailure(comment, msg()); });
+}
+
+double SolutionBase::memoizedCost(const CostTerm& cost, std::string& comment) const {
+	// costs are computed when storing solutions, i.e. while holding the task's planning lock
+	auto it = std::find_if(memoized_costs_.begin(), memoized_costs_.end(),
+	                       [&cost](const MemoizedCost& m) { return m.term == &cost; });
+	if (it == memoized_costs_.end()) {
+		std::string term_comment;
+		double value = computeCost(cost, term_comment);
+		it = memoized_costs_.insert(memoized_costs_.end(), MemoizedCost{ &cost, value, std::move(term_comment) });
+	}
+	comment.append(it->comment);
+	return it->cost;
+}
+
+namespace {
+std::atomic<bool> markers_enabled{ true };
+// serializes the generation of deferred markers, which might be triggered from multiple threads
+std::mutex marker_generation_mutex;
+}  // namespace
+
+void SolutionBase::setMarkersEnabled(bool enabled) {
+	markers_enabled = enabled;
+}
+
+bool SolutionBase::markersEnabled() {
+	return markers_enabled;
+}
+
+const std::string& SolutionBase::comment() const {
+	formatComments();
+	return comment_;
+}
+
+std::string SolutionBase::failureReason() const {
+	if (!failure_reason_.empty())
+		return failure_reason_;
+
+	// first line of the comment up to a colon, e.g. "invalid goal type"
+	std::string reason;
+	{
+		std::lock_guard<std::mutex> lock(comment_lock_.mutex);
+		reason = comment_.substr(0, comment_.find_first_of(":\n"));
+	}
+	const size_t first = reason.find_first_not_of(' ');
+	if (first == std::string::npos)
+		return "unknown";
+	return reason.substr(first, reason.find_last_not_of(' ') - first + 1);
+}
+
+bool SolutionBase::hasComment() const {
+	std::lock_guard<std::mutex> lock(comment_lock_.mutex);
+	return !comment_.empty() || !comment_formatters_.empty();
+}
+
+void SolutionBase::setComment(const std::string& comment) {
+	std::lock_guard<std::mutex> lock(comment_lock_.mutex);
+	comment_formatters_.clear();
+	comment_ = comment;
+}
+
+void SolutionBase::formatComment(CommentFormatter formatter) {
+	if (!formatter)
+		return;
+	std::lock_guard<std::mutex> lock(comment_lock_.mutex);
+	comment_formatters_.push_back(std::move(formatter));
+}
+
+void SolutionBase::formatComments() const {
+	std::lock_guard<std::mutex> lock(comment_lock_.mutex);
+	for (const CommentFormatter& formatter : comment_formatters_)
+		formatter(comment_);
+	comment_formatters_.clear();
+}
+
+void SolutionBase::addMarkers(MarkerGenerator generator) {
+	if (generator && markersEnabled())
+		marker_generators_.push_back(std::move(generator));
+}
+
+std::deque<visualization_msgs::Marker> SolutionBase::dropMarkers() const {
+	std::lock_guard<std::mutex> lock(marker_generation_mutex);
+	marker_generators_.clear();
+	std::deque<visualization_msgs::Marker> markers;
+	markers.swap(markers_);
+	return markers;
+}
+
+void SolutionBase::generateMarkers() const {
+	std::lock_guard<std::mutex> lock(marker_generation_mutex);
+	if (marker_generators_.empty())
+		return;
+	const size_t num_markers = markers_.size();
+	for (const MarkerGenerator& generator : marker_generators_)
+		generator(markers_);
+	marker_generators_.clear();
+
+	if (creator_ && Stage::memoryAccounting()) {
+		size_t bytes = 0;
+		for (auto it = markers_.begin() + num_markers; it != markers_.end(); ++it)
+			bytes += markerMemory(*it);
+		creator_->pimpl()->accountMarkers(bytes);
 	}
 }
 
+size_t markerMemory(const visualization_msgs::Marker& m) {
+	return sizeof(m) + m.points.size() * sizeof(geometry_msgs::Point) + m.colors.size() * sizeof(std_msgs::ColorRGBA) +
+	       m.text.size() + m.mesh_resource.size() + m.ns.size() + m.header.frame_id.size();
+}
+
+std::deque<visualization_msgs::Marker>& SolutionBase::markers() {
+	generateMarkers();
+	return markers_;
+}
+
+const std::deque<visualization_msgs::Marker>& SolutionBase::markers() const {
+	generateMarkers();
+	return markers_;
+}
+
 void SolutionBase::fillInfo(moveit_task_constructor_msgs::SolutionInfo& info, Introspection* introspection) const {
 	info.id = introspection ? introspection->solutionId(*this) : 0;
 	info.cost = this->cost();
@@ -211,20 +658,107 @@ void SolutionBase::fillInfo(moveit_task_constructor_msgs::SolutionInfo& info, In
 	const Introspection* ci = introspection;
 	info.stage_id = ci ? ci->stageId(this->creator()) : 0;
 
+	if (!markersEnabled())
+		return;
 	const auto& markers = this->markers();
 	info.markers.resize(markers.size());
 	std::copy(markers.begin(), markers.end(), info.markers.begin());
 }
 
 void SubTrajectory::fillMessage(moveit_task_constructor_msgs::Solution& msg, Introspection* introspection) const {
-	msg.sub_trajectory.emplace_back();
-	moveit_task_constructor_msgs::SubTrajectory& t = msg.sub_trajectory.back();
-	SolutionBase::fillInfo(t.info, introspection);
+	// conversion is expensive: cache the result, as the same solution is published repeatedly
+	auto cache = std::atomic_load(&msg_cache_);
+	const planning_scene::PlanningSceneConstPtr& end_scene = this->end()->scene();
+	if (!cache || cache->end_scene.lock() != end_scene) {
+		auto converted = std::make_shared<MessageCache>();
+		if (auto trajectory = this->trajectory()) {
+			// deferred time parameterization only affects the published trajectory
+			robot_trajectory::RobotTrajectoryPtr timed = timedTrajectory();
+			if (timed)
+				timed->getRobotTrajectoryMsg(converted->msg.trajectory);
+			else if (timeParameterizationPending()) {
+				ROS_ERROR_NAMED("SubTrajectory", "Deferred time parameterization failed");
+				converted->timing_failed = true;  // never publish the estimated timing
+			} else
+				trajectory->getRobotTrajectoryMsg(converted->msg.trajectory);
+		}
+		end_scene->getPlanningSceneDiffMsg(converted->msg.scene_diff);
+		converted->end_scene = end_scene;
+		cache = converted;
+		std::atomic_store(&msg_cache_, cache);  // concurrent conversions yield the same result
+	}
+
+	msg.sub_trajectory.push_back(cache->msg);
+	auto& info = msg.sub_trajectory.back().info;
+	SolutionBase::fillInfo(info, introspection);
+	if (cache->timing_failed) {
+		info.cost = std::numeric_limits<double>::infinity();
+		info.comment = "time parameterization failed" + (info.comment.empty() ? "" : "\n" + info.comment);
+	}
+}
+
+robot_trajectory::RobotTrajectoryPtr SubTrajectory::timedTrajectory() const {
+	auto trajectory = this->trajectory();
+	if (!trajectory || !pending_timing_)
+		return nullptr;
+	auto timed = std::make_shared<robot_trajectory::RobotTrajectory>(*trajectory, true);
+	return pending_timing_(*timed) ? timed : nullptr;
+}
+
+robot_trajectory::RobotTrajectoryConstPtr SubTrajectory::trajectory() const {
+	if (auto trajectory = std::atomic_load(&trajectory_))
+		return trajectory;
+	auto compressed = std::atomic_load(&compressed_);
+	return compressed ? compressed->decompress() : nullptr;
+}
+
+size_t SubTrajectory::waypointCount() const {
+	if (auto trajectory = std::atomic_load(&trajectory_))
+		return trajectory->getWayPointCount();
+	auto compressed = std::atomic_load(&compressed_);
+	return compressed ? compressed->waypointCount() : 0;
+}
 
-	if (trajectory())
-		trajectory()->getRobotTrajectoryMsg(t.trajectory);
+bool SubTrajectory::compress(double tolerance) {
+	auto trajectory = std::atomic_load(&trajectory_);
+	if (!trajectory)
+		return false;
+	auto compressed = CompressedTrajectory::compress(*trajectory, tolerance);
+	if (!compressed)
+		return false;
+	// publish the compressed representation first: concurrent readers always find one of both
+	std::atomic_store(&compressed_, compressed);
+	std::atomic_store(&trajectory_, robot_trajectory::RobotTrajectoryConstPtr());
+	dropMessageCache();
+	shared_data_.clear();
+	return true;
+}
 
-	this->end()->scene()->getPlanningSceneDiffMsg(t.scene_diff);
+std::shared_ptr<const Eigen::Matrix3Xd> SubTrajectory::framePositions(const std::string& frame) const {
+	auto trajectory = this->trajectory();
+	if (!trajectory)
+		return nullptr;
+	return sharedData<Eigen::Matrix3Xd>("frame_positions/" + frame, [&trajectory, &frame]() {
+		auto positions = std::make_shared<Eigen::Matrix3Xd>();
+		if (!utils::computeFramePositions(*trajectory, frame, *positions))
+			positions.reset();
+		return positions;
+	});
+}
+
+std::shared_ptr<const Eigen::MatrixXd> SubTrajectory::variablePositions() const {
+	auto trajectory = this->trajectory();
+	if (!trajectory)
+		return nullptr;
+	return sharedData<Eigen::MatrixXd>("variable_positions", [&trajectory]() {
+		const robot_trajectory::RobotTrajectory& traj = *trajectory;
+		auto positions = std::make_shared<Eigen::MatrixXd>(traj.getRobotModel()->getVariableCount(),
+		                                                     traj.getWayPointCount());
+		for (size_t i = 0; i < traj.getWayPointCount(); ++i)
+			positions->col(i) = Eigen::Map<const Eigen::VectorXd>(traj.getWayPoint(i).getVariablePositions(),
+			                                                      positions->rows());
+		return positions;
+	});
 }
 
 double SubTrajectory::computeCost(const CostTerm& f, std::string& comment) const {
@@ -233,6 +767,40 @@ double SubTrajectory::computeCost(const CostTerm& f, std::string& comment) const
 
 void SolutionSequence::push_back(const SolutionBase& solution) {
 	subsolutions_.push_back(&solution);
+	std::atomic_store(&flattened_, std::shared_ptr<const Flattened>());
+}
+
+namespace {
+void appendLeaf(SolutionSequence::Flattened& result, const SubTrajectory* trajectory) {
+	result.leaves.push_back(SolutionSequence::Leaf{ trajectory, result.cost, result.waypoints });
+	result.cost += trajectory->cost();
+	result.waypoints += trajectory->waypointCount();
+}
+
+void flatten(const SolutionBase& solution, SolutionSequence::Flattened& result) {
+	if (const auto* sequence = dynamic_cast<const SolutionSequence*>(&solution)) {
+		for (const SolutionSequence::Leaf& leaf : sequence->flattened().leaves)
+			appendLeaf(result, leaf.trajectory);
+	} else if (const auto* wrapped = dynamic_cast<const WrappedSolution*>(&solution))
+		flatten(*wrapped->wrapped(), result);
+	else if (const auto* sub = dynamic_cast<const SubTrajectory*>(&solution))
+		appendLeaf(result, sub);
+}
+}  // namespace
+
+const SolutionSequence::Flattened& SolutionSequence::flattened() const {
+	if (auto flattened = std::atomic_load(&flattened_))
+		return *flattened;
+
+	// concurrent callers might flatten twice, but agree on the stored result
+	auto flattened = std::make_shared<Flattened>();
+	for (const SolutionBase* s : subsolutions_)
+		flatten(*s, *flattened);
+	std::shared_ptr<const Flattened> expected;
+	std::shared_ptr<const Flattened> desired = flattened;
+	if (!std::atomic_compare_exchange_strong(&flattened_, &expected, desired))
+		return *expected;
+	return *desired;
 }
 
 void SolutionSequence::fillMessage(moveit_task_constructor_msgs::Solution& msg, Introspection* introspection) const {
@@ -37,16 +37,38 @@
 
 #include <moveit/task_constructor/container_p.h>
 #include <moveit/task_constructor/task_p.h>
+#include <moveit/task_constructor/collision_cache.h>
 #include <moveit/task_constructor/introspection.h>
+#include <moveit/task_constructor/moveit_compat.h>
+#include <moveit/task_constructor/robot_model_cache.h>
+#include <moveit/task_constructor/scratch_state.h>
+#include <moveit/task_constructor/utils.h>
 #include <moveit_task_constructor_msgs/ExecuteTaskSolutionAction.h>
 
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <geometry_msgs/PoseStamped.h>
 #include <actionlib/client/simple_action_client.h>
 
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/plan_execution/plan_execution.h>
+#if MOVEIT_HAS_MESSAGE_CHECKS
+#include <moveit/utils/message_checks.h>
+#endif
 
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
 #include <functional>
+#include <future>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
 
 namespace {
 std::string rosNormalizeName(const std::string& name) {
@@ -72,7 +94,21 @@ namespace moveit {
 namespace task_constructor {
 
 TaskPrivate::TaskPrivate(Task* me, const std::string& ns)
-  : WrapperBasePrivate(me, std::string()), ns_(rosNormalizeName(ns)), preempt_requested_(false) {}
+  : WrapperBasePrivate(me, std::string()), ns_(rosNormalizeName(ns))
+  , num_threads_(1)
+  , max_concurrency_(0)
+  , scheduling_policy_(Task::RECURSIVE)
+  , time_budget_(std::numeric_limits<double>::infinity())
+  , cost_pruning_(false)
+  , max_scene_depth_(0)
+  , dedup_resolution_(0.0)
+  , memory_budget_(0)
+  , compression_tolerance_(0.0)
+  , statistics_interval_(0.0)
+  , interfaces_resolved_(false)
+  , description_published_(false)
+  , epoch_(0)
+  , executor_(nullptr) {}
 
 TaskPrivate& TaskPrivate::operator=(TaskPrivate&& other) {
 	this->WrapperBasePrivate::operator=(std::move(other));
@@ -80,6 +116,26 @@ TaskPrivate& TaskPrivate::operator=(TaskPrivate&& other) {
 	robot_model_ = std::move(other.robot_model_);
 	robot_model_loader_ = std::move(other.robot_model_loader_);
 	task_cbs_ = std::move(other.task_cbs_);
+	num_threads_ = other.num_threads_;
+	max_concurrency_ = other.max_concurrency_;
+	task_executor_ = std::move(other.task_executor_);
+	scheduling_policy_ = other.scheduling_policy_;
+	cost_pruning_ = other.cost_pruning_;
+	max_scene_depth_ = other.max_scene_depth_;
+	dedup_resolution_ = other.dedup_resolution_;
+	timeout_policy_ = other.timeout_policy_;
+	stall_policy_ = other.stall_policy_;
+	warm_start_ = std::move(other.warm_start_);
+	memory_budget_ = other.memory_budget_;
+	compression_tolerance_ = other.compression_tolerance_;
+	record_file_ = std::move(other.record_file_);
+	record_ = std::move(other.record_);
+	statistics_file_ = std::move(other.statistics_file_);
+	statistics_interval_ = other.statistics_interval_;
+	statistics_ = std::move(other.statistics_);
+	interfaces_resolved_ = description_published_ = false;
+	unfreeze();
+	other.unfreeze();
 	// Ensure same introspection status, but keep the existing introspection instance,
 	// which stores this task pointer and includes it in its task_id_
 	static_cast<Task*>(me_)->enableIntrospection(static_cast<bool>(other.introspection_));
@@ -90,6 +146,412 @@ const ContainerBase* TaskPrivate::stages() const {
 	return children().empty() ? nullptr : static_cast<ContainerBase*>(children().front().get());
 }
 
+namespace {
+// Collect stages that can be computed independently of each other:
+// SerialContainers and Alternatives just compute all their children, so we schedule those directly.
+// Other containers implement their own scheduling logic, so we need to compute them as a whole.
+void collectComputeUnits(Stage& stage, std::vector<StagePrivate*>& units) {
+	if (dynamic_cast<SerialContainer*>(&stage) || dynamic_cast<Alternatives*>(&stage)) {
+		static_cast<ContainerBase&>(stage).pimpl()->traverseStages(
+		    [&units](Stage& child, int /*depth*/) {
+			    collectComputeUnits(child, units);
+			    return true;
+		    },
+		    0, 1);
+	} else
+		units.push_back(stage.pimpl());
+}
+}  // namespace
+
+void TaskPrivate::freeze() {
+	unfreeze();
+	for (const StageRecord& record : stageRecords())
+		record.stage->freezeInterfaces();
+}
+
+const std::vector<TaskPrivate::StageRecord>& TaskPrivate::stageRecords() const {
+	if (!stage_records_.empty() || children().empty())
+		return stage_records_;
+
+	stage_records_ = compileStageRecords();
+	collectComputeUnits(*const_cast<ContainerBase*>(stages()), compute_units_);
+	return stage_records_;
+}
+
+std::vector<TaskPrivate::StageRecord> TaskPrivate::compileStageRecords() const {
+	std::vector<StageRecord> records;
+	std::vector<uint32_t> path;  // record indices of the current stage's ancestors
+	traverseStages(
+	    [&records, &path](const Stage& stage, unsigned int depth) {
+		    const uint32_t index = records.size();
+		    path.resize(depth);
+		    records.push_back({ const_cast<StagePrivate*>(stage.pimpl()), path.empty() ? index : path.back(), depth,
+		                        dynamic_cast<const ContainerBase*>(&stage) != nullptr });
+		    path.push_back(index);
+		    return true;
+	    },
+	    0, UINT_MAX);
+	return records;
+}
+
+void TaskPrivate::refreshStageRecords() {
+	if (!stage_tree_changed_.exchange(false) || stage_records_.empty())
+		return;
+	std::vector<StageRecord> records = compileStageRecords();
+	std::lock_guard<std::mutex> lock(stage_records_mutex_);
+	stage_records_.swap(records);
+}
+
+void TaskPrivate::unfreeze() {
+	stage_records_.clear();
+	compute_units_.clear();
+	stage_tree_changed_ = false;
+}
+
+void TaskPrivate::distributeTimeBudget(double remaining) {
+	std::vector<std::pair<StagePrivate*, double>> weights;
+	for (const StageRecord& record : stageRecords()) {
+		if (record.container)  // containers just forward to their children
+			continue;
+		const Stage& stage = *record.stage->me();
+		weights.emplace_back(record.stage, stage.getTotalComputeTime() / (1 + stage.solutions().size()));
+	}
+
+	// stages without any computation yet are assumed to be average
+	double known = 0.0;
+	size_t num_known = 0;
+	for (const auto& w : weights)
+		if (w.second > 0.0) {
+			known += w.second;
+			++num_known;
+		}
+	const double fallback = num_known > 0 ? known / num_known : 1.0;
+	double total = 0.0;
+	for (auto& w : weights) {
+		if (w.second <= 0.0)
+			w.second = fallback;
+		total += w.second;
+	}
+	for (const auto& w : weights)
+		w.first->setTimeBudget(std::max(0.0, remaining) * w.second / total);
+}
+
+void TaskPrivate::publishSnapshots() {
+	++epoch_;
+	for (const StageRecord& record : stageRecords())
+		record.stage->publishSnapshot(epoch_);
+}
+
+SolutionBaseConstPtr TaskPrivate::findSolution(const SolutionBase& s) const {
+	const auto& solutions = stages()->solutions();
+	// binary search by cost, using a non-owning pointer to s as the probe
+	auto it = solutions.find(SolutionBaseConstPtr(SolutionBaseConstPtr(), &s));
+	return it == solutions.end() ? SolutionBaseConstPtr() : *it;
+}
+
+void TaskPrivate::streamSolution(const SolutionBase& s) {
+	std::lock_guard<std::mutex> lock(streams_mutex_);
+	if (streams_.empty())
+		return;
+	SolutionBaseConstPtr solution = findSolution(s);
+	if (!solution)
+		return;
+	for (const auto& stream : streams_)
+		stream->push(solution);
+}
+
+void TaskPrivate::announceSolution(const SolutionBase& s, const SolutionBaseConstPtr& shared) {
+	// asynchronous callbacks share ownership of the solution
+	callSolutionCallbacks(s, !hasAsyncSolutionCallbacks() ? SolutionBaseConstPtr() : shared ? shared : findSolution(s));
+	streamSolution(s);
+}
+
+void TaskPrivate::announceValidated() {
+	for (auto it = unannounced_.begin(); it != unannounced_.end();) {
+		const SolutionBase& s = **it;
+		if (s.isFailure() || !findSolution(s))
+			it = unannounced_.erase(it);  // invalidated
+		else if (!validationPending(s)) {
+			announceSolution(s, *it);
+			it = unannounced_.erase(it);
+		} else
+			++it;
+	}
+}
+
+void TaskPrivate::closeSolutionStreams() {
+	std::lock_guard<std::mutex> lock(streams_mutex_);
+	for (const auto& stream : streams_)
+		stream->close();
+	streams_.clear();
+}
+
+void TaskPrivate::updateCostBound() {
+	double bound = std::numeric_limits<double>::infinity();
+	const ContainerBase* container = stages();
+	if (cost_pruning_ && container && !container->solutions().empty() && !container->solutions().front()->isFailure())
+		bound = container->solutions().front()->cost();
+	if (bound == costBound())
+		return;
+	for (const StageRecord& record : stageRecords())
+		record.stage->setCostBound(bound);
+	setCostBound(bound);
+}
+
+namespace {
+// collect solutions of non-container stages that compose the given solution
+void collectStageSolutions(const SolutionBase& solution, std::vector<const SolutionBase*>& result) {
+	const bool composed = dynamic_cast<const ContainerBase*>(solution.creator());
+	if (const auto* sequence = composed ? dynamic_cast<const SolutionSequence*>(&solution) : nullptr) {
+		for (const SolutionBase* s : sequence->solutions())
+			collectStageSolutions(*s, result);
+	} else if (const auto* wrapped = composed ? dynamic_cast<const WrappedSolution*>(&solution) : nullptr)
+		collectStageSolutions(*wrapped->wrapped(), result);
+	else
+		result.push_back(&solution);
+}
+
+// shift the cost of all stored parent solutions composed of solution, whose cost changed by delta
+void propagateCostChange(const SolutionBase& solution, double delta) {
+	ContainerBase* parent = const_cast<ContainerBase*>(solution.creator()->parent());
+	if (!parent)
+		return;
+	std::vector<const SolutionBase*> composed;
+	for (const SolutionBaseConstPtr& candidate : parent->solutions()) {
+		if (const auto* sequence = dynamic_cast<const SolutionSequence*>(candidate.get())) {
+			const auto& parts = sequence->solutions();
+			if (std::find(parts.begin(), parts.end(), &solution) != parts.end())
+				composed.push_back(candidate.get());
+		} else if (const auto* wrapped = dynamic_cast<const WrappedSolution*>(candidate.get())) {
+			if (wrapped->wrapped() == &solution)
+				composed.push_back(candidate.get());
+		}
+	}
+	// shifting re-ranks the parent's solutions: iterate the collected ones
+	for (const SolutionBase* s : composed) {
+		const double shift = parent->pimpl()->shiftCost(*s, delta);
+		if (shift != 0.0)
+			propagateCostChange(*s, shift);
+	}
+}
+
+// evaluate COST_PENDING parts of solution, propagating their cost changes to all composing solutions
+bool resolvePendingCosts(const SolutionBase& solution) {
+	const bool composed = dynamic_cast<const ContainerBase*>(solution.creator());
+	bool changed = false;
+	if (const auto* sequence = composed ? dynamic_cast<const SolutionSequence*>(&solution) : nullptr) {
+		for (const SolutionBase* s : sequence->solutions())
+			changed = resolvePendingCosts(*s) || changed;
+	} else if (const auto* wrapped = composed ? dynamic_cast<const WrappedSolution*>(&solution) : nullptr)
+		changed = resolvePendingCosts(*wrapped->wrapped());
+
+	const double delta = const_cast<Stage*>(solution.creator())->pimpl()->resolvePendingCost(solution);
+	if (delta != 0.0)
+		propagateCostChange(solution, delta);
+	return delta != 0.0 || changed;
+}
+}  // namespace
+
+bool TaskPrivate::validationPending(const SolutionBase& solution) {
+	std::vector<const SolutionBase*> parts;
+	collectStageSolutions(solution, parts);
+	return std::any_of(parts.begin(), parts.end(), [](const SolutionBase* part) {
+		const auto* sub = dynamic_cast<const SubTrajectory*>(part);
+		return sub && sub->validationPending() && sub->trajectory();
+	});
+}
+
+void TaskPrivate::validateBestSolution() {
+	const auto& solutions = stages()->solutions();
+	while (!solutions.empty()) {
+		const SolutionBase* best = solutions.front().get();
+		if (resolvePendingCosts(*best)) {  // best solution was (possibly) re-ranked
+			updateCostBound();
+			continue;
+		}
+
+		std::vector<const SolutionBase*> parts;
+		collectStageSolutions(*best, parts);
+		bool valid = true;
+		for (const SolutionBase* part : parts)
+			valid = const_cast<Stage*>(part->creator())->pimpl()->validatePending(*part) && valid;
+		if (valid)
+			break;
+
+		// invalidate all solutions composed of the failed parts
+		SceneUpdate update{ moveit_msgs::PlanningScene() };
+		revalidate(update);
+		updateCostBound();
+		if (introspection_)
+			introspection_->publishTaskState();
+		if (!solutions.empty() && solutions.front().get() == best)
+			break;  // failed part wasn't stored by its stage
+	}
+	announceValidated();
+}
+
+size_t TaskPrivate::resumeContinuations() {
+	size_t resumed = 0;
+	for (const StageRecord& record : stageRecords())
+		if (record.stage->hasContinuations())
+			resumed += record.stage->resumeContinuations();
+	return resumed;
+}
+
+void TaskPrivate::cancelContinuations() {
+	for (const StageRecord& record : stageRecords())
+		if (record.stage->hasContinuations())
+			record.stage->cancelContinuations();
+}
+
+bool TaskPrivate::hasContinuations() const {
+	const auto& records = stageRecords();
+	return std::any_of(records.begin(), records.end(),
+	                   [](const StageRecord& record) { return record.stage->hasContinuations(); });
+}
+
+int32_t TaskPrivate::planScheduled(size_t max_solutions, double available_time) {
+	Task* task = static_cast<Task*>(me_);
+	stageRecords();  // compile compute units
+	const std::vector<StagePrivate*>& units = compute_units_;
+	// preempted units, e.g. losers of racing Alternatives, and units exceeding their deadline are not scheduled anymore
+	auto computable = [](const StagePrivate* unit) {
+		return !unit->preempted() && !unit->deadlineExceeded() && unit->canCompute();
+	};
+
+	// provide planning lock to all stages, keeping it locked during all (non-unlocked) computations
+	auto set_mutex = [this](std::mutex* mutex) {
+		for (const StageRecord& record : stageRecords())
+			record.stage->setPlanningMutex(mutex);
+	};
+	set_mutex(&planning_mutex_);
+
+	std::vector<bool> busy(units.size(), false);
+	size_t num_busy = 0;
+	size_t next = 0;  // round-robin start index to search for computable units
+	bool done = false;
+	int32_t result = moveit::core::MoveItErrorCode::PLANNING_FAILED;
+	std::exception_ptr exception;
+	std::condition_variable cv;
+
+	const TaskExecutorPtr executor = taskExecutor();
+	const bool limited = executor->options().max_concurrency > 0;
+
+	const auto start_time = std::chrono::steady_clock::now();
+	// own: dedicated unit of this worker in PIPELINED mode, units.size() if selecting any unit
+	auto worker = [&](size_t own) {
+		std::unique_lock<std::mutex> lock(planning_mutex_);
+		while (!done) {
+			refreshStageRecords();
+			if (preempt_.requested()) {
+				result = moveit::core::MoveItErrorCode::PREEMPTED;
+				cancelContinuations();
+				break;
+			}
+			if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() > available_time) {
+				result = moveit::core::MoveItErrorCode::TIMED_OUT;
+				break;
+			}
+			if (max_solutions != 0 && task->numSolutions() >= max_solutions)
+				break;
+
+			// resumed continuations count as a planning step as well
+			if (resumeContinuations() > 0) {
+				publishSnapshots();
+				cv.notify_all();
+				continue;
+			}
+
+			// find an idle unit that can compute
+			size_t found = units.size();
+			if (own != units.size()) {
+				if (!busy[own] && computable(units[own]))
+					found = own;
+			} else {
+				for (size_t i = 0; i != units.size(); ++i) {
+					size_t idx = (next + i) % units.size();
+					if (busy[idx] || !computable(units[idx]))
+						continue;
+					if (scheduling_policy_ == Task::RECURSIVE) {
+						found = idx;  // round-robin: first computable unit
+						break;
+					}
+					// best-first: globally most promising job wins
+					if (found == units.size() || units[idx]->jobPriority() < units[found]->jobPriority())
+						found = idx;
+				}
+			}
+			if (found == units.size()) {
+				// a dedicated worker is only done if no other unit can compute either
+				if (num_busy == 0 && !hasContinuations() &&
+				    (own == units.size() || std::none_of(units.begin(), units.end(), computable)))
+					break;  // nobody can compute anymore: we are done
+				// wait for busy units to finish, regularly checking timeout and preemption
+				cv.wait_for(lock, std::chrono::milliseconds(10));
+				continue;
+			}
+
+			if (scheduling_policy_ == Task::RECURSIVE)
+				next = found + 1;
+			if (std::isfinite(time_budget_))
+				distributeTimeBudget(available_time -
+				                     std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count());
+			busy[found] = true;
+			++num_busy;
+			TaskExecutor::Slot slot;
+			if (limited) {  // wait for a computation slot of the (shared) executor, allowing bookkeeping meanwhile
+				lock.unlock();
+				slot = executor->acquire();
+				lock.lock();
+			}
+			try {
+				units[found]->runCompute();
+				validateBestSolution();  // like sequential planning, validate after each step
+			} catch (...) {
+				exception = std::current_exception();
+				done = true;
+			}
+			slot.release();
+			busy[found] = false;
+			--num_busy;
+			if (!enforceMemoryBudget()) {
+				result = Task::MEMORY_BUDGET_EXCEEDED;
+				break;
+			}
+
+			publishSnapshots();
+			saveStatistics(false);
+			for (const auto& cb : task_cbs_)
+				cb(*task);
+			if (introspection_)
+				introspection_->publishTaskState();
+			cv.notify_all();
+		}
+		done = true;
+		cv.notify_all();
+	};
+
+	std::vector<std::thread> threads;
+	if (scheduling_policy_ == Task::PIPELINED) {
+		threads.reserve(units.size());
+		for (size_t own = 0; own != units.size(); ++own)
+			threads.push_back(executor->spawn([&worker, own]() { worker(own); }));
+	} else {
+		const size_t num_threads = max_concurrency_ > 0 ? std::min(num_threads_, max_concurrency_) : num_threads_;
+		threads.reserve(num_threads);
+		for (size_t i = 0; i != num_threads; ++i)
+			threads.push_back(executor->spawn([&worker, &units]() { worker(units.size()); }));
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	refreshStageRecords();  // reset the planning mutex of late stages too
+	set_mutex(nullptr);
+	if (exception)
+		std::rethrow_exception(exception);
+	return result;
+}
+
 Task::Task(const std::string& ns, bool introspection, ContainerBase::pointer&& container)
   : WrapperBase(new TaskPrivate(this, ns), std::move(container)) {
 	setTimeout(std::numeric_limits<double>::max());
@@ -114,8 +576,14 @@ Task& Task::operator=(Task&& other) {  // NOLINT(performance-noexcept-move-const
 
 Task::~Task() {
 	auto impl = pimpl();
+	if (impl->async_thread_.joinable()) {
+		preempt();
+		impl->async_thread_.join();
+	}
 	impl->introspection_.reset();  // stop introspection
+	impl->saveStatistics(true);
 	clear();  // remove all stages
+	ScratchState::purge(impl->robot_model_.get());  // pooled scratch states keep the model alive
 	impl->robot_model_.reset();
 	// only destroy loader after all references to the model are gone!
 	impl->robot_model_loader_.reset();
@@ -127,37 +595,45 @@ void Task::setRobotModel(const core::RobotModelConstPtr& robot_model) {
 		return;
 	}
 	auto impl = pimpl();
-	if (impl->robot_model_ && impl->robot_model_ != robot_model)
+	if (impl->robot_model_ && impl->robot_model_ != robot_model) {
 		reset();  // solutions, scenes, etc become invalid
+		ScratchState::purge(impl->robot_model_.get());
+	}
 	impl->robot_model_ = robot_model;
 }
 
 void Task::loadRobotModel(const std::string& robot_description) {
 	auto impl = pimpl();
-	impl->robot_model_loader_ = std::make_shared<robot_model_loader::RobotModelLoader>(robot_description);
+	try {
+		impl->robot_model_loader_ = RobotModelCache::load(robot_description);
+	} catch (const std::runtime_error& e) {
+		throw Exception(std::string("Task failed to construct RobotModel: ") + e.what());
+	}
 	setRobotModel(impl->robot_model_loader_->getModel());
-	if (!impl->robot_model_)
-		throw Exception("Task failed to construct RobotModel");
 }
 
 void Task::add(Stage::pointer&& stage) {
+	pimpl()->unfreeze();
 	stages()->add(std::move(stage));
 }
 
 void Task::insert(Stage::pointer&& stage, int before) {
+	pimpl()->unfreeze();
 	stages()->insert(std::move(stage), before);
 }
 
 void Task::clear() {
 	reset();
+	pimpl()->unfreeze();
 	stages()->clear();
 }
 
 void Task::enableIntrospection(bool enable) {
 	auto impl = pimpl();
-	if (enable && !impl->introspection_)
+	if (enable && !impl->introspection_) {
 		impl->introspection_.reset(new Introspection(impl));
-	else if (!enable && impl->introspection_) {
+		impl->description_published_ = false;
+	} else if (!enable && impl->introspection_) {
 		// reset introspection instance of all stages
 		impl->setIntrospection(nullptr);
 		impl->traverseStages(
@@ -191,37 +667,84 @@ void Task::reset() {
 	// signal introspection, that this task was reset
 	if (impl->introspection_)
 		impl->introspection_->reset();
+	// carry statistics of stages over to the next init()
+	impl->collectStatistics();
 
 	WrapperBase::reset();
+	impl->unfreeze();  // containers might have dropped children, e.g. ForEach
+	if (impl->warm_start_)  // caches survive, but wrappers of removed stages are forgotten
+		impl->warm_start_->prune();
+	if (const CollisionCachePtr collision_cache = CollisionCache::instance())
+		collision_cache->clear();
+	impl->unannounced_.clear();
+	impl->interfaces_resolved_ = false;
+	impl->updateCostBound();
 }
 
 void Task::init() {
 	auto impl = pimpl();
 	if (!impl->robot_model_)
 		loadRobotModel();
+	// stages and solvers use the task's executor, also for threads they spawn
+	TaskExecutor::Activation executor_activation(impl->taskExecutor());
+
+	// equip (new) stages with warm-start caches, which might change their configuration
+	if (impl->warm_start_)
+		stages()->traverseRecursively([&impl](const Stage& stage, unsigned int /*depth*/) {
+			Stage& s = const_cast<Stage&>(stage);
+			if (s.enableWarmStart(*impl->warm_start_))
+				s.pimpl()->markDirty();
+			return true;
+		});
 
-	// initialize push connections of wrapped child
-	StagePrivate* child = wrapped()->pimpl();
-	child->setPrevEnds(impl->pendingBackward());
-	child->setNextStarts(impl->pendingForward());
+	// only stages whose configuration changed since the last init() are initialized again
+	ContainerBasePrivate* root = stages()->pimpl();
+	const bool changed = root->needsInit(impl->robot_model_);
+	// reset() drops all interface links, requiring to resolve the interfaces again
+	const bool resolve = changed || !impl->interfaces_resolved_;
+
+	if (resolve) {  // initialize push connections of wrapped child
+		StagePrivate* child = wrapped()->pimpl();
+		child->setPrevEnds(impl->pendingBackward());
+		child->setNextStarts(impl->pendingForward());
+	}
 
 	// and *afterwards* initialize all children recursively
-	stages()->init(impl->robot_model_);
-	// task expects its wrapped child to push to both ends, this triggers interface resolution
-	stages()->pimpl()->resolveInterface(InterfaceFlags({ GENERATE }));
+	if (changed) {
+		stages()->init(impl->robot_model_);
+		root->markInitialized(impl->robot_model_);
+	}
+	if (resolve) {
+		impl->interfaces_resolved_ = false;
+		// task expects its wrapped child to push to both ends, this triggers interface resolution
+		stages()->pimpl()->resolveInterface(InterfaceFlags({ GENERATE }));
+		impl->interfaces_resolved_ = true;
 
-	// provide introspection instance to all stages
+		// the structure is fixed now: compile the stage tree
+		impl->freeze();
+	}
+
+	// provide introspection instance, preemption token, scene compaction, deduplication and timeout policy to stages
 	auto* introspection = impl->introspection_.get();
-	impl->traverseStages(
-	    [introspection](Stage& stage, int /*depth*/) {
-		    stage.pimpl()->setIntrospection(introspection);
-		    return true;
-	    },
-	    1, UINT_MAX);
+	const auto& records = impl->stageRecords();
+	for (const TaskPrivate::StageRecord& record : records) {
+		record.stage->setIntrospection(introspection);
+		const PreemptionToken* token = &impl->preempt_;
+		if (record.depth > 0)  // containers might hand down own tokens, e.g. racing Alternatives (parents come first)
+			token = static_cast<ContainerBasePrivate*>(records[record.parent].stage)->childPreemptionToken(record.stage);
+		record.stage->setPreemptionToken(token);
+		record.stage->setMaxSceneDepth(impl->max_scene_depth_);
+		record.stage->setStateDeduplication(impl->dedup_resolution_);
+		record.stage->inheritTimeoutPolicy(impl->timeout_policy_);
+		record.stage->setStallPolicy(impl->stall_policy_);
+	}
+	impl->restoreStatistics();
 
-	// first time publish task
-	if (introspection)
+	// publish task description whenever it changed
+	if (introspection && (changed || !impl->description_published_)) {
 		introspection->publishTaskDescription();
+		impl->description_published_ = true;
+	}
 }
 
 bool Task::canCompute() const {
@@ -233,36 +756,641 @@ void Task::compute() {
 }
 
 moveit::core::MoveItErrorCode Task::plan(size_t max_solutions) {
-	auto impl = pimpl();
 	init();
+	return continuePlanning(max_solutions);
+}
+
+moveit::core::MoveItErrorCode Task::replan(const moveit_msgs::PlanningScene& diff, size_t max_solutions) {
+	auto impl = pimpl();
+	SceneUpdate update(diff);
+	size_t num_invalidated = impl->revalidate(update);
+	ROS_DEBUG_STREAM_NAMED("Task", "scene update invalidated " << num_invalidated << " solutions");
+	impl->updateCostBound();  // best solution might have been invalidated
+	if (impl->introspection_)
+		impl->introspection_->publishTaskState();
+	return continuePlanning(max_solutions);
+}
+
+namespace {
+// does the generator refer to object by its "object" property or the frame of a pose property?
+bool dependsOn(const Stage& stage, const std::string& object) {
+	if (!dynamic_cast<const Generator*>(&stage))
+		return false;
+	for (const auto& pair : stage.properties()) {
+		const boost::any& value = pair.second.value();
+		if (value.empty())
+			continue;
+		if (pair.first == "object" && value.type() == typeid(std::string) &&
+		    boost::any_cast<const std::string&>(value) == object)
+			return true;
+		if (value.type() == typeid(geometry_msgs::PoseStamped) &&
+		    boost::any_cast<const geometry_msgs::PoseStamped&>(value).header.frame_id == object)
+			return true;
+	}
+	return false;
+}
+}  // namespace
+
+size_t TaskPrivate::regenerate(const std::string& object) {
+	// dependent generators, lifted to their outermost wrapper refining their solutions, e.g. ComputeIK
+	std::vector<Stage*> roots;
+	for (const StageRecord& record : stageRecords()) {
+		Stage* stage = record.stage->me();
+		if (!dependsOn(*stage, object))
+			continue;
+		while (stage->parent() && stage->parent()->parent() && dynamic_cast<const WrapperBase*>(stage->parent()))
+			stage = const_cast<ContainerBase*>(stage->parent());
+		if (std::find(roots.begin(), roots.end(), stage) == roots.end())
+			roots.push_back(stage);
+	}
+
+	size_t num_regenerated = 0;
+	for (Stage* root : roots) {
+		// wrappers first: they drop pending child solutions before the children hand over new ones
+		std::vector<Stage*> stages{ root };
+		if (const auto* container = dynamic_cast<const ContainerBase*>(root)) {
+			stages.clear();
+			container->traverseRecursively([&stages](const Stage& stage, unsigned int /*depth*/) {
+				stages.push_back(const_cast<Stage*>(&stage));
+				return true;
+			});
+		}
+		for (Stage* stage : stages)
+			stage->regenerate();
+		num_regenerated += stages.size();
+	}
+	return num_regenerated;
+}
+
+size_t TaskPrivate::numStoredItems() const {
+	size_t num = 0;
+	for (const StageRecord& record : stageRecords())
+		num += record.stage->numStoredStates() + record.stage->me()->failures().size();
+	return num;
+}
+
+moveit::core::MoveItErrorCode Task::replanObject(const moveit_msgs::CollisionObject& object, size_t max_solutions) {
+	auto impl = pimpl();
+	moveit_msgs::PlanningScene diff;
+	diff.is_diff = true;
+	diff.world.collision_objects.push_back(object);
+	SceneUpdate update(diff);
+	size_t num_invalidated = impl->revalidate(update);
+	size_t num_regenerated = impl->regenerate(object.id);
+	// invalidate solutions composed of regenerated ones
+	SceneUpdate composed{ moveit_msgs::PlanningScene() };
+	num_invalidated += impl->revalidate(composed);
+	// parents first, such that children's obsolete solutions aren't referred to anymore
+	impl->releaseObsoleteFailures();
+	for (const TaskPrivate::StageRecord& record : impl->stageRecords())
+		record.stage->releaseObsoleteFailures();
+	ROS_DEBUG_STREAM_NAMED("Task", "moving '" << object.id << "' invalidated " << num_invalidated
+	                                          << " solutions and regenerated " << num_regenerated << " stages");
+	impl->updateCostBound();
+	if (impl->introspection_)
+		impl->introspection_->publishTaskState();
+	return continuePlanning(max_solutions);
+}
+
+moveit::core::MoveItErrorCode Task::planContinuously(const std::string& object, const std::string& topic,
+                                                     double latency) {
+#if !MOVEIT_HAS_OBJECT_POSE
+	ROS_ERROR_STREAM_NAMED("Task", "moving objects by their pose requires MoveIt 1.1.6 or newer");
+	return moveit::core::MoveItErrorCode::FAILURE;
+#endif
+	auto impl = pimpl();
+	ros::NodeHandle nh;
+	ros::CallbackQueue queue;
+	nh.setCallbackQueue(&queue);
+	std::unique_ptr<geometry_msgs::PoseStamped> pending;  // latest pose update, not yet applied
+	ros::Subscriber sub = nh.subscribe<geometry_msgs::PoseStamped>(
+	    topic, 1, [&pending](const geometry_msgs::PoseStampedConstPtr& msg) {
+		    pending.reset(new geometry_msgs::PoseStamped(*msg));
+	    });
+
+	// limit each planning cycle to latency, restoring a previously set budget afterwards
+	struct BudgetScope
+	{
+		TaskPrivate* impl;
+		double previous;
+		~BudgetScope() {
+			impl->time_budget_ = previous;
+			impl->distributeTimeBudget(impl->time_budget_);
+		}
+	} budget{ impl, impl->time_budget_ };
+	impl->time_budget_ = std::min(latency, budget.previous);
+
+	moveit::core::MoveItErrorCode result = plan();
+	// pruned states and invalidated solutions accumulate: plan from scratch once they outnumber those of a full plan
+	size_t max_items = 2 * std::max<size_t>(impl->numStoredItems(), 100);
+	while (ros::ok() && result.val != moveit::core::MoveItErrorCode::PREEMPTED && !impl->preempt_.requested()) {
+		queue.callAvailable(ros::WallDuration(canCompute() ? 0.0 : 0.01));
+		if (!pending) {
+			if (canCompute())  // continue the previous cycle
+				result = continuePlanning(0);
+			continue;
+		}
+
+		moveit_msgs::CollisionObject update;
+		update.id = object;
+		update.header = pending->header;
+		update.operation = moveit_msgs::CollisionObject::MOVE;
+#if MOVEIT_HAS_OBJECT_POSE
+		update.pose = pending->pose;
+#endif
+		pending.reset();
+		result = replanObject(update);
+
+		if (impl->numStoredItems() > max_items) {
+			ROS_DEBUG_STREAM_NAMED("Task", "replanning from scratch to release " << impl->numStoredItems()
+			                                                                      << " states and failures");
+			reset();
+			result = plan();
+			max_items = 2 * std::max<size_t>(impl->numStoredItems(), 100);
+		}
+	}
+	return result;
+}
+
+moveit::core::MoveItErrorCode Task::continuePlanning(size_t max_solutions) {
+	auto impl = pimpl();
+	// close solution streams and publish the final state when planning finishes
+	struct StreamCloser
+	{
+		TaskPrivate* impl;
+		~StreamCloser() {
+			impl->closeSolutionStreams();
+			if (impl->introspection_)
+				impl->introspection_->flushTaskState();
+			impl->saveStatistics(true);
+		}
+	} closer{ impl };
+	// record or replay this planning run
+	struct RecordingScope
+	{
+		TaskPrivate* impl;
+		PlanningRecord::Activation activation;
+		RecordingScope(TaskPrivate* impl) : impl(impl), activation(impl->beginRecording()) {}
+		~RecordingScope() { impl->endRecording(); }
+	} recording(impl);
+	// stages and solvers use the task's executor, which planning workers inherit
+	TaskExecutor::Activation executor_activation(impl->taskExecutor());
 
 	// Print state and return success if there are solutions otherwise the input error_code
-	const auto success_or = [this](const int32_t error_code) {
+	const auto success_or = [this, impl](const int32_t error_code) {
+		impl->refreshStageRecords();
+		impl->validateBestSolution();
+		impl->publishSnapshots();
 		printState();
+		if (numSolutions() == 0 && EventLog::enabled())
+			ROS_DEBUG_STREAM_NAMED("EventLog", "Planning failed, recent events:\n" << dumpEvents(100));
 		return numSolutions() > 0 ? moveit::core::MoveItErrorCode::SUCCESS : error_code;
 	};
-	impl->preempt_requested_ = false;
-	const double available_time = timeout();
+	// planAsync() resets the token in the calling thread, such that a preempt() right after it is not lost
+	if (impl->reset_preempt_)
+		impl->preempt_.reset();
+	impl->reset_preempt_ = true;
+	// watch for stalled computations while planning
+	struct WatchdogScope
+	{
+		TaskPrivate* impl;
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool stop = false;
+		std::thread thread;
+		WatchdogScope(TaskPrivate* impl) : impl(impl) {
+			if (!impl->stall_policy_.enabled())
+				return;
+			impl->stageRecords();  // compile records in the planning thread, the watchdog only reads them
+			thread = impl->taskExecutor()->spawn([this]() { this->impl->watchStalls(mutex, cv, stop); });
+		}
+		~WatchdogScope() {
+			if (!thread.joinable())
+				return;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stop = true;
+			}
+			cv.notify_one();
+			thread.join();
+		}
+	} watchdog(impl);
+	const double available_time = std::min(timeout(), impl->time_budget_);
+	if (impl->num_threads_ > 1 || impl->scheduling_policy_ != RECURSIVE) {
+		const int32_t result = impl->planScheduled(max_solutions, available_time);
+		const moveit::core::MoveItErrorCode code = success_or(result);
+		// report an exceeded memory budget even if there are solutions
+		return result == MEMORY_BUDGET_EXCEEDED ? moveit::core::MoveItErrorCode(result) : code;
+	}
+
+	const TaskExecutorPtr executor = impl->taskExecutor();
 	const auto start_time = std::chrono::steady_clock::now();
-	while (canCompute() && (max_solutions == 0 || numSolutions() < max_solutions)) {
-		if (impl->preempt_requested_)
+	while ((canCompute() || impl->hasContinuations()) && (max_solutions == 0 || numSolutions() < max_solutions)) {
+		impl->refreshStageRecords();
+		if (impl->preempt_.requested()) {
+			impl->cancelContinuations();
 			return success_or(moveit::core::MoveItErrorCode::PREEMPTED);
-		if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() > available_time)
+		}
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		if (elapsed > available_time)
 			return success_or(moveit::core::MoveItErrorCode::TIMED_OUT);
-		compute();
+		if (std::isfinite(impl->time_budget_))
+			impl->distributeTimeBudget(available_time - elapsed);
+		const bool resumed = impl->resumeContinuations() > 0;
+		if (canCompute()) {
+			TaskExecutor::Slot slot = executor->acquire();  // share computations with other tasks of the executor
+			compute();
+		} else if (!resumed) {  // wait for pending continuations
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		impl->validateBestSolution();
+		impl->publishSnapshots();
+		impl->saveStatistics(false);
 		for (const auto& cb : impl->task_cbs_)
 			cb(*this);
 		if (impl->introspection_)
 			impl->introspection_->publishTaskState();
+		if (!impl->enforceMemoryBudget()) {
+			success_or(MEMORY_BUDGET_EXCEEDED);  // validate best solution and print state
+			return MEMORY_BUDGET_EXCEEDED;
+		}
 	};
 	return success_or(moveit::core::MoveItErrorCode::PLANNING_FAILED);
 }
 
+moveit::core::MoveItErrorCode Task::planAnytime(double time_budget) {
+	auto impl = pimpl();
+	const auto reset_budget = [impl]() {
+		impl->time_budget_ = std::numeric_limits<double>::infinity();
+		impl->distributeTimeBudget(impl->time_budget_);
+	};
+	impl->time_budget_ = time_budget;
+	moveit::core::MoveItErrorCode result;
+	try {
+		result = plan();
+	} catch (...) {
+		reset_budget();
+		throw;
+	}
+	reset_budget();
+	return result;
+}
+
+std::future<moveit::core::MoveItErrorCode> Task::planAsync(size_t max_solutions) {
+	auto impl = pimpl();
+	if (impl->async_thread_.joinable())
+		impl->async_thread_.join();  // wait for previous planning run
+
+	impl->preempt_.reset();
+	impl->reset_preempt_ = false;
+	std::packaged_task<moveit::core::MoveItErrorCode()> job([this, max_solutions]() { return plan(max_solutions); });
+	auto result = job.get_future();
+	auto shared_job = std::make_shared<decltype(job)>(std::move(job));
+	impl->async_thread_ = impl->taskExecutor()->spawn([shared_job]() { (*shared_job)(); });
+	return result;
+}
+
+SolutionStreamPtr Task::solutionStream() {
+	auto impl = pimpl();
+	auto stream = std::make_shared<SolutionStream>();
+	std::lock_guard<std::mutex> lock(impl->streams_mutex_);
+	impl->streams_.push_back(stream);
+	return stream;
+}
+
 void Task::preempt() {
-	pimpl()->preempt_requested_ = true;
+	auto impl = pimpl();
+	impl->preempt_.request();
+	std::lock_guard<std::mutex> lock(impl->executor_mutex_);
+	if (impl->executor_)
+		impl->executor_->stop();
+}
+
+void Task::setNumThreads(size_t num_threads) {
+	pimpl()->num_threads_ = std::max<size_t>(num_threads, 1);
+}
+
+size_t Task::numThreads() const {
+	return pimpl()->num_threads_;
+}
+
+void Task::setExecutor(const TaskExecutorPtr& executor) {
+	auto impl = pimpl();
+	impl->task_executor_ = executor;
+	if (impl->introspection_)
+		impl->introspection_->setExecutor(impl->taskExecutor());
+}
+
+TaskExecutorPtr Task::executor() const {
+	return pimpl()->taskExecutor();
+}
+
+void Task::setMaxConcurrency(size_t max_concurrency) {
+	pimpl()->max_concurrency_ = max_concurrency;
+}
+
+size_t Task::maxConcurrency() const {
+	return pimpl()->max_concurrency_;
+}
+
+void Task::setSchedulingPolicy(SchedulingPolicy policy) {
+	pimpl()->scheduling_policy_ = policy;
+}
+
+Task::SchedulingPolicy Task::schedulingPolicy() const {
+	return pimpl()->scheduling_policy_;
+}
+
+void Task::enableCostPruning(bool enable) {
+	auto impl = pimpl();
+	impl->cost_pruning_ = enable;
+	impl->updateCostBound();
+}
+
+bool Task::costPruning() const {
+	return pimpl()->cost_pruning_;
+}
+
+void Task::setMaxSceneDiffDepth(size_t depth) {
+	pimpl()->max_scene_depth_ = depth;
+}
+
+size_t Task::maxSceneDiffDepth() const {
+	return pimpl()->max_scene_depth_;
+}
+
+void Task::setStateDeduplication(double resolution) {
+	pimpl()->dedup_resolution_ = resolution;
+}
+
+double Task::stateDeduplication() const {
+	return pimpl()->dedup_resolution_;
+}
+
+void Task::setTimeoutPolicy(const TimeoutPolicy& policy) {
+	pimpl()->timeout_policy_ = policy;
+}
+
+const TimeoutPolicy& Task::timeoutPolicy() const {
+	return pimpl()->timeout_policy_;
+}
+
+void Task::setStallPolicy(const StallPolicy& policy) {
+	pimpl()->stall_policy_ = policy;
+}
+
+const StallPolicy& Task::stallPolicy() const {
+	return pimpl()->stall_policy_;
+}
+
+void Task::setWarmStart(bool enable) {
+	auto impl = pimpl();
+	if (!enable)
+		impl->warm_start_.reset();
+	else if (!impl->warm_start_)
+		impl->warm_start_ = std::make_shared<WarmStartCache>();
+}
+
+bool Task::warmStart() const {
+	return pimpl()->warm_start_ != nullptr;
+}
+
+void TaskPrivate::watchStalls(std::mutex& mutex, std::condition_variable& cv, const bool& stop) {
+	const std::vector<StageRecord>& records = stage_records_;  // compiled by WatchdogScope
+	std::vector<std::string> paths;  // paths of all compiled stages
+	std::vector<char> covered;  // a descendant is stalled
+
+	const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+	    std::chrono::duration<double>(stall_policy_.check_interval));
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!cv.wait_for(lock, interval, [&stop]() { return stop; })) {
+		// refreshStageRecords() only adds stages during planning: recompute all paths if their number changed
+		std::lock_guard<std::mutex> records_lock(stage_records_mutex_);
+		if (paths.size() != records.size()) {
+			paths.resize(records.size());
+			for (size_t i = 0; i < records.size(); ++i)
+				paths[i] = (records[i].depth > 0 ? paths[records[i].parent] + "/" : "") + records[i].stage->name();
+		}
+		const auto now = std::chrono::steady_clock::now();
+		covered.assign(records.size(), false);
+		// children follow their parents: visit in reverse to report the innermost stalled stage only
+		for (size_t i = records.size(); i-- > 0;) {
+			StagePrivate* stage = records[i].stage;
+			if (!covered[i] && !stage->stalled(now))
+				continue;
+			covered[records[i].parent] = true;
+			double running;
+			uint32_t input;
+			if (covered[i] || !stage->claimStall(now, running, input))
+				continue;
+
+			ROS_WARN_STREAM_NAMED("Task", "Stage '" << paths[i] << "' stalled: compute() is running for " << running
+			                                        << "s, input state "
+			                                        << (input ? "#" + std::to_string(input) : std::string("unknown"))
+			                                        << (stall_policy_.preempt ? ", preempting" : ""));
+			logEvent(stage->eventSource(), EventLog::STALL, running, input);
+			if (stall_policy_.preempt)
+				preempt_.request();
+		}
+	}
+}
+
+constexpr int32_t Task::MEMORY_BUDGET_EXCEEDED;
+
+void Task::setMemoryBudget(size_t bytes) {
+	pimpl()->memory_budget_ = bytes;
+	if (bytes > 0)
+		Stage::setMemoryAccounting(true);
+}
+
+size_t Task::memoryBudget() const {
+	return pimpl()->memory_budget_;
+}
+
+void Task::setTrajectoryCompression(double tolerance) {
+	pimpl()->compression_tolerance_ = tolerance;
 }
 
+double Task::trajectoryCompression() const {
+	return pimpl()->compression_tolerance_;
+}
+
+MemoryUsage Task::memoryUsage() const {
+	MemoryUsage total;
+	auto add = [&total](const Stage& stage) {
+		const MemoryUsage usage = stage.memoryUsage();
+		total.states += usage.states;
+		total.scenes += usage.scenes;
+		total.trajectories += usage.trajectories;
+		total.markers += usage.markers;
+	};
+	add(*this);
+	for (const TaskPrivate::StageRecord& record : pimpl()->stageRecords())
+		add(*record.stage->me());
+	return total;
+}
+
+std::string Task::dumpEvents(size_t max) const {
+	std::map<EventLog::Source, std::string> names{ { pimpl()->eventSource(), name() } };
+	for (const TaskPrivate::StageRecord& record : pimpl()->stageRecords())
+		names[record.stage->eventSource()] = record.stage->name();
+	std::ostringstream oss;
+	EventLog::instance().dump(oss,
+	                          [&names](EventLog::Source source) {
+		                          auto it = names.find(source);
+		                          return it == names.end() ? std::string() : it->second;
+	                          },
+	                          max);
+	return oss.str();
+}
+
+bool TaskPrivate::enforceMemoryBudget() {
+	if (memory_budget_ == 0)
+		return true;
+	Task* task = static_cast<Task*>(me());
+	const size_t threshold = memory_budget_ / 10 * 9;
+	size_t usage = task->memoryUsage().total();
+	if (usage <= threshold)
+		return true;
+
+	if (compression_tolerance_ > 0.0) {
+		size_t compressed = 0;
+		for (const StageRecord& record : stageRecords())
+			compressed += record.stage->compressSolutions(compression_tolerance_);
+		usage = task->memoryUsage().total();
+		ROS_DEBUG_STREAM_NAMED("Task", "compressed " << compressed << " trajectories, reducing memory to " << usage
+		                                             << " bytes (budget: " << memory_budget_ << ")");
+		if (usage <= threshold)
+			return true;
+	}
+
+	for (bool evict_solutions : { false, true }) {
+		for (const StageRecord& record : stageRecords())
+			record.stage->reduceMemory(evict_solutions);
+		reduceMemory(evict_solutions);
+		usage = task->memoryUsage().total();
+		ROS_DEBUG_STREAM_NAMED("Task", "reduced memory to " << usage << " bytes (budget: " << memory_budget_ << ")");
+		if (usage <= threshold)
+			return true;
+	}
+	if (usage <= memory_budget_)
+		return true;
+	ROS_WARN_STREAM_NAMED("Task", "stopped planning: memory usage of " << usage << " bytes exceeds the budget of "
+	                                                                   << memory_budget_ << " bytes");
+	return false;
+}
+
+void Task::setRecording(const std::string& file) {
+	auto impl = pimpl();
+	impl->record_file_ = file;
+	impl->record_.reset();
+}
+
+bool Task::setReplay(const std::string& file) {
+	auto impl = pimpl();
+	impl->record_file_.clear();
+	impl->record_ = file.empty() ? nullptr : PlanningRecord::load(file);
+	return file.empty() || impl->record_;
+}
+
+PlanningRecord* TaskPrivate::beginRecording() {
+	const Task& task = *static_cast<Task*>(me());
+	if (!record_file_.empty()) {
+		record_ = std::make_shared<PlanningRecord>(std::random_device()());
+		record_->recordProperties(task);
+	} else if (record_ && record_->mode() == PlanningRecord::REPLAY) {
+		record_->rewind();
+		record_->checkProperties(task);
+	} else
+		return nullptr;
+
+	std::srand(record_->seed());
+	return record_.get();
+}
+
+void Task::setStatisticsFile(const std::string& file, double save_interval) {
+	auto impl = pimpl();
+	impl->statistics_file_ = file;
+	impl->statistics_interval_ = save_interval;
+	impl->statistics_.reset();
+}
+
+const StatisticsRecord* Task::statistics() const {
+	return pimpl()->statistics_.get();
+}
+
+void TaskPrivate::restoreStatistics() {
+	if (statistics_file_.empty())
+		return;
+	if (!statistics_) {
+		if (std::ifstream(statistics_file_).good())
+			statistics_ = StatisticsRecord::load(statistics_file_);
+		if (!statistics_)  // start from scratch
+			statistics_ = std::make_shared<StatisticsRecord>();
+		statistics_saved_ = std::chrono::steady_clock::now();
+	}
+	size_t restored = 0;
+	for (const StageRecord& record : stageRecords())
+		restored += statistics_->restore(*record.stage);
+	if (restored)
+		ROS_DEBUG_STREAM_NAMED("Task", "restored statistics of " << restored << " stages");
+}
+
+void TaskPrivate::collectStatistics() {
+	if (!statistics_)
+		return;
+	for (const StageRecord& record : stageRecords())
+		statistics_->collect(*record.stage);
+}
+
+void TaskPrivate::saveStatistics(bool force) {
+	if (!statistics_ || statistics_file_.empty())
+		return;
+	const auto now = std::chrono::steady_clock::now();
+	if (!force && (statistics_interval_ <= 0.0 ||
+	               std::chrono::duration<double>(now - statistics_saved_).count() < statistics_interval_))
+		return;
+	collectStatistics();
+	statistics_->save(statistics_file_);
+	statistics_saved_ = now;
+}
+
+void TaskPrivate::endRecording() {
+	if (!record_)
+		return;
+	if (record_->mode() == PlanningRecord::RECORD)
+		record_->save(record_file_);
+	else if (size_t pending = record_->pendingResponses())
+		ROS_WARN_STREAM_NAMED("Task", pending << " recorded planner responses were not replayed");
+}
+
+namespace {
+// collect the primitive sub trajectories of solution, in execution order
+void collectSubTrajectories(const SolutionBase& solution, std::vector<const SubTrajectory*>& result) {
+	if (const auto* sequence = dynamic_cast<const SolutionSequence*>(&solution)) {
+		for (const SolutionSequence::Leaf& leaf : sequence->flattened().leaves)
+			result.push_back(leaf.trajectory);
+	} else if (const auto* wrapped = dynamic_cast<const WrappedSolution*>(&solution))
+		collectSubTrajectories(*wrapped->wrapped(), result);
+	else if (const auto* sub = dynamic_cast<const SubTrajectory*>(&solution))
+		result.push_back(sub);
+}
+
+// compressed trajectories only approximate the planned ones: refuse to execute them
+bool isCompressed(const std::vector<const SubTrajectory*>& parts) {
+	return std::any_of(parts.begin(), parts.end(), [](const SubTrajectory* part) { return part->compressed(); });
+}
+}  // namespace
+
 moveit::core::MoveItErrorCode Task::execute(const SolutionBase& s) {
+	std::vector<const SubTrajectory*> parts;
+	collectSubTrajectories(s, parts);
+	if (isCompressed(parts)) {
+		ROS_ERROR_STREAM_NAMED("Task", "refusing to execute a solution with compressed (lossy) trajectories");
+		return moveit::core::MoveItErrorCode(moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN);
+	}
+
 	actionlib::SimpleActionClient<moveit_task_constructor_msgs::ExecuteTaskSolutionAction> ac("execute_task_solution");
 	ac.waitForServer();
 
@@ -275,16 +1403,122 @@ moveit::core::MoveItErrorCode Task::execute(const SolutionBase& s) {
 	return ac.getResult()->error_code;
 }
 
+bool TaskPrivate::constructMotionPlan(const SolutionBase& s, const planning_scene::PlanningScenePtr& scene,
+                                      plan_execution::ExecutableMotionPlan& plan) {
+	if (s.isFailure()) {
+		ROS_ERROR_STREAM_NAMED("Task", "refusing to execute a failed solution");
+		return false;
+	}
+	std::vector<const SubTrajectory*> parts;
+	collectSubTrajectories(s, parts);
+	if (isCompressed(parts)) {
+		ROS_ERROR_STREAM_NAMED("Task", "refusing to execute a solution with compressed (lossy) trajectories");
+		return false;
+	}
+
+	const moveit::core::RobotModelConstPtr& model = scene->getRobotModel();
+	const planning_scene_monitor::PlanningSceneMonitorPtr monitor = plan.planning_scene_monitor_;
+	planning_scene::PlanningScenePtr predicted_scene = scene;
+	plan.plan_components_.reserve(parts.size());
+	for (const SubTrajectory* part : parts) {
+		plan.plan_components_.emplace_back();
+		plan_execution::ExecutableTrajectory& exec_traj = plan.plan_components_.back();
+		exec_traj.description_ = std::to_string(plan.plan_components_.size()) + "/" + std::to_string(parts.size());
+		const std::string& description = exec_traj.description_;
+
+		robot_trajectory::RobotTrajectoryConstPtr trajectory = part->trajectory();
+		if (!trajectory)  // execute an empty trajectory to apply the scene effect
+			exec_traj.trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(model, nullptr);
+		else if (part->timeParameterizationPending()) {
+			// like fillMessage(), only time the executed copy
+			if (!(exec_traj.trajectory_ = part->timedTrajectory()))
+				return false;
+		} else  // plan_execution doesn't modify the trajectory: share it
+			exec_traj.trajectory_ = std::const_pointer_cast<robot_trajectory::RobotTrajectory>(trajectory);
+
+		robot_trajectory::RobotTrajectoryPtr& executed = exec_traj.trajectory_;
+		if (!executed->empty()) {
+			// execute with the group actuating the trajectory's joints, as the capability does for its messages
+			const auto& joints = executed->getGroup() ? executed->getGroup()->getActiveJointModels() :
+			                                            model->getActiveJointModels();
+			std::vector<std::string> joint_names;
+			joint_names.reserve(joints.size());
+			for (const moveit::core::JointModel* joint : joints)
+				joint_names.push_back(joint->getName());
+			const moveit::core::JointModelGroup* group = utils::findJointModelGroup(*model, joint_names);
+			if (!group) {
+				ROS_ERROR_STREAM_NAMED("Task", "no JointModelGroup actuates the joints of SubTrajectory " << description);
+				return false;
+			}
+			if (group != executed->getGroup()) {  // shallow copy, sharing the waypoints
+				executed = std::make_shared<robot_trajectory::RobotTrajectory>(*executed);
+				executed->setGroupName(group->getName());
+			}
+			if (!predicted_scene->isPathValid(*executed, group->getName())) {
+				ROS_ERROR_STREAM_NAMED("Task", "SubTrajectory " << description << " is invalid in its scene");
+				return false;
+			}
+		}
+
+		// each trajectory is executed in the scene resulting from all preceding effects
+		auto diff = std::make_shared<moveit_msgs::PlanningScene>();
+		part->end()->scene()->getPlanningSceneDiffMsg(*diff);
+		predicted_scene = utils::predictScene(predicted_scene, *diff);
+		exec_traj.effect_on_success_ = [monitor, diff](const plan_execution::ExecutableMotionPlan* /*plan*/) {
+#if MOVEIT_HAS_MESSAGE_CHECKS
+			if (moveit::core::isEmpty(*diff))
+#else
+			if (planning_scene::PlanningScene::isEmpty(*diff))
+#endif
+				return true;
+			return monitor->newPlanningSceneMessage(*diff);
+		};
+	}
+	return true;
+}
+
+moveit::core::MoveItErrorCode Task::execute(const SolutionBase& s, plan_execution::PlanExecution& executor) {
+	const planning_scene_monitor::PlanningSceneMonitorPtr& monitor = executor.getPlanningSceneMonitor();
+	plan_execution::ExecutableMotionPlan plan;
+	plan.planning_scene_monitor_ = monitor;
+	planning_scene::PlanningScenePtr scene;
+	{  // validate against a snapshot of the monitored scene
+		planning_scene_monitor::LockedPlanningSceneRO locked(monitor);
+		scene = planning_scene::PlanningScene::clone(locked);
+	}
+	if (!TaskPrivate::constructMotionPlan(s, scene, plan))
+		return moveit::core::MoveItErrorCode(moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN);
+
+	auto impl = pimpl();
+	{
+		std::lock_guard<std::mutex> lock(impl->executor_mutex_);
+		impl->executor_ = &executor;
+	}
+	moveit::core::MoveItErrorCode result = executor.executeAndMonitor(plan);
+	std::lock_guard<std::mutex> lock(impl->executor_mutex_);
+	impl->executor_ = nullptr;
+	return result;
+}
+
 void Task::publishAllSolutions(bool wait) {
 	enableIntrospection(true);
 	pimpl()->introspection_->publishAllSolutions(wait);
 }
 
+size_t Task::publishSolutions(size_t count, size_t first) {
+	enableIntrospection(true);
+	return pimpl()->introspection_->publishSolutions(count, first);
+}
+
 void Task::onNewSolution(const SolutionBase& s) {
 	// no need to call WrapperBase::onNewSolution!
 	auto impl = pimpl();
-	for (const auto& cb : impl->solution_cbs_)
-		cb(s);
+	// solutions with lazily validated parts are announced once validateBestSolution() validated them
+	if (!TaskPrivate::validationPending(s))
+		impl->announceSolution(s, SolutionBaseConstPtr());
+	else if (SolutionBaseConstPtr solution = impl->findSolution(s))
+		impl->unannounced_.push_back(solution);
+	impl->updateCostBound();
 }
 
 ContainerBase* Task::stages() {
@@ -0,0 +1,147 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Plan multiple instances of a task concurrently
+*/
+
+#include <moveit/task_constructor/task_batch.h>
+#include <moveit/task_constructor/robot_model_cache.h>
+#include <moveit/task_constructor/task_executor.h>
+
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <ros/console.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <thread>
+
+namespace moveit {
+namespace task_constructor {
+
+TaskBatch::TaskBatch(size_t num_threads) {
+	setNumThreads(num_threads);
+}
+
+TaskBatch::~TaskBatch() {
+	tasks_.clear();
+	robot_model_.reset();
+	// only destroy loader after all references to the model are gone!
+	robot_model_loader_.reset();
+}
+
+void TaskBatch::setRobotModel(const moveit::core::RobotModelConstPtr& robot_model) {
+	robot_model_ = robot_model;
+	for (const auto& task : tasks_)
+		task->setRobotModel(robot_model);
+}
+
+void TaskBatch::loadRobotModel(const std::string& robot_description) {
+	robot_model_loader_ = RobotModelCache::load(robot_description);
+	setRobotModel(robot_model_loader_->getModel());
+}
+
+void TaskBatch::setNumThreads(size_t num_threads) {
+	if (num_threads == 0)
+		num_threads = std::thread::hardware_concurrency();
+	num_threads_ = std::max<size_t>(num_threads, 1);
+}
+
+void TaskBatch::add(TaskPtr task) {
+	if (!task)
+		throw std::runtime_error("TaskBatch: received invalid task");
+	if (robot_model_)
+		task->setRobotModel(robot_model_);
+	tasks_.push_back(std::move(task));
+}
+
+void TaskBatch::create(size_t num, const TaskFactory& factory) {
+	tasks_.reserve(tasks_.size() + num);
+	for (size_t i = 0; i != num; ++i)
+		add(factory(tasks_.size()));
+}
+
+void TaskBatch::clear() {
+	tasks_.clear();
+}
+
+std::vector<TaskBatch::Result> TaskBatch::plan(size_t max_solutions) {
+	// load the robot model only once for all tasks
+	if (!robot_model_ && !tasks_.empty())
+		loadRobotModel();
+
+	std::vector<Result> results(tasks_.size());
+	std::atomic<size_t> next{ 0 };
+	auto worker = [&]() {
+		for (size_t i = next++; i < tasks_.size(); i = next++) {
+			Result& result = results[i];
+			result.index = i;
+			const auto start = std::chrono::steady_clock::now();
+			try {
+				result.error_code = tasks_[i]->plan(max_solutions);
+			} catch (const std::exception& e) {
+				ROS_ERROR_STREAM_NAMED("TaskBatch", "planning task " << i << " failed: " << e.what());
+				result.error_code = moveit::core::MoveItErrorCode::FAILURE;
+			}
+			result.planning_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			const auto& solutions = tasks_[i]->solutions();
+			result.cost = solutions.empty() ? std::numeric_limits<double>::infinity() : solutions.front()->cost();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	const size_t num_threads = std::min(num_threads_, tasks_.size());
+	threads.reserve(num_threads);
+	const TaskExecutorPtr executor = TaskExecutor::current();
+	for (size_t i = 0; i != num_threads; ++i)
+		threads.push_back(executor->spawn(worker));
+	for (auto& thread : threads)
+		thread.join();
+
+	// rank successful tasks by cost of their best solution, keeping failures last
+	std::stable_sort(results.begin(), results.end(), [](const Result& a, const Result& b) {
+		if (bool(a.error_code) != bool(b.error_code))
+			return bool(a.error_code);
+		return a.cost < b.cost;
+	});
+	return results;
+}
+
+void TaskBatch::preempt() {
+	for (const auto& task : tasks_)
+		task->preempt();
+}
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,244 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Benchmark repeated planning of a task, exporting the results as JSON
+*/
+
+#include <moveit/task_constructor/task_benchmark.h>
+#include <moveit/task_constructor/container.h>
+#include <ros/console.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <mutex>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+constexpr char LOGNAME[] = "TaskBenchmark";
+
+// reset the process' peak RSS (VmHWM) to its current RSS
+bool resetPeakRSS() {
+	std::ofstream clear_refs("/proc/self/clear_refs");
+	clear_refs << "5";
+	clear_refs.close();
+	return bool(clear_refs);
+}
+
+// process' peak RSS [kB] since start or last resetPeakRSS()
+long peakRSS() {
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+		if (line.compare(0, 6, "VmHWM:") == 0)
+			return std::strtol(line.c_str() + 6, nullptr, 10);
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return usage.ru_maxrss;  // kB on Linux
+}
+
+void writeEscaped(std::ostream& os, const std::string& s) {
+	os << '"';
+	for (char c : s) {
+		if (c == '"' || c == '\\')
+			os << '\\' << c;
+		else if (static_cast<unsigned char>(c) >= 0x20)
+			os << c;
+	}
+	os << '"';
+}
+
+// JSON cannot represent inf or nan
+void writeNumber(std::ostream& os, double value) {
+	if (std::isfinite(value))
+		os << value;
+	else
+		os << "null";
+}
+
+double mean(const std::vector<TaskBenchmark::Run>& runs, double TaskBenchmark::Run::*member) {
+	double sum = 0.0;
+	size_t count = 0;
+	for (const auto& run : runs) {
+		if (!std::isfinite(run.*member))
+			continue;
+		sum += run.*member;
+		++count;
+	}
+	return count ? sum / count : std::numeric_limits<double>::quiet_NaN();
+}
+}  // namespace
+
+TaskBenchmark::TaskBenchmark(const std::string& name, const TaskFactory& factory) : name_(name), factory_(factory) {}
+
+const std::vector<TaskBenchmark::Run>& TaskBenchmark::run() {
+	runs_.clear();
+	runs_.reserve(repetitions_);
+	for (size_t i = 0; i != repetitions_; ++i) {
+		runs_.push_back(runOnce(seed_ + i));
+		const Run& r = runs_.back();
+		ROS_INFO_STREAM_NAMED(LOGNAME, name_ << " run " << i + 1 << "/" << repetitions_ << ": " << r.solutions
+		                                     << " solutions in " << r.planning_time << "s, first after "
+		                                     << r.time_to_first_solution << "s");
+	}
+	return runs_;
+}
+
+TaskBenchmark::Run TaskBenchmark::runOnce(unsigned int seed) {
+	using clock = std::chrono::steady_clock;
+	const double inf = std::numeric_limits<double>::infinity();
+
+	Run result;
+	result.seed = seed;
+	result.time_to_first_solution = inf;
+
+	std::srand(seed);
+	TaskPtr task = factory_(seed);
+
+	clock::time_point start;
+	std::once_flag first_solution;
+	auto callback = task->addSolutionCallback([&](const SolutionBase& /*s*/) {
+		std::call_once(first_solution, [&]() {
+			result.time_to_first_solution = std::chrono::duration<double>(clock::now() - start).count();
+		});
+	});
+
+	result.peak_rss_per_run = resetPeakRSS();
+	start = clock::now();
+	try {
+		result.error_code = task->plan(max_solutions_);
+	} catch (const std::exception& e) {
+		ROS_ERROR_STREAM_NAMED(LOGNAME, name_ << " planning failed: " << e.what());
+		result.error_code = moveit::core::MoveItErrorCode::FAILURE;
+	}
+	result.planning_time = std::chrono::duration<double>(clock::now() - start).count();
+	result.peak_rss = peakRSS();
+	task->removeSolutionCallback(callback);
+
+	const auto& solutions = task->solutions();
+	result.solutions = solutions.size();
+	result.solutions_per_second = result.planning_time > 0.0 ? result.solutions / result.planning_time : inf;
+	result.best_cost = solutions.empty() ? inf : solutions.front()->cost();
+
+	auto record = [&result](const Stage& stage, unsigned int depth) {
+		StageResult s;
+		s.name = stage.name();
+		s.depth = depth;
+		s.solutions = stage.solutions().size();
+		s.failures = stage.numFailures();
+		s.compute_time = stage.getTotalComputeTime();
+		s.compute_calls = stage.computeLatency().count();
+		s.compute_latency_median = stage.computeLatency().quantile(0.5);
+		s.solution_latency_mean = stage.solutionLatency().mean();
+		s.memory = stage.memoryUsage();
+		result.stages.push_back(std::move(s));
+		return true;
+	};
+	task->stages()->traverseRecursively(record);  // includes the root at depth 0
+	return result;
+}
+
+void TaskBenchmark::writeJson(std::ostream& os) const {
+	os << "{\"name\":";
+	writeEscaped(os, name_);
+	os << ",\"repetitions\":" << repetitions_ << ",\"seed\":" << seed_ << ",\"max_solutions\":" << max_solutions_;
+
+	os << ",\"runs\":[";
+	for (auto run = runs_.cbegin(), end = runs_.cend(); run != end; ++run) {
+		if (run != runs_.cbegin())
+			os << ',';
+		os << "\n{\"seed\":" << run->seed << ",\"error_code\":" << run->error_code.val << ",\"time_to_first_solution\":";
+		writeNumber(os, run->time_to_first_solution);
+		os << ",\"planning_time\":" << run->planning_time << ",\"solutions\":" << run->solutions
+		   << ",\"solutions_per_second\":";
+		writeNumber(os, run->solutions_per_second);
+		os << ",\"best_cost\":";
+		writeNumber(os, run->best_cost);
+		os << ",\"peak_rss_kb\":" << run->peak_rss
+		   << ",\"peak_rss_per_run\":" << (run->peak_rss_per_run ? "true" : "false") << ",\"stages\":[";
+		for (auto stage = run->stages.cbegin(), stages_end = run->stages.cend(); stage != stages_end; ++stage) {
+			if (stage != run->stages.cbegin())
+				os << ',';
+			os << "\n {\"name\":";
+			writeEscaped(os, stage->name);
+			os << ",\"depth\":" << stage->depth << ",\"solutions\":" << stage->solutions
+			   << ",\"failures\":" << stage->failures << ",\"compute_time\":" << stage->compute_time
+			   << ",\"compute_calls\":" << stage->compute_calls
+			   << ",\"compute_latency_median\":" << stage->compute_latency_median
+			   << ",\"solution_latency_mean\":" << stage->solution_latency_mean
+			   << ",\"memory\":{\"states\":" << stage->memory.states << ",\"scenes\":" << stage->memory.scenes
+			   << ",\"trajectories\":" << stage->memory.trajectories << ",\"markers\":" << stage->memory.markers
+			   << "}}";
+		}
+		os << "]}";
+	}
+	os << "]";
+
+	size_t succeeded = std::count_if(runs_.begin(), runs_.end(), [](const Run& r) { return bool(r.error_code); });
+	long peak_rss = 0;
+	for (const auto& run : runs_)
+		peak_rss = std::max(peak_rss, run.peak_rss);
+	os << ",\n\"summary\":{\"succeeded\":" << succeeded << ",\"mean_time_to_first_solution\":";
+	writeNumber(os, mean(runs_, &Run::time_to_first_solution));
+	os << ",\"mean_planning_time\":";
+	writeNumber(os, mean(runs_, &Run::planning_time));
+	os << ",\"mean_solutions_per_second\":";
+	writeNumber(os, mean(runs_, &Run::solutions_per_second));
+	os << ",\"mean_best_cost\":";
+	writeNumber(os, mean(runs_, &Run::best_cost));
+	os << ",\"peak_rss_kb\":" << peak_rss << "}}\n";
+}
+
+bool TaskBenchmark::writeJson(const std::string& file) const {
+	std::ofstream os(file);
+	if (os)
+		writeJson(os);
+	if (!os) {
+		ROS_ERROR_STREAM_NAMED(LOGNAME, "Failed to write benchmark results to '" << file << "'");
+		return false;
+	}
+	return true;
+}
+
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,226 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    executor running the threads of planning, asynchronous planners, publishing, and callbacks
+*/
+
+#include <moveit/task_constructor/task_executor.h>
+#include <moveit/task_constructor/recording.h>
+#include <ros/console.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+struct Registry
+{
+	std::mutex mutex;
+	TaskExecutorPtr executor;
+};
+
+Registry& registry() {
+	static Registry registry;
+	return registry;
+}
+
+thread_local std::weak_ptr<TaskExecutor> active_executor;
+}  // namespace
+
+TaskExecutor::Activation::Activation(std::weak_ptr<TaskExecutor> executor)
+  : previous_(std::move(active_executor)) {
+	active_executor = std::move(executor);
+}
+
+TaskExecutor::Activation::~Activation() {
+	active_executor = std::move(previous_);
+}
+
+TaskExecutor::Slot& TaskExecutor::Slot::operator=(Slot&& other) {
+	if (this != &other) {
+		release();
+		executor_ = other.executor_;
+		other.executor_ = nullptr;
+	}
+	return *this;
+}
+
+void TaskExecutor::Slot::release() {
+	if (!executor_)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(executor_->mutex_);
+		--executor_->busy_slots_;
+	}
+	executor_->slots_cv_.notify_one();
+	executor_ = nullptr;
+}
+
+TaskExecutor::TaskExecutor(Options options) : options_(std::move(options)) {}
+
+TaskExecutor::~TaskExecutor() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	jobs_cv_.notify_all();
+	for (auto& worker : workers_)
+		worker.join();
+}
+
+bool TaskExecutor::configureThread(const Options& options) {
+	bool success = true;
+	if (!options.cpus.empty()) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int cpu : options.cpus)
+			if (cpu >= 0 && cpu < CPU_SETSIZE)
+				CPU_SET(cpu, &set);
+		if (int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+			ROS_WARN_STREAM_NAMED("TaskExecutor", "Failed to set CPU affinity: " << strerror(err));
+			success = false;
+		}
+	}
+	if (options.policy >= 0) {
+		sched_param param;
+		param.sched_priority = options.priority;
+		if (int err = pthread_setschedparam(pthread_self(), options.policy, &param)) {
+			ROS_WARN_STREAM_NAMED("TaskExecutor", "Failed to set scheduling policy: " << strerror(err));
+			success = false;
+		}
+	}
+	// on Linux, the nice value is a per-thread attribute
+	if (options.nice != 0 && setpriority(PRIO_PROCESS, syscall(SYS_gettid), options.nice) != 0) {
+		ROS_WARN_STREAM_NAMED("TaskExecutor", "Failed to set nice value: " << strerror(errno));
+		success = false;
+	}
+	return success;
+}
+
+std::thread TaskExecutor::spawn(std::function<void()> fn) const {
+	// spawned threads record into the planning record of their parent and use its executor
+	PlanningRecord* record = PlanningRecord::active();
+	std::weak_ptr<TaskExecutor> active = active_executor;
+	if (!options_.configures())
+		return std::thread([record, active, fn = std::move(fn)]() {
+			PlanningRecord::Activation activation(record);
+			Activation executor_activation(active);
+			fn();
+		});
+	// the thread might outlive the executor: copy options
+	return std::thread([options = options_, record, active, fn = std::move(fn)]() {
+		configureThread(options);
+		PlanningRecord::Activation activation(record);
+		Activation executor_activation(active);
+		fn();
+	});
+}
+
+void TaskExecutor::post(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back([active = active_executor, job = std::move(job)]() {
+			Activation activation(active);
+			job();
+		});
+		if (workers_.empty()) {
+			PlanningRecord::Activation no_record(nullptr);  // pooled workers outlive any planning record
+			Activation no_executor{ std::weak_ptr<TaskExecutor>() };  // jobs activate the executor of their poster
+			unsigned int num_threads = options_.num_threads;
+			if (num_threads == 0)
+				num_threads = std::max(2u, std::thread::hardware_concurrency());
+			for (unsigned int i = 0; i < num_threads; ++i)
+				workers_.push_back(spawn([this]() { run(); }));
+		}
+	}
+	jobs_cv_.notify_one();
+}
+
+void TaskExecutor::run() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		jobs_cv_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+		if (jobs_.empty())
+			return;  // stopped
+		auto job = std::move(jobs_.front());
+		jobs_.pop_front();
+		lock.unlock();
+		job();
+		lock.lock();
+	}
+}
+
+TaskExecutor::Slot TaskExecutor::acquire() {
+	if (options_.max_concurrency == 0)
+		return Slot();
+	std::unique_lock<std::mutex> lock(mutex_);
+	slots_cv_.wait(lock, [this]() { return busy_slots_ < options_.max_concurrency; });
+	++busy_slots_;
+	return Slot(this);
+}
+
+TaskExecutorPtr TaskExecutor::instance() {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	if (!r.executor)
+		r.executor = std::make_shared<TaskExecutor>();
+	return r.executor;
+}
+
+void TaskExecutor::setInstance(const TaskExecutorPtr& executor) {
+	Registry& r = registry();
+	TaskExecutorPtr previous;  // finishes its jobs outside the lock, as they might access instance()
+	{
+		std::lock_guard<std::mutex> lock(r.mutex);
+		previous = std::move(r.executor);
+		r.executor = executor;
+	}
+}
+
+TaskExecutorPtr TaskExecutor::current() {
+	if (TaskExecutorPtr executor = active_executor.lock())
+		return executor;
+	return instance();
+}
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,191 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Declarative task descriptions, compiled once into templates for cheap instantiation
+*/
+
+#include <moveit/task_constructor/task_template.h>
+#include <moveit/task_constructor/container.h>
+
+#include <xmlrpcpp/XmlRpcValue.h>
+
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+std::string toText(XmlRpc::XmlRpcValue& value, const std::string& key) {
+	switch (value.getType()) {
+		case XmlRpc::XmlRpcValue::TypeString:
+			return static_cast<std::string&>(value);
+		case XmlRpc::XmlRpcValue::TypeBoolean:
+			return static_cast<bool>(value) ? "1" : "0";
+		case XmlRpc::XmlRpcValue::TypeInt:
+			return std::to_string(static_cast<int>(value));
+		case XmlRpc::XmlRpcValue::TypeDouble: {
+			std::ostringstream oss;
+			oss << std::setprecision(std::numeric_limits<double>::max_digits10) << static_cast<double>(value);
+			return oss.str();
+		}
+		default:
+			throw std::runtime_error("property '" + key + "': only scalar values are supported");
+	}
+}
+}  // namespace
+
+StageDescription StageDescription::fromXmlRpc(XmlRpc::XmlRpcValue& value) {
+	if (value.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+		throw std::runtime_error("stage description needs to be a dictionary");
+
+	StageDescription result;
+	if (value.hasMember("type"))
+		result.class_id = toText(value["type"], "type");
+	if (value.hasMember("name"))
+		result.name = toText(value["name"], "name");
+	if (value.hasMember("properties")) {
+		XmlRpc::XmlRpcValue& properties = value["properties"];
+		if (properties.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+			throw std::runtime_error("properties of '" + result.name + "' need to be a dictionary");
+		for (auto& pair : properties)
+			result.properties[pair.first] = toText(pair.second, pair.first);
+	}
+	if (value.hasMember("stages")) {
+		XmlRpc::XmlRpcValue& stages = value["stages"];
+		if (stages.getType() != XmlRpc::XmlRpcValue::TypeArray)
+			throw std::runtime_error("stages of '" + result.name + "' need to be a list");
+		for (int i = 0; i < stages.size(); ++i)
+			result.children.push_back(fromXmlRpc(stages[i]));
+	}
+	return result;
+}
+
+TaskTemplate::TaskTemplate(const StageDescription& description) {
+	const std::string path = description.name.empty() ? "task" : description.name;
+	Task task("", false);
+	SerialContainer stages;  // the task's top-level container
+	root_.name = description.name;
+	root_.properties = compileProperties(description, task.properties(), path);
+	root_.children = compileChildren(description, stages, path);
+}
+
+TaskTemplate::Properties TaskTemplate::compileProperties(const StageDescription& description, PropertyMap& declared,
+                                                         const std::string& path) {
+	// parse and validate property values against the prototype's declarations
+	Properties result;
+	for (const auto& pair : description.properties) {
+		const std::string& key = pair.first;
+		try {
+			Property& property = declared.property(key);
+			// untyped properties (without a value) receive the text, e.g. a named goal of MoveTo
+			const std::string type_name = property.typeName();
+			boost::any value = type_name.empty() ? boost::any(pair.second) : Property::deserialize(type_name, pair.second);
+			if (value.empty())
+				throw std::runtime_error("cannot parse '" + pair.second + "' as " + property.typeName());
+			declared.set(key, value);  // type check
+			result.emplace_back(key, std::move(value));
+		} catch (const std::exception& e) {
+			throw std::runtime_error(path + ": property '" + key + "': " + e.what());
+		}
+	}
+	return result;
+}
+
+std::vector<TaskTemplate::Node> TaskTemplate::compileChildren(const StageDescription& description,
+                                                              ContainerBase& prototype, const std::string& path) {
+	std::vector<Node> result;
+	for (const StageDescription& child : description.children)
+		result.push_back(compile(child, path + "/" + (child.name.empty() ? child.class_id : child.name)));
+	// check that the container accepts its children, e.g. wrappers only accept a single one
+	try {
+		for (const Node& child : result)
+			prototype.add(create(child));
+	} catch (const std::exception& e) {
+		throw std::runtime_error(path + ": " + e.what());
+	}
+	return result;
+}
+
+TaskTemplate::Node TaskTemplate::compile(const StageDescription& description, const std::string& path) {
+	Node node;
+	node.name = description.name;
+	try {
+		node.factory = StageRegistry::instance().factory(description.class_id);
+	} catch (const std::exception& e) {
+		throw std::runtime_error(path + ": " + e.what());
+	}
+
+	Stage::pointer prototype(node.factory());
+	node.properties = compileProperties(description, prototype->properties(), path);
+	if (description.children.empty())
+		return node;
+
+	auto* container = dynamic_cast<ContainerBase*>(prototype.get());
+	if (!container)
+		throw std::runtime_error(path + ": only containers can have child stages");
+	node.children = compileChildren(description, *container, path);
+	return node;
+}
+
+Stage::pointer TaskTemplate::create(const Node& node) {
+	Stage::pointer stage(node.factory());
+	if (!node.name.empty())
+		stage->setName(node.name);
+	PropertyMap& properties = stage->properties();
+	for (const auto& pair : node.properties)
+		properties.set(pair.first, pair.second);
+	if (!node.children.empty()) {
+		auto* container = static_cast<ContainerBase*>(stage.get());
+		for (const Node& child : node.children)
+			container->add(create(child));
+	}
+	return stage;
+}
+
+TaskPtr TaskTemplate::instantiate() const {
+	auto task = std::make_shared<Task>();
+	if (!root_.name.empty())
+		task->setName(root_.name);
+	PropertyMap& properties = task->properties();
+	for (const auto& pair : root_.properties)
+		properties.set(pair.first, pair.second);
+	for (const Node& child : root_.children)
+		task->add(create(child));
+	return task;
+}
+}  // namespace task_constructor
+}  // namespace moveit
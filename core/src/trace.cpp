@@ -0,0 +1,141 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Lightweight tracing of compute timelines, exported as Chrome trace JSON
+*/
+
+#include <moveit/task_constructor/trace.h>
+#include <ros/console.h>
+
+#include <cstdlib>
+#include <fstream>
+
+namespace moveit {
+namespace task_constructor {
+
+std::atomic<bool> Tracer::enabled_{ std::getenv("MTC_TRACE_FILE") && *std::getenv("MTC_TRACE_FILE") };
+constexpr std::size_t Tracer::MAX_EVENTS;
+
+namespace {
+// small, sequential thread ids are easier to read in trace viewers than std::thread::id
+uint32_t threadId() {
+	static std::atomic<uint32_t> next{ 1 };
+	thread_local uint32_t id = next++;
+	return id;
+}
+
+void writeEscaped(std::ostream& os, const std::string& s) {
+	for (char c : s) {
+		if (c == '"' || c == '\\')
+			os << '\\' << c;
+		else if (static_cast<unsigned char>(c) >= 0x20)
+			os << c;
+	}
+}
+}  // namespace
+
+Tracer& Tracer::instance() {
+	static Tracer tracer;
+	return tracer;
+}
+
+Tracer::Tracer() : origin_(std::chrono::steady_clock::now()) {
+	if (const char* file = std::getenv("MTC_TRACE_FILE"))
+		file_ = file;
+}
+
+Tracer::~Tracer() {
+	if (!file_.empty())
+		save(file_);
+}
+
+void Tracer::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	events_.clear();
+	dropped_ = 0;
+}
+
+void Tracer::record(const char* category, const char* name, uint32_t id, std::chrono::steady_clock::time_point start,
+                    std::chrono::steady_clock::time_point stop) {
+	using std::chrono::duration_cast;
+	using std::chrono::microseconds;
+	Event e{ category, name, id, threadId(), duration_cast<microseconds>(start - origin_).count(),
+		      duration_cast<microseconds>(stop - start).count() };
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (events_.size() < MAX_EVENTS)
+		events_.push_back(std::move(e));
+	else
+		++dropped_;
+}
+
+std::vector<Tracer::Event> Tracer::events() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return events_;
+}
+
+void Tracer::write(std::ostream& os) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (const Event& e : events_) {
+		if (!first)
+			os << ",\n";
+		first = false;
+		os << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread << ",\"ts\":" << e.start << ",\"dur\":" << e.duration
+		   << ",\"cat\":\"" << e.category << "\",\"name\":\"";
+		writeEscaped(os, e.name);
+		os << '"';
+		if (e.id)
+			os << ",\"args\":{\"solution_id\":" << e.id << '}';
+		os << '}';
+	}
+	os << "]}\n";
+	if (dropped_)
+		ROS_WARN_STREAM_NAMED("Tracer", "Dropped " << dropped_ << " trace events exceeding " << MAX_EVENTS);
+}
+
+bool Tracer::save(const std::string& file) const {
+	std::ofstream os(file);
+	if (os)
+		write(os);
+	if (!os) {
+		ROS_ERROR_STREAM_NAMED("Tracer", "Failed to write trace to '" << file << "'");
+		return false;
+	}
+	return true;
+}
+
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,244 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    lossy, error-bounded compression of robot trajectories
+*/
+
+#include <moveit/task_constructor/trajectory_compression.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_model/robot_model.h>
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+// interpolation parameter of waypoint i within segment [a, b], falling back to indices for zero durations
+double interpolation(const std::vector<double>& times, size_t a, size_t b, size_t i) {
+	const double span = times[b] - times[a];
+	return span > 0.0 ? (times[i] - times[a]) / span : static_cast<double>(i - a) / (b - a);
+}
+
+/* indices of waypoints to retain (including first and last), such that all dropped ones are linearly
+ * interpolated from their retained neighbours within tolerance: Ramer-Douglas-Peucker w.r.t. max-norm in time
+ */
+template <typename Position>
+std::vector<size_t> decimate(size_t count, size_t variables, const std::vector<double>& times,
+                             const Position& position, double tolerance) {
+	std::vector<bool> keep(count, false);
+	keep.front() = keep.back() = true;
+	std::vector<std::pair<size_t, size_t>> segments{ { 0, count - 1 } };
+	while (!segments.empty()) {
+		const size_t a = segments.back().first;
+		const size_t b = segments.back().second;
+		segments.pop_back();
+
+		double max_error = 0.0;
+		size_t split = a;
+		for (size_t i = a + 1; i < b; ++i) {
+			const double alpha = interpolation(times, a, b, i);
+			for (size_t v = 0; v < variables; ++v) {
+				const double error =
+				    std::abs(position(i, v) - (position(a, v) + alpha * (position(b, v) - position(a, v))));
+				if (!(error <= max_error)) {  // also catches NaN
+					max_error = error;
+					split = i;
+				}
+			}
+		}
+		if (!(max_error <= tolerance)) {
+			keep[split] = true;
+			segments.emplace_back(a, split);
+			segments.emplace_back(split, b);
+		}
+	}
+
+	std::vector<size_t> retained;
+	for (size_t i = 0; i != count; ++i)
+		if (keep[i])
+			retained.push_back(i);
+	return retained;
+}
+
+size_t stateMemory(const moveit::core::RobotModel& model) {
+	return sizeof(moveit::core::RobotState) + 3 * model.getVariableCount() * sizeof(double) +
+	       (model.getJointModelCount() + model.getLinkModelCount()) * sizeof(Eigen::Isometry3d);
+}
+}  // namespace
+
+CompressedTrajectoryConstPtr CompressedTrajectory::compress(const robot_trajectory::RobotTrajectory& trajectory,
+                                                            double tolerance) {
+	const size_t count = trajectory.getWayPointCount();
+	if (count < 3 || count > std::numeric_limits<uint32_t>::max() || !(tolerance > 0.0))
+		return nullptr;
+
+	std::shared_ptr<CompressedTrajectory> result(new CompressedTrajectory());
+	result->group_ = trajectory.getGroupName();
+	result->quantum_ = tolerance / 2.0;
+	result->variables_ = trajectory.getRobotModel()->getVariableCount();
+
+	// timing is stored with float precision: decimate w.r.t. the times reproduced by decompress()
+	std::vector<double> times;
+	times.reserve(count);
+	result->durations_.reserve(count);
+	double time = 0.0;
+	for (size_t i = 0; i != count; ++i) {
+		result->durations_.push_back(static_cast<float>(trajectory.getWayPointDurationFromPrevious(i)));
+		time += result->durations_.back();
+		times.push_back(time);
+	}
+
+	// Dropped waypoints deviate less than quantum from the interpolation of exact positions.
+	// Quantization of the retained ones adds at most quantum / 2, yielding an error below tolerance.
+	auto position = [&trajectory](size_t i, size_t v) { return trajectory.getWayPoint(i).getVariablePosition(v); };
+	const std::vector<size_t> retained = decimate(count, result->variables_, times, position, result->quantum_);
+
+	const double* reference = trajectory.getFirstWayPoint().getVariablePositions();
+	std::vector<int64_t> previous(result->variables_, 0);
+	result->retained_.reserve(retained.size());
+	result->deltas_.reserve(retained.size() * result->variables_);
+	for (size_t i : retained) {
+		result->retained_.push_back(static_cast<uint32_t>(i));
+		const double* positions = trajectory.getWayPoint(i).getVariablePositions();
+		for (size_t v = 0; v != result->variables_; ++v) {
+			const double steps = std::round((positions[v] - reference[v]) / result->quantum_);
+			if (!(std::abs(steps) <= std::numeric_limits<int32_t>::max()))
+				return nullptr;
+			const int64_t delta = static_cast<int64_t>(steps) - previous[v];
+			if (delta < std::numeric_limits<int32_t>::min() || delta > std::numeric_limits<int32_t>::max())
+				return nullptr;
+			result->deltas_.push_back(static_cast<int32_t>(delta));
+			previous[v] = static_cast<int64_t>(steps);
+		}
+	}
+
+	result->first_ = std::make_shared<moveit::core::RobotState>(trajectory.getFirstWayPoint());
+	result->last_ = std::make_shared<moveit::core::RobotState>(trajectory.getLastWayPoint());
+	return result;
+}
+
+robot_trajectory::RobotTrajectoryPtr CompressedTrajectory::decompress() const {
+	const size_t count = durations_.size();
+	auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(first_->getRobotModel(), group_);
+
+	// positions of retained waypoints
+	Eigen::MatrixXd retained(variables_, retained_.size());
+	const Eigen::Map<const Eigen::VectorXd> reference(first_->getVariablePositions(), variables_);
+	Eigen::Matrix<int64_t, Eigen::Dynamic, 1> steps = Eigen::Matrix<int64_t, Eigen::Dynamic, 1>::Zero(variables_);
+	for (size_t r = 0; r != retained_.size(); ++r) {
+		steps += Eigen::Map<const Eigen::Matrix<int32_t, Eigen::Dynamic, 1>>(&deltas_[r * variables_], variables_)
+		             .cast<int64_t>();
+		retained.col(r) = reference + quantum_ * steps.cast<double>();
+	}
+
+	// interpolate dropped waypoints, first and last are exact
+	std::vector<double> times(count);
+	double time = 0.0;
+	for (size_t i = 0; i != count; ++i)
+		times[i] = time += durations_[i];
+	Eigen::MatrixXd positions(variables_, count);
+	for (size_t i = 0, r = 0; i != count; ++i) {
+		while (retained_[r + 1] < i)
+			++r;
+		const double alpha = interpolation(times, retained_[r], retained_[r + 1], i);
+		positions.col(i) = retained.col(r) + alpha * (retained.col(r + 1) - retained.col(r));
+	}
+	positions.col(0) = reference;
+	positions.col(count - 1) = Eigen::Map<const Eigen::VectorXd>(last_->getVariablePositions(), variables_);
+
+	trajectory->addSuffixWayPoint(std::make_shared<moveit::core::RobotState>(*first_), durations_[0]);
+	for (size_t i = 1; i + 1 < count; ++i) {
+		auto state = std::make_shared<moveit::core::RobotState>(*first_);
+		state->setVariablePositions(positions.col(i).data());
+		const double h1 = times[i] - times[i - 1];
+		const double h2 = times[i + 1] - times[i];
+		if (first_->hasVelocities()) {
+			Eigen::VectorXd v = Eigen::VectorXd::Zero(variables_);
+			if (h1 + h2 > 0.0)
+				v = (positions.col(i + 1) - positions.col(i - 1)) / (h1 + h2);
+			state->setVariableVelocities(v.data());
+		}
+		if (first_->hasAccelerations()) {
+			Eigen::VectorXd a = Eigen::VectorXd::Zero(variables_);
+			if (h1 > 0.0 && h2 > 0.0)
+				a = 2.0 *
+				    ((positions.col(i + 1) - positions.col(i)) / h2 - (positions.col(i) - positions.col(i - 1)) / h1) /
+				    (h1 + h2);
+			state->setVariableAccelerations(a.data());
+		}
+		state->update();
+		trajectory->addSuffixWayPoint(state, durations_[i]);
+	}
+	trajectory->addSuffixWayPoint(std::make_shared<moveit::core::RobotState>(*last_), durations_[count - 1]);
+	return trajectory;
+}
+
+size_t CompressedTrajectory::memory() const {
+	return sizeof(CompressedTrajectory) + 2 * stateMemory(*first_->getRobotModel()) +
+	       durations_.capacity() * sizeof(float) + retained_.capacity() * sizeof(uint32_t) +
+	       deltas_.capacity() * sizeof(int32_t);
+}
+
+void decimateTrajectory(trajectory_msgs::JointTrajectory& msg, double tolerance) {
+	const size_t count = msg.points.size();
+	const size_t variables = msg.joint_names.size();
+	if (count < 3 || !(tolerance > 0.0))
+		return;
+	for (const trajectory_msgs::JointTrajectoryPoint& point : msg.points)
+		if (point.positions.size() != variables)
+			return;  // malformed message
+
+	std::vector<double> times;
+	times.reserve(count);
+	for (const trajectory_msgs::JointTrajectoryPoint& point : msg.points)
+		times.push_back(point.time_from_start.toSec());
+	auto position = [&msg](size_t i, size_t v) { return msg.points[i].positions[v]; };
+	const std::vector<size_t> retained = decimate(count, variables, times, position, tolerance);
+	if (retained.size() == count)
+		return;
+
+	std::vector<trajectory_msgs::JointTrajectoryPoint> points;
+	points.reserve(retained.size());
+	for (size_t i : retained)
+		points.push_back(std::move(msg.points[i]));
+	msg.points = std::move(points);
+}
+}  // namespace task_constructor
+}  // namespace moveit
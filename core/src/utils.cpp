@@ -37,17 +37,115 @@
 
 #include <tf2_eigen/tf2_eigen.h>
 
+#include <moveit/exceptions/exceptions.h>
+#include <moveit/robot_state/conversions.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/planning_scene/planning_scene.h>
 
 #include <moveit/task_constructor/moveit_compat.h>
+#if MOVEIT_HAS_MESSAGE_CHECKS
+#include <moveit/utils/message_checks.h>
+#endif
 #include <moveit/task_constructor/properties.h>
 #include <moveit/task_constructor/storage.h>
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <set>
+#include <vector>
+
 namespace moveit {
 namespace task_constructor {
 namespace utils {
 
+bool isSegmentColliding(const planning_scene::PlanningScene& scene, const moveit::core::RobotState& from,
+                        const moveit::core::RobotState& to, const std::string& group, double resolution) {
+	// FCL doesn't implement continuous checks (silently reporting no collision): sample the segment densely instead
+	if (scene.getActiveCollisionDetectorName() != "Bullet") {
+		double d = 0.0;
+		for (const moveit::core::JointModel* jm : from.getRobotModel()->getActiveJointModels())
+			d = std::max(d, jm->getDistanceFactor() * from.distance(to, jm));
+		const std::size_t steps = std::max<std::size_t>(1, std::ceil(d / std::max(resolution, 1e-6)));
+		moveit::core::RobotState state(from);
+		for (std::size_t i = 1; i < steps; ++i) {
+			from.interpolate(to, static_cast<double>(i) / steps, state);
+			state.update();
+			if (scene.isStateColliding(state, group))
+				return true;
+		}
+		return scene.isStateColliding(to, group);
+	}
+
+	collision_detection::CollisionRequest request;
+	request.group_name = group;
+	collision_detection::CollisionResult result;
+	const collision_detection::AllowedCollisionMatrix& acm = scene.getAllowedCollisionMatrix();
+#if MOVEIT_HAS_COLLISION_ENV
+	scene.getCollisionEnv()->checkRobotCollision(request, result, from, to, acm);
+#else
+	scene.getCollisionWorld()->checkRobotCollision(request, result, *scene.getCollisionRobot(), from, to, acm);
+#endif
+	if (result.collision)
+		return true;
+
+	result.clear();
+	scene.checkSelfCollision(request, result, to, acm);
+	return result.collision;
+}
+
+bool changesScene(const moveit_msgs::PlanningScene& scene_diff) {
+	// joint states are defined by the trajectories, but attached bodies are not
+	moveit_msgs::PlanningScene diff = scene_diff;
+	diff.robot_state.joint_state = sensor_msgs::JointState();
+	diff.robot_state.multi_dof_joint_state = sensor_msgs::MultiDOFJointState();
+#if MOVEIT_HAS_MESSAGE_CHECKS
+	return !moveit::core::isEmpty(diff);
+#else
+	return !planning_scene::PlanningScene::isEmpty(diff);
+#endif
+}
+
+planning_scene::PlanningScenePtr predictScene(const planning_scene::PlanningScenePtr& scene,
+                                              const moveit_msgs::PlanningScene& scene_diff) {
+	if (!changesScene(scene_diff))
+		return scene;
+	planning_scene::PlanningScenePtr predicted = scene->diff();
+	predicted->setPlanningSceneDiffMsg(scene_diff);
+	return predicted;
+}
+
+// TODO: move to moveit::core::RobotModel
+const moveit::core::JointModelGroup* findJointModelGroup(const moveit::core::RobotModel& model,
+                                                         const std::vector<std::string>& joints) {
+	std::set<std::string> joint_set(joints.begin(), joints.end());
+
+	const std::vector<const moveit::core::JointModelGroup*>& jmgs = model.getJointModelGroups();
+
+	for (const moveit::core::JointModelGroup* jmg : jmgs) {
+		const std::vector<std::string>& jmg_joints = jmg->getJointModelNames();
+		std::set<std::string> jmg_joint_set(jmg_joints.begin(), jmg_joints.end());
+
+		// return group if sets agree on all active joints
+		if (std::includes(jmg_joint_set.begin(), jmg_joint_set.end(), joint_set.begin(), joint_set.end())) {
+			std::set<std::string> difference;
+			std::set_difference(jmg_joint_set.begin(), jmg_joint_set.end(), joint_set.begin(), joint_set.end(),
+			                    std::inserter(difference, difference.begin()));
+			unsigned int acceptable = 0;
+			for (const std::string& diff_joint : difference) {
+				const moveit::core::JointModel* diff_jm = model.getJointModel(diff_joint);
+				if (diff_jm->isPassive() || diff_jm->getMimic() || diff_jm->getType() == moveit::core::JointModel::FIXED)
+					++acceptable;
+			}
+			if (difference.size() == acceptable)
+				return jmg;
+		}
+	}
+
+	return nullptr;
+}
+
 const moveit::core::LinkModel* getRigidlyConnectedParentLinkModel(const moveit::core::RobotState& state,
                                                                   std::string frame) {
 #if MOVEIT_HAS_STATE_RIGID_PARENT_LINK
@@ -108,6 +206,148 @@ bool getRobotTipForFrame(const Property& property, const planning_scene::Plannin
 	return true;
 }
 
+bool computeFramePositions(const robot_trajectory::RobotTrajectory& trajectory, const std::string& frame,
+                           Eigen::Matrix3Xd& positions) {
+	const size_t count = trajectory.getWayPointCount();
+	positions.resize(3, count);
+	if (count == 0)
+		return true;
+
+	const moveit::core::RobotState& first = trajectory.getWayPoint(0);
+	if (!first.knowsFrameTransform(frame))
+		return false;
+	const moveit::core::LinkModel* link = getRigidlyConnectedParentLinkModel(first, frame);
+	if (!link)
+		return false;
+	const Eigen::Vector3d offset =
+	    (first.getGlobalLinkTransform(link).inverse() * first.getFrameTransform(frame)).translation();
+
+	std::vector<const moveit::core::LinkModel*> chain;  // from root to link
+	for (const moveit::core::LinkModel* l = link; l; l = l->getParentLinkModel())
+		chain.push_back(l);
+	std::reverse(chain.begin(), chain.end());
+
+	std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d>> transforms(chain.size());
+	const double* previous = nullptr;
+	for (size_t i = 0; i < count; ++i) {
+		const double* values = trajectory.getWayPoint(i).getVariablePositions();
+		size_t k = 0;  // first link of the chain whose joint changed
+		for (; previous && k < chain.size(); ++k) {
+			const moveit::core::JointModel* joint = chain[k]->getParentJointModel();
+			const int index = joint->getFirstVariableIndex();
+			if (!std::equal(values + index, values + index + joint->getVariableCount(), previous + index))
+				break;
+		}
+		for (; k < chain.size(); ++k) {
+			const moveit::core::JointModel* joint = chain[k]->getParentJointModel();
+			Eigen::Isometry3d joint_transform;
+			joint->computeTransform(values + joint->getFirstVariableIndex(), joint_transform);
+			const Eigen::Isometry3d local = chain[k]->getJointOriginTransform() * joint_transform;
+			transforms[k] = k == 0 ? local : transforms[k - 1] * local;
+		}
+		positions.col(i) = transforms.back() * offset;
+		previous = values;
+	}
+	return true;
+}
+
+void estimateTimeStamps(robot_trajectory::RobotTrajectory& trajectory, double velocity_scaling) {
+	const moveit::core::JointModelGroup* jmg = trajectory.getGroup();
+	if (!jmg || trajectory.getWayPointCount() == 0)
+		return;
+
+	// inverse max velocity of all velocity-bounded variables
+	std::vector<std::pair<int, double>> inv_velocities;
+	const moveit::core::RobotModel& model = *trajectory.getRobotModel();
+	for (int index : jmg->getVariableIndexList()) {
+		const moveit::core::JointModel* joint = model.getJointOfVariable(index);
+		const moveit::core::VariableBounds& bounds = joint->getVariableBounds()[index - joint->getFirstVariableIndex()];
+		if (bounds.velocity_bounded_ && bounds.max_velocity_ > 0.0)
+			inv_velocities.emplace_back(index, 1.0 / (velocity_scaling * bounds.max_velocity_));
+	}
+
+	trajectory.setWayPointDurationFromPrevious(0, 0.0);
+	for (size_t i = 1; i < trajectory.getWayPointCount(); ++i) {
+		const double* from = trajectory.getWayPoint(i - 1).getVariablePositions();
+		const double* to = trajectory.getWayPoint(i).getVariablePositions();
+		double duration = 0.0;
+		for (const auto& variable : inv_velocities)
+			duration = std::max(duration, std::abs(to[variable.first] - from[variable.first]) * variable.second);
+		trajectory.setWayPointDurationFromPrevious(i, duration);
+	}
+}
+
+void JointPosture::clear() {
+	jmg_ = nullptr;
+	indices_.clear();
+	values_.clear();
+	fallback_.reset();
+}
+
+void JointPosture::validate(const std::string& joint) {
+	const auto& accepted = jmg_->getJointModelNames();
+	if (std::find(accepted.cbegin(), accepted.cend(), joint) == accepted.cend()) {
+		const std::string group = jmg_->getName();
+		clear();
+		throw moveit::Exception("joint '" + joint + "' is not part of group '" + group + "'");
+	}
+}
+
+void JointPosture::add(const std::string& joint, double value) {
+	validate(joint);
+	indices_.push_back(jmg_->getParentModel().getVariableIndex(joint));
+	values_.push_back(value);
+}
+
+void JointPosture::compile(const moveit::core::JointModelGroup* jmg, const std::string& named_state) {
+	clear();
+	std::map<std::string, double> values;
+	if (!jmg->getVariableDefaultPositions(named_state, values))
+		throw moveit::Exception("unknown state '" + named_state + "'");
+	jmg_ = jmg;
+	for (const auto& pair : values) {
+		indices_.push_back(jmg->getParentModel().getVariableIndex(pair.first));
+		values_.push_back(pair.second);
+	}
+}
+
+void JointPosture::compile(const moveit::core::JointModelGroup* jmg, const moveit_msgs::RobotState& diff,
+                           bool copy_attached_bodies) {
+	clear();
+	if (!diff.is_diff)
+		throw moveit::Exception("RobotState message must be a diff");
+	jmg_ = jmg;
+	copy_attached_bodies_ = copy_attached_bodies;
+	const sensor_msgs::JointState& js = diff.joint_state;
+	if (js.position.size() != js.name.size()) {
+		clear();
+		throw moveit::Exception("joint_state needs to specify a position for each joint");
+	}
+	for (size_t i = 0; i != js.name.size(); ++i)
+		add(js.name[i], js.position[i]);
+	for (const auto& name : diff.multi_dof_joint_state.joint_names)
+		validate(name);
+
+	if (!js.velocity.empty() || !js.effort.empty() || !diff.multi_dof_joint_state.joint_names.empty() ||
+	    (copy_attached_bodies && !diff.attached_collision_objects.empty()))
+		fallback_ = std::make_shared<const moveit_msgs::RobotState>(diff);
+}
+
+void JointPosture::compile(const moveit::core::JointModelGroup* jmg, const std::map<std::string, double>& joints) {
+	clear();
+	jmg_ = jmg;
+	for (const auto& joint : joints)
+		add(joint.first, joint.second);
+}
+
+void JointPosture::apply(moveit::core::RobotState& state) const {
+	if (fallback_) {
+		moveit::core::robotStateMsgToRobotState(*fallback_, state, copy_attached_bodies_);
+		return;
+	}
+	for (size_t i = 0; i != indices_.size(); ++i)
+		state.setVariablePosition(indices_[i], values_[i]);
+}
 }  // namespace utils
 }  // namespace task_constructor
 }  // namespace moveit
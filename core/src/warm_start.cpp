@@ -0,0 +1,79 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Caches keeping results of previous planning runs to warm-start the next ones
+*/
+
+#include <moveit/task_constructor/warm_start.h>
+#include <moveit/task_constructor/solvers/caching_planner.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace moveit {
+namespace task_constructor {
+
+solvers::PlannerInterfacePtr WarmStartCache::cachingPlanner(const solvers::PlannerInterfacePtr& planner) {
+	if (!planner || std::dynamic_pointer_cast<solvers::CachingPlanner>(planner))
+		return planner;
+	std::lock_guard<std::mutex> lock(mutex_);
+	pruneLocked();
+	PlannerWeakPtr& entry = planners_[planner];
+	solvers::PlannerInterfacePtr wrapper = entry.lock();
+	if (!wrapper) {
+		wrapper = std::make_shared<solvers::CachingPlanner>(planner);
+		entry = wrapper;
+	}
+	return wrapper;
+}
+
+void WarmStartCache::prune() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	pruneLocked();
+}
+
+void WarmStartCache::pruneLocked() {
+	for (auto it = planners_.begin(); it != planners_.end();)
+		it = it->second.expired() ? planners_.erase(it) : std::next(it);
+}
+
+size_t WarmStartCache::numPlanners() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return std::count_if(planners_.begin(), planners_.end(),
+	                     [](const std::pair<const PlannerWeakPtr, PlannerWeakPtr>& entry) {
+		                     return !entry.second.expired();
+	                     });
+}
+}  // namespace task_constructor
+}  // namespace moveit
@@ -17,6 +17,19 @@ RobotModelPtr getModel() {
 	return builder.build();
 }
 
+RobotModelPtr getArmModel() {
+	ros::console::set_logger_level(ROSCONSOLE_ROOT_LOGGER_NAME ".moveit_core.robot_model", ros::console::levels::Fatal);
+
+	geometry_msgs::Pose origin, offset;
+	origin.orientation.w = offset.orientation.w = 1.0;
+	offset.position.x = 1.0;
+	moveit::core::RobotModelBuilder builder("arm", "base");
+	builder.addChain("base->link1->tip", "continuous", { origin, offset }, urdf::Vector3(0, 0, 1));
+	builder.addCollisionBox("tip", { 0.1, 0.1, 0.1 }, origin);
+	builder.addGroupChain("base", "tip", "group");
+	return builder.build();
+}
+
 moveit::core::RobotModelPtr loadModel() {
 	static robot_model_loader::RobotModelLoader loader;
 	return loader.getModel();
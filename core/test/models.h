@@ -11,5 +11,8 @@ MOVEIT_CLASS_FORWARD(RobotModel);
 // get a hard-coded model
 moveit::core::RobotModelPtr getModel();
 
+// get a hard-coded model with collision geometry: a box at the tip of a 1m arm, revolving about z
+moveit::core::RobotModelPtr getArmModel();
+
 // load a model from robot_description
 moveit::core::RobotModelPtr loadModel();
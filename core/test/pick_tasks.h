@@ -0,0 +1,18 @@
+#pragma once
+
+#include <moveit/task_constructor/task.h>
+
+namespace moveit {
+namespace task_constructor {
+
+// pick tasks of the pick_* integration tests, shared with the planning benchmark
+
+/// pick with PA10's left arm from a fixed initial scene (loads robot_description)
+TaskPtr createPickPA10Task();
+/// pick with PR2's left arm, spawning the object into move_group's planning scene
+TaskPtr createPickPR2Task();
+/// pick with UR5, spawning the object into move_group's planning scene
+TaskPtr createPickUR5Task();
+
+}  // namespace task_constructor
+}  // namespace moveit
@@ -1,16 +1,43 @@
 #include <moveit/task_constructor/container_p.h>
 #include <moveit/task_constructor/stage_p.h>
+#include <moveit/task_constructor/stage_registry.h>
 #include <moveit/task_constructor/task_p.h>
+#include <moveit/task_constructor/metrics.h>
+#include <moveit/task_constructor/task_batch.h>
+#include <moveit/task_constructor/task_benchmark.h>
+#include <moveit/task_constructor/task_executor.h>
+#include <moveit/task_constructor/task_template.h>
+#include <moveit/task_constructor/warm_start.h>
+#include <moveit/task_constructor/preemption.h>
+#include <moveit/task_constructor/recording.h>
+#include <moveit/task_constructor/solution_store.h>
+#include <moveit/task_constructor/static_container.h>
+#include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/task_constructor/stages/connect.h>
 #include <moveit/task_constructor/stages/fixed_state.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/utils/robot_model_test_utils.h>
 
 #include "stage_mockups.h"
 #include "models.h"
 #include "gtest_value_printers.h"
 
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <gtest/gtest.h>
 #include <initializer_list>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <mutex>
+#include <sstream>
 #include <thread>
 
 using namespace moveit::task_constructor;
@@ -665,3 +692,1620 @@ TEST(Task, timeout) {
 	EXPECT_TRUE(t.plan());
 	EXPECT_EQ(t.solutions().size(), 2u);
 }
+
+// ForwardMockup recording the timeout available to each computation
+class TimeoutRecordingMockup : public ForwardMockup
+{
+public:
+	std::vector<double> timeouts_;
+	void computeForward(const InterfaceState& from) override {
+		timeouts_.push_back(timeout());
+		ForwardMockup::computeForward(from);
+	}
+};
+
+TEST(Task, anytime) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 3.0, 2.0, 1.0 })));
+	auto* fwd = new TimeoutRecordingMockup();
+	fwd->setTimeout(10.0);
+	t.add(Stage::pointer(fwd));
+
+	// keep planning beyond the first solution
+	EXPECT_TRUE(t.planAnytime(1.0));
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(1, 2, 3));
+	// stage timeout is limited by the budget
+	ASSERT_EQ(fwd->timeouts_.size(), 3u);
+	for (double timeout : fwd->timeouts_)
+		EXPECT_LE(timeout, 1.0);
+	// and restored afterwards
+	EXPECT_EQ(fwd->timeout(), 10.0);
+}
+
+TEST(Task, costPruning) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.enableCostPruning();
+
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 0.0, 0.0 })));
+	t.add(std::make_unique<ForwardMockup>(PredefinedCosts({ 1.0, 10.0 })));
+	auto* last = new ForwardMockup();
+	t.add(Stage::pointer(last));
+
+	// second state (cost 10) cannot improve on first solution (cost 1)
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(1));
+	EXPECT_EQ(last->runs_, 1u);
+}
+
+TEST(Task, costPruningScheduled) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.enableCostPruning();
+	t.setSchedulingPolicy(Task::BEST_FIRST);
+
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 0.0, 0.0 })));
+	t.add(std::make_unique<ForwardMockup>(PredefinedCosts({ 1.0, 10.0 })));
+	auto* last = new ForwardMockup();
+	t.add(Stage::pointer(last));
+
+	// scheduled planning prunes like sequential planning
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(1));
+	EXPECT_EQ(last->runs_, 1u);
+}
+
+TEST(SerialContainer, maxSolutionPaths) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	auto serial = std::make_unique<SerialContainer>();
+	serial->setMaxSolutionPaths(1);
+	serial->add(std::make_unique<BackwardMockup>(PredefinedCosts({ 1.0, 2.0 }), 2));
+	serial->add(std::make_unique<GeneratorMockup>(PredefinedCosts::single(0.0)));
+	serial->add(std::make_unique<ForwardMockup>(PredefinedCosts({ 10.0, 20.0 }), 2));
+	t.add(std::move(serial));
+
+	// each solution of the later propagator only assembles the cheapest of both paths through it
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.numSolutions(), 2u);
+	EXPECT_EQ(t.solutions().front()->cost(), 11.0);
+}
+
+TEST(Connecting, pendingPairs) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 2.0, 1.0 })));
+	auto connect = std::make_unique<ConnectMockup>();
+	auto* connect_ptr = connect.get();
+	t.add(std::move(connect));
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 10.0, 20.0 })));
+
+	// all pairs of the lazily enumerated frontier are computed exactly once
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(connect_ptr->runs_, 4u);
+	EXPECT_EQ(t.numSolutions(), 4u);
+	EXPECT_EQ(t.solutions().front()->cost(), 11.0);
+	EXPECT_EQ(t.solutions().back()->cost(), 22.0);
+}
+
+TEST(Stage, maxStoredSolutions) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	auto gen = std::make_unique<GeneratorMockup>(PredefinedCosts({ 1.0, 3.0, 2.0 }));
+	gen->setMaxStoredSolutions(1);
+	auto* gen_ptr = gen.get();
+	t.add(std::move(gen));
+	t.add(std::make_unique<ForwardMockup>(PredefinedCosts::constant(INF)));
+
+	// none of the generator's solutions is used in a complete solution: only the best one is kept
+	EXPECT_FALSE(t.plan());
+	ASSERT_EQ(gen_ptr->solutions().size(), 1u);
+	EXPECT_EQ(gen_ptr->solutions().front()->cost(), 1.0);
+}
+
+TEST(Task, topKSolutions) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.stages()->setMaxStoredSolutions(2);
+	auto* gen = new GeneratorMockup(PredefinedCosts({ 3.0, 1.0, 4.0, 2.0 }));
+	t.add(Stage::pointer(gen));
+	t.add(std::make_unique<ForwardMockup>());
+
+	// only the best two solutions are kept, the others are summarized
+	EXPECT_TRUE(t.plan());
+	ASSERT_EQ(t.solutions().size(), 2u);
+	EXPECT_EQ(t.solutions().front()->cost(), 1.0);
+	EXPECT_EQ(t.solutions().back()->cost(), 2.0);
+	const EvictedSolutions& evicted = t.stages()->evictedSolutions();
+	EXPECT_EQ(evicted.count, 2u);
+	EXPECT_EQ(evicted.min_cost, 3.0);
+	EXPECT_EQ(evicted.max_cost, 4.0);
+	EXPECT_EQ(evicted.meanCost(), 3.5);
+	// children are not bounded by the Task's limit
+	EXPECT_EQ(gen->solutions().size(), 4u);
+}
+
+// generator computing its costs asynchronously, spawning solutions in continuations
+struct AsyncGeneratorMockup : public GeneratorMockup
+{
+	size_t runs_at_first_resume_ = 0;
+	using GeneratorMockup::GeneratorMockup;
+
+	void compute() override {
+		++runs_;
+		const double cost = costs_.cost();
+		std::shared_future<double> future = std::async(std::launch::async, [cost]() {
+			                                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			                                    return cost;
+		                                    }).share();
+		resumeWhenReady(future, [this](double c) {
+			if (runs_at_first_resume_ == 0)
+				runs_at_first_resume_ = runs_;
+			spawn(InterfaceState(ps_), c);
+		});
+	}
+};
+
+TEST(Stage, resumeWhenReady) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto gen = std::make_unique<AsyncGeneratorMockup>(PredefinedCosts({ 3.0, 1.0, 2.0 }));
+	auto* gen_ptr = gen.get();
+	t.add(std::move(gen));
+	t.add(std::make_unique<ForwardMockup>());
+
+	// all computations are launched before the first one is resumed
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(gen_ptr->runs_at_first_resume_, 3u);
+	EXPECT_EQ(gen_ptr->numPendingContinuations(), 0u);
+	ASSERT_EQ(t.solutions().size(), 3u);
+	EXPECT_EQ(t.solutions().front()->cost(), 1.0);
+}
+
+// generator spawning all its costs at once
+struct BatchGeneratorMockup : public GeneratorMockup
+{
+	using GeneratorMockup::GeneratorMockup;
+
+	void compute() override {
+		++runs_;
+		Batch batch;
+		for (size_t i = 0; i < solutions_per_compute_; ++i) {
+			SubTrajectory trajectory;
+			trajectory.setCost(costs_.cost());
+			batch.emplace_back(InterfaceState(ps_), std::move(trajectory));
+		}
+		spawnMany(std::move(batch));
+	}
+};
+
+TEST(Stage, spawnMany) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto gen = std::make_unique<BatchGeneratorMockup>(PredefinedCosts({ 3.0, 1.0, 2.0 }), 3);
+	auto* gen_ptr = gen.get();
+	t.add(std::move(gen));
+	t.add(std::make_unique<ForwardMockup>());
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(gen_ptr->runs_, 1u);
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(1, 2, 3));
+}
+
+TEST(Stage, lazyCost) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	unsigned int calls = 0;
+	auto gen = std::make_unique<GeneratorMockup>(PredefinedCosts({ 1.0, 2.0, 3.0 }));
+	gen->setCostTerm([&calls](auto&& s) {
+		++calls;
+		return s.cost() == 1.0 ? 5.0 : 0.0;
+	});
+	gen->setLazyCost(true);
+	t.add(std::move(gen));
+	t.add(std::make_unique<ForwardMockup>());
+
+	// costs are only evaluated for the best solution: the first one is re-ranked, the last one never evaluated
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(0, 0, 5));
+	EXPECT_EQ(calls, 2u);
+}
+
+TEST(Stage, lazyCostOfSharedSolution) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	auto gen = std::make_unique<GeneratorMockup>(PredefinedCosts({ 0.0 }));
+	gen->setCostTerm([](auto&& /*s*/) { return 5.0; });
+	gen->setLazyCost(true);
+	t.add(std::move(gen));
+	t.add(std::make_unique<ForwardMockup>(PredefinedCosts({ 1.0, 2.0 }), 2));
+
+	// both solutions share the generator's solution, whose resolved cost applies to both
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(6, 7));
+}
+
+TEST(Task, replan) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 1.0, 2.0 })));
+	t.add(std::make_unique<ForwardMockup>());
+	EXPECT_TRUE(t.plan(1));
+	EXPECT_EQ(t.numSolutions(), 1u);
+
+	moveit_msgs::PlanningScene diff;
+	diff.is_diff = true;
+	moveit_msgs::CollisionObject box;
+	box.id = "box";
+	box.header.frame_id = "base";
+	box.operation = moveit_msgs::CollisionObject::ADD;
+	box.primitives.resize(1);
+	box.primitives[0].type = shape_msgs::SolidPrimitive::BOX;
+	box.primitives[0].dimensions = { 0.1, 0.1, 0.1 };
+	box.primitive_poses.resize(1);
+	box.primitive_poses[0].orientation.w = 1.0;
+	diff.world.collision_objects.push_back(box);
+
+	// existing (trajectory-less) solution remains valid and planning continues
+	EXPECT_TRUE(t.replan(diff));
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(1, 2));
+	for (const auto& solution : t.solutions()) {
+		EXPECT_TRUE(solution->start()->scene()->getWorld()->hasObject("box"));
+		EXPECT_TRUE(solution->end()->scene()->getWorld()->hasObject("box"));
+	}
+}
+
+// forward a single-waypoint trajectory of the start state, providing geometry to collide with
+struct WayPointForward : public PropagatingForward
+{
+	using PropagatingForward::PropagatingForward;
+	void computeForward(const InterfaceState& from) override {
+		auto traj = std::make_shared<robot_trajectory::RobotTrajectory>(from.scene()->getRobotModel(), nullptr);
+		traj->addSuffixWayPoint(from.scene()->getCurrentState(), 0.0);
+		sendForward(from, InterfaceState(from.scene()->diff()), SubTrajectory(traj));
+	}
+};
+
+TEST(Task, replanCollision) {
+	moveit::core::RobotModelBuilder builder("robot", "base");
+	builder.addChain("base->link1", "continuous");
+	geometry_msgs::Pose origin;
+	origin.orientation.w = 1.0;
+	builder.addCollisionBox("link1", { 0.1, 0.1, 0.1 }, origin);
+	builder.addGroupChain("base", "link1", "group");
+	auto model = builder.build();
+
+	Task t;
+	t.setRobotModel(model);
+	auto scene = std::make_shared<planning_scene::PlanningScene>(model);
+	t.add(std::make_unique<stages::FixedState>("start", scene));
+	t.add(std::make_unique<WayPointForward>("forward"));
+	EXPECT_TRUE(t.plan());
+	ASSERT_EQ(t.numSolutions(), 1u);
+	auto original = t.solutions().front()->start()->scene();
+
+	moveit_msgs::PlanningScene diff;
+	diff.is_diff = true;
+	moveit_msgs::CollisionObject box;
+	box.header.frame_id = "base";
+	box.operation = moveit_msgs::CollisionObject::ADD;
+	box.primitives.resize(1);
+	box.primitives[0].type = shape_msgs::SolidPrimitive::BOX;
+	box.primitives[0].dimensions = { 0.1, 0.1, 0.1 };
+	box.primitive_poses.resize(1);
+	box.primitive_poses[0].orientation.w = 1.0;
+
+	// a distant object doesn't invalidate the trajectory
+	box.id = "far";
+	box.primitive_poses[0].position.x = 10.0;
+	diff.world.collision_objects = { box };
+	EXPECT_TRUE(t.replan(diff));
+	ASSERT_EQ(t.numSolutions(), 1u);
+	const auto& solution = *t.solutions().front();
+	EXPECT_TRUE(solution.start()->scene()->getWorld()->hasObject("far"));
+	EXPECT_TRUE(solution.end()->scene()->getWorld()->hasObject("far"));
+	// stored scenes are replaced, not modified
+	EXPECT_FALSE(original->getWorld()->hasObject("far"));
+	EXPECT_FALSE(scene->getWorld()->hasObject("far"));
+
+	// an object overlapping with link1 invalidates the trajectory, which cannot be recomputed
+	box.id = "near";
+	box.primitive_poses[0].position.x = 0.0;
+	diff.world.collision_objects = { box };
+	EXPECT_FALSE(t.replan(diff));
+	EXPECT_EQ(t.numSolutions(), 0u);
+	EXPECT_EQ(t.stages()->findChild("forward")->failures().size(), 1u);
+}
+
+TEST(Task, replanObject) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	auto* gen = new GeneratorMockup(PredefinedCosts::single(0.0));
+	auto* con = new ConnectMockup();
+	auto* mon = new MonitoringGeneratorMockup(gen);
+	mon->properties().declare<std::string>("object", "box");
+	t.add(Stage::pointer(gen));
+	t.add(Stage::pointer(con));
+	t.add(Stage::pointer(mon));
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.numSolutions(), 1u);
+
+	moveit_msgs::CollisionObject box;
+	box.id = "box";
+	box.header.frame_id = "base";
+	box.operation = moveit_msgs::CollisionObject::ADD;
+	box.primitives.resize(1);
+	box.primitives[0].type = shape_msgs::SolidPrimitive::BOX;
+	box.primitives[0].dimensions = { 0.1, 0.1, 0.1 };
+	box.primitive_poses.resize(1);
+	box.primitive_poses[0].orientation.w = 1.0;
+
+	// the monitoring generator depends on the box: it is regenerated, while the generator's solution is reused
+	EXPECT_TRUE(t.replanObject(box));
+	EXPECT_EQ(gen->runs_, 1u);
+	EXPECT_EQ(mon->runs_, 2u);
+	EXPECT_EQ(con->runs_, 2u);
+	ASSERT_EQ(t.numSolutions(), 1u);
+	EXPECT_TRUE(t.solutions().front()->end()->scene()->getWorld()->hasObject("box"));
+
+	// obsolete solutions aren't accumulated as failures
+	box.operation = moveit_msgs::CollisionObject::MOVE;
+	for (int i = 0; i < 3; ++i)
+		EXPECT_TRUE(t.replanObject(box));
+	EXPECT_EQ(mon->failures().size(), 0u);
+	EXPECT_EQ(t.stages()->failures().size(), 0u);
+}
+
+TEST(Task, planAsync) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 3.0, 2.0, 1.0 })));
+	t.add(std::make_unique<TimedForwardMockup>(std::chrono::milliseconds(10)));
+
+	auto stream = t.solutionStream();
+	auto result = t.planAsync();
+
+	// solutions arrive in the order they were found
+	std::vector<double> costs;
+	SolutionBaseConstPtr solution;
+	while (stream->next(solution))
+		costs.push_back(solution->cost());
+	EXPECT_THAT(costs, ::testing::ElementsAre(3, 2, 1));
+	EXPECT_TRUE(stream->closed());
+
+	EXPECT_TRUE(result.get());
+	EXPECT_EQ(t.numSolutions(), 3u);
+}
+
+TEST(Task, preemptAfterPlanAsync) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts::constant(0.0)));
+
+	// preempting right away, possibly before the planning thread started, stops the infinite generator
+	auto result = t.planAsync();
+	t.preempt();
+	EXPECT_EQ(result.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+}
+
+TEST(StageRegistry, createBuiltIns) {
+	StageRegistry& registry = StageRegistry::instance();
+	EXPECT_TRUE(registry.contains("moveit_task_constructor/Serial Container"));
+	EXPECT_TRUE(registry.contains("moveit_task_constructor/Fixed State")) << "registered by the stages library";
+	EXPECT_TRUE(dynamic_cast<Fallbacks*>(registry.create("moveit_task_constructor/Fallbacks").get()));
+
+	resetMockupIds();
+	registry.add("test/Forward", "", [] { return new ForwardMockup(); });
+	auto stage = registry.create("test/Forward");
+	EXPECT_TRUE(dynamic_cast<ForwardMockup*>(stage.get()));
+
+	auto entries = registry.entries();
+	EXPECT_TRUE(std::is_sorted(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+		return a.class_id < b.class_id;
+	}));
+}
+
+TEST(TaskTemplate, instantiate) {
+	StageRegistry& registry = StageRegistry::instance();
+	registry.add<GeneratorMockup>("test/Generator");
+	registry.add<ForwardMockup>("test/Forward");
+
+	StageDescription generator{ "test/Generator", "gen", { { "timeout", "2.5" } }, {} };
+	StageDescription forward{ "test/Forward", "", { { "marker_ns", "fwd" } }, {} };
+	StageDescription root{ "", "templated", {}, { generator, forward } };
+	TaskTemplate tmpl(root);
+
+	for (int i = 0; i < 2; ++i) {
+		resetMockupIds();
+		TaskPtr t = tmpl.instantiate();
+		t->setRobotModel(getModel());
+		EXPECT_EQ(t->name(), "templated");
+		auto* gen = t->stages()->findChild("gen");
+		ASSERT_NE(gen, nullptr);
+		EXPECT_EQ(gen->timeout(), 2.5);
+		EXPECT_TRUE(t->plan());
+		EXPECT_EQ(t->numSolutions(), 1u);
+	}
+
+	// errors are detected when compiling the template
+	StageDescription invalid = root;
+	invalid.children[0].properties["timeout"] = "not a number";
+	EXPECT_THROW(TaskTemplate{ invalid }, std::runtime_error);
+	invalid = root;
+	invalid.children[1].properties["undeclared"] = "1";
+	EXPECT_THROW(TaskTemplate{ invalid }, std::runtime_error);
+	invalid = root;
+	invalid.children[0].children.push_back(forward);  // generator is not a container
+	EXPECT_THROW(TaskTemplate{ invalid }, std::runtime_error);
+	invalid = root;
+	invalid.children[1].class_id = "test/Unknown";
+	EXPECT_THROW(TaskTemplate{ invalid }, std::runtime_error);
+	invalid = root;
+	invalid.children[0].properties["timeout"] = "2.5 s";  // trailing garbage
+	EXPECT_THROW(TaskTemplate{ invalid }, std::runtime_error);
+
+	// strings are taken verbatim, untyped properties receive the text
+	StageDescription move_to{
+		"moveit_task_constructor/Move To", "", { { "group", "my group" }, { "goal", "ready" } }, {}
+	};
+	TaskPtr t = TaskTemplate(StageDescription{ "", "move", {}, { move_to } }).instantiate();
+	const PropertyMap& props = t->stages()->findChild("move to")->properties();
+	EXPECT_EQ(props.get<std::string>("group"), "my group");
+	EXPECT_EQ(props.get<std::string>("goal"), "ready");
+}
+
+TEST(TaskBatch, plan) {
+	resetMockupIds();
+	TaskBatch batch(2);
+	batch.setRobotModel(getModel());
+
+	const std::vector<double> costs{ 2.0, 0.0, INF, 1.0 };
+	batch.create(costs.size(), [&costs](size_t index) {
+		auto t = std::make_shared<Task>();
+		t->add(std::make_unique<GeneratorMockup>(PredefinedCosts::single(costs[index])));
+		t->add(std::make_unique<ForwardMockup>());
+		return t;
+	});
+	ASSERT_EQ(batch.size(), costs.size());
+	for (size_t i = 0; i != batch.size(); ++i)
+		EXPECT_EQ(batch.task(i).getRobotModel(), batch.getRobotModel());
+
+	auto results = batch.plan();
+	std::vector<size_t> ranking;
+	for (const auto& result : results) {
+		ranking.push_back(result.index);
+		EXPECT_GE(result.planning_time, 0.0);
+	}
+	EXPECT_THAT(ranking, ::testing::ElementsAre(1, 3, 0, 2));
+	EXPECT_TRUE(results[0].error_code);
+	EXPECT_EQ(results[0].cost, 0.0);
+	EXPECT_FALSE(results[3].error_code);
+}
+
+// ForwardMockup that busy-waits (but obeys preemption) during its computation
+class PreemptableForwardMockup : public ForwardMockup
+{
+public:
+	bool preempted_ = false;
+	void computeForward(const InterfaceState& from) override {
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (std::chrono::steady_clock::now() < deadline) {
+			if ((preempted_ = PreemptionToken::requested(preemptionToken())))
+				return silentFailure();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		ForwardMockup::computeForward(from);
+	}
+};
+
+TEST(Task, preempt) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts::constant(0.0)));
+	auto* fwd = new PreemptableForwardMockup();
+	t.add(Stage::pointer(fwd));
+
+	// repeatedly preempt, because plan() resets any request issued before planning started
+	std::atomic<bool> done{ false };
+	std::thread preempter([&t, &done]() {
+		while (!done) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			t.preempt();
+		}
+	});
+	auto start = std::chrono::steady_clock::now();
+	EXPECT_EQ(t.plan(), moveit::core::MoveItErrorCode::PREEMPTED);
+	done = true;
+	preempter.join();
+	EXPECT_TRUE(fwd->preempted_);
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+}
+
+TEST(Task, memoryBudget) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 0.0, 1.0, 2.0 })));
+	t.add(std::make_unique<ForwardMockup>());
+
+	t.setMemoryBudget(1 << 30);
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 3u);
+	EXPECT_GT(t.memoryUsage().total(), 0u);
+
+	// the generator's states alone exceed a tiny budget, which would otherwise plan forever
+	t.clear();
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts::constant(0.0)));
+	t.add(std::make_unique<ForwardMockup>());
+	t.setMemoryBudget(1);
+	EXPECT_EQ(t.plan(), Task::MEMORY_BUDGET_EXCEEDED);
+
+	t.setMemoryBudget(0);
+	Stage::setMemoryAccounting(false);
+}
+
+// generator spawning states with their own scene diffs
+struct DiffGeneratorMockup : GeneratorMockup
+{
+	using GeneratorMockup::GeneratorMockup;
+	void compute() override {
+		++runs_;
+		spawn(InterfaceState(ps_->diff()), costs_.cost());
+	}
+};
+
+TEST(Task, memoryBudgetEvictsDeadEnds) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto* gen = new DiffGeneratorMockup(PredefinedCosts({ 0.0, 1.0, 2.0, 3.0 }));
+	auto* fwd = new ForwardMockup(PredefinedCosts({ 0.0, INF, INF, INF }));
+	t.add(Stage::pointer(gen));
+	t.add(Stage::pointer(fwd));
+
+	t.setMemoryBudget(1 << 30);
+	EXPECT_TRUE(t.plan());
+	ASSERT_EQ(t.solutions().size(), 1u);
+	ASSERT_EQ(gen->solutions().size(), 4u);  // 3 of them are dead ends
+	EXPECT_EQ(fwd->failures().size(), 3u);
+	const MemoryUsage before = gen->memoryUsage();
+	const size_t total = t.memoryUsage().total();
+
+	// a tiny budget cannot be met, but the memory of all dead ends is released
+	t.setMemoryBudget(1);
+	EXPECT_FALSE(t.pimpl()->enforceMemoryBudget());
+	EXPECT_TRUE(fwd->failures().empty());
+	// the worse half of the generator's solutions is evicted, keeping the one of the task's solution
+	ASSERT_EQ(gen->solutions().size(), 2u);
+	EXPECT_EQ(gen->solutions().front()->cost(), 0.0);
+	EXPECT_EQ(gen->memoryUsage().states, before.states - 4 * sizeof(InterfaceState));  // start and end state each
+	EXPECT_LT(gen->memoryUsage().scenes, before.scenes);
+	EXPECT_LT(t.memoryUsage().total(), total);
+	ASSERT_EQ(t.solutions().size(), 1u);
+	EXPECT_EQ(t.solutions().front()->cost(), 0.0);
+
+	t.setMemoryBudget(0);
+	Stage::setMemoryAccounting(false);
+}
+
+// propagator sending failures with distinct comments, which are only formatted when accessed
+struct FailingForwardMockup : public ForwardMockup
+{
+	size_t formatted = 0;
+	size_t sent = 0;
+
+	FailingForwardMockup() : ForwardMockup(PredefinedCosts::constant(0.0), 50) {}
+	void computeForward(const InterfaceState& from) override {
+		for (std::size_t i = 0; i < solutions_per_compute_; ++i) {
+			SubTrajectory solution;
+			solution.markAsFailure("reason " + std::to_string(sent++) + ": details");
+			solution.formatComment([this](std::string& comment) {
+				++formatted;
+				comment += " (formatted)";
+			});
+			if (i == 0)
+				solution.setFailureReason("tagged");
+			sendForward(from, InterfaceState{ from.scene()->diff() }, std::move(solution));
+		}
+	}
+};
+
+TEST(Stage, failureReasonsBounded) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(Stage::pointer(new GeneratorMockup({ 0.0 })));
+	auto* fwd = new FailingForwardMockup();
+	t.add(Stage::pointer(fwd));
+
+	EXPECT_FALSE(t.plan());
+	ASSERT_TRUE(fwd->storeFailures());
+	const auto& reasons = fwd->failureReasons();
+	EXPECT_EQ(reasons.size(), StagePrivate::MAX_FAILURE_REASONS);
+	EXPECT_EQ(reasons.at("tagged"), 1u);  // explicitly set reason takes precedence over the comment
+	EXPECT_EQ(reasons.at("reason 1"), 1u);
+	// 50 failures: 1 tagged, 30 further distinct reasons, 19 beyond the limit
+	EXPECT_EQ(reasons.at("other"), 19u);
+	EXPECT_EQ(reasons.count("reason 49"), 0u);
+	// counting doesn't format the comments
+	EXPECT_EQ(fwd->formatted, 0u);
+}
+
+TEST(TaskBenchmark, recordRuns) {
+	std::vector<unsigned int> seeds;
+	TaskBenchmark benchmark("mockups", [&seeds](unsigned int seed) {
+		seeds.push_back(seed);
+		resetMockupIds();
+		auto t = std::make_shared<Task>();
+		t->setRobotModel(getModel());
+		t->add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 2.0, 1.0 })));
+		t->add(std::make_unique<ForwardMockup>());
+		return t;
+	});
+	benchmark.setRepetitions(2);
+	benchmark.setSeed(42);
+	const auto& runs = benchmark.run();
+
+	EXPECT_EQ(seeds, std::vector<unsigned int>({ 42, 43 }));
+	ASSERT_EQ(runs.size(), 2u);
+	for (const auto& run : runs) {
+		EXPECT_TRUE(run.error_code);
+		EXPECT_EQ(run.solutions, 2u);
+		EXPECT_EQ(run.best_cost, 1.0);
+		EXPECT_LE(run.time_to_first_solution, run.planning_time);
+		EXPECT_GT(run.peak_rss, 0);
+		// root container is recorded once, followed by its children
+		ASSERT_EQ(run.stages.size(), 3u);
+		EXPECT_EQ(run.stages[0].depth, 0u);
+		EXPECT_EQ(run.stages[1].name, "GEN1");
+		EXPECT_EQ(run.stages[1].depth, 1u);
+		EXPECT_EQ(run.stages[2].name, "FWD1");
+	}
+
+	std::ostringstream json;
+	benchmark.writeJson(json);
+	EXPECT_NE(json.str().find("\"name\":\"mockups\""), std::string::npos);
+	EXPECT_NE(json.str().find("\"summary\":{\"succeeded\":2"), std::string::npos);
+}
+
+TEST(PlanningRecord, replayPlannerResponses) {
+	auto robot_model = getModel();
+	const auto* jmg = robot_model->getJointModelGroup("group");
+	auto from = std::make_shared<planning_scene::PlanningScene>(robot_model);
+	auto to = from->diff();
+	to->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>(jmg->getVariableCount(), 0.5));
+	to->getCurrentStateNonConst().update();
+
+	solvers::JointInterpolationPlanner planner;
+	robot_trajectory::RobotTrajectoryPtr recorded, replayed;
+	const std::string file = "test_planning_record.bin";
+	{
+		PlanningRecord record(42);
+		PlanningRecord::Activation activation(&record);
+		ASSERT_TRUE(planner.plan(from, to, jmg, 1.0, recorded));
+		EXPECT_EQ(record.msg().responses.size(), 1u);
+		ASSERT_TRUE(record.save(file));
+	}
+
+	auto record = PlanningRecord::load(file);
+	ASSERT_TRUE(record);
+	EXPECT_EQ(record->seed(), 42u);
+	PlanningRecord::Activation activation(record.get());
+	// the recorded response is returned, although the goal differs
+	ASSERT_TRUE(planner.plan(from, from, jmg, 1.0, replayed));
+	ASSERT_TRUE(replayed);
+	EXPECT_EQ(replayed->getWayPointCount(), recorded->getWayPointCount());
+	EXPECT_EQ(record->pendingResponses(), 0u);
+	std::remove(file.c_str());
+}
+
+TEST(PlanningRecord, concurrentRecords) {
+	auto robot_model = getModel();
+	const auto* jmg = robot_model->getJointModelGroup("group");
+	auto from = std::make_shared<planning_scene::PlanningScene>(robot_model);
+	auto to = from->diff();
+	to->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>(jmg->getVariableCount(), 0.5));
+	to->getCurrentStateNonConst().update();
+
+	// each thread records its own calls only, including those of its spawned threads
+	auto plan_recorded = [&](size_t calls) {
+		PlanningRecord record(0);
+		PlanningRecord::Activation activation(&record);
+		solvers::JointInterpolationPlanner planner;
+		robot_trajectory::RobotTrajectoryPtr result;
+		for (size_t i = 0; i < calls; ++i)
+			planner.plan(from, to, jmg, 1.0, result);
+		TaskExecutor::instance()->spawn([&]() { planner.plan(from, to, jmg, 1.0, result); }).join();
+		return record.msg().responses.size();
+	};
+	auto first = std::async(std::launch::async, plan_recorded, 5);
+	auto second = std::async(std::launch::async, plan_recorded, 10);
+	EXPECT_EQ(first.get(), 6u);
+	EXPECT_EQ(second.get(), 11u);
+	EXPECT_EQ(PlanningRecord::active(), nullptr);
+}
+
+TEST(Task, recordAndReplay) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 0.0, 1.0 })));
+	t.add(std::make_unique<ForwardMockup>());
+
+	const std::string file = "test_task_record.bin";
+	t.setRecording(file);
+	EXPECT_TRUE(t.plan());
+	const int recorded = std::rand();
+
+	EXPECT_FALSE(t.setReplay("non_existing_record.bin"));
+	ASSERT_TRUE(t.setReplay(file));
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 2u);
+	EXPECT_EQ(std::rand(), recorded);  // std::rand() was reseeded with the recorded seed
+
+	auto record = PlanningRecord::load(file);
+	ASSERT_TRUE(record);
+	EXPECT_EQ(record->msg().stages.size(), 3u);  // root container and both mockups
+	std::remove(file.c_str());
+}
+
+TEST(SolutionStore, writeAndQuery) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 2.0, 1.0 })));
+	t.add(std::make_unique<ForwardMockup>());
+	ASSERT_TRUE(t.plan());
+
+	const std::string file = "test_solution_store.bin";
+	SolutionStore::Writer writer;
+	writer.add(t);
+	ASSERT_EQ(writer.size(), 2u);
+	ASSERT_TRUE(writer.write(file));
+
+	SolutionStore store;
+	ASSERT_TRUE(store.open(file));
+	ASSERT_EQ(store.size(), 2u);
+
+	SolutionStore::Query query;
+	query.task_name = t.name();
+	auto entries = store.query(query);
+	ASSERT_EQ(entries.size(), 2u);
+	EXPECT_EQ(entries[0].cost(), 1.0);  // sorted by cost
+	EXPECT_EQ(entries[1].cost(), 2.0);
+	EXPECT_EQ(entries[0].stages(), std::vector<std::string>({ "GEN1", "FWD1" }));
+
+	moveit_task_constructor_msgs::Solution msg;
+	entries[0].toMsg(msg);
+	EXPECT_EQ(msg.sub_trajectory.size(), 2u);
+	EXPECT_FALSE(msg.start_scene.robot_state.joint_state.name.empty());
+	EXPECT_EQ(entries[0].distance(msg.start_scene.robot_state.joint_state), 0.0);
+
+	query.max_cost = 1.5;
+	EXPECT_EQ(store.query(query).size(), 1u);
+	query.task_name = "other task";
+	EXPECT_TRUE(store.query(query).empty());
+
+	store.close();
+	std::remove(file.c_str());
+}
+
+TEST(Task, frozenStageRecords) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(std::make_unique<GeneratorMockup>());
+	auto serial = std::make_unique<SerialContainer>();
+	serial->add(std::make_unique<ForwardMockup>());
+	t.add(std::move(serial));
+	t.init();
+
+	const auto& records = t.pimpl()->stageRecords();
+	ASSERT_EQ(records.size(), 4u);  // root, generator, serial, forward
+	EXPECT_EQ(records[0].parent, 0u);
+	EXPECT_TRUE(records[0].container);
+	EXPECT_EQ(records[1].parent, 0u);
+	EXPECT_EQ(records[1].depth, 1u);
+	EXPECT_EQ(records[3].parent, 2u);
+	EXPECT_EQ(records[3].depth, 2u);
+	EXPECT_FALSE(records[3].container);
+
+	// push interfaces are cached, but resolve to the same interfaces
+	EXPECT_EQ(records[1].stage->nextStartsRaw(), records[1].stage->nextStarts().get());
+
+	t.add(std::make_unique<ForwardMockup>());
+	EXPECT_EQ(t.pimpl()->stageRecords().size(), 5u);  // recompiled after structural change
+}
+
+TEST(Task, skipInitOfUnchangedStages) {
+	struct CountingGenerator : public GeneratorMockup
+	{
+		size_t inits = 0;
+		void init(const moveit::core::RobotModelConstPtr& robot_model) override {
+			++inits;
+			GeneratorMockup::init(robot_model);
+		}
+	};
+
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto* gen = new CountingGenerator();
+	t.add(Stage::pointer(gen));
+	t.add(std::make_unique<ForwardMockup>());
+
+	t.init();
+	t.init();
+	EXPECT_EQ(gen->inits, 1u);
+
+	// reset() requires to resolve interfaces again, but not to initialize stages
+	t.reset();
+	t.init();
+	EXPECT_EQ(gen->inits, 1u);
+	EXPECT_TRUE(t.plan());
+
+	// changed properties trigger initialization
+	gen->properties().set("timeout", 1.0);
+	t.init();
+	EXPECT_EQ(gen->inits, 2u);
+
+	// ... as do changed inherited properties
+	t.stages()->properties().set("timeout", 2.0);
+	t.init();
+	EXPECT_EQ(gen->inits, 3u);
+
+	// ... and structural changes of the parent don't affect unchanged siblings
+	t.add(std::make_unique<ForwardMockup>());
+	t.init();
+	EXPECT_EQ(gen->inits, 3u);
+}
+
+TEST(Task, skipInitKeepsConnectMerging) {
+	auto model = getModel();
+	auto start = std::make_shared<planning_scene::PlanningScene>(model);
+	start->getCurrentStateNonConst().setToDefaultValues();
+	auto goal = start->diff();
+	goal->getCurrentStateNonConst().setVariablePositions(std::vector<double>(model->getVariableCount(), 0.5));
+	goal->getCurrentStateNonConst().update();
+
+	Task t;
+	t.setRobotModel(model);
+	auto planner = std::make_shared<solvers::JointInterpolationPlanner>();
+	t.add(std::make_unique<stages::FixedState>("start", start));
+	auto* connect = new stages::Connect("connect", { { "group", planner }, { "eef_group", planner } });
+	t.add(Stage::pointer(connect));
+	t.add(std::make_unique<stages::FixedState>("goal", goal));
+
+	// both group motions are merged into a single trajectory
+	auto merged = [connect]() {
+		return !connect->solutions().empty() &&
+		       dynamic_cast<const SubTrajectory*>(connect->solutions().front().get()) != nullptr;
+	};
+	ASSERT_TRUE(t.plan());
+	EXPECT_TRUE(merged());
+
+	// init() is skipped after reset(), but merging keeps working
+	t.reset();
+	EXPECT_FALSE(connect->pimpl()->needsInit(model));
+	ASSERT_TRUE(t.plan());
+	EXPECT_TRUE(merged());
+
+	// changed planner properties require initialization
+	planner->setProperty("max_step", 0.05);
+	EXPECT_TRUE(connect->pimpl()->needsInit(model));
+	ASSERT_TRUE(t.plan());
+	EXPECT_FALSE(connect->pimpl()->needsInit(model));
+
+	// ... as does another model instance, even with the same content
+	EXPECT_TRUE(connect->pimpl()->needsInit(getModel()));
+}
+
+TEST(StaticSerial, typedChildren) {
+	using Layout = StaticSerial<GeneratorMockup, ConnectMockup, GeneratorMockup>;
+	static_assert(StaticInterface<Layout>::value == GENERATE, "serial layout should generate");
+	static_assert(!static_detail::chain<GENERATE, GENERATE>::value, "generators cannot follow each other");
+	static_assert(static_detail::parallel<GENERATE, CONNECT>::value == ~0u, "alternatives need a common interface");
+
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto layout = std::make_unique<Layout>("layout");
+	Layout* l = layout.get();
+	EXPECT_EQ(l->numChildren(), 3u);
+	EXPECT_EQ(&l->get<1>(), l->findChild("CON1"));
+
+	EXPECT_THROW(l->bind<int>("timeout"), Property::type_error);
+	l->bind<double>("timeout", 5.0);
+	t.add(std::move(layout));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 1u);
+	EXPECT_EQ(l->get<2>().properties().get<double>("timeout"), 5.0);
+}
+
+TEST_F(TaskTestBase, concurrentSnapshots) {
+	add(t, new GeneratorMockup({ 3.0, 1.0, 2.0 }));
+	add(t, new ForwardMockup());
+	EXPECT_TRUE(t.snapshot()->solutions().empty());
+
+	std::atomic<bool> done{ false };
+	std::thread reader([this, &done]() {
+		while (!done) {
+			StageSnapshotConstPtr snapshot = t.snapshot();
+			EXPECT_EQ(snapshot->solutions().size(), snapshot->costs().size());
+			EXPECT_TRUE(std::is_sorted(snapshot->costs().begin(), snapshot->costs().end()));
+		}
+	});
+	EXPECT_TRUE(t.plan());
+	done = true;
+	reader.join();
+
+	StageSnapshotConstPtr snapshot = t.snapshot();
+	ASSERT_EQ(snapshot->solutions().size(), 3u);
+	EXPECT_EQ(snapshot->solutions().front(), *t.solutions().begin());
+	EXPECT_EQ(snapshot->costs(), std::vector<double>({ 1.0, 2.0, 3.0 }));
+	EXPECT_GT(snapshot->epoch, 0u);
+	EXPECT_EQ(t.stages()->findChild("GEN1")->snapshot()->solutions().size(), 3u);
+
+	// a snapshot stays valid, even after resetting the task
+	t.reset();
+	EXPECT_TRUE(t.snapshot()->solutions().empty());
+	EXPECT_EQ(snapshot->solutions().size(), 3u);
+}
+
+TEST_F(TaskTestBase, snapshotsShareUnchangedRanking) {
+	auto* gen = add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	EXPECT_TRUE(t.plan());
+	StageSnapshotConstPtr before = gen->snapshot();
+	ASSERT_EQ(before->solutions().size(), 2u);
+
+	// statistics-only changes republish without copying the solutions
+	gen->silentFailure();
+	gen->pimpl()->publishSnapshot(before->epoch + 1);
+	StageSnapshotConstPtr after = gen->snapshot();
+	EXPECT_NE(before, after);
+	EXPECT_EQ(before->ranking, after->ranking);
+	EXPECT_EQ(after->num_failures, before->num_failures + 1);
+}
+
+TEST_F(TaskTestBase, asyncSolutionCallbacks) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+
+	std::mutex mutex;
+	std::vector<double> costs;
+	bool other_thread = true;
+	const std::thread::id planning_thread = std::this_thread::get_id();
+	auto cb = t.addSolutionCallback(
+	    [&](const SolutionBase& s) {
+		    std::lock_guard<std::mutex> lock(mutex);
+		    costs.push_back(s.cost());
+		    other_thread = other_thread && std::this_thread::get_id() != planning_thread;
+	    },
+	    CallbackDispatch::async(1));
+	EXPECT_TRUE(t.plan());
+	t.removeSolutionCallback(cb);  // waits for all queued solutions
+
+	EXPECT_EQ(costs, std::vector<double>({ 1.0, 2.0, 3.0 }));
+	EXPECT_TRUE(other_thread);
+}
+
+TEST(Stage, asyncSolutionCallbackDropsOldest) {
+	GeneratorMockup g;
+	std::atomic<bool> entered{ false };
+	std::atomic<bool> release{ false };
+	std::vector<double> costs;
+	auto cb = g.addSolutionCallback(
+	    [&](const SolutionBase& s) {
+		    entered = true;
+		    while (!release)
+			    std::this_thread::yield();
+		    costs.push_back(s.cost());
+	    },
+	    CallbackDispatch::async(1, CallbackDispatch::DROP_OLDEST));
+
+	auto push = [&g](double cost) {
+		auto solution = std::make_shared<SubTrajectory>();
+		solution->setCost(cost);
+		g.pimpl()->callSolutionCallbacks(*solution, solution);
+	};
+	push(1.0);
+	while (!entered)  // callback is busy with the first solution
+		std::this_thread::yield();
+	push(2.0);
+	push(3.0);  // queue is full: drop 2.0
+	release = true;
+	g.removeSolutionCallback(cb);
+
+	EXPECT_EQ(costs, std::vector<double>({ 1.0, 3.0 }));
+}
+
+TEST_F(TaskTestBase, resetWaitsForAsyncSolutionCallbacksOfChildren) {
+	auto* gen = add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	auto* fwd = add(t, new ForwardMockup());
+	std::atomic<bool> entered{ false };
+	std::atomic<bool> release{ false };
+	std::atomic<size_t> valid_starts{ 0 };
+	fwd->addSolutionCallback(
+	    [&](const SolutionBase& s) {
+		    entered = true;
+		    while (!release)
+			    std::this_thread::yield();
+		    // the start state is owned by the generator, which must not be reset yet
+		    if (s.start() && s.start()->scene())
+			    ++valid_starts;
+	    },
+	    CallbackDispatch::async());
+	EXPECT_TRUE(t.plan());
+	while (!entered)
+		std::this_thread::yield();
+
+	std::atomic<bool> reset_done{ false };
+	std::thread resetter([&]() {
+		t.reset();
+		reset_done = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_FALSE(reset_done);  // blocked by the queued solutions of fwd
+	EXPECT_EQ(gen->solutions().size(), 2u);
+	release = true;
+	resetter.join();
+
+	EXPECT_EQ(valid_starts, 2u);
+	EXPECT_TRUE(gen->solutions().empty());
+}
+
+TEST_F(TaskTestBase, generatorHighWaterMark) {
+	auto* gen = add(t, new GeneratorMockup({ 1.0, 2.0, 3.0, 4.0, 5.0 }));
+	auto* fwd = add(t, new ForwardMockup());
+	gen->setHighWaterMark(2);
+	t.init();
+
+	gen->pimpl()->runCompute();
+	EXPECT_TRUE(gen->pimpl()->canCompute());
+	gen->pimpl()->runCompute();
+	EXPECT_EQ(fwd->pimpl()->pendingJobs(), 2u);
+	EXPECT_FALSE(gen->pimpl()->canCompute());  // wait for consumer to catch up
+
+	fwd->pimpl()->runCompute();
+	EXPECT_TRUE(gen->pimpl()->canCompute());
+
+	while (t.canCompute()) {
+		t.compute();
+		EXPECT_LE(fwd->pimpl()->pendingJobs(), 2u);
+	}
+	EXPECT_EQ(t.numSolutions(), 5u);
+}
+
+TEST_F(TaskTestBase, pendingJobsIgnorePrunedStates) {
+	auto* gen1 = add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	auto* con = add(t, new ConnectMockup());
+	auto* gen2 = add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	t.init();
+	for (auto* gen : { gen1, gen1, gen2, gen2 })
+		gen->pimpl()->runCompute();
+	EXPECT_EQ(con->pimpl()->pendingJobs(), 4u);
+
+	// pairs involving a pruned state will never be computed
+	InterfaceState* pruned = const_cast<InterfaceState*>(*con->pimpl()->starts()->begin());
+	pruned->updateStatus(InterfaceState::Status::PRUNED);
+	EXPECT_EQ(con->pimpl()->pendingJobs(), 2u);
+	pruned->updateStatus(InterfaceState::Status::ENABLED);
+	EXPECT_EQ(con->pimpl()->pendingJobs(), 4u);
+}
+
+TEST_F(TaskTestBase, stateDeduplication) {
+	// all generated states share the same scene
+	auto* gen = add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	auto* fwd = add(t, new ForwardMockup());
+	t.setStateDeduplication(1e-3);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(fwd->runs_, 1u);  // planned only once from the merged state
+	EXPECT_EQ(gen->solutions().size(), 3u);
+	EXPECT_EQ(gen->solutions().front()->end()->incomingTrajectories().size(), 3u);
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(1.0, 2.0, 3.0));
+}
+
+// records the costs of handed over solution batches
+struct BatchMonitorMockup : public MonitoringGeneratorMockup
+{
+	std::vector<std::vector<double>> batches_;
+	using MonitoringGeneratorMockup::MonitoringGeneratorMockup;
+
+	void onNewSolutions(const std::vector<const SolutionBase*>& solutions) override {
+		batches_.emplace_back();
+		for (const SolutionBase* s : solutions)
+			batches_.back().push_back(s->cost());
+		MonitoringGeneratorMockup::onNewSolutions(solutions);
+	}
+};
+
+TEST_F(TaskTestBase, monitoredSolutionBatches) {
+	auto* gen = add(t, new GeneratorMockup(PredefinedCosts{ std::list<double>{ 3.0, 1.0, 2.0 }, true }, 3));
+	add(t, new ConnectMockup());
+	auto* monitor = add(t, new BatchMonitorMockup(gen));
+
+	EXPECT_TRUE(t.plan());
+	// all solutions of a single compute() are handed over at once, sorted by cost
+	ASSERT_EQ(monitor->batches_.size(), 1u);
+	EXPECT_THAT(monitor->batches_.front(), testing::ElementsAre(1.0, 2.0, 3.0));
+	EXPECT_EQ(monitor->runs_, 3u);
+}
+
+// child factory of ForEach, creating a mockup with the element as its single cost
+template <typename Mockup>
+Stage::pointer costMockup(const boost::any& element, size_t /*index*/) {
+	return std::make_unique<Mockup>(PredefinedCosts::single(boost::any_cast<double>(element)));
+}
+
+TEST_F(TaskTestBase, forEachGenerators) {
+	auto* for_each = add(t, new ForEach("for each", &costMockup<GeneratorMockup>));
+	for_each->setElements({ 3.0, 1.0, 2.0, 4.0 });
+	for_each->setMaxConcurrency(2);
+
+	EXPECT_TRUE(t.plan());
+	// the first two children are created by init(), the others once a slot became available
+	EXPECT_EQ(for_each->numInstantiated(), 4u);
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(1, 2, 3, 4));
+}
+
+TEST_F(TaskTestBase, forEachPropagators) {
+	add(t, new GeneratorMockup(PredefinedCosts::single(0.0)));
+	auto* for_each = add(t, new ForEach("for each", &costMockup<ForwardMockup>));
+	for_each->setElements({ 2.0, 1.0, 3.0 });
+	for_each->setMaxConcurrency(1);
+
+	// children created during planning receive the already known start state as well
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(for_each->numInstantiated(), 3u);
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(1, 2, 3));
+}
+
+TEST_F(TaskTestBase, forEachLateChildren) {
+	auto* for_each = add(t, new ForEach("for each", &costMockup<GeneratorMockup>));
+	for_each->setElements({ 3.0, 1.0, 2.0, 4.0 });
+	for_each->setMaxConcurrency(2);
+
+	t.init();
+	EXPECT_EQ(t.pimpl()->stageRecords().size(), 4u);  // root, for each, first wave of two children
+	EXPECT_TRUE(t.plan());
+	// children created during planning are compiled into the stage tree as well
+	EXPECT_EQ(t.pimpl()->stageRecords().size(), 6u);
+
+	// reset() drops all children, planning again starts over with the first wave
+	t.reset();
+	EXPECT_EQ(for_each->numInstantiated(), 0u);
+	EXPECT_EQ(for_each->pimpl()->children().size(), 0u);
+	t.init();
+	EXPECT_EQ(for_each->numInstantiated(), 2u);
+	EXPECT_EQ(t.pimpl()->stageRecords().size(), 4u);
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(for_each->numInstantiated(), 4u);
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(1, 2, 3, 4));
+}
+
+TEST_F(TaskTestBase, forEachEarlyExit) {
+	auto* for_each = add(t, new ForEach("for each", &costMockup<GeneratorMockup>));
+	for_each->setElements({ 3.0, 1.0, 2.0 });
+	for_each->setMaxConcurrency(1);
+	for_each->setMaxSolutions(1);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(for_each->numInstantiated(), 1u);
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(3));
+}
+
+TEST_F(TaskTestBase, racingAlternatives) {
+	auto* alternatives = add(t, new Alternatives());
+	auto* fast = add(*alternatives, new GeneratorMockup(PredefinedCosts::single(1.0)));
+	auto* slow = add(*alternatives, new GeneratorMockup(PredefinedCosts({ 3.0, 4.0, 5.0 })));
+	alternatives->setRacing(true, 2.0);
+
+	// the first solution decides the race, preempting the other child before its first compute()
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(alternatives->raceWinner(), fast);
+	EXPECT_EQ(slow->runs_, 0u);
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(1));
+
+	// reset() starts a new race
+	t.reset();
+	alternatives->setRacing(false);
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(alternatives->raceWinner(), nullptr);
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(3, 4, 5));
+}
+
+TEST_F(TaskTestBase, metrics) {
+	t.stages()->setName("task");
+	add(t, new GeneratorMockup(PredefinedCosts({ 1.0, 2.0 })));
+	MetricsExporter metrics(t);
+
+	EXPECT_TRUE(t.plan());
+	metrics.update();
+	const std::string text = metrics.text();
+	EXPECT_NE(text.find("# TYPE mtc_stage_solutions gauge\n"), std::string::npos) << text;
+	EXPECT_NE(text.find("mtc_stage_solutions{task=\"task\",stage=\"task/GEN1\"} 2\n"), std::string::npos) << text;
+	EXPECT_NE(text.find("mtc_stage_solutions_found_total{task=\"task\",stage=\"task/GEN1\"} 2\n"), std::string::npos)
+	    << text;
+	EXPECT_NE(text.find("mtc_stage_compute_seconds{task=\"task\",stage=\"task/GEN1\",quantile=\"0.5\"}"),
+	          std::string::npos)
+	    << text;
+}
+
+// free TCP port on localhost, picked by the OS
+unsigned short freePort() {
+	int s = ::socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t size = sizeof(address);
+	::bind(s, reinterpret_cast<sockaddr*>(&address), size);
+	::getsockname(s, reinterpret_cast<sockaddr*>(&address), &size);
+	::close(s);
+	return ntohs(address.sin_port);
+}
+
+TEST_F(TaskTestBase, metricsServer) {
+	add(t, new GeneratorMockup(PredefinedCosts({ 1.0 })));
+	MetricsExporter metrics(t, freePort());  // served on localhost by default
+	ASSERT_NE(metrics.port(), 0u);
+	EXPECT_TRUE(t.plan());
+	metrics.update();
+
+	int client = ::socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(metrics.port());
+	ASSERT_EQ(::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+	const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+	::send(client, request.data(), request.size(), 0);
+	std::string response;
+	char buffer[4096];
+	for (ssize_t n; (n = ::recv(client, buffer, sizeof(buffer), 0)) > 0;)
+		response.append(buffer, n);
+	::close(client);
+
+	// any request is answered with the latest rendered metrics
+	EXPECT_EQ(response.compare(0, 15, "HTTP/1.0 200 OK"), 0) << response;
+	const size_t body = response.find("\r\n\r\n");
+	ASSERT_NE(body, std::string::npos) << response;
+	EXPECT_EQ(response.substr(body + 4), metrics.text());
+
+	EXPECT_THROW(MetricsExporter(t, freePort(), 1.0, "localhost"), std::runtime_error);  // IPv4 addresses only
+}
+
+// generator whose compute() stalls until planning was preempted (bounded by 10s, not to hang if it isn't)
+struct SlowGeneratorMockup : GeneratorMockup
+{
+	using GeneratorMockup::GeneratorMockup;
+	void compute() override {
+		const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (!pimpl()->preempted() && std::chrono::steady_clock::now() < end)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		GeneratorMockup::compute();
+	}
+};
+
+TEST_F(TaskTestBase, stallWatchdog) {
+	auto* gen = add(t, new SlowGeneratorMockup(PredefinedCosts({ 1.0, 2.0, 3.0 })));
+	StallPolicy policy = StallPolicy::watchdog(1.0, true);
+	policy.default_timeout = 0.01;
+	policy.check_interval = 0.005;
+	t.setStallPolicy(policy);
+
+	// the first stall preempts planning, which stops after the running compute()
+	const auto start = std::chrono::steady_clock::now();
+	EXPECT_TRUE(t.plan());
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));  // the watchdog preempted
+	EXPECT_EQ(gen->runs_, 1u);
+	EXPECT_NE(t.dumpEvents().find("stall running for"), std::string::npos);
+}
+
+struct WarmStartMockup : GeneratorMockup
+{
+	std::shared_ptr<int> cache;
+	using GeneratorMockup::GeneratorMockup;
+	bool enableWarmStart(WarmStartCache& warm_start) override {
+		auto previous = cache;
+		cache = warm_start.get<int>("counter");
+		return cache != previous;
+	}
+};
+
+TEST_F(TaskTestBase, warmStart) {
+	auto* gen = add(t, new WarmStartMockup(PredefinedCosts({ 1.0, 2.0, 3.0 })));
+	EXPECT_TRUE(t.plan(1));
+	EXPECT_FALSE(gen->cache);  // disabled by default
+
+	t.setWarmStart(true);
+	EXPECT_TRUE(t.plan(1));
+	ASSERT_TRUE(gen->cache);
+	++*gen->cache;
+
+	// caches survive reset()
+	auto cache = gen->cache;
+	t.reset();
+	EXPECT_TRUE(t.plan(1));
+	EXPECT_EQ(gen->cache, cache);
+	EXPECT_EQ(*gen->cache, 1);
+}
+
+TEST(TaskExecutor, limitsConcurrency) {
+	TaskExecutor::Options options;
+	options.num_threads = 4;
+	options.max_concurrency = 2;
+	TaskExecutor executor(options);
+
+	std::atomic<unsigned int> running{ 0 };
+	std::atomic<unsigned int> max_running{ 0 };
+	std::atomic<unsigned int> finished{ 0 };
+	for (int i = 0; i < 8; ++i)
+		executor.post([&]() {
+			TaskExecutor::Slot slot = executor.acquire();
+			unsigned int now = ++running;
+			unsigned int max = max_running;
+			while (now > max && !max_running.compare_exchange_weak(max, now))
+				;
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			--running;
+			++finished;
+		});
+	while (finished < 8)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	EXPECT_LE(max_running, 2u);
+	EXPECT_GE(max_running, 1u);
+}
+
+// generator recording the max number of concurrent computations and the executor they run with
+struct ConcurrencyProbe : public GeneratorMockup
+{
+	std::atomic<unsigned int>& running_;
+	std::atomic<unsigned int>& max_running_;
+	TaskExecutorPtr executor_;  // TaskExecutor::current() of the last computation
+
+	ConcurrencyProbe(std::atomic<unsigned int>& running, std::atomic<unsigned int>& max_running)
+	  : GeneratorMockup({ 3.0, 1.0, 2.0 }), running_(running), max_running_(max_running) {}
+
+	void compute() override {
+		unsigned int now = ++running_;
+		unsigned int max = max_running_;
+		while (now > max && !max_running_.compare_exchange_weak(max, now))
+			;
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		executor_ = TaskExecutor::current();
+		--running_;
+		GeneratorMockup::compute();
+	}
+};
+
+TEST_F(TaskTestBase, sharedExecutor) {
+	TaskExecutor::Options options;
+	options.max_concurrency = 1;
+	auto executor = std::make_shared<TaskExecutor>(options);
+	t.setExecutor(executor);
+	EXPECT_EQ(t.executor(), executor);
+
+	std::atomic<unsigned int> running{ 0 };
+	std::atomic<unsigned int> max_running{ 0 };
+	auto probe = add(t, new ConcurrencyProbe(running, max_running));
+	add(t, new ForwardMockup());
+	t.setNumThreads(2);
+
+	// a second task sharing the executor, planning concurrently
+	Task other;
+	other.setRobotModel(getModel());
+	other.setExecutor(executor);
+	auto other_probe = add(other, new ConcurrencyProbe(running, max_running));
+	other.setNumThreads(2);
+
+	std::thread other_planning([&other]() { EXPECT_TRUE(other.plan()); });
+	EXPECT_TRUE(t.plan());
+	other_planning.join();
+	EXPECT_EQ(t.solutions().size(), 3u);
+	EXPECT_EQ(other.solutions().size(), 3u);
+	// computations of both tasks took turns
+	EXPECT_EQ(max_running, 1u);
+	// stages compute with their task's executor, which isn't the process-wide one
+	EXPECT_EQ(probe->executor_, executor);
+	EXPECT_EQ(other_probe->executor_, executor);
+	EXPECT_EQ(TaskExecutor::current(), TaskExecutor::instance());
+
+	// reset to process-wide executor
+	t.setExecutor(nullptr);
+	EXPECT_EQ(t.executor(), TaskExecutor::instance());
+}
+
+TEST(FixedState, bulkStates) {
+	Task t;
+	t.setRobotModel(getModel());
+	auto base = std::make_shared<const planning_scene::PlanningScene>(t.getRobotModel());
+	std::vector<moveit::core::RobotState> states(3, base->getCurrentState());
+	for (size_t i = 0; i < states.size(); ++i) {
+		states[i].setVariablePosition(0, 0.1 * (i + 1));
+		states[i].update();
+	}
+	auto fixed = new stages::FixedState("fixed");
+	fixed->setStates(base, states, { 2.0, 0.0, 1.0 });
+	fixed->properties().set("ignore_collisions", true);
+	t.add(Stage::pointer(fixed));
+
+	// states are spawned lazily, in priority order
+	ASSERT_TRUE(t.plan(1));
+	ASSERT_EQ(t.solutions().size(), 1u);
+	const auto& scene = (*t.solutions().begin())->end()->scene();
+	EXPECT_EQ(scene->getParent(), base);
+	EXPECT_DOUBLE_EQ(scene->getCurrentState().getVariablePosition(0), 0.2);
+
+	t.reset();
+	ASSERT_TRUE(t.plan(0));
+	EXPECT_EQ(t.solutions().size(), 3u);
+}
+
+TEST(SolutionSequence, flattened) {
+	const moveit::core::RobotModelConstPtr robot{ getModel() };
+	auto traj{ std::make_shared<robot_trajectory::RobotTrajectory>(robot, nullptr) };
+	moveit::core::RobotState state{ robot };
+	state.setToDefaultValues();
+	for (int i = 0; i < 3; ++i)
+		traj->addSuffixWayPoint(state, 0.1);
+
+	SubTrajectory a{ traj, 1.0 }, b{ nullptr, 2.0 }, c{ traj, 4.0 };
+	SolutionSequence inner{ { &b, &c } };
+	WrappedSolution wrapped{ nullptr, &inner, 0.0 };
+	SolutionSequence outer{ { &a, &wrapped } };
+
+	const SolutionSequence::Flattened& flat = outer.flattened();
+	ASSERT_EQ(flat.leaves.size(), 3u);
+	EXPECT_EQ(flat.leaves[0].trajectory, &a);
+	EXPECT_EQ(flat.leaves[1].trajectory, &b);
+	EXPECT_EQ(flat.leaves[2].trajectory, &c);
+	EXPECT_EQ(flat.leaves[1].cost_offset, 1.0);
+	EXPECT_EQ(flat.leaves[2].cost_offset, 3.0);
+	EXPECT_EQ(flat.leaves[2].waypoint_offset, 3u);
+	EXPECT_EQ(flat.cost, 7.0);
+	EXPECT_EQ(flat.waypoints, 6u);
+	// cached result is returned on subsequent calls
+	EXPECT_EQ(&outer.flattened(), &flat);
+
+	SubTrajectory d{ traj, 8.0 };
+	outer.push_back(d);
+	EXPECT_EQ(outer.flattened().leaves.size(), 4u);
+	EXPECT_EQ(outer.flattened().waypoints, 9u);
+}
+
+TEST_F(TaskTestBase, interfaceMetrics) {
+	Interface::setMetricsEnabled(true);
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	auto* fw = add(t, new ForwardMockup());
+	auto* conn = add(t, new ConnectMockup());
+	add(t, new GeneratorMockup({ 1.0 }));
+	EXPECT_TRUE(t.plan());
+	Interface::setMetricsEnabled(false);
+
+	// propagator expanded (and removed) all states
+	Interface::Metrics m = fw->pimpl()->starts()->metrics();
+	EXPECT_EQ(m.added, 3u);
+	EXPECT_EQ(m.expanded, 3u);
+	EXPECT_EQ(m.pending, 0u);
+	EXPECT_EQ(m.states, 0u);
+	EXPECT_GE(m.max_age, m.mean_age);
+
+	// connecting stage keeps expanded states
+	m = conn->pimpl()->starts()->metrics();
+	EXPECT_EQ(m.added, 3u);
+	EXPECT_EQ(m.expanded, 3u);
+	EXPECT_EQ(m.states, 3u);
+	EXPECT_GE(m.max_depth, 2u);
+	EXPECT_EQ(conn->pimpl()->ends()->metrics().expanded, 1u);
+
+	// running counts match the current states
+	size_t enabled = 0, pruned = 0;
+	for (const InterfaceState* s : *conn->pimpl()->starts()) {
+		enabled += s->priority().enabled();
+		pruned += s->priority().status() == InterfaceState::Status::PRUNED;
+	}
+	EXPECT_EQ(m.enabled, enabled);
+	EXPECT_EQ(m.pruned, pruned);
+
+	// reset clears the metrics along with the states
+	t.reset();
+	m = conn->pimpl()->starts()->metrics();
+	EXPECT_EQ(m.states, 0u);
+	EXPECT_EQ(m.enabled, 0u);
+	EXPECT_EQ(m.added, 0u);
+	EXPECT_EQ(m.expanded, 0u);
+	EXPECT_EQ(m.pending, 0u);
+	EXPECT_EQ(m.max_depth, 0u);
+}
+
+TEST_F(TaskTestBase, containerDeadline) {
+	add(t, new GeneratorMockup(PredefinedCosts{ std::list<double>(10, 0.0), true }));
+	auto* phase = add(t, new SerialContainer("phase"));
+	auto* fwd = add(*phase, new ForwardMockup());
+	// any compute() exceeds this deadline, independent of the machine's speed
+	phase->setDeadline(1e-9);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_TRUE(phase->deadlineExceeded());
+	EXPECT_EQ(fwd->runs_, 1u);
+	// the container accounts the time of its compute() call, including its child's
+	EXPECT_NEAR(phase->deadlineUsed(), phase->getTotalComputeTime(), 1e-9);
+	EXPECT_EQ(t.numSolutions(), 1u);
+
+	// refilling the deadline grants another compute() step for the pending states
+	phase->refillDeadline();
+	EXPECT_FALSE(phase->deadlineExceeded());
+	EXPECT_EQ(phase->deadlineUsed(), 0.0);
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(fwd->runs_, 2u);
+	EXPECT_EQ(t.numSolutions(), 2u);
+}
+
+TEST_F(TaskTestBase, containerDeadlineScheduled) {
+	t.setSchedulingPolicy(Task::BEST_FIRST);
+	auto* gen = add(t, new GeneratorMockup(PredefinedCosts{ std::list<double>(10, 0.0), true }));
+	auto* phase = add(t, new SerialContainer("phase"));
+	auto* fwd = add(*phase, new ForwardMockup());
+	phase->setDeadline(1e-9);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_TRUE(phase->deadlineExceeded());
+	// units below the exhausted container are skipped, while the rest of the task continues planning
+	EXPECT_EQ(fwd->runs_, 1u);
+	EXPECT_EQ(gen->runs_, 10u);
+	EXPECT_EQ(t.numSolutions(), 1u);
+	// the transparent container is scheduled via its child, which charges its compute time
+	EXPECT_EQ(phase->getTotalComputeTime(), 0.0);
+	EXPECT_NEAR(phase->deadlineUsed(), fwd->getTotalComputeTime(), 1e-9);
+}
+
+TEST_F(TaskTestBase, mergerSequentialByDefault) {
+	struct ThreadForward : ForwardMockup
+	{
+		std::thread::id* thread_;
+		ThreadForward(std::thread::id* thread) : ForwardMockup(PredefinedCosts::constant(INF)), thread_(thread) {}
+		void computeForward(const InterfaceState& from) override {
+			*thread_ = std::this_thread::get_id();
+			ForwardMockup::computeForward(from);
+		}
+	};
+	std::thread::id threads[2];
+	add(t, new GeneratorMockup());
+	auto* merger = add(t, new Merger());
+	add(*merger, new ThreadForward(&threads[0]));
+	add(*merger, new ThreadForward(&threads[1]));
+	EXPECT_FALSE(merger->properties().get<bool>("concurrent"));
+
+	EXPECT_FALSE(t.plan());  // children only fail, nothing to merge
+	// both children were computed by the planning thread
+	EXPECT_EQ(threads[0], std::this_thread::get_id());
+	EXPECT_EQ(threads[1], std::this_thread::get_id());
+}
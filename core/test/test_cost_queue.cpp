@@ -1,5 +1,6 @@
 #include <list>
 #include <memory>
+#include <vector>
 #include <moveit/task_constructor/cost_queue.h>
 #include <moveit/task_constructor/storage.h>
 #include <gtest/gtest.h>
@@ -181,3 +182,67 @@ TEST_F(CostOrderedTestInt, update) {
 	EXPECT_EQ(queue.top(), first);
 	EXPECT_EQ(*(++queue.begin()), added);
 }
+
+TEST(Ordered, updateAndErase) {
+	std::vector<int> values{ 5, 3, 1, 4, 2 };
+	ordered<int*> queue;
+	std::vector<ordered<int*>::iterator> its;
+	for (int& v : values)
+		its.push_back(queue.insert(&v));
+
+	auto sorted = [&queue]() {
+		std::vector<int> result;
+		for (int* v : queue)
+			result.push_back(*v);
+		return result;
+	};
+	EXPECT_THAT(sorted(), ::testing::ElementsAre(1, 2, 3, 4, 5));
+
+	// change value without updating position first
+	values[0] = 0;
+	queue.update(its[0]);
+	EXPECT_THAT(sorted(), ::testing::ElementsAre(0, 1, 2, 3, 4));
+
+	queue.erase(its[3]);
+	EXPECT_THAT(sorted(), ::testing::ElementsAre(0, 1, 2, 3));
+	values[1] = 10;
+	queue.update(its[1]);
+	queue.insert(&values[3]);
+	EXPECT_THAT(sorted(), ::testing::ElementsAre(0, 1, 2, 4, 10));
+
+	// find by identity, modify and update position
+	const auto revision = queue.revision();
+	EXPECT_EQ(queue.find(&values[2]), its[2]);
+	EXPECT_EQ(queue.revision(), revision);  // lookup doesn't modify
+	int other = 1;  // equivalent to values[2], but not part of the queue
+	EXPECT_EQ(queue.find(&other), queue.end());
+	queue.update(queue.find(&values[2]), [](int* v) { *v = 20; });
+	EXPECT_THAT(sorted(), ::testing::ElementsAre(0, 2, 4, 10, 20));
+	EXPECT_EQ(queue.back(), &values[2]);
+	EXPECT_GT(queue.revision(), revision);
+}
+
+TEST(Ordered, merge) {
+	std::vector<int> values{ 1, 3, 5, 4, 2, 3 };
+	ordered<int*> queue;
+	queue.insert(&values[0]);
+	queue.insert(&values[1]);
+	queue.insert(&values[2]);
+
+	std::list<int*> batch{ &values[3], &values[4], &values[5] };
+	auto added = batch.begin();
+	queue.merge(batch);
+	EXPECT_TRUE(batch.empty());
+	EXPECT_EQ(*added, &values[3]);  // iterators remain valid
+
+	std::vector<int*> order(queue.begin(), queue.end());
+	// new items are added behind existing items with the same value
+	EXPECT_THAT(order, ::testing::ElementsAre(&values[0], &values[4], &values[1], &values[5], &values[3], &values[2]));
+	// index is consistent with the list
+	queue.erase(added);
+	values[0] = 6;
+	auto first = queue.begin();
+	queue.update(first);
+	EXPECT_EQ(queue.back(), &values[0]);
+	EXPECT_EQ(queue.size(), 5u);
+}
@@ -346,3 +346,101 @@ TEST(CostTerm, CompositeSolutionsContainerCost) {
 	    << "container cost term overwrites stage costs";
 	EXPECT_EQ(s1_ptr->solutions().front()->cost(), STAGE_COST) << "child cost is not affected";
 }
+
+TEST(CostTerm, MemoizedCost) {
+	unsigned int calls = 0;
+	LambdaCostTerm term{ [&calls](auto&& /*s*/, auto&& comment) {
+		++calls;
+		comment = "counted";
+		return 2.0;
+	} };
+
+	SubTrajectory sub;
+	SolutionSequence sequence{ { &sub, &sub } };
+	std::string comment;
+	EXPECT_EQ(sequence.memoizedCost(term, comment), 4.0);
+	EXPECT_EQ(calls, 1u) << "shared sub solution is evaluated once";
+	EXPECT_EQ(comment, "counted, counted") << "memoized comment is reported";
+
+	WrappedSolution wrapped{ nullptr, &sequence };
+	comment.clear();
+	EXPECT_EQ(wrapped.memoizedCost(term, comment), 4.0);
+	EXPECT_EQ(calls, 1u) << "wrapper reuses cost of wrapped solution";
+	EXPECT_EQ(comment, "counted, counted");
+
+	cost::Constant constant{ 1.0 };
+	EXPECT_EQ(sub.memoizedCost(constant, comment), 1.0) << "other cost terms are evaluated separately";
+}
+
+TEST(CostTerm, PathLength) {
+	const moveit::core::RobotModelConstPtr robot{ getModel() };
+	auto traj{ std::make_shared<robot_trajectory::RobotTrajectory>(robot, nullptr) };
+	moveit::core::RobotState state{ robot };
+	for (const std::vector<double>& positions : { std::vector<double>{ 0.0, 0.0, 0.0 }, { 0.5, -0.5, 0.0 },
+	                                               { 0.5, -0.5, 6.0 } }) {
+		state.setVariablePositions(positions);
+		traj->addSuffixWayPoint(state, 0.1);
+	}
+	SubTrajectory s{ traj };
+	std::string comment;
+
+	// all joints are continuous: the last step wraps around
+	EXPECT_NEAR(cost::PathLength()(s, comment), 1.0 + 2.0 * M_PI - 6.0, 1e-9);
+	EXPECT_NEAR(cost::PathLength({ "base-link1-joint" })(s, comment), 0.5, 1e-9);
+
+	cost::PathLength weighted;
+	weighted.weights = { { "base-link1-joint", 2.0 }, { "link2-tip-joint", 0.5 } };
+	EXPECT_NEAR(weighted(s, comment), 1.0 + 0.5 * (2.0 * M_PI - 6.0), 1e-9);
+}
+
+TEST(CostTerm, LinkMotion) {
+	const moveit::core::RobotModelConstPtr robot{ getModel() };
+	auto traj{ std::make_shared<robot_trajectory::RobotTrajectory>(robot, nullptr) };
+	moveit::core::RobotState state{ robot };
+	for (double position : { 0.0, 0.5, 1.0 }) {
+		state.setVariablePositions({ position, -position, position });
+		state.update();
+		traj->addSuffixWayPoint(state, 0.1);
+	}
+	SubTrajectory s{ traj };
+
+	auto positions{ s.framePositions("tip") };
+	ASSERT_TRUE(positions);
+	ASSERT_EQ(positions->cols(), 3);
+	for (size_t i = 0; i < traj->getWayPointCount(); ++i)
+		EXPECT_TRUE(positions->col(i).isApprox(traj->getWayPoint(i).getGlobalLinkTransform("tip").translation()));
+	EXPECT_EQ(s.framePositions("tip"), positions) << "positions are cached";
+
+	std::string comment;
+	EXPECT_EQ(cost::LinkMotion("unknown")(s, comment), std::numeric_limits<double>::infinity());
+	EXPECT_FALSE(comment.empty());
+}
+
+TEST(CostTerm, Composite) {
+	const moveit::core::RobotModelConstPtr robot{ getModel() };
+	auto traj{ std::make_shared<robot_trajectory::RobotTrajectory>(robot, nullptr) };
+	moveit::core::RobotState state{ robot };
+	for (double position : { 0.0, 0.5 }) {
+		state.setVariablePositions({ position, position, position });
+		traj->addSuffixWayPoint(state, 0.1);
+	}
+	SubTrajectory s{ traj };
+
+	unsigned int computed = 0;
+	auto shared{ std::make_shared<LambdaCostTerm>([&computed](const SubTrajectory& s) {
+		return *s.sharedData<double>("test", [&computed]() {
+			++computed;
+			return std::make_shared<double>(1.0);
+		});
+	}) };
+
+	cost::Composite composite;
+	composite.add(std::make_shared<cost::Constant>(1.0), 2.0);
+	composite.add(std::make_shared<cost::PathLength>(), 0.5);
+	composite.add(shared, 3.0);
+	composite.add(std::make_shared<LambdaCostTerm>(*shared));
+
+	std::string comment;
+	EXPECT_NEAR(composite(s, comment), 2.0 + 0.5 * 1.5 + 3.0 + 1.0, 1e-9);
+	EXPECT_EQ(computed, 1u) << "sub terms share per-trajectory data";
+}
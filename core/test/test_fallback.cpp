@@ -81,6 +81,39 @@ TEST_F(FallbacksFixturePropagate, computeFirstSuccessfulStagePerSolutionOnly) {
 	EXPECT_COSTS(t.solutions(), testing::ElementsAre(113, 124, 212, 221));
 }
 
+TEST_F(FallbacksFixturePropagate, speculativeSolutionsUsedOnFailure) {
+	t.setNumThreads(2);
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts::single(0.0)));
+
+	auto fallbacks = std::make_unique<Fallbacks>("Fallbacks");
+	fallbacks->setSpeculative(true);
+	fallbacks->add(std::make_unique<ForwardMockup>(PredefinedCosts::single(INF)));
+	fallbacks->add(std::make_unique<ForwardMockup>(PredefinedCosts::single(2.0)));
+	t.add(std::move(fallbacks));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(2));
+}
+
+TEST_F(FallbacksFixturePropagate, speculativeSolutionsDiscardedOnSuccess) {
+	t.setNumThreads(2);
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts::single(0.0)));
+
+	auto fallbacks = std::make_unique<Fallbacks>("Fallbacks");
+	fallbacks->setSpeculative(true);
+	auto* first = new ForwardMockup(PredefinedCosts::single(1.0));
+	auto* second = new ForwardMockup(PredefinedCosts::single(2.0));
+	fallbacks->add(Stage::pointer(first));
+	fallbacks->add(Stage::pointer(second));
+	t.add(std::move(fallbacks));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(1));
+	// second child computed speculatively in parallel
+	EXPECT_EQ(first->runs_, 1u);
+	EXPECT_EQ(second->runs_, 1u);
+}
+
 // requires individual job control in Fallbacks's children
 TEST_F(FallbacksFixturePropagate, DISABLED_updateSolutionOrder) {
 	t.add(std::make_unique<BackwardMockup>(PredefinedCosts({ 10.0, 0.0 })));
@@ -159,6 +192,34 @@ TEST_F(FallbacksFixturePropagate, activeChildReset) {
 	EXPECT_COSTS(fwd2->solutions(), testing::IsEmpty());
 }
 
+TEST_F(FallbacksFixturePropagate, adaptiveOrder) {
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 1.0, 2.0 })));
+
+	auto fallbacks = std::make_unique<Fallbacks>("Fallbacks");
+	auto* first = new ForwardMockup(PredefinedCosts::constant(INF));
+	auto* second = new ForwardMockup(PredefinedCosts::constant(10.0));
+	fallbacks->add(Stage::pointer(first));
+	fallbacks->add(Stage::pointer(second));
+	EXPECT_EQ(fallbacks->childOrder(), std::vector<std::string>({ "FWD1", "FWD2" }));
+
+	// warm start from exported statistics: the first child used to fail
+	Fallbacks::OrderStatistics stats;
+	stats[""]["FWD1"] = Fallbacks::ChildStatistics{ 4, 0, 0.4 };
+	stats[""]["FWD2"] = Fallbacks::ChildStatistics{ 4, 4, 0.4 };
+	fallbacks->setOrderStatistics(stats);
+	EXPECT_EQ(fallbacks->childOrder(), std::vector<std::string>({ "FWD1", "FWD2" }));  // not yet enabled
+	fallbacks->setAdaptiveOrder(true);
+	EXPECT_EQ(fallbacks->childOrder(), std::vector<std::string>({ "FWD2", "FWD1" }));
+	auto* fallbacks_ptr = fallbacks.get();
+	t.add(std::move(fallbacks));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(11, 12));
+	EXPECT_EQ(first->runs_, 0u);
+	EXPECT_EQ(fallbacks_ptr->orderStatistics().at("").at("FWD2").attempts, 6u);
+	EXPECT_EQ(fallbacks_ptr->orderStatistics().at("").at("FWD2").successes, 6u);
+}
+
 using FallbacksFixtureConnect = TaskTestBase;
 
 TEST_F(FallbacksFixtureConnect, connectStageInsideFallbacks) {
@@ -1,10 +1,13 @@
 #include <moveit/task_constructor/storage.h>
 #include <moveit/task_constructor/stage_p.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <geometry_msgs/PoseStamped.h>
 
 #include "models.h"
 #include <memory>
 #include <algorithm>
+#include <cmath>
 #include <iterator>
 #include <vector>
 #include <gtest/gtest.h>
@@ -35,6 +38,23 @@ TEST(InterfaceStatePriority, compare) {
 	EXPECT_TRUE(Prio(0, 0) > Prio(1, 10));
 	EXPECT_TRUE(Prio(0, 0) >= Prio(0, 0));
 	EXPECT_TRUE(Prio(0, 10) >= Prio(0, 0));
+
+	// negative costs and large depths are ordered as well
+	EXPECT_TRUE(Prio(0, -42) < Prio(0, -1));
+	EXPECT_TRUE(Prio(0, -1) < Prio(0, 0));
+	EXPECT_TRUE(Prio(0, -0.0) == Prio(0, 0));
+	EXPECT_TRUE(Prio(1u << 31, 0) < Prio(1, 0));
+}
+
+TEST(InterfaceStatePriority, keepsValues) {
+	for (double cost : { 0.0, 1e-300, -1e-300, 42.5, -42.5, 1e300, -1e300 }) {
+		const Prio prio(7, cost, InterfaceState::Status::PRUNED);
+		EXPECT_EQ(prio.cost(), cost);
+		EXPECT_EQ(prio.depth(), 7u);
+		EXPECT_EQ(prio.status(), InterfaceState::Status::PRUNED);
+		EXPECT_EQ(Prio(prio, InterfaceState::Status::ENABLED).cost(), cost);
+		EXPECT_TRUE(Prio(prio, InterfaceState::Status::ENABLED).enabled());
+	}
 }
 
 using Prio = InterfaceState::Priority;
@@ -58,6 +78,163 @@ public:
 	}
 };
 
+TEST(InterfaceState, compactScene) {
+	planning_scene::PlanningScenePtr ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	for (int i = 0; i < 3; ++i)
+		ps = ps->diff();
+
+	InterfaceState state(ps);
+	state.compactScene(3);  // depth is within limit
+	EXPECT_EQ(state.scene(), ps);
+
+	state.compactScene(2);
+	EXPECT_NE(state.scene(), ps);
+	EXPECT_FALSE(state.scene()->getParent());
+}
+
+TEST(InterfaceState, sharedProperties) {
+	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	InterfaceState state(ps);
+	const PropertyMap& empty = static_cast<const InterfaceState&>(state).properties();
+	EXPECT_EQ(empty.begin(), empty.end());
+	state.properties().set("value", 1);
+
+	InterfaceState copy(state);
+	const InterfaceState& const_copy = copy;
+	EXPECT_EQ(&const_copy.properties(), &static_cast<const InterfaceState&>(state).properties());  // shared
+
+	copy.properties().set("value", 2);  // detaches
+	EXPECT_EQ(state.properties().get<int>("value"), 1);
+	EXPECT_EQ(copy.properties().get<int>("value"), 2);
+}
+
+TEST(SubTrajectory, cachedMessage) {
+	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	InterfaceState start(ps), end(ps->diff()->diff());
+	SubTrajectory solution;
+	solution.setStartState(start);
+	solution.setEndState(end);
+	solution.setComment("first");
+
+	moveit_task_constructor_msgs::Solution msg;
+	solution.fillMessage(msg);
+	solution.setComment("second");  // info is filled for each message
+	solution.fillMessage(msg);
+	ASSERT_EQ(msg.sub_trajectory.size(), 2u);
+	EXPECT_EQ(msg.sub_trajectory[0].info.comment, "first");
+	EXPECT_EQ(msg.sub_trajectory[1].info.comment, "second");
+	EXPECT_EQ(msg.sub_trajectory[0].scene_diff, msg.sub_trajectory[1].scene_diff);
+
+	// a replaced end scene is converted again
+	end.compactScene(1);
+	ASSERT_FALSE(end.scene()->getParent());
+	solution.fillMessage(msg);
+	ASSERT_EQ(msg.sub_trajectory.size(), 3u);
+	EXPECT_FALSE(msg.sub_trajectory[2].scene_diff == msg.sub_trajectory[0].scene_diff);
+	solution.unregisterFromStates();
+}
+
+TEST(SubTrajectory, deferredTimeParameterization) {
+	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	InterfaceState start(ps), end(ps->diff());
+	auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(ps->getRobotModel(), "group");
+	trajectory->addSuffixWayPoint(ps->getCurrentState(), 0.0);
+	trajectory->addSuffixWayPoint(ps->getCurrentState(), 0.0);
+	SubTrajectory solution(trajectory);
+	solution.setStartState(start);
+	solution.setEndState(end);
+
+	int calls = 0;
+	solution.deferTimeParameterization([&calls](robot_trajectory::RobotTrajectory& t) {
+		++calls;
+		t.setWayPointDurationFromPrevious(1, 2.0);
+		return true;
+	});
+	EXPECT_TRUE(solution.timeParameterizationPending());
+	EXPECT_EQ(calls, 0);
+
+	// only the published trajectory is parameterized, once
+	moveit_task_constructor_msgs::Solution msg;
+	solution.fillMessage(msg);
+	solution.fillMessage(msg);
+	EXPECT_EQ(calls, 1);
+	ASSERT_EQ(msg.sub_trajectory[0].trajectory.joint_trajectory.points.size(), 2u);
+	EXPECT_EQ(msg.sub_trajectory[0].trajectory.joint_trajectory.points[1].time_from_start.toSec(), 2.0);
+	EXPECT_EQ(solution.trajectory()->getWayPointDurationFromPrevious(1), 0.0);
+
+	// a failing parameterization is reported instead of publishing the estimated timing
+	solution.deferTimeParameterization([](robot_trajectory::RobotTrajectory& /*unused*/) { return false; });
+	EXPECT_EQ(solution.timedTrajectory(), nullptr);
+	msg.sub_trajectory.clear();
+	solution.fillMessage(msg);
+	ASSERT_EQ(msg.sub_trajectory.size(), 1u);
+	EXPECT_TRUE(msg.sub_trajectory[0].trajectory.joint_trajectory.points.empty());
+	EXPECT_TRUE(std::isinf(msg.sub_trajectory[0].info.cost));
+	EXPECT_EQ(msg.sub_trajectory[0].info.comment, "time parameterization failed");
+	solution.unregisterFromStates();
+}
+
+TEST(SubTrajectory, deferredComment) {
+	SubTrajectory solution;
+	int calls = 0;
+	EXPECT_FALSE(solution.hasComment());
+	solution.setComment("base");
+	solution.formatComment([&calls](std::string& comment) {
+		++calls;
+		comment += " (formatted)";
+	});
+	solution.markAsFailure([&calls] {
+		++calls;
+		return std::string("failure");
+	});
+	EXPECT_TRUE(solution.isFailure());
+	EXPECT_TRUE(solution.hasComment());
+	EXPECT_EQ(calls, 0);  // not formatted before accessed
+	SubTrajectory copy(solution);  // copies pending formatters
+	EXPECT_EQ(solution.comment(), "failure\nbase (formatted)");
+	EXPECT_EQ(solution.comment(), "failure\nbase (formatted)");
+	EXPECT_EQ(calls, 2);  // formatted only once
+	EXPECT_EQ(copy.comment(), "failure\nbase (formatted)");
+	EXPECT_EQ(calls, 4);  // the copy formats its own comment
+
+	SubTrajectory pending;
+	pending.formatComment([](std::string& comment) { comment = "pending"; });
+	EXPECT_TRUE(pending.hasComment());
+
+	solution.formatComment([](std::string& comment) { comment = "dropped"; });
+	solution.setComment("replaced");
+	EXPECT_EQ(solution.comment(), "replaced");
+}
+
+TEST(SubTrajectory, deferredMarkers) {
+	SubTrajectory solution;
+	int calls = 0;
+	solution.addMarkers([&calls](std::deque<visualization_msgs::Marker>& markers) {
+		++calls;
+		markers.emplace_back();
+	});
+	EXPECT_EQ(calls, 0);  // not generated before accessed
+	EXPECT_EQ(solution.markers().size(), 1u);
+	EXPECT_EQ(solution.markers().size(), 1u);
+	EXPECT_EQ(calls, 1);  // generated only once
+
+	// restore the process-wide setting for other tests, even if this one fails
+	struct MarkersDisabled
+	{
+		MarkersDisabled() { SolutionBase::setMarkersEnabled(false); }
+		~MarkersDisabled() { SolutionBase::setMarkersEnabled(true); }
+	};
+	moveit_task_constructor_msgs::SolutionInfo info;
+	{
+		MarkersDisabled disabled;
+		solution.addMarkers([&calls](std::deque<visualization_msgs::Marker>& /*markers*/) { ++calls; });
+		solution.fillInfo(info);
+	}
+	EXPECT_TRUE(SolutionBase::markersEnabled());
+	EXPECT_EQ(calls, 1);  // dropped generator
+	EXPECT_TRUE(info.markers.empty());
+}
+
 TEST(Interface, update) {
 	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
 	StoringInterface i;
@@ -72,6 +249,54 @@ TEST(Interface, update) {
 	EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 3, 6 }));
 }
 
+TEST(Interface, batchUpdate) {
+	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	unsigned int notifications = 0;
+	StoringInterface i([&notifications](Interface::iterator /*it*/, Interface::UpdateFlags updated) {
+		if (!updated)
+			return;  // new state
+		EXPECT_FALSE(updated.testFlag(Interface::STATUS));
+		++notifications;
+	});
+	i.add(InterfaceState(ps, Prio(1, 0.0)));
+	i.add(InterfaceState(ps, Prio(2, 0.0)));
+	i.add(InterfaceState(ps, Prio(3, 0.0)));
+	EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 3, 2, 1 }));
+
+	{
+		Interface::BatchUpdate batch;
+		InterfaceState* last = *i.rbegin();
+		i.updatePriority(last, Prio(4, 0.0));
+		i.updatePriority(last, Prio(5, 0.0));
+		i.updatePriority(*i.begin(), Prio(6, 0.0));
+		// neither re-sorted nor notified yet
+		EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 6, 2, 5 }));
+		EXPECT_EQ(notifications, 0u);
+	}
+	EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 6, 5, 2 }));
+	EXPECT_EQ(notifications, 2u);  // once per changed state
+}
+
+TEST(Interface, batchUpdateStatus) {
+	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	StoringInterface i;
+	i.add(InterfaceState(ps, Prio(1, 0.0, InterfaceState::Status::ARMED)));
+	i.add(InterfaceState(ps, Prio(2, 0.0)));
+	i.add(InterfaceState(ps, Prio(3, 0.0)));
+	i.add(InterfaceState(ps, Prio(4, 0.0)));
+	EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 4, 3, 2, 1 }));
+
+	{
+		Interface::BatchUpdate batch;
+		i.updatePriority(*i.begin(), Prio(1, 0.0));  // deferred
+		EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 1, 3, 2, 1 }));
+		// status updates are processed immediately, sorting into the (re-sorted) interface
+		i.updatePriority(*i.rbegin(), Prio(2, 0.0));
+		EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 3, 2, 2, 1 }));
+	}
+	EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 3, 2, 2, 1 }));
+}
+
 using PrioPair = std::pair<Prio, Prio>;
 inline bool operator<(const PrioPair& lhs, const PrioPair& rhs) {
 	return ConnectingPrivate::StatePair::less(lhs.first, lhs.second, rhs.first, rhs.second);
@@ -95,3 +320,40 @@ TEST(StatePairs, compare) {
 		EXPECT_TRUE(good_good < pair(bad, bad));
 	}
 }
+
+namespace {
+// property type without any serialization
+struct Opaque
+{
+	int value;
+};
+geometry_msgs::PoseStamped poseAt(double x) {
+	geometry_msgs::PoseStamped pose;
+	pose.header.frame_id = "world";
+	pose.pose.position.x = x;
+	pose.pose.orientation.w = 1.0;
+	return pose;
+}
+}  // namespace
+
+TEST(InterfaceState, sameContentComparesProperties) {
+	const double resolution = 1e-3;
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	InterfaceState a(scene), b(scene);
+	EXPECT_TRUE(a.sameContent(b, resolution));
+
+	// states of the same scene but for different target poses, e.g. created by GeneratePose
+	a.properties().set("target_pose", poseAt(1.0));
+	b.properties().set("target_pose", poseAt(2.0));
+	EXPECT_FALSE(a.sameContent(b, resolution));
+	b.properties().set("target_pose", poseAt(1.0));
+	EXPECT_TRUE(a.sameContent(b, resolution));
+	EXPECT_EQ(a.contentHash(resolution), b.contentHash(resolution));
+
+	// unserializable values are only equal if shared
+	a.properties().set("opaque", Opaque{ 1 });
+	b.properties().set("opaque", Opaque{ 1 });
+	EXPECT_FALSE(a.sameContent(b, resolution));
+	b.shareProperties(a);
+	EXPECT_TRUE(a.sameContent(b, resolution));
+}
@@ -0,0 +1,160 @@
+#include "models.h"
+#include "stage_mockups.h"
+
+#include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/introspection.h>
+
+#include <ros/init.h>
+#include <ros/node_handle.h>
+#include <ros/spinner.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+using namespace moveit::task_constructor;
+
+namespace {
+template <typename Predicate>
+bool waitFor(const Predicate& predicate) {
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (!predicate()) {
+		if (std::chrono::steady_clock::now() > deadline)
+			return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return true;
+}
+
+// collect all messages of a topic in the private namespace
+template <typename Msg>
+class Collector
+{
+	mutable std::mutex mutex_;
+	std::vector<Msg> msgs_;
+	ros::Subscriber sub_;
+
+public:
+	explicit Collector(const std::string& topic) {
+		sub_ = ros::NodeHandle("~").subscribe<Msg>(topic, 100, [this](const boost::shared_ptr<const Msg>& msg) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			msgs_.push_back(*msg);
+		});
+		EXPECT_TRUE(waitFor([this]() { return sub_.getNumPublishers() > 0; })) << topic;
+	}
+
+	// wait for (at least) num messages and return all received ones
+	std::vector<Msg> wait(size_t num) const {
+		EXPECT_TRUE(waitFor([&]() {
+			std::lock_guard<std::mutex> lock(mutex_);
+			return msgs_.size() >= num;
+		}));
+		std::lock_guard<std::mutex> lock(mutex_);
+		return msgs_;
+	}
+};
+using SolutionCollector = Collector<moveit_task_constructor_msgs::Solution>;
+using StatisticsCollector = Collector<moveit_task_constructor_msgs::TaskStatistics>;
+
+std::vector<double> costs(const std::vector<moveit_task_constructor_msgs::Solution>& msgs) {
+	std::vector<double> result;
+	for (const auto& msg : msgs)  // cost of the top-level solution
+		result.push_back(msg.sub_solution.empty() ? -1.0 : msg.sub_solution.front().info.cost);
+	return result;
+}
+}  // namespace
+
+// a planned task whose solutions are published on demand only
+struct PublishSolutionsTest : public testing::Test
+{
+	Task t{ "", false };
+
+	PublishSolutionsTest() {
+		resetMockupIds();
+		t.setRobotModel(getModel());
+		t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 4.0, 1.0, 3.0, 2.0, 5.0, 0.0 })));
+		EXPECT_TRUE(t.plan());
+
+		// introspection is enabled only now: nothing was published (or latched) while planning
+		t.enableIntrospection(true);
+	}
+};
+
+TEST_F(PublishSolutionsTest, parallelInOrder) {
+	ASSERT_EQ(t.solutions().size(), 6u);
+	SolutionCollector solutions(SOLUTION_TOPIC);
+
+	// more threads than solutions: messages are filled concurrently, but published by cost
+	EXPECT_EQ(t.introspection().publishSolutions(3, 1, 4), 3u);
+	EXPECT_THAT(costs(solutions.wait(3)), testing::ElementsAre(1.0, 2.0, 3.0));
+
+	// the last page is truncated, pages beyond the end publish nothing
+	EXPECT_EQ(t.introspection().publishSolutions(10, 4, 2), 2u);
+	EXPECT_EQ(t.introspection().publishSolutions(1, 6, 2), 0u);
+	const auto msgs = solutions.wait(5);
+	EXPECT_THAT(costs(msgs), testing::ElementsAre(1.0, 2.0, 3.0, 4.0, 5.0));
+
+	// all solutions share their start scene, which is sent along with the first message only
+	for (size_t i = 0; i != msgs.size(); ++i) {
+		EXPECT_EQ(msgs[i].start_scene_id, msgs.front().start_scene_id);
+		EXPECT_EQ(msgs[i].start_scene.name.empty() && msgs[i].start_scene.robot_model_name.empty(), i != 0)
+		    << "message " << i;
+	}
+}
+
+TEST(RemoteProfile, statistics) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 1.0, 2.0, 3.0 })));
+	t.introspection().setRemoteProfile(true);
+	// without subscribers, only the final state is published (as keyframe of remote statistics)
+	EXPECT_TRUE(t.plan());
+
+	// the latched local message is full, it is published after the remote one
+	StatisticsCollector local(STATISTICS_TOPIC);
+	EXPECT_FALSE(local.wait(1).front().delta);
+	// the remote keyframe is replayed to new subscribers
+	StatisticsCollector remote(REMOTE_NAMESPACE "/" STATISTICS_TOPIC);
+	const auto keyframe = remote.wait(1).front();
+	EXPECT_FALSE(keyframe.delta);
+	EXPECT_FALSE(keyframe.stages.empty());
+	for (const auto& stage : keyframe.stages) {
+		EXPECT_EQ(stage.compute_latency.total_count, 0u);
+		EXPECT_EQ(stage.solution_latency.total_count, 0u);
+	}
+	EXPECT_EQ(local.wait(1).front().seq, keyframe.seq);
+
+	// later messages are deltas for remote subscribers only
+	t.introspection().flushTaskState(true);
+	auto remote_msgs = remote.wait(2);
+	ASSERT_EQ(remote_msgs.size(), 2u);
+	EXPECT_TRUE(remote_msgs.back().delta);
+	EXPECT_EQ(remote_msgs.back().seq, keyframe.seq + 1);
+	auto local_msgs = local.wait(2);
+	ASSERT_EQ(local_msgs.size(), 2u);
+	EXPECT_FALSE(local_msgs.back().delta);
+	EXPECT_EQ(local_msgs.back().stages.size(), keyframe.stages.size());
+
+	// late subscribers receive the keyframe and all later deltas, followed by new messages without gaps or duplicates
+	StatisticsCollector late(REMOTE_NAMESPACE "/" STATISTICS_TOPIC);
+	late.wait(2);
+	t.introspection().flushTaskState(true);
+	const auto late_msgs = late.wait(3);
+	ASSERT_EQ(late_msgs.size(), 3u);
+	EXPECT_FALSE(late_msgs[0].delta);
+	for (size_t i = 0; i != late_msgs.size(); ++i) {
+		EXPECT_EQ(late_msgs[i].seq, keyframe.seq + i);
+		EXPECT_EQ(late_msgs[i].delta, i != 0);
+	}
+}
+
+int main(int argc, char** argv) {
+	testing::InitGoogleTest(&argc, argv);
+	ros::init(argc, argv, "introspection_test");
+	ros::AsyncSpinner spinner(1);
+	spinner.start();
+
+	return RUN_ALL_TESTS();
+}
@@ -119,6 +119,24 @@ TEST_F(PandaMoveRelative, cartesianRotateAttachedIKFrame) {
 	    << end_eef_position;
 }
 
+TEST_F(PandaMoveRelative, firstFeasibleDirection) {
+	auto vector = [](double z) {
+		geometry_msgs::Vector3Stamped v;
+		v.header.frame_id = "world";
+		v.vector.z = z;
+		return v;
+	};
+	// moving up by 5m is out of reach
+	move->setDirections({ vector(5.0), vector(-0.05) });
+	ASSERT_TRUE(t.plan());
+	ASSERT_EQ(move->solutions().size(), 1u);
+
+	const auto& tip_name{ group->getOnlyOneEndEffectorTip()->getName() };
+	const auto start_eef_position{ position(scene, tip_name) };
+	const auto end_eef_position{ position(move->solutions().front()->end()->scene(), tip_name) };
+	EXPECT_NEAR(end_eef_position.z() - start_eef_position.z(), -0.05, 1e-3);
+}
+
 int main(int argc, char** argv) {
 	testing::InitGoogleTest(&argc, argv);
 	ros::init(argc, argv, "move_relative_test");
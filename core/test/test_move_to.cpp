@@ -73,6 +73,14 @@ TEST_F(PandaMoveTo, stateTarget) {
 	EXPECT_ONE_SOLUTION;
 }
 
+TEST_F(PandaMoveTo, goalSet) {
+	move_to->setGoals({ std::string("ready"),
+	                    std::map<std::string, double>{ { "panda_joint1", TAU / 8 }, { "panda_joint2", TAU / 8 } } });
+	move_to->setNumThreads(2);
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 2u);
+}
+
 geometry_msgs::PoseStamped getFramePoseOfNamedState(RobotState state, std::string pose, std::string frame) {
 	state.setToDefaultValues(state.getRobotModel()->getJointModelGroup("panda_arm"), pose);
 	auto frame_eigen{ state.getFrameTransform(frame) };
@@ -0,0 +1,199 @@
+#include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/container.h>
+#include <moveit/task_constructor/storage.h>
+
+#include "stage_mockups.h"
+#include "models.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <list>
+#include <new>
+
+/* Performance regression tests
+ *
+ * Instead of wall time, which is too noisy on CI machines, these tests bound operation counts:
+ * heap allocations, allocated bytes, and priority updates of interface states, measured while planning.
+ * Each scenario is planned at two problem sizes and the growth of the counters is compared to the
+ * expected complexity, thus catching e.g. accidental quadratic behavior in SerialContainer::onNewSolution.
+ */
+
+namespace {
+std::atomic<size_t> num_allocations{ 0 };
+std::atomic<size_t> num_bytes{ 0 };
+
+void* allocate(std::size_t size) {
+	num_allocations.fetch_add(1, std::memory_order_relaxed);
+	num_bytes.fetch_add(size, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+}  // namespace
+
+// count all heap allocations of this test binary
+void* operator new(std::size_t size) {
+	return allocate(size);
+}
+void* operator new[](std::size_t size) {
+	return allocate(size);
+}
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+void operator delete(void* p, std::size_t /*size*/) noexcept {
+	std::free(p);
+}
+void operator delete[](void* p, std::size_t /*size*/) noexcept {
+	std::free(p);
+}
+
+using namespace moveit::task_constructor;
+
+namespace {
+struct Counters
+{
+	size_t allocations = 0;
+	size_t bytes = 0;
+	size_t priority_updates = 0;
+
+	static Counters now() {
+		Counters c;
+		c.allocations = num_allocations.load();
+		c.bytes = num_bytes.load();
+		c.priority_updates = Interface::numPriorityUpdates();
+		return c;
+	}
+	Counters operator-(const Counters& other) const {
+		Counters c;
+		c.allocations = allocations - other.allocations;
+		c.bytes = bytes - other.bytes;
+		c.priority_updates = priority_updates - other.priority_updates;
+		return c;
+	}
+};
+
+struct Measurement
+{
+	Counters counters;
+	size_t solutions = 0;  // solutions created by all stages
+	size_t task_solutions = 0;  // complete solutions of the task
+};
+
+// number of solutions (incl. failures) created by all stages of the task
+size_t countSolutions(const Task& t) {
+	size_t count = 0;
+	t.stages()->traverseRecursively([&count](const Stage& stage, unsigned int /*depth*/) {
+		count += stage.solutions().size() + stage.failures().size();
+		return true;
+	});
+	return count;
+}
+
+// list of n zero costs
+PredefinedCosts costs(size_t n) {
+	return PredefinedCosts{ std::list<double>(n, 0.0), true };
+}
+
+struct PerfTest : public testing::Test
+{
+	void SetUp() override { Interface::setCountPriorityUpdates(true); }
+	void TearDown() override { Interface::setCountPriorityUpdates(false); }
+
+	template <typename Setup>
+	Measurement measure(const Setup& setup) {
+		resetMockupIds();
+		Task t;
+		t.setRobotModel(getModel());
+		t.enableIntrospection(false);
+		setup(t);
+
+		const Counters before = Counters::now();
+		EXPECT_TRUE(t.plan());
+		Measurement m;
+		m.counters = Counters::now() - before;
+		m.solutions = countSolutions(t);
+		m.task_solutions = t.solutions().size();
+		return m;
+	}
+
+	// check that counters grow at most by factor when doubling the problem size
+	static void expectGrowth(const Measurement& small, const Measurement& large, double factor) {
+		EXPECT_LE(large.counters.allocations, factor * small.counters.allocations);
+		EXPECT_LE(large.counters.bytes, factor * small.counters.bytes);
+		EXPECT_LE(large.counters.priority_updates, factor * std::max<size_t>(small.counters.priority_updates, 1));
+	}
+};
+}  // namespace
+
+// a single generator producing many solutions, propagated by a few stages
+TEST_F(PerfTest, wideGenerator) {
+	constexpr size_t NUM_STAGES = 3;
+	auto scenario = [](size_t width) {
+		return [width](Task& t) {
+			t.add(std::make_unique<GeneratorMockup>(costs(width)));
+			for (size_t i = 1; i < NUM_STAGES; ++i)
+				t.add(std::make_unique<ForwardMockup>());
+		};
+	};
+	const Measurement small = measure(scenario(100));
+	const Measurement large = measure(scenario(200));
+
+	EXPECT_EQ(small.task_solutions, 100u);
+	EXPECT_EQ(large.task_solutions, 200u);
+	// each stage creates one solution per generator solution, the task wraps each complete solution
+	EXPECT_EQ(large.solutions, (NUM_STAGES + 1) * 200u);
+	// a new solution of the i-th forward stage updates the i+1 states along its partial path, i.e.
+	// sum(i+1, i=1..NUM_STAGES-1) = 5 updates per generator solution, leaving some slack for notifications
+	EXPECT_LE(large.counters.priority_updates, 4 * NUM_STAGES * 200u);
+	expectGrowth(small, large, 2.5);  // linear in width, fixed overhead only lowers the ratio
+}
+
+// a deep serial chain propagating a few generator solutions
+TEST_F(PerfTest, deepSerialChain) {
+	constexpr size_t WIDTH = 5;
+	auto scenario = [](size_t depth) {
+		return [depth](Task& t) {
+			t.add(std::make_unique<GeneratorMockup>(costs(WIDTH)));
+			for (size_t i = 1; i < depth; ++i)
+				t.add(std::make_unique<ForwardMockup>());
+		};
+	};
+	const Measurement small = measure(scenario(25));
+	const Measurement large = measure(scenario(50));
+
+	EXPECT_EQ(small.task_solutions, WIDTH);
+	EXPECT_EQ(large.task_solutions, WIDTH);
+	EXPECT_EQ(large.solutions, (50 + 1) * WIDTH);
+	// every new child solution updates the states along its partial path: ~depth^2/2 per generator solution
+	EXPECT_LE(large.counters.priority_updates, 2 * WIDTH * 50u * 50u);
+	// quadratic in depth (deferred priority updates are recorded in hash maps): 4x plus some slack
+	expectGrowth(small, large, 4.5);
+}
+
+// large fan-out of a parallel container
+TEST_F(PerfTest, parallelFanOut) {
+	constexpr size_t WIDTH = 5;
+	auto scenario = [](size_t children) {
+		return [children](Task& t) {
+			t.add(std::make_unique<GeneratorMockup>(costs(WIDTH)));
+			auto alternatives = std::make_unique<Alternatives>();
+			for (size_t i = 0; i < children; ++i)
+				alternatives->add(std::make_unique<ForwardMockup>());
+			t.add(std::move(alternatives));
+		};
+	};
+	const Measurement small = measure(scenario(50));
+	const Measurement large = measure(scenario(100));
+
+	EXPECT_EQ(small.task_solutions, 50 * WIDTH);
+	EXPECT_EQ(large.task_solutions, 100 * WIDTH);
+	// generator, children, Alternatives, and task wrapper
+	EXPECT_EQ(large.solutions, WIDTH + 3 * 100 * WIDTH);
+	expectGrowth(small, large, 2.5);  // linear in fan-out
+}
@@ -1,4 +1,5 @@
 #include <moveit/task_constructor/properties.h>
+#include <geometry_msgs/PoseStamped.h>
 
 #include <gtest/gtest.h>
 #include <initializer_list>
@@ -76,6 +77,47 @@ TEST(Property, reset) {
 	EXPECT_EQ(props.get<double>("double1"), 1.0);
 }
 
+TEST(Property, assignInPlace) {
+	PropertyMap props;
+	props.declare<std::string>("string", std::string("default"));
+	props.setCurrent("string", std::string("first"));
+	const std::string* stored = &props.get<std::string>("string");
+
+	// assigning a value of the same type reuses the stored instance
+	props.setCurrent("string", std::string("second"));
+	EXPECT_EQ(&props.get<std::string>("string"), stored);
+	EXPECT_EQ(props.get<std::string>("string"), "second");
+	EXPECT_THROW(props.setCurrent("string", 1.0), Property::type_error);
+
+	props.reset();
+	EXPECT_EQ(props.get<std::string>("string"), "default");
+}
+
+TEST(Property, handle) {
+	PropertyMap props;
+	props.declare<double>("double1", 1.0);
+	props.declare<double>("double2");
+	EXPECT_THROW(props.handle<double>("double3"), Property::undeclared);
+	EXPECT_THROW(props.handle<int>("double1"), Property::type_error);
+
+	auto handle1 = props.handle<double>("double1");
+	auto handle2 = props.handle<double>("double2");
+	EXPECT_TRUE(handle1.valid());
+	EXPECT_EQ(handle1.get(), 1.0);
+	EXPECT_THROW(handle2.get(), Property::undefined);
+	EXPECT_EQ(handle2.get(2.0), 2.0);
+
+	// handles reflect later changes
+	props.set("double1", 3.0);
+	props.set("double2", 4.0);
+	EXPECT_EQ(handle1.get(), 3.0);
+	EXPECT_EQ(handle2.get(), 4.0);
+	props.setCurrent("double1", 5.0);
+	EXPECT_EQ(handle1.get(), 5.0);
+	props.reset();
+	EXPECT_EQ(handle1.get(), 3.0);
+}
+
 TEST(Property, anytype) {
 	PropertyMap props;
 	props.declare<boost::any>("any", "store any type");
@@ -107,6 +149,36 @@ TEST(Property, serialize) {
 	EXPECT_EQ(props.property("map").serialize(), "");
 }
 
+TEST(Property, serializeBinary) {
+	PropertyMap props;
+	props.declare<double>("double", 1.5);
+	geometry_msgs::PoseStamped pose;
+	pose.header.frame_id = "world";
+	pose.pose.position.x = 2.0;
+	props.declare<geometry_msgs::PoseStamped>("pose", pose);
+	props.declare<std::string>("string", std::string("foo"));
+
+	std::vector<uint8_t> data;
+	const Property& d = props.property("double");
+	ASSERT_TRUE(Property::serializeBinary(d.value(), data));
+	EXPECT_EQ(data.size(), sizeof(double));
+	EXPECT_EQ(boost::any_cast<double>(Property::deserializeBinary(d.typeName(), data)), 1.5);
+
+	const Property& p = props.property("pose");
+	ASSERT_TRUE(Property::serializeBinary(p.value(), data));
+	geometry_msgs::PoseStamped decoded =
+	    boost::any_cast<geometry_msgs::PoseStamped>(Property::deserializeBinary(p.typeName(), data));
+	EXPECT_EQ(decoded.header.frame_id, "world");
+	EXPECT_EQ(decoded.pose.position.x, 2.0);
+
+	// truncated data cannot be decoded
+	data.resize(data.size() / 2);
+	EXPECT_TRUE(Property::deserializeBinary(p.typeName(), data).empty());
+
+	// strings have no binary serialization
+	EXPECT_FALSE(Property::serializeBinary(props.property("string").value(), data));
+}
+
 class InitFromTest : public ::testing::Test
 {
 protected:
@@ -174,3 +246,28 @@ TEST_F(InitFromTest, function) {
 	slave.performInitFrom(1, master);
 	EXPECT_EQ(slave.get<double>("double3"), 3.0);
 }
+
+TEST_F(InitFromTest, memoized) {
+	unsigned int calls = 0;
+	slave.property("double3").configureInitFrom(1, [&calls](const PropertyMap& other) -> boost::any {
+		++calls;
+		return other.get<double>("double1") + other.get<double>("double2");
+	});
+	slave.performInitFrom(1, master);
+	slave.performInitFrom(1, master);  // unchanged inputs: skipped
+	EXPECT_EQ(calls, 1u);
+
+	PropertyMap copy(master);  // a copy shares the version of master
+	slave.performInitFrom(1, copy);
+	EXPECT_EQ(calls, 1u);
+
+	slave.reset();  // modified slave: re-initialize
+	slave.performInitFrom(1, master);
+	EXPECT_EQ(calls, 2u);
+
+	master.set("double1", 3.0);  // modified master: re-initialize
+	slave.reset();
+	slave.performInitFrom(1, master);
+	EXPECT_EQ(calls, 3u);
+	EXPECT_EQ(slave.get<double>("double3"), 5.0);
+}
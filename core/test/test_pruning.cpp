@@ -27,6 +27,16 @@ TEST_F(Pruning, PropagatorFailure) {
 	EXPECT_EQ(back->runs_, 0u);
 }
 
+TEST_F(Pruning, CountPrunedStates) {
+	add(t, new BackwardMockup());
+	add(t, new GeneratorMockup({ 0 }));
+	add(t, new ForwardMockup({ INF }));
+
+	EXPECT_FALSE(t.plan());
+	// both, the start and end state of the generator's solution were pruned
+	EXPECT_EQ(t.stages()->numPruned(), 2u);
+}
+
 TEST_F(Pruning, PruningMultiForward) {
 	add(t, new BackwardMockup());
 	add(t, new BackwardMockup());
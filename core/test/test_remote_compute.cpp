@@ -0,0 +1,57 @@
+#include "models.h"
+#include "stage_mockups.h"
+
+#include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/stages/remote_compute.h>
+
+#include <ros/init.h>
+#include <ros/spinner.h>
+#include <gtest/gtest.h>
+
+using namespace moveit::task_constructor;
+
+// a task with a remotely computed propagator, served by a worker within the same process
+struct RemoteComputeTest : public testing::Test
+{
+	moveit::core::RobotModelPtr model = getModel();
+	stages::RemoteComputeServer server{ model, "remote_compute_test" };
+	Task t;
+	ForwardMockup* child;
+
+	RemoteComputeTest() {
+		resetMockupIds();
+		t.setRobotModel(model);
+		t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 1.0, 2.0 })));
+		child = new ForwardMockup();
+		auto remote = std::make_unique<stages::RemoteCompute>("remote", Stage::pointer(child));
+		remote->setWorkers({ "remote_compute_test" });
+		t.add(std::move(remote));
+	}
+};
+
+TEST_F(RemoteComputeTest, computesOnWorker) {
+	server.add(child->name(), [] { return std::make_unique<ForwardMockup>(PredefinedCosts::constant(3.0)); });
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(child->runs_, 0u);  // not computed locally
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(4.0, 5.0));
+	// remote solutions are attributed to the wrapped child
+	EXPECT_EQ(child->solutions().size(), 2u);
+}
+
+TEST_F(RemoteComputeTest, reportsFailingWorker) {
+	// no factory registered for the child: the worker rejects the request
+	EXPECT_FALSE(t.plan());
+	EXPECT_EQ(child->runs_, 0u);
+	ASSERT_EQ(child->failures().size(), 2u);  // one per generated state
+	EXPECT_NE(child->failures().front()->comment().find("remote_compute_test"), std::string::npos);
+}
+
+int main(int argc, char** argv) {
+	testing::InitGoogleTest(&argc, argv);
+	ros::init(argc, argv, "remote_compute_test");
+	ros::AsyncSpinner spinner(1);
+	spinner.start();
+
+	return RUN_ALL_TESTS();
+}
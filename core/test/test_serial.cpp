@@ -65,6 +65,42 @@ TEST_F(ConnectConnect, SuccSucc) {
 	}
 }
 
+TEST_F(ConnectConnect, SuccSuccConcurrent) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	add(t, new Connect());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	add(t, new Connect());
+	add(t, new GeneratorMockup({ 0.0 }));
+
+	t.setNumThreads(4);
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(11, 12, 13, 21, 22, 23));
+}
+
+TEST_F(ConnectConnect, SuccSuccBestFirst) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	add(t, new Connect());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	add(t, new Connect());
+	add(t, new GeneratorMockup({ 0.0 }));
+
+	t.setSchedulingPolicy(Task::BEST_FIRST);
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(11, 12, 13, 21, 22, 23));
+}
+
+TEST_F(ConnectConnect, SuccSuccPipelined) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	add(t, new Connect());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	add(t, new Connect());
+	add(t, new GeneratorMockup({ 0.0 }));
+
+	t.setSchedulingPolicy(Task::PIPELINED);
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(11, 12, 13, 21, 22, 23));
+}
+
 // https://github.com/ros-planning/moveit_task_constructor/issues/218
 TEST_F(ConnectConnect, FailSucc) {
 	add(t, new GeneratorMockup());
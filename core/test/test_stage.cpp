@@ -1,14 +1,51 @@
 #include "models.h"
 
 #include <moveit/task_constructor/stage_p.h>
+#include <moveit/task_constructor/collision_backend.h>
+#include <moveit/task_constructor/collision_cache.h>
+#include <moveit/task_constructor/event_log.h>
+#include <moveit/task_constructor/pose_candidates.h>
+#include <moveit/task_constructor/reachability_map.h>
+#include <moveit/task_constructor/scratch_state.h>
+#include <moveit/task_constructor/statistics_record.h>
+#include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/task_p.h>
+#include <moveit/task_constructor/trace.h>
+#include <moveit/task_constructor/utils.h>
+#include <moveit/task_constructor/warm_start.h>
+#include <moveit/task_constructor/solvers/caching_planner.h>
+#include <moveit/task_constructor/solvers/experience_planner.h>
+#include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/task_constructor/solvers/pipeline_planner.h>
 #include <moveit/task_constructor/stages/compute_ik.h>
+#include <moveit/task_constructor/stages/connect.h>
+#include <moveit/task_constructor/stages/diversity_filter.h>
+#include <moveit/task_constructor/stages/fixed_cartesian_poses.h>
+#include <moveit/task_constructor/stages/fixed_state.h>
+#include <moveit/task_constructor/stages/generate_database_grasps.h>
+#include <moveit/task_constructor/stages/generate_grasp_pose.h>
 #include <moveit/task_constructor/stages/modify_planning_scene.h>
+#include <moveit/task_constructor/stages/move_to.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/plan_execution/plan_representation.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #include <geometry_msgs/PoseStamped.h>
+#include <geometric_shapes/shapes.h>
+#include <random_numbers/random_numbers.h>
 
 #include "stage_mockups.h"
 #include <ros/console.h>
 #include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
 
 using namespace moveit::task_constructor;
 using namespace planning_scene;
@@ -49,6 +86,56 @@ TEST(Stage, registerCallbacks) {
 	EXPECT_EQ(called, 1u);
 }
 
+TEST(Stage, forwardPropertiesShared) {
+	ForwardMockup stage;
+	stage.setForwardedProperties({ "a", "b" });
+	auto ps = std::make_shared<PlanningScene>(getModel());
+
+	InterfaceState source(ps);
+	source.properties().set("a", 1);
+	source.properties().set("b", 2);
+	InterfaceState shared(ps);
+	stage.forwardProperties(source, shared);  // all properties forwarded: shared
+	EXPECT_EQ(&static_cast<const InterfaceState&>(shared).properties(),
+	          &static_cast<const InterfaceState&>(source).properties());
+	EXPECT_EQ(shared.properties().get<int>("b"), 2);
+
+	source.properties().set("c", 3);
+	InterfaceState copied(ps);
+	stage.forwardProperties(source, copied);  // only a subset forwarded: copied
+	EXPECT_EQ(copied.properties().get<int>("a"), 1);
+	EXPECT_FALSE(copied.properties().hasProperty("c"));
+}
+
+TEST(JointPosture, compile) {
+	auto model = getModel();
+	const moveit::core::JointModelGroup* jmg = model->getJointModelGroup("group");
+	const std::string joint = jmg->getActiveJointModelNames().front();
+	moveit::core::RobotState state(model);
+	state.setToDefaultValues();
+
+	utils::JointPosture posture;
+	posture.compile(jmg, std::map<std::string, double>{ { joint, 0.5 } });
+	EXPECT_EQ(posture.group(), jmg);
+	posture.apply(state);
+	EXPECT_EQ(state.getVariablePosition(joint), 0.5);
+
+	moveit_msgs::RobotState msg;
+	msg.is_diff = true;
+	msg.joint_state.name = { joint };
+	msg.joint_state.position = { -0.5 };
+	posture.compile(jmg, msg);
+	posture.apply(state);
+	EXPECT_EQ(state.getVariablePosition(joint), -0.5);
+
+	EXPECT_THROW(posture.compile(jmg, "unknown"), moveit::Exception);
+	EXPECT_EQ(posture.group(), nullptr);
+	const std::string other = model->getJointModelGroup("eef_group")->getActiveJointModelNames().front();
+	EXPECT_THROW(posture.compile(jmg, std::map<std::string, double>{ { other, 0.0 } }), moveit::Exception);
+	msg.is_diff = false;
+	EXPECT_THROW(posture.compile(jmg, msg), moveit::Exception);
+}
+
 TEST(ComputeIK, init) {
 	auto g = std::make_unique<GeneratorMockup>();
 	stages::ComputeIK ik("ik", std::move(g));
@@ -77,6 +164,148 @@ TEST(ComputeIK, init) {
 	EXPECT_NO_THROW(ik.init(robot_model));
 }
 
+TEST(ComputeIK, cache) {
+	moveit::core::RobotModelPtr robot_model = getModel();
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	const moveit::core::LinkModel* link = robot_model->getLinkModel("link2");
+	stages::IKCache cache(0.01, 0.01, 2);
+
+	Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+	pose.translation() = Eigen::Vector3d(0.3, 0.0, 0.2);
+	EXPECT_TRUE(cache.lookup(jmg, link, pose).empty());
+
+	cache.store(jmg, link, pose, { 0.1, 0.2 });
+	cache.store(jmg, link, pose, { 0.1, 0.2 });  // duplicate
+	cache.store(jmg, link, pose, { 0.3, 0.4 });
+	cache.store(jmg, link, pose, { 0.5, 0.6 });  // evicts oldest
+	EXPECT_EQ(cache.size(), 1u);
+
+	// nearby pose maps to the same entry, most recent solution first
+	Eigen::Isometry3d nearby = pose;
+	nearby.translation().x() += 0.001;
+	auto solutions = cache.lookup(jmg, link, nearby);
+	ASSERT_EQ(solutions.size(), 2u);
+	EXPECT_EQ(solutions[0], std::vector<double>({ 0.5, 0.6 }));
+	EXPECT_EQ(solutions[1], std::vector<double>({ 0.3, 0.4 }));
+
+	// other poses and links don't
+	nearby.translation().x() += 0.02;
+	EXPECT_TRUE(cache.lookup(jmg, link, nearby).empty());
+	EXPECT_TRUE(cache.lookup(jmg, robot_model->getLinkModel("link1"), pose).empty());
+}
+
+TEST(ComputeIK, cacheBounded) {
+	moveit::core::RobotModelPtr robot_model = getModel();
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	const moveit::core::LinkModel* link = robot_model->getLinkModel("link2");
+	stages::IKCache cache(0.01, 0.01, 2, 2);
+
+	auto target = [](double x) {
+		Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+		pose.translation().x() = x;
+		return pose;
+	};
+	cache.store(jmg, link, target(0.1), { 0.1, 0.1 });
+	cache.store(jmg, link, target(0.2), { 0.2, 0.2 });
+	cache.store(jmg, link, target(0.1), { 0.3, 0.3 });  // refreshes target 0.1
+	cache.store(jmg, link, target(0.3), { 0.4, 0.4 });  // evicts target 0.2
+	EXPECT_EQ(cache.size(), 2u);
+	EXPECT_EQ(cache.lookup(jmg, link, target(0.1)).size(), 2u);
+	EXPECT_TRUE(cache.lookup(jmg, link, target(0.2)).empty());
+	EXPECT_EQ(cache.lookup(jmg, link, target(0.3)).size(), 1u);
+}
+
+TEST(ComputeIK, reachabilityMap) {
+	moveit::core::RobotModelPtr robot_model = getModel();
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	const moveit::core::LinkModel* link = robot_model->getLinkModel("link2");
+	auto map = ReachabilityMap::generate(jmg, link, 0.05, 1000, 42);
+	EXPECT_TRUE(map->matches(jmg, link));
+	EXPECT_FALSE(map->matches(jmg, robot_model->getLinkModel("link1")));
+
+	// the link position of any configuration is reachable, far away positions aren't
+	moveit::core::RobotState state(robot_model);
+	state.setToDefaultValues();
+	state.update();
+	const Eigen::Vector3d reached =
+	    state.getGlobalLinkTransform(ReachabilityMap::rootLink(jmg)).inverse() *
+	    state.getGlobalLinkTransform(link).translation();
+	const Eigen::Vector3d far(100.0, 100.0, 100.0);
+	EXPECT_GT(map->score(reached), 0.0);
+	EXPECT_EQ(map->score(far), 0.0);
+	EXPECT_TRUE(map->contains(reached));
+	EXPECT_FALSE(map->contains(far));
+
+	// a sparsely sampled map misses reachable voxels, which are still contained
+	auto sparse = ReachabilityMap::generate(jmg, link, 0.01, 10, 42);
+	random_numbers::RandomNumberGenerator rng(1);
+	size_t unreached = 0;
+	for (size_t i = 0; i != 100; ++i) {
+		state.setToRandomPositions(jmg, rng);
+		state.update();
+		const Eigen::Vector3d p = state.getGlobalLinkTransform(ReachabilityMap::rootLink(jmg)).inverse() *
+		                          state.getGlobalLinkTransform(link).translation();
+		if (sparse->score(p) == 0.0 && sparse->contains(p))
+			++unreached;
+	}
+	EXPECT_GT(unreached, 0u);  // reachable, but never sampled
+
+	const std::string file = testing::TempDir() + "reachability.bin";
+	map->save(file);
+	auto loaded = ReachabilityMap::load(file);
+	std::remove(file.c_str());
+	EXPECT_EQ(loaded->group(), "group");
+	EXPECT_EQ(loaded->link(), "link2");
+	EXPECT_EQ(loaded->size(), map->size());
+	EXPECT_EQ(loaded->score(reached), map->score(reached));
+	EXPECT_THROW(ReachabilityMap::load(file), std::runtime_error);
+}
+
+TEST(GraspDatabase, readWrite) {
+	using Grasp = stages::GraspDatabase::Grasp;
+	std::map<std::string, std::vector<Grasp>> grasps;
+	grasps["box"] = { Grasp{ { 0, 0, 0.1 }, { 0, 0, 0, 1 }, 0.05, 0.2 },
+		               Grasp{ { 0, 0, 0.2 }, { 0, 0, 0, 1 }, 0.06, 0.9 } };
+	grasps["cylinder"] = {};
+	const std::string file = testing::TempDir() + "grasps.bin";
+	ASSERT_TRUE(stages::GraspDatabase::write(file, grasps));
+
+	stages::GraspDatabase db;
+	ASSERT_TRUE(db.open(file));
+	EXPECT_EQ(db.objects(), std::vector<std::string>({ "box", "cylinder" }));
+	auto box = db.grasps("box");
+	ASSERT_EQ(box.size(), 2u);
+	EXPECT_FLOAT_EQ(box.begin[0].quality, 0.9);  // sorted by quality
+	EXPECT_FLOAT_EQ(box.begin[1].width, 0.05);
+	EXPECT_NEAR(box.begin[0].pose().translation().z(), 0.2, 1e-6);
+	EXPECT_EQ(db.grasps("cylinder").size(), 0u);
+	EXPECT_EQ(db.grasps("unknown").size(), 0u);
+	std::remove(file.c_str());
+
+	EXPECT_FALSE(db.open(file));
+}
+
+TEST(FixedCartesianPoses, loadPoses) {
+	std::vector<geometry_msgs::PoseStamped> poses(3);
+	for (auto& pose : poses)
+		pose.pose.orientation.w = 1.0;
+	poses[1].header.frame_id = "world";
+	poses[2].pose.position.x = 1.0;
+	const std::string file = testing::TempDir() + "poses.bin";
+	ASSERT_TRUE(stages::FixedCartesianPoses::savePoses(file, poses));
+
+	stages::FixedCartesianPoses stage;
+	EXPECT_TRUE(stage.loadPoses(file));
+	{  // drop the last value
+		std::ifstream is(file, std::ios::binary);
+		std::string content((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+		std::ofstream(file, std::ios::binary).write(content.data(), content.size() - sizeof(double));
+	}
+	EXPECT_FALSE(stage.loadPoses(file));
+	std::remove(file.c_str());
+	EXPECT_FALSE(stage.loadPoses(file));
+}
+
 TEST(ModifyPlanningScene, allowCollisions) {
 	auto s = std::make_unique<stages::ModifyPlanningScene>();
 	std::string first = "foo", second = "boom";
@@ -156,3 +385,1116 @@ TEST(Connect, compatible) {
 	attachObject(*other, "object", "tip", true);
 	EXPECT_FALSE(connect.compatible(scene, other)) << "different pose";
 }
+
+TEST(LatencyHistogram, quantiles) {
+	LatencyHistogram h;
+	EXPECT_EQ(h.count(), 0u);
+	EXPECT_EQ(h.quantile(0.5), 0.0);
+
+	for (int i = 1; i <= 100; ++i)
+		h.record(i * 1e-3);
+	EXPECT_EQ(h.count(), 100u);
+	EXPECT_DOUBLE_EQ(h.min(), 1e-3);
+	EXPECT_DOUBLE_EQ(h.max(), 0.1);
+	EXPECT_NEAR(h.mean(), 0.0505, 1e-9);
+	EXPECT_DOUBLE_EQ(h.quantile(0.0), 1e-3);
+	EXPECT_DOUBLE_EQ(h.quantile(1.0), 0.1);
+	// estimates are within bucket resolution
+	EXPECT_NEAR(h.quantile(0.5), 0.05, 0.2 * 0.05);
+	EXPECT_NEAR(h.quantile(0.9), 0.09, 0.2 * 0.09);
+
+	h.record(1e-9);  // below min resolution
+	h.record(1e6);  // above max resolution
+	EXPECT_EQ(h.buckets().front(), 1u);
+	EXPECT_EQ(h.buckets().back(), 1u);
+	EXPECT_DOUBLE_EQ(h.quantile(1.0), 1e6);
+
+	h.reset();
+	EXPECT_EQ(h.count(), 0u);
+}
+
+TEST(LatencyHistogram, decay) {
+	LatencyHistogram h;
+	for (int i = 0; i < 600; ++i)
+		h.record(1e-3);
+	for (int i = 0; i < 400; ++i)
+		h.record(0.1);
+	const double mean = h.mean();
+
+	h.decay(2000);  // no-op below the bound
+	EXPECT_EQ(h.count(), 1000u);
+
+	h.decay(100);  // distribution, mean, and extrema are kept
+	EXPECT_EQ(h.count(), 100u);
+	EXPECT_NEAR(h.mean(), mean, 1e-12);
+	EXPECT_DOUBLE_EQ(h.min(), 1e-3);
+	EXPECT_DOUBLE_EQ(h.max(), 0.1);
+	EXPECT_EQ(std::accumulate(h.buckets().begin(), h.buckets().end(), 0u), 100u);
+	EXPECT_NEAR(h.quantile(0.5), 1e-3, 0.2 * 1e-3);
+	EXPECT_NEAR(h.quantile(0.7), 0.1, 0.2 * 0.1);
+}
+
+TEST(Stage, latencyStatistics) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto gen = new GeneratorMockup({ 0.0, 0.0, 0.0 });
+	t.add(Stage::pointer(gen));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(gen->computeLatency().count(), 3u);
+	EXPECT_EQ(gen->solutionLatency().count(), 3u);
+	EXPECT_EQ(t.stages()->solutionLatency().count(), 3u);
+	EXPECT_LE(gen->computeLatency().sum(), gen->getTotalComputeTime() + 1e-9);
+
+	t.reset();
+	EXPECT_EQ(gen->computeLatency().count(), 0u);
+}
+
+TEST(Stage, adaptiveTimeout) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto gen = new GeneratorMockup({ 0.0, 0.0, 0.0 });
+	gen->setTimeout(10.0);
+	t.add(Stage::pointer(gen));
+
+	TimeoutPolicy policy = TimeoutPolicy::adaptive(0.95, 0.5);
+	policy.min_samples = 3;
+	t.setTimeoutPolicy(policy);
+	EXPECT_TRUE(t.plan());
+	EXPECT_TRUE(gen->timeoutPolicy().enabled());
+	EXPECT_EQ(gen->successLatency().count(), 3u);
+	// mockup computations take far less than min_timeout
+	EXPECT_DOUBLE_EQ(gen->timeout(), policy.min_timeout);
+
+	// the stage's own policy takes precedence over the task-wide one
+	gen->setTimeoutPolicy(TimeoutPolicy());
+	EXPECT_DOUBLE_EQ(gen->timeout(), 10.0);
+	t.reset();
+	EXPECT_EQ(gen->successLatency().count(), 0u);
+}
+
+// succeeds immediately for the first calls, afterwards fails after sleeping for its timeout
+struct TimingOutGenerator : Generator
+{
+	size_t successes_;
+	size_t max_calls_;
+	size_t calls_ = 0;
+	planning_scene::PlanningScenePtr scene_;
+
+	TimingOutGenerator(size_t successes, size_t max_calls)
+	  : Generator("TIMING_OUT"), successes_(successes), max_calls_(max_calls) {}
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override {
+		scene_ = std::make_shared<PlanningScene>(robot_model);
+		Generator::init(robot_model);
+	}
+	bool canCompute() const override { return calls_ < max_calls_; }
+	void compute() override {
+		if (calls_++ < successes_)
+			spawn(InterfaceState(scene_), 0.0);
+		else {
+			std::this_thread::sleep_for(std::chrono::duration<double>(timeout() + 1e-3));
+			silentFailure();
+		}
+	}
+};
+
+TEST(Stage, adaptiveTimeoutCountsTimeouts) {
+	Task t;
+	t.setRobotModel(getModel());
+	auto gen = new TimingOutGenerator(3, 7);
+	gen->setTimeout(1.0);
+	t.add(Stage::pointer(gen));
+
+	TimeoutPolicy policy = TimeoutPolicy::adaptive(0.5, 0.0);
+	policy.min_samples = 3;
+	gen->setTimeoutPolicy(policy);
+	EXPECT_TRUE(t.plan());
+	// 4 of 7 calls timed out: the median lies beyond all successful durations
+	EXPECT_EQ(gen->successLatency().count(), 3u);
+	EXPECT_DOUBLE_EQ(gen->timeout(), 1.0);
+}
+
+TEST(Task, persistentStatistics) {
+	const std::string file = testing::TempDir() + "statistics.bin";
+	std::remove(file.c_str());
+	{
+		resetMockupIds();
+		Task t;
+		t.setRobotModel(getModel());
+		t.add(Stage::pointer(new GeneratorMockup({ 0.0, 0.0, 0.0 })));
+		t.setStatisticsFile(file);
+		EXPECT_TRUE(t.plan());
+	}  // statistics are saved when planning finishes
+	{
+		resetMockupIds();
+		Task t;
+		t.setRobotModel(getModel());
+		auto gen = new GeneratorMockup({ 0.0 });
+		t.add(Stage::pointer(gen));
+		t.setStatisticsFile(file);
+		t.init();
+		ASSERT_TRUE(t.statistics());
+		EXPECT_EQ(t.statistics()->size(), 2u);  // root container and generator
+		EXPECT_EQ(gen->computeLatency().count(), 3u);
+		EXPECT_EQ(gen->successLatency().count(), 3u);
+
+		EXPECT_TRUE(t.plan());
+		EXPECT_EQ(gen->computeLatency().count(), 4u);
+		// statistics are carried across reset()
+		t.reset();
+		t.init();
+		EXPECT_EQ(gen->computeLatency().count(), 4u);
+	}
+	// the record is written via a temporary file, which doesn't remain
+	std::ifstream tmp(file + ".tmp" + std::to_string(getpid()));
+	EXPECT_FALSE(tmp.good());
+	std::remove(file.c_str());
+}
+
+TEST(Tracer, recordScopes) {
+	Tracer& tracer = Tracer::instance();
+	tracer.clear();
+	tracer.enable();
+	{
+		const std::string name = "inner \"quoted\"";
+		TraceScope scope("test", "outer", 42);
+		TraceScope inner("test", name);
+	}
+	tracer.disable();
+	{ TraceScope ignored("test", "disabled"); }
+
+	auto events = tracer.events();
+	ASSERT_EQ(events.size(), 2u);
+	EXPECT_EQ(events[0].name, "inner \"quoted\"");  // inner scope finishes first
+	EXPECT_EQ(events[1].name, "outer");
+	EXPECT_EQ(events[1].id, 42u);
+	EXPECT_EQ(events[0].thread, events[1].thread);
+	EXPECT_LE(events[1].start, events[0].start);
+
+	std::ostringstream os;
+	tracer.write(os);
+	EXPECT_NE(os.str().find("\"traceEvents\""), std::string::npos);
+	EXPECT_NE(os.str().find("inner \\\"quoted\\\""), std::string::npos);
+	tracer.clear();
+}
+
+TEST(EventLog, ringBuffer) {
+	EventLog& log = EventLog::instance();
+	log.clear();
+	const EventLog::Source stage = EventLog::newSource();
+	EXPECT_NE(EventLog::newSource(), stage) << "sources are unique";
+	for (size_t i = 0; i < EventLog::CAPACITY + 10; ++i)
+		log.record(stage, EventLog::COMPUTE, 0.5, i);
+
+	auto events = log.events();
+	ASSERT_EQ(events.size(), EventLog::CAPACITY) << "oldest events are overwritten";
+	EXPECT_EQ(events.front().arg, 10u);
+	EXPECT_EQ(events.back().arg, EventLog::CAPACITY + 9);
+	EXPECT_EQ(events.back().source, stage);
+	EXPECT_EQ(log.events(3).size(), 3u);
+
+	std::ostringstream os;
+	log.dump(os, [stage](EventLog::Source s) { return s == stage ? "stage" : ""; }, 1);
+	EXPECT_NE(os.str().find("'stage': compute took 0.5s"), std::string::npos);
+
+	log.clear();
+	EXPECT_TRUE(log.events().empty());
+}
+
+TEST(EventLog, taskEvents) {
+	EventLog& log = EventLog::instance();
+	log.clear();
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(Stage::pointer(new GeneratorMockup({ 0.0, 0.0 })));
+	EXPECT_FALSE(EventLog::enabled()) << "recording is opt-in";
+	EXPECT_TRUE(t.plan(1));
+	EXPECT_TRUE(log.events().empty());
+
+	log.enable();
+	EXPECT_TRUE(t.plan());
+	log.disable();
+	EXPECT_NE(t.dumpEvents().find("'GEN1': compute"), std::string::npos);
+	log.clear();
+}
+
+TEST(PlannerInterface, statistics) {
+	auto planner = std::make_shared<solvers::JointInterpolationPlanner>();
+	auto scene = std::make_shared<PlanningScene>(getModel());
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	const moveit::core::JointModelGroup* jmg = scene->getRobotModel()->getJointModelGroup("group");
+	robot_trajectory::RobotTrajectoryPtr result;
+
+	bool success = planner->plan(scene, scene, jmg, 1.0, result);
+	// fails (no IK solver) or forwards to the other plan() overload, which shouldn't be counted twice
+	planner->plan(scene, *scene->getRobotModel()->getLinkModel("tip"), Eigen::Isometry3d::Identity(), jmg, 0.1, result);
+
+	auto stats = planner->statistics();
+	ASSERT_EQ(stats.size(), 1u);
+	const auto& s = stats.begin()->second;
+	EXPECT_EQ(stats.begin()->first, std::make_pair(std::string("group"), std::string("joint_interpolation")));
+	EXPECT_EQ(s.calls, 2u);
+	EXPECT_LE(s.successes, success ? 2u : 1u);
+	EXPECT_EQ(s.planning_time.count(), 2u);
+
+	planner->resetStatistics();
+	EXPECT_TRUE(planner->statistics().empty());
+}
+
+// forwards plan() to the base class, but asynchronously on another thread
+struct AsyncForwardingPlanner : public solvers::JointInterpolationPlanner
+{
+	using JointInterpolationPlanner::plan;
+	bool plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
+	          const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	          const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(),
+	          const PreemptionToken* /*preempt*/ = nullptr) override {
+		CallRecorder recorder(*this, jmg, "forwarding", result);
+		auto async = launch([&](const PreemptionToken* preempt) {
+			PlanResult r;
+			r.success = JointInterpolationPlanner::plan(from, to, jmg, timeout, r.trajectory, path_constraints, preempt);
+			return r;
+		});
+		result = async.get().trajectory;
+		return recorder.finish(async.get().success);
+	}
+};
+
+// asynchronous plans only finish, failing, once canceled
+struct BlockingPlanner : public solvers::JointInterpolationPlanner
+{
+	std::atomic<int> canceled{ 0 };
+
+	using JointInterpolationPlanner::planAsync;
+	AsyncPlan planAsync(const planning_scene::PlanningSceneConstPtr& /*from*/,
+	                    const planning_scene::PlanningSceneConstPtr& /*to*/,
+	                    const moveit::core::JointModelGroup* /*jmg*/, double /*timeout*/,
+	                    const moveit_msgs::Constraints& /*path_constraints*/) override {
+		return launch([this](const PreemptionToken* preempt) {
+			while (!PreemptionToken::requested(preempt))
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			++canceled;
+			return PlanResult();
+		});
+	}
+};
+
+stages::Connect* addAsyncConnect(Task& t, const solvers::PlannerInterfacePtr& planner) {
+	t.setRobotModel(getArmModel());
+	auto start = std::make_shared<PlanningScene>(t.getRobotModel());
+	auto goal = start->diff();
+	goal->getCurrentStateNonConst().setVariablePosition("base-link1-joint", 0.5);
+	t.add(std::make_unique<stages::FixedState>("start", start));
+	auto c = std::make_unique<stages::Connect>("connect", stages::Connect::GroupPlannerVector{ { "group", planner } });
+	c->setAsyncPlanning(true);
+	stages::Connect* connect = c.get();
+	t.add(std::move(c));
+	t.add(std::make_unique<stages::FixedState>("goal", goal));
+	return connect;
+}
+
+TEST(Connect, asyncPlanning) {
+	Task t;
+	stages::Connect* connect = addAsyncConnect(t, std::make_shared<solvers::JointInterpolationPlanner>());
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.numSolutions(), 1u);
+	// resuming the plan's continuation doesn't count as a compute() call
+	EXPECT_EQ(connect->computeLatency().count(), 1u);
+	EXPECT_EQ(connect->numPendingContinuations(), 0u);
+}
+
+TEST(Connect, asyncPlanningCanceled) {
+	auto planner = std::make_shared<BlockingPlanner>();
+	Task t;
+	stages::Connect* connect = addAsyncConnect(t, planner);
+
+	// preemption cancels the running plan
+	std::thread preempter([&t]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		t.preempt();
+	});
+	EXPECT_EQ(t.plan().val, moveit::core::MoveItErrorCode::PREEMPTED);
+	preempter.join();
+	for (int i = 0; i < 1000 && planner->canceled == 0; ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	EXPECT_EQ(planner->canceled, 1);
+
+	// reset() cancels a plan started again
+	t.setTimeout(0.05);
+	EXPECT_EQ(t.plan().val, moveit::core::MoveItErrorCode::TIMED_OUT);
+	EXPECT_EQ(connect->numPendingContinuations(), 1u);
+	t.reset();
+	EXPECT_EQ(connect->numPendingContinuations(), 0u);
+	for (int i = 0; i < 1000 && planner->canceled == 1; ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	EXPECT_EQ(planner->canceled, 2);
+}
+
+TEST(PlannerInterface, statisticsOfLaunchedJobs) {
+	auto planner = std::make_shared<AsyncForwardingPlanner>();
+	auto scene = std::make_shared<PlanningScene>(getModel());
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	const moveit::core::JointModelGroup* jmg = scene->getRobotModel()->getJointModelGroup("group");
+	robot_trajectory::RobotTrajectoryPtr result;
+
+	planner->plan(scene, scene, jmg, 1.0, result);
+	// the launched job is nested into the outer call, although it ran on a pooled thread
+	auto stats = planner->statistics();
+	ASSERT_EQ(stats.size(), 1u);
+	EXPECT_EQ(stats.begin()->first.second, "forwarding");
+	EXPECT_EQ(stats.begin()->second.calls, 1u);
+
+	// launched from outside of plan(), the job is a call of its own
+	const moveit::core::LinkModel& tip = *scene->getRobotModel()->getLinkModel("tip");
+	planner->planAsync(scene, tip, Eigen::Isometry3d::Identity(), jmg, 0.1).get();
+	EXPECT_EQ(planner->statistics().size(), 2u);
+}
+
+TEST(CachingPlanner, reuse) {
+	auto planner = std::make_shared<solvers::JointInterpolationPlanner>();
+	solvers::CachingPlanner cache(planner);
+	auto from = std::make_shared<PlanningScene>(getModel());
+	from->getCurrentStateNonConst().setToDefaultValues();
+	auto to = from->diff();
+	const moveit::core::JointModelGroup* jmg = from->getRobotModel()->getJointModelGroup("group");
+	to->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>{ 0.5, -0.5 });
+	robot_trajectory::RobotTrajectoryPtr result;
+
+	ASSERT_TRUE(cache.plan(from, to, jmg, 1.0, result));
+	EXPECT_EQ(cache.misses(), 1u);
+	EXPECT_EQ(cache.size(), 1u);
+
+	// slightly different (within quantization) request hits the cache
+	to->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>{ 0.5001, -0.5 });
+	ASSERT_TRUE(cache.plan(from, to, jmg, 1.0, result));
+	EXPECT_EQ(cache.hits(), 1u);
+	EXPECT_EQ(planner->statistics().begin()->second.calls, 1u);
+	std::vector<double> goal;
+	result->getLastWayPoint().copyJointGroupPositions(jmg, goal);
+	EXPECT_DOUBLE_EQ(goal[0], 0.5001);
+
+	// different scene misses
+	auto other = from->diff();
+	spawnObject(*other, "object", shape_msgs::SolidPrimitive::BOX);
+	ASSERT_TRUE(cache.plan(other, to, jmg, 1.0, result));
+	EXPECT_EQ(cache.misses(), 2u);
+
+	// persistence
+	const std::string file = testing::TempDir() + "plan_cache.bin";
+	ASSERT_TRUE(cache.save(file));
+	solvers::CachingPlanner loaded(planner);
+	ASSERT_TRUE(loaded.load(file));
+	EXPECT_EQ(loaded.size(), 2u);
+	ASSERT_TRUE(loaded.plan(from, to, jmg, 1.0, result));
+	EXPECT_EQ(loaded.hits(), 1u);
+	std::remove(file.c_str());
+
+	// the wrapper defers time parameterization if either it or the wrapped planner does
+	EXPECT_FALSE(cache.defersTimeParameterization());
+	cache.setDeferTimeParameterization(true);
+	EXPECT_TRUE(cache.defersTimeParameterization());
+	cache.setDeferTimeParameterization(false);
+	planner->setDeferTimeParameterization(true);
+	EXPECT_TRUE(cache.defersTimeParameterization());
+}
+
+TEST(ExperiencePlanner, repair) {
+	auto planner = std::make_shared<solvers::JointInterpolationPlanner>();
+	solvers::ExperiencePlanner experience(planner);
+	auto from = std::make_shared<PlanningScene>(getModel());
+	from->getCurrentStateNonConst().setToDefaultValues();
+	const moveit::core::JointModelGroup* jmg = from->getRobotModel()->getJointModelGroup("group");
+	auto to = from->diff();
+	to->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>{ 1.0, -1.0 });
+	robot_trajectory::RobotTrajectoryPtr result;
+
+	ASSERT_TRUE(experience.plan(from, to, jmg, 1.0, result));
+	EXPECT_EQ(experience.size(), 1u);
+	EXPECT_EQ(experience.repairs(), 0u);
+
+	// similar query in reverse direction is answered by repairing the stored path
+	auto start = to->diff();
+	start->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>{ 1.1, -0.9 });
+	ASSERT_TRUE(experience.plan(start, from, jmg, 1.0, result));
+	EXPECT_EQ(experience.repairs(), 1u);
+	EXPECT_EQ(planner->statistics().begin()->second.calls, 1u);
+
+	std::vector<double> positions;
+	result->getFirstWayPoint().copyJointGroupPositions(jmg, positions);
+	EXPECT_DOUBLE_EQ(positions[0], 1.1);
+	result->getLastWayPoint().copyJointGroupPositions(jmg, positions);
+	EXPECT_DOUBLE_EQ(positions[0], 0.0);
+
+	// distant queries are not repaired, but planned
+	auto distant = to->diff();
+	distant->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>{ 3.0, -3.0 });
+	ASSERT_TRUE(experience.plan(distant, from, jmg, 1.0, result));
+	EXPECT_EQ(experience.repairs(), 1u);
+	EXPECT_EQ(planner->statistics().begin()->second.calls, 2u);
+}
+
+namespace {
+// scene of getArmModel() with an obstacle at the tip's position for joint angle pi/2
+PlanningScenePtr sceneWithObstacle() {
+	auto scene = std::make_shared<PlanningScene>(getArmModel());
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+	pose.translation() = Eigen::Vector3d(0.0, 1.0, 0.0);
+	scene->getWorldNonConst()->addToObject("obstacle", std::make_shared<shapes::Box>(0.2, 0.2, 0.2), pose);
+	return scene;
+}
+PlanningScenePtr goalScene(const PlanningSceneConstPtr& from, double angle) {
+	auto to = from->diff();
+	to->getCurrentStateNonConst().setVariablePosition("base-link1-joint", angle);
+	to->getCurrentStateNonConst().update();
+	return to;
+}
+}  // namespace
+
+TEST(JointInterpolationPlanner, collisionAlongPath) {
+	auto from = sceneWithObstacle();
+	const moveit::core::JointModelGroup* jmg = from->getRobotModel()->getJointModelGroup("group");
+	robot_trajectory::RobotTrajectoryPtr result;
+
+	for (unsigned int threads : { 1u, 4u }) {
+		auto planner = std::make_shared<solvers::JointInterpolationPlanner>();
+		planner->setProperty("max_step", 0.05);
+		planner->setProperty("num_threads", threads);
+
+		// the obstacle is passed by the sweep to 2.5 rad, but not by the one to 1.0 rad
+		EXPECT_FALSE(planner->plan(from, goalScene(from, 2.5), jmg, 1.0, result)) << threads << " threads";
+		ASSERT_TRUE(result);
+		// reported trajectory ends at a colliding waypoint
+		EXPECT_TRUE(from->isStateColliding(result->getLastWayPoint(), "group"));
+		EXPECT_LT(result->getLastWayPoint().getVariablePosition("base-link1-joint"), 2.5);
+
+		EXPECT_TRUE(planner->plan(from, goalScene(from, 1.0), jmg, 1.0, result)) << threads << " threads";
+		EXPECT_DOUBLE_EQ(result->getLastWayPoint().getVariablePosition("base-link1-joint"), 1.0);
+	}
+}
+
+TEST(JointInterpolationPlanner, continuousCollisionChecking) {
+	auto from = sceneWithObstacle();
+	const moveit::core::JointModelGroup* jmg = from->getRobotModel()->getJointModelGroup("group");
+	auto to = goalScene(from, 2.5);
+	robot_trajectory::RobotTrajectoryPtr result;
+
+	// a single segment, whose collision-free end points enclose the obstacle
+	auto planner = std::make_shared<solvers::JointInterpolationPlanner>();
+	planner->setProperty("max_step", 10.0);
+	ASSERT_FALSE(from->isStateColliding(to->getCurrentState(), "group"));
+	EXPECT_TRUE(planner->plan(from, to, jmg, 1.0, result));
+
+	planner->setProperty("continuous_collision_checking", true);
+	EXPECT_FALSE(planner->plan(from, to, jmg, 1.0, result));
+}
+
+namespace {
+// scene diff adding the obstacle of sceneWithObstacle()
+moveit_msgs::PlanningScene obstacleDiff() {
+	moveit_msgs::PlanningScene diff;
+	diff.is_diff = true;
+	moveit_msgs::CollisionObject box;
+	box.id = "obstacle";
+	box.header.frame_id = "base";
+	box.operation = moveit_msgs::CollisionObject::ADD;
+	box.primitives.resize(1);
+	box.primitives[0].type = shape_msgs::SolidPrimitive::BOX;
+	box.primitives[0].dimensions = { 0.2, 0.2, 0.2 };
+	box.primitive_poses.resize(1);
+	box.primitive_poses[0].position.y = 1.0;
+	box.primitive_poses[0].orientation.w = 1.0;
+	diff.world.collision_objects.push_back(box);
+	return diff;
+}
+// trajectory of group rotating its first joint from 0 to angle
+robot_trajectory::RobotTrajectoryPtr sweep(const PlanningSceneConstPtr& scene, double angle) {
+	auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(scene->getRobotModel(), "group");
+	moveit::core::RobotState state(scene->getCurrentState());
+	for (double t = 0.0; t <= 1.0 + 1e-9; t += 0.02) {  // NOLINT(clang-analyzer-security.FloatLoopCounter)
+		state.setVariablePosition("base-link1-joint", t * angle);
+		state.update();
+		trajectory->addSuffixWayPoint(state, t);
+	}
+	return trajectory;
+}
+}  // namespace
+
+TEST(Utils, predictCumulativeScene) {
+	auto scene = std::make_shared<PlanningScene>(getArmModel());
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	moveit_msgs::PlanningScene none;
+	none.is_diff = true;
+	none.robot_state.is_diff = true;
+	none.robot_state.joint_state.name = { "base-link1-joint" };
+	none.robot_state.joint_state.position = { 0.5 };
+
+	// joint states don't change the scene, an added object does and persists for all successors
+	EXPECT_FALSE(utils::changesScene(none));
+	EXPECT_EQ(utils::predictScene(scene, none), scene);
+	auto added = utils::predictScene(scene, obstacleDiff());
+	ASSERT_NE(added, scene);
+	EXPECT_EQ(utils::predictScene(added, none), added);
+	EXPECT_TRUE(added->getWorld()->hasObject("obstacle"));
+	EXPECT_FALSE(scene->getWorld()->hasObject("obstacle"));
+
+	// a later sweep passing the obstacle is only valid in the original scene
+	auto trajectory = sweep(scene, 2.5);
+	EXPECT_TRUE(scene->isPathValid(*trajectory, "group"));
+	EXPECT_FALSE(utils::predictScene(added, none)->isPathValid(*trajectory, "group"));
+}
+
+TEST(Utils, predictAttachedScene) {
+	auto scene = std::make_shared<PlanningScene>(getArmModel());
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	spawnObject(*scene, "object", shape_msgs::SolidPrimitive::BOX, { 1.0, 0, 0 });
+
+	// pick: attach the object at the tip, moving it from the world to the robot
+	moveit_msgs::PlanningScene attach;
+	attach.is_diff = true;
+	attach.robot_state.is_diff = true;
+	attach.robot_state.attached_collision_objects.resize(1);
+	attach.robot_state.attached_collision_objects[0].link_name = "tip";
+	attach.robot_state.attached_collision_objects[0].object.id = "object";
+	attach.robot_state.attached_collision_objects[0].object.operation = moveit_msgs::CollisionObject::ADD;
+	ASSERT_TRUE(utils::changesScene(attach));
+	auto attached = utils::predictScene(scene, attach);
+	ASSERT_NE(attached, scene);
+	EXPECT_FALSE(attached->getWorld()->hasObject("object"));
+	EXPECT_TRUE(attached->getCurrentState().hasAttachedBody("object"));
+
+	// lift: only valid with the object attached
+	auto lift = sweep(attached, 1.0);
+	EXPECT_TRUE(attached->isPathValid(*lift, "group"));
+	EXPECT_FALSE(scene->isPathValid(*lift, "group"));
+
+	// place: detaching changes the scene as well
+	moveit_msgs::PlanningScene detach = attach;
+	detach.robot_state.attached_collision_objects[0].object.operation = moveit_msgs::CollisionObject::REMOVE;
+	EXPECT_TRUE(utils::changesScene(detach));
+	EXPECT_FALSE(utils::predictScene(attached, detach)->getCurrentState().hasAttachedBody("object"));
+}
+
+TEST(Task, announceLazilyValidatedSolutions) {
+	for (double angle : { 2.5, 1.0 }) {
+		Task t;
+		t.setRobotModel(getArmModel());
+		t.add(std::make_unique<stages::FixedState>("start", sceneWithObstacle()));
+		auto planner = std::make_shared<solvers::JointInterpolationPlanner>();
+		planner->setProperty("lazy_validation", true);
+		auto move = std::make_unique<stages::MoveTo>("move", planner);
+		move->setGroup("group");
+		move->setGoal(std::map<std::string, double>{ { "base-link1-joint", angle } });
+		t.add(std::move(move));
+
+		std::vector<double> announced;
+		t.addSolutionCallback([&announced](const SolutionBase& s) { announced.push_back(s.cost()); });
+		auto stream = t.solutionStream();
+		// only the path to 1.0 rad is collision-free and announced (once validated)
+		const bool valid = angle < 2.0;
+		EXPECT_EQ(bool(t.plan()), valid) << angle;
+		EXPECT_EQ(announced.size(), valid ? 1u : 0u) << angle;
+		SolutionBaseConstPtr solution;
+		EXPECT_EQ(stream->next(solution, 0.0), valid) << angle;
+	}
+}
+
+TEST(Task, constructMotionPlan) {
+	Task t;
+	t.setRobotModel(getArmModel());
+	auto start = std::make_shared<PlanningScene>(getArmModel());
+	start->getCurrentStateNonConst().setToDefaultValues();
+	t.add(std::make_unique<stages::FixedState>("start", start));
+	auto move = std::make_unique<stages::MoveTo>("move", std::make_shared<solvers::JointInterpolationPlanner>());
+	move->setGroup("group");
+	move->setGoal(std::map<std::string, double>{ { "base-link1-joint", 2.5 } });
+	t.add(std::move(move));
+	ASSERT_TRUE(t.plan());
+	const SolutionBase& solution = *t.solutions().front();
+
+	// the motion is executed by the group actuating its joints
+	plan_execution::ExecutableMotionPlan plan;
+	ASSERT_TRUE(TaskPrivate::constructMotionPlan(solution, start, plan));
+	ASSERT_FALSE(plan.plan_components_.empty());
+	EXPECT_EQ(plan.plan_components_.back().trajectory_->getGroupName(), "group");
+
+	// the path passes an obstacle of the execution scene, which wasn't known to planning
+	plan = plan_execution::ExecutableMotionPlan();
+	EXPECT_FALSE(TaskPrivate::constructMotionPlan(solution, sceneWithObstacle(), plan));
+
+	// failed solutions are refused
+	SubTrajectory failure;
+	failure.markAsFailure("failed");
+	plan = plan_execution::ExecutableMotionPlan();
+	EXPECT_FALSE(TaskPrivate::constructMotionPlan(failure, start, plan));
+}
+
+TEST(WarmStartCache, planners) {
+	WarmStartCache cache;
+	auto planner = std::make_shared<solvers::JointInterpolationPlanner>();
+	solvers::PlannerInterfacePtr wrapper = cache.cachingPlanner(planner);
+	ASSERT_TRUE(std::dynamic_pointer_cast<solvers::CachingPlanner>(wrapper));
+	EXPECT_EQ(cache.cachingPlanner(planner), wrapper);  // shared by all stages using planner
+	EXPECT_EQ(cache.cachingPlanner(wrapper), wrapper);
+	EXPECT_EQ(cache.numPlanners(), 1u);
+
+	// the cache keeps neither wrappers nor planners alive
+	std::weak_ptr<solvers::PlannerInterface> weak = planner;
+	planner.reset();
+	wrapper.reset();
+	EXPECT_TRUE(weak.expired());
+	EXPECT_EQ(cache.numPlanners(), 0u);
+	cache.prune();
+	EXPECT_EQ(cache.numPlanners(), 0u);
+}
+
+TEST(WarmStartCache, stages) {
+	// ComputeIK uses the task-wide IK cache, unless it has its own one
+	WarmStartCache cache;
+	stages::ComputeIK ik("ik", std::make_unique<GeneratorMockup>());
+	EXPECT_TRUE(ik.enableWarmStart(cache));
+	EXPECT_EQ(ik.properties().get<stages::IKCachePtr>("ik_cache"), cache.get<stages::IKCache>("ik_cache"));
+	EXPECT_FALSE(ik.enableWarmStart(cache));
+
+	// MoveTo reuses its trajectory after reset()
+	Task t;
+	t.setRobotModel(getArmModel());
+	t.setWarmStart(true);
+	auto start = std::make_shared<PlanningScene>(getArmModel());
+	start->getCurrentStateNonConst().setToDefaultValues();
+	t.add(std::make_unique<stages::FixedState>("start", start));
+	auto move = std::make_unique<stages::MoveTo>("move", std::make_shared<solvers::JointInterpolationPlanner>());
+	move->setGroup("group");
+	move->setGoal(std::map<std::string, double>{ { "base-link1-joint", 1.0 } });
+	auto* stage = move.get();
+	t.add(std::move(move));
+
+	ASSERT_TRUE(t.plan());
+	auto caching = std::dynamic_pointer_cast<const solvers::CachingPlanner>(stage->planners().front());
+	ASSERT_TRUE(caching);
+	EXPECT_EQ(caching->hits(), 0u);
+	t.reset();
+	ASSERT_TRUE(t.plan());
+	EXPECT_EQ(stage->planners().front(), caching);  // not wrapped again
+	EXPECT_EQ(caching->hits(), 1u);
+}
+
+TEST(MoveTo, compiledGoalSet) {
+	Task t;
+	t.setRobotModel(getArmModel());
+	t.add(std::make_unique<stages::FixedState>("start", std::make_shared<PlanningScene>(getArmModel())));
+	auto move = std::make_unique<stages::MoveTo>("move", std::make_shared<solvers::JointInterpolationPlanner>());
+	move->setGroup("group");
+	// equal goals given by distinct values share their compiled posture
+	using Joints = std::map<std::string, double>;
+	move->setGoals({ Joints{ { "base-link1-joint", 0.5 } }, Joints{ { "base-link1-joint", 1.0 } },
+	                 Joints{ { "base-link1-joint", 0.5 } } });
+	auto* stage = move.get();
+	t.add(std::move(move));
+
+	ASSERT_TRUE(t.plan());
+	std::multiset<double> reached;
+	for (const auto& solution : stage->solutions())
+		reached.insert(solution->end()->scene()->getCurrentState().getVariablePosition("base-link1-joint"));
+	EXPECT_EQ(reached, (std::multiset<double>{ 0.5, 0.5, 1.0 }));
+
+	// goals changed after a plan are recompiled by the next one
+	t.reset();
+	stage->setGoals({ Joints{ { "base-link1-joint", -0.5 } } });
+	ASSERT_TRUE(t.plan());
+	ASSERT_EQ(stage->solutions().size(), 1u);
+	EXPECT_EQ(stage->solutions().front()->end()->scene()->getCurrentState().getVariablePosition("base-link1-joint"),
+	          -0.5);
+}
+
+TEST(PipelinePlanner, sceneFingerprint) {
+	auto scene = std::make_shared<PlanningScene>(getModel());
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	const moveit::core::JointModelGroup* jmg = scene->getRobotModel()->getJointModelGroup("group");
+	const std::string base = solvers::PipelinePlanner::sceneFingerprint(*scene, jmg);
+
+	// joints of the planned group don't matter
+	auto moved = scene->diff();
+	moved->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>{ 0.5, -0.5 });
+	EXPECT_EQ(solvers::PipelinePlanner::sceneFingerprint(*moved, jmg), base);
+
+	// but all other joints
+	auto other = scene->diff();
+	const moveit::core::JointModelGroup* eef = scene->getRobotModel()->getJointModelGroup("eef_group");
+	const std::string& eef_joint = eef->getActiveJointModelNames().front();
+	moveit::core::RobotState& state = other->getCurrentStateNonConst();
+	state.setVariablePosition(eef_joint, state.getVariablePosition(eef_joint) + 0.1);
+	EXPECT_NE(solvers::PipelinePlanner::sceneFingerprint(*other, jmg), base);
+
+	// and the allowed collisions
+	auto allowed = scene->diff();
+	allowed->getAllowedCollisionMatrixNonConst().setEntry("link1", "link2", true);
+	EXPECT_NE(solvers::PipelinePlanner::sceneFingerprint(*allowed, jmg), base);
+}
+
+TEST(PlannerInterface, planAsync) {
+	auto planner = std::make_shared<solvers::JointInterpolationPlanner>();
+	auto from = std::make_shared<PlanningScene>(getModel());
+	from->getCurrentStateNonConst().setToDefaultValues();
+	const moveit::core::JointModelGroup* jmg = from->getRobotModel()->getJointModelGroup("group");
+	auto to = from->diff();
+	to->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>{ 1.0, -1.0 });
+
+	std::vector<solvers::PlannerInterface::AsyncPlan> plans;
+	for (int i = 0; i < 4; ++i)
+		plans.push_back(planner->planAsync(from, to, jmg, 1.0));
+	for (const auto& plan : plans) {
+		ASSERT_TRUE(plan.valid());
+		EXPECT_TRUE(plan.get().success);
+		EXPECT_TRUE(plan.get().trajectory);
+	}
+	EXPECT_EQ(planner->statistics().begin()->second.calls, 4u);
+}
+
+// reports the first state of each batch as colliding
+struct CollidingBackend : public ThreadedCollisionBackend
+{
+	mutable std::vector<size_t> batches;
+	size_t firstColliding(const PlanningScene& /*scene*/, const std::string& /*group*/, const States& states,
+	                      unsigned int /*num_threads*/, const PreemptionToken* /*preempt*/) const override {
+		batches.push_back(states.size());
+		return 0;
+	}
+};
+
+TEST(CollisionBackend, batchesJointInterpolation) {
+	auto planner = std::make_shared<solvers::JointInterpolationPlanner>();
+	auto from = std::make_shared<PlanningScene>(getModel());
+	from->getCurrentStateNonConst().setToDefaultValues();
+	const moveit::core::JointModelGroup* jmg = from->getRobotModel()->getJointModelGroup("group");
+	auto to = from->diff();
+	to->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>{ 1.0, -1.0 });
+
+	robot_trajectory::RobotTrajectoryPtr result;
+	EXPECT_TRUE(planner->plan(from, to, jmg, 1.0, result)) << "default backend: model without collision geometry";
+
+	auto backend = std::make_shared<CollidingBackend>();
+	CollisionBackend::setInstance(backend);
+	EXPECT_FALSE(planner->plan(from, to, jmg, 1.0, result));
+	CollisionBackend::setInstance(nullptr);
+
+	// all waypoints are checked in a single batch, the goal (checked first) collides
+	ASSERT_EQ(backend->batches.size(), 1u);
+	EXPECT_EQ(backend->batches[0] + 1, result->getWayPointCount());
+}
+
+TEST(ThreadedCollisionBackend, checksUpdatedAndDirtyStates) {
+	auto scene = sceneWithObstacle();
+	std::list<moveit::core::RobotState> storage;  // updated states alternating with dirty ones
+	CollisionBackend::States states;
+	for (size_t i = 0; i != 40; ++i) {
+		storage.emplace_back(scene->getCurrentState());
+		storage.back().setVariablePosition("base-link1-joint", i < 30 ? 0.0 : M_PI / 2.0);
+		if (i % 2 == 0)
+			storage.back().update();
+		states.push_back(&storage.back());
+	}
+	ThreadedCollisionBackend backend;
+	for (unsigned int threads : { 1u, 2u })
+		EXPECT_EQ(backend.firstColliding(*scene, "group", states, threads), 30u) << threads << " threads";
+	// input states remain untouched
+	EXPECT_TRUE(std::next(storage.begin())->dirtyCollisionBodyTransforms());
+}
+
+TEST(CollisionCache, sharesResultsPerScene) {
+	CollisionCache cache(1e-3);
+	auto scene = std::make_shared<PlanningScene>(getModel());
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	const moveit::core::RobotState state{ scene->getCurrentState() };
+
+	size_t checks = 0;
+	auto check = [&checks]() { return ++checks > 1; };  // only the first check reports collision-free
+	EXPECT_FALSE(cache.isColliding(scene, state, "group", check));
+	EXPECT_FALSE(cache.isColliding(scene, state, "group", check));
+	EXPECT_EQ(checks, 1u);
+	EXPECT_EQ(cache.hits(), 1u);
+
+	// quantized states match, other groups, states, and scenes don't
+	moveit::core::RobotState nearby{ state };
+	nearby.setVariablePosition(0, nearby.getVariablePosition(0) + 1e-5);
+	EXPECT_FALSE(cache.isColliding(scene, nearby, "group", check));
+	EXPECT_TRUE(cache.isColliding(scene, state, "", check));
+	nearby.setVariablePosition(0, nearby.getVariablePosition(0) + 0.1);
+	EXPECT_TRUE(cache.isColliding(scene, nearby, "group", check));
+	auto diff = scene->diff();
+	EXPECT_TRUE(cache.isColliding(diff, state, "group", check));
+	EXPECT_EQ(checks, 4u);
+
+	cache.storeColliding(diff, nearby, "group", false);
+	EXPECT_FALSE(cache.isColliding(diff, nearby, "group", check));
+	EXPECT_EQ(cache.size(), 2u);
+
+	// results are dropped with their scene
+	diff.reset();
+	scene.reset();
+	auto other = std::make_shared<PlanningScene>(getModel());
+	EXPECT_TRUE(cache.isColliding(other, state, "group", check));
+	EXPECT_EQ(checks, 5u);
+}
+
+TEST(CollisionCache, optIn) {
+	EXPECT_FALSE(CollisionCache::instance());  // disabled by default
+
+	auto cache = std::make_shared<CollisionCache>();
+	CollisionCache::setInstance(cache);
+	auto scene = std::make_shared<PlanningScene>(getModel());
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	cache->storeColliding(scene, scene->getCurrentState(), "group", false);
+	EXPECT_EQ(cache->size(), 1u);
+
+	// results are cleared by Task::reset()
+	Task t;
+	t.reset();
+	EXPECT_EQ(cache->size(), 0u);
+	CollisionCache::setInstance(nullptr);
+}
+
+TEST(Stage, memoryAccounting) {
+	StandaloneGeneratorMockup g{ PredefinedCosts::constant(0.0) };
+	g.init(getModel());
+
+	g.compute();
+	EXPECT_EQ(g.memoryUsage().total(), 0u);  // disabled by default
+
+	Stage::setMemoryAccounting(true);
+	g.compute();
+	g.compute();
+	Stage::setMemoryAccounting(false);
+
+	const MemoryUsage usage = g.memoryUsage();
+	EXPECT_EQ(usage.states, 4 * sizeof(InterfaceState));  // spawn() creates two states per solution
+	EXPECT_GT(usage.scenes, 0u);
+	EXPECT_EQ(usage.trajectories, 0u);
+	EXPECT_EQ(usage.total(), usage.states + usage.scenes + usage.markers);
+
+	g.reset();
+	EXPECT_EQ(g.memoryUsage().total(), 0u);
+}
+
+TEST(ScratchState, recyclesStates) {
+	auto model = getModel();
+	const moveit::core::RobotState* first;
+	{
+		ScratchState state(model);
+		first = &*state;
+	}
+	const size_t idle = ScratchState::pooled();
+	ASSERT_GT(idle, 0u);
+
+	moveit::core::RobotState source(model);
+	source.setToDefaultValues();
+	ScratchState copy(source);
+	EXPECT_EQ(&*copy, first);  // most recently returned state is reused
+	EXPECT_EQ(ScratchState::pooled(), idle - 1);
+	EXPECT_EQ(copy->distance(source), 0.0);
+
+	// states of other robot models are allocated
+	ScratchState other(getModel());
+	EXPECT_EQ(ScratchState::pooled(), idle - 1);
+	EXPECT_NE(other->getRobotModel(), model);
+}
+
+TEST(ScratchState, purgeReleasesModel) {
+	auto model = getModel();
+	std::weak_ptr<const moveit::core::RobotModel> weak = model;
+	{ ScratchState state(model); }
+	model.reset();
+	EXPECT_FALSE(weak.expired());  // kept alive by this thread's pool
+
+	ScratchState::purge(weak.lock().get());
+	EXPECT_TRUE(weak.expired());
+}
+
+TEST(CompressedTrajectory, errorBound) {
+	auto model = getModel();
+	auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(model, "group");
+	const size_t count = 201;
+	for (size_t i = 0; i != count; ++i) {
+		auto state = std::make_shared<moveit::core::RobotState>(model);
+		state->setToDefaultValues();
+		const double t = 0.01 * i;
+		for (size_t v = 0; v != model->getVariableCount(); ++v)
+			state->setVariablePosition(v, v % 2 ? 0.5 * t : std::sin(t + v));
+		state->update();
+		trajectory->addSuffixWayPoint(state, i ? 0.01 : 0.0);
+	}
+
+	const double tolerance = 1e-3;
+	auto compressed = CompressedTrajectory::compress(*trajectory, tolerance);
+	ASSERT_TRUE(compressed);
+	EXPECT_EQ(compressed->waypointCount(), count);
+	EXPECT_LT(compressed->retainedCount(), count / 4);
+
+	auto restored = compressed->decompress();
+	ASSERT_EQ(restored->getWayPointCount(), count);
+	EXPECT_NEAR(restored->getDuration(), trajectory->getDuration(), 1e-6);
+	for (size_t i = 0; i != count; ++i)
+		for (size_t v = 0; v != model->getVariableCount(); ++v)
+			EXPECT_NEAR(restored->getWayPoint(i).getVariablePosition(v),
+			            trajectory->getWayPoint(i).getVariablePosition(v), tolerance);
+	EXPECT_EQ(restored->getLastWayPoint().distance(trajectory->getLastWayPoint()), 0.0);
+
+	SubTrajectory sub(trajectory);
+	ASSERT_TRUE(sub.compress(tolerance));
+	EXPECT_FALSE(sub.compress(tolerance));  // already compressed
+	EXPECT_EQ(sub.trajectory()->getWayPointCount(), count);
+	// the rebuilt trajectory only approximates the planned one
+	Task t;
+	EXPECT_EQ(t.execute(sub).val, moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN);
+
+	moveit_msgs::RobotTrajectory msg;
+	trajectory->getRobotTrajectoryMsg(msg);
+	decimateTrajectory(msg.joint_trajectory, tolerance);
+	EXPECT_LE(msg.joint_trajectory.points.size(), compressed->retainedCount());  // twice the tolerance
+}
+
+// spawn states with given values of the first variable
+struct VariableGenerator : Generator
+{
+	std::list<double> values_;
+	planning_scene::PlanningScenePtr scene_;
+
+	VariableGenerator(std::list<double> values) : Generator("VAR"), values_(std::move(values)) {}
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override {
+		scene_ = std::make_shared<PlanningScene>(robot_model);
+		scene_->getCurrentStateNonConst().setToDefaultValues();
+		Generator::init(robot_model);
+	}
+	bool canCompute() const override { return !values_.empty(); }
+	void compute() override {
+		auto scene = scene_->diff();
+		scene->getCurrentStateNonConst().setVariablePosition(0, values_.front());
+		values_.pop_front();
+		spawn(InterfaceState(scene), 0.0);
+	}
+};
+
+TEST(DiversityFilter, minDistance) {
+	Task t;
+	t.setRobotModel(getModel());
+	auto filter = std::make_unique<stages::DiversityFilter>(
+	    "diverse", std::make_unique<VariableGenerator>(std::list<double>{ 0.0, 0.05, 0.2, 0.22, -0.3, 0.5 }));
+	filter->setMinDistance(0.1);
+	t.add(std::move(filter));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.numSolutions(), 4u);  // 0.05 and 0.22 are rejected
+	EXPECT_EQ(t.stages()->findChild("diverse")->numFailures(), 2u);
+}
+
+TEST(DiversityFilter, wrapsContinuousJoints) {
+	Task t;
+	t.setRobotModel(getModel());  // all joints are continuous
+	auto filter = std::make_unique<stages::DiversityFilter>(
+	    "diverse", std::make_unique<VariableGenerator>(std::list<double>{ 3.1, -3.1, 0.0 }));
+	filter->setMinDistance(0.1);
+	t.add(std::move(filter));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.numSolutions(), 2u);  // -3.1 is only 0.08 away from 3.1
+}
+
+// spawn states with given values of the first variable and given costs, all in a single batch
+struct VariableBatchGenerator : VariableGenerator
+{
+	std::list<double> costs_;
+
+	VariableBatchGenerator(std::list<double> values, std::list<double> costs)
+	  : VariableGenerator(std::move(values)), costs_(std::move(costs)) {}
+	void compute() override {
+		Batch batch;
+		for (; !values_.empty(); values_.pop_front(), costs_.pop_front()) {
+			auto scene = scene_->diff();
+			scene->getCurrentStateNonConst().setVariablePosition(0, values_.front());
+			SubTrajectory trajectory;
+			trajectory.setCost(costs_.front());
+			batch.emplace_back(InterfaceState(scene), std::move(trajectory));
+		}
+		spawnMany(std::move(batch));
+	}
+};
+
+TEST(DiversityFilter, prefersCheapestOfBatch) {
+	Task t;
+	t.setRobotModel(getModel());
+	auto filter = std::make_unique<stages::DiversityFilter>(
+	    "diverse", std::make_unique<VariableBatchGenerator>(std::list<double>{ 0.0, 0.05, 1.0 },
+	                                                        std::list<double>{ 3.0, 1.0, 2.0 }));
+	filter->setMinDistance(0.1);
+	t.add(std::move(filter));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(1.0, 2.0));  // 0.0 is rejected in favour of 0.05
+}
+
+TEST(PoseCandidates, batchOperations) {
+	PoseCandidates candidates("object");
+	for (uint32_t i = 0; i < 5; ++i)
+		candidates.add(Eigen::Isometry3d(Eigen::Translation3d(i, 0, 0)), 5.0 - i, i);
+
+	// remove odd candidates, preserving the order of the others
+	EXPECT_EQ(candidates.retain([&candidates](size_t i) { return candidates.parents()[i] % 2 == 0; }), 2u);
+	EXPECT_EQ(candidates.parents(), std::vector<uint32_t>({ 0, 2, 4 }));
+	EXPECT_EQ(candidates.scores(), std::vector<double>({ 5.0, 3.0, 1.0 }));
+
+	candidates.sortByScore();
+	EXPECT_EQ(candidates.parents(), std::vector<uint32_t>({ 4, 2, 0 }));
+	EXPECT_DOUBLE_EQ(candidates.poses()[0].translation().x(), 4.0);
+
+	candidates.transform(Eigen::Isometry3d(Eigen::Translation3d(0, 1, 0)), "world");
+	EXPECT_EQ(candidates.frame(), "world");
+	EXPECT_DOUBLE_EQ(candidates.poses()[2].translation().y(), 1.0);
+}
+
+TEST(PoseCandidates, graspFilter) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto* ref = new GeneratorMockup(PredefinedCosts::single(0.0));
+	t.add(Stage::pointer(ref));
+	t.add(std::make_unique<ConnectMockup>());
+
+	moveit_msgs::RobotState posture;
+	posture.is_diff = true;
+	const double delta = M_PI / 2.;
+	auto grasp = std::make_unique<stages::GenerateGraspPose>("grasp");
+	grasp->setEndEffector("eef");
+	grasp->setObject("base");
+	grasp->setAngleDelta(delta);
+	grasp->setPreGraspPose(posture);
+	grasp->setGraspPose(posture);
+	grasp->setMonitoredStage(ref);
+
+	// keep samples 0 and 2 only, reversing their order by score
+	size_t num_candidates = 0;
+	grasp->setCandidateFilter([&num_candidates](PoseCandidates& candidates) {
+		num_candidates = candidates.size();
+		const std::vector<uint32_t>& parents = candidates.parents();
+		candidates.retain([&parents](size_t i) { return parents[i] == 0 || parents[i] == 2; });
+		for (size_t i = 0; i != candidates.size(); ++i)
+			candidates.scores()[i] = 10.0 - candidates.parents()[i];
+		candidates.sortByScore();
+	});
+	Stage* stage = grasp.get();
+	t.add(std::move(grasp));
+
+	EXPECT_TRUE(t.plan());
+	ASSERT_GE(num_candidates, 4u);
+	EXPECT_EQ(stage->numFailures(), num_candidates - 2);  // rejected candidates are silent failures
+	ASSERT_EQ(stage->solutions().size(), 2u);
+
+	// comments follow their samples through the parent index
+	auto it = stage->solutions().begin();
+	EXPECT_EQ((*it)->comment(), std::to_string(3 * delta));  // sample 2
+	EXPECT_DOUBLE_EQ((*it)->cost(), 10.0 - 2);
+	EXPECT_EQ((*std::next(it))->comment(), std::to_string(delta));  // sample 0
+	EXPECT_DOUBLE_EQ((*std::next(it))->cost(), 10.0);
+}
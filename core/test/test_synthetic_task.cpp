@@ -0,0 +1,84 @@
+#include "../benchmark/synthetic_task.h"
+
+#include <moveit/task_constructor/container.h>
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+using namespace moveit::task_constructor;
+using namespace moveit::task_constructor::synthetic;
+
+namespace {
+std::vector<double> costs(const Task& task) {
+	std::vector<double> result;
+	for (const auto& solution : task.solutions())
+		result.push_back(solution->cost());
+	return result;
+}
+
+size_t numStages(const Task& task) {
+	size_t count = 0;
+	task.stages()->traverseRecursively([&count](const Stage& /*stage*/, unsigned int /*depth*/) {
+		++count;
+		return true;
+	});
+	return count;
+}
+}  // namespace
+
+TEST(SyntheticTask, serialTree) {
+	TaskConfig config;
+	config.cost_distribution = CostDistribution::CONSTANT;
+	auto task = createTask(config);
+	// root, generator, and a binary tree of 3 serial containers with 4 leaf propagators
+	EXPECT_EQ(numStages(*task), 9u);
+
+	EXPECT_TRUE(task->plan());
+	// each of the 4 chained propagators doubles the generator's 10 states
+	EXPECT_EQ(task->solutions().size(), 160u);
+	for (double cost : costs(*task))
+		EXPECT_DOUBLE_EQ(cost, 5.0);  // generator + 4 propagators
+}
+
+TEST(SyntheticTask, alternativesTree) {
+	TaskConfig config;
+	config.depth = 1;
+	config.branching = 3;
+	config.containers = { ContainerType::ALTERNATIVES };
+	auto task = createTask(config);
+	EXPECT_TRUE(task->plan());
+	EXPECT_EQ(task->solutions().size(), 10u * 3u * 2u);
+}
+
+TEST(SyntheticTask, reproducible) {
+	TaskConfig config;
+	config.failure_probability = 0.3;
+	config.seed = 7;
+	auto first = createTask(config);
+	auto second = createTask(config);
+	first->plan();
+	second->plan();
+	EXPECT_FALSE(first->solutions().empty());
+	EXPECT_EQ(costs(*first), costs(*second));
+
+	config.seed = 8;
+	auto other = createTask(config);
+	other->plan();
+	EXPECT_NE(costs(*first), costs(*other));
+}
+
+TEST(SyntheticTask, failures) {
+	TaskConfig config;
+	config.failure_probability = 1.0;
+	auto task = createTask(config);
+	EXPECT_FALSE(task->plan());
+	EXPECT_TRUE(task->solutions().empty());
+}
+
+TEST(SyntheticTask, parse) {
+	EXPECT_EQ(parseContainerType("fallbacks"), ContainerType::FALLBACKS);
+	EXPECT_EQ(parseCostDistribution("exponential"), CostDistribution::EXPONENTIAL);
+	EXPECT_THROW(parseContainerType("parallel"), std::invalid_argument);
+	EXPECT_THROW(parseCostDistribution("normal"), std::invalid_argument);
+}
@@ -67,6 +67,11 @@ using namespace moveit::task_constructor;
 
 // prepare a demo environment from ROS parameters under pnh
 void setupDemoScene(ros::NodeHandle& pnh);
+// add object to the planning scene, throws on failure
+void spawnObject(moveit::planning_interface::PlanningSceneInterface& psi, const moveit_msgs::CollisionObject& object);
+// table and object as configured by ROS parameters under pnh
+moveit_msgs::CollisionObject createTable(ros::NodeHandle& pnh);
+moveit_msgs::CollisionObject createObject(ros::NodeHandle& pnh);
 
 class PickPlaceTask
 {
@@ -74,12 +79,20 @@ public:
 	PickPlaceTask(const std::string& task_name, const ros::NodeHandle& pnh);
 	~PickPlaceTask() = default;
 
+	/// pick the named object instead of the configured one (before init())
+	void setObject(const std::string& name) { object_name_ = name; }
+	/// place the object at given pose (in object_reference_frame) instead of the configured one (before init())
+	void setPlacePose(const geometry_msgs::Pose& pose) { place_pose_ = pose; }
+
 	bool init();
 
 	bool plan();
 
 	bool execute();
 
+	/// the task created by init()
+	const moveit::task_constructor::TaskPtr& getTask() const { return task_; }
+
 private:
 	void loadParameters();
 
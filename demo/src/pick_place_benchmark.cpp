@@ -0,0 +1,51 @@
+/* Planning benchmark of the pick and place demo
+ *
+ * Plans the demo task for ~repetitions runs with seeds ~seed, ~seed + 1, ...
+ * and writes the results as JSON to ~output (default: stdout).
+ * The task is configured from the same parameters as pick_place_demo, see pickplace_benchmark.launch.
+ */
+
+#include <ros/ros.h>
+
+#include <moveit_task_constructor_demo/pick_place_task.h>
+#include <moveit/task_constructor/task_benchmark.h>
+
+#include <iostream>
+
+constexpr char LOGNAME[] = "moveit_task_constructor_demo";
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "mtc_benchmark");
+	ros::NodeHandle pnh("~");
+
+	ros::AsyncSpinner spinner(1);
+	spinner.start();
+
+	moveit_task_constructor_demo::setupDemoScene(pnh);
+
+	moveit::task_constructor::TaskBenchmark benchmark("pick_place_demo", [&pnh](unsigned int /*seed*/) {
+		moveit_task_constructor_demo::PickPlaceTask pick_place_task("pick_place_task", pnh);
+		if (!pick_place_task.init())
+			throw std::runtime_error("Initialization failed");
+		auto task = pick_place_task.getTask();
+		task->enableIntrospection(false);
+		return task;
+	});
+	benchmark.setRepetitions(pnh.param("repetitions", 10));
+	benchmark.setSeed(pnh.param("seed", 0));
+	benchmark.setMaxSolutions(pnh.param("max_solutions", 10));
+
+	try {
+		benchmark.run();
+	} catch (const std::exception& e) {
+		ROS_ERROR_STREAM_NAMED(LOGNAME, e.what());
+		return 1;
+	}
+
+	const std::string output = pnh.param<std::string>("output", "");
+	if (output.empty())
+		benchmark.writeJson(std::cout);
+	else if (!benchmark.writeJson(output))
+		return 1;
+	return 0;
+}
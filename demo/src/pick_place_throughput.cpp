@@ -0,0 +1,220 @@
+/* Throughput benchmark picking and placing many objects in clutter
+ *
+ * Spawns ~num_objects cylinders at random (seed ~seed) collision-free positions on the table
+ * and plans a pick-place task for each of them, moving the object by ~place_offset [x, y].
+ * All objects are planned against the same initial scene, both sequentially and as a TaskBatch
+ * with ~num_threads threads (0: one per core), as selected by ~mode (sequential, batch, or both).
+ * Objects per minute, latency quantiles, and peak memory are written as JSON to ~output (default: stdout).
+ * The peak memory is measured per plan (each task when sequential, the whole batch otherwise), if the kernel
+ * supports resetting it (peak_rss_per_plan: true). Otherwise, it is the process' overall peak so far.
+ * The task is configured from the same parameters as pick_place_demo, see pickplace_throughput.launch.
+ */
+
+#include <ros/ros.h>
+
+#include <moveit_task_constructor_demo/pick_place_task.h>
+#include <moveit/task_constructor/task_batch.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+constexpr char LOGNAME[] = "moveit_task_constructor_demo";
+
+namespace {
+struct Report
+{
+	std::string mode;
+	size_t objects = 0;
+	size_t succeeded = 0;
+	double wall_time = 0.0;  // [s]
+	std::vector<double> latencies;  // planning time of each object [s]
+	long peak_rss = 0;  // [kB]
+	bool peak_rss_per_plan = true;
+};
+
+// reset the process' peak RSS (VmHWM) to its current RSS
+bool resetPeakRSS() {
+	std::ofstream clear_refs("/proc/self/clear_refs");
+	clear_refs << "5";
+	clear_refs.close();
+	return bool(clear_refs);
+}
+
+// process' peak RSS [kB] since start or last resetPeakRSS()
+long peakRSS() {
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+		if (line.compare(0, 6, "VmHWM:") == 0)
+			return std::strtol(line.c_str() + 6, nullptr, 10);
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return usage.ru_maxrss;  // kB on Linux
+}
+
+double seconds(std::chrono::steady_clock::duration d) {
+	return std::chrono::duration<double>(d).count();
+}
+
+// nearest-rank quantile of sorted values
+double quantile(const std::vector<double>& sorted, double q) {
+	if (sorted.empty())
+		return 0.0;
+	const size_t rank = static_cast<size_t>(std::ceil(q * sorted.size()));
+	return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+// sample collision-free poses of num objects with given radius on the configured table
+std::vector<geometry_msgs::Pose> samplePoses(ros::NodeHandle& pnh, size_t num, double radius, unsigned int seed) {
+	const moveit_msgs::CollisionObject table = moveit_task_constructor_demo::createTable(pnh);
+	const geometry_msgs::Pose& center = table.primitive_poses[0];
+	const double half_length = 0.5 * table.primitives[0].dimensions[0] - radius;
+	const double half_width = 0.5 * table.primitives[0].dimensions[1] - radius;
+	const double min_distance = 2.0 * radius + pnh.param("min_clearance", 0.06);
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> x(center.position.x - half_length, center.position.x + half_length);
+	std::uniform_real_distribution<double> y(center.position.y - half_width, center.position.y + half_width);
+	std::vector<geometry_msgs::Pose> poses;
+	for (size_t attempts = 0; poses.size() < num && attempts < 1000 * num; ++attempts) {
+		geometry_msgs::Pose pose;
+		pose.position.x = x(rng);
+		pose.position.y = y(rng);
+		pose.orientation.w = 1.0;
+		if (std::all_of(poses.begin(), poses.end(), [&pose, min_distance](const geometry_msgs::Pose& other) {
+			    return std::hypot(pose.position.x - other.position.x, pose.position.y - other.position.y) >= min_distance;
+		    }))
+			poses.push_back(pose);
+	}
+	if (poses.size() < num)
+		throw std::runtime_error("Cannot fit " + std::to_string(num) + " objects onto the table");
+	return poses;
+}
+
+std::string objectName(size_t index) {
+	return "object_" + std::to_string(index);
+}
+
+void writeJson(std::ostream& os, const std::vector<Report>& reports) {
+	os << "{\"runs\":[";
+	for (auto report = reports.begin(); report != reports.end(); ++report) {
+		std::vector<double> sorted = report->latencies;
+		std::sort(sorted.begin(), sorted.end());
+		if (report != reports.begin())
+			os << ',';
+		os << "\n {\"mode\":\"" << report->mode << "\",\"objects\":" << report->objects
+		   << ",\"succeeded\":" << report->succeeded << ",\"wall_time\":" << report->wall_time
+		   << ",\"objects_per_minute\":" << (report->wall_time > 0 ? 60.0 * report->objects / report->wall_time : 0.0)
+		   << ",\"latency_p50\":" << quantile(sorted, 0.5) << ",\"latency_p90\":" << quantile(sorted, 0.9)
+		   << ",\"latency_p99\":" << quantile(sorted, 0.99) << ",\"latency_max\":" << quantile(sorted, 1.0)
+		   << ",\"peak_rss_kb\":" << report->peak_rss
+		   << ",\"peak_rss_per_plan\":" << (report->peak_rss_per_plan ? "true" : "false") << '}';
+	}
+	os << "]}\n";
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "mtc_throughput");
+	ros::NodeHandle pnh("~");
+
+	ros::AsyncSpinner spinner(1);
+	spinner.start();
+
+	const size_t num_objects = pnh.param("num_objects", 10);
+	const std::string mode = pnh.param<std::string>("mode", "both");
+	const size_t max_solutions = pnh.param("max_solutions", 1);
+	std::vector<double> place_offset = pnh.param("place_offset", std::vector<double>{ 0.0, 0.0 });
+	place_offset.resize(2, 0.0);
+
+	// cluttered scene: table and num_objects cylinders of the configured dimensions
+	std::vector<geometry_msgs::Pose> poses;
+	try {
+		ros::Duration(1.0).sleep();  // Wait for ApplyPlanningScene service
+		moveit::planning_interface::PlanningSceneInterface psi;
+		moveit_task_constructor_demo::spawnObject(psi, moveit_task_constructor_demo::createTable(pnh));
+		moveit_msgs::CollisionObject object = moveit_task_constructor_demo::createObject(pnh);
+		const double z = object.primitive_poses[0].position.z;
+		poses = samplePoses(pnh, num_objects, object.primitives[0].dimensions[1], pnh.param("seed", 0));
+		for (size_t i = 0; i < poses.size(); ++i) {
+			object.id = objectName(i);
+			object.primitive_poses[0] = poses[i];
+			object.primitive_poses[0].position.z = z;
+			moveit_task_constructor_demo::spawnObject(psi, object);
+		}
+	} catch (const std::exception& e) {
+		ROS_ERROR_STREAM_NAMED(LOGNAME, e.what());
+		return 1;
+	}
+
+	// create (but don't plan) the task for object i
+	auto create = [&](size_t i) {
+		moveit_task_constructor_demo::PickPlaceTask pick_place_task("pick_place_" + objectName(i), pnh);
+		geometry_msgs::Pose place = poses[i];
+		place.position.x += place_offset[0];
+		place.position.y += place_offset[1];
+		pick_place_task.setObject(objectName(i));
+		pick_place_task.setPlacePose(place);
+		if (!pick_place_task.init())
+			throw std::runtime_error("Initialization failed");
+		auto task = pick_place_task.getTask();
+		task->enableIntrospection(false);
+		return task;
+	};
+
+	std::vector<Report> reports;
+	try {
+		if (mode == "sequential" || mode == "both") {
+			Report report{ "sequential", num_objects };
+			for (size_t i = 0; i < num_objects; ++i) {
+				auto task = create(i);
+				report.peak_rss_per_plan &= resetPeakRSS();
+				const auto start = std::chrono::steady_clock::now();
+				report.succeeded += bool(task->plan(max_solutions));
+				report.latencies.push_back(seconds(std::chrono::steady_clock::now() - start));
+				report.wall_time += report.latencies.back();
+				report.peak_rss = std::max(report.peak_rss, peakRSS());
+			}
+			reports.push_back(report);
+		}
+		if (mode == "batch" || mode == "both") {
+			Report report{ "batch", num_objects };
+			moveit::task_constructor::TaskBatch batch(pnh.param("num_threads", 0));
+			batch.create(num_objects, create);
+			report.peak_rss_per_plan = resetPeakRSS();
+			const auto start = std::chrono::steady_clock::now();
+			for (const auto& result : batch.plan(max_solutions)) {
+				report.succeeded += bool(result.error_code);
+				report.latencies.push_back(result.planning_time);
+			}
+			report.wall_time = seconds(std::chrono::steady_clock::now() - start);
+			report.peak_rss = peakRSS();
+			reports.push_back(report);
+		}
+	} catch (const std::exception& e) {
+		ROS_ERROR_STREAM_NAMED(LOGNAME, e.what());
+		return 1;
+	}
+	if (reports.empty()) {
+		ROS_ERROR_STREAM_NAMED(LOGNAME, "Unknown mode '" << mode << "': use sequential, batch, or both");
+		return 1;
+	}
+
+	const std::string output = pnh.param<std::string>("output", "");
+	if (output.empty()) {
+		writeJson(std::cout, reports);
+		return 0;
+	}
+	std::ofstream file(output);
+	writeJson(file, reports);
+	return file ? 0 : 1;
+}
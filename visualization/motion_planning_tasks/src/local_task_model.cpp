@@ -38,6 +38,7 @@
 #include "factory_model.h"
 #include "properties/property_factory.h"
 #include <rviz/properties/property_tree_model.h>
+#include <rviz/properties/property.h>
 
 #include <ros/console.h>
 
@@ -82,6 +83,98 @@ LocalTaskModel::LocalTaskModel(ContainerBase::pointer&& container, const plannin
   : BaseTaskModel(scene, display_context, parent), Task("", true, std::move(container)) {
 	root_ = this;
 	flags_ |= LOCAL_MODEL;
+
+	// the planning thread only signals new snapshots, coalescing updates until the Qt thread processed them
+	addTaskCallback([this](const Task& /*task*/) {
+		if (!update_pending_.exchange(true))
+			Q_EMIT snapshotsChanged();
+	});
+	connect(this, &LocalTaskModel::snapshotsChanged, this, &LocalTaskModel::updateSnapshots, Qt::QueuedConnection);
+	connect(this, &LocalTaskModel::planningFinished, this, &LocalTaskModel::onPlanningFinished, Qt::QueuedConnection);
+}
+
+LocalTaskModel::~LocalTaskModel() {
+	if (planner_.joinable()) {
+		preempt();
+		planner_.join();
+	}
+}
+
+bool LocalTaskModel::startPlanning(size_t max_solutions) {
+	if (flags_ & IS_RUNNING)
+		return false;
+	if (planner_.joinable())  // finished, but not yet processed by onPlanningFinished()
+		planner_.join();
+
+	if (!getRobotModel() && scene_)
+		setRobotModel(scene_->getRobotModel());
+	try {  // initialize in the Qt thread, reporting configuration errors immediately
+		init();
+	} catch (const InitStageException& e) {
+		ROS_ERROR_STREAM_NAMED("LocalTaskModel", "Task initialization failed:\n" << e);
+		return false;
+	}
+	flags_ |= IS_INITIALIZED;
+	setRunning(true);
+	updateSnapshots();
+
+	planner_ = std::thread([this, max_solutions]() {
+		bool success = false;
+		try {
+			success = bool(plan(max_solutions));
+		} catch (const std::exception& e) {
+			ROS_ERROR_STREAM_NAMED("LocalTaskModel", "Planning failed: " << e.what());
+		}
+		Q_EMIT planningFinished(success);
+	});
+	return true;
+}
+
+void LocalTaskModel::cancelPlanning() {
+	if (flags_ & IS_RUNNING)
+		preempt();
+}
+
+void LocalTaskModel::onPlanningFinished(bool /*success*/) {
+	if (planner_.joinable())
+		planner_.join();
+	setRunning(false);
+	updateSnapshots();
+}
+
+void LocalTaskModel::setRunning(bool running) {
+	if (running) {
+		flags_ |= IS_RUNNING;
+		for (const auto& entry : properties_)
+			lockProperties(entry.second->getRoot());
+	} else {
+		flags_ &= ~IS_RUNNING;
+		for (rviz::Property* property : locked_properties_)
+			property->setReadOnly(false);
+		locked_properties_.clear();
+	}
+}
+
+void LocalTaskModel::lockProperties(rviz::Property* root) {
+	if (!root->getReadOnly()) {
+		root->setReadOnly(true);
+		locked_properties_.push_back(root);
+	}
+	for (int i = 0, end = root->numChildren(); i != end; ++i)
+		lockProperties(root->childAt(i));
+}
+
+void LocalTaskModel::updateSnapshots() {
+	update_pending_ = false;
+	// notify about (potentially) changed solution counts of all stages
+	std::function<void(const QModelIndex&)> notify = [this, &notify](const QModelIndex& parent) {
+		const int rows = rowCount(parent);
+		if (rows > 0)
+			Q_EMIT dataChanged(index(0, 1, parent), index(rows - 1, 2, parent));
+		for (int row = 0; row < rows; ++row)
+			notify(index(row, 0, parent));
+	};
+	notify(QModelIndex());
 }
 
 int LocalTaskModel::rowCount(const QModelIndex& parent) const {
@@ -151,9 +244,14 @@ QVariant LocalTaskModel::data(const QModelIndex& index, int role) const {
 				case 0:
 					return QString::fromStdString(n->name());
 				case 1:
-					return (uint)n->solutions().size();
 				case 2:
-					return 0;
+					if (flags_ & IS_RUNNING) {  // the planning thread modifies solutions: use snapshots
+						const StageSnapshotConstPtr snapshot = n->snapshot();
+						if (!snapshot)
+							return 0u;
+						return index.column() == 1 ? (uint)snapshot->solutions().size() : (uint)snapshot->num_failures;
+					}
+					return index.column() == 1 ? (uint)n->solutions().size() : (uint)n->failures().size();
 			}
 			break;
 	}
@@ -162,7 +260,7 @@ QVariant LocalTaskModel::data(const QModelIndex& index, int role) const {
 
 bool LocalTaskModel::setData(const QModelIndex& index, const QVariant& value, int role) {
 	Node* n = node(index);
-	if (!n || index.column() != 0 || role != Qt::EditRole)
+	if (!n || index.column() != 0 || role != Qt::EditRole || (flags_ & IS_RUNNING))
 		return false;
 
 	// change name
@@ -244,6 +342,8 @@ rviz::PropertyTreeModel* LocalTaskModel::getPropertyModel(const QModelIndex& ind
 		it_inserted.first->second =
 		    PropertyFactory::instance().createPropertyTreeModel(*n, scene_.get(), display_context_);
 		it_inserted.first->second->setParent(this);
+		if (flags_ & IS_RUNNING)  // the planning thread reads the properties
+			lockProperties(it_inserted.first->second->getRoot());
 	}
 	return it_inserted.first->second;
 }
@@ -39,6 +39,13 @@
 #include "task_list_model.h"
 #include <moveit/task_constructor/task.h>
 
+#include <atomic>
+#include <thread>
+
+namespace rviz {
+class Property;
+}  // namespace rviz
+
 namespace moveit_rviz_plugin {
 
 class LocalTaskModel : public BaseTaskModel, public moveit::task_constructor::Task
@@ -49,12 +56,42 @@ class LocalTaskModel : public BaseTaskModel, public moveit::task_constructor::Ta
 	StageFactoryPtr stage_factory_;
 	std::map<Node*, rviz::PropertyTreeModel*> properties_;
 
+	std::thread planner_;  // background planning thread
+	std::atomic<bool> update_pending_{ false };  // a snapshot update is queued for the Qt thread
+	std::vector<rviz::Property*> locked_properties_;  // properties made read-only while running
+
 	inline Node* node(const QModelIndex& index) const;
 	QModelIndex index(Node* n) const;
+	/// set or clear IS_RUNNING, (un)locking all editable properties
+	void setRunning(bool running);
+	/// make all editable properties of the tree read-only, remembering them in locked_properties_
+	void lockProperties(rviz::Property* root);
+
+private Q_SLOTS:
+	/// update solution counts of all stages from their current snapshots
+	void updateSnapshots();
+	void onPlanningFinished(bool success);
+
+Q_SIGNALS:
+	/// emitted (from the planning thread) after each planning step
+	void snapshotsChanged();
+	/// emitted when background planning finished, was cancelled, or failed
+	void planningFinished(bool success);
 
 public:
 	LocalTaskModel(ContainerBase::pointer&& container, const planning_scene::PlanningSceneConstPtr& scene,
 	               rviz::DisplayContext* display_context, QObject* parent = nullptr);
+	~LocalTaskModel() override;
+
+	/** plan (up to max_solutions solutions) in a background thread, keeping the UI responsive
+	 *
+	 * While planning, the task (including stage properties) cannot be modified
+	 * and views are updated from stage snapshots after each step.
+	 * Returns false if the task is already running or fails to initialize.
+	 */
+	bool startPlanning(size_t max_solutions = 0);
+	/// cancel background planning, which stops after the running computations
+	void cancelPlanning();
 	int rowCount(const QModelIndex& parent = QModelIndex()) const override;
 
 	QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
@@ -140,8 +140,13 @@ public:
 
 	void addBuiltInClass(const QString& package, const QString& name, const QString& description,
 	                     const std::function<Type*()>& factory_function) {
+		addBuiltInClass(package + "/" + name, package, name, description, factory_function);
+	}
+	/// add a built-in class with an explicit class id, e.g. shadowing a plugin class declared by another package
+	void addBuiltInClass(const QString& class_id, const QString& package, const QString& name,
+	                     const QString& description, const std::function<Type*()>& factory_function) {
 		BuiltInClassRecord record;
-		record.class_id_ = package + "/" + name;
+		record.class_id_ = class_id;
 		record.package_ = package;
 		record.name_ = name;
 		record.description_ = description;
@@ -153,6 +158,19 @@ public:
 		addBuiltInClass("Built Ins", name, description, [] { return new Derived(); });
 	}
 
+	/// load the libraries of all declared (non built-in) plugin classes upfront
+	void preload() {
+		for (const auto& id : class_loader_->getDeclaredClasses()) {
+			if (built_ins_.contains(QString::fromStdString(id)))
+				continue;
+			try {
+				class_loader_->loadLibraryForClass(id);
+			} catch (pluginlib::PluginlibException& ex) {
+				ROS_WARN("PluginlibFactory: Failed to preload plugin for class '%s'. Error: %s", id.c_str(), ex.what());
+			}
+		}
+	}
+
 	/** @brief Instantiate and return a instance of a subclass of Type using our
 	 *         pluginlib::ClassLoader.
 	 * @param class_id A string identifying the class uniquely among
@@ -35,19 +35,29 @@
 /* Author: Robert Haschke */
 
 #include <stdio.h>
+#include <algorithm>
+#include <set>
 
 #include "remote_task_model.h"
 #include "properties/property_factory.h"
 #include <moveit/task_constructor/container.h>
 #include <moveit/task_constructor/properties.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit_task_constructor_msgs/GetSolution.h>
+#include <moveit_task_constructor_msgs/GetSolutions.h>
+#include <moveit_msgs/Constraints.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/TwistStamped.h>
+#include <geometry_msgs/Vector3Stamped.h>
 #include <rviz/properties/property_tree_model.h>
 #include <rviz/properties/string_property.h>
 #include <ros/console.h>
 
 #include <QApplication>
 #include <QPalette>
+#include <QTimer>
 #include <qglobal.h>
 
 using namespace moveit::task_constructor;
@@ -61,6 +71,109 @@ enum NodeFlag
 };
 using NodeFlags = QFlags<NodeFlag>;
 
+namespace {
+// binary values larger than this are only decoded when their rviz::Property gets expanded
+const size_t LAZY_DECODE_SIZE = 64;
+// TaskStatistics are coalesced to update models at most at display frame rate
+const int STATISTICS_UPDATE_INTERVAL = 33;  // ms
+
+/// read-only rviz::Property holding a binary-encoded value, which is only decoded on demand
+class LazyProperty : public rviz::Property
+{
+	std::string type_;
+	std::vector<uint8_t> data_;
+	bool decoded_ = false;
+
+public:
+	LazyProperty(const moveit_task_constructor_msgs::Property& prop) {
+		setReadOnly(true);
+		update(prop);
+	}
+
+	void update(const moveit_task_constructor_msgs::Property& prop) {
+		setName(QString::fromStdString(prop.name));
+		setDescription(QString::fromStdString(prop.description));
+		if (prop.type == type_ && prop.data == data_)
+			return;  // keep decoded value
+
+		type_ = prop.type;
+		data_ = prop.data;
+		decoded_ = false;
+		removeChildren();
+		setValue(QString("<%1 bytes>").arg(data_.size()));
+	}
+
+	bool decoded() const { return decoded_; }
+	void decode() {
+		decoded_ = true;
+		boost::any value = moveit::task_constructor::Property::deserializeBinary(type_, data_);
+		if (value.empty()) {
+			setValue(QString("<unknown type %1>").arg(QString::fromStdString(type_)));
+			return;
+		}
+		setValue(QVariant());
+		const std::string text = moveit::task_constructor::Property::serialize(value);
+		rviz::Property* result =
+		    PropertyFactory::createDefault(getNameStd(), type_, getDescription().toStdString(), text, this);
+		if (result != this) {  // a scalar value cannot reuse this
+			setValue(result->getValue());
+			delete result;
+		}
+	}
+};
+
+/// PropertyTreeModel decoding LazyProperty items when they get expanded
+class LazyPropertyTreeModel : public rviz::PropertyTreeModel
+{
+	static LazyProperty* pending(rviz::Property* p) {
+		LazyProperty* lazy = dynamic_cast<LazyProperty*>(p);
+		return lazy && !lazy->decoded() ? lazy : nullptr;
+	}
+
+public:
+	using rviz::PropertyTreeModel::PropertyTreeModel;
+
+	bool hasChildren(const QModelIndex& parent) const override {
+		return pending(getProp(parent)) || rviz::PropertyTreeModel::hasChildren(parent);
+	}
+	bool canFetchMore(const QModelIndex& parent) const override { return pending(getProp(parent)); }
+	void fetchMore(const QModelIndex& parent) override {
+		if (LazyProperty* lazy = pending(getProp(parent)))
+			lazy->decode();
+	}
+};
+
+// register (binary) serializers of message types commonly used as properties
+const bool COMMON_TYPES_REGISTERED = (PropertySerializer<moveit_msgs::Constraints>(),
+                                      PropertySerializer<geometry_msgs::PoseStamped>(),
+                                      PropertySerializer<geometry_msgs::TwistStamped>(),
+                                      PropertySerializer<geometry_msgs::Vector3Stamped>(), true);
+
+QString frontierToolTip(const char* name, const std::vector<moveit_task_constructor_msgs::InterfaceMetrics>& metrics) {
+	if (metrics.empty())
+		return QString();
+	const auto& m = metrics.front();
+	return QString("%1: %2 states (%3 enabled, %4 pruned), %5 pending, max depth %6\n"
+	               "   %7 of %8 expanded, %9/s, age %10 s (max %11 s)\n")
+	    .arg(name)
+	    .arg(m.states)
+	    .arg(m.enabled)
+	    .arg(m.pruned)
+	    .arg(m.pending)
+	    .arg(m.max_depth)
+	    .arg(m.expanded)
+	    .arg(m.added)
+	    .arg(m.expansion_rate, 0, 'f', 1)
+	    .arg(m.mean_age, 0, 'f', 3)
+	    .arg(m.max_age, 0, 'f', 3);
+}
+
+// summarize the search frontier of a stage's interfaces
+QString frontierToolTip(const moveit_task_constructor_msgs::StageStatistics& s) {
+	return (frontierToolTip("starts", s.starts) + frontierToolTip("ends", s.ends)).trimmed();
+}
+}  // namespace
+
 struct RemoteTaskModel::Node
 {
 	Node* parent_;
@@ -71,10 +184,11 @@ struct RemoteTaskModel::Node
 	std::unique_ptr<RemoteSolutionModel> solutions_;
 	std::unique_ptr<rviz::PropertyTreeModel> property_tree_;
 	std::map<std::string, Property> properties_;
+	QString frontier_;  // tooltip summarizing the search frontier (if published)
 
 	inline Node(Node* parent) : parent_(parent) {
 		solutions_.reset(new RemoteSolutionModel());
-		property_tree_.reset(new rviz::PropertyTreeModel(new rviz::Property()));
+		property_tree_.reset(new LazyPropertyTreeModel(new rviz::Property()));
 	}
 
 	bool setName(const QString& name) {
@@ -126,8 +240,18 @@ rviz::Property* RemoteTaskModel::Node::createProperty(const moveit_task_construc
                                                       const planning_scene::PlanningSceneConstPtr& scene_,
                                                       rviz::DisplayContext* display_context_) {
 	auto& factory = PropertyFactory::instance();
+	const bool binary = prop.encoding == moveit_task_constructor_msgs::Property::BINARY;
+	if (binary && prop.data.size() > LAZY_DECODE_SIZE) {  // postpone decoding of large binary values
+		if (LazyProperty* lazy = dynamic_cast<LazyProperty*>(old)) {
+			lazy->update(prop);
+			return lazy;
+		}
+		return new LazyProperty(prop);
+	}
+
 	// try to deserialize from msg (using registered functions)
-	boost::any value = Property::deserialize(prop.type, prop.value);
+	boost::any value =
+	    binary ? Property::deserializeBinary(prop.type, prop.data) : Property::deserialize(prop.type, prop.value);
 	if (!value.empty()) {  // if successful, create rviz::Property from mtc::Property using factory methods
 		auto it = properties_.insert(std::make_pair(prop.name, Property())).first;
 		it->second.setDescription(prop.description);
@@ -140,7 +264,8 @@ rviz::Property* RemoteTaskModel::Node::createProperty(const moveit_task_construc
 	}
 
 	// otherwise create default, read-only rviz::Property by parsing serialized YAML
-	return factory.createDefault(prop.name, prop.type, prop.description, prop.value, old);
+	return factory.createDefault(prop.name, prop.type, prop.description,
+	                             binary ? Property::serialize(value) : prop.value, old);
 }
 
 // return Node* corresponding to index
@@ -181,12 +306,14 @@ QModelIndex RemoteTaskModel::index(const Node* n) const {
 }
 
 RemoteTaskModel::RemoteTaskModel(ros::NodeHandle& nh, const std::string& service_name,
+                                 const std::string& batch_service_name,
                                  const planning_scene::PlanningSceneConstPtr& scene,
                                  rviz::DisplayContext* display_context, QObject* parent)
   : BaseTaskModel(scene, display_context, parent), root_(new Node(nullptr)) {
 	id_to_stage_[0] = root_;  // root node has ID 0
-	// service to request solutions
+	// services to request solutions
 	get_solution_client_ = nh.serviceClient<moveit_task_constructor_msgs::GetSolution>(service_name);
+	get_solutions_client_ = nh.serviceClient<moveit_task_constructor_msgs::GetSolutions>(batch_service_name);
 }
 
 RemoteTaskModel::~RemoteTaskModel() {
@@ -257,6 +384,10 @@ QVariant RemoteTaskModel::data(const QModelIndex& index, int role) const {
 			if (index.column() == 0 && index.parent().isValid())
 				return flowIcon(n->interface_flags_);
 			break;
+		case Qt::ToolTipRole:
+			if (index.column() == 0 && !n->frontier_.isEmpty())
+				return n->frontier_;
+			break;
 	}
 
 	return BaseTaskModel::data(index, role);
@@ -311,7 +442,8 @@ void RemoteTaskModel::processStageDescriptions(const moveit_task_constructor_msg
 		if (!(n->node_flags_ & NAME_CHANGED))  // avoid overwriting a manually changed name
 			changed |= n->setName(QString::fromStdString(s.name));
 
-		n->setProperties(s.properties, scene_, display_context_);
+		if (!s.properties_omitted)  // skeleton descriptions are followed by the properties
+			n->setProperties(s.properties, scene_, display_context_);
 
 		InterfaceFlags old_flags = n->interface_flags_;
 		n->interface_flags_ = InterfaceFlags();
@@ -336,18 +468,53 @@ void RemoteTaskModel::processStageDescriptions(const moveit_task_constructor_msg
 	}
 }
 
-void RemoteTaskModel::processStageStatistics(const moveit_task_constructor_msgs::TaskStatistics::_stages_type& msg) {
-	// iterate over statistics and update node's solutions where needed
-	for (const auto& s : msg) {
-		// find node for stage s, this should always exist
-		auto it = id_to_stage_.find(s.id);
-		if (it == id_to_stage_.end()) {
-			ROS_ERROR_NAMED("TaskListModel", "No stage %d", s.id);
-			continue;
+void RemoteTaskModel::processStageStatistics(const moveit_task_constructor_msgs::TaskStatistics& msg) {
+	// a delta can only be applied if we didn't miss a message since the last keyframe
+	if (msg.delta && (!statistics_valid_ || msg.seq != statistics_seq_ + 1)) {
+		statistics_valid_ = false;  // wait for next keyframe
+		statistics_seq_ = msg.seq;
+		return;
+	}
+	statistics_valid_ = true;
+	statistics_seq_ = msg.seq;
+
+	// keyframes (of non-delta mode) supersede each other
+	if (!msg.delta && std::none_of(pending_statistics_.begin(), pending_statistics_.end(),
+	                               [](const moveit_task_constructor_msgs::TaskStatistics& m) { return m.delta; }))
+		pending_statistics_.clear();
+
+	if (pending_statistics_.empty())
+		QTimer::singleShot(STATISTICS_UPDATE_INTERVAL, this, [this]() { flushStageStatistics(); });
+	pending_statistics_.push_back(msg);
+}
+
+void RemoteTaskModel::flushStageStatistics() {
+	std::set<Node*> touched, changed;
+	for (const auto& msg : pending_statistics_) {
+		// iterate over statistics and update node's solutions where needed
+		for (const auto& s : msg.stages) {
+			// find node for stage s, this should always exist
+			auto it = id_to_stage_.find(s.id);
+			if (it == id_to_stage_.end()) {
+				ROS_ERROR_NAMED("TaskListModel", "No stage %d", s.id);
+				continue;
+			}
+			Node* n = it->second;
+			if (touched.insert(n).second)
+				n->solutions_->holdRowUpdates(true);
+			if (!s.starts.empty() || !s.ends.empty())
+				n->frontier_ = frontierToolTip(s);
+			if (msg.delta ? n->solutions_->processSolutionIDsDelta(s) :
+			                n->solutions_->processSolutionIDs(s.solved, s.failed, s.num_failed, s.total_compute_time))
+				changed.insert(n);
 		}
-		Node* n = it->second;
-		n->solutions_->processSolutionIDs(s.solved, s.failed, s.num_failed, s.total_compute_time);
+	}
+	pending_statistics_.clear();
+
+	for (Node* n : touched)
+		n->solutions_->holdRowUpdates(false);
 
+	for (Node* n : changed) {
 		// emit notify about model changes when node was already visited
 		if (n->node_flags_ & WAS_VISITED) {
 			QModelIndex idx = index(n);
@@ -364,33 +531,46 @@ void RemoteTaskModel::setSolutionData(const moveit_task_constructor_msgs::Soluti
 }
 
 DisplaySolutionPtr RemoteTaskModel::processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg) {
-	DisplaySolutionPtr s(new DisplaySolution);
-	s->setFromMessage(scene_->diff(), msg);
-
 	// store sub solution data in model
 	for (const auto& sub : msg.sub_solution)
 		setSolutionData(sub.info);
 	for (const auto& sub : msg.sub_trajectory)
 		setSolutionData(sub.info);
+	if (msg.summary)
+		return DisplaySolutionPtr();  // full solution is fetched on demand
+
+	DisplaySolutionPtr s(new DisplaySolution);
+	if (msg.start_scene_id.empty() || !msg.start_scene.robot_model_name.empty()) {  // msg carries start scene
+		planning_scene::PlanningScenePtr start_scene = scene_->diff();
+		s->setFromMessage(start_scene, msg);
+		if (!msg.start_scene_id.empty())
+			start_scenes_[msg.start_scene_id] = start_scene;
+	} else {  // msg refers to a previously sent start scene
+		auto it = start_scenes_.find(msg.start_scene_id);
+		if (it == start_scenes_.end()) {
+			ROS_WARN_NAMED("TaskListModel", "Solution refers to unknown start scene %s", msg.start_scene_id.c_str());
+			return DisplaySolutionPtr();
+		}
+		s->setFromMessage(it->second, msg.sub_trajectory);
+	}
 
 	// caching is only enabled for top-level solutions (stage_id == 1)
 	// otherwise we would store PlanningScenes over and over
 	if (!msg.sub_solution.empty() && msg.sub_solution.front().info.stage_id == 1 &&
 	    msg.sub_solution.front().info.id != 0) {
-		// cache solution for future use
-		id_to_solution_[msg.sub_solution.front().info.id] = s;
-
 		// cache DisplaySolutions for all individual sub trajectories
 		uint i = 0;
 		for (const auto& t : msg.sub_trajectory) {
 			if (t.info.id == 0)
 				continue;  // invalid id
-			DisplaySolutionPtr& sub =
-			    id_to_solution_.insert(std::make_pair(t.info.id, DisplaySolutionPtr())).first->second;
-			if (!sub)
-				sub.reset(new DisplaySolution(*s, i));
+			DisplaySolutionPtr sub;
+			if (!id_to_solution_.get(t.info.id, sub) || !sub)
+				id_to_solution_.insert(t.info.id, std::make_shared<DisplaySolution>(*s, i));
 			i++;
 		}
+
+		// cache solution for future use, inserted last to be most recently used
+		id_to_solution_.insert(msg.sub_solution.front().info.id, s);
 	}
 
 	return s;
@@ -412,27 +592,53 @@ DisplaySolutionPtr RemoteTaskModel::getSolution(const QModelIndex& index) {
 	Q_ASSERT(index.isValid());
 
 	uint32_t id = index.sibling(index.row(), 0).data(Qt::UserRole).toUInt();
-	auto it = id_to_solution_.find(id);
-	if (it == id_to_solution_.cend()) {
+	DisplaySolutionPtr result;
+	if (!id_to_solution_.get(id, result)) {
 		// TODO: try to assemble (and cache) the solution from known leaves
 		// to avoid some communication overhead
 
-		DisplaySolutionPtr result;
+		if (!(flags_ & IS_DESTROYED) && get_solutions_client_ && fetchSolutions(index)) {
+			if (id_to_solution_.get(id, result))
+				return result;
+		}
 		if (!(flags_ & IS_DESTROYED)) {
 			// request solution via service
 			moveit_task_constructor_msgs::GetSolution srv;
 			srv.request.solution_id = id;
 			if (get_solution_client_.call(srv)) {
-				id_to_solution_[id] = result = processSolutionMessage(srv.response.solution);
+				result = processSolutionMessage(srv.response.solution);
+				id_to_solution_.insert(id, result);
 				return result;
 			}
 			// on failure mark remote task as destroyed: don't retrieve more solutions
 			get_solution_client_.shutdown();
 			flags_ |= IS_DESTROYED;
 		}
-		return result;
 	}
-	return it->second;
+	return result;
+}
+
+bool RemoteTaskModel::fetchSolutions(const QModelIndex& index) {
+	// number of solutions fetched around index, anticipating that the user scrolls through the list
+	static const int PREFETCH = 20;
+
+	moveit_task_constructor_msgs::GetSolutions srv;
+	const QAbstractItemModel* m = index.model();
+	for (int row = std::max(0, index.row() - PREFETCH / 2), end = std::min(m->rowCount(), row + PREFETCH);
+	     row < end; ++row) {
+		uint32_t id = m->index(row, 0).data(Qt::UserRole).toUInt();
+		if (id != 0 && !id_to_solution_.contains(id))
+			srv.request.solution_ids.push_back(id);
+	}
+
+	if (!get_solutions_client_.call(srv)) {
+		get_solutions_client_.shutdown();  // e.g. remote task doesn't provide the batch service
+		return false;
+	}
+	// scenes are sent only once: process solutions in order
+	for (size_t i = 0; i < srv.response.solutions.size() && i < srv.response.solution_ids.size(); ++i)
+		id_to_solution_.insert(srv.response.solution_ids[i], processSolutionMessage(srv.response.solutions[i]));
+	return true;
 }
 
 rviz::PropertyTreeModel* RemoteTaskModel::getPropertyModel(const QModelIndex& index) {
@@ -448,17 +654,58 @@ template <class T>
 typename T::iterator findById(T& c, decltype((*c.cbegin())->id) id) {
 	return std::find_if(c.begin(), c.end(), [id](const typename T::value_type& item) { return item->id == id; });
 }
+}  // namespace detail
+
+size_t SolutionCache::estimateSize(const DisplaySolution& s) {
+	size_t result = sizeof(DisplaySolution) + s.numSubSolutions() * sizeof(robot_trajectory::RobotTrajectory);
+	if (s.getWayPointCount() == 0)
+		return result;
+
+	// estimate size of materialized way points: positions, velocities, accelerations, efforts + transforms
+	const moveit::core::RobotModelConstPtr& model = s.robotModel();
+	size_t state_size = sizeof(moveit::core::RobotState) + 4 * model->getVariableCount() * sizeof(double) +
+	                    (model->getLinkModelCount() + model->getJointModelCount()) * sizeof(Eigen::Isometry3d);
+	return result + s.getWayPointCount() * state_size;
+}
 
-// insert new Data item into data_ container
-template <class T>
-typename T::iterator insert(T& c, typename T::value_type&& item) {
-	auto p = std::equal_range(c.begin(), c.end(), item);
-	if (p.first == p.second)  // new item
-		return c.insert(p.second, std::move(item));
-	else
-		return p.first;
+void SolutionCache::setCapacity(size_t capacity) {
+	capacity_ = capacity;
+	evict();
+}
+
+bool SolutionCache::get(uint32_t id, DisplaySolutionPtr& solution) {
+	auto it = entries_.find(id);
+	if (it == entries_.end())
+		return false;
+	lru_.splice(lru_.begin(), lru_, it->second.lru);
+	solution = it->second.solution;
+	return true;
+}
+
+void SolutionCache::insert(uint32_t id, const DisplaySolutionPtr& solution, size_t size) {
+	auto it = entries_.find(id);
+	if (it != entries_.end()) {
+		size_ -= it->second.size;
+		lru_.splice(lru_.begin(), lru_, it->second.lru);
+		it->second.solution = solution;
+		it->second.size = size;
+	} else {
+		lru_.push_front(id);
+		entries_.insert(std::make_pair(id, Entry{ solution, size, lru_.begin() }));
+	}
+	size_ += size;
+	evict();
+}
+
+void SolutionCache::evict() {
+	// always keep the most recently used solution, even if it exceeds the capacity alone
+	while (size_ > capacity_ && lru_.size() > 1) {
+		auto it = entries_.find(lru_.back());
+		size_ -= it->second.size;
+		entries_.erase(it);
+		lru_.pop_back();
+	}
 }
-}  // namespace detail
 
 RemoteSolutionModel::RemoteSolutionModel(QObject* parent) : QAbstractTableModel(parent) {}
 
@@ -533,7 +780,7 @@ void RemoteSolutionModel::setSolutionData(uint32_t id, float cost, const QString
 	// retrieve iterator and row corresponding to id
 	auto sit = detail::findById(sorted_, id);
 	int row = (sit != sorted_.end()) ? sit - sorted_.begin() : -1;
-	auto it = (sit != sorted_.end()) ? *sit : detail::insert(data_, Data(id, cost, 0, comment));
+	auto it = (sit != sorted_.end()) ? *sit : insert(Data(id, cost, 0, comment));
 
 	QModelIndex tl, br;
 	Data& item = *it;
@@ -550,8 +797,10 @@ void RemoteSolutionModel::setSolutionData(uint32_t id, float cost, const QString
 	if (tl.isValid())
 		Q_EMIT dataChanged(tl, br);
 
-	if (row < 0 && isVisible(*it))  // item was newly created: inform views
-		sortInternal();
+	if (row < 0 && isVisible(*it)) {  // item was newly created: inform views
+		assignCreationRanks();
+		updateRows();
+	}
 }
 
 void RemoteSolutionModel::sort(int column, Qt::SortOrder order) {
@@ -564,37 +813,73 @@ void RemoteSolutionModel::sort(int column, Qt::SortOrder order) {
 	sortInternal();
 }
 
+std::vector<RemoteSolutionModel::DataList::iterator> RemoteSolutionModel::sortedItems() {
+	std::vector<DataList::iterator> sorted;
+	for (auto it = data_.begin(), end = data_.end(); it != end; ++it)
+		if (isVisible(*it))
+			sorted.push_back(it);
+
+	if (sort_column_ >= 0)
+		std::sort(sorted.begin(), sorted.end(), [this](const DataList::iterator& left, const DataList::iterator& right) {
+			return lessThan(*left, *right);
+		});
+	return sorted;
+}
+
+bool RemoteSolutionModel::lessThan(const Data& left, const Data& right) const {
+	if (sort_column_ < 0)  // unsorted: creation order
+		return left.id < right.id;
+	int comp = 0;
+	switch (sort_column_) {
+		case 1:  // cost order
+			if (left.cost_rank < right.cost_rank)
+				comp = -1;
+			else if (left.cost_rank > right.cost_rank)
+				comp = 1;
+			break;
+		case 2:  // comment
+			comp = left.comment.compare(right.comment);
+			break;
+	}
+	if (comp == 0)  // if still undecided, id decides
+		comp = (left.id < right.id ? -1 : 1);
+	return (sort_order_ == Qt::AscendingOrder) ? (comp < 0) : (comp >= 0);
+}
+
+RemoteSolutionModel::DataList::iterator RemoteSolutionModel::find(uint32_t id) {
+	auto it = index_.find(id);
+	return it != index_.end() ? it->second : data_.end();
+}
+
+RemoteSolutionModel::DataList::iterator RemoteSolutionModel::insert(Data&& item) {
+	// ids increase over time, thus new items are usually appended
+	auto next = index_.lower_bound(item.id);
+	if (next != index_.end() && next->first == item.id)
+		return next->second;
+	auto it = data_.insert(next != index_.end() ? next->second : data_.end(), std::move(item));
+	index_.emplace_hint(next, it->id, it);
+	return it;
+}
+
+void RemoteSolutionModel::erase(DataList::iterator it) {
+	index_.erase(it->id);
+	data_.erase(it);
+}
+
+void RemoteSolutionModel::markListed() {
+	for (auto& item : data_)
+		item.listed = false;
+	for (const auto& it : sorted_)
+		it->listed = true;
+}
+
 void RemoteSolutionModel::sortInternal() {
 	Q_EMIT layoutAboutToBeChanged();
 	QModelIndexList old_indexes = persistentIndexList();
-	std::vector<DataList::iterator> old_sorted;
+	std::vector<DataList::iterator> old_sorted = sortedItems();
 	std::swap(sorted_, old_sorted);
-
-	// create new order in sorted_
-	for (auto it = data_.begin(), end = data_.end(); it != end; ++it)
-		if (isVisible(*it))
-			sorted_.push_back(it);
-
-	if (sort_column_ >= 0) {
-		std::sort(sorted_.begin(), sorted_.end(),
-		          [this](const DataList::iterator& left, const DataList::iterator& right) {
-			          int comp = 0;
-			          switch (sort_column_) {
-				          case 1:  // cost order
-					          if (left->cost_rank < right->cost_rank)
-						          comp = -1;
-					          else if (left->cost_rank > right->cost_rank)
-						          comp = 1;
-					          break;
-				          case 2:  // comment
-					          comp = left->comment.compare(right->comment);
-					          break;
-			          }
-			          if (comp == 0)  // if still undecided, id decides
-				          comp = (left->id < right->id ? -1 : 1);
-			          return (sort_order_ == Qt::AscendingOrder) ? (comp < 0) : (comp >= 0);
-		          });
-	}
+	markListed();
+	rows_dirty_ = ranks_changed_ = false;
 
 	// map old indexes to new ones
 	std::map<int, int> old_to_new_row;
@@ -614,18 +899,161 @@ void RemoteSolutionModel::sortInternal() {
 	Q_EMIT layoutChanged();
 }
 
+void RemoteSolutionModel::holdRowUpdates(bool hold) {
+	hold_rows_ = hold;
+	if (!hold && rows_dirty_)
+		updateRows();
+}
+
+bool RemoteSolutionModel::mergeRows() {
+	// listed items, which remain visible, need to keep their order
+	const Data* previous = nullptr;
+	for (const auto& it : sorted_) {
+		if (!isVisible(*it))
+			continue;
+		if (previous && !lessThan(*previous, *it))
+			return false;
+		previous = &*it;
+	}
+
+	// remove runs of rows that are not visible anymore
+	for (int row = sorted_.size() - 1; row >= 0; --row) {
+		if (isVisible(*sorted_[row]))
+			continue;
+		int first = row;
+		while (first > 0 && !isVisible(*sorted_[first - 1]))
+			--first;
+		beginRemoveRows(QModelIndex(), first, row);
+		for (int i = first; i <= row; ++i)
+			sorted_[i]->listed = false;
+		sorted_.erase(sorted_.begin() + first, sorted_.begin() + row + 1);
+		endRemoveRows();
+		row = first;
+	}
+
+	// new visible items in display order
+	auto less = [this](const DataList::iterator& left, const DataList::iterator& right) {
+		return lessThan(*left, *right);
+	};
+	std::vector<DataList::iterator> added;
+	for (auto it = data_.begin(), end = data_.end(); it != end; ++it)
+		if (!it->listed && isVisible(*it))
+			added.push_back(it);
+	std::sort(added.begin(), added.end(), less);
+
+	// insert runs of new items sharing the same (binary-searched) position at once
+	size_t row = 0;
+	for (auto begin = added.begin(); begin != added.end();) {
+		row = std::upper_bound(sorted_.begin() + row, sorted_.end(), *begin, less) - sorted_.begin();
+		auto end = begin + 1;
+		if (row < sorted_.size())
+			while (end != added.end() && less(*end, sorted_[row]))
+				++end;
+		else
+			end = added.end();
+		beginInsertRows(QModelIndex(), row, row + (end - begin) - 1);
+		for (auto it = begin; it != end; ++it)
+			(*it)->listed = true;
+		sorted_.insert(sorted_.begin() + row, begin, end);
+		endInsertRows();
+		row += end - begin;
+		begin = end;
+	}
+	return true;
+}
+
+void RemoteSolutionModel::updateRows() {
+	if (hold_rows_) {
+		rows_dirty_ = true;
+		return;
+	}
+	rows_dirty_ = false;
+	if (mergeRows()) {
+		if (ranks_changed_ && !sorted_.empty())
+			Q_EMIT dataChanged(index(0, 0), index(sorted_.size() - 1, 0));
+		ranks_changed_ = false;
+		return;
+	}
+	const std::vector<DataList::iterator> target = sortedItems();
+
+	// remove rows that are not visible anymore
+	std::set<const Data*> listed;
+	for (const auto& it : target)
+		listed.insert(&*it);
+	for (int row = sorted_.size() - 1; row >= 0; --row) {
+		if (listed.count(&*sorted_[row]))
+			continue;
+		beginRemoveRows(QModelIndex(), row, row);
+		sorted_.erase(sorted_.begin() + row);
+		endRemoveRows();
+	}
+
+	// transform sorted_ into target, row by row
+	std::set<const Data*> present;
+	for (const auto& it : sorted_)
+		present.insert(&*it);
+	for (size_t row = 0; row < target.size(); ++row) {
+		if (row < sorted_.size() && sorted_[row] == target[row])
+			continue;
+		if (!present.count(&*target[row])) {  // insert a run of new items at once
+			size_t end = row + 1;
+			while (end < target.size() && !present.count(&*target[end]))
+				++end;
+			beginInsertRows(QModelIndex(), row, end - 1);
+			sorted_.insert(sorted_.begin() + row, target.begin() + row, target.begin() + end);
+			endInsertRows();
+			row = end - 1;
+		} else {  // move existing item up (sorted_ and target agree on all rows before)
+			size_t from = std::find(sorted_.begin() + row, sorted_.end(), target[row]) - sorted_.begin();
+			beginMoveRows(QModelIndex(), from, from, QModelIndex(), row);
+			sorted_.erase(sorted_.begin() + from);
+			sorted_.insert(sorted_.begin() + row, target[row]);
+			endMoveRows();
+		}
+	}
+	markListed();
+
+	if (ranks_changed_ && !sorted_.empty())
+		Q_EMIT dataChanged(index(0, 0), index(sorted_.size() - 1, 0));
+	ranks_changed_ = false;
+}
+
+void RemoteSolutionModel::assignCreationRanks() {
+	uint32_t rank = 0;
+	for (auto& item : data_) {
+		// a changed rank of a new item (with rank 0) doesn't need notification
+		if (item.creation_rank != ++rank && item.creation_rank != 0)
+			ranks_changed_ = true;
+		item.creation_rank = rank;
+	}
+}
+
 // process solution ids received in stage statistics
-void RemoteSolutionModel::processSolutionIDs(const std::vector<uint32_t>& successful,
+bool RemoteSolutionModel::processSolutionIDs(const std::vector<uint32_t>& successful,
                                              const std::vector<uint32_t>& failed, size_t num_failed,
                                              double total_compute_time) {
+	// skip unchanged keyframes: all ids known and in same cost order
+	if (successful.size() + failed.size() == data_.size() && failed.size() == num_failed_data_ &&
+	    std::max(num_failed, failed.size()) == num_failed_ && total_compute_time == total_compute_time_) {
+		uint32_t rank = 0;
+		bool unchanged = true;
+		for (size_t i = 0; unchanged && i < successful.size(); ++i) {
+			auto it = find(successful[i]);
+			unchanged = it != data_.end() && it->cost_rank == ++rank;
+		}
+		for (size_t i = 0; unchanged && i < failed.size(); ++i) {
+			unchanged = find(failed[i]) != data_.end();
+		}
+		if (unchanged)
+			return false;
+	}
+
 	// append new items to the end of data_
 	processSolutionIDs(successful, true);
 	processSolutionIDs(failed, false);
 
 	// assign consecutive creation ranks
-	uint32_t rank = 0;
-	for (auto& item : data_)
-		item.creation_rank = ++rank;
+	assignCreationRanks();
 
 	// the task may not report failure ids (in failed),
 	// but it may report the overall number of failures
@@ -633,7 +1061,8 @@ void RemoteSolutionModel::processSolutionIDs(const std::vector<uint32_t>& succes
 	num_failed_ = std::max(num_failed, num_failed_data_);
 	total_compute_time_ = total_compute_time;
 
-	sortInternal();
+	updateRows();
+	return true;
 }
 
 void RemoteSolutionModel::processSolutionIDs(const std::vector<uint32_t>& ids, bool successful) {
@@ -644,12 +1073,66 @@ void RemoteSolutionModel::processSolutionIDs(const std::vector<uint32_t>& ids, b
 	uint32_t cost_rank = 0;
 	for (const uint32_t id : ids) {
 		uint32_t rank = successful ? ++cost_rank : std::numeric_limits<uint32_t>::max();
-		auto it = detail::insert(data_, Data(id, default_cost, rank));
+		auto it = insert(Data(id, default_cost, rank));
 		Q_ASSERT(it->id == id);
 		it->cost_rank = rank;
 	}
 }
 
+bool RemoteSolutionModel::processSolutionIDsDelta(const moveit_task_constructor_msgs::StageStatistics& delta) {
+	if (delta.removed.empty() && delta.solved.empty() && delta.failed.empty() &&
+	    std::max<size_t>(delta.num_failed, num_failed_data_) == num_failed_ &&
+	    delta.total_compute_time == total_compute_time_)
+		return false;
+
+	const uint32_t failed_rank = std::numeric_limits<uint32_t>::max();
+	// remove dropped items, informing views
+	for (const uint32_t id : delta.removed) {
+		auto it = find(id);
+		if (it == data_.end())
+			continue;
+		auto sit = it->listed ? std::find(sorted_.begin(), sorted_.end(), it) : sorted_.end();
+		if (sit != sorted_.end()) {
+			int row = sit - sorted_.begin();
+			beginRemoveRows(QModelIndex(), row, row);
+			sorted_.erase(sit);
+			erase(it);
+			endRemoveRows();
+		} else
+			erase(it);
+	}
+
+	// remaining successful items, ordered by cost
+	std::vector<Data*> by_cost;
+	for (auto& item : data_)
+		if (item.cost_rank != failed_rank)
+			by_cost.push_back(&item);
+	std::sort(by_cost.begin(), by_cost.end(),
+	          [](const Data* left, const Data* right) { return left->cost_rank < right->cost_rank; });
+
+	// insert new items at their (increasing) positions
+	for (size_t i = 0; i < delta.solved.size() && i < delta.solved_index.size(); ++i) {
+		size_t size = data_.size();
+		auto it = insert(Data(delta.solved[i], std::numeric_limits<double>::quiet_NaN(), 0));
+		if (data_.size() == size)
+			continue;  // already known
+		by_cost.insert(by_cost.begin() + std::min<size_t>(delta.solved_index[i], by_cost.size()), &*it);
+	}
+	uint32_t rank = 0;
+	for (Data* item : by_cost)
+		item->cost_rank = ++rank;
+	processSolutionIDs(delta.failed, false);
+
+	assignCreationRanks();
+
+	num_failed_data_ = data_.size() - by_cost.size();
+	num_failed_ = std::max<size_t>(delta.num_failed, num_failed_data_);
+	total_compute_time_ = delta.total_compute_time;
+
+	updateRows();
+	return true;
+}
+
 bool RemoteSolutionModel::isVisible(const RemoteSolutionModel::Data& item) const {
 	return std::isnan(item.cost) || item.cost <= max_cost_;
 }
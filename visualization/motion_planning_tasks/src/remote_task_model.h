@@ -41,9 +41,53 @@
 #include <ros/service_client.h>
 #include <memory>
 #include <limits>
+#include <list>
+#include <map>
 
 namespace moveit_rviz_plugin {
 
+/** LRU cache of DisplaySolutions, bounded by their (approximate) memory footprint
+ *
+ *  Evicted solutions are fetched again from the remote task when needed.
+ */
+class SolutionCache
+{
+	struct Entry
+	{
+		DisplaySolutionPtr solution;
+		size_t size;
+		std::list<uint32_t>::iterator lru;  // position in lru_
+	};
+	std::map<uint32_t, Entry> entries_;
+	std::list<uint32_t> lru_;  // ids, most recently used first
+	size_t size_ = 0;  // accumulated size of all entries
+	size_t capacity_;
+
+	void evict();
+
+public:
+	static const size_t DEFAULT_CAPACITY = 256 << 20;  // bytes
+
+	SolutionCache(size_t capacity = DEFAULT_CAPACITY) : capacity_(capacity) {}
+
+	/// approximate memory footprint of a solution
+	static size_t estimateSize(const DisplaySolution& s);
+
+	size_t size() const { return size_; }
+	size_t count() const { return entries_.size(); }
+	size_t capacity() const { return capacity_; }
+	void setCapacity(size_t capacity);
+
+	bool contains(uint32_t id) const { return entries_.count(id); }
+	/// lookup solution and mark it as recently used, return false if not cached
+	bool get(uint32_t id, DisplaySolutionPtr& solution);
+	/// insert or replace solution, evicting least recently used ones if capacity is exceeded
+	void insert(uint32_t id, const DisplaySolutionPtr& solution, size_t size);
+	void insert(uint32_t id, const DisplaySolutionPtr& solution) {
+		insert(id, solution, solution ? estimateSize(*solution) : 0);
+	}
+};
+
 class RemoteSolutionModel;
 /** Model representing a remote task
  *
@@ -55,9 +99,15 @@ class RemoteTaskModel : public BaseTaskModel
 	struct Node;
 	Node* const root_;
 	ros::ServiceClient get_solution_client_;
+	ros::ServiceClient get_solutions_client_;  // batch requests
 
 	std::map<uint32_t, Node*> id_to_stage_;
-	std::map<uint32_t, DisplaySolutionPtr> id_to_solution_;
+	SolutionCache id_to_solution_;
+	std::map<std::string, planning_scene::PlanningSceneConstPtr> start_scenes_;  // start scenes by id
+	uint32_t statistics_seq_ = 0;  // sequence number of last processed TaskStatistics
+	bool statistics_valid_ = false;  // in delta mode: did we see all messages since the last keyframe?
+	// TaskStatistics received since the last (coalesced) model update
+	std::vector<moveit_task_constructor_msgs::TaskStatistics> pending_statistics_;
 
 	inline Node* node(const QModelIndex& index) const;
 	QModelIndex index(const Node* n) const;
@@ -65,9 +115,13 @@ class RemoteTaskModel : public BaseTaskModel
 	Node* node(uint32_t stage_id) const;
 	inline RemoteSolutionModel* getSolutionModel(uint32_t stage_id) const;
 	void setSolutionData(const moveit_task_constructor_msgs::SolutionInfo& info);
+	/// fetch solutions of index and its uncached neighbours (in the solution list) with a single request
+	bool fetchSolutions(const QModelIndex& index);
+	/// apply pending_statistics_, only notifying about changed stages
+	void flushStageStatistics();
 
 public:
-	RemoteTaskModel(ros::NodeHandle& nh, const std::string& service_name,
+	RemoteTaskModel(ros::NodeHandle& nh, const std::string& service_name, const std::string& batch_service_name,
 	                const planning_scene::PlanningSceneConstPtr& scene, rviz::DisplayContext* display_context,
 	                QObject* parent = nullptr);
 	~RemoteTaskModel() override;
@@ -82,13 +136,16 @@ public:
 
 	QModelIndex indexFromStageId(size_t id) const override;
 	void processStageDescriptions(const moveit_task_constructor_msgs::TaskDescription::_stages_type& msg);
-	void processStageStatistics(const moveit_task_constructor_msgs::TaskStatistics::_stages_type& msg);
+	void processStageStatistics(const moveit_task_constructor_msgs::TaskStatistics& msg);
 	DisplaySolutionPtr processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg);
 
 	QAbstractItemModel* getSolutionModel(const QModelIndex& index) override;
 	DisplaySolutionPtr getSolution(const QModelIndex& index) override;
 
 	rviz::PropertyTreeModel* getPropertyModel(const QModelIndex& index) override;
+
+	/// limit memory used by cached solutions (in bytes)
+	void setSolutionCacheCapacity(size_t capacity) { id_to_solution_.setCapacity(capacity); }
 };
 
 /** Model representing solutions of a remote task */
@@ -102,6 +159,7 @@ class RemoteSolutionModel : public QAbstractTableModel
 		QString comment;
 		uint32_t creation_rank;  // rank, ordered by creation
 		uint32_t cost_rank;  // rank, ordering by cost
+		bool listed = false;  // item is in sorted_
 
 		Data(uint32_t id, float cost, uint32_t cost_rank, const QString& name = QString())
 		  : id(id), cost(cost), comment(name), creation_rank(0), cost_rank(cost_rank) {}
@@ -111,6 +169,7 @@ class RemoteSolutionModel : public QAbstractTableModel
 	// successful and failed solutions ordered by id / creation
 	using DataList = std::list<Data>;
 	DataList data_;
+	std::map<uint32_t, DataList::iterator> index_;  // items of data_ by id
 	size_t num_failed_data_ = 0;  // number of failed solutions in data_
 	size_t num_failed_ = 0;  // number of reported failures
 	double total_compute_time_ = 0.0;
@@ -120,10 +179,30 @@ class RemoteSolutionModel : public QAbstractTableModel
 	Qt::SortOrder sort_order_ = Qt::AscendingOrder;
 	double max_cost_ = std::numeric_limits<double>::infinity();
 	std::vector<DataList::iterator> sorted_;
+	bool hold_rows_ = false;  // postpone updates of sorted_
+	bool rows_dirty_ = false;  // sorted_ needs an update
+	bool ranks_changed_ = false;  // creation rank of a listed item changed
 
 	inline bool isVisible(const Data& item) const;
+	/// item with given id (data_.end() if unknown)
+	DataList::iterator find(uint32_t id);
+	/// insert a new item into data_ (returning an existing one with the same id)
+	DataList::iterator insert(Data&& item);
+	void erase(DataList::iterator it);
+	/// display order of items
+	bool lessThan(const Data& left, const Data& right) const;
 	void processSolutionIDs(const std::vector<uint32_t>& ids, bool successful);
+	void assignCreationRanks();
+	/// visible items in display order
+	std::vector<DataList::iterator> sortedItems();
+	/// full re-sort, emitting layoutChanged
 	void sortInternal();
+	/// incrementally update sorted_, emitting minimal row signals
+	void updateRows();
+	/// merge new items into sorted_ by binary search, returns false if listed items need to be reordered
+	bool mergeRows();
+	/// update Data::listed after rebuilding sorted_
+	void markListed();
 
 public:
 	RemoteSolutionModel(QObject* parent = nullptr);
@@ -139,7 +218,12 @@ public:
 	void sort(int column, Qt::SortOrder order) override;
 
 	void setSolutionData(uint32_t id, float cost, const QString& comment);
-	void processSolutionIDs(const std::vector<uint32_t>& successful, const std::vector<uint32_t>& failed,
+	/// returns false if nothing changed
+	bool processSolutionIDs(const std::vector<uint32_t>& successful, const std::vector<uint32_t>& failed,
 	                        size_t num_failed, double total_compute_time);
+	/// apply a delta-encoded StageStatistics message, returns false if nothing changed
+	bool processSolutionIDsDelta(const moveit_task_constructor_msgs::StageStatistics& delta);
+	/// while held, views are not informed about new or reordered rows (but about removed ones)
+	void holdRowUpdates(bool hold);
 };
 }  // namespace moveit_rviz_plugin
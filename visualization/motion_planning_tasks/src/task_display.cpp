@@ -198,15 +198,17 @@ void TaskDisplay::changedRobotDescription() {
 void TaskDisplay::taskDescriptionCB(const moveit_task_constructor_msgs::TaskDescriptionConstPtr& msg) {
 	setStatus(rviz::StatusProperty::Ok, "Task Monitor", "OK");
 	requestPanel();
-	task_list_model_->processTaskDescriptionMessage(*msg, update_nh_,
-	                                                base_ns_ + GET_SOLUTION_SERVICE "_" + msg->task_id);
+	task_list_model_->processTaskDescriptionMessage(*msg, update_nh_, base_ns_ + GET_SOLUTION_SERVICE "_" + msg->task_id,
+	                                                base_ns_ + GET_SOLUTIONS_SERVICE "_" + msg->task_id);
 
 	// Start listening to other topics if this is the first description
 	// Waiting for the description ensures we do not receive data that cannot be interpreted yet
 	if (!received_task_description_ && !msg->stages.empty()) {
 		received_task_description_ = true;
 		task_statistics_sub = update_nh_.subscribe(base_ns_ + STATISTICS_TOPIC, 2, &TaskDisplay::taskStatisticsCB, this);
-		task_solution_sub = update_nh_.subscribe(base_ns_ + SOLUTION_TOPIC, 2, &TaskDisplay::taskSolutionCB, this);
+		// solutions can be large: avoid Nagle's algorithm delaying them
+		task_solution_sub = update_nh_.subscribe(base_ns_ + SOLUTION_TOPIC, 2, &TaskDisplay::taskSolutionCB, this,
+		                                         ros::TransportHints().tcpNoDelay());
 	}
 }
 
@@ -217,6 +219,10 @@ void TaskDisplay::taskStatisticsCB(const moveit_task_constructor_msgs::TaskStati
 
 void TaskDisplay::taskSolutionCB(const moveit_task_constructor_msgs::SolutionConstPtr& msg) {
 	setStatus(rviz::StatusProperty::Ok, "Task Monitor", "OK");
+	if (msg->summary) {  // e.g. from the remote profile: nothing to display
+		task_list_model_->processSolutionMessage(*msg);
+		return;
+	}
 	try {
 		const DisplaySolutionPtr& s = task_list_model_->processSolutionMessage(*msg);
 		if (s)
@@ -42,12 +42,14 @@
 #include "factory_model.h"
 #include "icons.h"
 
+#include <moveit/task_constructor/stage_registry.h>
 #include <ros/console.h>
 
 #include <QMimeData>
 #include <QHeaderView>
 #include <QScrollBar>
 #include <qevent.h>
+#include <cstdlib>
 #include <numeric>
 
 using namespace moveit::task_constructor;
@@ -134,14 +136,27 @@ QVariant BaseTaskModel::flowIcon(moveit::task_constructor::InterfaceFlags f) {
 
 StageFactoryPtr getStageFactory() {
 	static std::weak_ptr<StageFactory> factory;
+	static StageFactoryPtr preloaded;  // keeps the factory alive if plugins should be preloaded
 	StageFactoryPtr result = factory.lock();
 	if (result)
 		return result;
 
 	try {
 		result.reset(new StageFactory("moveit_task_constructor_core", "moveit::task_constructor::Stage"));
-		// Hm. pluglinlib / ClassLoader cannot instantiate classes in implicitly loaded libs
-		result->addBuiltInClass<moveit::task_constructor::SerialContainer>("Serial Container", "");
+		// pluginlib's ClassLoader cannot instantiate classes in implicitly loaded libs:
+		// create built-in stages directly via the StageRegistry, which also skips pluginlib's XML parsing for them
+		// Their class ids keep pluginlib's naming, but icons are looked up in the declaring (core) package.
+		for (const auto& entry : moveit::task_constructor::StageRegistry::instance().entries()) {
+			const size_t slash = entry.class_id.find('/');
+			const auto factory_function = entry.factory;
+			result->addBuiltInClass(QString::fromStdString(entry.class_id), "moveit_task_constructor_core",
+			                        QString::fromStdString(entry.class_id.substr(slash + 1)),
+			                        QString::fromStdString(entry.description), factory_function);
+		}
+		if (std::getenv("MTC_PRELOAD_PLUGINS")) {
+			result->preload();
+			preloaded = result;
+		}
 		factory = result;  // remember for future uses
 		return result;
 	} catch (const std::exception& e) {
@@ -163,7 +178,9 @@ void TaskListModel::onRemoveModel(QAbstractItemModel* model) {
 }
 
 TaskListModel::TaskListModel(QObject* parent)
-  : FlatMergeProxyModel(parent), old_task_handling_(TaskView::OLD_TASK_REPLACE) {
+  : FlatMergeProxyModel(parent)
+  , old_task_handling_(TaskView::OLD_TASK_REPLACE)
+  , solution_cache_capacity_(SolutionCache::DEFAULT_CAPACITY) {
 	ROS_DEBUG_NAMED(LOGNAME, "created TaskListModel: %p", this);
 	setStageFactory(getStageFactory());
 }
@@ -207,6 +224,13 @@ void TaskListModel::setOldTaskHandling(int mode) {
 	old_task_handling_ = mode;
 }
 
+void TaskListModel::setSolutionCacheSize(int megabytes) {
+	solution_cache_capacity_ = static_cast<size_t>(std::max(megabytes, 1)) << 20;
+	for (const auto& pair : remote_tasks_)
+		if (pair.second)
+			pair.second->setSolutionCacheCapacity(solution_cache_capacity_);
+}
+
 void TaskListModel::highlightStage(size_t id) {
 	if (!active_task_model_)
 		return;
@@ -242,12 +266,20 @@ QVariant TaskListModel::data(const QModelIndex& index, int role) const {
 // process a task description message:
 // update existing RemoteTask, create a new one, or (if msg.stages is empty) delete an existing one
 void TaskListModel::processTaskDescriptionMessage(const moveit_task_constructor_msgs::TaskDescription& msg,
-                                                  ros::NodeHandle& nh, const std::string& service_name) {
+                                                  ros::NodeHandle& nh, const std::string& service_name,
+                                                  const std::string& batch_service_name) {
 	// retrieve existing or insert new remote task for given task id
 	auto it_inserted = remote_tasks_.insert(std::make_pair(msg.task_id, nullptr));
 	const auto& task_it = it_inserted.first;
 	RemoteTaskModel*& remote_task = task_it->second;
 
+	// deltas only update known tasks, a full description will follow for new ones
+	if (msg.delta && (!remote_task || (remote_task->taskFlags() & BaseTaskModel::IS_DESTROYED))) {
+		if (!remote_task)
+			remote_tasks_.erase(task_it);
+		return;
+	}
+
 	if (!msg.stages.empty() && remote_task && (remote_task->taskFlags() & BaseTaskModel::IS_DESTROYED)) {
 		// task overriding previous one that was already marked destroyed, but not yet removed from model
 		if (old_task_handling_ != TaskView::OLD_TASK_KEEP)
@@ -267,7 +299,8 @@ void TaskListModel::processTaskDescriptionMessage(const moveit_task_constructor_
 			remote_task->processStageDescriptions(msg.stages);
 	} else if (!remote_task) {  // create new task model, if ID was not known before
 		// the model is managed by this instance via Qt's parent-child mechanism
-		remote_task = new RemoteTaskModel(nh, service_name, scene_, display_context_, this);
+		remote_task = new RemoteTaskModel(nh, service_name, batch_service_name, scene_, display_context_, this);
+		remote_task->setSolutionCacheCapacity(solution_cache_capacity_);
 		remote_task->processStageDescriptions(msg.stages);
 		ROS_DEBUG_NAMED(LOGNAME, "received new task: %s (%s)", msg.stages[0].name.c_str(), msg.task_id.c_str());
 		// insert newly created model into this' model instance
@@ -291,7 +324,7 @@ void TaskListModel::processTaskStatisticsMessage(const moveit_task_constructor_m
 	if (!remote_task || (remote_task->taskFlags() & RemoteTaskModel::IS_DESTROYED))
 		return;  // task is not in use anymore
 
-	remote_task->processStageStatistics(msg.stages);
+	remote_task->processStageStatistics(msg);
 }
 
 DisplaySolutionPtr TaskListModel::processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg) {
@@ -132,6 +132,8 @@ class TaskListModel : public utils::FlatMergeProxyModel
 	std::map<std::string, RemoteTaskModel*> remote_tasks_;
 	// mode reflecting the "Old task handling" setting
 	int old_task_handling_;
+	// memory limit (in bytes) for cached solutions of each remote task
+	size_t solution_cache_capacity_;
 
 	// factory used to create stages
 	StageFactoryPtr stage_factory_;
@@ -156,7 +158,7 @@ public:
 
 	/// process an incoming task description message - only call in Qt's main loop
 	void processTaskDescriptionMessage(const moveit_task_constructor_msgs::TaskDescription& msg, ros::NodeHandle& nh,
-	                                   const std::string& service_name);
+	                                   const std::string& service_name, const std::string& batch_service_name);
 	/// process an incoming task description message - only call in Qt's main loop
 	void processTaskStatisticsMessage(const moveit_task_constructor_msgs::TaskStatistics& msg);
 	/// process an incoming solution message - only call in Qt's main loop
@@ -176,6 +178,8 @@ public:
 
 public Q_SLOTS:
 	void setOldTaskHandling(int mode);
+	/// limit memory used by cached solutions of each remote task (in MB)
+	void setSolutionCacheSize(int megabytes);
 
 protected Q_SLOTS:
 	void highlightStage(size_t id);
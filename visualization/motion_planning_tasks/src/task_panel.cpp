@@ -41,6 +41,7 @@
 #include "task_panel_p.h"
 #include "meta_task_list_model.h"
 #include "local_task_model.h"
+#include "remote_task_model.h"
 #include "factory_model.h"
 #include "pluginlib_factory.h"
 #include "task_display.h"
@@ -50,6 +51,7 @@
 
 #include <rviz/properties/property.h>
 #include <rviz/properties/enum_property.h>
+#include <rviz/properties/int_property.h>
 #include <rviz/display_group.h>
 #include <rviz/visualization_manager.h>
 #include <rviz/window_manager_interface.h>
@@ -237,7 +239,8 @@ TaskViewPrivate::TaskViewPrivate(TaskView* view) : q_ptr(view), exec_action_clie
 
 	// init actions
 	// TODO(v4hn): add actionAddLocalTask once there is something meaningful to add
-	tasks_view->addActions({ /*actionAddLocalTask,*/ actionRemoveTaskTreeRows, actionShowTimeColumn });
+	tasks_view->addActions({ /*actionAddLocalTask,*/ actionRemoveTaskTreeRows, actionPlanLocalTask, actionCancelPlanning,
+	                         actionShowTimeColumn });
 }
 
 std::pair<TaskListModel*, TaskDisplay*> TaskViewPrivate::getTaskListModel(const QModelIndex& index) const {
@@ -253,6 +256,8 @@ std::pair<BaseTaskModel*, QModelIndex> TaskViewPrivate::getTaskModel(const QMode
 void TaskViewPrivate::configureTaskListModel(TaskListModel* model) {
 	QObject::connect(q_ptr, &TaskView::oldTaskHandlingChanged, model, &TaskListModel::setOldTaskHandling);
 	model->setOldTaskHandling(q_ptr->old_task_handling->getOptionInt());
+	QObject::connect(q_ptr, &TaskView::solutionCacheSizeChanged, model, &TaskListModel::setSolutionCacheSize);
+	model->setSolutionCacheSize(q_ptr->solution_cache_size->getInt());
 }
 
 void TaskViewPrivate::configureExistingModels() {
@@ -302,6 +307,8 @@ TaskView::TaskView(moveit_rviz_plugin::TaskPanel* parent, rviz::Property* root)
 	// connect signals
 	connect(d->actionRemoveTaskTreeRows, SIGNAL(triggered()), this, SLOT(removeSelectedStages()));
 	connect(d->actionAddLocalTask, SIGNAL(triggered()), this, SLOT(addTask()));
+	connect(d->actionPlanLocalTask, SIGNAL(triggered()), this, SLOT(planCurrentTask()));
+	connect(d->actionCancelPlanning, SIGNAL(triggered()), this, SLOT(cancelPlanning()));
 	connect(d->actionShowTimeColumn, &QAction::triggered, [this](bool checked) { show_time_column->setValue(checked); });
 
 	connect(d->tasks_view->selectionModel(), SIGNAL(currentChanged(QModelIndex, QModelIndex)), this,
@@ -333,6 +340,13 @@ TaskView::TaskView(moveit_rviz_plugin::TaskPanel* parent, rviz::Property* root)
 	old_task_handling->addOption("Remove", OLD_TASK_REMOVE);
 	connect(old_task_handling, &rviz::Property::changed, this, &TaskView::onOldTaskHandlingChanged);
 
+	solution_cache_size = new rviz::IntProperty("Solution Cache Size", SolutionCache::DEFAULT_CAPACITY >> 20,
+	                                            "Memory (in MB) to use for caching solutions of each remote task. "
+	                                            "Evicted solutions are fetched again on demand.",
+	                                            configs);
+	solution_cache_size->setMin(1);
+	connect(solution_cache_size, &rviz::Property::changed, this, &TaskView::onSolutionCacheSizeChanged);
+
 	show_time_column = new rviz::BoolProperty("Show Computation Times", true, "Show the 'time' column", configs);
 	connect(show_time_column, &rviz::Property::changed, this, &TaskView::onShowTimeChanged);
 
@@ -424,6 +438,18 @@ void TaskView::addTask() {
 	d_ptr->tasks_view->edit(current);
 }
 
+void TaskView::planCurrentTask() {
+	auto* task = dynamic_cast<LocalTaskModel*>(d_ptr->getTaskModel(d_ptr->tasks_view->currentIndex()).first);
+	if (task)
+		task->startPlanning();
+}
+
+void TaskView::cancelPlanning() {
+	auto* task = dynamic_cast<LocalTaskModel*>(d_ptr->getTaskModel(d_ptr->tasks_view->currentIndex()).first);
+	if (task)
+		task->cancelPlanning();
+}
+
 void TaskView::removeSelectedStages() {
 	auto* m = d_ptr->tasks_view->model();
 	for (const auto& range : d_ptr->tasks_view->selectionModel()->selection())
@@ -440,6 +466,10 @@ void TaskView::onCurrentStageChanged(const QModelIndex& current, const QModelInd
 	BaseTaskModel* task;
 	QModelIndex task_index;
 	std::tie(task, task_index) = d_ptr->getTaskModel(current);
+	// planning is available for local tasks
+	const bool local = task && (task->taskFlags() & BaseTaskModel::LOCAL_MODEL);
+	d_ptr->actionPlanLocalTask->setEnabled(local);
+	d_ptr->actionCancelPlanning->setEnabled(local);
 
 	d_ptr->lock(nullptr);  // unlocks any locked_display_
 
@@ -550,6 +580,10 @@ void TaskView::onOldTaskHandlingChanged() {
 	Q_EMIT oldTaskHandlingChanged(old_task_handling->getOptionInt());
 }
 
+void TaskView::onSolutionCacheSizeChanged() {
+	Q_EMIT solutionCacheSizeChanged(solution_cache_size->getInt());
+}
+
 GlobalSettingsWidgetPrivate::GlobalSettingsWidgetPrivate(GlobalSettingsWidget* widget, rviz::Property* root)
   : q_ptr(widget) {
 	setupUi(widget);
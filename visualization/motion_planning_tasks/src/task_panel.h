@@ -49,6 +49,7 @@ class WindowManagerInterface;
 class Property;
 class BoolProperty;
 class EnumProperty;
+class IntProperty;
 }  // namespace rviz
 
 namespace moveit_rviz_plugin {
@@ -127,6 +128,7 @@ protected:
 
 	rviz::EnumProperty* initial_task_expand;
 	rviz::EnumProperty* old_task_handling;
+	rviz::IntProperty* solution_cache_size;
 	rviz::BoolProperty* show_time_column;
 
 public:
@@ -145,6 +147,9 @@ public:
 
 public Q_SLOTS:
 	void addTask();
+	/// plan the current local task in the background
+	void planCurrentTask();
+	void cancelPlanning();
 
 protected Q_SLOTS:
 	void removeSelectedStages();
@@ -154,12 +159,14 @@ protected Q_SLOTS:
 	void onExecCurrentSolution() const;
 	void onShowTimeChanged();
 	void onOldTaskHandlingChanged();
+	void onSolutionCacheSizeChanged();
 
 private:
 	Q_PRIVATE_SLOT(d_ptr, void _q_configureInsertedModels(QModelIndex, int, int));
 
 Q_SIGNALS:
 	void oldTaskHandlingChanged(int old_task_handling);
+	void solutionCacheSizeChanged(int megabytes);
 };
 
 class GlobalSettingsWidgetPrivate;
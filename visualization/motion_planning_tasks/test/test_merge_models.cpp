@@ -152,6 +152,30 @@ TEST(TreeMergeModel, basics) {
 	EXPECT_EQ(tree.rowCount(), 0);
 }
 
+TEST(TreeMergeModel, mappingCache) {
+	TreeMergeProxyModel tree;
+	QStandardItemModel* m1 = createStandardModel(&tree, 2, 2, 3);
+	QStandardItemModel* m2 = createStandardModel(&tree, 3, 2, 4);
+	tree.insertModel("M1", m1);
+	tree.insertModel("M2", m2);
+	checkEquality(&tree, tree.index(1, 0), m2, QModelIndex());
+
+	// bottom-up mapping of deep items, whose ancestors are already known
+	QModelIndex src = m2->index(1, 0, m2->index(2, 0, m2->index(0, 0)));
+	modifySourceModel(m2, &tree, src);
+	checkEquality(&tree, tree.index(1, 0), m2, QModelIndex());
+
+	// removing a subtree invalidates its mappings only
+	m2->removeRows(0, 1, m2->index(1, 0));
+	checkEquality(&tree, tree.index(1, 0), m2, QModelIndex());
+	checkEquality(&tree, tree.index(0, 0), m1, QModelIndex());
+
+	// removing a model shifts the positions of subsequent ones
+	ASSERT_TRUE(tree.removeModel(m1));
+	checkEquality(&tree, tree.index(0, 0), m2, QModelIndex());
+	EXPECT_EQ(tree.getModel(tree.index(0, 0, tree.index(0, 0))).first, m2);
+}
+
 TEST(FlatMergeModel, basics) {
 	FlatMergeProxyModel flat;
 
@@ -226,3 +250,39 @@ TEST_F(FlatMergeModelRemove, remove4) {
 	EXPECT_TRUE(flat.removeRows(2, 2));
 	EXPECT_EQ(flat.rowCount(), 1 + 1 + 2);
 }
+
+TEST(FlatMergeModel, rowMapping) {
+	FlatMergeProxyModel flat;
+	std::vector<QStandardItemModel*> models;
+	for (int i = 0; i < 5; ++i) {
+		models.push_back(createStandardModel(&flat, i + 1, 2, 1));
+		flat.insertModel(models.back());
+	}
+	ASSERT_EQ(flat.rowCount(), 1 + 2 + 3 + 4 + 5);
+	EXPECT_EQ(flat.getModel(flat.index(0, 0)).first, models[0]);
+	EXPECT_EQ(flat.getModel(flat.index(3, 0)).first, models[2]);
+	EXPECT_EQ(flat.getModel(flat.index(14, 1)).first, models[4]);
+	EXPECT_FALSE(flat.index(15, 0).isValid());
+
+	// insert and remove source rows: subsequent rows need to shift
+	models[1]->insertRow(0, new QStandardItem("new"));
+	ASSERT_EQ(flat.rowCount(), 16);
+	EXPECT_EQ(flat.index(1, 0).data(), QVariant("new"));
+	EXPECT_EQ(flat.getModel(flat.index(3, 0)).first, models[1]);
+	EXPECT_EQ(flat.getModel(flat.index(4, 0)).first, models[2]);
+
+	// empty models are skipped
+	models[0]->removeRow(0);
+	ASSERT_EQ(flat.rowCount(), 15);
+	EXPECT_EQ(flat.index(0, 0).data(), QVariant("new"));
+	EXPECT_EQ(flat.getModel(flat.index(2, 0)).first, models[1]);
+	EXPECT_EQ(flat.getModel(flat.index(3, 0)).first, models[2]);
+
+	EXPECT_EQ(flat.index(14, 0).data(), models[4]->index(4, 0).data());
+	EXPECT_EQ(flat.mapToSource(flat.index(6, 1)), models[3]->index(0, 1));
+	EXPECT_EQ(flat.mapFromSource(models[3]->index(0, 1)), flat.index(6, 1));
+
+	flat.removeModel(models[2]);
+	ASSERT_EQ(flat.rowCount(), 12);
+	EXPECT_EQ(flat.getModel(flat.index(4, 0)).first, models[3]);
+}
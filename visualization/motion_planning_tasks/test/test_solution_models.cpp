@@ -55,3 +55,123 @@ TEST_F(SolutionModelTest, sorting) {
 	processAndValidate({ 1, 3 }, { 2 });
 	processAndValidate({ 4, 1, 6, 3 }, { 5, 2 });
 }
+
+TEST_F(SolutionModelTest, incrementalUpdates) {
+	RemoteSolutionModel model;
+	model.sort(1, Qt::AscendingOrder);
+
+	int inserted = 0, layouts = 0;
+	QObject::connect(&model, &QAbstractItemModel::rowsInserted,
+	                 [&inserted](const QModelIndex& /*parent*/, int first, int last) { inserted += last - first + 1; });
+	QObject::connect(&model, &QAbstractItemModel::layoutChanged, [&layouts]() { ++layouts; });
+
+	EXPECT_TRUE(model.processSolutionIDs({ 1, 3 }, { 2 }, 1, 0.0));
+	EXPECT_EQ(inserted, 3);
+	EXPECT_FALSE(model.processSolutionIDs({ 1, 3 }, { 2 }, 1, 0.0));  // unchanged keyframe
+
+	EXPECT_TRUE(model.processSolutionIDs({ 4, 1, 3 }, { 2 }, 1, 0.0));
+	EXPECT_EQ(inserted, 4);
+	EXPECT_EQ(layouts, 0);
+
+	std::vector<uint32_t> ids;
+	for (int row = 0; row < model.rowCount(); ++row)
+		ids.push_back(model.data(model.index(row, 0), Qt::UserRole).toInt());
+	EXPECT_THAT(ids, ::testing::ElementsAre(4, 1, 3, 2));
+}
+
+TEST_F(SolutionModelTest, mergesNewRows) {
+	RemoteSolutionModel model;
+	model.sort(1, Qt::AscendingOrder);
+	EXPECT_TRUE(model.processSolutionIDs({ 1, 5, 3 }, {}, 0, 0.0));
+
+	int inserts = 0, moves = 0, layouts = 0;
+	QObject::connect(&model, &QAbstractItemModel::rowsInserted, [&inserts]() { ++inserts; });
+	QObject::connect(&model, &QAbstractItemModel::rowsMoved, [&moves]() { ++moves; });
+	QObject::connect(&model, &QAbstractItemModel::layoutChanged, [&layouts]() { ++layouts; });
+
+	// new items are inserted at their cost position, consecutive ones with a single signal
+	EXPECT_TRUE(model.processSolutionIDs({ 1, 6, 5, 7, 8, 3, 9 }, {}, 0, 0.0));
+	EXPECT_EQ(inserts, 3);
+	EXPECT_EQ(moves, 0);
+	EXPECT_EQ(layouts, 0);
+
+	std::vector<uint32_t> ids;
+	for (int row = 0; row < model.rowCount(); ++row)
+		ids.push_back(model.data(model.index(row, 0), Qt::UserRole).toInt());
+	EXPECT_THAT(ids, ::testing::ElementsAre(1, 6, 5, 7, 8, 3, 9));
+}
+
+TEST(SolutionCache, lruEviction) {
+	SolutionCache cache(100);
+	std::vector<DisplaySolutionPtr> s;
+	for (int i = 0; i < 5; ++i)
+		s.push_back(std::make_shared<DisplaySolution>());
+
+	cache.insert(1, s[1], 40);
+	cache.insert(2, s[2], 40);
+	EXPECT_EQ(cache.size(), 80u);
+
+	DisplaySolutionPtr result;
+	ASSERT_TRUE(cache.get(1, result));  // 1 becomes most recently used
+	EXPECT_EQ(result, s[1]);
+
+	cache.insert(3, s[3], 40);  // evicts 2
+	EXPECT_EQ(cache.count(), 2u);
+	EXPECT_EQ(cache.size(), 80u);
+	EXPECT_TRUE(cache.contains(1));
+	EXPECT_FALSE(cache.contains(2));
+	EXPECT_FALSE(cache.get(2, result));
+
+	// replacing an entry updates its size
+	cache.insert(3, s[3], 10);
+	EXPECT_EQ(cache.size(), 50u);
+
+	// an entry exceeding the capacity alone is kept
+	cache.insert(4, s[4], 200);
+	EXPECT_EQ(cache.count(), 1u);
+	EXPECT_TRUE(cache.contains(4));
+
+	cache.setCapacity(1000);
+	cache.insert(1, s[1], 40);
+	EXPECT_EQ(cache.count(), 2u);
+	cache.setCapacity(100);
+	EXPECT_EQ(cache.count(), 1u);
+	EXPECT_TRUE(cache.contains(1));
+}
+
+TEST(DisplaySolution, timeIndex) {
+	// sub trajectories with 3, 0, and 2 way points, spaced by 0.5s
+	std::vector<moveit_task_constructor_msgs::SubTrajectory> subs(3);
+	for (double t : { 0.0, 0.5, 1.0 }) {
+		subs[0].trajectory.joint_trajectory.points.emplace_back();
+		subs[0].trajectory.joint_trajectory.points.back().time_from_start = ros::Duration(t);
+	}
+	for (double t : { 0.5, 1.0 }) {
+		subs[2].trajectory.multi_dof_joint_trajectory.points.emplace_back();
+		subs[2].trajectory.multi_dof_joint_trajectory.points.back().time_from_start = ros::Duration(t);
+	}
+	DisplaySolution solution;
+	solution.setFromMessage(planning_scene::PlanningSceneConstPtr(), subs);
+
+	EXPECT_EQ(solution.getWayPointCount(), 5u);
+	EXPECT_DOUBLE_EQ(solution.getDuration(), 2.0);
+	EXPECT_EQ(solution.indexPair(2), DisplaySolution::IndexPair(0, 2));
+	EXPECT_EQ(solution.indexPair(3), DisplaySolution::IndexPair(2, 0));
+	EXPECT_DOUBLE_EQ(solution.getWayPointTime(4), 2.0);
+
+	double fraction;
+	EXPECT_EQ(solution.indexAt(0.25, &fraction), 0u);
+	EXPECT_DOUBLE_EQ(fraction, 0.5);
+	// no interpolation across sub trajectories
+	EXPECT_EQ(solution.indexAt(1.25, &fraction), 2u);
+	EXPECT_DOUBLE_EQ(fraction, 0.0);
+	EXPECT_EQ(solution.indexAt(1.75, &fraction), 3u);
+	EXPECT_DOUBLE_EQ(fraction, 0.5);
+	EXPECT_EQ(solution.indexAt(5.0, &fraction), 4u);
+
+	// sub solutions share the index
+	DisplaySolution last(solution, 2);
+	EXPECT_DOUBLE_EQ(last.getDuration(), 1.0);
+	EXPECT_EQ(last.indexAt(0.75), 0u);
+	EXPECT_EQ(last.indexAt(0.25), 0u);
+}
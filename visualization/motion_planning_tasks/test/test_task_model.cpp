@@ -39,10 +39,17 @@
 #include <src/remote_task_model.h>
 #include <moveit/task_constructor/container.h>
 #include <moveit/task_constructor/stages/current_state.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <rviz/properties/property.h>
+#include <rviz/properties/property_tree_model.h>
 
 #include <ros/init.h>
 #include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
 #include <initializer_list>
+#include <thread>
 #include <qcoreapplication.h>
 
 using namespace moveit::task_constructor;
@@ -189,6 +196,80 @@ TEST_F(TaskListModelTest, localTaskModel) {
 	}
 }
 
+// generator blocking its first compute() until released
+struct BlockingGenerator : public Generator
+{
+	planning_scene::PlanningScenePtr scene_;
+	std::atomic<bool> released_{ false };
+	bool done_ = false;
+
+	BlockingGenerator(const planning_scene::PlanningScenePtr& scene) : Generator("blocking"), scene_(scene) {}
+	bool canCompute() const override { return !done_; }
+	void compute() override {
+		while (!released_)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		done_ = true;
+		spawn(InterfaceState(scene_), 0.0);
+	}
+};
+
+static rviz::Property* findProperty(rviz::PropertyTreeModel* model, const QString& name) {
+	rviz::Property* root = model->getRoot();
+	for (int i = 0, end = root->numChildren(); i != end; ++i)
+		if (root->childAt(i)->getName() == name)
+			return root->childAt(i);
+	return nullptr;
+}
+
+static bool isEditable(const rviz::Property* property) {
+	return property->getViewFlags(1) & Qt::ItemIsEditable;
+}
+
+TEST_F(TaskListModelTest, localTaskModelPlanning) {
+	moveit::core::RobotModelBuilder builder("robot", "base");
+	builder.addChain("base->link1", "continuous");
+	auto scene = std::make_shared<planning_scene::PlanningScene>(builder.build());
+
+	moveit_rviz_plugin::LocalTaskModel m(std::make_unique<SerialContainer>("task pipeline"), scene, nullptr);
+	auto generator = new BlockingGenerator(scene);
+	m.add(Stage::pointer(generator));
+	const QModelIndex stage_idx = m.index(0, 0, m.index(0, 0));
+
+	rviz::PropertyTreeModel* stage_props = m.getPropertyModel(stage_idx);
+	rviz::Property* timeout = findProperty(stage_props, "timeout");
+	ASSERT_TRUE(timeout);
+	EXPECT_TRUE(isEditable(timeout));
+
+	ASSERT_TRUE(m.startPlanning(1));
+	EXPECT_TRUE(m.taskFlags() & moveit_rviz_plugin::BaseTaskModel::IS_RUNNING);
+	EXPECT_FALSE(m.startPlanning(1));  // already running
+
+	// neither stages nor their properties can be edited while the planning thread reads them
+	EXPECT_FALSE(m.setData(stage_idx, QString("renamed")));
+	EXPECT_FALSE(m.removeRows(0, 1, m.index(0, 0)));
+	EXPECT_FALSE(isEditable(timeout));
+	// property models created while running are locked as well
+	rviz::Property* root_timeout = findProperty(m.getPropertyModel(m.index(0, 0)), "timeout");
+	ASSERT_TRUE(root_timeout);
+	EXPECT_FALSE(isEditable(root_timeout));
+
+	// wait for onPlanningFinished(), which is queued to this thread
+	generator->released_ = true;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while ((m.taskFlags() & moveit_rviz_plugin::BaseTaskModel::IS_RUNNING) &&
+	       std::chrono::steady_clock::now() < deadline) {
+		QCoreApplication::sendPostedEvents();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_FALSE(m.taskFlags() & moveit_rviz_plugin::BaseTaskModel::IS_RUNNING);
+	EXPECT_EQ(m.solutions().size(), 1u);
+
+	// properties are unlocked again
+	EXPECT_TRUE(isEditable(timeout));
+	EXPECT_TRUE(isEditable(root_timeout));
+	EXPECT_TRUE(m.setData(stage_idx, QString("renamed")));
+}
+
 TEST_F(TaskListModelTest, noChildren) {
 	children = 0;
 	populateAndValidate();
@@ -230,6 +311,26 @@ TEST_F(TaskListModelTest, deletion) {
 	EXPECT_EQ(model.rowCount(), 0);
 }
 
+TEST_F(TaskListModelTest, incrementalDescription) {
+	children = 3;
+	auto delta = genMsg("first");
+	delta.delta = true;
+	model.processTaskDescriptionMessage(delta, nh, "get_solution");
+	EXPECT_EQ(model.rowCount(), 0);  // deltas of unknown tasks are ignored
+
+	auto skeleton = genMsg("first");
+	for (auto& stage : skeleton.stages)
+		stage.properties_omitted = true;
+	model.processTaskDescriptionMessage(skeleton, nh, "get_solution");
+	validate(model, { "first" });
+
+	// deltas update stages of known tasks
+	delta.stages.erase(delta.stages.begin());
+	model.processTaskDescriptionMessage(delta, nh, "get_solution");
+	validate(model, { "first" });
+	EXPECT_EQ(num_inserts, 1);
+}
+
 int main(int argc, char** argv) {
 	testing::InitGoogleTest(&argc, argv);
 	ros::init(argc, argv, "test_task_model");
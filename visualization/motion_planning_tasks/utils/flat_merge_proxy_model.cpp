@@ -36,7 +36,7 @@
 
 #include "flat_merge_proxy_model.h"
 #include <vector>
-#include <numeric>
+#include <unordered_map>
 
 namespace moveit_rviz_plugin {
 namespace utils {
@@ -105,28 +105,66 @@ public:
 
 	// top-level items
 	std::vector<ModelData> data_;
+	// position of models in data_
+	std::unordered_map<const QObject*, size_t> positions_;
+	// Fenwick tree over top-level row counts of data_ (1-based), providing O(log n) row offsets
+	std::vector<int> row_tree_;
+
+	static inline size_t lowestBit(size_t i) { return i & (~i + 1); }
 
 public:
 	FlatMergeProxyModelPrivate(FlatMergeProxyModel* model) : q_ptr(model) {}
 
 	std::vector<ModelData>::iterator find(const QObject* model) {
 		Q_ASSERT(model);
-		return std::find_if(data_.begin(), data_.end(), [model](const auto& data) { return data.model_ == model; });
+		auto it = positions_.find(model);
+		return it == positions_.end() ? data_.end() : data_.begin() + it->second;
 	}
 
-	int accumulatedRowCount(std::vector<ModelData>::const_iterator start,
-	                        std::vector<ModelData>::const_iterator end) const {
-		return std::accumulate(start, end, 0, [](int acc, const auto& d) { return acc + d.model_->rowCount(); });
+	// rebuild positions_ and row_tree_ after changes of data_
+	void rebuildRowIndex() {
+		positions_.clear();
+		row_tree_.assign(data_.size() + 1, 0);
+		for (size_t i = 1; i <= data_.size(); ++i) {
+			positions_[data_[i - 1].model_] = i - 1;
+			row_tree_[i] += data_[i - 1].model_->rowCount();
+			size_t parent = i + lowestBit(i);
+			if (parent < row_tree_.size())
+				row_tree_[parent] += row_tree_[i];
+		}
 	}
-	int rowOffset(QObject* model) {
+	// update row count of top-level rows of model at pos
+	void addRows(size_t pos, int delta) {
+		for (size_t i = pos + 1; i < row_tree_.size(); i += lowestBit(i))
+			row_tree_[i] += delta;
+	}
+	// accumulated top-level rows of all models before pos
+	int rowOffset(size_t pos) const {
 		int result = 0;
-		for (const ModelData& d : data_) {
-			if (d.model_ == model)
-				return result;
-			result += d.model_->rowCount();
+		for (size_t i = pos; i > 0; i -= lowestBit(i))
+			result += row_tree_[i];
+		return result;
+	}
+	int rowOffset(QObject* model) {
+		auto it = positions_.find(model);
+		Q_ASSERT(it != positions_.end());
+		return rowOffset(it->second);
+	}
+	int totalRowCount() const { return rowOffset(data_.size()); }
+	// position of model providing top-level proxy row, which is reduced to the source row
+	size_t locate(int& row) const {
+		size_t pos = 0;
+		size_t step = 1;
+		while (2 * step < row_tree_.size())
+			step *= 2;
+		// find largest pos with rowOffset(pos) <= row
+		for (; step > 0; step /= 2) {
+			if (pos + step < row_tree_.size() && row_tree_[pos + step] <= row) {
+				pos += step;
+				row -= row_tree_[pos];
+			}
 		}
-		Q_ASSERT(false);
-		return 0;
+		return pos;  // data_.size() if row is too large
 	}
 
 	// retrieve the source_index corresponding to proxy_index
@@ -134,8 +172,20 @@ public:
 		Q_ASSERT(proxy_index.isValid());
 		Q_ASSERT(proxy_index.model() == q_ptr);
 
-		int prev_rows = 0;  // accumulated rows from previous models
-		for (const ModelData& d : data_) {
+		// fast path for top-level items
+		int src_row = proxy_index.row();
+		size_t pos = locate(src_row);
+		if (pos < data_.size()) {
+			const ModelData& d = data_[pos];
+			auto it = d.proxy_to_source_mapping_.find(proxy_index.internalPointer());
+			if (it != d.proxy_to_source_mapping_.end() && !it->second.isValid()) {
+				data = const_cast<ModelData*>(&d);
+				return d.model_->index(src_row, proxy_index.column(), QModelIndex());
+			}
+		}
+
+		for (size_t i = 0; i < data_.size(); ++i) {
+			const ModelData& d = data_[i];
 			// internal_pointer points to source parent
 			auto it = d.proxy_to_source_mapping_.find(proxy_index.internalPointer());
 			if (it != d.proxy_to_source_mapping_.end()) {
@@ -144,11 +194,10 @@ public:
 				int row = proxy_index.row();
 
 				if (!src_index.isValid())  // top-level item of embedded model
-					row -= prev_rows;  // need to reduce row by number of previous' models rows
+					row -= rowOffset(i);  // need to reduce row by number of previous' models rows
 
 				return d.model_->index(row, proxy_index.column(), src_index);
 			}
-			prev_rows += d.model_->rowCount();
 		}
 		Q_ASSERT(false);
 		return QModelIndex();
@@ -161,15 +210,10 @@ public:
 		QModelIndex src_parent = src.parent();
 		int prev_rows = 0;
 		if (!src_parent.isValid()) {  // src is top-level item
-			auto it = data_.begin(), end = data_.end();
-			for (; it != end; ++it) {
-				if (it->model_ == src.model()) {
-					data = &const_cast<ModelData&>(*it);
-					break;
-				}
-				prev_rows += it->model_->rowCount();
-			}
-			Q_ASSERT(it != end);
+			auto it = positions_.find(src.model());
+			Q_ASSERT(it != positions_.end());
+			data = const_cast<ModelData*>(&data_[it->second]);
+			prev_rows = rowOffset(it->second);
 		}
 
 		// store source index in mapping: easy, if we already know the correspondig model (coming top-down)
@@ -189,14 +233,11 @@ public:
 		const QModelIndex& src_parent = src.parent();
 		if (!src_parent.isValid()) {  // reached root
 			// figure out corresponding ModelData from src.model()
-			for (const ModelData& d : data_) {
-				if (d.model_ == src.model()) {
-					data = const_cast<ModelData*>(&d);
-					data->storeMapping(src.internalPointer(), src_parent);
-					return;
-				}
-			}
-			Q_ASSERT(false);  // src should be part of our model!
+			auto it = positions_.find(src.model());
+			Q_ASSERT(it != positions_.end());  // src should be part of our model!
+			data = const_cast<ModelData*>(&data_[it->second]);
+			data->storeMapping(src.internalPointer(), src_parent);
+			return;
 		}
 
 		// recursively climb the tree
@@ -256,7 +297,7 @@ int FlatMergeProxyModel::rowCount(const QModelIndex& parent) const {
 		return 0;
 
 	if (!parent.isValid())  // root
-		return d_ptr->accumulatedRowCount(d_ptr->data_.begin(), d_ptr->data_.end());
+		return d_ptr->totalRowCount();
 
 	FlatMergeProxyModelPrivate::ModelData* data = nullptr;
 	QModelIndex src_parent = d_ptr->mapToSource(parent, data);
@@ -280,18 +321,16 @@ QModelIndex FlatMergeProxyModel::index(int row, int column, const QModelIndex& p
 		return QModelIndex();
 
 	if (!parent.isValid()) {  // top-level items
-		int prev_rows = 0;
-		for (FlatMergeProxyModelPrivate::ModelData& d : const_cast<FlatMergeProxyModelPrivate*>(d_ptr)->data_) {
-			int rows = d.model_->rowCount();
-			if (row - prev_rows < rows) {
-				const QModelIndex& src_index = d.model_->index(row - prev_rows, column, QModelIndex());
-				// for top-level item, internal pointer refers to model
-				d.storeMapping(src_index.internalPointer(), QModelIndex());
-				return createIndex(row, column, src_index.internalPointer());
-			}
-			prev_rows += rows;
-		}
-		return QModelIndex();  // row is too large
+		int src_row = row;
+		size_t pos = d_ptr->locate(src_row);
+		if (pos >= d_ptr->data_.size())
+			return QModelIndex();  // row is too large
+
+		FlatMergeProxyModelPrivate::ModelData& d = const_cast<FlatMergeProxyModelPrivate*>(d_ptr)->data_[pos];
+		const QModelIndex& src_index = d.model_->index(src_row, column, QModelIndex());
+		// for top-level item, internal pointer refers to model
+		d.storeMapping(src_index.internalPointer(), QModelIndex());
+		return createIndex(row, column, src_index.internalPointer());
 	}
 
 	// other items need to refer to operation on source model
@@ -420,20 +459,16 @@ bool FlatMergeProxyModel::insertModel(QAbstractItemModel* model, int pos) {
 	if (pos < 0)
 		pos = modelCount() + std::max<int>(pos + 1, -modelCount());
 	Q_ASSERT(pos >= 0 && pos <= (int)modelCount());
+	if (d_ptr->positions_.count(model))
+		return false;  // model can only inserted once
+
 	auto it = d_ptr->data_.begin();
 	std::advance(it, pos);
 
-	int row = 0;
-	for (const auto& d : d_ptr->data_) {
-		if (d.model_ == model)
-			return false;  // model can only inserted once
-		// accumulate rowCount() of models before pos
-		if (--pos >= 0)
-			row += d.model_->rowCount();
-	}
-
+	int row = d_ptr->rowOffset(pos);
 	beginInsertRows(QModelIndex(), row, row + model->rowCount() - 1);
 	d_ptr->data_.insert(it, FlatMergeProxyModelPrivate::ModelData(model));
+	d_ptr->rebuildRowIndex();
 	endInsertRows();
 
 	connect(model, SIGNAL(destroyed(QObject*)), this, SLOT(_q_sourceDestroyed(QObject*)));
@@ -516,11 +551,13 @@ bool FlatMergeProxyModelPrivate::removeModel(std::vector<ModelData>::iterator it
 	if (it == data_.end())
 		return false;
 
-	int row = accumulatedRowCount(data_.begin(), it);
-	q_ptr->beginRemoveRows(QModelIndex(), row, row + it->model_->rowCount() - 1);
+	const size_t pos = it - data_.begin();
+	int row = rowOffset(pos);
+	q_ptr->beginRemoveRows(QModelIndex(), row, rowOffset(pos + 1) - 1);
 	if (call)
 		q_ptr->onRemoveModel(it->model_);
 	it = data_.erase(it);
+	rebuildRowIndex();
 	q_ptr->endRemoveRows();
 	return true;
 }
@@ -557,31 +594,30 @@ void FlatMergeProxyModelPrivate::_q_sourceRowsAboutToBeRemoved(const QModelIndex
 
 // NOLINTNEXTLINE(readability-identifier-naming)
 void FlatMergeProxyModelPrivate::_q_sourceRowsInserted(const QModelIndex& parent, int start, int end) {
-	Q_UNUSED(parent)
-	Q_UNUSED(start)
-	Q_UNUSED(end)
+	if (!parent.isValid())
+		addRows(positions_.at(q_ptr->sender()), end - start + 1);
 	q_ptr->endInsertRows();
 }
 
 // NOLINTNEXTLINE(readability-identifier-naming)
 void FlatMergeProxyModelPrivate::_q_sourceRowsMoved(const QModelIndex& sourceParent, int sourceStart, int sourceEnd,
                                                     const QModelIndex& destParent, int dest) {
-	Q_UNUSED(sourceParent)
-	Q_UNUSED(sourceStart)
-	Q_UNUSED(sourceEnd)
-	Q_UNUSED(destParent)
 	Q_UNUSED(dest)
+	// moves between levels change the number of top-level rows
+	const size_t pos = positions_.at(q_ptr->sender());
+	if (!sourceParent.isValid())
+		addRows(pos, sourceStart - sourceEnd - 1);
+	if (!destParent.isValid())
+		addRows(pos, sourceEnd - sourceStart + 1);
 	q_ptr->endMoveRows();
 }
 
 // NOLINTNEXTLINE(readability-identifier-naming)
 void FlatMergeProxyModelPrivate::_q_sourceRowsRemoved(const QModelIndex& parent, int start, int end) {
-	Q_UNUSED(parent)
-	Q_UNUSED(start)
-	Q_UNUSED(end)
-
 	auto it = find(q_ptr->sender());
 	Q_ASSERT(it != data_.end());
+	if (!parent.isValid())
+		addRows(it - data_.begin(), start - end - 1);
 	if (it->rowsRemoved())
 		q_ptr->endRemoveRows();
 }
@@ -36,6 +36,7 @@
 
 #include "tree_merge_proxy_model.h"
 #include <vector>
+#include <unordered_map>
 
 namespace moveit_rviz_plugin {
 namespace utils {
@@ -55,9 +56,10 @@ public:
 		QAbstractItemModel* model_;
 
 		// map of proxy=source QModelIndex's internal pointer to source parent's QModelIndex
-		using ProxyToSourceMap = std::map<void*, QPersistentModelIndex>;
+		using ProxyToSourceMap = std::unordered_map<void*, QPersistentModelIndex>;
 		ProxyToSourceMap proxy_to_source_mapping_;
-		std::vector<ProxyToSourceMap::iterator> invalidated_mappings_;
+		// keys of mappings invalidated by a pending row removal
+		std::vector<void*> invalidated_mappings_;
 
 		inline void storeMapping(void* src_internal_pointer, const QModelIndex& src_parent) {
 			ProxyToSourceMap::value_type pair(src_internal_pointer, src_parent);
@@ -79,13 +81,13 @@ public:
 				QModelIndex current = it->second;
 				if (src_parent == current) {  // it is on affected level
 					if (std::find(pointers.begin(), pointers.end(), it->first) != pointers.end())
-						invalidated_mappings_.push_back(it);
+						invalidated_mappings_.push_back(it->first);
 				} else {  // not on affected level, check parents
 					while (current.isValid()) {
 						QModelIndex current_parent = current.parent();
 						if (current_parent == src_parent) {  // current on affected level
 							if (current.row() >= start && current.row() < end)
-								invalidated_mappings_.push_back(it);
+								invalidated_mappings_.push_back(it->first);
 							break;
 						}
 						current = current_parent;
@@ -94,11 +96,13 @@ public:
 			}
 			return !invalidated_mappings_.empty();
 		}
-		bool rowsRemoved() {
+		bool rowsRemoved(std::unordered_map<void*, size_t>& owners) {
 			bool affected = !invalidated_mappings_.empty();
 			// remove invalidated mappings
-			for (auto it : invalidated_mappings_)
-				proxy_to_source_mapping_.erase(it);
+			for (void* key : invalidated_mappings_) {
+				proxy_to_source_mapping_.erase(key);
+				owners.erase(key);
+			}
 			invalidated_mappings_.clear();
 			return affected;
 		}
@@ -106,13 +110,26 @@ public:
 
 	// top-level items
 	std::vector<ModelData> data_;
+	// position of models in data_
+	std::unordered_map<const QObject*, size_t> positions_;
+	// cache: internal pointer of proxy index -> position of owning model in data_
+	mutable std::unordered_map<void*, size_t> owners_;
 
 public:
 	TreeMergeProxyModelPrivate(TreeMergeProxyModel* model) : q_ptr(model) {}
 
 	std::vector<ModelData>::iterator find(const QObject* model) {
 		Q_ASSERT(model);
-		return std::find_if(data_.begin(), data_.end(), [model](const auto& data) { return data.model_ == model; });
+		auto it = positions_.find(model);
+		return it == positions_.end() ? data_.end() : data_.begin() + it->second;
+	}
+
+	// positions in data_ have changed: rebuild lookup tables
+	void modelsChanged() {
+		positions_.clear();
+		for (size_t i = 0; i < data_.size(); ++i)
+			positions_[data_[i].model_] = i;
+		owners_.clear();
 	}
 
 	// retrieve the source_index corresponding to proxy_index
@@ -125,10 +142,22 @@ public:
 			return QModelIndex();
 		}
 
-		for (const ModelData& d : data_) {
+		void* key = proxy_index.internalPointer();
+		auto owner = owners_.find(key);
+		if (owner != owners_.end()) {
+			const ModelData& d = data_[owner->second];
+			auto it = d.proxy_to_source_mapping_.find(key);
+			Q_ASSERT(it != d.proxy_to_source_mapping_.end());
+			data = const_cast<ModelData*>(&d);
+			return d.model_->index(proxy_index.row(), proxy_index.column(), it->second);
+		}
+
+		for (size_t i = 0; i < data_.size(); ++i) {
+			const ModelData& d = data_[i];
 			// internal_pointer points to source parent
-			auto it = d.proxy_to_source_mapping_.find(proxy_index.internalPointer());
+			auto it = d.proxy_to_source_mapping_.find(key);
 			if (it != d.proxy_to_source_mapping_.end()) {
+				owners_.emplace(key, i);
 				data = const_cast<ModelData*>(&d);
 				return d.model_->index(proxy_index.row(), proxy_index.column(), it->second);
 			}
@@ -141,12 +170,10 @@ public:
 		if (!src.isValid()) {  // root src index: map to group item
 			QObject* model = data ? data->model_ : q_ptr->sender();
 			Q_ASSERT(model);
-			for (int row = 0, end = data_.size(); row != end; ++row) {
-				if (data_.at(row).model_ == model)
-					// for top-level items, internal pointer refers to this model
-					return q_ptr->createIndex(row, 0, q_ptr);
-			}
-			Q_ASSERT(false);
+			auto it = positions_.find(model);
+			Q_ASSERT(it != positions_.end());
+			// for top-level items, internal pointer refers to this model
+			return q_ptr->createIndex(it->second, 0, q_ptr);
 		}
 
 		QModelIndex src_parent = src.parent();
@@ -164,32 +191,25 @@ public:
 
 	void mapSourceIndexes(const QModelIndex& src, ModelData*& data) const {
 		Q_ASSERT(src.isValid());
+		// figure out corresponding ModelData from src.model()
+		auto pos = positions_.find(src.model());
+		Q_ASSERT(pos != positions_.end());  // src should be part of our model!
+		data = const_cast<ModelData*>(&data_[pos->second]);
+		storeMappings(src, *data);
+	}
 
-		const QModelIndex& src_parent = src.parent();
-		if (!src_parent.isValid()) {  // reached root
-			// figure out corresponding ModelData from src.model()
-			for (const ModelData& d : data_) {
-				if (d.model_ == src.model()) {
-					data = const_cast<ModelData*>(&d);
-					data->storeMapping(src.internalPointer(), src_parent);
-					return;
-				}
-			}
-			Q_ASSERT(false);  // src should be part of our model!
-		}
+	// store mappings of src and its ancestors, stopping at the first already known one
+	static void storeMappings(const QModelIndex& src, ModelData& data) {
+		if (data.proxy_to_source_mapping_.count(src.internalPointer()))
+			return;
 
-		// recursively climb the tree
-		mapSourceIndexes(src_parent, data);
-		// now data should be well-defined
-		data->storeMapping(src.internalPointer(), src_parent);
+		const QModelIndex& src_parent = src.parent();
+		if (src_parent.isValid())  // recursively climb the tree
+			storeMappings(src_parent, data);
+		data.storeMapping(src.internalPointer(), src_parent);
 	}
 
-	std::vector<ModelData>::iterator getModelIterator(const QAbstractItemModel* model) {
-		for (auto it = data_.begin(), end = data_.end(); it != end; ++it)
-			if (it->model_ == model)
-				return it;
-		return data_.end();
-	}
+	std::vector<ModelData>::iterator getModelIterator(const QAbstractItemModel* model) { return find(model); }
 
 	bool removeModel(std::vector<ModelData>::iterator it, bool call);
 
@@ -378,6 +398,7 @@ bool TreeMergeProxyModel::removeRows(int row, int count, const QModelIndex& pare
 		beginRemoveRows(QModelIndex(), row, row + count - 1);
 		std::for_each(first, last, [this](const auto& data) { this->onRemoveModel(data.model_); });
 		d_ptr->data_.erase(first, last);
+		d_ptr->modelsChanged();
 		endRemoveRows();
 		return true;
 	} else {
@@ -392,9 +413,8 @@ bool TreeMergeProxyModel::insertModel(const QString& name, QAbstractItemModel* m
 		return false;  // invalid model
 	if (!d_ptr->data_.empty() && model->columnCount() != columnCount())
 		return false;  // all models must have same column count
-	for (const auto& d : d_ptr->data_)
-		if (d.model_ == model)
-			return false;  // model can only inserted once
+	if (d_ptr->positions_.count(model))
+		return false;  // model can only inserted once
 
 	// limit pos to range [0, modelCount()]
 	if (pos > 0 && pos > (int)modelCount())
@@ -407,6 +427,7 @@ bool TreeMergeProxyModel::insertModel(const QString& name, QAbstractItemModel* m
 
 	beginInsertRows(QModelIndex(), pos, pos);
 	d_ptr->data_.insert(it, TreeMergeProxyModelPrivate::ModelData(name, model));
+	d_ptr->modelsChanged();
 	endInsertRows();
 
 	connect(model, SIGNAL(destroyed(QObject*)), this, SLOT(_q_sourceDestroyed(QObject*)));
@@ -499,6 +520,7 @@ bool TreeMergeProxyModelPrivate::removeModel(std::vector<ModelData>::iterator it
 	if (call)
 		q_ptr->onRemoveModel(it->model_);
 	data_.erase(it);
+	modelsChanged();
 	q_ptr->endRemoveRows();
 	return true;
 }
@@ -554,7 +576,7 @@ void TreeMergeProxyModelPrivate::_q_sourceRowsRemoved(const QModelIndex& parent,
 
 	auto it = find(q_ptr->sender());
 	Q_ASSERT(it != data_.end());
-	if (it->rowsRemoved())
+	if (it->rowsRemoved(owners_))
 		q_ptr->endRemoveRows();
 }
 
@@ -38,10 +38,12 @@
 
 #include <moveit_task_constructor_msgs/Solution.h>
 #include <moveit/macros/class_forward.h>
+#include <memory>
 
 namespace moveit {
 namespace core {
 MOVEIT_CLASS_FORWARD(RobotState);
+MOVEIT_CLASS_FORWARD(RobotModel);
 }
 }  // namespace moveit
 namespace planning_scene {
@@ -62,45 +64,55 @@ namespace moveit_rviz_plugin {
 MOVEIT_CLASS_FORWARD(DisplaySolution);
 MOVEIT_CLASS_FORWARD(MarkerVisualization);
 
-/** Class representing a task solution for display */
+/** Class representing a task solution for display
+ *
+ *  Sub trajectories are kept as raw messages and only converted into RobotTrajectories
+ *  and PlanningScenes, when they are accessed for the first time.
+ */
 class DisplaySolution
 {
+	struct Data;
+	struct Segments;
+
 	/// number of overall steps
-	size_t steps_;
-	/// start scene
-	planning_scene::PlanningSceneConstPtr start_scene_;
-
-	struct Data
-	{
-		/// end scene for each sub trajectory
-		planning_scene::PlanningSceneConstPtr scene_;
-		/// sub trajectories, might be empty
-		robot_trajectory::RobotTrajectoryPtr trajectory_;
-		/// joints involved in the trajectory
-		std::vector<std::string> joints_;
-		/// comment of the trajectory
-		std::string comment_;
-		/// id of creating stage
-		uint32_t creator_id_;
-		/// rviz markers
-		MarkerVisualizationPtr markers_;
-	};
-	std::vector<Data> data_;
+	size_t steps_ = 0;
+	/// sub trajectories, shared with DisplaySolutions created for individual sub trajectories
+	std::shared_ptr<Segments> segments_;
+	/// range of sub trajectories in segments_ represented by this solution
+	size_t first_ = 0;
+	size_t count_ = 0;
+
+	/// access (and materialize if needed) sub trajectory i of this solution
+	const Data& data(size_t i) const;
 
 public:
 	DisplaySolution() = default;
 	/// create DisplaySolution for given sub trajectory of master
 	DisplaySolution(const DisplaySolution& master, uint32_t sub);
 
-	size_t numSubSolutions() const { return data_.size(); }
+	size_t numSubSolutions() const { return count_; }
 
 	size_t getWayPointCount() const { return steps_; }
 	bool empty() const { return steps_ == 0; }
 
-	/// pair of trajectory part and way point index within part
+	/// overall duration of all sub trajectories [s], available without materializing any sub trajectory
+	double getDuration() const;
+
+	/// pair of trajectory part and way point index within part, O(log n) in the number of parts
 	using IndexPair = std::pair<size_t, size_t>;
 	IndexPair indexPair(size_t index) const;
 
+	/// time of given way point from start of the solution, getDuration() for index >= getWayPointCount()
+	double getWayPointTime(size_t index) const;
+	/** index of last way point not later than given time from start, O(log n) in the number of way points
+	 *
+	 * If fraction is given, it is set to the relative time to the next way point of the same sub trajectory,
+	 * i.e. 0 if there is no such way point. Use interpolate() to compute the corresponding state.
+	 */
+	size_t indexAt(double time, double* fraction = nullptr) const;
+	/// interpolate between way points index and index + 1 of the same sub trajectory
+	void interpolate(size_t index, double fraction, moveit::core::RobotState& state) const;
+
 	float getWayPointDurationFromPrevious(const IndexPair& idx_pair) const;
 	float getWayPointDurationFromPrevious(size_t index) const {
 		if (index >= steps_)
@@ -109,23 +121,26 @@ public:
 	}
 	const moveit::core::RobotStatePtr& getWayPointPtr(const IndexPair& idx_pair) const;
 	const moveit::core::RobotStatePtr& getWayPointPtr(size_t index) const { return getWayPointPtr(indexPair(index)); }
-	const planning_scene::PlanningSceneConstPtr& startScene() const { return start_scene_; }
+	const planning_scene::PlanningSceneConstPtr& startScene() const;
+	/// robot model of the solution, available without materializing any sub trajectory
+	const moveit::core::RobotModelConstPtr& robotModel() const;
 	const planning_scene::PlanningSceneConstPtr& scene(const IndexPair& idx_pair) const;
-	const planning_scene::PlanningSceneConstPtr& scene(size_t index) const {
-		if (index >= steps_)
-			return data_.back().scene_;
-		return scene(indexPair(index));
-	}
+	/// scene at given way point, the final scene for index >= getWayPointCount()
+	const planning_scene::PlanningSceneConstPtr& scene(size_t index) const;
 	const std::string& comment(const IndexPair& idx_pair) const;
 	const std::string& comment(size_t index) const { return comment(indexPair(index)); }
 	uint32_t creatorId(const IndexPair& idx_pair) const;
 
 	const MarkerVisualizationPtr markers(const IndexPair& idx_pair) const;
 	const MarkerVisualizationPtr markers(size_t index) const { return markers(indexPair(index)); }
-	const MarkerVisualizationPtr markersOfSubTrajectory(size_t index) const { return data_.at(index).markers_; }
+	const MarkerVisualizationPtr markersOfSubTrajectory(size_t index) const;
 
+	/// initialize start_scene from msg.start_scene and sub trajectories from msg
 	void setFromMessage(const planning_scene::PlanningScenePtr& start_scene,
 	                    const moveit_task_constructor_msgs::Solution& msg);
+	/// initialize from sub trajectories, starting from the given (already initialized) scene
+	void setFromMessage(const planning_scene::PlanningSceneConstPtr& start_scene,
+	                    const std::vector<moveit_task_constructor_msgs::SubTrajectory>& sub_trajectories);
 	void fillMessage(moveit_task_constructor_msgs::Solution& msg) const;
 };
 }  // namespace moveit_rviz_plugin
@@ -38,39 +38,41 @@ MOVEIT_CLASS_FORWARD(MarkerVisualization);
  */
 class MarkerVisualization
 {
-	// list of all markers, attached to scene nodes in namespaces_
+	// marker, attached to a frame's scene node in its namespace
 	struct MarkerData
 	{
-		visualization_msgs::MarkerPtr msg_;
+		// message, shared between all markers of identical content (using a process-wide pool)
+		visualization_msgs::MarkerConstPtr msg_;
 		std::shared_ptr<rviz::MarkerBase> marker_;
 
-		MarkerData(const visualization_msgs::Marker& marker);
+		MarkerData(const visualization_msgs::MarkerConstPtr& msg) : msg_(msg) {}
 	};
 	struct NamespaceData
 	{
 		Ogre::SceneNode* ns_node_ = nullptr;
 		// markers grouped by frame
 		std::map<std::string, Ogre::SceneNode*> frames_;
+		// markers of this namespace, rviz::MarkerBase instances are only created when first shown
+		std::deque<MarkerData> markers_;
+		bool markers_created_ = false;
 	};
 
-	// list of all markers
-	std::deque<MarkerData> markers_;
 	// markers grouped by their namespace
 	std::map<std::string, NamespaceData> namespaces_;
 
 	// planning_frame_ of scene
 	std::string planning_frame_;
-	// flag indicating that markers were created
-	bool markers_created_ = false;
+	// context used for (lazy) creation of markers, valid after createMarkers()
+	rviz::DisplayContext* context_ = nullptr;
 
 public:
 	MarkerVisualization(const std::vector<visualization_msgs::Marker>& markers,
 	                    const planning_scene::PlanningScene& end_scene);
 	~MarkerVisualization();
 
-	/// did we successfully created all markers (and scene nodes)?
-	bool created() const { return markers_created_; }
-	/// create markers (placed at planning frame of scene)
+	/// did we successfully created all scene nodes?
+	bool created() const { return context_ != nullptr; }
+	/// create scene nodes for all namespaces, markers themselves are created when their namespace is shown
 	bool createMarkers(rviz::DisplayContext* context, Ogre::SceneNode* scene_node);
 	/// update marker position/orientation based on frames of given scene + robot_state
 	void update(const planning_scene::PlanningScene& end_scene, const moveit::core::RobotState& robot_state);
@@ -79,7 +81,9 @@ public:
 	void setVisible(const QString& ns, Ogre::SceneNode* parent_scene_node, bool visible);
 
 private:
-	void update(MarkerData& data, const planning_scene::PlanningScene& end_scene,
+	/// create markers of namespace (placed at planning frame of scene)
+	bool createMarkers(NamespaceData& ns);
+	void update(NamespaceData& ns, const planning_scene::PlanningScene& end_scene,
 	            const moveit::core::RobotState& robot_state) const;
 };
 
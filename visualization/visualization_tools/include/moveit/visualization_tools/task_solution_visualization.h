@@ -40,6 +40,8 @@
 #include <moveit_task_constructor_msgs/Solution.h>
 #include <QObject>
 #include <boost/thread/mutex.hpp>
+#include <map>
+#include <set>
 
 class QColor;
 
@@ -66,6 +68,7 @@ class PanelDockWidget;
 namespace moveit {
 namespace core {
 MOVEIT_CLASS_FORWARD(RobotModel);
+MOVEIT_CLASS_FORWARD(RobotState);
 }
 }  // namespace moveit
 namespace planning_scene {
@@ -144,8 +147,11 @@ protected:
 	void setVisibility(Ogre::SceneNode* node, Ogre::SceneNode* parent, bool visible);
 	float getStateDisplayTime();
 	void clearTrail();
+	/// fill trail_waypoints_ and links to show for LOD mode, false if Trail Group is invalid
+	bool computeLODTrail(const DisplaySolution& solution, std::set<std::string>& links);
 	void renderCurrentWayPoint();
-	void renderWayPoint(size_t index, int previous_index);
+	/// render way point index, interpolated by fraction towards the next way point
+	void renderWayPoint(size_t index, int previous_index, double fraction = 0.0);
 	void renderPlanningScene(const planning_scene::PlanningSceneConstPtr& scene);
 
 	// render the planning scene
@@ -162,14 +168,22 @@ protected:
 	DisplaySolutionPtr displaying_solution_;
 	DisplaySolutionPtr next_solution_to_display_;
 	std::vector<rviz::Robot*> trail_;
+	std::vector<int> trail_waypoints_;  // waypoint indexes shown by trail_ (sorted)
 	bool animating_ = false;  // auto-progressing the current waypoint?
 	bool drop_displaying_solution_ = false;
 	bool locked_ = false;
 	int current_state_ = -1;
 	float current_state_time_;
+	double current_time_ = 0.0;  // trajectory time of REALTIME playback
+	double current_fraction_ = 0.0;  // interpolation towards next waypoint
+	moveit::core::RobotStatePtr interpolated_state_;
+	// first way point of the sub trajectory interpolated_state_ was copied from
+	std::weak_ptr<const moveit::core::RobotState> interpolated_source_;
 	boost::mutex display_solution_mutex_;
 
 	planning_scene::PlanningScenePtr scene_;
+	// start scenes of received solutions, by start_scene_id
+	std::map<std::string, planning_scene::PlanningSceneConstPtr> start_scenes_;
 
 	// Pointers from parent display that we save
 	rviz::Display* display_;  // the parent display that this class populates
@@ -194,6 +208,9 @@ protected:
 	rviz::BoolProperty* trail_display_property_;
 	rviz::BoolProperty* interrupt_display_property_;
 	rviz::IntProperty* trail_step_size_property_;
+	rviz::EnumProperty* trail_mode_property_;
+	rviz::EditableEnumProperty* trail_group_property_;
+	rviz::FloatProperty* trail_min_distance_property_;
 
 	// PlanningScene Properties
 	rviz::BoolProperty* scene_enabled_property_;
@@ -40,50 +40,196 @@
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <ros/console.h>
 #include <boost/format.hpp>
+#include <algorithm>
 
 namespace moveit_rviz_plugin {
 
+struct DisplaySolution::Data
+{
+	/// end scene for each sub trajectory
+	planning_scene::PlanningSceneConstPtr scene_;
+	/// sub trajectories, might be empty
+	robot_trajectory::RobotTrajectoryPtr trajectory_;
+	/// joints involved in the trajectory
+	std::vector<std::string> joints_;
+	/// comment of the trajectory
+	std::string comment_;
+	/// id of creating stage
+	uint32_t creator_id_;
+	/// number of way points
+	size_t steps_;
+	/// time from start of the sub trajectory for each way point
+	std::vector<double> times_;
+	/// rviz markers
+	MarkerVisualizationPtr markers_;
+};
+
+/// sequence of sub trajectories, materialized in order (each one starts from the end scene of its predecessor)
+struct DisplaySolution::Segments
+{
+	/// start scene
+	planning_scene::PlanningSceneConstPtr start_scene_;
+	std::vector<Data> data_;
+	/// raw messages of sub trajectories, released once materialized
+	std::vector<moveit_task_constructor_msgs::SubTrajectory> msgs_;
+	/// number of leading sub trajectories already materialized
+	size_t materialized_ = 0;
+	/// prefix sums of number of way points and durations of sub trajectories (size: data_.size() + 1)
+	std::vector<size_t> step_offsets_;
+	std::vector<double> time_offsets_;
+
+	const Data& get(size_t i) {
+		while (materialized_ <= i)
+			materializeNext();
+		return data_[i];
+	}
+	const planning_scene::PlanningSceneConstPtr& startScene(size_t i) {
+		return i == 0 ? start_scene_ : get(i - 1).scene_;
+	}
+	void materializeNext();
+};
+
+void DisplaySolution::Segments::materializeNext() {
+	assert(materialized_ < data_.size());
+	Data& data = data_[materialized_];
+	moveit_task_constructor_msgs::SubTrajectory& sub = msgs_[materialized_];
+
+	planning_scene::PlanningScenePtr ref_scene = startScene(materialized_)->diff();
+	data.trajectory_.reset(new robot_trajectory::RobotTrajectory(ref_scene->getRobotModel(), nullptr));
+	data.trajectory_->setRobotTrajectoryMsg(ref_scene->getCurrentState(), sub.trajectory);
+	data.joints_ = sub.trajectory.joint_trajectory.joint_names;
+	data.joints_.insert(data.joints_.end(), sub.trajectory.multi_dof_joint_trajectory.joint_names.begin(),
+	                    sub.trajectory.multi_dof_joint_trajectory.joint_names.end());
+
+	ref_scene->setPlanningSceneDiffMsg(sub.scene_diff);
+	data.scene_ = ref_scene;
+
+	if (!sub.info.markers.empty())
+		data.markers_.reset(new MarkerVisualization(sub.info.markers, *ref_scene));
+	else
+		data.markers_.reset();
+
+	sub = moveit_task_constructor_msgs::SubTrajectory();  // release message
+	++materialized_;
+}
+
+const DisplaySolution::Data& DisplaySolution::data(size_t i) const {
+	assert(i < count_);
+	return segments_->get(first_ + i);
+}
+
+double DisplaySolution::getDuration() const {
+	if (!segments_)
+		return 0.0;
+	return segments_->time_offsets_[first_ + count_] - segments_->time_offsets_[first_];
+}
+
 std::pair<size_t, size_t> DisplaySolution::indexPair(size_t index) const {
-	size_t part = 0;
-	for (const auto& d : data_) {
-		if (index < d.trajectory_->getWayPointCount())
-			break;
-		index -= d.trajectory_->getWayPointCount();
-		++part;
+	// first part ending behind index (skipping empty parts)
+	const auto begin = segments_->step_offsets_.begin() + first_;
+	const auto end = begin + count_ + 1;
+	index += *begin;
+	auto it = std::upper_bound(begin + 1, end, index);
+	assert(it != end);
+	return std::make_pair(it - begin - 1, index - *(it - 1));
+}
+
+double DisplaySolution::getWayPointTime(size_t index) const {
+	if (index >= steps_)
+		return getDuration();
+	const IndexPair idx_pair = indexPair(index);
+	const size_t part = first_ + idx_pair.first;
+	return segments_->time_offsets_[part] - segments_->time_offsets_[first_] +
+	       segments_->data_[part].times_[idx_pair.second];
+}
+
+size_t DisplaySolution::indexAt(double time, double* fraction) const {
+	if (fraction)
+		*fraction = 0.0;
+	if (steps_ == 0)
+		return 0;
+
+	const auto& starts = segments_->time_offsets_;
+	time += starts[first_];
+	// last part starting not later than time
+	size_t part = std::upper_bound(starts.begin() + first_ + 1, starts.begin() + first_ + count_, time) -
+	              starts.begin() - 1;
+	for (;; --part) {
+		// last way point of part not later than time, falling back to preceding parts if there is none
+		const std::vector<double>& times = segments_->data_[part].times_;
+		const double local = time - starts[part];
+		auto it = std::upper_bound(times.begin(), times.end(), local);
+		if (it == times.begin() && part > first_)
+			continue;
+
+		if (fraction && it != times.begin() && it != times.end() && *it > *(it - 1))
+			*fraction = (local - *(it - 1)) / (*it - *(it - 1));
+		size_t index = segments_->step_offsets_[part] - segments_->step_offsets_[first_];
+		if (it != times.begin())
+			index += it - times.begin() - 1;
+		return std::min(index, steps_ - 1);
 	}
-	assert(part < data_.size());
-	assert(index < data_[part].trajectory_->getWayPointCount());
-	return std::make_pair(part, index);
+}
+
+void DisplaySolution::interpolate(size_t index, double fraction, moveit::core::RobotState& state) const {
+	const IndexPair idx_pair = indexPair(index);
+	const auto& trajectory = data(idx_pair.first).trajectory_;
+	assert(idx_pair.second + 1 < trajectory->getWayPointCount());
+	trajectory->getWayPoint(idx_pair.second).interpolate(trajectory->getWayPoint(idx_pair.second + 1), fraction, state);
+	state.update();
 }
 
 DisplaySolution::DisplaySolution(const DisplaySolution& master, uint32_t sub)
-  : start_scene_(sub == 0 ? master.start_scene_ : master.data_[sub - 1].scene_), data_({ master.data_[sub] }) {
-	steps_ = data_.front().trajectory_->getWayPointCount();
+  : segments_(master.segments_), first_(master.first_ + sub), count_(1) {
+	assert(sub < master.count_);
+	steps_ = segments_->data_[first_].steps_;
 }
 
 float DisplaySolution::getWayPointDurationFromPrevious(const IndexPair& idx_pair) const {
-	return data_[idx_pair.first].trajectory_->getWayPointDurationFromPrevious(idx_pair.second);
+	return data(idx_pair.first).trajectory_->getWayPointDurationFromPrevious(idx_pair.second);
 }
 
 const robot_state::RobotStatePtr& DisplaySolution::getWayPointPtr(const IndexPair& idx_pair) const {
-	return data_[idx_pair.first].trajectory_->getWayPointPtr(idx_pair.second);
+	return data(idx_pair.first).trajectory_->getWayPointPtr(idx_pair.second);
+}
+
+const planning_scene::PlanningSceneConstPtr& DisplaySolution::startScene() const {
+	static const planning_scene::PlanningSceneConstPtr NONE;
+	return segments_ ? segments_->startScene(first_) : NONE;
+}
+
+const moveit::core::RobotModelConstPtr& DisplaySolution::robotModel() const {
+	static const moveit::core::RobotModelConstPtr NONE;
+	return segments_ ? segments_->start_scene_->getRobotModel() : NONE;
 }
 
 const planning_scene::PlanningSceneConstPtr& DisplaySolution::scene(const IndexPair& idx_pair) const {
 	// start scene is parent of end scene
-	return data_[idx_pair.first].scene_->getParent();
+	return data(idx_pair.first).scene_->getParent();
+}
+
+const planning_scene::PlanningSceneConstPtr& DisplaySolution::scene(size_t index) const {
+	if (index < steps_)
+		return scene(indexPair(index));
+	return count_ == 0 ? startScene() : data(count_ - 1).scene_;
 }
 
 const std::string& DisplaySolution::comment(const IndexPair& idx_pair) const {
-	return data_[idx_pair.first].comment_;
+	return segments_->data_[first_ + idx_pair.first].comment_;
 }
 
 uint32_t DisplaySolution::creatorId(const DisplaySolution::IndexPair& idx_pair) const {
-	return data_[idx_pair.first].creator_id_;
+	return segments_->data_[first_ + idx_pair.first].creator_id_;
 }
 
 const MarkerVisualizationPtr DisplaySolution::markers(const DisplaySolution::IndexPair& idx_pair) const {
-	return data_[idx_pair.first].markers_;
+	return data(idx_pair.first).markers_;
+}
+
+const MarkerVisualizationPtr DisplaySolution::markersOfSubTrajectory(size_t index) const {
+	if (index >= count_)
+		throw std::out_of_range("invalid sub trajectory index");
+	return data(index).markers_;
 }
 
 void DisplaySolution::setFromMessage(const planning_scene::PlanningScenePtr& start_scene,
@@ -96,45 +242,55 @@ void DisplaySolution::setFromMessage(const planning_scene::PlanningScenePtr& sta
 
 	// initialize parent scene from solution's start scene
 	start_scene->setPlanningSceneMsg(msg.start_scene);
-	start_scene_ = start_scene;
-	planning_scene::PlanningScenePtr ref_scene = start_scene_->diff();
+	setFromMessage(start_scene, msg.sub_trajectory);
+}
 
-	data_.resize(msg.sub_trajectory.size());
+void DisplaySolution::setFromMessage(const planning_scene::PlanningSceneConstPtr& start_scene,
+                                     const std::vector<moveit_task_constructor_msgs::SubTrajectory>& sub_trajectories) {
+	segments_ = std::make_shared<Segments>();
+	segments_->start_scene_ = start_scene;
+	segments_->msgs_ = sub_trajectories;
+	segments_->data_.resize(sub_trajectories.size());
+	segments_->step_offsets_.assign(1, 0);
+	segments_->time_offsets_.assign(1, 0.0);
+	first_ = 0;
+	count_ = sub_trajectories.size();
 
+	// only fetch meta data, trajectories and scenes are materialized on first access
 	steps_ = 0;
 	size_t i = 0;
-	for (const auto& sub : msg.sub_trajectory) {
-		data_[i].trajectory_.reset(new robot_trajectory::RobotTrajectory(ref_scene->getRobotModel(), nullptr));
-		data_[i].trajectory_->setRobotTrajectoryMsg(ref_scene->getCurrentState(), sub.trajectory);
-		data_[i].joints_ = sub.trajectory.joint_trajectory.joint_names;
-		data_[i].joints_.insert(data_[i].joints_.end(), sub.trajectory.multi_dof_joint_trajectory.joint_names.begin(),
-		                        sub.trajectory.multi_dof_joint_trajectory.joint_names.end());
-		data_[i].comment_ = sub.info.comment;
-		data_[i].creator_id_ = sub.info.stage_id;
-		steps_ += data_[i].trajectory_->getWayPointCount();
-
-		ref_scene->setPlanningSceneDiffMsg(sub.scene_diff);
-		data_[i].scene_ = ref_scene;
-
-		// create new reference scene for next iteration
-		ref_scene = ref_scene->diff();
-
-		if (!sub.info.markers.empty())
-			data_[i].markers_.reset(new MarkerVisualization(sub.info.markers, *ref_scene));
-		else
-			data_[i].markers_.reset();
-		++i;
+	for (const auto& sub : sub_trajectories) {
+		Data& data = segments_->data_[i++];
+		data.comment_ = sub.info.comment;
+		data.creator_id_ = sub.info.stage_id;
+		// RobotTrajectory::setRobotTrajectoryMsg() considers both, joint and multi-dof trajectories
+		data.steps_ = std::max(sub.trajectory.joint_trajectory.points.size(),
+		                       sub.trajectory.multi_dof_joint_trajectory.points.size());
+		steps_ += data.steps_;
+
+		data.times_.clear();
+		data.times_.reserve(data.steps_);
+		if (sub.trajectory.joint_trajectory.points.size() == data.steps_) {
+			for (const auto& point : sub.trajectory.joint_trajectory.points)
+				data.times_.push_back(point.time_from_start.toSec());
+		} else {
+			for (const auto& point : sub.trajectory.multi_dof_joint_trajectory.points)
+				data.times_.push_back(point.time_from_start.toSec());
+		}
+		segments_->step_offsets_.push_back(steps_);
+		segments_->time_offsets_.push_back(segments_->time_offsets_.back() +
+		                                   (data.times_.empty() ? 0.0 : data.times_.back()));
 	}
 }
 
 void DisplaySolution::fillMessage(moveit_task_constructor_msgs::Solution& msg) const {
-	start_scene_->getPlanningSceneMsg(msg.start_scene);
-	msg.sub_trajectory.resize(data_.size());
+	startScene()->getPlanningSceneMsg(msg.start_scene);
+	msg.sub_trajectory.resize(count_);
 	auto traj_it = msg.sub_trajectory.begin();
-	for (const auto& sub : data_) {
+	for (size_t i = 0; i < count_; ++i, ++traj_it) {
+		const Data& sub = data(i);
 		sub.scene_->getPlanningSceneDiffMsg(traj_it->scene_diff);
 		sub.trajectory_->getRobotTrajectoryMsg(traj_it->trajectory, sub.joints_);
-		++traj_it;
 	}
 }
 
@@ -13,16 +13,52 @@
 #include <tf2_msgs/TF2Error.h>
 #include <ros/console.h>
 #include <eigen_conversions/eigen_msg.h>
+#include <ros/serialization.h>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
 
 namespace moveit_rviz_plugin {
 
-// create MarkerData with nil marker_ pointer, just with a copy of message
-MarkerVisualization::MarkerData::MarkerData(const visualization_msgs::Marker& marker) {
-	msg_.reset(new visualization_msgs::Marker(marker));
-	msg_->header.stamp = ros::Time();
-	msg_->frame_locked = false;
+namespace {
+std::vector<uint8_t> serialize(const visualization_msgs::Marker& marker) {
+	std::vector<uint8_t> buffer(ros::serialization::serializationLength(marker));
+	ros::serialization::OStream stream(buffer.data(), buffer.size());
+	ros::serialization::serialize(stream, marker);
+	return buffer;
 }
 
+/// Return a shared instance of marker, deduplicating markers of identical content across all solutions.
+/// Many solutions show the very same markers (e.g. grasp frames), which are stored only once this way.
+visualization_msgs::MarkerConstPtr sharedMarker(const visualization_msgs::Marker& marker) {
+	static std::mutex mutex;
+	static std::unordered_multimap<size_t, std::weak_ptr<const visualization_msgs::Marker>> pool;
+	static size_t prune_size = 1024;
+
+	std::vector<uint8_t> buffer = serialize(marker);
+	size_t hash = std::hash<std::string>()(std::string(buffer.begin(), buffer.end()));
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto range = pool.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		visualization_msgs::MarkerConstPtr candidate = it->second.lock();
+		if (candidate && serialize(*candidate) == buffer)
+			return candidate;
+	}
+
+	// drop expired entries once the pool has grown significantly
+	if (pool.size() >= prune_size) {
+		for (auto it = pool.begin(); it != pool.end();)
+			it = it->second.expired() ? pool.erase(it) : std::next(it);
+		prune_size = std::max<size_t>(1024, 2 * pool.size());
+	}
+
+	visualization_msgs::MarkerConstPtr result(new visualization_msgs::Marker(marker));
+	pool.emplace(hash, result);
+	return result;
+}
+}  // namespace
+
 MarkerVisualization::MarkerVisualization(const std::vector<visualization_msgs::Marker>& markers,
                                          const planning_scene::PlanningScene& end_scene) {
 	planning_frame_ = end_scene.getPlanningFrame();
@@ -34,10 +70,16 @@ MarkerVisualization::MarkerVisualization(const std::vector<visualization_msgs::M
 			continue;  // ignore markers with unknown frame
 		}
 
-		// remember marker message
-		markers_.emplace_back(marker);
-		// remember namespace name
-		namespaces_.insert(std::make_pair(marker.ns, NamespaceData()));
+		// create a copy of the message, ignoring time stamp
+		visualization_msgs::Marker copy(marker);
+		copy.header.stamp = ros::Time();
+		copy.frame_locked = false;
+		visualization_msgs::MarkerConstPtr msg = sharedMarker(copy);
+
+		// remember marker message in its namespace, skipping exact duplicates
+		std::deque<MarkerData>& ns_markers = namespaces_[marker.ns].markers_;
+		if (std::none_of(ns_markers.begin(), ns_markers.end(), [&msg](const MarkerData& d) { return d.msg_ == msg; }))
+			ns_markers.emplace_back(msg);
 	}
 }
 
@@ -57,23 +99,36 @@ void setVisibility(Ogre::SceneNode* node, Ogre::SceneNode* parent, bool visible)
 
 void MarkerVisualization::setVisible(const QString& ns, Ogre::SceneNode* parent_scene_node, bool visible) {
 	auto it = namespaces_.find(ns.toStdString());
-	if (it == namespaces_.end())
+	if (it == namespaces_.end() || !it->second.ns_node_)
+		return;
+	if (visible && !createMarkers(it->second))
 		return;
 	setVisibility(it->second.ns_node_, parent_scene_node, visible);
 }
 
 bool MarkerVisualization::createMarkers(rviz::DisplayContext* context, Ogre::SceneNode* parent_scene_node) {
-	if (markers_created_)
+	if (context_)
+		return true;  // already called before
+
+	for (auto& pair : namespaces_)
+		pair.second.ns_node_ = parent_scene_node->getCreator()->createSceneNode();
+	context_ = context;
+	return true;
+}
+
+bool MarkerVisualization::createMarkers(NamespaceData& ns) {
+	if (ns.markers_created_)
 		return true;  // already called before
+	Q_ASSERT(context_ && ns.ns_node_);
 
 	// fetch transform from planning_frame_ to rviz' fixed frame
-	const std::string& fixed_frame = context->getFrameManager()->getFixedFrame();
+	const std::string& fixed_frame = context_->getFrameManager()->getFixedFrame();
 	Ogre::Quaternion quat;
 	Ogre::Vector3 pos;
 
 	try {
 #ifdef RVIZ_TF1
-		tf::TransformListener* tf = context->getFrameManager()->getTFClient();
+		tf::TransformListener* tf = context_->getFrameManager()->getTFClient();
 		tf::StampedTransform tm;
 		tf->lookupTransform(planning_frame_, fixed_frame, ros::Time(), tm);
 		auto q = tm.getRotation();
@@ -81,7 +136,7 @@ bool MarkerVisualization::createMarkers(rviz::DisplayContext* context, Ogre::Sce
 		quat = Ogre::Quaternion(q.w(), -q.x(), -q.y(), -q.z());
 		pos = Ogre::Vector3(p.x(), p.y(), p.z());
 #else
-		std::shared_ptr<tf2_ros::Buffer> tf = context->getFrameManager()->getTF2BufferPtr();
+		std::shared_ptr<tf2_ros::Buffer> tf = context_->getFrameManager()->getTF2BufferPtr();
 		geometry_msgs::TransformStamped tm;
 		tm = tf->lookupTransform(planning_frame_, fixed_frame, ros::Time());
 		auto q = tm.transform.rotation;
@@ -94,23 +149,16 @@ bool MarkerVisualization::createMarkers(rviz::DisplayContext* context, Ogre::Sce
 		return false;
 	}
 
-	for (MarkerData& data : markers_) {
+	for (MarkerData& data : ns.markers_) {
 		if (data.marker_)
 			continue;
 
-		auto ns_it = namespaces_.find(data.msg_->ns);
-		Q_ASSERT(ns_it != namespaces_.end());  // we have added all namespaces before!
-		if (ns_it->second.ns_node_ == nullptr)  // create scene node for this namespace
-			ns_it->second.ns_node_ = parent_scene_node->getCreator()->createSceneNode();
-		Ogre::SceneNode* node = ns_it->second.ns_node_;
-
 		// create a scene node for all markers with given frame name
-		auto frame_it = ns_it->second.frames_.insert(std::make_pair(data.msg_->header.frame_id, nullptr)).first;
+		auto frame_it = ns.frames_.insert(std::make_pair(data.msg_->header.frame_id, nullptr)).first;
 		if (frame_it->second == nullptr)
-			frame_it->second = node->createChildSceneNode();
-		node = frame_it->second;
+			frame_it->second = ns.ns_node_->createChildSceneNode();
 
-		data.marker_.reset(rviz::createMarker(data.msg_->type, nullptr, context, node));
+		data.marker_.reset(rviz::createMarker(data.msg_->type, nullptr, context_, frame_it->second));
 		if (!data.marker_)
 			continue;  // failed to create marker
 
@@ -118,55 +166,52 @@ bool MarkerVisualization::createMarkers(rviz::DisplayContext* context, Ogre::Sce
 		// w.r.t. rviz' current fixed frame. However, we want to place the marker w.r.t.
 		// the planning frame of the planning scene!
 
-		// Hence, temporarily modify the message-specified frame to planning_frame_
-		const std::string msg_frame = data.msg_->header.frame_id;
-		data.msg_->header.frame_id = planning_frame_;
-		data.marker_->setMessage(data.msg_);
-		data.msg_->header.frame_id = msg_frame;
+		// Hence, pass a copy of the (shared) message with the frame modified to planning_frame_
+		visualization_msgs::MarkerPtr msg(new visualization_msgs::Marker(*data.msg_));
+		msg->header.frame_id = planning_frame_;
+		data.marker_->setMessage(msg);
 
 		// ... and subsequently revert any transform between rviz' fixed frame and planning_frame_
 		data.marker_->setOrientation(quat * data.marker_->getOrientation());
 		data.marker_->setPosition(quat * data.marker_->getPosition() + pos);
 	}
-	markers_created_ = true;
+	ns.markers_created_ = true;
 	return true;
 }
 
-void MarkerVisualization::update(MarkerData& data, const planning_scene::PlanningScene& scene,
+void MarkerVisualization::update(NamespaceData& ns, const planning_scene::PlanningScene& scene,
                                  const moveit::core::RobotState& robot_state) const {
 	Q_ASSERT(scene.getPlanningFrame() == planning_frame_);
 
-	const visualization_msgs::Marker& marker = *data.msg_;
-	if (marker.header.frame_id == scene.getPlanningFrame())
-		return;  // no need to transform nodes placed at planning frame
-
-	// fetch base pose from robot_state / scene
-	Eigen::Affine3d pose;
-	if (robot_state.knowsFrameTransform(marker.header.frame_id))
-		pose = robot_state.getFrameTransform(marker.header.frame_id);
-	else if (scene.knowsFrameTransform(marker.header.frame_id))
-		pose = scene.getFrameTransform(marker.header.frame_id);
-	else {
-		ROS_WARN_ONCE_NAMED("MarkerVisualization", "unknown frame '%s' for solution marker in namespace '%s'",
-		                    marker.header.frame_id.c_str(), marker.ns.c_str());
-		return;  // ignore markers with unknown frame
-	}
-
-	auto ns_it = namespaces_.find(marker.ns);
-	Q_ASSERT(ns_it != namespaces_.end());  // we have added all namespaces before
-	auto frame_it = ns_it->second.frames_.find(marker.header.frame_id);
-	Q_ASSERT(frame_it != ns_it->second.frames_.end());  // we have created all of them
+	// all markers of a frame share a scene node: update them at once
+	for (const auto& frame : ns.frames_) {
+		const std::string& frame_id = frame.first;
+		if (frame_id == scene.getPlanningFrame())
+			continue;  // no need to transform nodes placed at planning frame
+
+		// fetch base pose from robot_state / scene
+		Eigen::Affine3d pose;
+		if (robot_state.knowsFrameTransform(frame_id))
+			pose = robot_state.getFrameTransform(frame_id);
+		else if (scene.knowsFrameTransform(frame_id))
+			pose = scene.getFrameTransform(frame_id);
+		else {
+			ROS_WARN_ONCE_NAMED("MarkerVisualization", "unknown frame '%s' for solution marker", frame_id.c_str());
+			continue;  // ignore markers with unknown frame
+		}
 
-	const Eigen::Quaterniond q = (Eigen::Quaterniond)pose.linear();
-	const Eigen::Vector3d& p = pose.translation();
-	frame_it->second->setOrientation(Ogre::Quaternion(q.w(), q.x(), q.y(), q.z()));
-	frame_it->second->setPosition(Ogre::Vector3(p.x(), p.y(), p.z()));
+		const Eigen::Quaterniond q = (Eigen::Quaterniond)pose.linear();
+		const Eigen::Vector3d& p = pose.translation();
+		frame.second->setOrientation(Ogre::Quaternion(q.w(), q.x(), q.y(), q.z()));
+		frame.second->setPosition(Ogre::Vector3(p.x(), p.y(), p.z()));
+	}
 }
 
 void MarkerVisualization::update(const planning_scene::PlanningScene& end_scene,
                                  const moveit::core::RobotState& robot_state) {
-	for (MarkerData& data : markers_)
-		update(data, end_scene, robot_state);
+	for (auto& pair : namespaces_)
+		if (pair.second.markers_created_)
+			update(pair.second, end_scene, robot_state);
 }
 
 MarkerVisualizationProperty::MarkerVisualizationProperty(const QString& name, rviz::Property* parent)
@@ -217,8 +262,9 @@ void MarkerVisualizationProperty::addMarkers(const MarkerVisualizationPtr& marke
 		}
 		Q_ASSERT(pair.second.ns_node_);  // nodes should have been created in createMarkers()
 
+		// markers of enabled namespaces are created on demand
 		if (ns_it->second->getBool())
-			marker_scene_node_->addChild(pair.second.ns_node_);
+			markers->setVisible(ns, marker_scene_node_, true);
 	}
 }
 
@@ -68,7 +68,17 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/trim.hpp>
 
+#include <algorithm>
+
 namespace moveit_rviz_plugin {
+namespace {
+enum TrailMode
+{
+	TRAIL_FULL,
+	TRAIL_LOD
+};
+}  // namespace
+
 TaskSolutionVisualization::TaskSolutionVisualization(rviz::Property* parent, rviz::Display* display)
   : display_(display) {
 	// trajectory properties
@@ -99,6 +109,25 @@ TaskSolutionVisualization::TaskSolutionVisualization(rviz::Property* parent, rvi
 	    SLOT(changedTrail()), this);
 	trail_step_size_property_->setMin(1);
 
+	trail_mode_property_ = new rviz::EnumProperty("Trail Mode", "Full",
+	                                              "Full: show whole robot every Trail Step Size waypoints\n"
+	                                              "Level of Detail: only show Trail Group links, spaced by distance",
+	                                              parent, SLOT(changedTrail()), this);
+	trail_mode_property_->addOption("Full", TRAIL_FULL);
+	trail_mode_property_->addOption("Level of Detail", TRAIL_LOD);
+
+	trail_group_property_ =
+	    new rviz::EditableEnumProperty("Trail Group", "",
+	                                   "Group whose links (and attached end-effectors) are shown in LOD mode. "
+	                                   "The trail is spaced by the motion of its last link.",
+	                                   trail_mode_property_, SLOT(changedTrail()), this);
+
+	trail_min_distance_property_ =
+	    new rviz::FloatProperty("Trail Min Distance", 0.05f,
+	                            "Minimal Cartesian distance (in m) between trail samples in LOD mode",
+	                            trail_mode_property_, SLOT(changedTrail()), this);
+	trail_min_distance_property_->setMin(0.0);
+
 	// robot properties
 	robot_property_ = new rviz::Property("Robot", QString(), QString(), parent);
 	robot_visual_enabled_property_ = new rviz::BoolProperty("Show Robot Visual", true,
@@ -218,6 +247,11 @@ void TaskSolutionVisualization::onRobotModelLoaded(const robot_model::RobotModel
 
 	scene_.reset(new planning_scene::PlanningScene(robot_model));
 
+	trail_group_property_->clearOptions();
+	for (const std::string& group : robot_model->getJointModelGroupNames())
+		trail_group_property_->addOptionStd(group);
+	trail_group_property_->sortOptions();
+
 	robot_render_->load(*robot_model->getURDF());  // load rviz robot
 	enabledRobotColor();  // force-refresh to account for saved display configuration
 }
@@ -241,6 +275,37 @@ void TaskSolutionVisualization::reset() {
 void TaskSolutionVisualization::clearTrail() {
 	qDeleteAll(trail_);
 	trail_.clear();
+	trail_waypoints_.clear();
+}
+
+bool TaskSolutionVisualization::computeLODTrail(const DisplaySolution& solution, std::set<std::string>& links) {
+	const moveit::core::RobotModelConstPtr& model = scene_->getRobotModel();
+	const moveit::core::JointModelGroup* group = model->getJointModelGroup(trail_group_property_->getStdString());
+	if (!group || group->getLinkModels().empty())
+		return false;
+
+	const std::vector<std::string>& group_links = group->getLinkModelNames();
+	links.insert(group_links.begin(), group_links.end());
+	for (const std::string& eef : group->getAttachedEndEffectorNames()) {
+		const std::vector<std::string>& eef_links = model->getEndEffector(eef)->getLinkModelNames();
+		links.insert(eef_links.begin(), eef_links.end());
+	}
+
+	// distance-adaptive decimation: sample whenever the tip moved far enough
+	const moveit::core::LinkModel* tip = group->getLinkModels().back();
+	const double min_distance = trail_min_distance_property_->getFloat();
+	const size_t count = solution.getWayPointCount();
+	Eigen::Vector3d last;
+	for (size_t i = 0; i < count; ++i) {
+		moveit::core::RobotState state(*solution.getWayPointPtr(i));
+		state.updateLinkTransforms();
+		const Eigen::Vector3d position = state.getGlobalLinkTransform(tip).translation();
+		if (i == 0 || i + 1 == count || (position - last).norm() >= min_distance) {
+			trail_waypoints_.push_back(i);
+			last = position;
+		}
+	}
+	return true;
 }
 
 void TaskSolutionVisualization::changedLoopDisplay() {
@@ -264,13 +329,25 @@ void TaskSolutionVisualization::changedTrail() {
 	setVisibility(main_scene_node_, parent_scene_node_, true);
 	setVisibility(trail_scene_node_, main_scene_node_, true);
 
-	int stepsize = trail_step_size_property_->getInt();
-	trail_.resize(t->getWayPointCount() / stepsize);
+	std::set<std::string> links;  // links shown in LOD mode
+	const bool lod = trail_mode_property_->getOptionInt() == TRAIL_LOD && computeLODTrail(*t, links);
+	if (!lod) {
+		int stepsize = trail_step_size_property_->getInt();
+		for (std::size_t i = 0; i < t->getWayPointCount() / stepsize; i++)
+			trail_waypoints_.push_back(std::min(i * stepsize, t->getWayPointCount() - 1));  // limit to last point
+	}
+
+	trail_.resize(trail_waypoints_.size());
 	for (std::size_t i = 0; i < trail_.size(); i++) {
-		int waypoint_i = std::min(i * stepsize, t->getWayPointCount() - 1);  // limit to last trajectory point
+		int waypoint_i = trail_waypoints_[i];
 		rviz::Robot* r =
 		    new rviz::Robot(trail_scene_node_, context_, "Trail Robot " + boost::lexical_cast<std::string>(i), nullptr);
 		r->load(*scene_->getRobotModel()->getURDF());
+		if (lod) {
+			for (auto& link : r->getLinks())
+				if (!links.count(link.first))
+					link.second->getLinkProperty()->setValue(false);  // hide link
+		}
 		r->setVisualVisible(robot_visual_enabled_property_->getBool());
 		r->setCollisionVisible(robot_collision_enabled_property_->getBool());
 		r->setAlpha(robot_alpha_property_->getFloat());
@@ -396,6 +473,7 @@ void TaskSolutionVisualization::update(float wall_dt, float /*ros_dt*/) {
 	} else if (current_state_ < max_state_index)
 		animating_ = true;  // auto-activate animation if slider_panel_ is hidden
 
+	double fraction = 0.0;
 	if (animating_ && current_state_ == previous_state) {
 		// auto-advance current_state_ based on time progress
 		current_state_time_ += wall_dt;
@@ -404,19 +482,24 @@ void TaskSolutionVisualization::update(float wall_dt, float /*ros_dt*/) {
 		if (current_state_ < 0) {  // special case indicating restart of animation
 			current_state_ = 0;
 			current_state_time_ = 0.0;
+			current_time_ = 0.0;
 			trail_scene_node_->setVisible(false);
-		} else if (tm < 0.0) {  // using realtime: skip to next waypoint based on elapsed display time
-			while (current_state_ < max_state_index && (tm = displaying_solution_->getWayPointDurationFromPrevious(
-			                                                current_state_ + 1)) < current_state_time_) {
-				++current_state_;
-				current_state_time_ -= tm;
-			}
-		} else if (current_state_time_ > tm) {  // fixed display time per state
-			++current_state_;
-			current_state_time_ = 0.0;
+		} else if (tm < 0.0) {  // using realtime: look up (and interpolate) waypoint from elapsed trajectory time
+			current_time_ += wall_dt;
+			const double duration = displaying_solution_->getDuration();
+			if (waypoint_count > 0 && current_time_ <= duration)
+				current_state_ = displaying_solution_->indexAt(current_time_, &fraction);
+			else  // show last waypoint for 0.1s before switching to final scene
+				current_state_ = std::max(waypoint_count - 1, 0) + static_cast<int>((current_time_ - duration) / 0.1);
+		} else if (current_state_time_ > tm) {  // fixed display time per state, skipping states on slow frames
+			const int steps = tm > 0.0 ? static_cast<int>(current_state_time_ / tm) : 1;
+			current_state_ = std::min(current_state_ + steps, max_state_index + 1);
+			current_state_time_ = tm > 0.0 ? current_state_time_ - steps * tm : 0.0;
 		}
 	} else if (current_state_ != previous_state) {  // current_state_ changed from slider
 		current_state_time_ = 0.0;
+		if (current_state_ >= 0)
+			current_time_ = displaying_solution_->getWayPointTime(current_state_);
 	}
 
 	if ((waypoint_count > 0 && current_state_ >= max_state_index) ||
@@ -431,31 +514,29 @@ void TaskSolutionVisualization::update(float wall_dt, float /*ros_dt*/) {
 		setVisibility();
 		return;
 	}
-	if (current_state_ == previous_state)
+	if (current_state_ == previous_state && fraction == current_fraction_)
 		return;
 
-	renderWayPoint(current_state_, previous_state);
+	current_fraction_ = fraction;
+	renderWayPoint(current_state_, previous_state, fraction);
 
-	// show / hide trail between start .. end
-	int stepsize = trail_step_size_property_->getInt();
-	int start = std::max(0, previous_state / stepsize);
-	int end = current_state_ / stepsize;
-	bool show = start <= end;
-	if (!show)
-		std::swap(start, end);
-	end = std::min<int>(end, trail_.size());
-	for (; start < end; ++start)
-		trail_[start]->setVisible(show);
+	// show / hide trail samples between previous and current state
+	bool show = previous_state <= current_state_;
+	int low = std::min(previous_state, current_state_);
+	int high = std::max(previous_state, current_state_);
+	for (auto it = std::upper_bound(trail_waypoints_.begin(), trail_waypoints_.end(), low);
+	     it != trail_waypoints_.end() && *it <= high; ++it)
+		trail_[it - trail_waypoints_.begin()]->setVisible(show);
 
 	setVisibility();
 }
 
 void TaskSolutionVisualization::renderCurrentWayPoint() {
 	if (displaying_solution_)
-		renderWayPoint(current_state_, -1);
+		renderWayPoint(current_state_, -1, current_fraction_);
 }
 
-void TaskSolutionVisualization::renderWayPoint(size_t index, int previous_index) {
+void TaskSolutionVisualization::renderWayPoint(size_t index, int previous_index, double fraction) {
 	size_t waypoint_count = displaying_solution_->getWayPointCount();
 	moveit::core::RobotStateConstPtr robot_state;
 	planning_scene::PlanningSceneConstPtr scene;
@@ -483,6 +564,16 @@ void TaskSolutionVisualization::renderWayPoint(size_t index, int previous_index)
 			Q_EMIT activeStageChanged(displaying_solution_->creatorId(idx_pair));
 		}
 		robot_state = displaying_solution_->getWayPointPtr(idx_pair);
+		if (fraction > 0.0) {
+			// copy the state once per sub trajectory, providing its attached bodies
+			const moveit::core::RobotStatePtr& source = displaying_solution_->getWayPointPtr({ idx_pair.first, 0 });
+			if (!interpolated_state_ || interpolated_source_.lock() != source) {
+				interpolated_state_.reset(new moveit::core::RobotState(*robot_state));
+				interpolated_source_ = source;
+			}
+			displaying_solution_->interpolate(index, fraction, *interpolated_state_);
+			robot_state = interpolated_state_;
+		}
 	}
 
 	QColor attached_color = attached_body_color_property_->getColor();
@@ -517,7 +608,21 @@ void TaskSolutionVisualization::renderPlanningScene(const planning_scene::Planni
 
 void TaskSolutionVisualization::showTrajectory(const moveit_task_constructor_msgs::Solution& msg) {
 	DisplaySolutionPtr s(new DisplaySolution);
-	s->setFromMessage(scene_, msg);
+	if (msg.start_scene_id.empty())
+		s->setFromMessage(scene_, msg);
+	else if (!msg.start_scene.robot_model_name.empty()) {  // msg carries start scene: cache it
+		planning_scene::PlanningScenePtr start_scene = scene_->diff();
+		s->setFromMessage(start_scene, msg);
+		start_scenes_[msg.start_scene_id] = start_scene;
+	} else {  // msg refers to a previously sent start scene
+		auto it = start_scenes_.find(msg.start_scene_id);
+		if (it == start_scenes_.end()) {
+			ROS_WARN_STREAM_NAMED("task_solution_visualization",
+			                      "Solution refers to unknown start scene " << msg.start_scene_id);
+			return;
+		}
+		s->setFromMessage(it->second, msg.sub_trajectory);
+	}
 	showTrajectory(s, false);
 }
 